@@ -0,0 +1,315 @@
+#include "twoPhoton.h"
+#include <chrono>
+#include <new>
+
+/* ---------------------------------------------AsyncJobs----------------------------------------------------------
+ ConvolveFrames, SymConvolveFrames and MedianFrames on a big stack can take seconds, and while they run the thread that
+ called them is blocked, which freezes the acquisition user interface if that is Igor's main thread. Their Async
+ versions check their waves and make the output wave as usual, then start a job and return its job ID right away.
+ Each job has a thread of its own that hands the frames to the thread pool and waits for them, so the pool's governor
+ shares the pool between jobs and ordinary calls. A job never asks for all of the pool's threads, so an ordinary call
+ made while it runs still gets a slot, and never waits for the job. AsyncJobProgress polls a job, AsyncJobWait waits
+ for it with a timeout, and AsyncJobCancel stops it. A job is collected, i.e., its waves are released and its buffers
+ are freed, by the AsyncJobWait that sees it finish, or by AsyncJobCancel, after which its job ID is no longer valid.
+ All the jobs are in a list protected by gAsyncMutex.
+ Last Modified 2026/10/16
+ ---------------------------------------------------------------------------------------------------------------*/
+
+/* One job, from when it is started until it is collected
+ Last Modified 2026/10/16 */
+typedef struct AsyncJob{
+    UInt32 jobID;
+    ThreadPoolTileFunc tileFunc;    // tile function doing one frame per tile
+    void* paramsPtr;                // copy of the paramater structure for the tile function, owned by the job
+    CountInt nFrames;               // number of frames, i.e., tiles
+    UInt32 nSlots;                  // most threads to use
+    ThreadPoolControl control;      // cancel flag and frames done, shared with the thread pool
+    waveHndl wavesH [3];            // output, input and kernel waves, held until the job is collected, or nullptr
+    Ptr buffersPtr [2];             // buffer and kernel table, freed when the job is collected, or nullptr
+    pthread_t thread;               // thread running the job
+    UInt8 isDone;                   // set when the thread has finished, protected by gAsyncMutex
+    UInt8 isCollecting;             // set when a thread has taken the job out of the list to collect it
+    UInt32 nWaiters;                // threads in AsyncJobWait for this job, which must leave before it is freed
+    int result;                     // result from the thread pool, 0 or an error code
+    struct AsyncJob* nextJob;
+} AsyncJob, *AsyncJobPtr;
+
+static pthread_mutex_t gAsyncMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t gAsyncDoneCond = PTHREAD_COND_INITIALIZER;   // broadcast when any job finishes or is collected
+static AsyncJobPtr gAsyncJobsHead = nullptr;
+static UInt32 gAsyncNextJobID = 1;
+
+/* Thread function for a job. Runs the job on the thread pool and marks it done
+ Last Modified 2026/10/16 */
+static void* AsyncJobThread (void* threadarg){
+    AsyncJobPtr job = (AsyncJobPtr)threadarg;
+    int result = ThreadPoolRunTilesControlled (job->tileFunc, job->paramsPtr, job->nFrames, 1, job->nSlots, &job->control);
+    pthread_mutex_lock (&gAsyncMutex);
+    job->result = result;
+    job->isDone = 1;
+    pthread_cond_broadcast (&gAsyncDoneCond);
+    pthread_mutex_unlock (&gAsyncMutex);
+    return nullptr;
+}
+
+/* Frees everything a job holds, marking the output wave modified if asked. The job must have been taken out of the
+ list, and its thread must have finished
+ Last Modified 2026/10/16 */
+static void AsyncJobFree (AsyncJobPtr job, UInt8 isModified){
+    UInt8 iWave, iBuffer;
+    if ((isModified) && (job->wavesH [0] != nullptr)) WaveHandleModified (job->wavesH [0]);
+    for (iWave = 0; iWave < 3; iWave++){
+        if (job->wavesH [iWave] != nullptr) ReleaseWave (&job->wavesH [iWave]);
+    }
+    for (iBuffer = 0; iBuffer < 2; iBuffer++){
+        if (job->buffersPtr [iBuffer] != nullptr) WMDisposePtr (job->buffersPtr [iBuffer]);
+    }
+    if (job->paramsPtr != nullptr) WMDisposePtr ((Ptr)job->paramsPtr);
+    delete job;
+}
+
+/* Takes a job out of the list, so no other thread can collect it, and wakes up threads waiting for it.
+ Called with gAsyncMutex locked
+ Last Modified 2026/10/16 */
+static void AsyncJobUnlist (AsyncJobPtr job){
+    AsyncJobPtr prevJob = nullptr, aJob;
+    for (aJob = gAsyncJobsHead; (aJob != nullptr) && (aJob != job); prevJob = aJob, aJob = aJob->nextJob);
+    if (aJob == nullptr) return;
+    if (prevJob == nullptr){
+        gAsyncJobsHead = job->nextJob;
+    }else{
+        prevJob->nextJob = job->nextJob;
+    }
+    job->isCollecting = 1;
+    pthread_cond_broadcast (&gAsyncDoneCond);
+}
+
+/* Returns the job with a job ID, or nullptr if there is no such job, or it has been taken out of the list to collect it.
+ Called with gAsyncMutex locked
+ Last Modified 2026/10/16 */
+static AsyncJobPtr AsyncJobFind (double jobID){
+    AsyncJobPtr job;
+    for (job = gAsyncJobsHead; (job != nullptr) && ((double)job->jobID != jobID); job = job->nextJob);
+    return job;
+}
+
+/* Waits for the thread of a job taken out of the list, and for any threads still in AsyncJobWait for it to leave,
+ then frees the job, returning its result and the fraction of its frames that were done
+ Last Modified 2026/10/16 */
+static int AsyncJobCollect (AsyncJobPtr job, double* fractionDonePtr){
+    int result;
+    pthread_join (job->thread, NULL);
+    pthread_mutex_lock (&gAsyncMutex);
+    while (job->nWaiters > 0) pthread_cond_wait (&gAsyncDoneCond, &gAsyncMutex);
+    pthread_mutex_unlock (&gAsyncMutex);
+    result = job->result;
+    if (fractionDonePtr != nullptr) *fractionDonePtr = (job->nFrames > 0) ? (double)job->control.itemsDone/(double)job->nFrames : 1;
+    AsyncJobFree (job, 1);
+    return result;
+}
+
+/* Starts a job, see AsyncJobs.h
+ Last Modified 2026/10/16 */
+int AsyncJobStart (ThreadPoolTileFunc tileFunc, void* paramsPtr, size_t paramSize, CountInt nFrames, UInt32 nSlots,
+                   waveHndl outPutWaveH, waveHndl inPutWaveH, waveHndl kernelH, Ptr bufferPtr, Ptr kernelTablePtr, double* jobIDPtr){
+    int result = 0;
+    UInt8 iWave;
+    AsyncJobPtr job = new (std::nothrow) AsyncJob ();
+    try{
+        if (job == nullptr) throw result = MEMFAIL;
+        job->buffersPtr [0] = bufferPtr;
+        job->buffersPtr [1] = kernelTablePtr;
+        job->paramsPtr = (void*)WMNewPtr (paramSize);
+        if (job->paramsPtr == nullptr) throw result = MEMFAIL;
+        memcpy (job->paramsPtr, paramsPtr, paramSize);
+        job->tileFunc = tileFunc;
+        job->nFrames = nFrames;
+        // leave a slot free for ordinary calls, so they never wait on a job
+        job->nSlots = (nSlots < ThreadPoolBackgroundSlots ()) ? nSlots : ThreadPoolBackgroundSlots ();
+        job->control.cancel = 0;
+        job->control.itemsDone = 0;
+        // hold each wave once, the input wave may also be the output wave
+        job->wavesH [0] = outPutWaveH;
+        job->wavesH [1] = (inPutWaveH != outPutWaveH) ? inPutWaveH : nullptr;
+        job->wavesH [2] = kernelH;
+        for (iWave = 0; iWave < 3; iWave++){
+            if ((job->wavesH [iWave] != nullptr) && (HoldWave (job->wavesH [iWave]))){
+                for (; iWave < 3; iWave++) job->wavesH [iWave] = nullptr;  // only release the ones we held
+                throw result = WAVEERROR_NOS;
+            }
+        }
+        pthread_mutex_lock (&gAsyncMutex);
+        job->jobID = gAsyncNextJobID++;
+        if (pthread_create (&job->thread, NULL, AsyncJobThread, (void*)job) != 0){
+            pthread_mutex_unlock (&gAsyncMutex);
+            throw result = MEMFAIL;
+        }
+        job->nextJob = gAsyncJobsHead;
+        gAsyncJobsHead = job;
+        *jobIDPtr = (double)job->jobID;
+        pthread_mutex_unlock (&gAsyncMutex);
+    }catch (int result){
+        if (job != nullptr){
+            AsyncJobFree (job, 0);
+        }else{
+            if (bufferPtr != nullptr) WMDisposePtr (bufferPtr);
+            if (kernelTablePtr != nullptr) WMDisposePtr (kernelTablePtr);
+        }
+        return result;
+    }
+    return 0;
+}
+
+/* Cancels and collects every job
+ Last Modified 2026/10/16 */
+void AsyncJobCancelAll (void){
+    AsyncJobPtr job;
+    for (;;){
+        pthread_mutex_lock (&gAsyncMutex);
+        job = gAsyncJobsHead;
+        if (job != nullptr){
+            job->control.cancel = 1;
+            AsyncJobUnlist (job);
+        }
+        pthread_mutex_unlock (&gAsyncMutex);
+        if (job == nullptr) break;
+        AsyncJobCollect (job, nullptr);
+    }
+}
+
+/* --------------------------- AsyncJobProgress--------------------------------------------
+ Returns the fraction of frames done by a job, from 0 to 1, without waiting. The job still needs to be collected with
+ AsyncJobWait, even when it shows 1
+ AsyncJobParams
+ double jobID       job ID returned by one of the Async XFUNCs
+ Last Modified 2026/10/16 */
+extern "C" int AsyncJobProgress (AsyncJobParamsPtr p){
+    int result;
+    AsyncJobPtr job;
+    XFuncTimer timer;  // times each phase of this call, for TwoPhotonStats
+    XFuncTimerStart (&timer, STATS_ASYNCJOBPROGRESS);
+    pthread_mutex_lock (&gAsyncMutex);
+    try{
+        job = AsyncJobFind (p->jobID);
+        if (job == nullptr) throw result = BADJOBID;
+    }catch (int result){
+        pthread_mutex_unlock (&gAsyncMutex);
+        XFuncTimerEnd (&timer);
+        p -> result = (double)(result - FIRST_XOP_ERR);
+#ifdef NO_IGOR_ERR
+        return (0);
+#else
+        return (result);
+#endif
+    }
+    p->result = (job->nFrames > 0) ? (double)job->control.itemsDone/(double)job->nFrames : 1;
+    pthread_mutex_unlock (&gAsyncMutex);
+    XFuncTimerEnd (&timer);
+    return (0);
+}
+
+/* --------------------------- AsyncJobWait--------------------------------------------
+ Waits up to timeOut seconds for a job to finish. Returns 1 if the job finished, in which case it is collected, the
+ output wave is marked modified, and any error from the job, as JOBCANCELLED, is returned. Returns 0 if the job is
+ still running after timeOut seconds. A timeOut of 0 only checks, and a negative timeOut waits as long as it takes
+ AsyncJobWaitParams
+ double timeOut     seconds to wait
+ double jobID       job ID returned by one of the Async XFUNCs
+ Last Modified 2026/10/16 */
+extern "C" int AsyncJobWait (AsyncJobWaitParamsPtr p){
+    int result = 0;
+    AsyncJobPtr job;
+    struct timespec endTime;
+    std::chrono::system_clock::time_point endPoint;
+    UInt8 isDone;
+    XFuncTimer timer;  // times each phase of this call, for TwoPhotonStats
+    XFuncTimerStart (&timer, STATS_ASYNCJOBWAIT);
+    pthread_mutex_lock (&gAsyncMutex);
+    try{
+        job = AsyncJobFind (p->jobID);
+        if (job == nullptr) throw result = BADJOBID;
+    }catch (int result){
+        pthread_mutex_unlock (&gAsyncMutex);
+        XFuncTimerEnd (&timer);
+        p -> result = (double)(result - FIRST_XOP_ERR);
+#ifdef NO_IGOR_ERR
+        return (0);
+#else
+        return (result);
+#endif
+    }
+    XFuncTimerPhase (&timer, STATS_COMPUTE);
+    if (p->timeOut > 0){
+        endPoint = std::chrono::system_clock::now () + std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::duration<double>(p->timeOut));
+        std::chrono::nanoseconds sinceEpoch = std::chrono::duration_cast<std::chrono::nanoseconds>(endPoint.time_since_epoch ());
+        endTime.tv_sec = (time_t)(sinceEpoch.count ()/1000000000);
+        endTime.tv_nsec = (long)(sinceEpoch.count () % 1000000000);
+    }
+    // counted as a waiter, the job is not freed while we wait, even if another thread takes it out of the list
+    job->nWaiters++;
+    while ((job->isDone == 0) && (job->isCollecting == 0) && (p->timeOut != 0)){
+        if (p->timeOut < 0){
+            pthread_cond_wait (&gAsyncDoneCond, &gAsyncMutex);
+        }else if (pthread_cond_timedwait (&gAsyncDoneCond, &gAsyncMutex, &endTime) != 0){
+            break;
+        }
+    }
+    job->nWaiters--;
+    if (job->isCollecting){ // collected by AsyncJobCancel or another AsyncJobWait while we waited
+        isDone = 0;
+        result = BADJOBID;
+        pthread_cond_broadcast (&gAsyncDoneCond);
+    }else{
+        isDone = job->isDone;
+        if (isDone) AsyncJobUnlist (job);
+    }
+    pthread_mutex_unlock (&gAsyncMutex);
+    XFuncTimerPhase (&timer, STATS_FINISH);
+    if (isDone) result = AsyncJobCollect (job, nullptr);
+    XFuncTimerEnd (&timer);
+    p->result = isDone;
+    if (result){
+        p -> result = (double)(result - FIRST_XOP_ERR);
+#ifdef NO_IGOR_ERR
+        return (0);
+#else
+        return (result);
+#endif
+    }
+    return (0);
+}
+
+/* --------------------------- AsyncJobCancel--------------------------------------------
+ Stops a job and collects it. No more frames are started once the job is cancelled, so this waits for at most the
+ frames already being done. Frames of the output wave that were not done are left as they were. Returns the fraction
+ of frames that were done
+ AsyncJobParams
+ double jobID       job ID returned by one of the Async XFUNCs
+ Last Modified 2026/10/16 */
+extern "C" int AsyncJobCancel (AsyncJobParamsPtr p){
+    int result;
+    AsyncJobPtr job;
+    XFuncTimer timer;  // times each phase of this call, for TwoPhotonStats
+    XFuncTimerStart (&timer, STATS_ASYNCJOBCANCEL);
+    pthread_mutex_lock (&gAsyncMutex);
+    try{
+        job = AsyncJobFind (p->jobID);
+        if (job == nullptr) throw result = BADJOBID;
+    }catch (int result){
+        pthread_mutex_unlock (&gAsyncMutex);
+        XFuncTimerEnd (&timer);
+        p -> result = (double)(result - FIRST_XOP_ERR);
+#ifdef NO_IGOR_ERR
+        return (0);
+#else
+        return (result);
+#endif
+    }
+    job->control.cancel = 1;
+    AsyncJobUnlist (job);
+    pthread_mutex_unlock (&gAsyncMutex);
+    XFuncTimerPhase (&timer, STATS_FINISH);
+    AsyncJobCollect (job, &p->result);
+    XFuncTimerEnd (&timer);
+    return (0);
+}
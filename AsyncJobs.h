@@ -0,0 +1,17 @@
+/*
+    AsyncJobs.h -- runs frame by frame XFUNCs on a background thread, so Igor's main thread is not blocked while they run
+*/
+#ifndef ASYNCJOBS_H_
+#define ASYNCJOBS_H_
+
+/* Starts a job that runs tileFunc on the thread pool for nFrames frames, one frame per tile, from a thread of its own,
+ and puts its job ID in jobIDPtr. The paramater structure is copied, so it can be on the caller's stack. The waves are
+ held with HoldWave until the job is collected, so Igor can not kill them while the job uses their data, and outPutWaveH
+ is marked as modified when the job is collected. bufferPtr and kernelTablePtr, which may be nullptr, are freed when
+ the job is collected. If the job can not be started, they are freed before returning an error */
+int AsyncJobStart (ThreadPoolTileFunc tileFunc, void* paramsPtr, size_t paramSize, CountInt nFrames, UInt32 nSlots,
+                   waveHndl outPutWaveH, waveHndl inPutWaveH, waveHndl kernelH, Ptr bufferPtr, Ptr kernelTablePtr, double* jobIDPtr);
+/* Cancels and collects every job, as when the XOP is unloaded */
+void AsyncJobCancelAll (void);
+
+#endif
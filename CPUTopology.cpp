@@ -0,0 +1,447 @@
+#include "twoPhotonKernels.h"
+#ifdef __linux__
+#include <sched.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#endif
+#if defined (_MSC_VER) && (defined (_M_X64) || defined (_M_IX86))
+#include <intrin.h>
+#endif
+
+/* ---------------------------------------------CPUTopology----------------------------------------------------------
+ Counting the processors in the system over-subscribes on shared analysis servers and in containers, where a process
+ may be limited to a few CPUs by its affinity mask or by a cgroup CPU quota, and using every logical CPU is not always
+ best for memory-bound kernels on cores with hyper-threading, or for tiles that wait on efficiency cores of a hybrid CPU.
+ CPUTopologyRead finds the logical CPUs the process may run on, any quota on its run time, and which of those CPUs share
+ a physical core or are performance cores. CPUTopologyNumThreads turns that into a number of threads, with a cap that
+ is set from Igor with SetNumProcessorsCap. CPUTopologySIMDLevel finds which of the kernels' SIMD loops the CPU can run,
+ and CPUTopologyL2Bytes how much L2 cache each thread has, for sizing blocks of work that should stay in cache
+ Last Modified 2026/10/16
+ ---------------------------------------------------------------------------------------------------------------*/
+
+#ifdef __linux__
+/* Reads the first line of a small text file into buffer, returning 0 if the file can not be read
+ Last Modified 2026/10/16 */
+static int CPUTopologyReadLine (const char* path, char* buffer, int bufferSize){
+    FILE* fp = fopen (path, "r");
+    if (fp == nullptr) return 0;
+    char* gotLine = fgets (buffer, bufferSize, fp);
+    fclose (fp);
+    if (gotLine == nullptr) return 0;
+    buffer [strcspn (buffer, "\r\n")] = 0;
+    return 1;
+}
+
+/* Returns non-zero if cpu is in a kernel cpu list string, like "0-7,16-23"
+ Last Modified 2026/10/16 */
+int CPUTopologyInList (const char* list, int cpu){
+    int first, last, nChars;
+    while (sscanf (list, "%d%n", &first, &nChars) == 1){
+        list += nChars;
+        last = first;
+        if (*list == '-'){
+            if (sscanf (list + 1, "%d%n", &last, &nChars) != 1) break;
+            list += nChars + 1;
+        }
+        if ((cpu >= first) && (cpu <= last)) return 1;
+        if (*list != ',') break;
+        list++;
+    }
+    return 0;
+}
+
+/* Returns the number of cpus in a kernel cpu list string, like "0-7,16-23"
+ Last Modified 2026/10/16 */
+UInt32 CPUTopologyListCount (const char* list){
+    int first, last, nChars;
+    UInt32 nCPUs = 0;
+    while (sscanf (list, "%d%n", &first, &nChars) == 1){
+        list += nChars;
+        last = first;
+        if (*list == '-'){
+            if (sscanf (list + 1, "%d%n", &last, &nChars) != 1) break;
+            list += nChars + 1;
+        }
+        if (last >= first) nCPUs += (UInt32)(last - first + 1);
+        if (*list != ',') break;
+        list++;
+    }
+    return nCPUs;
+}
+
+/* Returns CPUs worth of run time allowed by the cgroup CPU quota of this process, rounded up, or 0 if there is none.
+ For cgroup v2 checks cpu.max of the cgroup of the process and each of its parents, and uses the smallest quota. For
+ cgroup v1 checks cpu.cfs_quota_us and cpu.cfs_period_us of the cpu controller. The files are read under rootDir,
+ which is "" but for tests
+ Last Modified 2026/10/16 */
+static UInt32 CPUTopologyCgroupQuota (const char* rootDir){
+    char line [512], cgroupDir [512], path [1024];
+    long long quota, period;
+    UInt32 quotaCPUs = 0, dirQuota;
+    char* slashPtr;
+    // cgroup v2 has a single line starting with 0:: in /proc/self/cgroup
+    cgroupDir [0] = 0;
+    snprintf (path, sizeof (path), "%s/proc/self/cgroup", rootDir);
+    FILE* fp = fopen (path, "r");
+    if (fp != nullptr){
+        while (fgets (line, sizeof (line), fp) != nullptr){
+            if (strncmp (line, "0::", 3) == 0){
+                line [strcspn (line, "\r\n")] = 0;
+                snprintf (cgroupDir, sizeof (cgroupDir), "%s", line + 3);
+                break;
+            }
+        }
+        fclose (fp);
+    }
+    for (;;){
+        snprintf (path, sizeof (path), "%s/sys/fs/cgroup%s/cpu.max", rootDir, (strcmp (cgroupDir, "/") == 0) ? "" : cgroupDir);
+        if ((CPUTopologyReadLine (path, line, sizeof (line))) && (sscanf (line, "%lld %lld", &quota, &period) == 2) && (quota > 0) && (period > 0)){
+            dirQuota = (UInt32)((quota + period - 1)/period);
+            if ((quotaCPUs == 0) || (dirQuota < quotaCPUs)) quotaCPUs = dirQuota;
+        }
+        slashPtr = strrchr (cgroupDir, '/');
+        if (slashPtr == nullptr) break;
+        *slashPtr = 0;  // move up to the parent cgroup, with the root as ""
+    }
+    if (quotaCPUs > 0) return quotaCPUs;
+    // cgroup v1, "max" in cpu.max reads as no quota above, and -1 in cpu.cfs_quota_us means no quota
+    char periodPath [1024];
+    for (int iDir = 0; (iDir < 2) && (quotaCPUs == 0); iDir++){
+        const char* controller = (iDir == 0) ? "cpu" : "cpu,cpuacct";
+        snprintf (path, sizeof (path), "%s/sys/fs/cgroup/%s/cpu.cfs_quota_us", rootDir, controller);
+        snprintf (periodPath, sizeof (periodPath), "%s/sys/fs/cgroup/%s/cpu.cfs_period_us", rootDir, controller);
+        if ((CPUTopologyReadLine (path, line, sizeof (line))) && (sscanf (line, "%lld", &quota) == 1) && (quota > 0) &&
+            (CPUTopologyReadLine (periodPath, line, sizeof (line))) && (sscanf (line, "%lld", &period) == 1) && (period > 0)){
+            quotaCPUs = (UInt32)((quota + period - 1)/period);
+        }
+    }
+    return quotaCPUs;
+}
+
+/* Linux: affinity from sched_getaffinity, quota from cgroups, cores and hybrid layout from sysfs. A core is counted
+ once, from the first allowed logical CPU with its package and core id. Performance cores are the cores with the
+ highest cpu_capacity on ARM big.LITTLE, or the cores listed in /sys/devices/cpu_core/cpus on Intel hybrid CPUs.
+ The sysfs and cgroup files are read under rootDir, which is "" but for tests
+ Last Modified 2026/10/16 */
+void CPUTopologyReadRoot (CPUTopologyPtr topoPtr, const char* rootDir){
+    char line [4096], path [1024];
+    int nConf, iCPU, jCPU, setSize = 1024;
+    cpu_set_t* setPtr = nullptr;
+    UInt64* coreKeysPtr = nullptr;
+    long* capacitiesPtr = nullptr;
+    long maxCapacity = 0, minCapacity = -1, coreId, packageId;
+    UInt8 isFirst, hasCapacity = 1, hasCoreList;
+    char coreList [4096];
+    int np = (int)sysconf (_SC_NPROCESSORS_ONLN);
+    topoPtr->onlineCPUs = (np < 1) ? 1 : np;
+    topoPtr->allowedCPUs = topoPtr->onlineCPUs;
+    topoPtr->physicalCores = topoPtr->onlineCPUs;
+    topoPtr->perfCores = topoPtr->onlineCPUs;
+    nConf = (int)sysconf (_SC_NPROCESSORS_CONF);
+    if (nConf > setSize) setSize = nConf;
+    // affinity mask, growing the set if the kernel has more CPUs than we asked about
+    for (;;){
+        setPtr = CPU_ALLOC (setSize);
+        if (setPtr == nullptr) break;
+        CPU_ZERO_S (CPU_ALLOC_SIZE (setSize), setPtr);
+        if (sched_getaffinity (0, CPU_ALLOC_SIZE (setSize), setPtr) == 0) break;
+        CPU_FREE (setPtr);
+        setPtr = nullptr;
+        if ((errno != EINVAL) || (setSize >= (1 << 20))) break;
+        setSize *= 2;
+    }
+    if (setPtr != nullptr){
+        np = CPU_COUNT_S (CPU_ALLOC_SIZE (setSize), setPtr);
+        if (np > 0) topoPtr->allowedCPUs = np;
+        // physical cores and performance cores among the allowed CPUs
+        coreKeysPtr = (UInt64*)WMNewPtr (setSize * sizeof (UInt64));
+        capacitiesPtr = (long*)WMNewPtr (setSize * sizeof (long));
+        if ((np > 0) && (coreKeysPtr != nullptr) && (capacitiesPtr != nullptr)){
+            for (iCPU = 0; iCPU < setSize; iCPU++){
+                coreKeysPtr [iCPU] = (UInt64)iCPU;  // its own core, unless we can read its core id
+                capacitiesPtr [iCPU] = 0;
+                if (!CPU_ISSET_S (iCPU, CPU_ALLOC_SIZE (setSize), setPtr)) continue;
+                snprintf (path, sizeof (path), "%s/sys/devices/system/cpu/cpu%d/topology/core_id", rootDir, iCPU);
+                if ((CPUTopologyReadLine (path, line, sizeof (line))) && (sscanf (line, "%ld", &coreId) == 1)){
+                    snprintf (path, sizeof (path), "%s/sys/devices/system/cpu/cpu%d/topology/physical_package_id", rootDir, iCPU);
+                    packageId = 0;
+                    if (CPUTopologyReadLine (path, line, sizeof (line))) sscanf (line, "%ld", &packageId);
+                    coreKeysPtr [iCPU] = (((UInt64)(packageId & 0xFFFF)) << 48) | (((UInt64)(coreId & 0xFFFFFF)) << 24) | ((UInt64)1 << 23);
+                }
+                snprintf (path, sizeof (path), "%s/sys/devices/system/cpu/cpu%d/cpu_capacity", rootDir, iCPU);
+                if ((CPUTopologyReadLine (path, line, sizeof (line))) && (sscanf (line, "%ld", &capacitiesPtr [iCPU]) == 1)){
+                    if (capacitiesPtr [iCPU] > maxCapacity) maxCapacity = capacitiesPtr [iCPU];
+                    if ((minCapacity < 0) || (capacitiesPtr [iCPU] < minCapacity)) minCapacity = capacitiesPtr [iCPU];
+                }else{
+                    hasCapacity = 0;
+                }
+            }
+            if ((hasCapacity) && (maxCapacity == minCapacity)) hasCapacity = 0;  // all cores the same, not hybrid
+            snprintf (path, sizeof (path), "%s/sys/devices/cpu_core/cpus", rootDir);
+            hasCoreList = CPUTopologyReadLine (path, coreList, sizeof (coreList));
+            topoPtr->physicalCores = 0;
+            topoPtr->perfCores = 0;
+            for (iCPU = 0; iCPU < setSize; iCPU++){
+                if (!CPU_ISSET_S (iCPU, CPU_ALLOC_SIZE (setSize), setPtr)) continue;
+                isFirst = 1;
+                for (jCPU = 0; jCPU < iCPU; jCPU++){
+                    if ((CPU_ISSET_S (jCPU, CPU_ALLOC_SIZE (setSize), setPtr)) && (coreKeysPtr [jCPU] == coreKeysPtr [iCPU])){
+                        isFirst = 0;
+                        break;
+                    }
+                }
+                if (!isFirst) continue;
+                topoPtr->physicalCores++;
+                if (hasCapacity){
+                    if (capacitiesPtr [iCPU] == maxCapacity) topoPtr->perfCores++;
+                }else if (hasCoreList){
+                    if (CPUTopologyInList (coreList, iCPU)) topoPtr->perfCores++;
+                }else{
+                    topoPtr->perfCores++;
+                }
+            }
+            if (topoPtr->physicalCores == 0) topoPtr->physicalCores = topoPtr->allowedCPUs;
+            if (topoPtr->perfCores == 0) topoPtr->perfCores = topoPtr->physicalCores;
+        }else{
+            topoPtr->physicalCores = topoPtr->allowedCPUs;
+            topoPtr->perfCores = topoPtr->allowedCPUs;
+        }
+        if (coreKeysPtr != nullptr) WMDisposePtr ((Ptr)coreKeysPtr);
+        if (capacitiesPtr != nullptr) WMDisposePtr ((Ptr)capacitiesPtr);
+        CPU_FREE (setPtr);
+    }
+    topoPtr->quotaCPUs = CPUTopologyCgroupQuota (rootDir);
+}
+
+static void CPUTopologyReadSystem (CPUTopologyPtr topoPtr){
+    CPUTopologyReadRoot (topoPtr, "");
+}
+/* Linux: size of the L2 cache of cpu0, and the logical CPUs that share it, from its cache directories in sysfs.
+ Returns the bytes for each of those CPUs, or 0 if there is no L2 cache listed
+ Last Modified 2026/10/16 */
+static UInt32 CPUTopologyReadL2 (void){
+    char line [4096], path [128];
+    long level, size;
+    char unit;
+    UInt32 nSharing;
+    for (int iIndex = 0; iIndex < 16; iIndex++){
+        snprintf (path, sizeof (path), "/sys/devices/system/cpu/cpu0/cache/index%d/level", iIndex);
+        if (!CPUTopologyReadLine (path, line, sizeof (line))) break;
+        if ((sscanf (line, "%ld", &level) != 1) || (level != 2)) continue;
+        snprintf (path, sizeof (path), "/sys/devices/system/cpu/cpu0/cache/index%d/type", iIndex);
+        if ((CPUTopologyReadLine (path, line, sizeof (line))) && (strcmp (line, "Instruction") == 0)) continue;
+        snprintf (path, sizeof (path), "/sys/devices/system/cpu/cpu0/cache/index%d/size", iIndex);
+        unit = 0;
+        if ((!CPUTopologyReadLine (path, line, sizeof (line))) || (sscanf (line, "%ld%c", &size, &unit) < 1) || (size < 1)) continue;
+        if (unit == 'K') size *= 1024;
+        if (unit == 'M') size *= 1024 * 1024;
+        nSharing = 1;
+        snprintf (path, sizeof (path), "/sys/devices/system/cpu/cpu0/cache/index%d/shared_cpu_list", iIndex);
+        if (CPUTopologyReadLine (path, line, sizeof (line))) nSharing = CPUTopologyListCount (line);
+        if (nSharing < 1) nSharing = 1;
+        return (UInt32)(size/nSharing);
+    }
+    return 0;
+}
+#endif
+
+#if defined (__GNUC__) && !defined (__linux__)
+/* MacOS: there are no affinity masks or quotas. Cores from hw.physicalcpu, and performance cores from perflevel0,
+ which is the fastest level on Apple Silicon
+ Last Modified 2026/10/16 */
+static void CPUTopologyReadSystem (CPUTopologyPtr topoPtr){
+    int np = 1, nLevels = 0;
+    size_t length = sizeof(np);
+    sysctlbyname ("hw.ncpu", &np, &length, NULL, 0);
+    topoPtr->onlineCPUs = (np < 1) ? 1 : np;
+    length = sizeof(np);
+    if ((sysctlbyname ("hw.activecpu", &np, &length, NULL, 0) != 0) || (np < 1)) np = topoPtr->onlineCPUs;
+    topoPtr->allowedCPUs = np;
+    length = sizeof(np);
+    if ((sysctlbyname ("hw.physicalcpu", &np, &length, NULL, 0) != 0) || (np < 1)) np = topoPtr->allowedCPUs;
+    topoPtr->physicalCores = np;
+    topoPtr->perfCores = np;
+    length = sizeof(nLevels);
+    if ((sysctlbyname ("hw.nperflevels", &nLevels, &length, NULL, 0) == 0) && (nLevels > 1)){
+        length = sizeof(np);
+        if ((sysctlbyname ("hw.perflevel0.physicalcpu", &np, &length, NULL, 0) == 0) && (np > 0)) topoPtr->perfCores = np;
+    }
+    topoPtr->quotaCPUs = 0;
+}
+
+/* MacOS: L2 size of the performance cores and how many cores share it on Apple Silicon, else hw.l2cachesize. Returns
+ the bytes for each core, or 0 if the L2 size is not listed
+ Last Modified 2026/10/16 */
+static UInt32 CPUTopologyReadL2 (void){
+    SInt64 l2Bytes = 0;
+    int cpusPerL2 = 1;
+    size_t length = sizeof(l2Bytes);
+    if ((sysctlbyname ("hw.perflevel0.l2cachesize", &l2Bytes, &length, NULL, 0) == 0) && (l2Bytes > 0)){
+        length = sizeof(cpusPerL2);
+        if ((sysctlbyname ("hw.perflevel0.cpusperl2", &cpusPerL2, &length, NULL, 0) != 0) || (cpusPerL2 < 1)) cpusPerL2 = 1;
+        return (UInt32)(l2Bytes/cpusPerL2);
+    }
+    l2Bytes = 0;
+    length = sizeof(l2Bytes);
+    if ((sysctlbyname ("hw.l2cachesize", &l2Bytes, &length, NULL, 0) == 0) && (l2Bytes > 0)) return (UInt32)l2Bytes;
+    return 0;
+}
+#endif
+
+#ifdef _WINDOWS_
+/* Windows: affinity from the process affinity mask, quota from a hard cap on CPU rate for a job object, and cores from
+ GetLogicalProcessorInformationEx, where the cores with the highest EfficiencyClass are the performance cores. Only the
+ processor group of the calling thread is looked at, which is where pool threads run unless told otherwise
+ Last Modified 2026/10/16 */
+static void CPUTopologyReadSystem (CPUTopologyPtr topoPtr){
+    DWORD_PTR processMask = 0, countMask, systemMask;
+    UInt32 np;
+    DWORD infoSize = 0;
+    PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX infoPtr, infoEndPtr;
+    char* infoBufferPtr;
+    BYTE maxClass = 0;
+    USHORT group = 0;
+    GROUP_AFFINITY threadGroup;
+    JOBOBJECT_CPU_RATE_CONTROL_INFORMATION rateInfo;
+    np = (UInt32)GetActiveProcessorCount (ALL_PROCESSOR_GROUPS);
+    topoPtr->onlineCPUs = (np < 1) ? 1 : np;
+    topoPtr->allowedCPUs = topoPtr->onlineCPUs;
+    if (GetProcessAffinityMask (GetCurrentProcess (), &processMask, &systemMask) && (processMask != 0)){
+        for (np = 0, countMask = processMask; countMask != 0; countMask &= countMask - 1) np++;
+        // a mask covers a single group of up to 64 CPUs, so only believe it when it is smaller than the system
+        if (np < topoPtr->allowedCPUs) topoPtr->allowedCPUs = np;
+    }
+    if (GetThreadGroupAffinity (GetCurrentThread (), &threadGroup)) group = threadGroup.Group;
+    topoPtr->physicalCores = topoPtr->allowedCPUs;
+    topoPtr->perfCores = topoPtr->allowedCPUs;
+    GetLogicalProcessorInformationEx (RelationProcessorCore, NULL, &infoSize);
+    infoBufferPtr = (char*)WMNewPtr (infoSize);
+    if ((infoBufferPtr != nullptr) && (GetLogicalProcessorInformationEx (RelationProcessorCore, (PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX)infoBufferPtr, &infoSize))){
+        infoEndPtr = (PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX)(infoBufferPtr + infoSize);
+        // first pass finds the highest efficiency class, second pass counts cores with allowed CPUs
+        for (infoPtr = (PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX)infoBufferPtr; infoPtr < infoEndPtr; infoPtr = (PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX)((char*)infoPtr + infoPtr->Size)){
+            if (infoPtr->Processor.EfficiencyClass > maxClass) maxClass = infoPtr->Processor.EfficiencyClass;
+        }
+        topoPtr->physicalCores = 0;
+        topoPtr->perfCores = 0;
+        for (infoPtr = (PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX)infoBufferPtr; infoPtr < infoEndPtr; infoPtr = (PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX)((char*)infoPtr + infoPtr->Size)){
+            if ((infoPtr->Processor.GroupMask [0].Group != group) || ((infoPtr->Processor.GroupMask [0].Mask & processMask) == 0)) continue;
+            topoPtr->physicalCores++;
+            if (infoPtr->Processor.EfficiencyClass == maxClass) topoPtr->perfCores++;
+        }
+        if (topoPtr->physicalCores == 0) topoPtr->physicalCores = topoPtr->allowedCPUs;
+        if (topoPtr->perfCores == 0) topoPtr->perfCores = topoPtr->physicalCores;
+    }
+    if (infoBufferPtr != nullptr) WMDisposePtr ((Ptr)infoBufferPtr);
+    // CpuRate is in hundredths of a percent of the whole system
+    topoPtr->quotaCPUs = 0;
+    if ((QueryInformationJobObject (NULL, JobObjectCpuRateControlInformation, &rateInfo, sizeof (rateInfo), NULL)) &&
+        (rateInfo.ControlFlags & JOB_OBJECT_CPU_RATE_CONTROL_ENABLE) && (rateInfo.ControlFlags & JOB_OBJECT_CPU_RATE_CONTROL_HARD_CAP) &&
+        (rateInfo.CpuRate > 0)){
+        topoPtr->quotaCPUs = (UInt32)(((UInt64)rateInfo.CpuRate * topoPtr->onlineCPUs + 9999)/10000);
+    }
+}
+
+/* Windows: size of the first L2 cache from GetLogicalProcessorInformationEx, and the logical CPUs in its group mask
+ that share it. Returns the bytes for each of those CPUs, or 0 if there is no L2 cache listed
+ Last Modified 2026/10/16 */
+static UInt32 CPUTopologyReadL2 (void){
+    DWORD infoSize = 0;
+    PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX infoPtr, infoEndPtr;
+    char* infoBufferPtr;
+    KAFFINITY countMask;
+    UInt32 l2Bytes = 0, nSharing;
+    GetLogicalProcessorInformationEx (RelationCache, NULL, &infoSize);
+    infoBufferPtr = (char*)WMNewPtr (infoSize);
+    if ((infoBufferPtr != nullptr) && (GetLogicalProcessorInformationEx (RelationCache, (PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX)infoBufferPtr, &infoSize))){
+        infoEndPtr = (PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX)(infoBufferPtr + infoSize);
+        for (infoPtr = (PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX)infoBufferPtr; infoPtr < infoEndPtr; infoPtr = (PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX)((char*)infoPtr + infoPtr->Size)){
+            if ((infoPtr->Cache.Level != 2) || (infoPtr->Cache.Type == CacheInstruction)) continue;
+            for (nSharing = 0, countMask = infoPtr->Cache.GroupMask.Mask; countMask != 0; countMask &= countMask - 1) nSharing++;
+            l2Bytes = infoPtr->Cache.CacheSize/((nSharing < 1) ? 1 : nSharing);
+            break;
+        }
+    }
+    if (infoBufferPtr != nullptr) WMDisposePtr ((Ptr)infoBufferPtr);
+    return l2Bytes;
+}
+#endif
+
+/* Fills in a CPUTopology for the system we are running on, with usableCPUs from the affinity mask and any quota
+ Last Modified 2026/10/16 */
+void CPUTopologyRead (CPUTopologyPtr topoPtr){
+    CPUTopologyReadSystem (topoPtr);
+    topoPtr->usableCPUs = topoPtr->allowedCPUs;
+    if ((topoPtr->quotaCPUs > 0) && (topoPtr->quotaCPUs < topoPtr->usableCPUs)) topoPtr->usableCPUs = topoPtr->quotaCPUs;
+}
+
+/* Returns the number of threads to use for a cap from SetNumProcessorsCap: CPU_CAP_NONE for all the usable logical
+ CPUs, a positive number for at most that many, CPU_CAP_PHYSICAL for one per physical core, or CPU_CAP_PERFORMANCE
+ for one per performance core. The result is always between 1 and the number of usable CPUs
+ Last Modified 2026/10/16 */
+UInt32 CPUTopologyNumThreads (int cap){
+    CPUTopology topo;
+    CPUTopologyRead (&topo);
+    return CPUTopologyThreadsForCap (&topo, cap, 0);
+}
+
+/* Returns the number of threads for a cap, as for CPUTopologyNumThreads, from a CPUTopology that has been read already.
+ If maxThreads is not 0, as for the threads in the pool, the result is not more than maxThreads
+ Last Modified 2026/10/16 */
+UInt32 CPUTopologyThreadsForCap (CPUTopologyPtr topoPtr, int cap, UInt32 maxThreads){
+    UInt32 nThreads;
+    switch (cap){
+        case CPU_CAP_NONE:
+            nThreads = topoPtr->usableCPUs;
+            break;
+        case CPU_CAP_PHYSICAL:
+            nThreads = topoPtr->physicalCores;
+            break;
+        case CPU_CAP_PERFORMANCE:
+            nThreads = topoPtr->perfCores;
+            break;
+        default:
+            nThreads = (cap > 0) ? (UInt32)cap : topoPtr->usableCPUs;
+            break;
+    }
+    if (nThreads > topoPtr->usableCPUs) nThreads = topoPtr->usableCPUs;
+    if ((maxThreads > 0) && (nThreads > maxThreads)) nThreads = maxThreads;
+    if (nThreads < 1) nThreads = 1;
+    return nThreads;
+}
+
+/* Returns the bytes of L2 cache for each logical CPU, the size of the L2 cache of the first CPU divided by the number of
+ logical CPUs that share it, or CPU_L2_BYTES_DEFAULT if that can not be found
+ Last Modified 2026/10/16 */
+UInt32 CPUTopologyL2Bytes (void){
+    UInt32 l2Bytes = CPUTopologyReadL2 ();
+    return (l2Bytes > 0) ? l2Bytes : CPU_L2_BYTES_DEFAULT;
+}
+
+/* Returns the best SIMD instruction set the kernels have loops for that this CPU and operating system support, as
+ CPU_SIMD_NONE, CPU_SIMD_SSE41 or CPU_SIMD_AVX2. Always CPU_SIMD_NONE on processors that are not x86
+ Last Modified 2026/10/16 */
+UInt8 CPUTopologySIMDLevel (void){
+    UInt8 level = CPU_SIMD_NONE;
+#if defined (__GNUC__) && (defined (__x86_64__) || defined (__i386__))
+    __builtin_cpu_init ();
+    if (__builtin_cpu_supports ("sse4.1")) level = CPU_SIMD_SSE41;
+    if ((level == CPU_SIMD_SSE41) && (__builtin_cpu_supports ("avx2"))) level = CPU_SIMD_AVX2;
+#elif defined (_MSC_VER) && (defined (_M_X64) || defined (_M_IX86))
+    int info [4];
+    __cpuid (info, 0);
+    int maxLeaf = info [0];
+    __cpuid (info, 1);
+    if (info [2] & (1 << 19)) level = CPU_SIMD_SSE41;
+    // AVX2 also needs the OS to save the YMM registers, as shown by OSXSAVE and XCR0
+    if ((level == CPU_SIMD_SSE41) && (maxLeaf >= 7) && (info [2] & (1 << 27)) && (info [2] & (1 << 28)) && ((_xgetbv (0) & 6) == 6)){
+        __cpuidex (info, 7, 0);
+        if (info [1] & (1 << 5)) level = CPU_SIMD_AVX2;
+    }
+#endif
+    return level;
+}
+
+// SIMD loops used by the kernels, the best there are for this CPU unless set lower
+UInt8 gSIMDLevel = CPUTopologySIMDLevel ();
@@ -0,0 +1,48 @@
+/*
+    CPUTopology.h -- finds how many CPUs the twoPhoton XOP may really use, for sizing the thread pool and thread fan-out
+*/
+#ifndef CPUTOPOLOGY_H_
+#define CPUTOPOLOGY_H_
+
+/* Special values for the cap passed to CPUTopologyNumThreads, and to the SetNumProcessorsCap XFUNC */
+#define CPU_CAP_NONE            0   // use all the usable logical CPUs
+#define CPU_CAP_PHYSICAL        -1  // use one thread per usable physical core
+#define CPU_CAP_PERFORMANCE     -2  // use one thread per usable performance core on hybrid CPUs, else per physical core
+
+/* What we know about the CPUs this process can run on. Counts of cores only include cores with at least one logical
+ CPU in the affinity mask of the process. When something can not be found out on a system, it is set from the count
+ above it, so physicalCores is the same as allowedCPUs if we can not see which logical CPUs share a core */
+typedef struct CPUTopology{
+    UInt32 onlineCPUs;      // logical CPUs online in the system
+    UInt32 allowedCPUs;     // logical CPUs in the affinity mask of this process
+    UInt32 quotaCPUs;       // CPUs worth of run time allowed by a cgroup (container) or job object quota, rounded up, or 0 if none
+    UInt32 usableCPUs;      // allowedCPUs, limited by quotaCPUs
+    UInt32 physicalCores;   // physical cores among the allowed CPUs
+    UInt32 perfCores;       // performance cores among the allowed CPUs on hybrid (P/E core) CPUs, else physicalCores
+} CPUTopology, *CPUTopologyPtr;
+
+void CPUTopologyRead (CPUTopologyPtr topoPtr);
+UInt32 CPUTopologyNumThreads (int cap);
+UInt32 CPUTopologyThreadsForCap (CPUTopologyPtr topoPtr, int cap, UInt32 maxThreads);
+#ifdef __linux__
+/* The Linux parsing, exposed so kernelTests can check it against a made-up sysfs and cgroup tree under rootDir */
+void CPUTopologyReadRoot (CPUTopologyPtr topoPtr, const char* rootDir);
+int CPUTopologyInList (const char* list, int cpu);
+UInt32 CPUTopologyListCount (const char* list);
+#endif
+
+/* L2 cache for each logical CPU, for kernels that work in blocks sized to stay in L2. The default is used when the
+ size of the L2 cache can not be found */
+#define CPU_L2_BYTES_DEFAULT    262144
+UInt32 CPUTopologyL2Bytes (void);
+
+/* SIMD instruction sets the kernels have hand-written loops for, from CPUTopologySIMDLevel. gSIMDLevel picks the loops
+ used, and is set to the best the CPU has when the XOP is loaded. It may be set lower, as by kernelTests and kernelBench
+ to check and time the SIMD loops against the scalar ones */
+#define CPU_SIMD_NONE           0   // scalar loops only
+#define CPU_SIMD_SSE41          1   // SSE4.1
+#define CPU_SIMD_AVX2           2   // AVX2, with AVX enabled by the operating system
+UInt8 CPUTopologySIMDLevel (void);
+extern UInt8 gSIMDLevel;
+
+#endif
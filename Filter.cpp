@@ -1,324 +1,30 @@
 #include "twoPhoton.h"
 /* ----------------------------------------Filter ------------------------------------------------------------------
- Code for filtering waves with 2D convolution kernels - arbitrary, symetrical, or median
- Last Modified 2025/06/23 by Jamie Boyd
+ Code for filtering waves with 2D convolution kernels - arbitrary, symetrical, or median. The templates and tile
+ functions are in FilterKernels.cpp
+ Last Modified 2026/10/16
 --------------------------------------------------------------------------------------------------------------------*/
 
 
+/* Finishes the Async version of a filter XFUNC after AsyncJobStart, which has put the job ID in resultPtr, or returned
+ an error. Frees the output path string and returns the result, as the XFUNCs do
+ Last Modified 2026/10/16 */
+static int ConvolveFramesAsyncResult (Handle outPutPath, int result, double* resultPtr, XFuncTimerPtr timerPtr){
+    WMDisposeHandle (outPutPath);    // free input string for output path
+    XFuncTimerEnd (timerPtr);
+    if (result == 0) return (0);
+    *resultPtr = (double)(result - FIRST_XOP_ERR);
+#ifdef NO_IGOR_ERR
+    return (0);
+#else
+    return (result);
+#endif
+}
+
 /* ------------------------------------ convolution with a 2D kernel ------------------------------------------
  convolves each frame in input wave with an arbitrary sized 2D kernel
  --------------------------------------------------------------------------------------------------------------*/
 
-/* Makes a table of weights for a 2D kernel
- Last Modified 2014/01/20 by Jamie Boyd */
-float* ConvolveMakeKernelTable (float * kernel, int kWidth, int kHeight){
-    int kRadH = (kHeight -1)/2;
-    int kRadW = (kWidth-1)/2;
-    int kSize = kWidth * kHeight;
-    // allocate memory for kernel table
-    float * kernelTablePtr =(float*) WMNewPtr (kSize * sizeof (float));
-    if (kernelTablePtr == NULL) return NULL;
-    int iConvo, convoEnd, convoToNextRow;
-    int kx, ky;
-    // get value for first point in kernel table
-    int iKT =0;
-     kernelTablePtr [iKT] = 0;
-    convoToNextRow=kRadW;
-    //yLoop
-    for (iConvo = kSize -1; iConvo >= (kSize/2); iConvo -= convoToNextRow){
-        // xLoop
-        for (convoEnd = iConvo - kRadW ; iConvo >= convoEnd; iConvo -=1){
-            kernelTablePtr [iKT]  += kernel [iConvo];
-        }
-    }
-    // get values for first column in kernelTable- adding a row to kernel each time
-    for (iKT =kWidth; iKT <  (kSize/2) + 1;  iKT +=kWidth, iConvo -= convoToNextRow){
-        kernelTablePtr [iKT] = kernelTablePtr [iKT -kWidth];
-        // convo X
-        for (convoEnd = iConvo - kRadW ; iConvo >= convoEnd; iConvo -=1){
-            kernelTablePtr [iKT] += kernel [iConvo];
-        }
-    }
-    // left edge bottom - removing a row from kernel each time
-    for (iConvo = kSize -1; iKT < kSize; iKT += kWidth, iConvo -= convoToNextRow){
-        kernelTablePtr [iKT] = kernelTablePtr [iKT -kWidth];
-        // convo X
-        for (convoEnd = iConvo - kRadW ; iConvo >= convoEnd; iConvo -=1){
-            kernelTablePtr [iKT] -= kernel [iConvo];
-        }
-    }
-    // Now do each row based on column 0 of that row
-    // top
-    for (ky =0, iKT =1; ky <= kRadH; ky +=1, iKT +=1){
-        // top left - adding a new column at left each time
-        for (kx =1; kx <= kRadW; kx +=1, iKT +=1){
-            kernelTablePtr [iKT] = kernelTablePtr [iKT - 1];
-            for (iConvo = (kRadH - ky)* kWidth + kRadW -kx; iConvo < kSize; iConvo += kWidth){
-                kernelTablePtr [iKT] += kernel [iConvo];
-            }
-        }
-        // top right - removing a column at right eadh time
-        for (kx-=1; kx > 0; kx -=1, iKT +=1){
-            kernelTablePtr [iKT] = kernelTablePtr [iKT - 1];
-            for (iConvo =(kRadH - ky)* kWidth + kRadW + kx ; iConvo < kSize; iConvo += kWidth){
-                kernelTablePtr [iKT] -= kernel [iConvo];
-            }
-        }
-    }
-    // bottom
-    for (ky -=1; ky > 0; ky -=1, iKT +=1){
-        // bottom left - adding a new column at left each time
-        for (kx =1; kx <= kRadW; kx +=1, iKT +=1){
-            kernelTablePtr [iKT] = kernelTablePtr [iKT - 1];
-            for (iConvo = kRadW -kx, convoEnd = (kRadH + ky) * kWidth ; iConvo < convoEnd; iConvo += kWidth){
-                kernelTablePtr [iKT] += kernel [iConvo];
-            }
-        }
-        // bottom right - removing a  column at right each time
-        for (kx -=1; kx > 0; kx -=1, iKT +=1){
-            kernelTablePtr [iKT] = kernelTablePtr [iKT - 1];
-            for (iConvo = kRadW + kx, convoEnd = (kRadH + ky) * kWidth; iConvo < convoEnd; iConvo += kWidth){
-                kernelTablePtr [iKT] -= kernel [iConvo];
-            }
-        }
-    }
-    return kernelTablePtr;
-}
-
-/* Function template to convolve a single row in an image.  Doesn't need to explicitly know image Y size/position within Y or
- Kernel Y size. Just needs to know start-Y and end-Y position in the kernel. So the same function can be called for any Y
- position in an image. Note that destWave is passed by reference
- Last modified 2014/01/24 by Jamie Boyd */
-template <typename TI, typename TO> void ConvolveX (TI *srcWave, TO *&destWave, float *kernel, float *kernelTable, UInt16 nKernelX, UInt16 radKernelX, CountInt nWaveX, UInt16 endKernelY, UInt16 &startKernel, CountInt &startConvo, UInt16 &ikernelTable, UInt16 &toNextKernelX, CountInt &nConvoX, CountInt &toNextConvoX){
-    
-    CountInt iWaveX;
-    CountInt iConvo;
-    double outVal;
-    UInt16 iKernel;
-    UInt16 endKernelX;
-    
-    // X Loop for LEFT
-    for (iWaveX= 0; iWaveX < radKernelX; iWaveX+=1){
-        // Y Loop for Covolution
-        outVal = 0;
-        endKernelX = startKernel + nConvoX;
-        for (iKernel = startKernel, iConvo = startConvo; iKernel < endKernelY; iKernel += toNextKernelX, iConvo += toNextConvoX){
-            // X Loop for Convolution
-            for (; iKernel <  endKernelX; iKernel += 1, iConvo += 1)
-                outVal += srcWave [iConvo] * kernel [iKernel];
-            endKernelX += nKernelX;
-        } // end of Y loop for Convolution
-        // set output value
-        *destWave = outVal/kernelTable[ikernelTable];
-        // get ready for next pixel in this row of TOP LEFT
-        startKernel -= 1; // start convo 1  point earlier than for last pixel
-        nConvoX +=1; // one more convo point per row than for last pixel
-        toNextKernelX -=1;
-        toNextConvoX -=1;
-        ikernelTable += 1; // move tp next position in convo table
-        destWave +=1;
-    } // end of X loop for LEFT
-    // X Loop for CENTRE
-    for (; iWaveX < (nWaveX - radKernelX); iWaveX +=1){
-        outVal = 0;
-        endKernelX = startKernel + nConvoX;
-        for (iKernel = startKernel, iConvo = startConvo; iKernel < endKernelY; iKernel += toNextKernelX, iConvo += toNextConvoX){
-            // X Loop for Convolution
-            for (; iKernel < endKernelX; iKernel += 1, iConvo += 1)
-                outVal += srcWave [iConvo] * kernel [iKernel];
-            endKernelX += nKernelX;
-        } // end of Y loop for Convolution
-        // set output value
-        *destWave = outVal/kernelTable[ikernelTable];
-        // get ready for next pixel in this row
-        destWave +=1;
-        startConvo += 1;
-    }	// end of X loop for CENTRE
-    // X Loop for RIGHT
-    ikernelTable += 1; // move to next position in kernel table
-    for (; iWaveX < nWaveX; iWaveX +=1){
-        // get ready for next pixel in this row of TOP RIGHT
-        nConvoX -=1; // one less convo point per row than for last pixel
-        toNextKernelX +=1;
-        toNextConvoX +=1;
-        endKernelX = startKernel + nConvoX;
-        outVal = 0;
-        // Y loop for convolution
-        for (iKernel = startKernel, iConvo = startConvo; iKernel < endKernelY; iKernel += toNextKernelX, iConvo += toNextConvoX){
-            // X Loop for Convolution
-            for (; iKernel < endKernelX; iKernel += 1, iConvo += 1)
-                outVal += srcWave[iConvo] * kernel [iKernel];
-            endKernelX += nKernelX;
-        } // end of Y loop for Convo
-        // set output value
-        *destWave = outVal/kernelTable[ikernelTable];
-        destWave += 1;
-        startConvo += 1;
-        ikernelTable += 1; // move to next position in kernel table
-    } // End of X Loop for RIGHT
-}
-
-
-/* function template for convolving one wave with another and putting results in an output wave.
- Input wave can be 2 or 3D, but each plane is done as a separate 2D image.
- Last Modified 2014/01/24 by Jamie Boyd */
-template <typename TI, typename TO> void ConvolveT (TI* srcWave, TO* destWave, TO* frameBuffer, CountInt nWaveX, CountInt nWaveY, CountInt nWaveZ, float* kernel, float * kernelTable, UInt16 nKernelX, UInt16 nKernelY){
-    UInt16 radKernelX = (nKernelX - 1)/2; //radius of the kernel width, not including the central pixel
-    UInt16 radKernelY = (nKernelY - 1)/2; //radius of the kernel height, not including the central pixel
-    UInt16 nKernel = nKernelX * nKernelY;
-    CountInt fSize = (nWaveX * nWaveY);  //frame size
-    // iterating through kernel and kernel table
-    UInt16 ikernelTable; // position in kernelTable
-    UInt16 startKernel; // position of kernel at start of convolution of first pixel of the row
-    CountInt startFrameKernel = (radKernelY * nKernelX) + radKernelX;
-    UInt16 endKernelY; // end point in kernel (determined by starting position and number of rows
-    // Convolution variables
-    CountInt startConvo; // position in the src wave for the convolution for first pixel in the row to convolve)
-    CountInt toNextConvoX = nWaveX - radKernelX -1; // amount to add to iConvo to get to next row for convolution
-	UInt16 toNextKernelX= radKernelX; // amount to add to iKernel to get to next row of kernel
-	CountInt nConvoX = radKernelX + 1; // number of X to convolve at start of each line
-    // Pointers to Push
-    TI *srcFramePtr=srcWave; // will point to start of each frame in input image
-    TO *destPixPtr; // will point to each pixel in turn in output image
-    TI *srcEndPtr = srcWave + fSize * nWaveZ; // end of data to process
-    UInt8 inPlace = 0;
-    if ((TI*)destWave == (TI*)srcWave){
-		inPlace = 1;
-        destPixPtr = frameBuffer;
-    }else{
-        destPixPtr = destWave;
-    }
-	// Loop through all frames
-    CountInt iWaveY;
-    for (;srcFramePtr < srcEndPtr; srcFramePtr += fSize){
-        // Y Loop for TOP (first radKernelY rows)
-        ikernelTable = 0; // at start of frame, kernel table pos = 0
-        startKernel=startFrameKernel;
-        endKernelY=nKernel;
-        for (iWaveY= 0;  iWaveY < radKernelY; iWaveY+=1){
-            startConvo =0;
-            ConvolveX (srcFramePtr, destPixPtr, kernel, kernelTable, nKernelX, radKernelX, nWaveX, endKernelY, startKernel, startConvo, ikernelTable, toNextKernelX, nConvoX, toNextConvoX);
-            startKernel -= nKernelX -radKernelX;
-        }
-        // Y Loop for MIDDLE (up to nWaveY - radKernelY rows)
-        startConvo =0;
-        for (; iWaveY < (nWaveY - radKernelY); iWaveY +=1){
-            startKernel = radKernelX;
-            ConvolveX (srcFramePtr, destPixPtr, kernel, kernelTable, nKernelX, radKernelX, nWaveX, endKernelY, startKernel, startConvo, ikernelTable, toNextKernelX, nConvoX, toNextConvoX);
-            ikernelTable -= nKernelX;
-            startConvo += radKernelX;
-        }
-        // Loop for Y BOTTOM
-        ikernelTable += nKernelX;
-        for (;iWaveY < nWaveY;iWaveY +=1){
-            startKernel = radKernelX;
-            endKernelY -= nKernelX;
-            ConvolveX (srcFramePtr, destPixPtr, kernel, kernelTable, nKernelX, radKernelX, nWaveX, endKernelY, startKernel, startConvo, ikernelTable, toNextKernelX, nConvoX, toNextConvoX);
-            startConvo += radKernelX;
-        }
-        // if convolving in place copy buffer back on top of src wave  at end of frame
-        if (inPlace){
-            memcpy ((void*)srcFramePtr, (void*)frameBuffer, fSize * sizeof (TO));
-            destPixPtr = frameBuffer; // reset destination pixel to start of buffer
-        }
-    }
-}
-
-
-/* Structure to pass data to each ConvolveFrames thread or ConvolveSymFrames thread
- Last Modified 2025/06/23 by Jamie Boyd */
-typedef struct ConvolveFramesThreadParams{
-    int inPutWaveType;          // WaveMetrics code for waveType
-    char* inPutDataPtr;         // pointer to start of input wave
-    char* outPutDataPtr;        // pointer to start of output wave
-    char* frameBufferPtr;       // pointer to frame sized buffer for symConvolveFrames, or when overwriting with ConvolveFrames
-    CountInt xSize;            // number of columns in each frame
-    CountInt ySize;            // number of rows in each frame
-    CountInt zSize;            // number of frames
-    UInt8 ti;                // number of this thread, starting from 0
-    UInt8 tN;                // total number of threads
-    float * kernelDataPtr;    // pointer to start of kernel
-    float * kernelTablePtr; // pointer to start of kernel table
-    UInt16 kWidth;            // number of columns in kernel
-    UInt16 kHeight;            // number of rows in kernel (ignored by convolveSymFrames)
-    UInt8 isFloat;            // waveType of outPut wave. 0 for same type as input wave, 1 for floating point wave
-} ConvolveFramesThreadParams, *ConvolveFramesThreadParamsPtr;
-
-
-/* Each thread to colvolve a range of frames starts with this function
- Last Modified 2014/01/20 by Jamie Boyd */
-void* ConvolveFramesThread (void* threadarg){
-	struct ConvolveFramesThreadParams* p;
-	p = (struct ConvolveFramesThreadParams*) threadarg;
-	CountInt tFrames = p->zSize/p->tN; //frames per thread = number of frames / number of threads, truncated to an integer
-	CountInt startPos = p->ti * tFrames; // which frame to start this thread on depends on thread number * frames per thread. ti is 0 based
-	if (p->ti == p->tN - 1) tFrames +=  (p->zSize % p->tN); // the last thread gets any left-over frames
-    CountInt frameSize =p->xSize * p->ySize;
-    startPos *= frameSize; //change start position from frames to data points by multiplying by frame size
-    CountInt bufferOffset;
-    if ((char*) p->inPutDataPtr == (char*) p->outPutDataPtr){
-        bufferOffset = p->ti * frameSize;
-    }else{
-        bufferOffset = 0;
-    }
-	if (p->isFloat){
-		switch (p->inPutWaveType) {
-            case NT_I8:
-                ConvolveT ((char*)p->inPutDataPtr + startPos, (float*)p->outPutDataPtr + startPos, (float*)p->frameBufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kernelDataPtr, p->kernelTablePtr, p->kWidth, p->kHeight);
-                break;
-            case (NT_I8 | NT_UNSIGNED):
-                ConvolveT ((unsigned char*)p->inPutDataPtr + startPos, (float*)p->outPutDataPtr + startPos, (float*)p->frameBufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kernelDataPtr, p->kernelTablePtr, p->kWidth, p->kHeight);
-                break;
-            case NT_I16:
-                ConvolveT ((short*)p->inPutDataPtr + startPos, (float*)p->outPutDataPtr + startPos, (float*)p->frameBufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kernelDataPtr, p->kernelTablePtr, p->kWidth, p->kHeight);
-                break;
-            case (NT_I16 | NT_UNSIGNED):
-                ConvolveT ((unsigned short*)p->inPutDataPtr + startPos,(float*)p->outPutDataPtr + startPos, (float*)p->frameBufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kernelDataPtr, p->kernelTablePtr, p->kWidth, p->kHeight);
-                break;
-            case NT_I32:
-                ConvolveT ((long*)p->inPutDataPtr + startPos,(float*)p->outPutDataPtr + startPos, (float*)p->frameBufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kernelDataPtr, p->kernelTablePtr, p->kWidth, p->kHeight);
-                break;
-            case (NT_I32| NT_UNSIGNED):
-                ConvolveT ((unsigned long*)p->inPutDataPtr + startPos,(float*)p->outPutDataPtr + startPos, (float*)p->frameBufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kernelDataPtr, p->kernelTablePtr, p->kWidth, p->kHeight);
-                break;
-            case NT_FP32:
-                ConvolveT ((float*)p->inPutDataPtr + startPos,(float*)p->outPutDataPtr + startPos, (float*)p->frameBufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kernelDataPtr, p->kernelTablePtr, p->kWidth, p->kHeight);
-                break;
-            case NT_FP64:
-                ConvolveT ((double*)p->inPutDataPtr + startPos,(float*)p->outPutDataPtr + startPos, (float*)p->frameBufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kernelDataPtr, p->kernelTablePtr, p->kWidth, p->kHeight);
-                break;
-		}
-	}else {
-        switch (p->inPutWaveType) {
-            case NT_I8:
-                ConvolveT ((char*)p->inPutDataPtr + startPos,(char*)p->outPutDataPtr + startPos, (char*)p->frameBufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kernelDataPtr, p->kernelTablePtr,p-> kWidth, p->kHeight);
-                break;
-            case (NT_I8 | NT_UNSIGNED):
-                ConvolveT ((unsigned char*)p->inPutDataPtr + startPos,(unsigned char*)p->outPutDataPtr + startPos, (unsigned char*)p->frameBufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kernelDataPtr, p->kernelTablePtr, p->kWidth, p->kHeight);
-                break;
-            case NT_I16:
-                ConvolveT ((short*)p->inPutDataPtr + startPos,(short*)p->outPutDataPtr + startPos, (short*)p->frameBufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kernelDataPtr, p->kernelTablePtr, p->kWidth, p->kHeight);
-                break;
-            case (NT_I16 | NT_UNSIGNED):
-                ConvolveT ((unsigned short*)p->inPutDataPtr + startPos,(unsigned short*)p->outPutDataPtr + startPos, (unsigned short*)p->frameBufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kernelDataPtr, p->kernelTablePtr, p->kWidth, p->kHeight);
-                break;
-            case NT_I32:
-                ConvolveT ((long*)p->inPutDataPtr + startPos,(long*)p->outPutDataPtr + startPos, (long*)p->frameBufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kernelDataPtr, p->kernelTablePtr, p->kWidth, p->kHeight);
-                break;
-            case (NT_I32| NT_UNSIGNED):
-                ConvolveT ((unsigned long*)p->inPutDataPtr + startPos,(unsigned long*)p->outPutDataPtr + startPos, (unsigned long*)p->frameBufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kernelDataPtr, p->kernelTablePtr, p->kWidth, p->kHeight);
-                break;
-            case NT_FP32:
-                ConvolveT ((float*)p->inPutDataPtr + startPos,(float*)p->outPutDataPtr + startPos, (float*)p->frameBufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kernelDataPtr, p->kernelTablePtr, p->kWidth, p->kHeight);
-                break;
-            case NT_FP64:
-                ConvolveT ((double*)p->inPutDataPtr + startPos,(double*)p->outPutDataPtr + startPos, (double*)p->frameBufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kernelDataPtr, p->kernelTablePtr, p->kWidth, p->kHeight);
-                break;
-		}
-	}
-	return nullptr;
-}
-
 /* ConvolveFrames XOP entry function
  Convolves a 2D or 3D wave with a smaller 2D wave (the kernel), and sends the output to an output wave.
  Treats each plane in a 3D wave as a separate image
@@ -332,7 +38,7 @@ void* ConvolveFramesThread (void* threadarg){
  Handle outPutPath;	// A handle to a string containing path to output wave we want to make, or empty string to overwrite existing wave
  waveHndl inPutWaveH;//input wave. needs to be 3D wave
  double result; */
-extern "C" int ConvolveFrames(ConvolveFramesParamsPtr p){
+static int ConvolveFramesDo (ConvolveFramesParamsPtr p, UInt8 isAsync){
 	int result = 0;	// The error returned from various Wavemetrics functions
 	waveHndl inPutWaveH, outPutWaveH, kernelH;		// handles to the input and output waves and the kernel
 	int inPutWaveType, kernelWaveType; //  Wavetypes numeric codes for things like 32 bit floating point, 16 bit int, etc
@@ -347,14 +53,15 @@ extern "C" int ConvolveFrames(ConvolveFramesParamsPtr p){
 	UInt8 overWrite = (UInt8)(p->overWrite);	// 0 to not overwrite output wave if it already exists, 1 to overwrite old waves
 	UInt8 isFloat = (UInt8)(p-> outPutType); // 0 to use input type for output, non-zero to use make bit floating point output
 	UInt8 isOverWriting; // non-zero if output is overwriting input wave
-    float *kernelTablePtr; // kernel table (calculated weighting for truncation of convolution at edges)
+    float *kernelTablePtr = nullptr; // kernel table (calculated weighting for truncation of convolution at edges)
 	UInt16 kSize;
 	char *inPutDataStartPtr, *outPutDataStartPtr, *kernelDataStartPtr;
     // for threads
-    UInt8 iThread, nThreads;
-    ConvolveFramesThreadParamsPtr paramArrayPtr;
-    pthread_t* threadsPtr;
+    UInt32 nThreads;
+    ConvolveFramesThreadParams params;  // paramaters for the tiles
     char* bufferPtr = nullptr;  // pointer to temp buffer for threads
+	XFuncTimer timer;  // times each phase of this call, for TwoPhotonStats
+	XFuncTimerStart (&timer, isAsync ? STATS_CONVOLVEFRAMESASYNC : STATS_CONVOLVEFRAMES);
 	try{
 		// Get handles to input wave and kernel. Make sure both waves exist.
 		inPutWaveH = p->inPutWaveH;
@@ -410,11 +117,13 @@ extern "C" int ConvolveFrames(ConvolveFramesParamsPtr p){
 				// make the output wave
 				//No liberal wave names for output wave
 				CleanupName (0, outPutWaveName, MAX_OBJ_NAME);
+				XFuncTimerPhase (&timer, STATS_MAKEWAVE);
 				if (isFloat){
 					if (MDMakeWave (&outPutWaveH, outPutWaveName, outPutDFHandle, inPutDimensionSizes, NT_FP32, overWrite)) throw result = WAVEERROR_NOS;
 				}else{
 					if (MDMakeWave (&outPutWaveH, outPutWaveName, outPutDFHandle, inPutDimensionSizes, inPutWaveType, overWrite)) throw result = WAVEERROR_NOS;
 				}
+				XFuncTimerPhase (&timer, STATS_THREADS);
 			}
 		}
         //Get data offsets for the 3 waves (2 waves, if overwriting)
@@ -433,13 +142,8 @@ extern "C" int ConvolveFrames(ConvolveFramesParamsPtr p){
 		kernelTablePtr = ConvolveMakeKernelTable ((float*)kernelDataStartPtr, (int)kernelDimensionSizes[0], (int) kernelDimensionSizes[1]);
 		if (kernelTablePtr == NULL) throw result = NOMEM;
         // multiprocessor init
-        nThreads = gNumProcessors;
+        nThreads = (isAsync) ? ThreadPoolBackgroundSlots () : gNumProcessors;
         if (zSize < nThreads) nThreads = zSize;
-        paramArrayPtr = (ConvolveFramesThreadParamsPtr)WMNewPtr (nThreads * sizeof(ConvolveFramesThreadParams));
-        // make an array of pthread_t
-        if (paramArrayPtr == nullptr) throw result = NOMEM;
-        threadsPtr = (pthread_t*)WMNewPtr(nThreads * sizeof(pthread_t));
-        if (threadsPtr == nullptr) throw result = NOMEM;
         if (isOverWriting){ // input = output wave, so need to  make a frame sized buffer
             switch (inPutWaveType) {
                 case NT_I64 | NT_UNSIGNED:
@@ -467,9 +171,8 @@ extern "C" int ConvolveFrames(ConvolveFramesParamsPtr p){
             if (bufferPtr == NULL) throw result = NOMEM;
         }
     }catch (int (result)) { // catch before starting threads
+        XFuncTimerEnd (&timer);
         if (bufferPtr != nullptr)  WMDisposePtr ((Ptr)bufferPtr);
-        if (threadsPtr != nullptr) WMDisposePtr ((Ptr)threadsPtr);
-        if (paramArrayPtr != nullptr) WMDisposePtr ((Ptr)paramArrayPtr);
         if (kernelTablePtr !=nullptr) WMDisposePtr ((Ptr)kernelTablePtr);
         WMDisposeHandle (p->outPutPath);    // free input string for output path
         p -> result = (double)(result - FIRST_XOP_ERR);
@@ -479,253 +182,58 @@ extern "C" int ConvolveFrames(ConvolveFramesParamsPtr p){
             return (result);
         #endif
     }
-    // fill array of parameter structures
-    for (iThread = 0; iThread < nThreads; iThread++){
-        paramArrayPtr[iThread].inPutWaveType = inPutWaveType;
-        paramArrayPtr[iThread].inPutDataPtr = inPutDataStartPtr;
-        paramArrayPtr[iThread].outPutDataPtr = outPutDataStartPtr;
-        paramArrayPtr[iThread].frameBufferPtr = bufferPtr;
-        paramArrayPtr[iThread].xSize = inPutDimensionSizes [0];
-        paramArrayPtr[iThread].ySize = inPutDimensionSizes [1];
-        paramArrayPtr[iThread].zSize = zSize;
-        paramArrayPtr[iThread].ti=iThread; // number of this thread, starting from 0
-        paramArrayPtr[iThread].tN =nThreads; // total number of threads
-        paramArrayPtr[iThread].kernelDataPtr=(float*)kernelDataStartPtr;
-        paramArrayPtr[iThread].kernelTablePtr=kernelTablePtr;
-        paramArrayPtr[iThread].kWidth = kernelDimensionSizes [0];
-        paramArrayPtr[iThread].kHeight= kernelDimensionSizes [1];
-        paramArrayPtr[iThread].isFloat = isFloat; // 0 for same type as input wave, non-zero for floating point wave
-    }
-    // create the threads
-    for (iThread = 0; iThread < nThreads; iThread++){
-        pthread_create (&threadsPtr[iThread], NULL, ConvolveFramesThread, (void *) &paramArrayPtr[iThread]);
-    }
-    // Wait till all the threads are finished
-    for (iThread = 0; iThread < nThreads; iThread++){
-        pthread_join (threadsPtr[iThread], NULL);
+    XFuncTimerPhase (&timer, STATS_THREADS);
+    // fill paramater structure
+    params.inPutWaveType = inPutWaveType;
+    params.inPutDataPtr = inPutDataStartPtr;
+    params.outPutDataPtr = outPutDataStartPtr;
+    params.frameBufferPtr = bufferPtr;
+    params.xSize = inPutDimensionSizes [0];
+    params.ySize = inPutDimensionSizes [1];
+    params.zSize = zSize;
+    params.kernelDataPtr=(float*)kernelDataStartPtr;
+    params.kernelTablePtr=kernelTablePtr;
+    params.kWidth = kernelDimensionSizes [0];
+    params.kHeight= kernelDimensionSizes [1];
+    params.isFloat = isFloat; // 0 for same type as input wave, non-zero for floating point wave
+    if (isAsync){ // start a job on its own thread, which owns the buffers from now on, and return its ID
+        XFuncTimerPhase (&timer, STATS_COMPUTE);
+        result = AsyncJobStart (ConvolveFramesTile, &params, sizeof (params), zSize, nThreads, outPutWaveH, inPutWaveH, kernelH, (Ptr)bufferPtr, (Ptr)kernelTablePtr, &p->result);
+        return ConvolveFramesAsyncResult (p->outPutPath, result, &p->result, &timer);
     }
+    // run the tiles on the thread pool, one frame per tile, and wait till they are all finished
+    XFuncTimerPhase (&timer, STATS_COMPUTE);
+    ThreadPoolRunTiles (ConvolveFramesTile, &params, zSize, 1, nThreads);
+    XFuncTimerPhase (&timer, STATS_FINISH);
     // free frameBuffer, if made
     if (isOverWriting) WMDisposePtr ((Ptr)bufferPtr);
-    // free memory for pThreads Array
-    WMDisposePtr ((Ptr)threadsPtr);
-    // Free paramaterArray memory
-    WMDisposePtr ((Ptr)paramArrayPtr);
     //free kernel table memory
     WMDisposePtr ((Ptr)kernelTablePtr);
     WMDisposeHandle (p->outPutPath);
     // Inform Igor that we have changed the output wave.
     WaveHandleModified(outPutWaveH);
     p -> result = (0);
+    XFuncTimerEnd (&timer);
     return (0);
 }
 
-/* -------------------------------- convolution with a symetrical 2D kernel ------------------------------------------
- A symetrical 2D kernel applied as the same 1D kernel done first in X and then in Y. Each frame is done as 2D plane
- ------------------------------------------------------------------------------------------------------------------- */
- 
-/* Makes and returns a table of weights for a 1D kernel, first Checking that the kernel is, indeed, symetrical
- returns a null pointer if kernel is not symetrical
- Last Modified 2014/01/21 by Jamie Boyd */
-float * SymConvolveMakeKernelTable (float * kernel, UInt16 kWidth){
-    // kernel has to be odd
-    if((kWidth % 2) == 0) return NIL;
-    // check symetry
-    // Get sum of entire kernel for making kernel table while we are at it
-    UInt16 kRadW = (kWidth-1)/2; // radius of kernel, not counting central point
-    UInt16 iKT, iConvo;
-    float kSum=0;
-    for (iKT =0, iConvo = kWidth -1; iKT < kRadW; iKT +=1, iConvo -=1){
-        if (kernel [iKT] != kernel [iConvo]) return NIL;
-        kSum += kernel [iKT] + kernel [iConvo];
-    }
-    // If we get to here, kernel is symetrical. Sum of kernel lacks central point
-    kSum += kernel [kRadW];
-    // make kernel table. It's symetrical, so we only need to make size kRadW + 1
-    float *kernelTable =(float*) WMNewPtr ((kRadW + 1) * sizeof (float));
-    if (kernelTable == NIL) return NIL;
-    // last point = kernel sum
-    kernelTable [kRadW] = kSum;
-    // each earlier point removes a value from left side
-    iKT = kRadW-1;
-    for (iConvo = 0; iKT >0; iKT -=1, iConvo +=1)
-        kernelTable [iKT] = kernelTable [iKT + 1] - kernel [iConvo];
-    kernelTable [iKT] = kernelTable [iKT + 1] - kernel [iConvo];
-    return kernelTable;
-}
-
-
-/* template function for convolving one wave with a 1D symetrical kernel (e.g., Guassian) and putting results in an output wave.
- Input wave can be 2 or 3D, but each plane is done as a separate 2D image.
- Last Modified 2014/01/21 by Jamie Boyd */
-template <typename TI, typename TO> void SymConvolveT (TI* srcWave, TO* destWave, TO* buffer, CountInt nWaveX, CountInt nWaveY, CountInt nWaveZ, float* kernel, float * kernelTable, UInt16 kWidth){
-    CountInt frameSize = nWaveX * nWaveY;
-    //variables for iterating through waves
-    UInt16 kRad = (kWidth-1)/2; // radius of kernel, not including the central point
-    //CountInt nWave = frameSize * nWaveZ;
-    //Position of pixel in x,y,z
-    CountInt iWaveY,  iWaveX;
-    //CountInt nEdgeY = kRad * nWaveX;
-    // iterating through kernel and convo positions, linear
-    CountInt iKernel, iConvo, iKernelTable=0, convoStart, kernelStart, kernelEnd;
-    // temporary value to calculate value for each pixel
-    double outVal;
-    CountInt iOut; // position of output value, in buffer, then in output wave
-    TI* srcFramePtr = srcWave;
-    TI* srcEndPtr = srcWave + frameSize * nWaveZ;
-    TO* destFramePtr = destWave;
-    for (; srcFramePtr < srcEndPtr; srcFramePtr += frameSize, destFramePtr += frameSize){
-        // Do Y filtering first, sending output to frame buffer. each Y starts at startFrameP + iWaveX
-        for (iWaveX =0; iWaveX < nWaveX; iWaveX +=1){
-            // TOP of each row.
-            iOut = iWaveX;
-            convoStart = iWaveX;
-            kernelStart = kRad;
-            kernelEnd = kWidth;
-            for (iWaveY=0; iWaveY < kRad; iWaveY += 1){
-                // convolution in Y
-                outVal =0;
-                for (iKernel =kernelStart, iConvo =convoStart; iKernel < kernelEnd; iKernel +=1, iConvo += nWaveX)
-                    outVal += srcFramePtr [iConvo] * kernel [iKernel];
-                buffer [iOut] = outVal / kernelTable [iKernelTable];
-                kernelStart -=1;
-                iKernelTable +=1;
-                iOut += nWaveX;
-            }
-            // Middle of each row
-            for (; iWaveY < (nWaveY - kRad); iWaveY += 1){
-                outVal =0;
-                // convolution in Y
-                for (iKernel =kernelStart, iConvo =convoStart; iKernel < kernelEnd; iKernel +=1, iConvo += nWaveX)
-                    outVal += srcFramePtr [iConvo] * kernel [iKernel];
-                buffer [iOut] = outVal / kernelTable [iKernelTable];
-                convoStart += nWaveX;
-                iOut += nWaveX;
-            }
-            // bottom of each row
-            for (; iWaveY < nWaveY; iWaveY += 1){
-                kernelEnd -=1;
-                iKernelTable -=1;
-                // convolution in Y
-                outVal =0;
-                for (iKernel =kernelStart, iConvo =convoStart; iKernel < kernelEnd; iKernel +=1, iConvo += nWaveX)
-                    outVal += srcFramePtr [iConvo] * kernel [iKernel];
-                buffer [iOut] = outVal / kernelTable [iKernelTable];
-                convoStart += nWaveX;
-                iOut += nWaveX;
-            }
-        }
-        // Do X filtering second, sending output to output wave.
-        iOut =0;
-        convoStart = 0;
-        for (iWaveY=0; iWaveY < nWaveY; iWaveY +=1){
-            kernelStart = kRad;
-            kernelEnd = kWidth;
-            // left edge
-            for (iWaveX =0; iWaveX < kRad; iWaveX +=1){
-                // convolution in X
-                outVal =0;
-                for (iKernel =kernelStart, iConvo =convoStart; iKernel < kernelEnd; iKernel +=1, iConvo += 1)
-                    outVal += buffer [iConvo] * kernel [iKernel];
-                destFramePtr [iOut] = outVal / kernelTable [iKernelTable];
-                kernelStart -=1;
-                iKernelTable +=1;
-                iOut += 1;
-            }
-            // Middle
-            for (; iWaveX < (nWaveX - kRad); iWaveX+= 1){
-                outVal =0;
-                // convolution in X
-                for (iKernel =kernelStart, iConvo =convoStart; iKernel < kernelEnd; iKernel +=1, iConvo += 1)
-                    outVal += buffer [iConvo] * kernel [iKernel];
-                destFramePtr [iOut] = outVal / kernelTable [iKernelTable];
-                convoStart += 1;
-                iOut += 1;
-            }
-            // right edge
-            for (; iWaveX< nWaveX; iWaveX += 1){
-                kernelEnd -=1;
-                iKernelTable -=1;
-                // convolution in X
-                outVal =0;
-                for (iKernel =kernelStart, iConvo =convoStart; iKernel < kernelEnd; iKernel +=1, iConvo += 1)
-                    outVal += buffer [iConvo] * kernel [iKernel];
-                destFramePtr [iOut] = outVal/ kernelTable [iKernelTable];
-                convoStart += 1;
-                iOut += 1;
-            }
-            convoStart += kRad; // get to next row for x filtering
-        }
-    }
+extern "C" int ConvolveFrames(ConvolveFramesParamsPtr p){
+    return ConvolveFramesDo (p, 0);
 }
 
-/* Each thread to symetrically convolve a range of frames starts with this function
- Last Modified 2025/06/23 by Jamie Boyd */
-void* SymConvolveFramesThread (void* threadarg){
-    struct ConvolveFramesThreadParams* p;
-    p = (struct ConvolveFramesThreadParams*) threadarg;
-    CountInt tFrames = p->zSize/p->tN; //frames per thread = number of frames / number of threads, truncated to an integer
-    CountInt startPos = p->ti * tFrames; // whaich frame to start this thread on depends on thread number * frames per thread. ti is 0 based
-    if (p->ti == p->tN - 1) tFrames +=  (p->zSize % p->tN); // the last thread gets any left-over frames
-    startPos *= (p->xSize * p->ySize); //change start position from frames to data points by multiplying by frame size
-    CountInt bufferOffset =p->ti * p->xSize * p->ySize;
-    if (p->isFloat){
-        switch (p->inPutWaveType) {
-            case NT_I8:
-                SymConvolveT ((char*)p->inPutDataPtr + startPos,(float*)p->outPutDataPtr + startPos, (float*)p->frameBufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kernelDataPtr, p->kernelTablePtr, p-> kWidth);
-                break;
-            case (NT_I8 | NT_UNSIGNED):
-                SymConvolveT ((unsigned char*)p->inPutDataPtr + startPos,(float*)p->outPutDataPtr + startPos, (float*)p->frameBufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kernelDataPtr, p->kernelTablePtr, p-> kWidth);
-                break;
-            case NT_I16:
-                SymConvolveT ((short*)p->inPutDataPtr + startPos,(float*)p->outPutDataPtr + startPos, (float*)p->frameBufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kernelDataPtr, p->kernelTablePtr, p-> kWidth);
-                break;
-            case (NT_I16 | NT_UNSIGNED):
-                SymConvolveT ((unsigned short*)p->inPutDataPtr + startPos,(float*)p->outPutDataPtr + startPos, (float*)p->frameBufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kernelDataPtr, p->kernelTablePtr, p-> kWidth);
-                break;
-            case NT_I32:
-                SymConvolveT ((long*)p->inPutDataPtr + startPos,(float*)p->outPutDataPtr + startPos, (float*)p->frameBufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kernelDataPtr, p->kernelTablePtr, p-> kWidth);
-                break;
-            case (NT_I32| NT_UNSIGNED):
-                SymConvolveT ((unsigned long*)p->inPutDataPtr + startPos,(float*)p->outPutDataPtr + startPos, (float*)p->frameBufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kernelDataPtr, p->kernelTablePtr, p-> kWidth);
-                break;
-            case NT_FP32:
-                SymConvolveT ((float*)p->inPutDataPtr + startPos,(float*)p->outPutDataPtr + startPos, (float*)p->frameBufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kernelDataPtr, p->kernelTablePtr, p-> kWidth);
-                break;
-            case NT_FP64:
-                SymConvolveT ((double*)p->inPutDataPtr + startPos,(float*)p->outPutDataPtr + startPos, (float*)p->frameBufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kernelDataPtr, p->kernelTablePtr, p-> kWidth);
-                break;
-        }
-    }else {
-        switch (p->inPutWaveType) {
-            case NT_I8:
-                SymConvolveT ((char*)p->inPutDataPtr + startPos,(char*)p->outPutDataPtr + startPos, (char*)p->frameBufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kernelDataPtr, p->kernelTablePtr, p-> kWidth);
-                break;
-            case (NT_I8 | NT_UNSIGNED):
-                SymConvolveT ((unsigned char*)p->inPutDataPtr + startPos,(unsigned char*)p->outPutDataPtr + startPos, (unsigned char*)p->frameBufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kernelDataPtr, p->kernelTablePtr, p-> kWidth);
-                break;
-            case NT_I16:
-                SymConvolveT ((short*)p->inPutDataPtr + startPos,(short*)p->outPutDataPtr + startPos,  (short*)p->frameBufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kernelDataPtr, p->kernelTablePtr, p-> kWidth);
-                break;
-            case (NT_I16 | NT_UNSIGNED):
-                SymConvolveT ((unsigned short*)p->inPutDataPtr + startPos,(unsigned short*)p->outPutDataPtr + startPos, (unsigned short*)p->frameBufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kernelDataPtr, p->kernelTablePtr, p-> kWidth);
-                break;
-            case NT_I32:
-                SymConvolveT ((long*)p->inPutDataPtr + startPos,(long*)p->outPutDataPtr + startPos, (long*)p->frameBufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kernelDataPtr, p->kernelTablePtr, p-> kWidth);
-                break;
-            case (NT_I32| NT_UNSIGNED):
-                SymConvolveT ((unsigned long*)p->inPutDataPtr + startPos,(unsigned long*)p->outPutDataPtr + startPos, (unsigned long*)p->frameBufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kernelDataPtr, p->kernelTablePtr, p-> kWidth);
-                break;
-            case NT_FP32:
-                SymConvolveT ((float*)p->inPutDataPtr + startPos,(float*)p->outPutDataPtr + startPos, (float*)p->frameBufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kernelDataPtr, p->kernelTablePtr, p-> kWidth);
-                break;
-            case NT_FP64:
-                SymConvolveT ((double*)p->inPutDataPtr + startPos,(double*)p->outPutDataPtr + startPos, (double*)p->frameBufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kernelDataPtr, p->kernelTablePtr, p-> kWidth);
-                break;
-        }
-    }
-    return nullptr;
+/* ConvolveFramesAsync XOP entry function
+ Checks the waves and makes the output wave as ConvolveFrames does, then starts the convolution as a job on a thread of
+ its own and returns the job ID, without waiting for it. Use AsyncJobProgress, AsyncJobWait and AsyncJobCancel with
+ the job ID, and do not change the waves until the job is collected by AsyncJobWait or AsyncJobCancel
+ Last Modified 2026/10/16 */
+extern "C" int ConvolveFramesAsync(ConvolveFramesParamsPtr p){
+    return ConvolveFramesDo (p, 1);
 }
 
+/* -------------------------------- convolution with a symetrical 2D kernel ------------------------------------------
+ A symetrical 2D kernel applied as the same 1D kernel done first in X and then in Y. Each frame is done as 2D plane
+ ------------------------------------------------------------------------------------------------------------------- */
+ 
 /* SymConvolveFrames XOP entry function
  Convolves a 2D or 3D wave with a 1D symetrical kernel in X and Y, and sends the output to an output wave.
  Treats each plane in a 3D wave as a separate image
@@ -739,7 +247,7 @@ void* SymConvolveFramesThread (void* threadarg){
  Handle outPutPath;	// A handle to a string containing path to output wave we want to make, or empty string to overwrite existing wave
  waveHndl inPutWaveH; //input wave. needs to be 2D or 3D wave
  double result; */
-extern "C" int SymConvolveFrames(ConvolveFramesParamsPtr p) {
+static int SymConvolveFramesDo (ConvolveFramesParamsPtr p, UInt8 isAsync) {
     int result = 0;	// The error returned from various Wavemetrics functions
     waveHndl inPutWaveH, outPutWaveH, kernelH;		// handles to the input wave, output wave (we create) and kernel wave
     int inPutWaveType; //  Wavetypes numeric codes for things like 32 bit floating point, 16 bit int, etc
@@ -759,11 +267,12 @@ extern "C" int SymConvolveFrames(ConvolveFramesParamsPtr p) {
     UInt8 overWrite = (UInt8)(p->overWrite);	// 0 to not overwrite output wave if it already exists, 1 to overwrite old waves
     UInt8 isFloat = (UInt8)(p-> outPutType); // 0 to use input type, non-zero to use 32 bit floating point
     UInt8 isOverWriting; // non-zero if output is overwriting input wave
-    float *kernelTable;
-    UInt8 iThread, nThreads;
-    ConvolveFramesThreadParamsPtr paramArrayPtr;
-    pthread_t* threadsPtr;
-    char *inPutDataStartPtr, *outPutDataStartPtr, *kernelDataStartPtr, *bufferPtr;
+    float *kernelTable = nullptr;
+    UInt32 nThreads;
+    ConvolveFramesThreadParams params;  // paramaters for the tiles
+    char *inPutDataStartPtr, *outPutDataStartPtr, *kernelDataStartPtr, *bufferPtr = nullptr;
+    XFuncTimer timer;  // times each phase of this call, for TwoPhotonStats
+    XFuncTimerStart (&timer, isAsync ? STATS_SYMCONVOLVEFRAMESASYNC : STATS_SYMCONVOLVEFRAMES);
     try{
         // Get handles to input wave and kernel.
         inPutWaveH = p->inPutWaveH;
@@ -821,11 +330,13 @@ extern "C" int SymConvolveFrames(ConvolveFramesParamsPtr p) {
                 // make the output wave
                 //No liberal wave names for output wave
                 CleanupName (0, outPutWaveName, MAX_OBJ_NAME);
+                XFuncTimerPhase (&timer, STATS_MAKEWAVE);
                 if (isFloat){
                     if (MDMakeWave (&outPutWaveH, outPutWaveName, outPutDFHandle, inPutDimensionSizes, NT_FP32, overWrite)) throw result = WAVEERROR_NOS;
                 }else{
                     if (MDMakeWave (&outPutWaveH, outPutWaveName, outPutDFHandle, inPutDimensionSizes, inPutWaveType, overWrite)) throw result = WAVEERROR_NOS;
                 }
+                XFuncTimerPhase (&timer, STATS_THREADS);
             }
         }
         //Get data offsets for the 3 waves (2 waves, if overwriting)
@@ -843,14 +354,8 @@ extern "C" int SymConvolveFrames(ConvolveFramesParamsPtr p) {
         kernelTable = SymConvolveMakeKernelTable ((float*)kernelDataStartPtr, kernelDimensionSizes [0]);
         if (kernelTable ==NULL) throw result = BADSYMKERNEL;
         // multiprocessor initialization
-        nThreads = gNumProcessors;
+        nThreads = (isAsync) ? ThreadPoolBackgroundSlots () : gNumProcessors;
         if (zSize < nThreads) nThreads = zSize;
-        // make an array of parameter structures
-        paramArrayPtr= (ConvolveFramesThreadParamsPtr)WMNewPtr (nThreads * sizeof(ConvolveFramesThreadParams));
-        if (paramArrayPtr == nullptr) throw result = MEMFAIL;
-        // make an array of pthread_t
-        threadsPtr =(pthread_t*)WMNewPtr(nThreads * sizeof(pthread_t));
-        if (threadsPtr == nullptr) throw result = MEMFAIL;
         // make buffer
         switch (inPutWaveType) {
             case NT_I64 | NT_UNSIGNED:
@@ -877,9 +382,9 @@ extern "C" int SymConvolveFrames(ConvolveFramesParamsPtr p) {
         }
         if (bufferPtr == nullptr) throw result = NOMEM;
     }catch (int (result)) { // catch errors before starting threads
+        XFuncTimerEnd (&timer);
         if (bufferPtr != nullptr)WMDisposePtr ((Ptr)bufferPtr);
-        if (threadsPtr != nullptr) WMDisposePtr ((Ptr)threadsPtr);
-        if (paramArrayPtr != nullptr) WMDisposePtr ((Ptr)paramArrayPtr);
+        if (kernelTable != nullptr) WMDisposePtr ((Ptr)kernelTable);
         WMDisposeHandle (p->outPutPath);    // free input string for output path
         p -> result = (double)(result - FIRST_XOP_ERR);
         #ifdef NO_IGOR_ERR
@@ -888,290 +393,53 @@ extern "C" int SymConvolveFrames(ConvolveFramesParamsPtr p) {
             return (result);
         #endif
     }
-    // fill paramater array
-    for (iThread = 0; iThread < nThreads; iThread++){
-        paramArrayPtr[iThread].inPutWaveType = inPutWaveType;
-        paramArrayPtr[iThread].inPutDataPtr = inPutDataStartPtr;
-        paramArrayPtr[iThread].outPutDataPtr = outPutDataStartPtr;
-        paramArrayPtr[iThread].frameBufferPtr = bufferPtr;
-        paramArrayPtr[iThread].xSize = inPutDimensionSizes [0];
-        paramArrayPtr[iThread].ySize = inPutDimensionSizes [1];
-        paramArrayPtr[iThread].zSize =zSize;
-        paramArrayPtr[iThread].ti=iThread; // number of this thread, starting from 0
-        paramArrayPtr[iThread].tN =nThreads; // total number of threads
-        paramArrayPtr[iThread].kernelDataPtr=(float*)kernelDataStartPtr; //pointer to start of kernel
-        paramArrayPtr[iThread].kWidth = kernelDimensionSizes[0]; //width of kernel
-        paramArrayPtr[iThread].kernelTablePtr =kernelTable; // sum of kernel at start of column or line
-        paramArrayPtr[iThread].isFloat = isFloat; // 0 for same type as input wave, non-zero for floating point wave
-    }
-    // create the threads
-    for (iThread = 0; iThread < nThreads; iThread++){
-        pthread_create (&threadsPtr[iThread], NULL, SymConvolveFramesThread, (void *) &paramArrayPtr[iThread]);
-    }
-    // Wait till all the threads are finished
-    for (iThread = 0; iThread < nThreads; iThread++){
-        pthread_join (threadsPtr[iThread], NULL);
+    XFuncTimerPhase (&timer, STATS_THREADS);
+    // fill paramater structure
+    params.inPutWaveType = inPutWaveType;
+    params.inPutDataPtr = inPutDataStartPtr;
+    params.outPutDataPtr = outPutDataStartPtr;
+    params.frameBufferPtr = bufferPtr;
+    params.xSize = inPutDimensionSizes [0];
+    params.ySize = inPutDimensionSizes [1];
+    params.zSize =zSize;
+    params.kernelDataPtr=(float*)kernelDataStartPtr; //pointer to start of kernel
+    params.kWidth = kernelDimensionSizes[0]; //width of kernel
+    params.kernelTablePtr =kernelTable; // sum of kernel at start of column or line
+    params.isFloat = isFloat; // 0 for same type as input wave, non-zero for floating point wave
+    if (isAsync){ // start a job on its own thread, which owns the buffers from now on, and return its ID
+        XFuncTimerPhase (&timer, STATS_COMPUTE);
+        result = AsyncJobStart (SymConvolveFramesTile, &params, sizeof (params), zSize, nThreads, outPutWaveH, inPutWaveH, kernelH, (Ptr)bufferPtr, (Ptr)kernelTable, &p->result);
+        return ConvolveFramesAsyncResult (p->outPutPath, result, &p->result, &timer);
     }
+    // run the tiles on the thread pool, one frame per tile, and wait till they are all finished
+    XFuncTimerPhase (&timer, STATS_COMPUTE);
+    ThreadPoolRunTiles (SymConvolveFramesTile, &params, zSize, 1, nThreads);
+    XFuncTimerPhase (&timer, STATS_FINISH);
     WMDisposePtr ((Ptr)bufferPtr);      // free memory for frame buffer
-    WMDisposePtr ((Ptr)threadsPtr);     // free memory for pThreads Array
-    WMDisposePtr ((Ptr)paramArrayPtr);  // Free paramaterArray memory
     WMDisposePtr ((Ptr)kernelTable);    //free kernel table memory
     WMDisposeHandle (p->outPutPath);    // free input string for output path
     WaveHandleModified(outPutWaveH);    // Inform Igor that we have changed the output wave.
     p -> result = (0);
+    XFuncTimerEnd (&timer);
     return (0);
 }
 
-
-/* -------------------------------------- MedianFrames-------------------------------------------------------
- Applies a median filter to a 2D or 3D wave, treating each plane as a separate 2D image
- Does multiple frames in a single 3D wave
- -------------------------------------------------------------------------------------------------------------*/
-
-/* template for a stand-alone median function for any data type
- n = number of data points, dataStrtPtr is pointer to start of data
- Last Modified 2013/07/16 by Jamie Boyd */
-template <typename T> T medianT (UInt32 n, T* dataStrtPtr) {
-    UInt32 medianOffset = n/2; // point offset to location of median value when function returns
-    UInt32 i,right = n -1,j,left =0, mid; // point offsets used for partitioning
-    T a; //
-    T temp; // used for SWAP macro
-    for (;;) {
-        if (right <= left+1) {
-            if (right == left+1 && *(dataStrtPtr + right) < *(dataStrtPtr + left)) {
-                SWAP((*(dataStrtPtr + left)),(*(dataStrtPtr + right)));
-            }
-            return *(dataStrtPtr + medianOffset);
-        } else {
-            mid=(left + right) >> 1;
-            SWAP((*(dataStrtPtr + mid)),(*(dataStrtPtr + left + 1)));
-            if (*(dataStrtPtr + left) > *(dataStrtPtr + right)) {
-                SWAP((*(dataStrtPtr + left)),(*(dataStrtPtr + right)));
-            }
-            if (*(dataStrtPtr + left + 1) > *(dataStrtPtr + right)) {
-                SWAP((*(dataStrtPtr + left + 1)), ( *(dataStrtPtr + right)));
-            }
-            if (*(dataStrtPtr + left) > *(dataStrtPtr + left+1)) {
-                SWAP((*(dataStrtPtr + left)),(*(dataStrtPtr + left+1)));
-            }
-            i=left+1;
-            j=right;
-            a=*(dataStrtPtr + left+1);
-            for (;;) {
-                do i++; while (*(dataStrtPtr + i) < a);
-                do j--; while (*(dataStrtPtr + j) > a);
-                if (j < i) break;
-                SWAP((*(dataStrtPtr + i)),(*(dataStrtPtr + j)));
-            }
-            *(dataStrtPtr + left + 1) = *(dataStrtPtr + j);
-            *(dataStrtPtr + j) = a;
-            if (j >= medianOffset) right=j-1;
-            if (j <= medianOffset) left=i;
-        }
-    }
+extern "C" int SymConvolveFrames(ConvolveFramesParamsPtr p) {
+    return SymConvolveFramesDo (p, 0);
 }
 
-
- /* template for applying a median filter and putting the results in an output wave.
-  Input wave can be 2 or 3D, but each plane is done as a separate 2D image.
- Last Modified 2025/06/24 by Jamie Boyd */
-template <typename TI> void MedianFramesT (TI* srcWave, TI* destWave, TI* bufferStartPtr, CountInt xSize, CountInt ySize, CountInt zSize, UInt16 kWidth){
-    CountInt fSize = (xSize * ySize);  //frame size
-    CountInt bufferSize =(fSize *  sizeof (TI));
-    UInt32 kSize = (kWidth * kWidth); // number of pixels in the kernel
-    TI* kernelCopyStart; // pointer to start of the buffer to store copied data to be medianed in a destructive fashion
-    UInt32  kBufferSize = (kSize *  sizeof (TI));
-    UInt32 kRadW = (kWidth - 1)/2; //radius of the kernel width, including the central pixel
-    UInt8 isOverWriting = 0; // will be set to 1 if overwriting existing wave
-    TI* inPutPtr; // Center pixel input pixel. Offsets to kernel input are calculated relative to this. Value progresses monotonically through wave
-    TI* convoPtr; // pointer to pixel of the image used when copying data
-    TI* outPutPtr; // output pixel to get the calculated median value. Value progresses monotonically through the wave
-    TI* kPtr;  // pointer to iterate through the copied data
-    CountInt kX, kY, kXend, kYend; // variables for iterating through pieces of kernel
-    CountInt wToNextRow; //amount to add to wToFirstRow to get to next row in input wave when iterating through a kernel
-    CountInt wX, wY, wZ, wXend, wYend; // to keep track of progress through X and Y in input wave
-    // overwriting source if dest == src
-    if ((TI*)destWave == (TI*)srcWave){
-        isOverWriting = 1;
-    }
-    // Make a buffer big enough to hold a "kernel's worth" of pixels - allocate in thread because it is too small to fail
-    kernelCopyStart = (TI*) WMNewPtr (kBufferSize);
-    // Loop through all frames
-    for (wZ=0, outPutPtr = destWave, inPutPtr =srcWave; wZ < zSize; wZ++){
-        if (isOverWriting){  // copy next frame to buffer and position input pointer at start of buffer
-            memcpy ((void*) bufferStartPtr, (void*) outPutPtr, bufferSize);
-            inPutPtr = (TI*) bufferStartPtr;
-        } // If not copying to a buffer, inputPtr will be left in correct position at end of Z loop
-        // Loop for TOP
-        for (wY = 0; wY < kRadW; wY++){
-            // loop for TOP LEFT
-            for (wX =0; wX < kRadW; wX++, inPutPtr++, outPutPtr++){
-                convoPtr = inPutPtr - (wY  * xSize) - wX;
-                wToNextRow =  (UInt32)(xSize - kRadW - wX - 1);
-                kPtr = kernelCopyStart;
-                // loop through kernel at each location
-                for (kY = kRadW - wY; kY < kWidth; kY++ , convoPtr +=wToNextRow){
-                    for (kX = kRadW - wX; kX < kWidth; kX++, kPtr++, convoPtr++) *kPtr = *convoPtr;
-                }
-                *outPutPtr = medianT ((CountInt)(kPtr - kernelCopyStart), kernelCopyStart);
-            } // End of Loop for TOP LEFT
-            // Loop for TOP CENTER
-            for (wXend =(xSize - kRadW); wX < wXend; wX++, inPutPtr++, outPutPtr++){
-                // loop through kernel at each location
-                convoPtr = inPutPtr - (wY  * xSize) - kRadW;
-                wToNextRow = xSize - kWidth;
-                kPtr = kernelCopyStart;
-                for (kY = kRadW - wY; kY < kWidth; kY++, convoPtr += wToNextRow){
-                    for (kX =0; kX < kWidth; kX++, kPtr++, convoPtr++) *kPtr = *convoPtr;
-                }
-                *outPutPtr = medianT ((CountInt)(kPtr - kernelCopyStart), kernelCopyStart);
-            } // End of Loop for TOP CENTER
-            // Loop for TOP RIGHT
-            for (;wX < xSize; wX++, inPutPtr++, outPutPtr++){
-                // loop through kernel at each location
-                convoPtr =  inPutPtr - (wY  * xSize) - kRadW;
-                wToNextRow = xSize - kRadW - (xSize - wX);
-                kPtr = kernelCopyStart;
-                for (kY = kRadW - wY; kY < kWidth; kY++, convoPtr += wToNextRow){
-                    for (kX =0, kXend = kRadW + (xSize - wX); kX < kXend; kX++, kPtr++, convoPtr++) *kPtr = *convoPtr;
-                }
-                *outPutPtr = medianT ((CountInt)(kPtr - kernelCopyStart), kernelCopyStart);
-            } // End of Loop for TOP RIGHT
-        } // End of Loop for TOP
-        // Loop for MIDDLE
-        for (wYend =(ySize - kRadW) ; wY < wYend ; wY++){
-            // Loop for MIDDLE LEFT
-            for (wX =0; wX < kRadW; wX++, inPutPtr++, outPutPtr++){
-                convoPtr = inPutPtr - (kRadW  * xSize) - wX;
-                wToNextRow =  xSize - kRadW - wX - 1;
-                kPtr = kernelCopyStart;
-                // loop through kernel at each location
-                for (kY = 0; kY < kWidth; kY++, convoPtr +=wToNextRow){
-                    for (kX = kRadW - wX; kX < kWidth; kX++, kPtr++, convoPtr++) *kPtr = *convoPtr;
-                }
-                *outPutPtr = medianT ((CountInt)(kPtr - kernelCopyStart), kernelCopyStart);
-            } // End of Loop for MIDDLE LEFT
-            // Loop for MIDDLE CENTER
-            for (wXend = (xSize - kRadW); wX < wXend ; wX++, inPutPtr++, outPutPtr++){
-                convoPtr = inPutPtr - (kRadW  * xSize) - kRadW;
-                wToNextRow = xSize - kWidth;
-                kPtr = kernelCopyStart;
-                // loop through kernel at each location
-                for (kY = 0; kY < kWidth; kY++, convoPtr += wToNextRow){
-                    for (kX =0; kX < kWidth; kX++, kPtr++, convoPtr++) *kPtr = *convoPtr;
-                }
-                *outPutPtr = medianT ((CountInt)(kPtr - kernelCopyStart), kernelCopyStart);
-            } // End of Loop for MIDDLE CENTER
-            // Loop for MIDDLE RIGHT
-            for (;wX < xSize; wX++, inPutPtr++, outPutPtr++){
-                // loop through kernel at each location
-                convoPtr =  inPutPtr - (kRadW  * xSize) - kRadW;
-                wToNextRow = xSize - kRadW - (xSize - wX);
-                kPtr = kernelCopyStart;
-                for (kY = 0; kY < kWidth; kY++, convoPtr += wToNextRow){
-                    for (kX = 0, kXend = kRadW + (xSize - wX); kX < kXend; kX++, kPtr++, convoPtr++) *kPtr = *convoPtr;
-                }
-                *outPutPtr = medianT ((CountInt)(kPtr - kernelCopyStart), kernelCopyStart);
-            } // End of Loop for MIDDLE RIGHT
-        } // End of Loop for MIDDLE
-        // Loop for BOTTOM
-        for (; wY < ySize; wY++){
-            // Loop for BOTTOM LEFT
-            for (wX = 0; wX < kRadW; wX ++, inPutPtr++, outPutPtr++){
-                // Loop through kernel at each location
-                convoPtr = inPutPtr - (kRadW  * xSize) - wX;
-                wToNextRow =  xSize - kRadW - wX - 1;
-                kPtr = kernelCopyStart;
-                for (kY = 0, kYend = kRadW + (ySize - wY); kY < kYend; kY++, convoPtr += wToNextRow){
-                    for (kX =kRadW - wX; kX < kWidth; kX++, kPtr++, convoPtr++) *kPtr = *convoPtr;
-                }
-                *outPutPtr = medianT ((CountInt)(kPtr - kernelCopyStart), kernelCopyStart);
-            } // End ofLoop for BOTTOM LEFT
-            // Loop for BOTTOM CENTER
-            for (; wX < (xSize - kRadW); wX++, inPutPtr++, outPutPtr++){
-                // Loop through kernel at each location
-                convoPtr = inPutPtr - (kRadW  * xSize) - kRadW;
-                wToNextRow = xSize - kWidth;
-                kPtr = kernelCopyStart;
-                for (kY = 0, kYend = kRadW + (ySize - wY) ; kY < kYend; kY++, convoPtr += wToNextRow){
-                    for (kX =0; kX < kWidth; kX++, convoPtr++, kPtr++) *kPtr = *convoPtr;
-                }
-                *outPutPtr = medianT ((CountInt)(kPtr - kernelCopyStart), kernelCopyStart);
-            } // End of Loop for BOTTOM CENTER
-            // Loop for BOTTOM RIGHT
-            for (; wX < xSize; wX++, inPutPtr++, outPutPtr++){
-                //Loop through kernel at each location
-                convoPtr =  inPutPtr - (kRadW * xSize) - kRadW;
-                wToNextRow = xSize - kRadW - (xSize - wX);
-                kPtr = kernelCopyStart;
-                for (kYend = kRadW + (ySize - wY), kY =0; kY < kYend; kY++, convoPtr += wToNextRow){
-                    for (kX =0, kXend = kRadW + (xSize -wX); kX < kXend; kX++, convoPtr++, kPtr++) *kPtr = *convoPtr;
-                }
-                *outPutPtr = medianT ((CountInt)(kPtr - kernelCopyStart), kernelCopyStart);
-            } // End of Loop for BOTTOM RIGHT
-        } // End of Loop for BOTTOM
-    } // End of Loop for Each Frame
-    if (kernelCopyStart != nullptr) WMDisposePtr ((Ptr)kernelCopyStart);
+/* SymConvolveFramesAsync XOP entry function
+ SymConvolveFrames as a job on a thread of its own, returning the job ID right away, as for ConvolveFramesAsync
+ Last Modified 2026/10/16 */
+extern "C" int SymConvolveFramesAsync(ConvolveFramesParamsPtr p) {
+    return SymConvolveFramesDo (p, 1);
 }
 
-/* Structure to pass data to each MedianFramesThread
- Last Modified 2013/07/16 by Jamie Boyd */
-typedef struct MedianFramesThreadParams{
-    int inPutWaveType;
-    char* inPutDataStartPtr;
-    char* outPutDataStartPtr;
-    char* bufferPtr;
-    CountInt xSize;
-    CountInt ySize;
-    CountInt zSize;
-    UInt8 ti; // number of this thread, starting from 0
-    UInt8 tN; // total number of threads
-    UInt16 kWidth;
-}MedianFramesThreadParams, *MedianFramesThreadParamsPtr;
-
 
-/* Each thread to median filter a range of frames starts with this function
- Last Modified 2013/07/16 by Jamie Boyd */
-void* MedianFramesThread (void* threadarg){
-    struct MedianFramesThreadParams* p;
-    p = (struct MedianFramesThreadParams*) threadarg;
-    CountInt tFrames = p->zSize/p->tN; //frames per thread = number of frames / number of threads, truncated to an integer
-    CountInt startPos = p->ti * tFrames; // which frame to start this thread on depends on thread number * frames per thread. ti is 0 based
-    CountInt frameSize = p->xSize * p->ySize;
-    if (p->ti == p->tN - 1) tFrames +=  (p->zSize % p->tN); // the last thread gets any left-over frames
-    startPos *= frameSize; //change start position from frames to data points by multiplying by frame size
-    // call the right template function for the wave types
-    CountInt bufferOffset = 0;
-    if (p->inPutDataStartPtr == p->outPutDataStartPtr )
-        bufferOffset= frameSize * p->ti;
-    switch (p->inPutWaveType) {
-        case NT_I8:
-            MedianFramesT ((char*)p->inPutDataStartPtr + startPos, (char*)p->outPutDataStartPtr + startPos, (char*)p->bufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kWidth);
-            break;
-        case (NT_I8 | NT_UNSIGNED):
-            MedianFramesT ((unsigned char*)p->inPutDataStartPtr + startPos,(unsigned char*)p->outPutDataStartPtr + startPos, (unsigned char*)p->bufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kWidth);
-            break;
-        case NT_I16:
-            MedianFramesT ((short*)p->inPutDataStartPtr + startPos,(short*)p->outPutDataStartPtr + startPos, (short*)p->bufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kWidth);
-            break;
-        case (NT_I16 | NT_UNSIGNED):
-            MedianFramesT ((unsigned short*)p->inPutDataStartPtr + startPos,(unsigned short*)p->outPutDataStartPtr + startPos, (unsigned short*)p->bufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kWidth);
-            break;
-        case NT_I32:
-            MedianFramesT ((long*)p->inPutDataStartPtr + startPos,(long*)p->outPutDataStartPtr + startPos, (long*)p->bufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kWidth);
-            break;
-        case (NT_I32| NT_UNSIGNED):
-            MedianFramesT ((unsigned long*)p->inPutDataStartPtr + startPos,(unsigned long*)p->outPutDataStartPtr + startPos, (unsigned long*)p->bufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kWidth);
-            break;
-        case NT_FP32:
-            MedianFramesT ((float*)p->inPutDataStartPtr + startPos,(float*)p->outPutDataStartPtr + startPos, (float*)p->bufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kWidth);
-            break;
-        case NT_FP64:
-            MedianFramesT ((double*)p->inPutDataStartPtr + startPos,(double*)p->outPutDataStartPtr + startPos, (double*)p->bufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kWidth);
-            break;
-    }
-    return nullptr;
-}
+/* -------------------------------------- MedianFrames-------------------------------------------------------
+ Applies a median filter to a 2D or 3D wave, treating each plane as a separate 2D image
+ Does multiple frames in a single 3D wave
+ -------------------------------------------------------------------------------------------------------------*/
 
 /* MedianFrames XOP entry function
  Applies a median filter to a 2D or 3D wave, treating each plane in a 3D wave as a separate 2D image
@@ -1183,7 +451,7 @@ void* MedianFramesThread (void* threadarg){
  double result;
  } MedianFramesParams, *MedianFramesParamsPtr;
  Last modified 2013/07/16 by Jamie Boyd */
-extern "C" int MedianFrames (MedianFramesParamsPtr p){
+static int MedianFramesDo (MedianFramesParamsPtr p, UInt8 isAsync){
     int result = 0;	// The error returned from various Wavemetrics functions
     waveHndl inPutWaveH, outPutWaveH;		// handles to the input and output waves
 	int inPutWaveType; //  Wavetypes numeric codes for things like 32 bit floating point, 16 bit int, etc
@@ -1199,9 +467,10 @@ extern "C" int MedianFrames (MedianFramesParamsPtr p){
     UInt8 isOverWriting; // non-zero if output is overwriting input wave
     char *inPutDataStartPtr, *outPutDataStartPtr, *bufferPtr = nullptr;
     // for threads
-    UInt8 iThread, nThreads;
-    MedianFramesThreadParamsPtr paramArrayPtr = nullptr;
-    pthread_t* threadsPtr = nullptr;
+    UInt32 nThreads;
+    MedianFramesThreadParams params;    // paramaters for the tiles
+    XFuncTimer timer;  // times each phase of this call, for TwoPhotonStats
+    XFuncTimerStart (&timer, isAsync ? STATS_MEDIANFRAMESASYNC : STATS_MEDIANFRAMES);
     try{
         // Check that kWidth is odd
         if ((kWidth % 2) == 0) throw result = BADKERNEL;
@@ -1232,8 +501,8 @@ extern "C" int MedianFrames (MedianFramesParamsPtr p){
             if (GetNamedDataFolder (NULL, outPutPath, &outPutDFHandle))throw result = WAVEERROR_NOS;
             // Test name and data folder for output wave against the input wave to prevent accidental overwriting, if src and dest are the same
             WaveName (inPutWaveH, inPutWaveName);
-            if (GetWavesDataFolder (inPutWaveH, &inPutDFHandle)) return WAVEERROR_NOS;
-            if (GetDataFolderNameOrPath (inPutDFHandle, 1, inPutPath)) return WAVEERROR_NOS;
+            if (GetWavesDataFolder (inPutWaveH, &inPutDFHandle)) throw result = WAVEERROR_NOS;
+            if (GetDataFolderNameOrPath (inPutDFHandle, 1, inPutPath)) throw result = WAVEERROR_NOS;
             if ((!(CmpStr (inPutPath,outPutPath))) && (!(CmpStr (inPutWaveName,outPutWaveName)))){	// Then we would overwrite input wave
                 if (overWrite == NO_OVERWITE) throw result = OVERWRITEALERT;
                 isOverWriting = 1;
@@ -1243,7 +512,9 @@ extern "C" int MedianFrames (MedianFramesParamsPtr p){
                 // make the output wave
                 //No liberal wave names for output wave
                 CleanupName (0, outPutWaveName, MAX_OBJ_NAME);
+                XFuncTimerPhase (&timer, STATS_MAKEWAVE);
                 if (MDMakeWave (&outPutWaveH, outPutWaveName, outPutDFHandle, inPutDimensionSizes, inPutWaveType, overWrite)) throw result = WAVEERROR_NOS;
+                XFuncTimerPhase (&timer, STATS_THREADS);
             }
         }
 		//Get data offsets for the 2 waves (1 wave, if overwriting)
@@ -1256,14 +527,8 @@ extern "C" int MedianFrames (MedianFramesParamsPtr p){
         inPutDataStartPtr = (char*)(*inPutWaveH) + inPutOffset;
         outPutDataStartPtr =  (char*)(*outPutWaveH) + outPutOffset; // true even if overwriting
         // multiprocessor init
-        nThreads = gNumProcessors;
-        if (zSize < nThreads) nThreads = (UInt8) zSize;
-        // make array of parameter structures */
-        paramArrayPtr = (MedianFramesThreadParamsPtr)WMNewPtr(nThreads * sizeof(MedianFramesThreadParams));
-        if (paramArrayPtr == nullptr) throw result = NOMEM;
-        // make an array of pthread_t
-        threadsPtr =(pthread_t*)WMNewPtr(nThreads * sizeof(pthread_t));
-        if (threadsPtr == nullptr) throw result = NOMEM;
+        nThreads = (isAsync) ? ThreadPoolBackgroundSlots () : gNumProcessors;
+        if (zSize < nThreads) nThreads = (UInt32) zSize;
         // make a buffer of frames for threads if overwriting src
         if (isOverWriting){
             switch (inPutWaveType) {
@@ -1292,9 +557,8 @@ extern "C" int MedianFrames (MedianFramesParamsPtr p){
             if (bufferPtr == nullptr) throw result = NOMEM;
         }
     }catch (int result){
+        XFuncTimerEnd (&timer);
         if (bufferPtr != nullptr) WMDisposePtr ((Ptr)bufferPtr);
-        if (threadsPtr != nullptr) WMDisposePtr ((Ptr)threadsPtr);
-        if (paramArrayPtr != nullptr) WMDisposePtr ((Ptr)paramArrayPtr);
         WMDisposeHandle (p->outPutPath);    // free input string for output path
         p -> result = (double)(result - FIRST_XOP_ERR);
         #ifdef NO_IGOR_ERR
@@ -1303,32 +567,40 @@ extern "C" int MedianFrames (MedianFramesParamsPtr p){
             return (result);
         #endif
     }
-    // fill params array
-    for (iThread = 0; iThread < nThreads; iThread++){
-        paramArrayPtr[iThread].inPutWaveType = inPutWaveType;
-        paramArrayPtr[iThread].inPutDataStartPtr = inPutDataStartPtr;
-        paramArrayPtr[iThread].outPutDataStartPtr = outPutDataStartPtr;
-        paramArrayPtr[iThread].bufferPtr = bufferPtr;
-        paramArrayPtr[iThread].xSize = inPutDimensionSizes [0];
-        paramArrayPtr[iThread].ySize = inPutDimensionSizes [1];
-        paramArrayPtr[iThread].zSize = inPutDimensionSizes [2];
-        paramArrayPtr[iThread].ti=iThread; // number of this thread, starting from 0
-        paramArrayPtr[iThread].tN =nThreads; // total number of threads
-        paramArrayPtr[iThread].kWidth = (int)kWidth;
-    }
-    // create the threads
-    for (iThread = 0; iThread < nThreads; iThread++){
-        pthread_create (&threadsPtr[iThread], NULL, MedianFramesThread, (void *) &paramArrayPtr[iThread]);
-    }
-    // Wait till all the threads are finished
-    for (iThread = 0; iThread < nThreads; iThread++){
-        pthread_join (threadsPtr[iThread], NULL);
+    XFuncTimerPhase (&timer, STATS_THREADS);
+    // fill paramater structure
+    params.inPutWaveType = inPutWaveType;
+    params.inPutDataStartPtr = inPutDataStartPtr;
+    params.outPutDataStartPtr = outPutDataStartPtr;
+    params.bufferPtr = bufferPtr;
+    params.xSize = inPutDimensionSizes [0];
+    params.ySize = inPutDimensionSizes [1];
+    params.zSize = inPutDimensionSizes [2];
+    params.kWidth = (int)kWidth;
+    if (isAsync){ // start a job on its own thread, which owns the buffer from now on, and return its ID
+        XFuncTimerPhase (&timer, STATS_COMPUTE);
+        result = AsyncJobStart (MedianFramesTile, &params, sizeof (params), zSize, nThreads, outPutWaveH, inPutWaveH, nullptr, (Ptr)bufferPtr, nullptr, &p->result);
+        return ConvolveFramesAsyncResult (p->outPutPath, result, &p->result, &timer);
     }
-    WMDisposePtr ((Ptr)bufferPtr);      // free memory for buffer
-    WMDisposePtr ((Ptr)threadsPtr);     // free memory for pThreads Array
-    WMDisposePtr ((Ptr)paramArrayPtr);  // free memory for paramaters Array
+    // run the tiles on the thread pool, one frame per tile, and wait till they are all finished
+    XFuncTimerPhase (&timer, STATS_COMPUTE);
+    ThreadPoolRunTiles (MedianFramesTile, &params, zSize, 1, nThreads);
+    XFuncTimerPhase (&timer, STATS_FINISH);
+    if (bufferPtr != nullptr) WMDisposePtr ((Ptr)bufferPtr);      // free memory for buffer
     WMDisposeHandle (p->outPutPath);    // free input string for output path
     WaveHandleModified(outPutWaveH);	// Inform Igor that we have changed the output wave.
     p -> result = (0);
+    XFuncTimerEnd (&timer);
     return (0);
 }
+
+extern "C" int MedianFrames (MedianFramesParamsPtr p){
+    return MedianFramesDo (p, 0);
+}
+
+/* MedianFramesAsync XOP entry function
+ MedianFrames as a job on a thread of its own, returning the job ID right away, as for ConvolveFramesAsync
+ Last Modified 2026/10/16 */
+extern "C" int MedianFramesAsync (MedianFramesParamsPtr p){
+    return MedianFramesDo (p, 1);
+}
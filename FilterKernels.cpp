@@ -0,0 +1,689 @@
+#include "twoPhotonKernels.h"
+/* ----------------------------------------Filter Kernels ------------------------------------------------------------------
+ Templates and tile functions for filtering waves with 2D convolution kernels - arbitrary, symetrical, or median.
+ The XFUNCs that call them are in Filter.cpp
+ Last Modified 2026/10/16
+--------------------------------------------------------------------------------------------------------------------*/
+
+/* ------------------------------------ convolution with a 2D kernel ------------------------------------------
+ convolves each frame in input wave with an arbitrary sized 2D kernel
+ --------------------------------------------------------------------------------------------------------------*/
+
+/* Makes a table of weights for a 2D kernel
+ Last Modified 2014/01/20 by Jamie Boyd */
+float* ConvolveMakeKernelTable (float * kernel, int kWidth, int kHeight){
+    int kRadH = (kHeight -1)/2;
+    int kRadW = (kWidth-1)/2;
+    int kSize = kWidth * kHeight;
+    // allocate memory for kernel table
+    float * kernelTablePtr =(float*) WMNewPtr (kSize * sizeof (float));
+    if (kernelTablePtr == NULL) return NULL;
+    int iConvo, convoEnd, convoToNextRow;
+    int kx, ky;
+    // get value for first point in kernel table
+    int iKT =0;
+     kernelTablePtr [iKT] = 0;
+    convoToNextRow=kRadW;
+    //yLoop
+    for (iConvo = kSize -1; iConvo >= (kSize/2); iConvo -= convoToNextRow){
+        // xLoop
+        for (convoEnd = iConvo - kRadW ; iConvo >= convoEnd; iConvo -=1){
+            kernelTablePtr [iKT]  += kernel [iConvo];
+        }
+    }
+    // get values for first column in kernelTable- adding a row to kernel each time
+    for (iKT =kWidth; iKT <  (kSize/2) + 1;  iKT +=kWidth, iConvo -= convoToNextRow){
+        kernelTablePtr [iKT] = kernelTablePtr [iKT -kWidth];
+        // convo X
+        for (convoEnd = iConvo - kRadW ; iConvo >= convoEnd; iConvo -=1){
+            kernelTablePtr [iKT] += kernel [iConvo];
+        }
+    }
+    // left edge bottom - removing a row from kernel each time
+    for (iConvo = kSize -1; iKT < kSize; iKT += kWidth, iConvo -= convoToNextRow){
+        kernelTablePtr [iKT] = kernelTablePtr [iKT -kWidth];
+        // convo X
+        for (convoEnd = iConvo - kRadW ; iConvo >= convoEnd; iConvo -=1){
+            kernelTablePtr [iKT] -= kernel [iConvo];
+        }
+    }
+    // Now do each row based on column 0 of that row
+    // top
+    for (ky =0, iKT =1; ky <= kRadH; ky +=1, iKT +=1){
+        // top left - adding a new column at left each time
+        for (kx =1; kx <= kRadW; kx +=1, iKT +=1){
+            kernelTablePtr [iKT] = kernelTablePtr [iKT - 1];
+            for (iConvo = (kRadH - ky)* kWidth + kRadW -kx; iConvo < kSize; iConvo += kWidth){
+                kernelTablePtr [iKT] += kernel [iConvo];
+            }
+        }
+        // top right - removing a column at right eadh time
+        for (kx-=1; kx > 0; kx -=1, iKT +=1){
+            kernelTablePtr [iKT] = kernelTablePtr [iKT - 1];
+            for (iConvo =(kRadH - ky)* kWidth + kRadW + kx ; iConvo < kSize; iConvo += kWidth){
+                kernelTablePtr [iKT] -= kernel [iConvo];
+            }
+        }
+    }
+    // bottom
+    for (ky -=1; ky > 0; ky -=1, iKT +=1){
+        // bottom left - adding a new column at left each time
+        for (kx =1; kx <= kRadW; kx +=1, iKT +=1){
+            kernelTablePtr [iKT] = kernelTablePtr [iKT - 1];
+            for (iConvo = kRadW -kx, convoEnd = (kRadH + ky) * kWidth ; iConvo < convoEnd; iConvo += kWidth){
+                kernelTablePtr [iKT] += kernel [iConvo];
+            }
+        }
+        // bottom right - removing a  column at right each time
+        for (kx -=1; kx > 0; kx -=1, iKT +=1){
+            kernelTablePtr [iKT] = kernelTablePtr [iKT - 1];
+            for (iConvo = kRadW + kx, convoEnd = (kRadH + ky) * kWidth; iConvo < convoEnd; iConvo += kWidth){
+                kernelTablePtr [iKT] -= kernel [iConvo];
+            }
+        }
+    }
+    return kernelTablePtr;
+}
+
+/* Function template to convolve a single row in an image.  Doesn't need to explicitly know image Y size/position within Y or
+ Kernel Y size. Just needs to know start-Y and end-Y position in the kernel. So the same function can be called for any Y
+ position in an image. Note that destWave is passed by reference
+ Last modified 2014/01/24 by Jamie Boyd */
+template <typename TI, typename TO> void ConvolveX (TI *srcWave, TO *&destWave, float *kernel, float *kernelTable, UInt16 nKernelX, UInt16 radKernelX, CountInt nWaveX, UInt16 endKernelY, UInt16 &startKernel, CountInt &startConvo, UInt16 &ikernelTable, UInt16 &toNextKernelX, CountInt &nConvoX, CountInt &toNextConvoX){
+    
+    CountInt iWaveX;
+    CountInt iConvo;
+    double outVal;
+    UInt16 iKernel;
+    UInt16 endKernelX;
+    
+    // X Loop for LEFT
+    for (iWaveX= 0; iWaveX < radKernelX; iWaveX+=1){
+        // Y Loop for Covolution
+        outVal = 0;
+        endKernelX = startKernel + nConvoX;
+        for (iKernel = startKernel, iConvo = startConvo; iKernel < endKernelY; iKernel += toNextKernelX, iConvo += toNextConvoX){
+            // X Loop for Convolution
+            for (; iKernel <  endKernelX; iKernel += 1, iConvo += 1)
+                outVal += srcWave [iConvo] * kernel [iKernel];
+            endKernelX += nKernelX;
+        } // end of Y loop for Convolution
+        // set output value
+        *destWave = outVal/kernelTable[ikernelTable];
+        // get ready for next pixel in this row of TOP LEFT
+        startKernel -= 1; // start convo 1  point earlier than for last pixel
+        nConvoX +=1; // one more convo point per row than for last pixel
+        toNextKernelX -=1;
+        toNextConvoX -=1;
+        ikernelTable += 1; // move tp next position in convo table
+        destWave +=1;
+    } // end of X loop for LEFT
+    // X Loop for CENTRE
+    for (; iWaveX < (nWaveX - radKernelX); iWaveX +=1){
+        outVal = 0;
+        endKernelX = startKernel + nConvoX;
+        for (iKernel = startKernel, iConvo = startConvo; iKernel < endKernelY; iKernel += toNextKernelX, iConvo += toNextConvoX){
+            // X Loop for Convolution
+            for (; iKernel < endKernelX; iKernel += 1, iConvo += 1)
+                outVal += srcWave [iConvo] * kernel [iKernel];
+            endKernelX += nKernelX;
+        } // end of Y loop for Convolution
+        // set output value
+        *destWave = outVal/kernelTable[ikernelTable];
+        // get ready for next pixel in this row
+        destWave +=1;
+        startConvo += 1;
+    }	// end of X loop for CENTRE
+    // X Loop for RIGHT
+    ikernelTable += 1; // move to next position in kernel table
+    for (; iWaveX < nWaveX; iWaveX +=1){
+        // get ready for next pixel in this row of TOP RIGHT
+        nConvoX -=1; // one less convo point per row than for last pixel
+        toNextKernelX +=1;
+        toNextConvoX +=1;
+        endKernelX = startKernel + nConvoX;
+        outVal = 0;
+        // Y loop for convolution
+        for (iKernel = startKernel, iConvo = startConvo; iKernel < endKernelY; iKernel += toNextKernelX, iConvo += toNextConvoX){
+            // X Loop for Convolution
+            for (; iKernel < endKernelX; iKernel += 1, iConvo += 1)
+                outVal += srcWave[iConvo] * kernel [iKernel];
+            endKernelX += nKernelX;
+        } // end of Y loop for Convo
+        // set output value
+        *destWave = outVal/kernelTable[ikernelTable];
+        destWave += 1;
+        startConvo += 1;
+        ikernelTable += 1; // move to next position in kernel table
+    } // End of X Loop for RIGHT
+}
+
+
+/* function template for convolving one wave with another and putting results in an output wave.
+ Input wave can be 2 or 3D, but each plane is done as a separate 2D image.
+ Last Modified 2014/01/24 by Jamie Boyd */
+template <typename TI, typename TO> void ConvolveT (TI* srcWave, TO* destWave, TO* frameBuffer, CountInt nWaveX, CountInt nWaveY, CountInt nWaveZ, float* kernel, float * kernelTable, UInt16 nKernelX, UInt16 nKernelY){
+    UInt16 radKernelX = (nKernelX - 1)/2; //radius of the kernel width, not including the central pixel
+    UInt16 radKernelY = (nKernelY - 1)/2; //radius of the kernel height, not including the central pixel
+    UInt16 nKernel = nKernelX * nKernelY;
+    CountInt fSize = (nWaveX * nWaveY);  //frame size
+    // iterating through kernel and kernel table
+    UInt16 ikernelTable; // position in kernelTable
+    UInt16 startKernel; // position of kernel at start of convolution of first pixel of the row
+    CountInt startFrameKernel = (radKernelY * nKernelX) + radKernelX;
+    UInt16 endKernelY; // end point in kernel (determined by starting position and number of rows
+    // Convolution variables
+    CountInt startConvo; // position in the src wave for the convolution for first pixel in the row to convolve)
+    CountInt toNextConvoX = nWaveX - radKernelX -1; // amount to add to iConvo to get to next row for convolution
+	UInt16 toNextKernelX= radKernelX; // amount to add to iKernel to get to next row of kernel
+	CountInt nConvoX = radKernelX + 1; // number of X to convolve at start of each line
+    // Pointers to Push
+    TI *srcFramePtr=srcWave; // will point to start of each frame in input image
+    TO *destPixPtr; // will point to each pixel in turn in output image
+    TI *srcEndPtr = srcWave + fSize * nWaveZ; // end of data to process
+    UInt8 inPlace = 0;
+    if ((TI*)destWave == (TI*)srcWave){
+		inPlace = 1;
+        destPixPtr = frameBuffer;
+    }else{
+        destPixPtr = destWave;
+    }
+	// Loop through all frames
+    CountInt iWaveY;
+    for (;srcFramePtr < srcEndPtr; srcFramePtr += fSize){
+        // Y Loop for TOP (first radKernelY rows)
+        ikernelTable = 0; // at start of frame, kernel table pos = 0
+        startKernel=startFrameKernel;
+        endKernelY=nKernel;
+        for (iWaveY= 0;  iWaveY < radKernelY; iWaveY+=1){
+            startConvo =0;
+            ConvolveX (srcFramePtr, destPixPtr, kernel, kernelTable, nKernelX, radKernelX, nWaveX, endKernelY, startKernel, startConvo, ikernelTable, toNextKernelX, nConvoX, toNextConvoX);
+            startKernel -= nKernelX -radKernelX;
+        }
+        // Y Loop for MIDDLE (up to nWaveY - radKernelY rows)
+        startConvo =0;
+        for (; iWaveY < (nWaveY - radKernelY); iWaveY +=1){
+            startKernel = radKernelX;
+            ConvolveX (srcFramePtr, destPixPtr, kernel, kernelTable, nKernelX, radKernelX, nWaveX, endKernelY, startKernel, startConvo, ikernelTable, toNextKernelX, nConvoX, toNextConvoX);
+            ikernelTable -= nKernelX;
+            startConvo += radKernelX;
+        }
+        // Loop for Y BOTTOM
+        ikernelTable += nKernelX;
+        for (;iWaveY < nWaveY;iWaveY +=1){
+            startKernel = radKernelX;
+            endKernelY -= nKernelX;
+            ConvolveX (srcFramePtr, destPixPtr, kernel, kernelTable, nKernelX, radKernelX, nWaveX, endKernelY, startKernel, startConvo, ikernelTable, toNextKernelX, nConvoX, toNextConvoX);
+            startConvo += radKernelX;
+        }
+        // if convolving in place copy buffer back on top of src wave  at end of frame
+        if (inPlace){
+            memcpy ((void*)srcFramePtr, (void*)frameBuffer, fSize * sizeof (TO));
+            destPixPtr = frameBuffer; // reset destination pixel to start of buffer
+        }
+    }
+}
+
+
+/* Each tile of frames to convolve, from startFrame up to endFrame, is done with this function
+ Last Modified 2026/10/16 */
+void ConvolveFramesTile (void* paramsPtr, CountInt startFrame, CountInt endFrame, UInt32 iSlot){
+	struct ConvolveFramesThreadParams* p;
+	p = (struct ConvolveFramesThreadParams*) paramsPtr;
+	CountInt tFrames = endFrame - startFrame; //frames in this tile
+    CountInt frameSize =p->xSize * p->ySize;
+    CountInt startPos = startFrame * frameSize; //change start position from frames to data points by multiplying by frame size
+    CountInt bufferOffset;
+    if ((char*) p->inPutDataPtr == (char*) p->outPutDataPtr){
+        bufferOffset = iSlot * frameSize;
+    }else{
+        bufferOffset = 0;
+    }
+	if (p->isFloat){
+		switch (p->inPutWaveType) {
+            case NT_I8:
+                ConvolveT ((char*)p->inPutDataPtr + startPos, (float*)p->outPutDataPtr + startPos, (float*)p->frameBufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kernelDataPtr, p->kernelTablePtr, p->kWidth, p->kHeight);
+                break;
+            case (NT_I8 | NT_UNSIGNED):
+                ConvolveT ((unsigned char*)p->inPutDataPtr + startPos, (float*)p->outPutDataPtr + startPos, (float*)p->frameBufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kernelDataPtr, p->kernelTablePtr, p->kWidth, p->kHeight);
+                break;
+            case NT_I16:
+                ConvolveT ((short*)p->inPutDataPtr + startPos, (float*)p->outPutDataPtr + startPos, (float*)p->frameBufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kernelDataPtr, p->kernelTablePtr, p->kWidth, p->kHeight);
+                break;
+            case (NT_I16 | NT_UNSIGNED):
+                ConvolveT ((unsigned short*)p->inPutDataPtr + startPos,(float*)p->outPutDataPtr + startPos, (float*)p->frameBufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kernelDataPtr, p->kernelTablePtr, p->kWidth, p->kHeight);
+                break;
+            case NT_I32:
+                ConvolveT ((SInt32*)p->inPutDataPtr + startPos,(float*)p->outPutDataPtr + startPos, (float*)p->frameBufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kernelDataPtr, p->kernelTablePtr, p->kWidth, p->kHeight);
+                break;
+            case (NT_I32| NT_UNSIGNED):
+                ConvolveT ((UInt32*)p->inPutDataPtr + startPos,(float*)p->outPutDataPtr + startPos, (float*)p->frameBufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kernelDataPtr, p->kernelTablePtr, p->kWidth, p->kHeight);
+                break;
+            case NT_FP32:
+                ConvolveT ((float*)p->inPutDataPtr + startPos,(float*)p->outPutDataPtr + startPos, (float*)p->frameBufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kernelDataPtr, p->kernelTablePtr, p->kWidth, p->kHeight);
+                break;
+            case NT_FP64:
+                ConvolveT ((double*)p->inPutDataPtr + startPos,(float*)p->outPutDataPtr + startPos, (float*)p->frameBufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kernelDataPtr, p->kernelTablePtr, p->kWidth, p->kHeight);
+                break;
+		}
+	}else {
+        switch (p->inPutWaveType) {
+            case NT_I8:
+                ConvolveT ((char*)p->inPutDataPtr + startPos,(char*)p->outPutDataPtr + startPos, (char*)p->frameBufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kernelDataPtr, p->kernelTablePtr,p-> kWidth, p->kHeight);
+                break;
+            case (NT_I8 | NT_UNSIGNED):
+                ConvolveT ((unsigned char*)p->inPutDataPtr + startPos,(unsigned char*)p->outPutDataPtr + startPos, (unsigned char*)p->frameBufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kernelDataPtr, p->kernelTablePtr, p->kWidth, p->kHeight);
+                break;
+            case NT_I16:
+                ConvolveT ((short*)p->inPutDataPtr + startPos,(short*)p->outPutDataPtr + startPos, (short*)p->frameBufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kernelDataPtr, p->kernelTablePtr, p->kWidth, p->kHeight);
+                break;
+            case (NT_I16 | NT_UNSIGNED):
+                ConvolveT ((unsigned short*)p->inPutDataPtr + startPos,(unsigned short*)p->outPutDataPtr + startPos, (unsigned short*)p->frameBufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kernelDataPtr, p->kernelTablePtr, p->kWidth, p->kHeight);
+                break;
+            case NT_I32:
+                ConvolveT ((SInt32*)p->inPutDataPtr + startPos,(SInt32*)p->outPutDataPtr + startPos, (SInt32*)p->frameBufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kernelDataPtr, p->kernelTablePtr, p->kWidth, p->kHeight);
+                break;
+            case (NT_I32| NT_UNSIGNED):
+                ConvolveT ((UInt32*)p->inPutDataPtr + startPos,(UInt32*)p->outPutDataPtr + startPos, (UInt32*)p->frameBufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kernelDataPtr, p->kernelTablePtr, p->kWidth, p->kHeight);
+                break;
+            case NT_FP32:
+                ConvolveT ((float*)p->inPutDataPtr + startPos,(float*)p->outPutDataPtr + startPos, (float*)p->frameBufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kernelDataPtr, p->kernelTablePtr, p->kWidth, p->kHeight);
+                break;
+            case NT_FP64:
+                ConvolveT ((double*)p->inPutDataPtr + startPos,(double*)p->outPutDataPtr + startPos, (double*)p->frameBufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kernelDataPtr, p->kernelTablePtr, p->kWidth, p->kHeight);
+                break;
+		}
+	}
+}
+
+/* -------------------------------- convolution with a symetrical 2D kernel ------------------------------------------
+ A symetrical 2D kernel applied as the same 1D kernel done first in X and then in Y. Each frame is done as 2D plane
+ ------------------------------------------------------------------------------------------------------------------- */
+ 
+/* Makes and returns a table of weights for a 1D kernel, first Checking that the kernel is, indeed, symetrical
+ returns a null pointer if kernel is not symetrical
+ Last Modified 2014/01/21 by Jamie Boyd */
+float * SymConvolveMakeKernelTable (float * kernel, UInt16 kWidth){
+    // kernel has to be odd
+    if((kWidth % 2) == 0) return NIL;
+    // check symetry
+    // Get sum of entire kernel for making kernel table while we are at it
+    UInt16 kRadW = (kWidth-1)/2; // radius of kernel, not counting central point
+    UInt16 iKT, iConvo;
+    float kSum=0;
+    for (iKT =0, iConvo = kWidth -1; iKT < kRadW; iKT +=1, iConvo -=1){
+        if (kernel [iKT] != kernel [iConvo]) return NIL;
+        kSum += kernel [iKT] + kernel [iConvo];
+    }
+    // If we get to here, kernel is symetrical. Sum of kernel lacks central point
+    kSum += kernel [kRadW];
+    // make kernel table. It's symetrical, so we only need to make size kRadW + 1
+    float *kernelTable =(float*) WMNewPtr ((kRadW + 1) * sizeof (float));
+    if (kernelTable == NIL) return NIL;
+    // last point = kernel sum
+    kernelTable [kRadW] = kSum;
+    // each earlier point removes a value from left side
+    iKT = kRadW-1;
+    for (iConvo = 0; iKT >0; iKT -=1, iConvo +=1)
+        kernelTable [iKT] = kernelTable [iKT + 1] - kernel [iConvo];
+    kernelTable [iKT] = kernelTable [iKT + 1] - kernel [iConvo];
+    return kernelTable;
+}
+
+
+/* template function for convolving one wave with a 1D symetrical kernel (e.g., Guassian) and putting results in an output wave.
+ Input wave can be 2 or 3D, but each plane is done as a separate 2D image.
+ Last Modified 2014/01/21 by Jamie Boyd */
+template <typename TI, typename TO> void SymConvolveT (TI* srcWave, TO* destWave, TO* buffer, CountInt nWaveX, CountInt nWaveY, CountInt nWaveZ, float* kernel, float * kernelTable, UInt16 kWidth){
+    CountInt frameSize = nWaveX * nWaveY;
+    //variables for iterating through waves
+    UInt16 kRad = (kWidth-1)/2; // radius of kernel, not including the central point
+    //CountInt nWave = frameSize * nWaveZ;
+    //Position of pixel in x,y,z
+    CountInt iWaveY,  iWaveX;
+    //CountInt nEdgeY = kRad * nWaveX;
+    // iterating through kernel and convo positions, linear
+    CountInt iKernel, iConvo, iKernelTable=0, convoStart, kernelStart, kernelEnd;
+    // temporary value to calculate value for each pixel
+    double outVal;
+    CountInt iOut; // position of output value, in buffer, then in output wave
+    TI* srcFramePtr = srcWave;
+    TI* srcEndPtr = srcWave + frameSize * nWaveZ;
+    TO* destFramePtr = destWave;
+    for (; srcFramePtr < srcEndPtr; srcFramePtr += frameSize, destFramePtr += frameSize){
+        // Do Y filtering first, sending output to frame buffer. each Y starts at startFrameP + iWaveX
+        for (iWaveX =0; iWaveX < nWaveX; iWaveX +=1){
+            // TOP of each row.
+            iOut = iWaveX;
+            convoStart = iWaveX;
+            kernelStart = kRad;
+            kernelEnd = kWidth;
+            for (iWaveY=0; iWaveY < kRad; iWaveY += 1){
+                // convolution in Y
+                outVal =0;
+                for (iKernel =kernelStart, iConvo =convoStart; iKernel < kernelEnd; iKernel +=1, iConvo += nWaveX)
+                    outVal += srcFramePtr [iConvo] * kernel [iKernel];
+                buffer [iOut] = outVal / kernelTable [iKernelTable];
+                kernelStart -=1;
+                iKernelTable +=1;
+                iOut += nWaveX;
+            }
+            // Middle of each row
+            for (; iWaveY < (nWaveY - kRad); iWaveY += 1){
+                outVal =0;
+                // convolution in Y
+                for (iKernel =kernelStart, iConvo =convoStart; iKernel < kernelEnd; iKernel +=1, iConvo += nWaveX)
+                    outVal += srcFramePtr [iConvo] * kernel [iKernel];
+                buffer [iOut] = outVal / kernelTable [iKernelTable];
+                convoStart += nWaveX;
+                iOut += nWaveX;
+            }
+            // bottom of each row
+            for (; iWaveY < nWaveY; iWaveY += 1){
+                kernelEnd -=1;
+                iKernelTable -=1;
+                // convolution in Y
+                outVal =0;
+                for (iKernel =kernelStart, iConvo =convoStart; iKernel < kernelEnd; iKernel +=1, iConvo += nWaveX)
+                    outVal += srcFramePtr [iConvo] * kernel [iKernel];
+                buffer [iOut] = outVal / kernelTable [iKernelTable];
+                convoStart += nWaveX;
+                iOut += nWaveX;
+            }
+        }
+        // Do X filtering second, sending output to output wave.
+        iOut =0;
+        convoStart = 0;
+        for (iWaveY=0; iWaveY < nWaveY; iWaveY +=1){
+            kernelStart = kRad;
+            kernelEnd = kWidth;
+            // left edge
+            for (iWaveX =0; iWaveX < kRad; iWaveX +=1){
+                // convolution in X
+                outVal =0;
+                for (iKernel =kernelStart, iConvo =convoStart; iKernel < kernelEnd; iKernel +=1, iConvo += 1)
+                    outVal += buffer [iConvo] * kernel [iKernel];
+                destFramePtr [iOut] = outVal / kernelTable [iKernelTable];
+                kernelStart -=1;
+                iKernelTable +=1;
+                iOut += 1;
+            }
+            // Middle
+            for (; iWaveX < (nWaveX - kRad); iWaveX+= 1){
+                outVal =0;
+                // convolution in X
+                for (iKernel =kernelStart, iConvo =convoStart; iKernel < kernelEnd; iKernel +=1, iConvo += 1)
+                    outVal += buffer [iConvo] * kernel [iKernel];
+                destFramePtr [iOut] = outVal / kernelTable [iKernelTable];
+                convoStart += 1;
+                iOut += 1;
+            }
+            // right edge
+            for (; iWaveX< nWaveX; iWaveX += 1){
+                kernelEnd -=1;
+                iKernelTable -=1;
+                // convolution in X
+                outVal =0;
+                for (iKernel =kernelStart, iConvo =convoStart; iKernel < kernelEnd; iKernel +=1, iConvo += 1)
+                    outVal += buffer [iConvo] * kernel [iKernel];
+                destFramePtr [iOut] = outVal/ kernelTable [iKernelTable];
+                convoStart += 1;
+                iOut += 1;
+            }
+            convoStart += kRad; // get to next row for x filtering
+        }
+    }
+}
+
+/* Each tile of frames to symetrically convolve, from startFrame up to endFrame, is done with this function
+ Last Modified 2026/10/16 */
+void SymConvolveFramesTile (void* paramsPtr, CountInt startFrame, CountInt endFrame, UInt32 iSlot){
+    struct ConvolveFramesThreadParams* p;
+    p = (struct ConvolveFramesThreadParams*) paramsPtr;
+    CountInt tFrames = endFrame - startFrame; //frames in this tile
+    CountInt startPos = startFrame * (p->xSize * p->ySize); //change start position from frames to data points by multiplying by frame size
+    CountInt bufferOffset =iSlot * p->xSize * p->ySize;
+    if (p->isFloat){
+        switch (p->inPutWaveType) {
+            case NT_I8:
+                SymConvolveT ((char*)p->inPutDataPtr + startPos,(float*)p->outPutDataPtr + startPos, (float*)p->frameBufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kernelDataPtr, p->kernelTablePtr, p-> kWidth);
+                break;
+            case (NT_I8 | NT_UNSIGNED):
+                SymConvolveT ((unsigned char*)p->inPutDataPtr + startPos,(float*)p->outPutDataPtr + startPos, (float*)p->frameBufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kernelDataPtr, p->kernelTablePtr, p-> kWidth);
+                break;
+            case NT_I16:
+                SymConvolveT ((short*)p->inPutDataPtr + startPos,(float*)p->outPutDataPtr + startPos, (float*)p->frameBufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kernelDataPtr, p->kernelTablePtr, p-> kWidth);
+                break;
+            case (NT_I16 | NT_UNSIGNED):
+                SymConvolveT ((unsigned short*)p->inPutDataPtr + startPos,(float*)p->outPutDataPtr + startPos, (float*)p->frameBufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kernelDataPtr, p->kernelTablePtr, p-> kWidth);
+                break;
+            case NT_I32:
+                SymConvolveT ((SInt32*)p->inPutDataPtr + startPos,(float*)p->outPutDataPtr + startPos, (float*)p->frameBufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kernelDataPtr, p->kernelTablePtr, p-> kWidth);
+                break;
+            case (NT_I32| NT_UNSIGNED):
+                SymConvolveT ((UInt32*)p->inPutDataPtr + startPos,(float*)p->outPutDataPtr + startPos, (float*)p->frameBufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kernelDataPtr, p->kernelTablePtr, p-> kWidth);
+                break;
+            case NT_FP32:
+                SymConvolveT ((float*)p->inPutDataPtr + startPos,(float*)p->outPutDataPtr + startPos, (float*)p->frameBufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kernelDataPtr, p->kernelTablePtr, p-> kWidth);
+                break;
+            case NT_FP64:
+                SymConvolveT ((double*)p->inPutDataPtr + startPos,(float*)p->outPutDataPtr + startPos, (float*)p->frameBufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kernelDataPtr, p->kernelTablePtr, p-> kWidth);
+                break;
+        }
+    }else {
+        switch (p->inPutWaveType) {
+            case NT_I8:
+                SymConvolveT ((char*)p->inPutDataPtr + startPos,(char*)p->outPutDataPtr + startPos, (char*)p->frameBufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kernelDataPtr, p->kernelTablePtr, p-> kWidth);
+                break;
+            case (NT_I8 | NT_UNSIGNED):
+                SymConvolveT ((unsigned char*)p->inPutDataPtr + startPos,(unsigned char*)p->outPutDataPtr + startPos, (unsigned char*)p->frameBufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kernelDataPtr, p->kernelTablePtr, p-> kWidth);
+                break;
+            case NT_I16:
+                SymConvolveT ((short*)p->inPutDataPtr + startPos,(short*)p->outPutDataPtr + startPos,  (short*)p->frameBufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kernelDataPtr, p->kernelTablePtr, p-> kWidth);
+                break;
+            case (NT_I16 | NT_UNSIGNED):
+                SymConvolveT ((unsigned short*)p->inPutDataPtr + startPos,(unsigned short*)p->outPutDataPtr + startPos, (unsigned short*)p->frameBufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kernelDataPtr, p->kernelTablePtr, p-> kWidth);
+                break;
+            case NT_I32:
+                SymConvolveT ((SInt32*)p->inPutDataPtr + startPos,(SInt32*)p->outPutDataPtr + startPos, (SInt32*)p->frameBufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kernelDataPtr, p->kernelTablePtr, p-> kWidth);
+                break;
+            case (NT_I32| NT_UNSIGNED):
+                SymConvolveT ((UInt32*)p->inPutDataPtr + startPos,(UInt32*)p->outPutDataPtr + startPos, (UInt32*)p->frameBufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kernelDataPtr, p->kernelTablePtr, p-> kWidth);
+                break;
+            case NT_FP32:
+                SymConvolveT ((float*)p->inPutDataPtr + startPos,(float*)p->outPutDataPtr + startPos, (float*)p->frameBufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kernelDataPtr, p->kernelTablePtr, p-> kWidth);
+                break;
+            case NT_FP64:
+                SymConvolveT ((double*)p->inPutDataPtr + startPos,(double*)p->outPutDataPtr + startPos, (double*)p->frameBufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kernelDataPtr, p->kernelTablePtr, p-> kWidth);
+                break;
+        }
+    }
+}
+
+/* -------------------------------------- MedianFrames-------------------------------------------------------
+ Applies a median filter to a 2D or 3D wave, treating each plane as a separate 2D image
+ Does multiple frames in a single 3D wave
+ -------------------------------------------------------------------------------------------------------------*/
+
+ /* template for applying a median filter and putting the results in an output wave.
+  Input wave can be 2 or 3D, but each plane is done as a separate 2D image.
+ Last Modified 2025/06/24 by Jamie Boyd */
+template <typename TI> void MedianFramesT (TI* srcWave, TI* destWave, TI* bufferStartPtr, CountInt xSize, CountInt ySize, CountInt zSize, UInt16 kWidth){
+    CountInt fSize = (xSize * ySize);  //frame size
+    CountInt bufferSize =(fSize *  sizeof (TI));
+    UInt32 kSize = (kWidth * kWidth); // number of pixels in the kernel
+    TI* kernelCopyStart; // pointer to start of the buffer to store copied data to be medianed in a destructive fashion
+    UInt32  kBufferSize = (kSize *  sizeof (TI));
+    UInt32 kRadW = (kWidth - 1)/2; //radius of the kernel width, including the central pixel
+    UInt8 isOverWriting = 0; // will be set to 1 if overwriting existing wave
+    TI* inPutPtr; // Center pixel input pixel. Offsets to kernel input are calculated relative to this. Value progresses monotonically through wave
+    TI* convoPtr; // pointer to pixel of the image used when copying data
+    TI* outPutPtr; // output pixel to get the calculated median value. Value progresses monotonically through the wave
+    TI* kPtr;  // pointer to iterate through the copied data
+    CountInt kX, kY, kXend, kYend; // variables for iterating through pieces of kernel
+    CountInt wToNextRow; //amount to add to wToFirstRow to get to next row in input wave when iterating through a kernel
+    CountInt wX, wY, wZ, wXend, wYend; // to keep track of progress through X and Y in input wave
+    // overwriting source if dest == src
+    if ((TI*)destWave == (TI*)srcWave){
+        isOverWriting = 1;
+    }
+    // Make a buffer big enough to hold a "kernel's worth" of pixels - allocate in thread because it is too small to fail
+    kernelCopyStart = (TI*) WMNewPtr (kBufferSize);
+    // Loop through all frames
+    for (wZ=0, outPutPtr = destWave, inPutPtr =srcWave; wZ < zSize; wZ++){
+        if (isOverWriting){  // copy next frame to buffer and position input pointer at start of buffer
+            memcpy ((void*) bufferStartPtr, (void*) outPutPtr, bufferSize);
+            inPutPtr = (TI*) bufferStartPtr;
+        } // If not copying to a buffer, inputPtr will be left in correct position at end of Z loop
+        // Loop for TOP
+        for (wY = 0; wY < kRadW; wY++){
+            // loop for TOP LEFT
+            for (wX =0; wX < kRadW; wX++, inPutPtr++, outPutPtr++){
+                convoPtr = inPutPtr - (wY  * xSize) - wX;
+                wToNextRow =  (UInt32)(xSize - kRadW - wX - 1);
+                kPtr = kernelCopyStart;
+                // loop through kernel at each location
+                for (kY = kRadW - wY; kY < kWidth; kY++ , convoPtr +=wToNextRow){
+                    for (kX = kRadW - wX; kX < kWidth; kX++, kPtr++, convoPtr++) *kPtr = *convoPtr;
+                }
+                *outPutPtr = medianT ((CountInt)(kPtr - kernelCopyStart), kernelCopyStart);
+            } // End of Loop for TOP LEFT
+            // Loop for TOP CENTER
+            for (wXend =(xSize - kRadW); wX < wXend; wX++, inPutPtr++, outPutPtr++){
+                // loop through kernel at each location
+                convoPtr = inPutPtr - (wY  * xSize) - kRadW;
+                wToNextRow = xSize - kWidth;
+                kPtr = kernelCopyStart;
+                for (kY = kRadW - wY; kY < kWidth; kY++, convoPtr += wToNextRow){
+                    for (kX =0; kX < kWidth; kX++, kPtr++, convoPtr++) *kPtr = *convoPtr;
+                }
+                *outPutPtr = medianT ((CountInt)(kPtr - kernelCopyStart), kernelCopyStart);
+            } // End of Loop for TOP CENTER
+            // Loop for TOP RIGHT
+            for (;wX < xSize; wX++, inPutPtr++, outPutPtr++){
+                // loop through kernel at each location
+                convoPtr =  inPutPtr - (wY  * xSize) - kRadW;
+                wToNextRow = xSize - kRadW - (xSize - wX);
+                kPtr = kernelCopyStart;
+                for (kY = kRadW - wY; kY < kWidth; kY++, convoPtr += wToNextRow){
+                    for (kX =0, kXend = kRadW + (xSize - wX); kX < kXend; kX++, kPtr++, convoPtr++) *kPtr = *convoPtr;
+                }
+                *outPutPtr = medianT ((CountInt)(kPtr - kernelCopyStart), kernelCopyStart);
+            } // End of Loop for TOP RIGHT
+        } // End of Loop for TOP
+        // Loop for MIDDLE
+        for (wYend =(ySize - kRadW) ; wY < wYend ; wY++){
+            // Loop for MIDDLE LEFT
+            for (wX =0; wX < kRadW; wX++, inPutPtr++, outPutPtr++){
+                convoPtr = inPutPtr - (kRadW  * xSize) - wX;
+                wToNextRow =  xSize - kRadW - wX - 1;
+                kPtr = kernelCopyStart;
+                // loop through kernel at each location
+                for (kY = 0; kY < kWidth; kY++, convoPtr +=wToNextRow){
+                    for (kX = kRadW - wX; kX < kWidth; kX++, kPtr++, convoPtr++) *kPtr = *convoPtr;
+                }
+                *outPutPtr = medianT ((CountInt)(kPtr - kernelCopyStart), kernelCopyStart);
+            } // End of Loop for MIDDLE LEFT
+            // Loop for MIDDLE CENTER
+            for (wXend = (xSize - kRadW); wX < wXend ; wX++, inPutPtr++, outPutPtr++){
+                convoPtr = inPutPtr - (kRadW  * xSize) - kRadW;
+                wToNextRow = xSize - kWidth;
+                kPtr = kernelCopyStart;
+                // loop through kernel at each location
+                for (kY = 0; kY < kWidth; kY++, convoPtr += wToNextRow){
+                    for (kX =0; kX < kWidth; kX++, kPtr++, convoPtr++) *kPtr = *convoPtr;
+                }
+                *outPutPtr = medianT ((CountInt)(kPtr - kernelCopyStart), kernelCopyStart);
+            } // End of Loop for MIDDLE CENTER
+            // Loop for MIDDLE RIGHT
+            for (;wX < xSize; wX++, inPutPtr++, outPutPtr++){
+                // loop through kernel at each location
+                convoPtr =  inPutPtr - (kRadW  * xSize) - kRadW;
+                wToNextRow = xSize - kRadW - (xSize - wX);
+                kPtr = kernelCopyStart;
+                for (kY = 0; kY < kWidth; kY++, convoPtr += wToNextRow){
+                    for (kX = 0, kXend = kRadW + (xSize - wX); kX < kXend; kX++, kPtr++, convoPtr++) *kPtr = *convoPtr;
+                }
+                *outPutPtr = medianT ((CountInt)(kPtr - kernelCopyStart), kernelCopyStart);
+            } // End of Loop for MIDDLE RIGHT
+        } // End of Loop for MIDDLE
+        // Loop for BOTTOM
+        for (; wY < ySize; wY++){
+            // Loop for BOTTOM LEFT
+            for (wX = 0; wX < kRadW; wX ++, inPutPtr++, outPutPtr++){
+                // Loop through kernel at each location
+                convoPtr = inPutPtr - (kRadW  * xSize) - wX;
+                wToNextRow =  xSize - kRadW - wX - 1;
+                kPtr = kernelCopyStart;
+                for (kY = 0, kYend = kRadW + (ySize - wY); kY < kYend; kY++, convoPtr += wToNextRow){
+                    for (kX =kRadW - wX; kX < kWidth; kX++, kPtr++, convoPtr++) *kPtr = *convoPtr;
+                }
+                *outPutPtr = medianT ((CountInt)(kPtr - kernelCopyStart), kernelCopyStart);
+            } // End ofLoop for BOTTOM LEFT
+            // Loop for BOTTOM CENTER
+            for (; wX < (xSize - kRadW); wX++, inPutPtr++, outPutPtr++){
+                // Loop through kernel at each location
+                convoPtr = inPutPtr - (kRadW  * xSize) - kRadW;
+                wToNextRow = xSize - kWidth;
+                kPtr = kernelCopyStart;
+                for (kY = 0, kYend = kRadW + (ySize - wY) ; kY < kYend; kY++, convoPtr += wToNextRow){
+                    for (kX =0; kX < kWidth; kX++, convoPtr++, kPtr++) *kPtr = *convoPtr;
+                }
+                *outPutPtr = medianT ((CountInt)(kPtr - kernelCopyStart), kernelCopyStart);
+            } // End of Loop for BOTTOM CENTER
+            // Loop for BOTTOM RIGHT
+            for (; wX < xSize; wX++, inPutPtr++, outPutPtr++){
+                //Loop through kernel at each location
+                convoPtr =  inPutPtr - (kRadW * xSize) - kRadW;
+                wToNextRow = xSize - kRadW - (xSize - wX);
+                kPtr = kernelCopyStart;
+                for (kYend = kRadW + (ySize - wY), kY =0; kY < kYend; kY++, convoPtr += wToNextRow){
+                    for (kX =0, kXend = kRadW + (xSize -wX); kX < kXend; kX++, convoPtr++, kPtr++) *kPtr = *convoPtr;
+                }
+                *outPutPtr = medianT ((CountInt)(kPtr - kernelCopyStart), kernelCopyStart);
+            } // End of Loop for BOTTOM RIGHT
+        } // End of Loop for BOTTOM
+    } // End of Loop for Each Frame
+    if (kernelCopyStart != nullptr) WMDisposePtr ((Ptr)kernelCopyStart);
+}
+
+/* Each tile of frames to median filter, from startFrame up to endFrame, is done with this function
+ Last Modified 2026/10/16 */
+void MedianFramesTile (void* paramsPtr, CountInt startFrame, CountInt endFrame, UInt32 iSlot){
+    struct MedianFramesThreadParams* p;
+    p = (struct MedianFramesThreadParams*) paramsPtr;
+    CountInt tFrames = endFrame - startFrame; //frames in this tile
+    CountInt frameSize = p->xSize * p->ySize;
+    CountInt startPos = startFrame * frameSize; //change start position from frames to data points by multiplying by frame size
+    // call the right template function for the wave types
+    CountInt bufferOffset = 0;
+    if (p->inPutDataStartPtr == p->outPutDataStartPtr )
+        bufferOffset= frameSize * iSlot;
+    switch (p->inPutWaveType) {
+        case NT_I8:
+            MedianFramesT ((char*)p->inPutDataStartPtr + startPos, (char*)p->outPutDataStartPtr + startPos, (char*)p->bufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kWidth);
+            break;
+        case (NT_I8 | NT_UNSIGNED):
+            MedianFramesT ((unsigned char*)p->inPutDataStartPtr + startPos,(unsigned char*)p->outPutDataStartPtr + startPos, (unsigned char*)p->bufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kWidth);
+            break;
+        case NT_I16:
+            MedianFramesT ((short*)p->inPutDataStartPtr + startPos,(short*)p->outPutDataStartPtr + startPos, (short*)p->bufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kWidth);
+            break;
+        case (NT_I16 | NT_UNSIGNED):
+            MedianFramesT ((unsigned short*)p->inPutDataStartPtr + startPos,(unsigned short*)p->outPutDataStartPtr + startPos, (unsigned short*)p->bufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kWidth);
+            break;
+        case NT_I32:
+            MedianFramesT ((SInt32*)p->inPutDataStartPtr + startPos,(SInt32*)p->outPutDataStartPtr + startPos, (SInt32*)p->bufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kWidth);
+            break;
+        case (NT_I32| NT_UNSIGNED):
+            MedianFramesT ((UInt32*)p->inPutDataStartPtr + startPos,(UInt32*)p->outPutDataStartPtr + startPos, (UInt32*)p->bufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kWidth);
+            break;
+        case NT_FP32:
+            MedianFramesT ((float*)p->inPutDataStartPtr + startPos,(float*)p->outPutDataStartPtr + startPos, (float*)p->bufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kWidth);
+            break;
+        case NT_FP64:
+            MedianFramesT ((double*)p->inPutDataStartPtr + startPos,(double*)p->outPutDataStartPtr + startPos, (double*)p->bufferPtr + bufferOffset, p->xSize, p->ySize, tFrames, p->kWidth);
+            break;
+    }
+}
+
@@ -1,143 +1,10 @@
 #include "twoPhoton.h"
 /* ---------------------------------------------Kalman----------------------------------------------------------
- Code for Kalman averaging of frames in a 3d wave, 2d wave, or a list of waves
- Last Modified 2025/06/23 by Jamie Boyd
+ Code for Kalman averaging of frames in a 3d wave, 2d wave, or a list of waves. The templates and tile functions
+ are in KalmanKernels.cpp
+ Last Modified 2026/10/16
  ---------------------------------------------------------------------------------------------------------------*/
 
-/* The following template is used to handle any one of the 8 types of wave data, for any of the three Kalman averaging functions
- for 3D waves
- Last modified 2014/01/28 by Jamie Boyd */
-template <typename T> int KalmanT(T *srcWaveStart, T *destWaveStart, CountInt pixPerThread, CountInt pixToNextFrame, CountInt numLayers, float multiplier) {
-	T* destWaveEnd = destWaveStart + pixPerThread;	// End of the output layer we are putting the average into
-	T* srcWave, *destWave;	// pointers used to iterate through source wave and destination wave
-	/* If multiplier is < 1, use standard averaging across layers with a floating point temporary value */
-	if (multiplier < 1){
-		double tempVal;
-		CountInt pixPerLayer = pixPerThread + pixToNextFrame;
-		T* srcWaveEnd = srcWaveStart + (numLayers * pixPerLayer);
-		CountInt toNextSrcPix = (numLayers * pixPerLayer) - 1;
-		for (srcWave = srcWaveStart, destWave = destWaveStart ; destWave < destWaveEnd ; srcWave -= toNextSrcPix, destWave ++){			for (tempVal =0; srcWave < srcWaveEnd; srcWave += pixPerLayer)
-			tempVal += *srcWave;
-            *destWave = tempVal/numLayers;
-		}
-	}else{
-		CountInt layer; // used to iterate through layers
-		// Special stuff for first frame
-		if (srcWaveStart == destWaveStart){	//this happens when collapsing a wave into the first frame
-			if (multiplier > 1){
-				//Multiply the first layer by Multiplier
-				for (destWave = destWaveStart; destWave < destWaveEnd; destWave++){
-					*destWave *= multiplier;
-				}
-			}
-			// position src wave pointer at start of 2nd frame
-			srcWave = srcWaveStart + pixPerThread + pixToNextFrame;
-		}else{ //srcwave and dsetwave are different
-			if (multiplier > 1){ // To increase precision in averaging in special instances where, for example, 16 bit waves contain less than 16 bits of data
-				// Set output layer = first layer of input wave * Multiplier
-				for (destWave = destWaveStart, srcWave = srcWaveStart; destWave < destWaveEnd; destWave++, srcWave++){
-					*destWave = *srcWave * multiplier;
-				}
-			}else{ // first frame when No Multiplier, and Src and dest are different
-				for (destWave = destWaveStart, srcWave = srcWaveStart; destWave < destWaveEnd; destWave++, srcWave++){
-					*destWave = *srcWave;
-				}
-			}
-			// advance src wave pointer to start of next frame
-			srcWave += pixToNextFrame;
-		}
-		//For each remaining layer in input wave, iterate through, averaging the input value into the output layer
-		if (multiplier > 1){
-			for(layer=1; layer < numLayers; layer++, srcWave += pixToNextFrame) {
-				for (destWave = destWaveStart; destWave < destWaveEnd; destWave++, srcWave++){
-					*destWave = ((*destWave * layer) + *srcWave * multiplier)/(layer + 1);
-				}
-			}
-			// Divide output layer by Multiplier
-			for (destWave = destWaveStart;destWave < destWaveEnd; destWave++){
-				*destWave /= multiplier;
-			}
-		}else{ // no multiplier
-			for(layer=1; layer < numLayers; layer++, srcWave += pixToNextFrame) {
-				for (destWave = destWaveStart; destWave < destWaveEnd; destWave++, srcWave++){
-					*destWave = ((*destWave * layer) + *srcWave)/(layer + 1);
-				}
-			}
-		}
-	}
-	return 0;
-}
-
-
-/* Structure to pass data to each KalmanThread
- Last Modified Feb 21 2010 by Jamie Boyd */
-typedef struct KalmanThreadParams{
-    int inPutWaveType;
-    char* inPutDataStartPtr;
-    char* outPutDataStartPtr;
-    CountInt startLayer;
-    CountInt outPutLayer;
-    CountInt xSize;
-    CountInt ySize;
-    CountInt zSize;
-    float multiplier;
-    UInt8 ti; // number of this thread, starting from 0
-    UInt8 tN; // total number of threads
-} KalmanThreadParams, *KalmanThreadParamsPtr;
-
-
-/* Each thread to do Kalman averaging starts with this function
- Last Modified 2013/07/16 by Jamie Boyd */
-void* KalmanThread (void* threadarg){
-	struct KalmanThreadParams* p;
-	p = (struct KalmanThreadParams*) threadarg;
-	CountInt xSize= p->xSize;
-	CountInt ySize = p->ySize;
-	CountInt zSize = p->zSize;
-	CountInt startLayer = p->startLayer;
-	CountInt outPutLayer = p->outPutLayer;
-	float multiplier = p->multiplier;
-	UInt8 ti = p->ti;
-	UInt8 tN = p->tN;
-	CountInt frameSize = ySize * xSize;
-	CountInt pixPerThread = frameSize/tN;
-	CountInt startPos = ti * pixPerThread; // which pixel to start this thread on depends on thread number * points per thread. ti is 0 based
-	if (ti == (tN - 1)) pixPerThread += (frameSize % tN); // last thread gets any extra pixels
-	CountInt pixToNextFrame = frameSize - pixPerThread;
-	int result;
-	switch (p->inPutWaveType) {
-	case NT_I8:
-		result = KalmanT ((char*)p->inPutDataStartPtr + (startLayer * frameSize) + startPos, (char*)p->outPutDataStartPtr + (outPutLayer * frameSize) + startPos, pixPerThread, pixToNextFrame, zSize, multiplier);
-		break;
-	case (NT_I8 | NT_UNSIGNED):
-		result = KalmanT ((unsigned char*)p->inPutDataStartPtr + (startLayer * frameSize) + startPos, (unsigned char*)p->outPutDataStartPtr + (outPutLayer * frameSize) + startPos, pixPerThread, pixToNextFrame, zSize, multiplier);
-		break;
-	case NT_I16:
-		result = KalmanT ((short*)p->inPutDataStartPtr + (startLayer * frameSize) + startPos, (short*) p->outPutDataStartPtr + (outPutLayer * frameSize) + startPos, pixPerThread, pixToNextFrame, zSize, multiplier);
-		break;
-	case (NT_I16 | NT_UNSIGNED):
-		result = KalmanT ((unsigned short*)p->inPutDataStartPtr + (startLayer * frameSize) + startPos, (unsigned short*) p->outPutDataStartPtr + (outPutLayer * frameSize) + startPos, pixPerThread, pixToNextFrame, zSize, multiplier);
-		break;
-	case NT_I32:
-		result = KalmanT ((long*)p->inPutDataStartPtr + (startLayer * frameSize) + startPos, (long*) p->outPutDataStartPtr + (outPutLayer * frameSize) + startPos, pixPerThread, pixToNextFrame, zSize, multiplier);
-		break;
-	case (NT_I32| NT_UNSIGNED):
-		result = KalmanT ((unsigned long*)p->inPutDataStartPtr + (startLayer * frameSize)+ startPos, (unsigned long*) p->outPutDataStartPtr + (outPutLayer * frameSize) + startPos, pixPerThread, pixToNextFrame, zSize, multiplier);
-		break;
-	case NT_FP32:
-		result = KalmanT ((float*)p->inPutDataStartPtr + (startLayer * frameSize) + startPos, (float*) p->outPutDataStartPtr + (outPutLayer * frameSize) + startPos, pixPerThread, pixToNextFrame, zSize, multiplier);
-		break;
-	case NT_FP64:
-		result = KalmanT ((double*)p->inPutDataStartPtr + (startLayer * frameSize) + startPos, (double*) p->outPutDataStartPtr + (outPutLayer * frameSize) + startPos, pixPerThread, pixToNextFrame, zSize, multiplier);
-		break;
-	default:	// Unknown data type - possible in a future version of Igor.
-		result= NT_FNOT_AVAIL;
-		break;
-	}
-	if (result != 0) throw result;
-    return 0;
-}
-
 /* KalmanAllFrames XOP entry function
  Does Kalman averaging across all layers in a 3D wave and places results in a new 2D wave
  KalmanAllFramesParams
@@ -146,8 +13,10 @@ void* KalmanThread (void* threadarg){
  double multiplier      Multiplier for,e.g., 16 bit waves containing less than 16 bits of data
  double overWrite       0 to give errors when wave already exists. non-zero to overwrite existing wave without warning.
  result                 0 for success, error code for failure
-Last Modified 2015/06/18 by Jamie Boyd  */
-extern "C" int KalmanAllFrames(KalmanAllFramesParamsPtr p) {
+ exact is 0 for KalmanAllFrames, for a running average, as done one layer at a time, and 1 for KalmanAllFramesExact,
+ to sum all the layers and divide once, rounding to nearest, so integer waves are averaged exactly
+Last Modified 2026/10/16  */
+static int KalmanAllFramesDo (KalmanAllFramesParamsPtr p, UInt8 exact) {
 	int result = 0;	// The error returned from various Wavemetrics functions
 	waveHndl inPutWaveH = NULL, outPutWaveH = NULL;	// Handles to the input and output waves
     int inPutWaveType;	// Wavemetrics numeric code for data type of wave
@@ -163,9 +32,9 @@ extern "C" int KalmanAllFrames(KalmanAllFramesParamsPtr p) {
 	char *inPutDataStartPtr, *outPutDataStartPtr;
 	float multiplier = (float)(p->multiplier);	// multiplier for integer waves containing less than their full range of data
 	CountInt zSize;
-	UInt8 iThread, nThreads;
-    KalmanThreadParamsPtr paramArrayPtr = NULL;
-    pthread_t* threadsPtr = NULL;
+    KalmanThreadParams params;  // paramaters for the tiles
+    XFuncTimer timer;  // times each phase of this call, for TwoPhotonStats
+    XFuncTimerStart (&timer, exact ? STATS_KALMANALLFRAMESEXACT : STATS_KALMANALLFRAMES);
     try {
 		// Get handle to input wave.
 		inPutWaveH = p ->inPutWaveH;
@@ -205,7 +74,9 @@ extern "C" int KalmanAllFrames(KalmanAllFramesParamsPtr p) {
 				inPutDimensionSizes [2] = 0;
 				//No liberal wave names for output wave
 				CleanupName (0, outPutWaveName, MAX_OBJ_NAME);
+				XFuncTimerPhase (&timer, STATS_MAKEWAVE);
 				if (MDMakeWave (&outPutWaveH, outPutWaveName, outPutDFHandle, inPutDimensionSizes, inPutWaveType, overWrite)) throw result = WAVEERROR_NOS;
+				XFuncTimerPhase (&timer, STATS_THREADS);
 			}
 		}
         //Get data offsets for the 2 waves (1 wave, if overwriting)
@@ -218,22 +89,25 @@ extern "C" int KalmanAllFrames(KalmanAllFramesParamsPtr p) {
 			if (MDAccessNumericWaveData(outPutWaveH, kMDWaveAccessMode0, &outPutOffset)) throw result = WAVEERROR_NOS;
 			outPutDataStartPtr =  (char*)(*outPutWaveH) + outPutOffset;
 		}
-        // get ready for multiprocessor initialization
-        if (zSize < gNumProcessors){
-            nThreads =zSize;
-        }else{
-            nThreads = gNumProcessors;
-        }
-        // make array of parameter structures
-        paramArrayPtr = (KalmanThreadParamsPtr)WMNewPtr (nThreads * sizeof(KalmanThreadParams));
-        if (paramArrayPtr == NULL) throw result = MEMFAIL;
-        // make an array of pthread_t
-        threadsPtr =(pthread_t*)WMNewPtr(nThreads * sizeof(pthread_t));
-        if (threadsPtr == NULL) throw result = MEMFAIL;
-        // catch error before starting threads
+        XFuncTimerPhase (&timer, STATS_THREADS);
+        // fill paramater structure
+        params.inPutWaveType = inPutWaveType;
+        params.inPutDataStartPtr = inPutDataStartPtr;
+        params.outPutDataStartPtr = outPutDataStartPtr;
+        params.startLayer = 0;
+        params.outPutLayer =0;
+        params.xSize = inPutDimensionSizes [0];
+        params.ySize = inPutDimensionSizes [1];
+        params.zSize =zSize;
+        params.nGroups = 1;
+        params.nChannels = 1;
+        params.multiplier =multiplier;
+        params.exact = exact;
+        // run the tiles on the thread pool, and wait till they are all finished
+        XFuncTimerPhase (&timer, STATS_COMPUTE);
+        if ((result = KalmanRunTiles (&params)) != 0) throw result;
 	}catch (int result){
-        if (paramArrayPtr != NULL) WMDisposePtr ((Ptr)paramArrayPtr);
-        if (threadsPtr != NULL) WMDisposePtr ((Ptr)paramArrayPtr);
+        XFuncTimerEnd (&timer);
         WMDisposeHandle(p->outPutPath);  // dispose passed in string paramater
         p -> result = (double)(result - FIRST_XOP_ERR);
 #ifdef NO_IGOR_ERR
@@ -242,30 +116,7 @@ extern "C" int KalmanAllFrames(KalmanAllFramesParamsPtr p) {
         return (result);
 #endif
 	}
-    // fill paramater array
-    for (iThread = 0; iThread < nThreads; iThread++){
-        paramArrayPtr[iThread].inPutWaveType = inPutWaveType;
-        paramArrayPtr[iThread].inPutDataStartPtr = inPutDataStartPtr;
-        paramArrayPtr[iThread].outPutDataStartPtr = outPutDataStartPtr;
-        paramArrayPtr[iThread].startLayer = 0;
-        paramArrayPtr[iThread].outPutLayer =0;
-        paramArrayPtr[iThread].xSize = inPutDimensionSizes [0];
-        paramArrayPtr[iThread].ySize = inPutDimensionSizes [1];
-        paramArrayPtr[iThread].zSize =zSize;
-        paramArrayPtr[iThread].multiplier =multiplier;
-        paramArrayPtr[iThread].ti=iThread; // number of this thread, starting from 0
-        paramArrayPtr[iThread].tN =nThreads; // total number of threads
-    }
-    // create the threads
-    for (iThread = 0; iThread < nThreads; iThread++){
-        pthread_create (&threadsPtr[iThread], NULL, KalmanThread, (void *) &paramArrayPtr[iThread]);
-    }
-    // Wait till all the threads are finished
-    for (iThread = 0; iThread < nThreads; iThread++){
-        pthread_join (threadsPtr[iThread], NULL);
-    }
-    WMDisposePtr ((Ptr)threadsPtr);      // free memory for pThreads Array
-    WMDisposePtr ((Ptr)paramArrayPtr);  // Free paramaterArray memory
+    XFuncTimerPhase (&timer, STATS_FINISH);
     WMDisposeHandle(p->outPutPath);    // dispose passed in string paramater
     if (isOverWriting){	//then collapsing a 3D wave to 2 D
         inPutDimensionSizes [0] = -1;
@@ -277,9 +128,23 @@ extern "C" int KalmanAllFrames(KalmanAllFramesParamsPtr p) {
     // Inform Igor that we have changed output wave
     WaveHandleModified(outPutWaveH);
     p -> result = (0);
+    XFuncTimerEnd (&timer);
     return (0);
 }
 
+extern "C" int KalmanAllFrames(KalmanAllFramesParamsPtr p) {
+    return KalmanAllFramesDo (p, 0);
+}
+
+/* KalmanAllFramesExact XOP entry function
+ Averages all the layers as KalmanAllFrames does, but sums the layers in accumulators wide enough not to overflow and
+ divides each sum once, rounding to nearest, so no multiplier is needed to keep the precision of integer waves. The
+ multiplier is not used
+ Last Modified 2026/10/16 */
+extern "C" int KalmanAllFramesExact(KalmanAllFramesParamsPtr p) {
+    return KalmanAllFramesDo (p, 1);
+}
+
 /* KalmanSpecFrames XOP entry function
  Averages a specified range of layers of the input wave into a specified layer of the output wave
  KalmanSpecFramesParams
@@ -290,8 +155,10 @@ extern "C" int KalmanAllFrames(KalmanAllFramesParamsPtr p) {
  outPutLayer         layer of output wave to receive results of averaging
  multiplier          Multiplier, as for 16 bit waves containing less than 16 bits of data
  result              0 or error code
- Last Modified 2014/02/13 by Jamie Boyd */
-extern "C" int KalmanSpecFrames(KalmanSpecFramesParamsPtr p) {
+ exact is 0 for KalmanSpecFrames, for a running average, and 1 for KalmanSpecFramesExact, to sum the layers and divide
+ once, as for KalmanAllFramesExact
+ Last Modified 2026/10/16 */
+static int KalmanSpecFramesDo (KalmanSpecFramesParamsPtr p, UInt8 exact) {
 	int result = 0;	// The error returned from various Wavemetrics functions
 	waveHndl inPutWaveH = NIL, outPutWaveH = NIL;	// Handles to the input and output waves
 	int inPutWaveType, outPutWaveType;	// Wavemetrics numeric code for data type of wave
@@ -303,10 +170,10 @@ extern "C" int KalmanSpecFrames(KalmanSpecFramesParamsPtr p) {
 	CountInt pointsPerLayer;	// The number of points in a layer, needed information for iterating through a layer
 	char *inPutDataStartPtr, *outPutDataStartPtr;
 	float multiplier = (float)(p->multiplier);	// multiplier for integer waves containing less than their full range of data
-    UInt8 iThread, nThreads;
-    KalmanThreadParamsPtr paramArrayPtr = NULL;
-    pthread_t* threadsPtr = NULL;
+    KalmanThreadParams params;  // paramaters for the tiles
     // try/catch before starting threads
+	XFuncTimer timer;  // times each phase of this call, for TwoPhotonStats
+	XFuncTimerStart (&timer, exact ? STATS_KALMANSPECFRAMESEXACT : STATS_KALMANSPECFRAMES);
 	try {
 		// Get handles to input wave and kernel. Make sure both waves exist.
 		inPutWaveH = p ->inPutWaveH;	// Get Handle to the input Wave and make sure it exists
@@ -349,18 +216,25 @@ extern "C" int KalmanSpecFrames(KalmanSpecFramesParamsPtr p) {
 		inPutDataStartPtr = (char*)(*inPutWaveH) + inPutOffset;
 		if (MDAccessNumericWaveData(outPutWaveH, kMDWaveAccessMode0, &outPutOffset))throw result = WAVEERROR_NOS;
 		outPutDataStartPtr =  (char*)(*outPutWaveH) + outPutOffset;
-        // multiprocessor initialization
-        nThreads =gNumProcessors;
-        if (inPutDimensionSizes [LAYERS] < nThreads) nThreads = inPutDimensionSizes [LAYERS];
-        // make an array of parameter structures
-        paramArrayPtr = (KalmanThreadParamsPtr)WMNewPtr (nThreads * sizeof(KalmanThreadParams));
-        if (paramArrayPtr == NULL) throw result = MEMFAIL;
-        // make an array of pthread_t
-        threadsPtr =(pthread_t*)WMNewPtr(nThreads * sizeof(pthread_t));
-        if (threadsPtr == NULL) throw result = MEMFAIL;
+        XFuncTimerPhase (&timer, STATS_THREADS);
+        // fill paramater structure
+        params.inPutWaveType = inPutWaveType;
+        params.inPutDataStartPtr = inPutDataStartPtr;
+        params.outPutDataStartPtr = outPutDataStartPtr;
+        params.startLayer = startLayer;
+        params.outPutLayer = outPutLayer;
+        params.xSize = inPutDimensionSizes [0];
+        params.ySize = inPutDimensionSizes [1];
+        params.zSize = layersToDo;
+        params.nGroups = 1;
+        params.nChannels = 1;
+        params.multiplier =multiplier;
+        params.exact = exact;
+        // run the tiles on the thread pool, and wait till they are all finished
+        XFuncTimerPhase (&timer, STATS_COMPUTE);
+        if ((result = KalmanRunTiles (&params)) != 0) throw result;
 	}catch (int result){
-        if (paramArrayPtr != NULL) WMDisposePtr ((Ptr)paramArrayPtr);
-        if (threadsPtr != NULL) WMDisposePtr ((Ptr)threadsPtr);
+        XFuncTimerEnd (&timer);
         p -> result = (double)(result - FIRST_XOP_ERR);
 #ifdef NO_IGOR_ERR
     return (0);
@@ -368,35 +242,25 @@ extern "C" int KalmanSpecFrames(KalmanSpecFramesParamsPtr p) {
     return (result);
 #endif
 	}
-    // fill paramater array
-    for (iThread = 0; iThread < nThreads; iThread++){
-        paramArrayPtr[iThread].inPutWaveType = inPutWaveType;
-        paramArrayPtr[iThread].inPutDataStartPtr = inPutDataStartPtr;
-        paramArrayPtr[iThread].outPutDataStartPtr = outPutDataStartPtr;
-        paramArrayPtr[iThread].startLayer = startLayer;
-        paramArrayPtr[iThread].outPutLayer = outPutLayer;
-        paramArrayPtr[iThread].xSize = inPutDimensionSizes [0];
-        paramArrayPtr[iThread].ySize = inPutDimensionSizes [1];
-        paramArrayPtr[iThread].zSize = layersToDo;
-        paramArrayPtr[iThread].multiplier =multiplier;
-        paramArrayPtr[iThread].ti=iThread; // number of this thread, starting from 0
-        paramArrayPtr[iThread].tN =nThreads; // total number of threads
-    }
-    // create the threads
-    for (iThread = 0; iThread < nThreads; iThread++){
-        pthread_create (&threadsPtr[iThread], NULL, KalmanThread, (void *) &paramArrayPtr[iThread]);
-    }
-    // Wait till all the threads are finished
-    for (iThread = 0; iThread < nThreads; iThread++){
-        pthread_join (threadsPtr[iThread], NULL);
-    }
-    WMDisposePtr ((Ptr)threadsPtr);         // free memory for pThreads Array
-    WMDisposePtr ((Ptr)paramArrayPtr);      // Free paramaterArray memory
+    XFuncTimerPhase (&timer, STATS_FINISH);
     WaveHandleModified(outPutWaveH);        // Inform Igor that we have changed the output wave.
     p -> result = (0);
+    XFuncTimerEnd (&timer);
     return (0);
 }
 
+extern "C" int KalmanSpecFrames(KalmanSpecFramesParamsPtr p) {
+    return KalmanSpecFramesDo (p, 0);
+}
+
+/* KalmanSpecFramesExact XOP entry function
+ Averages a range of layers into a layer of the output wave as KalmanSpecFrames does, but sums the layers and divides
+ once, as for KalmanAllFramesExact. The multiplier is not used
+ Last Modified 2026/10/16 */
+extern "C" int KalmanSpecFramesExact(KalmanSpecFramesParamsPtr p) {
+    return KalmanSpecFramesDo (p, 1);
+}
+
 
 /* KalmanWaveToFrame XOP entry function
  Collapses a 3D input wave into a single 2D frame. You can get the same result with KalmanAllFrames by
@@ -417,9 +281,9 @@ int KalmanWaveToFrame (KalmanWaveToFrameParamsPtr p) {
 	float multiplier = (float)(p->multiplier);
 	CountInt zSize;
     // threading
-	UInt8 iThread, nThreads;
-    KalmanThreadParamsPtr paramArrayPtr = NULL;
-    pthread_t* threadsPtr = NULL;
+    KalmanThreadParams params;  // paramaters for the tiles
+	XFuncTimer timer;  // times each phase of this call, for TwoPhotonStats
+	XFuncTimerStart (&timer, STATS_KALMANWAVETOFRAME);
 	try {
 		// Get handle to input wave. Make sure input wave exists.
 		inPutWaveH = p->inPutWaveH;
@@ -436,17 +300,8 @@ int KalmanWaveToFrame (KalmanWaveToFrameParamsPtr p) {
         //Get data offset for the wave
 		if (MDAccessNumericWaveData(inPutWaveH, kMDWaveAccessMode0, &inPutOffset)) throw result = WAVEERROR_NOS;
 		inPutDataStartPtr = (char*)(*inPutWaveH) + inPutOffset;
-        // for multiprocessor initialization
-        nThreads = gNumProcessors;
-        // make an array of parameter structures
-        paramArrayPtr = (KalmanThreadParamsPtr)WMNewPtr (nThreads * sizeof(KalmanThreadParams));
-        if (paramArrayPtr == NULL) throw result = MEMFAIL;
-        // make an array of pthread_t
-        threadsPtr = (pthread_t*)WMNewPtr(nThreads * sizeof(pthread_t));
-        if (threadsPtr == NULL) throw result = MEMFAIL;
 	}catch (int result){
-        if (paramArrayPtr != NULL)  WMDisposePtr ((Ptr)paramArrayPtr);
-        if (threadsPtr != NULL) WMDisposePtr ((Ptr)threadsPtr);
+        XFuncTimerEnd (&timer);
         p -> result = (double)(result - FIRST_XOP_ERR);
 #ifdef NO_IGOR_ERR
     return (0);
@@ -454,30 +309,24 @@ int KalmanWaveToFrame (KalmanWaveToFrameParamsPtr p) {
     return (result);
 #endif
 	}
-    // fill pramaters array
-    for (iThread = 0; iThread < nThreads; iThread++){
-        paramArrayPtr[iThread].inPutWaveType = inPutWaveType;
-        paramArrayPtr[iThread].inPutDataStartPtr = inPutDataStartPtr;
-        paramArrayPtr[iThread].outPutDataStartPtr = inPutDataStartPtr;
-        paramArrayPtr[iThread].startLayer = 0;
-        paramArrayPtr[iThread].outPutLayer =0;
-        paramArrayPtr[iThread].xSize = inPutDimensionSizes [0];
-        paramArrayPtr[iThread].ySize = inPutDimensionSizes [1];
-        paramArrayPtr[iThread].zSize =zSize;
-        paramArrayPtr[iThread].multiplier =multiplier;
-        paramArrayPtr[iThread].ti=iThread; // number of this thread, starting from 0
-        paramArrayPtr[iThread].tN =nThreads; // total number of threads
-    }
-    // create the threads
-    for (iThread = 0; iThread < nThreads; iThread++){
-        pthread_create (&threadsPtr[iThread], NULL, KalmanThread, (void *) &paramArrayPtr[iThread]);
-    }
-    // Wait till all the threads are finished
-    for (iThread = 0; iThread < nThreads; iThread++){
-        pthread_join (threadsPtr[iThread], NULL);
-    }
-    WMDisposePtr ((Ptr)threadsPtr);     // free memory for pThreads Array
-    WMDisposePtr ((Ptr)paramArrayPtr);  // Free paramaterArray memory
+    XFuncTimerPhase (&timer, STATS_THREADS);
+    // fill paramater structure
+    params.inPutWaveType = inPutWaveType;
+    params.inPutDataStartPtr = inPutDataStartPtr;
+    params.outPutDataStartPtr = inPutDataStartPtr;
+    params.startLayer = 0;
+    params.outPutLayer =0;
+    params.xSize = inPutDimensionSizes [0];
+    params.ySize = inPutDimensionSizes [1];
+    params.zSize =zSize;
+    params.nGroups = 1;
+    params.nChannels = 1;
+    params.multiplier =multiplier;
+    params.exact = 0;   // a running average needs no buffers, so KalmanRunTiles can not fail
+    // run the tiles on the thread pool, and wait till they are all finished
+    XFuncTimerPhase (&timer, STATS_COMPUTE);
+    KalmanRunTiles (&params);
+    XFuncTimerPhase (&timer, STATS_FINISH);
 	// Redimension wave
 	inPutDimensionSizes [0] = -1;
 	inPutDimensionSizes [1] = -1;
@@ -486,127 +335,11 @@ int KalmanWaveToFrame (KalmanWaveToFrameParamsPtr p) {
 	MDChangeWave (inPutWaveH, -1, inPutDimensionSizes);
 	WaveHandleModified(inPutWaveH);     // Inform Igor that we have changed the input wave.
 	p -> result = (0);
+	XFuncTimerEnd (&timer);
 	return (0);
 }
 
 
-/* Template for handling all data types for KalmanList function
-Last Modified 2013/07/16 by Jamie Boyd  */
-template <typename T> int KalmanListT (T** srcWaveStarts, T* destWaveStart, UInt16 nWaves, CountInt startPos, CountInt endPos, float multiplier) {
-	UInt16 iWave;
-	CountInt iPos;
-	T** srcWave;
-	T** srcWaveEnd = srcWaveStarts + nWaves; 
-	/* If multiplier is < 1, use standard averaging across waves with a floating point temporary value */
-	if (multiplier < 1){ 
-		double tempVal;
-		for (iPos = startPos; iPos < endPos; iPos++){
-			for (tempVal = 0, srcWave = srcWaveStarts; srcWave < srcWaveEnd; srcWave++){
-				tempVal += *(*srcWave + iPos);
-			}
-			*(destWaveStart + iPos) = (tempVal/nWaves);
-		}
-	}else{ //Kalman
-		// Do Special stuff for first wave
-		if (*srcWaveStarts == destWaveStart){	//this happens when collapsing a wave into the first frame
-			if (multiplier > 1){
-				//Multiply the first wave by Multiplier
-				for (iPos = startPos; iPos < endPos; iPos++){
-					*(destWaveStart + iPos) *= multiplier;
-				}
-			}
-		}else{ //srcwave and destwave are different
-			if (multiplier > 1){
-				// Set output wave = first input wave * Multiplier
-				for (iPos=startPos ; iPos < endPos; iPos++){
-					*(destWaveStart + iPos) = *(*srcWaveStarts + iPos) * multiplier;
-				}
-			}else{ // first wave when No Multiplier, and Src and dest are different
-				for (iPos = startPos ; iPos < endPos ; iPos++){
-					*(destWaveStart + iPos) = *(*srcWaveStarts + iPos);
-				}
-			}
-		}
-		//For each remaining wave in input list, iterate through, averaging the input value into the output wave
-		if (multiplier > 1){
-			for(iWave=1, srcWave = srcWaveStarts + 1; iWave < nWaves ; iWave++, srcWave++) {
-				for (iPos = startPos ; iPos < endPos; iPos++){
-					*(destWaveStart + iPos) = ((*(destWaveStart + iPos) * iWave) + *(*srcWave + iPos) * multiplier)/(iWave + 1);
-				}
-			}
-			for (iPos =startPos; iPos < endPos; iPos ++){
-				*(destWaveStart + iPos) /= multiplier;
-			}
-		}else{ // no multiplier
-			for(iWave=1, srcWave = srcWaveStarts + 1; iWave < nWaves; iWave++, srcWave++) {
-				for (iPos = startPos; iPos < endPos ; iPos++){
-					*(destWaveStart + iPos) = ((*(destWaveStart + iPos) * iWave) +  *(*srcWave + iPos))/(iWave + 1);
-				}
-			}
-		}
-	}
-	return 0;
-}
-
-
-/* Structure to pass data to each KalmanListThread
-Last Modified 2013/07/16 by Jamie Boyd */
-typedef struct KalmanListThreadParams{
-    int inPutWaveType;
-    Ptr* inPutDataStartsPtr;
-    char* outPutDataStartPtr;
-    UInt16 nWaves;
-    CountInt nPnts;
-    float multiplier;
-    UInt8 ti; // number of this thread, starting from 0
-    UInt8 tN; // total number of threads
-} KalmanListThreadParams, *KalmanListThreadParamsPtr;
-
-
-/* Each thread to average a list of waves starts with this function
-Last Modified 2013/07/16 by Jamie Boyd */
-void* KalmanListThread (void* threadarg){
-	struct KalmanListThreadParams* p;
-	p = (struct KalmanListThreadParams*) threadarg;
-	CountInt nPnts= p->nPnts;
-	float multiplier = p->multiplier;
-	UInt8 ti = p->ti;
-	UInt8 tN = p->tN;
-	CountInt pntsPerThread = nPnts/tN;
-	CountInt startPos = ti * pntsPerThread; // which point to start this thread on depends on thread number * points per thread. ti is 0 based
-	if (ti == (tN - 1)) pntsPerThread += (nPnts % tN); // last thread gets any extra points
-	switch (p->inPutWaveType) {
-	case NT_I8:
-		KalmanListT ((char**)p->inPutDataStartsPtr, (char*)p->outPutDataStartPtr, p->nWaves, startPos, startPos + pntsPerThread, multiplier);
-		break;
-	case (NT_I8 | NT_UNSIGNED):
-		KalmanListT ((unsigned char**)p->inPutDataStartsPtr, (unsigned char*)p->outPutDataStartPtr, p->nWaves, startPos, startPos + pntsPerThread, multiplier);				break;
-	case NT_I16:
-		KalmanListT ((short**)p->inPutDataStartsPtr, (short*)p->outPutDataStartPtr, p->nWaves, startPos, startPos + pntsPerThread, multiplier);
-		break;
-	case (NT_I16 | NT_UNSIGNED):
-		KalmanListT ((unsigned short**)p->inPutDataStartsPtr, (unsigned short*)p->outPutDataStartPtr, p->nWaves, startPos, startPos + pntsPerThread, multiplier);
-		break;
-	case NT_I32:
-		KalmanListT ((long**)p->inPutDataStartsPtr, (long*)p->outPutDataStartPtr, p->nWaves, startPos, startPos + pntsPerThread, multiplier);
-		break;
-	case (NT_I32| NT_UNSIGNED):
-		KalmanListT ((unsigned long**)p->inPutDataStartsPtr, (unsigned long*)p->outPutDataStartPtr, p->nWaves, startPos, startPos + pntsPerThread, multiplier);
-		break;
-	case NT_FP32:
-		KalmanListT ((float**)p->inPutDataStartsPtr, (float*)p->outPutDataStartPtr, p->nWaves, startPos, startPos + pntsPerThread, multiplier);
-		break;
-	case NT_FP64:
-		KalmanListT ((double**)p->inPutDataStartsPtr, (double*)p->outPutDataStartPtr, p->nWaves, startPos, startPos + pntsPerThread, multiplier);
-		break;
-	default:	// Unknown data type - possible in a future version of Igor.
-		throw NT_FNOT_AVAIL;
-		break;
-	}
-	return 0;
-}
-
-
 /* KalmanList XOP entry function
  Averages a semicolon-separated list of waves. Each wave must have same data type and same dimensions. This is not used by the
  twoPhoton acquisition code so we print some more information in the error cases with XOPNotice
@@ -616,11 +349,12 @@ void* KalmanListThread (void* threadarg){
  multiplier         Multiplier for 16 bit waves containing less than 16 bits of data
  overwrite          0 to give errors when wave already exists. non-zero to overwrite existing wave.
  result             0 for success, else error code
- Last Modified 2014/02/13 by Jamie Boyd */
+ The list is resolved to wave handles once, and the waves are averaged in cache-sized blocks of points across the thread pool
+ Last Modified 2026/10/16 */
 extern "C" int KalmanList (KalmanListParamsPtr p) {
 	int result = 0;	// The error returned from various Wavemetrics functions
 	waveHndl outPutWaveH = NULL; // handle to output wave
-	waveHndl* handleList; // pointer to an array of handles for input waves
+	waveHndl* handleList = nullptr; // pointer to an array of handles for input waves
 	DFPATH inPutPath, outPutPath ;	// string to hold data folder path of input wave
 	WVNAME inPutWaveName, outPutWaveName;	// C strings to hold names of input and output waves
 	DataFolderHandle inPutDFHandle, outPutDFHandle;	// Handles to datafolders of input and output waves
@@ -635,9 +369,9 @@ extern "C" int KalmanList (KalmanListParamsPtr p) {
 	UInt16 numWaves;	//number of input waves in the input list
 	CountInt waveOffset;	//offset in bytes from begnning of handle to a wave to the actual data - size of headers, units, etc.
 	CountInt nPnts;
-    UInt8 iThread, nThreads;
-    KalmanListThreadParamsPtr paramArrayPtr = nullptr;
-    pthread_t* threadsPtr = nullptr;
+    KalmanListThreadParams params;  // paramaters for the tiles
+	XFuncTimer timer;  // times each phase of this call, for TwoPhotonStats
+	XFuncTimerStart (&timer, STATS_KALMANLIST);
 	try {
 		// Check that input string exists
 		if (WMGetHandleSize (p->inPutList) == 0) throw result = NON_EXISTENT_WAVE;
@@ -652,6 +386,7 @@ extern "C" int KalmanList (KalmanListParamsPtr p) {
 		}
 		// parse input list into an array of waveHandles
 		handleList = ParseWaveListPaths (p->inPutList, &numWaves);
+		if (handleList == nullptr) throw result = MEMFAIL;
 		// check that dimension sizes and wave types (no text waves) are the same for each wave in array
 #ifdef IPARSEWAVE_INF0
 		char XOPbuffer [256]; // string used for XOPAlert if we find a bad wave
@@ -747,151 +482,77 @@ extern "C" int KalmanList (KalmanListParamsPtr p) {
 		//No liberal wave names for output wave
 		if (isOverWriting == 0){
 			CleanupName (0, outPutWaveName, MAX_OBJ_NAME);
+			XFuncTimerPhase (&timer, STATS_MAKEWAVE);
 			if ( MDMakeWave (&outPutWaveH, outPutWaveName, outPutDFHandle, inPutDimensionSizes, inPutWaveType, overWrite)) throw result = WAVEERROR_NOS;
+			XFuncTimerPhase (&timer, STATS_THREADS);
 		}
         // get offsets to data for input waves
         inPutDataStartsPtr = (Ptr*) WMNewPtr (numWaves * sizeof (Ptr));
+		if (inPutDataStartsPtr == nullptr) throw result = MEMFAIL;
 		for (int iw = 0; iw < numWaves; iw++){
 			if (MDAccessNumericWaveData(handleList[iw], kMDWaveAccessMode0, &waveOffset)) throw result = WAVEERROR_NOS;
             *(inPutDataStartsPtr + iw) = (char*)(*handleList[iw]) + waveOffset;
 		}
 		// get offset for outPut wave
 		if (isOverWriting) {
+			outPutWaveH = handleList [0];
             outPutDataStartPtr = *inPutDataStartsPtr;
 		}else{
 			if (MDAccessNumericWaveData(outPutWaveH, kMDWaveAccessMode0, &waveOffset)) throw result = WAVEERROR_NOS;
 			outPutDataStartPtr =  (char*)(*outPutWaveH) + waveOffset;
 		}
-        // multiprocessor init
-        nThreads = gNumProcessors;
-        paramArrayPtr = (KalmanListThreadParamsPtr)WMNewPtr(nThreads * sizeof(KalmanListThreadParams));
-        if (paramArrayPtr == nullptr) throw result = MEMFAIL;
-        // make an array of pthread_t
-        threadsPtr =(pthread_t*)WMNewPtr(nThreads * sizeof(pthread_t));
-        if (threadsPtr == nullptr) throw result = MEMFAIL;
+		XFuncTimerPhase (&timer, STATS_THREADS);
+		// fill paramater structure
+		params.inPutWaveType = inPutWaveType;
+		params.inPutDataStartsPtr = inPutDataStartsPtr;
+		params.outPutDataStartPtr = outPutDataStartPtr;
+		params.nWaves=numWaves;
+		params.nPnts = nPnts;
+		params.multiplier = multiplier;
+		// run the tiles on the thread pool, and wait till they are all finished
+		XFuncTimerPhase (&timer, STATS_COMPUTE);
+		if ((result = KalmanListRunTiles (&params, gNumProcessors)) != 0) throw result;
 	}catch (int result){
-        if (threadsPtr != nullptr) WMDisposePtr((Ptr)threadsPtr);
-        if (paramArrayPtr != nullptr) WMDisposePtr ((Ptr)paramArrayPtr);
+		XFuncTimerEnd (&timer);
 		if (inPutDataStartsPtr != nullptr) WMDisposePtr ((Ptr)inPutDataStartsPtr);
+		if (handleList != nullptr) WMDisposePtr ((Ptr)handleList);
         WMDisposeHandle(p->inPutList);
         WMDisposeHandle(p->outPutPath);
 		// set result
-		p -> result = (result - FIRST_XOP_ERR);	// XFUNC error code
+		p -> result = (double)(result - FIRST_XOP_ERR);	// XFUNC error code
+#ifdef NO_IGOR_ERR
+		return (0);
+#else
 		return (result);
+#endif
 	}
-    // fill threadArray
-	for (iThread = 0; iThread < nThreads; iThread++){
-		paramArrayPtr[iThread].inPutWaveType = inPutWaveType;
-        paramArrayPtr[iThread].inPutDataStartsPtr = inPutDataStartsPtr;
-		paramArrayPtr[iThread].outPutDataStartPtr = outPutDataStartPtr;
-		paramArrayPtr[iThread].nWaves=numWaves;
-		paramArrayPtr[iThread].nPnts = nPnts;
-		paramArrayPtr[iThread].multiplier = multiplier;
-		paramArrayPtr[iThread].ti=iThread; // number of this thread, starting from 0
-		paramArrayPtr[iThread].tN =nThreads; // total number of threads
-	}
-    
-	// create the threads
-	for (iThread = 0; iThread < nThreads; iThread++){
-		pthread_create (&threadsPtr[iThread], NULL, KalmanListThread, (void *) &paramArrayPtr[iThread]);
-	}
-	// Wait till all the threads are finished
-	for (iThread = 0; iThread < nThreads; iThread++){
-		pthread_join (threadsPtr[iThread], NULL);
-	}
-	WMDisposePtr ((Ptr)threadsPtr);         // free memory for pThreads Array
-	WMDisposePtr ((Ptr)paramArrayPtr);      // Free paramaterArray memory
+	XFuncTimerPhase (&timer, STATS_FINISH);
     WMDisposePtr ((Ptr)inPutDataStartsPtr); // free pointers to data starts
+    WMDisposePtr ((Ptr)handleList);         // free array of input wave handles
     WMDisposeHandle(p->inPutList);          // free inPutList input string
     WMDisposeHandle(p->outPutPath);         // free outPutPath input string
 	// Inform Igor that we have changed the wave.
 	WaveHandleModified(outPutWaveH);
 	// set result
 	p -> result = (0);
+	XFuncTimerEnd (&timer);
 	return (0);
 }
 
 
-/* Template for doing sequential Kalman averaging, src wave is the new wave,
- dest wave is the old wave already averaged iKal times
- Last Modified 2014/01/28 by Jamie Boyd */
-template <typename T> void KalmanNextT (T* srcWaveStart, T* destWaveStart, CountInt nPoints, UInt16 iKal) {
-	T* srcWave;
-	T* destWave;
-	T* destWaveEnd = destWaveStart + nPoints;
-	if (iKal == 0){
-		for (srcWave = srcWaveStart, destWave = destWaveStart; destWave < destWaveEnd; srcWave++, destWave++)
-			*destWave = *srcWave;
-	}else{
-		for (srcWave = srcWaveStart, destWave = destWaveStart; destWave < destWaveEnd; srcWave++, destWave++)
-			*destWave= (*destWave  * iKal +  *srcWave)/(iKal + 1);
-	}
-}
-
-
-/* Structure to pass data to each KalmanNext Thread
- Last Modified: 2014/01/28 by Jamie Boyd */
-typedef struct KalmanNextThreadParams{
-    int inPutWaveType;
-    char* inPutDataStartPtr;
-    char* outPutDataStartPtr;
-    CountInt nPnts;
-    UInt16 iKal;
-    UInt8 ti; // number of this thread, starting from 0
-    UInt8 tN; // total number of threads
-} KalmanNextThreadParams, *KalmanNextThreadParamsPtr;
-
-
-/* Each thread to do sequential Kalmaning starts with this function
- Last Modified 2014/01/29 by Jamie Boyd */
-void* KalmanNextThread (void* threadarg){
-	struct KalmanNextThreadParams* p;
-	p = (struct KalmanNextThreadParams*) threadarg;
-	CountInt nPnts= p->nPnts;
-	UInt8 ti = p->ti;
-	UInt8 tN = p->tN;
-	CountInt pntsPerThread = nPnts/tN;
-	CountInt startPos = ti * pntsPerThread; // which point to start this thread on depends on thread number * points per thread. ti is 0 based
-	if (ti == (tN - 1)) pntsPerThread += (nPnts % tN); // last thread gets any extra points
-	switch (p->inPutWaveType) {
-        case NT_I8:
-            KalmanNextT ((char*)p->inPutDataStartPtr + startPos, (char*)p->outPutDataStartPtr + startPos, pntsPerThread, p->iKal);
-            break;
-        case (NT_I8 | NT_UNSIGNED):
-            KalmanNextT ((unsigned char*)p->inPutDataStartPtr + startPos, (unsigned char*)p->outPutDataStartPtr + startPos, pntsPerThread, p->iKal);
-            break;
-        case NT_I16:
-            KalmanNextT ((short*)p->inPutDataStartPtr + startPos, (short*)p->outPutDataStartPtr+ startPos, pntsPerThread, p->iKal);
-            break;
-        case (NT_I16 | NT_UNSIGNED):
-            KalmanNextT ((unsigned short*)p->inPutDataStartPtr + startPos, (unsigned short*)p->outPutDataStartPtr + startPos, pntsPerThread, p->iKal);
-            break;
-        case NT_I32:
-            KalmanNextT ((long*)p->inPutDataStartPtr + startPos, (long*)p->outPutDataStartPtr + startPos, pntsPerThread, p->iKal);
-            break;
-        case (NT_I32| NT_UNSIGNED):
-            KalmanNextT ((unsigned long*)p->inPutDataStartPtr + startPos, (unsigned long*)p->outPutDataStartPtr + startPos, pntsPerThread, p->iKal);
-            break;
-        case NT_FP32:
-            KalmanNextT ((float*)p->inPutDataStartPtr + startPos, (float*)p->outPutDataStartPtr + startPos, pntsPerThread, p->iKal);
-            break;
-        case NT_FP64:
-            KalmanNextT ((double*)p->inPutDataStartPtr + startPos, (double*)p->outPutDataStartPtr + startPos, pntsPerThread, p->iKal);
-            break;
-	}
-	return nullptr;
-}
-
-
 /* KalmanNext XOP entry function
- Averages a wave into an already averaged wave. Both waves must have same data type and same dimensions.
+ Averages a wave into an already averaged wave. Both waves must have same data type and same dimensions. The input wave
+ may also have one more dimension than the output wave, as a 3D wave of new frames for a 2D average, and then each of
+ its layers (or chunks, for a 3D average) is added in turn, all in one pass over the output wave
  KalmanNextParams:
  inPutWaveH     handle to input wave
  outPutWaveH    handle to output wave
- iKal           index of wave are we adding
+ iKal           number of waves already averaged into the output wave. 0 to start a new average with the first input wave
  result         0 or error code
- Last Modified 2014/01/28 by Jamie Boyd */
-extern "C" int KalmanNext (KalmanNextParamsPtr p) {
+ weight is 0 from KalmanNext, for a running average of all the waves, and more than 0 and up to 1 from
+ KalmanNextWeighted, for an exponential average, each new wave having this weight and the old average 1 - weight
+ Last Modified 2026/10/16 */
+static int KalmanNextDo (KalmanNextParamsPtr p, double weight, UInt8 isWeighted) {
 	int result = 0;	// The error returned from various Wavemetrics functions
     waveHndl outPutWaveH = NULL; // handle to output wave
 	waveHndl inPutWaveH; // handle to input wave
@@ -903,13 +564,15 @@ extern "C" int KalmanNext (KalmanNextParamsPtr p) {
 	char* inPutDataStartPtr;
 	CountInt inPutOffset, outPutOffset;	//offset in bytes from begnning of handle to a wave to the actual data - size of headers, units, etc.
 	CountInt nPnts = 1;
-	UInt16 iKal;
-    UInt8 iThread, nThreads;
-    KalmanNextThreadParamsPtr paramArrayPtr = NULL;
-    pthread_t* threadsPtr = NULL;
+	CountInt nFrames = 1;   // number of new waves in the input wave
+	CountInt iKal;
+    KalmanNextThreadParams params;  // paramaters for the tiles
+	XFuncTimer timer;  // times each phase of this call, for TwoPhotonStats
+	XFuncTimerStart (&timer, isWeighted ? STATS_KALMANNEXTWEIGHTED : STATS_KALMANNEXT);
 	try {
-		// get iKal
-        iKal = (UInt16)p->iKal;
+		// get iKal and weight
+        iKal = (p->iKal > 0) ? (CountInt)p->iKal : 0;
+        if ((isWeighted) && ((weight <= 0) || (weight > 1))) throw result = BADWEIGHT;
         // Get handle to input wave. Make sure input wave exists.
 		inPutWaveH = p->inPutWaveH;
 		if(inPutWaveH == NIL)throw result = NON_EXISTENT_WAVE;
@@ -926,29 +589,26 @@ extern "C" int KalmanNext (KalmanNextParamsPtr p) {
 		if (outPutWaveType==TEXT_WAVE_TYPE) throw result = NOTEXTWAVES;
 		//Get number of used dimensions in outPut wave.
 		if (MDGetWaveDimensions(outPutWaveH, &outPutDimensions, outPutDimensionSizes))throw result = WAVEERROR_NOS;
-        // check that waves are the same types and dimension sizes
+        // check that waves are the same types and dimension sizes, or that the input wave has one more dimension, for a block of new waves
         if (inPutWaveType != outPutWaveType) throw result = NOTSAMEDIMSIZE;
-        if (inPutDimensions != outPutDimensions) throw result = NOTSAMEDIMSIZE;
+        if (inPutDimensions == outPutDimensions + 1){
+            nFrames = inPutDimensionSizes [outPutDimensions];
+        }else if (inPutDimensions != outPutDimensions){
+            throw result = NOTSAMEDIMSIZE;
+        }
         // check sizes of each dimension, and calculate total number of points as well
         UInt8 id;
-        for (id=0; id < inPutDimensions; id +=1){
+        for (id=0; id < outPutDimensions; id +=1){
             if (inPutDimensionSizes [id] != outPutDimensionSizes [id]) throw result = NOTSAMEDIMSIZE;
-            nPnts *= inPutDimensionSizes [id];
+            nPnts *= outPutDimensionSizes [id];
         }
 		//Get data offset for the waves
 		if (MDAccessNumericWaveData(inPutWaveH, kMDWaveAccessMode0, &inPutOffset)) throw result = WAVEERROR_NOS;
 		inPutDataStartPtr = (char*)(*inPutWaveH) + inPutOffset;
         if (MDAccessNumericWaveData(outPutWaveH, kMDWaveAccessMode0, &outPutOffset)) throw result = WAVEERROR_NOS;
 		outPutDataStartPtr = (char*)(*outPutWaveH) + outPutOffset;
-        // multiprocessor initialization
-        nThreads =gNumProcessors;
-        // make an array of parameter structures
-        paramArrayPtr = (KalmanNextThreadParamsPtr)WMNewPtr (nThreads * sizeof(KalmanNextThreadParams));
-        // make an array of pthread_t
-        threadsPtr =(pthread_t*)WMNewPtr(nThreads * sizeof(pthread_t));
     }catch (int result){
-        if (threadsPtr != NULL) WMDisposePtr ((Ptr)threadsPtr);
-        if (paramArrayPtr != NULL) WMDisposePtr ((Ptr)paramArrayPtr);
+        XFuncTimerEnd (&timer);
         p -> result = (double)(result - FIRST_XOP_ERR);
 #ifdef NO_IGOR_ERR
             return (0);
@@ -956,31 +616,742 @@ extern "C" int KalmanNext (KalmanNextParamsPtr p) {
             return (result);
 #endif
     }
-    // make an array of parameter structures
-    for (int iThread = 0; iThread < nThreads; iThread++){
-        paramArrayPtr[iThread].inPutWaveType = inPutWaveType;
-        paramArrayPtr[iThread].inPutDataStartPtr = inPutDataStartPtr;
-        paramArrayPtr[iThread].outPutDataStartPtr = outPutDataStartPtr;
-        paramArrayPtr[iThread].nPnts =nPnts;
-        paramArrayPtr[iThread].iKal =iKal;
-        paramArrayPtr[iThread].ti=iThread; // number of this thread, starting from 0
-        paramArrayPtr[iThread].tN =nThreads; // total number of threads
-    }
-    // create the threads
-    for (iThread = 0; iThread < nThreads; iThread++){
-        pthread_create (&threadsPtr[iThread], NULL, KalmanNextThread, (void *) &paramArrayPtr[iThread]);
-    }
-    // Wait till all the threads are finished
-    for (iThread = 0; iThread < nThreads; iThread++){
-        pthread_join (threadsPtr[iThread], NULL);
-    }
-    // free memory for pThreads Array
-    WMDisposePtr ((Ptr)threadsPtr);
-    // Free paramaterArray memory
-    WMDisposePtr ((Ptr)paramArrayPtr);
+    XFuncTimerPhase (&timer, STATS_THREADS);
+    // fill paramater structure
+    params.inPutWaveType = inPutWaveType;
+    params.inPutDataStartPtr = inPutDataStartPtr;
+    params.outPutDataStartPtr = outPutDataStartPtr;
+    params.nPnts =nPnts;
+    params.iKal =iKal;
+    params.nFrames = nFrames;
+    params.weight = weight;
+    // run the tiles on the thread pool, and wait till they are all finished
+    XFuncTimerPhase (&timer, STATS_COMPUTE);
+    ThreadPoolRunTiles (KalmanNextTile, &params, nPnts, ThreadPoolTileSize (nPnts, KALMAN_MIN_TILE), gNumProcessors);
+    XFuncTimerPhase (&timer, STATS_FINISH);
 	MDChangeWave (outPutWaveH, -1, outPutDimensionSizes);
     // Inform Igor that we have changed the input wave.
 	WaveHandleModified(outPutWaveH);
 	p -> result = (0);
+	XFuncTimerEnd (&timer);
+	return (0);
+}
+
+extern "C" int KalmanNext (KalmanNextParamsPtr p) {
+    return KalmanNextDo (p, 0, 0);
+}
+
+/* KalmanNextWeighted XOP entry function
+ Averages a wave, or a block of waves, into an already averaged wave as KalmanNext does, but as an exponential average
+ for live display, each new wave having weight, from more than 0 to 1, and the old average 1 - weight
+ KalmanNextWeightedParams:
+ inPutWaveH     handle to input wave
+ outPutWaveH    handle to output wave
+ iKal           number of waves already averaged into the output wave. 0 to start a new average with the first input wave
+ weight         weight of each new wave, more than 0 and up to 1, else BADWEIGHT
+ result         0 or error code
+ Last Modified 2026/10/16 */
+extern "C" int KalmanNextWeighted (KalmanNextWeightedParamsPtr p) {
+    KalmanNextParams nextParams;
+    int result;
+    nextParams.iKal = p->iKal;
+    nextParams.outPutWaveH = p->outPutWaveH;
+    nextParams.inPutWaveH = p->inPutWaveH;
+    nextParams.tp = p->tp;
+    result = KalmanNextDo (&nextParams, p->weight, 1);
+    p->result = nextParams.result;
+    return (result);
+}
+
+
+/* KalmanSlidingWindow XOP entry function
+ Makes a moving average of a 3D wave in a new 3D wave, each layer of the output being the average of nWindow layers of
+ the input. Each window after the first adds one layer and takes off another, so the time for each output layer does
+ not grow with the size of the window. Sums are wide enough that they can not overflow, and are divided once, rounding
+ to nearest, as for exact averaging with KalmanAllFrames
+ KalmanSlidingWindowParams
+ inPutWaveH     handle to a 3D input wave
+ outPutPath     A handle to a string containing path to output wave we want to make
+ nWindow        number of layers in each window, a whole number from 1 to the number of layers in the input wave
+ sameSize       0 for an output wave of zSize - nWindow + 1 layers, each layer n the average of input layers n to
+                n + nWindow - 1. non-zero for an output wave of zSize layers, each centered on the same input layer,
+                with the windows at the start and end averaging only the layers they have
+ overWrite      0 to give errors when wave already exists. non-zero to overwrite existing wave without warning.
+ result         0 for success, error code for failure
+ Last Modified 2026/10/16 */
+extern "C" int KalmanSlidingWindow (KalmanSlidingWindowParamsPtr p) {
+	int result = 0;	// The error returned from various Wavemetrics functions
+	waveHndl inPutWaveH = NULL, outPutWaveH = NULL;	// Handles to the input and output waves
+	int inPutWaveType;	// Wavemetrics numeric code for data type of wave
+	int inPutDimensions;		// The number of dimensions used in the input wave
+	CountInt inPutOffset, outPutOffset; //offset in bytes from begnning of handle to a wave to the actual data - size of headers, units, etc.
+	CountInt inPutDimensionSizes[MAX_DIMENSIONS+1];	// An array used to hold the sizes of each dimension of the input wave
+	DataFolderHandle inPutDFHandle, outPutDFHandle;	// Handle to the datafolder where we will put the output wave
+	DFPATH inPutPath, outPutPath;	// string to hold data folder path of input wave
+	WVNAME inPutWaveName, outPutWaveName;	// C string to hold name of input wave
+	UInt8 overWrite = (p->overWrite != 0);	// 0 to not overwrite output wave if it already exists, 1 to overwrite old waves
+	CountInt zSize, nWindow;
+	KalmanSlidingThreadParams params;  // paramaters for the tiles
+	XFuncTimer timer;  // times each phase of this call, for TwoPhotonStats
+	XFuncTimerStart (&timer, STATS_KALMANSLIDINGWINDOW);
+	try {
+		// Get handle to input wave.
+		inPutWaveH = p ->inPutWaveH;
+		if(inPutWaveH == NIL)throw result = NON_EXISTENT_WAVE;
+		// get wave data type and check that we don't have a text wave
+		inPutWaveType = WaveType(inPutWaveH);
+		if (inPutWaveType==TEXT_WAVE_TYPE) throw result = NOTEXTWAVES;
+		//Get number of used dimensions in input wave.
+		if (MDGetWaveDimensions(inPutWaveH, &inPutDimensions, inPutDimensionSizes))throw result = WAVEERROR_NOS;
+		// Check that input wave is 3D
+		if (inPutDimensions != 3) throw result = INPUTNEEDS_3D_WAVE;
+		zSize = inPutDimensionSizes [LAYERS];
+		// check window size
+		if ((p->nWindow < 1) || (p->nWindow > zSize) || (p->nWindow != (CountInt)p->nWindow)) throw result = BADLAYERCOUNT;
+		nWindow = (CountInt)p->nWindow;
+		// output wave is always a new wave, as the windows need input layers that come before their output layers
+		if (WMGetHandleSize (p->outPutPath) == 0) throw result = OVERWRITEALERT;
+		ParseWavePath (p->outPutPath, outPutPath, outPutWaveName);
+		//check that data folder is valid and get a handle to the datafolder
+		if (GetNamedDataFolder (NULL, outPutPath, &outPutDFHandle))throw result = WAVEERROR_NOS;
+		// Test name and data folder for output wave against the input wave to prevent overwriting the input wave
+		WaveName (inPutWaveH, inPutWaveName);
+		if (GetWavesDataFolder (inPutWaveH, &inPutDFHandle)) throw result = WAVEERROR_NOS;
+		if (GetDataFolderNameOrPath (inPutDFHandle, 1, inPutPath)) throw result = WAVEERROR_NOS;
+		if ((!(CmpStr (inPutPath,outPutPath))) && (!(CmpStr (inPutWaveName,outPutWaveName)))) throw result = OVERWRITEALERT;
+		// make the output wave, with one layer for each window
+		params.outZSize = (p->sameSize != 0) ? zSize : zSize - nWindow + 1;
+		params.offset = (p->sameSize != 0) ? (nWindow - 1)/2 : 0;
+		inPutDimensionSizes [LAYERS] = params.outZSize;
+		//No liberal wave names for output wave
+		CleanupName (0, outPutWaveName, MAX_OBJ_NAME);
+		XFuncTimerPhase (&timer, STATS_MAKEWAVE);
+		if (MDMakeWave (&outPutWaveH, outPutWaveName, outPutDFHandle, inPutDimensionSizes, inPutWaveType, overWrite)) throw result = WAVEERROR_NOS;
+		XFuncTimerPhase (&timer, STATS_THREADS);
+		//Get data offsets for the 2 waves
+		if (MDAccessNumericWaveData(inPutWaveH, kMDWaveAccessMode0, &inPutOffset)) throw result = WAVEERROR_NOS;
+		if (MDAccessNumericWaveData(outPutWaveH, kMDWaveAccessMode0, &outPutOffset)) throw result = WAVEERROR_NOS;
+		// fill paramater structure
+		params.inPutWaveType = inPutWaveType;
+		params.inPutDataStartPtr = (char*)(*inPutWaveH) + inPutOffset;
+		params.outPutDataStartPtr = (char*)(*outPutWaveH) + outPutOffset;
+		params.xSize = inPutDimensionSizes [0];
+		params.ySize = inPutDimensionSizes [1];
+		params.zSize = zSize;
+		params.nWindow = nWindow;
+		// run the tiles on the thread pool, and wait till they are all finished
+		XFuncTimerPhase (&timer, STATS_COMPUTE);
+		if ((result = KalmanSlidingRunTiles (&params)) != 0) throw result;
+	}catch (int result){
+		XFuncTimerEnd (&timer);
+		WMDisposeHandle(p->outPutPath);  // dispose passed in string paramater
+		p -> result = (double)(result - FIRST_XOP_ERR);
+#ifdef NO_IGOR_ERR
+		return (0);
+#else
+		return (result);
+#endif
+	}
+	XFuncTimerPhase (&timer, STATS_FINISH);
+	WMDisposeHandle(p->outPutPath);    // dispose passed in string paramater
+	// Inform Igor that we have changed output wave
+	WaveHandleModified(outPutWaveH);
+	p -> result = (0);
+	XFuncTimerEnd (&timer);
+	return (0);
+}
+
+
+/* KalmanGroupFrames XOP entry function
+ Bins the layers of a 3D wave into groups of nFrames layers, averaging each group into one layer, in a single pass over
+ the input. Layers left over at the end, fewer than nFrames, are not used. The output is a new 3D wave with
+ zSize/nFrames layers, or the input wave, redimensioned to zSize/nFrames layers
+ KalmanGroupFramesParams
+ inPutWaveH     handle to a 3D input wave
+ outPutPath     A handle to a string containing path to output wave we want to make, or empty string to overwrite input wave
+ nFrames        number of layers averaged into each output layer, a whole number from 1 to the number of input layers
+ multiplier     Multiplier for,e.g., 16 bit waves containing less than 16 bits of data, as for KalmanAllFrames
+ overWrite      0 to give errors when wave already exists. non-zero to overwrite existing wave without warning.
+ exact          0 for a running average, non-zero to sum the layers and divide once, as for KalmanAllFrames
+ result         0 for success, error code for failure
+ Last Modified 2026/10/16 */
+extern "C" int KalmanGroupFrames (KalmanGroupFramesParamsPtr p) {
+	int result = 0;	// The error returned from various Wavemetrics functions
+	waveHndl inPutWaveH = NULL, outPutWaveH = NULL;	// Handles to the input and output waves
+	int inPutWaveType;	// Wavemetrics numeric code for data type of wave
+	int inPutDimensions;		// The number of dimensions used in the input wave
+	CountInt inPutOffset, outPutOffset; //offset in bytes from begnning of handle to a wave to the actual data - size of headers, units, etc.
+	CountInt inPutDimensionSizes[MAX_DIMENSIONS+1];	// An array used to hold the sizes of each dimension of the input wave
+	DataFolderHandle inPutDFHandle, outPutDFHandle;	// Handle to the datafolder where we will put the output wave
+	DFPATH inPutPath, outPutPath;	// string to hold data folder path of input wave
+	WVNAME inPutWaveName, outPutWaveName;	// C string to hold name of input wave
+	UInt8 overWrite = (p->overWrite != 0);	// 0 to not overwrite output wave if it already exists, 1 to overwrite old waves
+	UInt8 isOverWriting; // non-zero if output is overwriting input wave
+	CountInt zSize, nFrames, nGroups;
+	KalmanThreadParams params;  // paramaters for the tiles
+	XFuncTimer timer;  // times each phase of this call, for TwoPhotonStats
+	XFuncTimerStart (&timer, STATS_KALMANGROUPFRAMES);
+	try {
+		// Get handle to input wave.
+		inPutWaveH = p ->inPutWaveH;
+		if(inPutWaveH == NIL)throw result = NON_EXISTENT_WAVE;
+		// get wave data type and check that we don't have a text wave
+		inPutWaveType = WaveType(inPutWaveH);
+		if (inPutWaveType==TEXT_WAVE_TYPE) throw result = NOTEXTWAVES;
+		//Get number of used dimensions in input wave.
+		if (MDGetWaveDimensions(inPutWaveH, &inPutDimensions, inPutDimensionSizes))throw result = WAVEERROR_NOS;
+		// Check that input wave is 3D
+		if (inPutDimensions != 3) throw result = INPUTNEEDS_3D_WAVE;
+		zSize = inPutDimensionSizes [LAYERS];
+		// check group size
+		if ((p->nFrames < 1) || (p->nFrames > zSize) || (p->nFrames != (CountInt)p->nFrames)) throw result = BADLAYERCOUNT;
+		nFrames = (CountInt)p->nFrames;
+		nGroups = zSize/nFrames;
+		// If outPutPath is empty string, we are overwriting existing wave
+		if (WMGetHandleSize (p->outPutPath) == 0){
+			if (overWrite == NO_OVERWITE) throw result = OVERWRITEALERT;
+			outPutWaveH = inPutWaveH;
+			isOverWriting = 1;
+		}else{ // Parse outPut path
+			ParseWavePath (p->outPutPath, outPutPath, outPutWaveName);
+			//check that data folder is valid and get a handle to the datafolder
+			if (GetNamedDataFolder (NULL, outPutPath, &outPutDFHandle))throw result = WAVEERROR_NOS;
+			// Test name and data folder for output wave against the input wave to prevent accidental overwriting, if src and dest are the same
+			WaveName (inPutWaveH, inPutWaveName);
+			if (GetWavesDataFolder (inPutWaveH, &inPutDFHandle)) throw result = WAVEERROR_NOS;
+			if (GetDataFolderNameOrPath (inPutDFHandle, 1, inPutPath)) throw result = WAVEERROR_NOS;
+			if ((!(CmpStr (inPutPath,outPutPath))) && (!(CmpStr (inPutWaveName,outPutWaveName)))){	// Then we would overwrite wave
+				isOverWriting = 1;
+				if (overWrite == NO_OVERWITE) throw result = OVERWRITEALERT;
+				outPutWaveH = inPutWaveH;
+			}else{
+				isOverWriting = 0;
+				// make the output wave, with one layer for each group
+				inPutDimensionSizes [LAYERS] = nGroups;
+				//No liberal wave names for output wave
+				CleanupName (0, outPutWaveName, MAX_OBJ_NAME);
+				XFuncTimerPhase (&timer, STATS_MAKEWAVE);
+				if (MDMakeWave (&outPutWaveH, outPutWaveName, outPutDFHandle, inPutDimensionSizes, inPutWaveType, overWrite)) throw result = WAVEERROR_NOS;
+				XFuncTimerPhase (&timer, STATS_THREADS);
+			}
+		}
+		//Get data offsets for the 2 waves (1 wave, if overwriting)
+		if (MDAccessNumericWaveData(inPutWaveH, kMDWaveAccessMode0, &inPutOffset)) throw result = WAVEERROR_NOS;
+		if (MDAccessNumericWaveData(outPutWaveH, kMDWaveAccessMode0, &outPutOffset)) throw result = WAVEERROR_NOS;
+		XFuncTimerPhase (&timer, STATS_THREADS);
+		// fill paramater structure
+		params.inPutWaveType = inPutWaveType;
+		params.inPutDataStartPtr = (char*)(*inPutWaveH) + inPutOffset;
+		params.outPutDataStartPtr = (char*)(*outPutWaveH) + outPutOffset;
+		params.startLayer = 0;
+		params.outPutLayer = 0;
+		params.xSize = inPutDimensionSizes [0];
+		params.ySize = inPutDimensionSizes [1];
+		params.zSize = nFrames;
+		params.nGroups = nGroups;
+		params.nChannels = 1;
+		params.multiplier = (float)(p->multiplier);
+		params.exact = (p->exact != 0);
+		// run the tiles on the thread pool, and wait till they are all finished
+		XFuncTimerPhase (&timer, STATS_COMPUTE);
+		if ((result = KalmanRunTiles (&params)) != 0) throw result;
+	}catch (int result){
+		XFuncTimerEnd (&timer);
+		WMDisposeHandle(p->outPutPath);  // dispose passed in string paramater
+		p -> result = (double)(result - FIRST_XOP_ERR);
+#ifdef NO_IGOR_ERR
+		return (0);
+#else
+		return (result);
+#endif
+	}
+	XFuncTimerPhase (&timer, STATS_FINISH);
+	WMDisposeHandle(p->outPutPath);    // dispose passed in string paramater
+	if (isOverWriting){	// then the groups are in the first layers of the input wave
+		inPutDimensionSizes [0] = -1;
+		inPutDimensionSizes [1] = -1;
+		inPutDimensionSizes [2] = nGroups;
+		inPutDimensionSizes [3] = 0;
+		MDChangeWave (outPutWaveH, -1, inPutDimensionSizes);
+	}
+	// Inform Igor that we have changed output wave
+	WaveHandleModified(outPutWaveH);
+	p -> result = (0);
+	XFuncTimerEnd (&timer);
+	return (0);
+}
+
+
+/* KalmanStats XOP entry function
+ Makes a new 3D wave with the per-point mean, variance and standard deviation over all the layers of a 3D wave, and
+ optionally the minimum and maximum, in one pass through the input. Layers of the output are labelled mean, variance,
+ stdDev, min, and max. The variance is the sample variance, dividing by the number of layers - 1. The output is single
+ precision floating point for 8 and 16 bit and single precision waves, and double precision for 32 bit and double
+ precision waves
+ KalmanStatsParams
+ inPutWaveH     handle to a 3D input wave
+ outPutPath     A handle to a string containing path to output wave we want to make
+ doMinMax       non-zero to add layers for the minimum and maximum of each point
+ overWrite      0 to give errors when wave already exists. non-zero to overwrite existing wave without warning.
+ result         0 for success, error code for failure
+ Last Modified 2026/10/16 */
+extern "C" int KalmanStats (KalmanStatsParamsPtr p) {
+	int result = 0;	// The error returned from various Wavemetrics functions
+	waveHndl inPutWaveH = NULL, outPutWaveH = NULL;	// Handles to the input and output waves
+	int inPutWaveType;	// Wavemetrics numeric code for data type of wave
+	int inPutDimensions;		// The number of dimensions used in the input wave
+	CountInt inPutOffset, outPutOffset; //offset in bytes from begnning of handle to a wave to the actual data - size of headers, units, etc.
+	CountInt inPutDimensionSizes[MAX_DIMENSIONS+1];	// An array used to hold the sizes of each dimension of the input wave
+	CountInt outPutDimensionSizes[MAX_DIMENSIONS+1];	// An array used to hold the sizes of each dimension of the output wave
+	DataFolderHandle inPutDFHandle, outPutDFHandle;	// Handle to the datafolder where we will put the output wave
+	DFPATH inPutPath, outPutPath;	// string to hold data folder path of input wave
+	WVNAME inPutWaveName, outPutWaveName;	// C string to hold name of input wave
+	UInt8 overWrite = (p->overWrite != 0);	// 0 to not overwrite output wave if it already exists, 1 to overwrite old waves
+	UInt8 doMinMax = (p->doMinMax != 0);
+	const char* layerLabels [5] = {"mean", "variance", "stdDev", "min", "max"};
+	int iLayer;
+	KalmanStatsThreadParams params;  // paramaters for the tiles
+	XFuncTimer timer;  // times each phase of this call, for TwoPhotonStats
+	XFuncTimerStart (&timer, STATS_KALMANSTATS);
+	try {
+		// Get handle to input wave.
+		inPutWaveH = p ->inPutWaveH;
+		if(inPutWaveH == NIL)throw result = NON_EXISTENT_WAVE;
+		// get wave data type and check that we don't have a text wave
+		inPutWaveType = WaveType(inPutWaveH);
+		if (inPutWaveType==TEXT_WAVE_TYPE) throw result = NOTEXTWAVES;
+		//Get number of used dimensions in input wave.
+		if (MDGetWaveDimensions(inPutWaveH, &inPutDimensions, inPutDimensionSizes))throw result = WAVEERROR_NOS;
+		// Check that input wave is 3D
+		if (inPutDimensions != 3) throw result = INPUTNEEDS_3D_WAVE;
+		// output wave is always a new wave, of a different type than the input wave
+		if (WMGetHandleSize (p->outPutPath) == 0) throw result = OVERWRITEALERT;
+		ParseWavePath (p->outPutPath, outPutPath, outPutWaveName);
+		//check that data folder is valid and get a handle to the datafolder
+		if (GetNamedDataFolder (NULL, outPutPath, &outPutDFHandle))throw result = WAVEERROR_NOS;
+		// Test name and data folder for output wave against the input wave to prevent overwriting the input wave
+		WaveName (inPutWaveH, inPutWaveName);
+		if (GetWavesDataFolder (inPutWaveH, &inPutDFHandle)) throw result = WAVEERROR_NOS;
+		if (GetDataFolderNameOrPath (inPutDFHandle, 1, inPutPath)) throw result = WAVEERROR_NOS;
+		if ((!(CmpStr (inPutPath,outPutPath))) && (!(CmpStr (inPutWaveName,outPutWaveName)))) throw result = OVERWRITEALERT;
+		// make the output wave, with a layer for each statistic
+		outPutDimensionSizes [0] = inPutDimensionSizes [0];
+		outPutDimensionSizes [1] = inPutDimensionSizes [1];
+		outPutDimensionSizes [LAYERS] = doMinMax ? 5 : 3;
+		outPutDimensionSizes [3] = 0;
+		//No liberal wave names for output wave
+		CleanupName (0, outPutWaveName, MAX_OBJ_NAME);
+		XFuncTimerPhase (&timer, STATS_MAKEWAVE);
+		if (MDMakeWave (&outPutWaveH, outPutWaveName, outPutDFHandle, outPutDimensionSizes, KalmanStatsOutPutType (inPutWaveType), overWrite)) throw result = WAVEERROR_NOS;
+		for (iLayer = 0; iLayer < outPutDimensionSizes [LAYERS]; iLayer++){
+			MDSetDimensionLabel (outPutWaveH, LAYERS, iLayer, (char*)layerLabels [iLayer]);
+		}
+		XFuncTimerPhase (&timer, STATS_THREADS);
+		//Get data offsets for the 2 waves
+		if (MDAccessNumericWaveData(inPutWaveH, kMDWaveAccessMode0, &inPutOffset)) throw result = WAVEERROR_NOS;
+		if (MDAccessNumericWaveData(outPutWaveH, kMDWaveAccessMode0, &outPutOffset)) throw result = WAVEERROR_NOS;
+		// fill paramater structure
+		params.inPutWaveType = inPutWaveType;
+		params.inPutDataStartPtr = (char*)(*inPutWaveH) + inPutOffset;
+		params.outPutDataStartPtr = (char*)(*outPutWaveH) + outPutOffset;
+		params.xSize = inPutDimensionSizes [0];
+		params.ySize = inPutDimensionSizes [1];
+		params.zSize = inPutDimensionSizes [LAYERS];
+		params.doMinMax = doMinMax;
+		// run the tiles on the thread pool, and wait till they are all finished
+		XFuncTimerPhase (&timer, STATS_COMPUTE);
+		if ((result = KalmanStatsRunTiles (&params)) != 0) throw result;
+	}catch (int result){
+		XFuncTimerEnd (&timer);
+		WMDisposeHandle(p->outPutPath);  // dispose passed in string paramater
+		p -> result = (double)(result - FIRST_XOP_ERR);
+#ifdef NO_IGOR_ERR
+		return (0);
+#else
+		return (result);
+#endif
+	}
+	XFuncTimerPhase (&timer, STATS_FINISH);
+	WMDisposeHandle(p->outPutPath);    // dispose passed in string paramater
+	// Inform Igor that we have changed output wave
+	WaveHandleModified(outPutWaveH);
+	p -> result = (0);
+	XFuncTimerEnd (&timer);
+	return (0);
+}
+
+
+/* KalmanInterleaved XOP entry function
+ Averages each channel of a 3D wave with channels interleaved layer by layer (channel 0, channel 1, channel 0,
+ channel 1...), straight from the interleaved wave, in a single pass, without first copying each channel into its own
+ wave. The layers of each channel are binned into groups of nFrames layers, or all taken as one group if nFrames is 0.
+ The output has a layer for each channel in each group, interleaved in the same order as the input. Layers left over
+ at the end, fewer than nFrames for every channel, are not used
+ KalmanInterleavedParams
+ inPutWaveH     handle to a 3D input wave
+ outPutPath     A handle to a string containing path to output wave we want to make, or empty string to overwrite input wave
+ nChannels      number of channels interleaved in the input wave
+ nFrames        number of layers of each channel averaged into each output layer, or 0 to average all of them
+ multiplier     Multiplier for,e.g., 16 bit waves containing less than 16 bits of data, as for KalmanAllFrames
+ overWrite      0 to give errors when wave already exists. non-zero to overwrite existing wave without warning.
+ exact          0 for a running average, non-zero to sum the layers and divide once, as for KalmanAllFrames
+ result         0 for success, error code for failure
+ Last Modified 2026/10/16 */
+extern "C" int KalmanInterleaved (KalmanInterleavedParamsPtr p) {
+	int result = 0;	// The error returned from various Wavemetrics functions
+	waveHndl inPutWaveH = NULL, outPutWaveH = NULL;	// Handles to the input and output waves
+	int inPutWaveType;	// Wavemetrics numeric code for data type of wave
+	int inPutDimensions;		// The number of dimensions used in the input wave
+	CountInt inPutOffset, outPutOffset; //offset in bytes from begnning of handle to a wave to the actual data - size of headers, units, etc.
+	CountInt inPutDimensionSizes[MAX_DIMENSIONS+1];	// An array used to hold the sizes of each dimension of the input wave
+	DataFolderHandle inPutDFHandle, outPutDFHandle;	// Handle to the datafolder where we will put the output wave
+	DFPATH inPutPath, outPutPath;	// string to hold data folder path of input wave
+	WVNAME inPutWaveName, outPutWaveName;	// C string to hold name of input wave
+	UInt8 overWrite = (p->overWrite != 0);	// 0 to not overwrite output wave if it already exists, 1 to overwrite old waves
+	UInt8 isOverWriting; // non-zero if output is overwriting input wave
+	CountInt zSize, nChannels, nFrames, nGroups;
+	KalmanThreadParams params;  // paramaters for the tiles
+	XFuncTimer timer;  // times each phase of this call, for TwoPhotonStats
+	XFuncTimerStart (&timer, STATS_KALMANINTERLEAVED);
+	try {
+		// Get handle to input wave.
+		inPutWaveH = p ->inPutWaveH;
+		if(inPutWaveH == NIL)throw result = NON_EXISTENT_WAVE;
+		// get wave data type and check that we don't have a text wave
+		inPutWaveType = WaveType(inPutWaveH);
+		if (inPutWaveType==TEXT_WAVE_TYPE) throw result = NOTEXTWAVES;
+		//Get number of used dimensions in input wave.
+		if (MDGetWaveDimensions(inPutWaveH, &inPutDimensions, inPutDimensionSizes))throw result = WAVEERROR_NOS;
+		// Check that input wave is 3D
+		if (inPutDimensions != 3) throw result = INPUTNEEDS_3D_WAVE;
+		zSize = inPutDimensionSizes [LAYERS];
+		// check number of channels, and number of layers of each channel in a group
+		if ((p->nChannels < 1) || (p->nChannels > zSize)) throw result = BADCHANNELCOUNT;
+		nChannels = (CountInt)p->nChannels;
+		if ((p->nFrames < 0) || (p->nFrames > zSize/nChannels)) throw result = BADLAYERCOUNT;
+		nFrames = (p->nFrames < 1) ? zSize/nChannels : (CountInt)p->nFrames;
+		nGroups = zSize/(nFrames * nChannels);
+		// If outPutPath is empty string, we are overwriting existing wave
+		if (WMGetHandleSize (p->outPutPath) == 0){
+			if (overWrite == NO_OVERWITE) throw result = OVERWRITEALERT;
+			outPutWaveH = inPutWaveH;
+			isOverWriting = 1;
+		}else{ // Parse outPut path
+			ParseWavePath (p->outPutPath, outPutPath, outPutWaveName);
+			//check that data folder is valid and get a handle to the datafolder
+			if (GetNamedDataFolder (NULL, outPutPath, &outPutDFHandle))throw result = WAVEERROR_NOS;
+			// Test name and data folder for output wave against the input wave to prevent accidental overwriting, if src and dest are the same
+			WaveName (inPutWaveH, inPutWaveName);
+			if (GetWavesDataFolder (inPutWaveH, &inPutDFHandle)) throw result = WAVEERROR_NOS;
+			if (GetDataFolderNameOrPath (inPutDFHandle, 1, inPutPath)) throw result = WAVEERROR_NOS;
+			if ((!(CmpStr (inPutPath,outPutPath))) && (!(CmpStr (inPutWaveName,outPutWaveName)))){	// Then we would overwrite wave
+				isOverWriting = 1;
+				if (overWrite == NO_OVERWITE) throw result = OVERWRITEALERT;
+				outPutWaveH = inPutWaveH;
+			}else{
+				isOverWriting = 0;
+				// make the output wave, with one layer for each channel in each group
+				inPutDimensionSizes [LAYERS] = nGroups * nChannels;
+				//No liberal wave names for output wave
+				CleanupName (0, outPutWaveName, MAX_OBJ_NAME);
+				XFuncTimerPhase (&timer, STATS_MAKEWAVE);
+				if (MDMakeWave (&outPutWaveH, outPutWaveName, outPutDFHandle, inPutDimensionSizes, inPutWaveType, overWrite)) throw result = WAVEERROR_NOS;
+				XFuncTimerPhase (&timer, STATS_THREADS);
+			}
+		}
+		//Get data offsets for the 2 waves (1 wave, if overwriting)
+		if (MDAccessNumericWaveData(inPutWaveH, kMDWaveAccessMode0, &inPutOffset)) throw result = WAVEERROR_NOS;
+		if (MDAccessNumericWaveData(outPutWaveH, kMDWaveAccessMode0, &outPutOffset)) throw result = WAVEERROR_NOS;
+		XFuncTimerPhase (&timer, STATS_THREADS);
+		// fill paramater structure
+		params.inPutWaveType = inPutWaveType;
+		params.inPutDataStartPtr = (char*)(*inPutWaveH) + inPutOffset;
+		params.outPutDataStartPtr = (char*)(*outPutWaveH) + outPutOffset;
+		params.startLayer = 0;
+		params.outPutLayer = 0;
+		params.xSize = inPutDimensionSizes [0];
+		params.ySize = inPutDimensionSizes [1];
+		params.zSize = nFrames;
+		params.nGroups = nGroups;
+		params.nChannels = nChannels;
+		params.multiplier = (float)(p->multiplier);
+		params.exact = (p->exact != 0);
+		// run the tiles on the thread pool, and wait till they are all finished
+		XFuncTimerPhase (&timer, STATS_COMPUTE);
+		if ((result = KalmanRunTiles (&params)) != 0) throw result;
+	}catch (int result){
+		XFuncTimerEnd (&timer);
+		WMDisposeHandle(p->outPutPath);  // dispose passed in string paramater
+		p -> result = (double)(result - FIRST_XOP_ERR);
+#ifdef NO_IGOR_ERR
+		return (0);
+#else
+		return (result);
+#endif
+	}
+	XFuncTimerPhase (&timer, STATS_FINISH);
+	WMDisposeHandle(p->outPutPath);    // dispose passed in string paramater
+	if (isOverWriting){	// then the averages are in the first layers of the input wave
+		inPutDimensionSizes [0] = -1;
+		inPutDimensionSizes [1] = -1;
+		inPutDimensionSizes [2] = nGroups * nChannels;
+		inPutDimensionSizes [3] = 0;
+		MDChangeWave (outPutWaveH, -1, inPutDimensionSizes);
+	}
+	// Inform Igor that we have changed output wave
+	WaveHandleModified(outPutWaveH);
+	p -> result = (0);
+	XFuncTimerEnd (&timer);
+	return (0);
+}
+
+
+/* KalmanRobust XOP entry function
+ Averages all the layers of a 3D wave into a 2D wave, as for KalmanAllFrames, but with an average that is not thrown
+ off by a few bad layers, like laser flicker, stage bumps, or spikes from the PMT. Each point's column of layers is
+ copied into a buffer that stays in cache while it is averaged in several passes
+ KalmanRobustParams
+ inPutWaveH     handle to a 3D input wave
+ outPutPath     A handle to a string containing path to output wave we want to make, or empty string to overwrite input wave
+ mode           0 for a sigma clipped mean, leaving out points more than threshold standard deviations from the mean of
+                the points that are left, till no more points are left out. 1 for a Winsorized mean, with the threshold
+                fraction of the points at each end replaced by the nearest point that is kept. 2 for a trimmed mean,
+                with the threshold fraction of the points at each end left out
+ threshold      standard deviations for sigma clipping, greater than 0, or fraction of points at each end for
+                Winsorizing or trimming, from 0 to less than 0.5
+ overWrite      0 to give errors when wave already exists. non-zero to overwrite existing wave without warning.
+ result         0 for success, error code for failure
+ Last Modified 2026/10/16 */
+extern "C" int KalmanRobust (KalmanRobustParamsPtr p) {
+	int result = 0;	// The error returned from various Wavemetrics functions
+	waveHndl inPutWaveH = NULL, outPutWaveH = NULL;	// Handles to the input and output waves
+	int inPutWaveType;	// Wavemetrics numeric code for data type of wave
+	int inPutDimensions;		// The number of dimensions used in the input wave
+	CountInt inPutOffset, outPutOffset; //offset in bytes from begnning of handle to a wave to the actual data - size of headers, units, etc.
+	CountInt inPutDimensionSizes[MAX_DIMENSIONS+1];	// An array used to hold the sizes of each dimension of the input wave
+	DataFolderHandle inPutDFHandle, outPutDFHandle;	// Handle to the datafolder where we will put the output wave
+	DFPATH inPutPath, outPutPath;	// string to hold data folder path of input wave
+	WVNAME inPutWaveName, outPutWaveName;	// C string to hold name of input wave
+	UInt8 overWrite = (p->overWrite != 0);	// 0 to not overwrite output wave if it already exists, 1 to overwrite old waves
+	UInt8 isOverWriting; // non-zero if output is overwriting input wave
+	CountInt zSize;
+	KalmanRobustThreadParams params;  // paramaters for the tiles
+	XFuncTimer timer;  // times each phase of this call, for TwoPhotonStats
+	XFuncTimerStart (&timer, STATS_KALMANROBUST);
+	try {
+		// Get handle to input wave.
+		inPutWaveH = p ->inPutWaveH;
+		if(inPutWaveH == NIL)throw result = NON_EXISTENT_WAVE;
+		// get wave data type and check that we don't have a text wave
+		inPutWaveType = WaveType(inPutWaveH);
+		if (inPutWaveType==TEXT_WAVE_TYPE) throw result = NOTEXTWAVES;
+		//Get number of used dimensions in input wave.
+		if (MDGetWaveDimensions(inPutWaveH, &inPutDimensions, inPutDimensionSizes))throw result = WAVEERROR_NOS;
+		// Check that input wave is 3D
+		if (inPutDimensions != 3) throw result = INPUTNEEDS_3D_WAVE;
+		zSize = inPutDimensionSizes [LAYERS];
+		// check mode and threshold
+		if (p->mode == KALMAN_ROBUST_SIGMA){
+			if (!(p->threshold > 0)) throw result = BADROBUSTMODE;
+		}else if ((p->mode == KALMAN_ROBUST_WINSOR) || (p->mode == KALMAN_ROBUST_TRIM)){
+			if (!((p->threshold >= 0) && (p->threshold < 0.5))) throw result = BADROBUSTMODE;
+		}else{
+			throw result = BADROBUSTMODE;
+		}
+		// If outPutPath is empty string, we are overwriting existing wave
+		if (WMGetHandleSize (p->outPutPath) == 0){
+			if (overWrite == NO_OVERWITE) throw result = OVERWRITEALERT;
+			outPutWaveH = inPutWaveH;
+			isOverWriting = 1;
+		}else{ // Parse outPut path
+			ParseWavePath (p->outPutPath, outPutPath, outPutWaveName);
+			//check that data folder is valid and get a handle to the datafolder
+			if (GetNamedDataFolder (NULL, outPutPath, &outPutDFHandle))throw result = WAVEERROR_NOS;
+			// Test name and data folder for output wave against the input wave to prevent accidental overwriting, if src and dest are the same
+			WaveName (inPutWaveH, inPutWaveName);
+			if (GetWavesDataFolder (inPutWaveH, &inPutDFHandle)) throw result = WAVEERROR_NOS;
+			if (GetDataFolderNameOrPath (inPutDFHandle, 1, inPutPath)) throw result = WAVEERROR_NOS;
+			if ((!(CmpStr (inPutPath,outPutPath))) && (!(CmpStr (inPutWaveName,outPutWaveName)))){	// Then we would overwrite wave
+				isOverWriting = 1;
+				if (overWrite == NO_OVERWITE) throw result = OVERWRITEALERT;
+				outPutWaveH = inPutWaveH;
+			}else{
+				isOverWriting = 0;
+				// make the 2D output wave
+				inPutDimensionSizes [LAYERS] = 0;
+				//No liberal wave names for output wave
+				CleanupName (0, outPutWaveName, MAX_OBJ_NAME);
+				XFuncTimerPhase (&timer, STATS_MAKEWAVE);
+				if (MDMakeWave (&outPutWaveH, outPutWaveName, outPutDFHandle, inPutDimensionSizes, inPutWaveType, overWrite)) throw result = WAVEERROR_NOS;
+				XFuncTimerPhase (&timer, STATS_THREADS);
+			}
+		}
+		//Get data offsets for the 2 waves (1 wave, if overwriting)
+		if (MDAccessNumericWaveData(inPutWaveH, kMDWaveAccessMode0, &inPutOffset)) throw result = WAVEERROR_NOS;
+		if (MDAccessNumericWaveData(outPutWaveH, kMDWaveAccessMode0, &outPutOffset)) throw result = WAVEERROR_NOS;
+		XFuncTimerPhase (&timer, STATS_THREADS);
+		// fill paramater structure
+		params.inPutWaveType = inPutWaveType;
+		params.inPutDataStartPtr = (char*)(*inPutWaveH) + inPutOffset;
+		params.outPutDataStartPtr = (char*)(*outPutWaveH) + outPutOffset;
+		params.xSize = inPutDimensionSizes [0];
+		params.ySize = inPutDimensionSizes [1];
+		params.zSize = zSize;
+		params.mode = (UInt8)p->mode;
+		params.threshold = p->threshold;
+		// run the tiles on the thread pool, and wait till they are all finished
+		XFuncTimerPhase (&timer, STATS_COMPUTE);
+		if ((result = KalmanRobustRunTiles (&params)) != 0) throw result;
+	}catch (int result){
+		XFuncTimerEnd (&timer);
+		WMDisposeHandle(p->outPutPath);  // dispose passed in string paramater
+		p -> result = (double)(result - FIRST_XOP_ERR);
+#ifdef NO_IGOR_ERR
+		return (0);
+#else
+		return (result);
+#endif
+	}
+	XFuncTimerPhase (&timer, STATS_FINISH);
+	WMDisposeHandle(p->outPutPath);    // dispose passed in string paramater
+	if (isOverWriting){	//then collapsing a 3D wave to 2 D
+		inPutDimensionSizes [0] = -1;
+		inPutDimensionSizes [1] = -1;
+		inPutDimensionSizes [2] = 0;
+		inPutDimensionSizes [3] = 0;
+		MDChangeWave (outPutWaveH, -1, inPutDimensionSizes);
+	}
+	// Inform Igor that we have changed output wave
+	WaveHandleModified(outPutWaveH);
+	p -> result = (0);
+	XFuncTimerEnd (&timer);
+	return (0);
+}
+
+
+/* TriggeredAverage XOP entry function
+ Averages windows of layers around each of a list of trigger layers, for stimulus-locked analysis, into a new 3D wave,
+ a peri-event movie of nPre + nPost + 1 layers, in one pass over the input and without copying the window around each
+ trigger. Layer n of the output is the average over the triggers of input layer trigger - nPre + n. Triggers are
+ rounded to the nearest layer, and triggers whose whole window is not inside the input wave are not used. Sums are
+ divided once, rounding to nearest, as for exact averaging with KalmanAllFrames. The layer scaling of the output is
+ that of the input, offset so the trigger layer is at 0
+ TriggeredAverageParams
+ inPutWaveH     handle to a 3D input wave
+ triggerWaveH   handle to a real numeric wave of the input layers at each trigger, with at least one point
+ outPutPath     A handle to a string containing path to output wave we want to make
+ nPre           number of layers before each trigger layer in each window
+ nPost          number of layers after each trigger layer in each window
+ overWrite      0 to give errors when wave already exists. non-zero to overwrite existing wave without warning.
+ result         0 for success, error code for failure
+ Last Modified 2026/10/16 */
+extern "C" int TriggeredAverage (TriggeredAverageParamsPtr p) {
+	int result = 0;	// The error returned from various Wavemetrics functions
+	waveHndl inPutWaveH = NULL, triggerWaveH = NULL, outPutWaveH = NULL;	// Handles to the input, trigger, and output waves
+	int inPutWaveType;	// Wavemetrics numeric code for data type of wave
+	int inPutDimensions;		// The number of dimensions used in the input wave
+	CountInt inPutOffset, outPutOffset; //offset in bytes from begnning of handle to a wave to the actual data - size of headers, units, etc.
+	CountInt inPutDimensionSizes[MAX_DIMENSIONS+1];	// An array used to hold the sizes of each dimension of the input wave
+	DataFolderHandle inPutDFHandle, outPutDFHandle;	// Handle to the datafolder where we will put the output wave
+	DFPATH inPutPath, outPutPath;	// string to hold data folder path of input wave
+	WVNAME inPutWaveName, outPutWaveName;	// C string to hold name of input wave
+	UInt8 overWrite = (p->overWrite != 0);	// 0 to not overwrite output wave if it already exists, 1 to overwrite old waves
+	CountInt zSize, nPre, nPost, nWindow, nTriggerPnts, iTrigger, startLayer;
+	double* triggersPtr = nullptr;	// the trigger wave, as doubles
+	double zDelta, zOffset;	// layer scaling of the input wave
+	TriggeredAverageThreadParams params;  // paramaters for the tiles
+	params.startLayersPtr = nullptr;
+	XFuncTimer timer;  // times each phase of this call, for TwoPhotonStats
+	XFuncTimerStart (&timer, STATS_TRIGGEREDAVERAGE);
+	try {
+		// Get handle to input wave.
+		inPutWaveH = p ->inPutWaveH;
+		if(inPutWaveH == NIL)throw result = NON_EXISTENT_WAVE;
+		// get wave data type and check that we don't have a text wave
+		inPutWaveType = WaveType(inPutWaveH);
+		if (inPutWaveType==TEXT_WAVE_TYPE) throw result = NOTEXTWAVES;
+		//Get number of used dimensions in input wave.
+		if (MDGetWaveDimensions(inPutWaveH, &inPutDimensions, inPutDimensionSizes))throw result = WAVEERROR_NOS;
+		// Check that input wave is 3D
+		if (inPutDimensions != 3) throw result = INPUTNEEDS_3D_WAVE;
+		zSize = inPutDimensionSizes [LAYERS];
+		// check window size
+		if ((p->nPre < 0) || (p->nPost < 0) || (p->nPre + p->nPost + 1 > zSize)) throw result = BADLAYERCOUNT;
+		nPre = (CountInt)p->nPre;
+		nPost = (CountInt)p->nPost;
+		nWindow = nPre + nPost + 1;
+		// get trigger wave, as doubles, and keep the start layers of the windows that are inside the input wave
+		triggerWaveH = p->triggerWaveH;
+		if (triggerWaveH == NIL) throw result = NON_EXISTENT_WAVE;
+		if (WaveType (triggerWaveH) == TEXT_WAVE_TYPE) throw result = NOTEXTWAVES;
+		// complex trigger waves would give MDGetDPDataFromNumericWave two doubles for each point
+		if (WaveType (triggerWaveH) & NT_CMPLX) throw result = NUMTYPE;
+		nTriggerPnts = WavePoints (triggerWaveH);
+		if (nTriggerPnts == 0) throw result = NOTRIGGERS;
+		triggersPtr = (double*)WMNewPtr (nTriggerPnts * sizeof (double));
+		params.startLayersPtr = (CountInt*)WMNewPtr (nTriggerPnts * sizeof (CountInt));
+		if ((triggersPtr == nullptr) || (params.startLayersPtr == nullptr)) throw result = MEMFAIL;
+		if (MDGetDPDataFromNumericWave (triggerWaveH, triggersPtr)) throw result = WAVEERROR_NOS;
+		params.nTriggers = 0;
+		for (iTrigger = 0; iTrigger < nTriggerPnts; iTrigger++){
+			if (!((triggersPtr [iTrigger] - nPre >= -0.5) && (triggersPtr [iTrigger] + nPost < zSize - 0.5))) continue;	// also leaves out NaNs
+			startLayer = (CountInt)(triggersPtr [iTrigger] + 0.5) - nPre;
+			params.startLayersPtr [params.nTriggers++] = startLayer;
+		}
+		if (params.nTriggers == 0) throw result = NOTRIGGERS;
+		// output wave is always a new wave
+		if (WMGetHandleSize (p->outPutPath) == 0) throw result = OVERWRITEALERT;
+		ParseWavePath (p->outPutPath, outPutPath, outPutWaveName);
+		//check that data folder is valid and get a handle to the datafolder
+		if (GetNamedDataFolder (NULL, outPutPath, &outPutDFHandle))throw result = WAVEERROR_NOS;
+		// Test name and data folder for output wave against the input wave to prevent overwriting the input wave
+		WaveName (inPutWaveH, inPutWaveName);
+		if (GetWavesDataFolder (inPutWaveH, &inPutDFHandle)) throw result = WAVEERROR_NOS;
+		if (GetDataFolderNameOrPath (inPutDFHandle, 1, inPutPath)) throw result = WAVEERROR_NOS;
+		if ((!(CmpStr (inPutPath,outPutPath))) && (!(CmpStr (inPutWaveName,outPutWaveName)))) throw result = OVERWRITEALERT;
+		// make the output wave, with one layer for each layer of the window, scaled so the trigger layer is at 0
+		inPutDimensionSizes [LAYERS] = nWindow;
+		//No liberal wave names for output wave
+		CleanupName (0, outPutWaveName, MAX_OBJ_NAME);
+		XFuncTimerPhase (&timer, STATS_MAKEWAVE);
+		if (MDMakeWave (&outPutWaveH, outPutWaveName, outPutDFHandle, inPutDimensionSizes, inPutWaveType, overWrite)) throw result = WAVEERROR_NOS;
+		if (MDGetWaveScaling (inPutWaveH, LAYERS, &zDelta, &zOffset)) throw result = WAVEERROR_NOS;
+		zOffset = -nPre * zDelta;
+		if (MDSetWaveScaling (outPutWaveH, LAYERS, &zDelta, &zOffset)) throw result = WAVEERROR_NOS;
+		XFuncTimerPhase (&timer, STATS_THREADS);
+		//Get data offsets for the 2 waves
+		if (MDAccessNumericWaveData(inPutWaveH, kMDWaveAccessMode0, &inPutOffset)) throw result = WAVEERROR_NOS;
+		if (MDAccessNumericWaveData(outPutWaveH, kMDWaveAccessMode0, &outPutOffset)) throw result = WAVEERROR_NOS;
+		// fill paramater structure
+		params.inPutWaveType = inPutWaveType;
+		params.inPutDataStartPtr = (char*)(*inPutWaveH) + inPutOffset;
+		params.outPutDataStartPtr = (char*)(*outPutWaveH) + outPutOffset;
+		params.xSize = inPutDimensionSizes [0];
+		params.ySize = inPutDimensionSizes [1];
+		params.zSize = zSize;
+		params.nWindow = nWindow;
+		// run the tiles on the thread pool, and wait till they are all finished
+		XFuncTimerPhase (&timer, STATS_COMPUTE);
+		if ((result = TriggeredAverageRunTiles (&params)) != 0) throw result;
+	}catch (int result){
+		XFuncTimerEnd (&timer);
+		WMDisposeHandle(p->outPutPath);  // dispose passed in string paramater
+		if (triggersPtr != nullptr) WMDisposePtr ((Ptr)triggersPtr);
+		if (params.startLayersPtr != nullptr) WMDisposePtr ((Ptr)params.startLayersPtr);
+		p -> result = (double)(result - FIRST_XOP_ERR);
+#ifdef NO_IGOR_ERR
+		return (0);
+#else
+		return (result);
+#endif
+	}
+	XFuncTimerPhase (&timer, STATS_FINISH);
+	WMDisposeHandle(p->outPutPath);    // dispose passed in string paramater
+	WMDisposePtr ((Ptr)triggersPtr);
+	WMDisposePtr ((Ptr)params.startLayersPtr);
+	// Inform Igor that we have changed output wave
+	WaveHandleModified(outPutWaveH);
+	p -> result = (0);
+	XFuncTimerEnd (&timer);
 	return (0);
 }
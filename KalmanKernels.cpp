@@ -0,0 +1,1025 @@
+#include "twoPhotonKernels.h"
+#include <limits>
+/* ---------------------------------------------Kalman Kernels----------------------------------------------------------
+ Templates and tile functions for Kalman averaging of frames in a 3d wave, 2d wave, or a list of waves.
+ The XFUNCs that call them are in Kalman.cpp
+ Last Modified 2026/10/16
+ ---------------------------------------------------------------------------------------------------------------*/
+
+/* Does the running average loops of KalmanT with the SSE4.1 or AVX2 loops, if gSIMDLevel allows and there are few enough
+ layers for them. Returns non-zero if the scalar loops must be used
+ Last Modified 2026/10/16 */
+template <typename T> int KalmanLayersSIMD (T* srcWave, T* destWaveStart, CountInt pixPerThread, CountInt pixToNextFrame, CountInt numLayers, float multiplier){
+	if (numLayers > KALMAN_SIMD_MAX_LAYERS) return 1;
+	switch (gSIMDLevel){
+		case CPU_SIMD_AVX2:
+			return KalmanLayersAVX2 (srcWave, destWaveStart, pixPerThread, pixToNextFrame, numLayers, multiplier);
+		case CPU_SIMD_SSE41:
+			return KalmanLayersSSE41 (srcWave, destWaveStart, pixPerThread, pixToNextFrame, numLayers, multiplier);
+		default:
+			return 1;
+	}
+}
+
+/* The following template is used to handle any one of the 8 types of wave data, for any of the three Kalman averaging functions
+ for 3D waves. The running average over the layers after the first is done with SIMD loops when the CPU has them
+ Last modified 2026/10/16 */
+template <typename T> int KalmanT(T *srcWaveStart, T *destWaveStart, CountInt pixPerThread, CountInt pixToNextFrame, CountInt numLayers, float multiplier) {
+	T* destWaveEnd = destWaveStart + pixPerThread;	// End of the output layer we are putting the average into
+	T* srcWave, *destWave;	// pointers used to iterate through source wave and destination wave
+	/* If multiplier is < 1, use standard averaging across layers with a floating point temporary value */
+	if (multiplier < 1){
+		double tempVal;
+		CountInt pixPerLayer = pixPerThread + pixToNextFrame;
+		T* srcWaveEnd = srcWaveStart + (numLayers * pixPerLayer);
+		CountInt toNextSrcPix = (numLayers * pixPerLayer) - 1;
+		for (srcWave = srcWaveStart, destWave = destWaveStart ; destWave < destWaveEnd ; srcWave -= toNextSrcPix, destWave ++){			for (tempVal =0; srcWave < srcWaveEnd; srcWave += pixPerLayer)
+			tempVal += *srcWave;
+            *destWave = tempVal/numLayers;
+		}
+	}else{
+		CountInt layer; // used to iterate through layers
+		// Special stuff for first frame
+		if (srcWaveStart == destWaveStart){	//this happens when collapsing a wave into the first frame
+			if (multiplier > 1){
+				//Multiply the first layer by Multiplier
+				for (destWave = destWaveStart; destWave < destWaveEnd; destWave++){
+					*destWave *= multiplier;
+				}
+			}
+			// position src wave pointer at start of 2nd frame
+			srcWave = srcWaveStart + pixPerThread + pixToNextFrame;
+		}else{ //srcwave and dsetwave are different
+			if (multiplier > 1){ // To increase precision in averaging in special instances where, for example, 16 bit waves contain less than 16 bits of data
+				// Set output layer = first layer of input wave * Multiplier
+				for (destWave = destWaveStart, srcWave = srcWaveStart; destWave < destWaveEnd; destWave++, srcWave++){
+					*destWave = *srcWave * multiplier;
+				}
+			}else{ // first frame when No Multiplier, and Src and dest are different
+				for (destWave = destWaveStart, srcWave = srcWaveStart; destWave < destWaveEnd; destWave++, srcWave++){
+					*destWave = *srcWave;
+				}
+			}
+			// advance src wave pointer to start of next frame
+			srcWave += pixToNextFrame;
+		}
+		//For each remaining layer in input wave, iterate through, averaging the input value into the output layer, with SIMD loops if we can
+		if (KalmanLayersSIMD (srcWave, destWaveStart, pixPerThread, pixToNextFrame, numLayers, multiplier) != 0){
+			if (multiplier > 1){
+				for(layer=1; layer < numLayers; layer++, srcWave += pixToNextFrame) {
+					for (destWave = destWaveStart; destWave < destWaveEnd; destWave++, srcWave++){
+						*destWave = ((*destWave * layer) + *srcWave * multiplier)/(layer + 1);
+					}
+				}
+			}else{ // no multiplier
+				for(layer=1; layer < numLayers; layer++, srcWave += pixToNextFrame) {
+					for (destWave = destWaveStart; destWave < destWaveEnd; destWave++, srcWave++){
+						*destWave = ((*destWave * layer) + *srcWave)/(layer + 1);
+					}
+				}
+			}
+		}
+		if (multiplier > 1){
+			// Divide output layer by Multiplier
+			for (destWave = destWaveStart;destWave < destWaveEnd; destWave++){
+				*destWave /= multiplier;
+			}
+		}
+	}
+	return 0;
+}
+
+
+/* Divides the sum of numLayers points once, for exact averaging. Integer sums are rounded to the nearest whole number,
+ with halves rounded away from zero. Floating point sums are rounded to the wave type when they are stored
+ Last Modified 2026/10/16 */
+template <typename A> inline A KalmanExactDivide (A sum, CountInt numLayers){
+	A half = (A)(numLayers/2);
+	return (sum < 0) ? (sum - half)/(A)numLayers : (sum + half)/(A)numLayers;
+}
+
+template <> inline double KalmanExactDivide (double sum, CountInt numLayers){
+	return sum/numLayers;
+}
+
+/* Exact averaging of numLayers layers: sums the layers for each point in an accumulator of type A, wide enough that no
+ sum can overflow, then divides once. There is no divide for each layer, as in the running average of KalmanT, and no
+ multiplier is needed to keep precision. The tile is done in blocks of KALMAN_EXACT_BLOCK points, adding each layer to
+ the whole block before going on to the next layer, so each layer is read as one sequential run per block and the sums
+ stay in cache. accPtr is a buffer of KALMAN_EXACT_BLOCK sums for this thread. srcWaveStart may be the same as
+ destWaveStart, when collapsing a wave into its first frame, as each block is written only after it has been read
+ Last Modified 2026/10/16 */
+template <typename T, typename A> int KalmanExactT (T* srcWaveStart, T* destWaveStart, CountInt pixPerThread, CountInt pixToNextFrame, CountInt numLayers, A* accPtr){
+	CountInt pixPerLayer = pixPerThread + pixToNextFrame;
+	CountInt blockStart, blockSize, iPix, layer;
+	T* srcPtr;
+	T* destPtr;
+	for (blockStart = 0; blockStart < pixPerThread; blockStart += blockSize){
+		blockSize = ((pixPerThread - blockStart) < KALMAN_EXACT_BLOCK) ? (pixPerThread - blockStart) : KALMAN_EXACT_BLOCK;
+		srcPtr = srcWaveStart + blockStart;
+		destPtr = destWaveStart + blockStart;
+		for (iPix = 0; iPix < blockSize; iPix++){
+			accPtr [iPix] = srcPtr [iPix];
+		}
+		for (layer = 1; layer < numLayers; layer++){
+			srcPtr += pixPerLayer;
+			for (iPix = 0; iPix < blockSize; iPix++){
+				accPtr [iPix] += srcPtr [iPix];
+			}
+		}
+		for (iPix = 0; iPix < blockSize; iPix++){
+			destPtr [iPix] = (T)KalmanExactDivide (accPtr [iPix], numLayers);
+		}
+	}
+	return 0;
+}
+
+// bytes of each tile taken through all the layers at a time by KalmanAverageT, a quarter of the L2 cache of a thread,
+// leaving room for the layers streaming past
+CountInt gKalmanBlockBytes = CPUTopologyL2Bytes ()/4;
+
+/* Averages the layers for one tile, with exact averaging if there is a buffer of sums for this thread, else with KalmanT.
+ KalmanT is given blocks of gKalmanBlockBytes of the tile, each taken through all the layers before the next, so the
+ running average of a block stays in L2 cache while the layers stream past it. Exact sums are 32 bit for 8 and 16 bit
+ points, unless there are more than KALMAN_EXACT_I32_LAYERS layers, 64 bit for 32 bit points, and double for floating
+ point points, and are blocked by KalmanExactT
+ Last Modified 2026/10/16 */
+template <typename T> int KalmanAverageT (T* srcWaveStart, T* destWaveStart, CountInt pixPerThread, CountInt pixToNextFrame, CountInt numLayers, float multiplier, SInt64* accPtr){
+	if (accPtr == nullptr){
+		CountInt blockPix = gKalmanBlockBytes/sizeof (T);
+		CountInt blockStart, blockSize;
+		if (blockPix < 1) blockPix = pixPerThread;
+		for (blockStart = 0; blockStart < pixPerThread; blockStart += blockSize){
+			blockSize = ((pixPerThread - blockStart) < blockPix) ? (pixPerThread - blockStart) : blockPix;
+			KalmanT (srcWaveStart + blockStart, destWaveStart + blockStart, blockSize, pixToNextFrame + pixPerThread - blockSize, numLayers, multiplier);
+		}
+		return 0;
+	}else if (!std::numeric_limits<T>::is_integer){
+		return KalmanExactT (srcWaveStart, destWaveStart, pixPerThread, pixToNextFrame, numLayers, (double*)accPtr);
+	}else if ((sizeof (T) <= 2) && (numLayers <= KALMAN_EXACT_I32_LAYERS)){
+		return KalmanExactT (srcWaveStart, destWaveStart, pixPerThread, pixToNextFrame, numLayers, (SInt32*)accPtr);
+	}else{
+		return KalmanExactT (srcWaveStart, destWaveStart, pixPerThread, pixToNextFrame, numLayers, accPtr);
+	}
+}
+
+/* Each tile of pixels to do Kalman averaging, from startPos up to endPos, is done with this function. The groups are
+ done one after another, so when averaging in place, the output layer for a group has been read before it is written.
+ For interleaved channels, each channel is averaged straight from the interleaved layers, stepping over the layers of
+ the other channels, into its own output layer. When averaging in place, the output layer for a channel in the first
+ group is that channel's own first layer
+ Last Modified 2026/10/16 */
+void KalmanTile (void* paramsPtr, CountInt startPos, CountInt endPos, UInt32 iSlot){
+	struct KalmanThreadParams* p;
+	p = (struct KalmanThreadParams*) paramsPtr;
+	CountInt xSize= p->xSize;
+	CountInt ySize = p->ySize;
+	CountInt zSize = p->zSize;
+	float multiplier = p->multiplier;
+	SInt64* accPtr = (p->accBufferPtr != nullptr) ? p->accBufferPtr + iSlot * KALMAN_EXACT_BLOCK : nullptr;
+	CountInt frameSize = ySize * xSize;
+	CountInt pixPerTile = endPos - startPos;
+	CountInt nChannels = p->nChannels;
+	CountInt pixToNextFrame = nChannels * frameSize - pixPerTile;
+	CountInt iGroup, iChannel, iOut, srcStart, destStart;
+	int result = 0;
+	for (iOut = 0; (iOut < p->nGroups * nChannels) && (result == 0); iOut++){
+		iGroup = iOut/nChannels;
+		iChannel = iOut - iGroup * nChannels;
+		srcStart = ((p->startLayer + iGroup * zSize * nChannels + iChannel) * frameSize) + startPos;
+		destStart = ((p->outPutLayer + iOut) * frameSize) + startPos;
+		switch (p->inPutWaveType) {
+		case NT_I8:
+			result = KalmanAverageT ((char*)p->inPutDataStartPtr + srcStart, (char*)p->outPutDataStartPtr + destStart, pixPerTile, pixToNextFrame, zSize, multiplier, accPtr);
+			break;
+		case (NT_I8 | NT_UNSIGNED):
+			result = KalmanAverageT ((unsigned char*)p->inPutDataStartPtr + srcStart, (unsigned char*)p->outPutDataStartPtr + destStart, pixPerTile, pixToNextFrame, zSize, multiplier, accPtr);
+			break;
+		case NT_I16:
+			result = KalmanAverageT ((short*)p->inPutDataStartPtr + srcStart, (short*) p->outPutDataStartPtr + destStart, pixPerTile, pixToNextFrame, zSize, multiplier, accPtr);
+			break;
+		case (NT_I16 | NT_UNSIGNED):
+			result = KalmanAverageT ((unsigned short*)p->inPutDataStartPtr + srcStart, (unsigned short*) p->outPutDataStartPtr + destStart, pixPerTile, pixToNextFrame, zSize, multiplier, accPtr);
+			break;
+		case NT_I32:
+			result = KalmanAverageT ((SInt32*)p->inPutDataStartPtr + srcStart, (SInt32*) p->outPutDataStartPtr + destStart, pixPerTile, pixToNextFrame, zSize, multiplier, accPtr);
+			break;
+		case (NT_I32| NT_UNSIGNED):
+			result = KalmanAverageT ((UInt32*)p->inPutDataStartPtr + srcStart, (UInt32*) p->outPutDataStartPtr + destStart, pixPerTile, pixToNextFrame, zSize, multiplier, accPtr);
+			break;
+		case NT_FP32:
+			result = KalmanAverageT ((float*)p->inPutDataStartPtr + srcStart, (float*) p->outPutDataStartPtr + destStart, pixPerTile, pixToNextFrame, zSize, multiplier, accPtr);
+			break;
+		case NT_FP64:
+			result = KalmanAverageT ((double*)p->inPutDataStartPtr + srcStart, (double*) p->outPutDataStartPtr + destStart, pixPerTile, pixToNextFrame, zSize, multiplier, accPtr);
+			break;
+		default:	// Unknown data type - possible in a future version of Igor.
+			result= NT_FNOT_AVAIL;
+			break;
+		}
+	}
+	if (result != 0) throw result;
+}
+
+/* Runs KalmanTile on the thread pool over all the pixels in a frame, in tiles of at least KALMAN_MIN_TILE pixels. For
+ exact averaging, each thread gets a buffer for the sums of one block. Returns 0, MEMFAIL, or an error thrown by a tile
+ Last Modified 2026/10/16 */
+int KalmanRunTiles (KalmanThreadParamsPtr paramsPtr){
+    int result = 0;
+    UInt32 nSlots = gNumProcessors;
+    CountInt frameSize = paramsPtr->xSize * paramsPtr->ySize;
+    paramsPtr->accBufferPtr = nullptr;
+    if (paramsPtr->exact){
+        paramsPtr->accBufferPtr = (SInt64*)WMNewPtr (nSlots * KALMAN_EXACT_BLOCK * sizeof (SInt64));
+        if (paramsPtr->accBufferPtr == nullptr) return MEMFAIL;
+    }
+    result = ThreadPoolRunTiles (KalmanTile, paramsPtr, frameSize, ThreadPoolTileSize (frameSize, KALMAN_MIN_TILE), nSlots);
+    if (paramsPtr->accBufferPtr != nullptr) WMDisposePtr ((Ptr)paramsPtr->accBufferPtr);
+    paramsPtr->accBufferPtr = nullptr;
+    return result;
+}
+
+/* Template for handling all data types for KalmanList function. The tile is done in blocks of KALMAN_LIST_BLOCK points,
+ adding each wave in the list to the whole block before going on to the next wave, so each source wave is read as one
+ sequential run per block and the sum or running average for the block stays in cache while all the waves are added.
+ sumPtr is a buffer of KALMAN_LIST_BLOCK doubles for the sums, only needed when multiplier < 1
+Last Modified 2026/10/16 */
+template <typename T> int KalmanListT (T** srcWaveStarts, T* destWaveStart, UInt16 nWaves, CountInt startPos, CountInt endPos, float multiplier, double* sumPtr) {
+	UInt16 iWave;
+	CountInt iPos, blockStart, blockSize;
+	T* srcPtr;
+	T* destPtr;
+	for (blockStart = startPos; blockStart < endPos; blockStart += blockSize){
+		blockSize = ((endPos - blockStart) < KALMAN_LIST_BLOCK) ? (endPos - blockStart) : KALMAN_LIST_BLOCK;
+		destPtr = destWaveStart + blockStart;
+		srcPtr = *srcWaveStarts + blockStart;
+		/* If multiplier is < 1, use standard averaging across waves with a floating point sum for each point */
+		if (multiplier < 1){
+			for (iPos = 0; iPos < blockSize; iPos++){
+				sumPtr [iPos] = srcPtr [iPos];
+			}
+			for (iWave = 1; iWave < nWaves; iWave++){
+				srcPtr = srcWaveStarts [iWave] + blockStart;
+				for (iPos = 0; iPos < blockSize; iPos++){
+					sumPtr [iPos] += srcPtr [iPos];
+				}
+			}
+			for (iPos = 0; iPos < blockSize; iPos++){
+				destPtr [iPos] = (sumPtr [iPos]/nWaves);
+			}
+		}else{ //Kalman
+			// Do Special stuff for first wave. When collapsing a wave into the first frame, srcPtr and destPtr are the same
+			if (multiplier > 1){
+				// Set output wave = first input wave * Multiplier
+				for (iPos = 0; iPos < blockSize; iPos++){
+					destPtr [iPos] = srcPtr [iPos] * multiplier;
+				}
+			}else if (srcPtr != destPtr){ // first wave when No Multiplier, and Src and dest are different
+				for (iPos = 0; iPos < blockSize; iPos++){
+					destPtr [iPos] = srcPtr [iPos];
+				}
+			}
+			//For each remaining wave in input list, iterate through, averaging the input value into the output wave
+			if (multiplier > 1){
+				for (iWave = 1; iWave < nWaves; iWave++){
+					srcPtr = srcWaveStarts [iWave] + blockStart;
+					for (iPos = 0; iPos < blockSize; iPos++){
+						destPtr [iPos] = ((destPtr [iPos] * iWave) + srcPtr [iPos] * multiplier)/(iWave + 1);
+					}
+				}
+				for (iPos = 0; iPos < blockSize; iPos++){
+					destPtr [iPos] /= multiplier;
+				}
+			}else{ // no multiplier
+				for (iWave = 1; iWave < nWaves; iWave++){
+					srcPtr = srcWaveStarts [iWave] + blockStart;
+					for (iPos = 0; iPos < blockSize; iPos++){
+						destPtr [iPos] = ((destPtr [iPos] * iWave) + srcPtr [iPos])/(iWave + 1);
+					}
+				}
+			}
+		}
+	}
+	return 0;
+}
+
+
+/* Each tile of points to average from a list of waves, from startPos up to endPos, is done with this function
+Last Modified 2026/10/16 */
+void KalmanListTile (void* paramsPtr, CountInt startPos, CountInt endPos, UInt32 iSlot){
+	struct KalmanListThreadParams* p;
+	p = (struct KalmanListThreadParams*) paramsPtr;
+	float multiplier = p->multiplier;
+	double* sumPtr = (p->sumBufferPtr != nullptr) ? p->sumBufferPtr + iSlot * KALMAN_LIST_BLOCK : nullptr;
+	switch (p->inPutWaveType) {
+	case NT_I8:
+		KalmanListT ((char**)p->inPutDataStartsPtr, (char*)p->outPutDataStartPtr, p->nWaves, startPos, endPos, multiplier, sumPtr);
+		break;
+	case (NT_I8 | NT_UNSIGNED):
+		KalmanListT ((unsigned char**)p->inPutDataStartsPtr, (unsigned char*)p->outPutDataStartPtr, p->nWaves, startPos, endPos, multiplier, sumPtr);
+		break;
+	case NT_I16:
+		KalmanListT ((short**)p->inPutDataStartsPtr, (short*)p->outPutDataStartPtr, p->nWaves, startPos, endPos, multiplier, sumPtr);
+		break;
+	case (NT_I16 | NT_UNSIGNED):
+		KalmanListT ((unsigned short**)p->inPutDataStartsPtr, (unsigned short*)p->outPutDataStartPtr, p->nWaves, startPos, endPos, multiplier, sumPtr);
+		break;
+	case NT_I32:
+		KalmanListT ((SInt32**)p->inPutDataStartsPtr, (SInt32*)p->outPutDataStartPtr, p->nWaves, startPos, endPos, multiplier, sumPtr);
+		break;
+	case (NT_I32| NT_UNSIGNED):
+		KalmanListT ((UInt32**)p->inPutDataStartsPtr, (UInt32*)p->outPutDataStartPtr, p->nWaves, startPos, endPos, multiplier, sumPtr);
+		break;
+	case NT_FP32:
+		KalmanListT ((float**)p->inPutDataStartsPtr, (float*)p->outPutDataStartPtr, p->nWaves, startPos, endPos, multiplier, sumPtr);
+		break;
+	case NT_FP64:
+		KalmanListT ((double**)p->inPutDataStartsPtr, (double*)p->outPutDataStartPtr, p->nWaves, startPos, endPos, multiplier, sumPtr);
+		break;
+	default:	// Unknown data type - possible in a future version of Igor.
+		throw NT_FNOT_AVAIL;
+		break;
+	}
+}
+
+/* Runs KalmanListTile on the thread pool over all the points of the waves in the list. Tiles are a whole number of
+ KALMAN_LIST_BLOCK blocks, and each thread gets a buffer for the sums of one block when multiplier < 1. Returns 0,
+ MEMFAIL, or an error thrown by a tile
+ Last Modified 2026/10/16 */
+int KalmanListRunTiles (KalmanListThreadParamsPtr paramsPtr, UInt32 nSlots){
+    int result = 0;
+    CountInt pointsPerTile = ThreadPoolTileSize (paramsPtr->nPnts, KALMAN_LIST_BLOCK);
+    pointsPerTile = ((pointsPerTile + KALMAN_LIST_BLOCK - 1)/KALMAN_LIST_BLOCK) * KALMAN_LIST_BLOCK;
+    paramsPtr->sumBufferPtr = nullptr;
+    if (paramsPtr->multiplier < 1){
+        paramsPtr->sumBufferPtr = (double*)WMNewPtr (nSlots * KALMAN_LIST_BLOCK * sizeof (double));
+        if (paramsPtr->sumBufferPtr == nullptr) return MEMFAIL;
+    }
+    result = ThreadPoolRunTiles (KalmanListTile, paramsPtr, paramsPtr->nPnts, pointsPerTile, nSlots);
+    if (paramsPtr->sumBufferPtr != nullptr) WMDisposePtr ((Ptr)paramsPtr->sumBufferPtr);
+    paramsPtr->sumBufferPtr = nullptr;
+    return result;
+}
+
+
+/* Template for doing sequential Kalman averaging, src waves are the new waves, nFrames of them one after another,
+ dest wave is the old wave already averaged iKal times. The points are done in blocks of KALMAN_NEXT_BLOCK, adding every
+ new wave to a block before going on to the next block, so the average for the block stays in cache. K is the type of
+ the count of waves averaged, UInt16 as in earlier versions when the count fits in it, else CountInt. With a weight, each
+ new wave is given that weight in an exponential average, rounded to nearest for integer waves with halves rounded away
+ from zero, instead of 1/(count + 1)
+ Last Modified 2026/10/16 */
+template <typename T, typename K> void KalmanNextT (T* srcWaveStart, T* destWaveStart, CountInt nPoints, CountInt srcToNextFrame, CountInt nFrames, K iKal, double weight) {
+	const bool isInteger = std::numeric_limits<T>::is_integer;
+	double keep = 1 - weight;
+	CountInt blockStart, blockSize, iPos, iFrame;
+	K nAveraged;
+	T* srcPtr;
+	T* destPtr;
+	for (blockStart = 0; blockStart < nPoints; blockStart += blockSize){
+		blockSize = ((nPoints - blockStart) < KALMAN_NEXT_BLOCK) ? (nPoints - blockStart) : KALMAN_NEXT_BLOCK;
+		destPtr = destWaveStart + blockStart;
+		for (iFrame = 0, nAveraged = iKal; iFrame < nFrames; iFrame++, nAveraged++){
+			srcPtr = srcWaveStart + (iFrame * srcToNextFrame) + blockStart;
+			if (nAveraged == 0){
+				for (iPos = 0; iPos < blockSize; iPos++)
+					destPtr [iPos] = srcPtr [iPos];
+			}else if (weight > 0){
+				for (iPos = 0; iPos < blockSize; iPos++){
+					double average = destPtr [iPos] * keep + srcPtr [iPos] * weight;
+					destPtr [iPos] = (T)(isInteger ? average + ((average < 0) ? -0.5 : 0.5) : average);
+				}
+			}else{
+				for (iPos = 0; iPos < blockSize; iPos++)
+					destPtr [iPos] = (destPtr [iPos] * nAveraged + srcPtr [iPos])/(nAveraged + 1);
+			}
+		}
+	}
+}
+
+/* Picks the type for the count of waves averaged by KalmanNextT
+ Last Modified 2026/10/16 */
+template <typename T> void KalmanNextCountT (T* srcWaveStart, T* destWaveStart, CountInt nPoints, KalmanNextThreadParamsPtr p){
+	if (p->iKal + p->nFrames - 1 <= 65535){
+		KalmanNextT (srcWaveStart, destWaveStart, nPoints, p->nPnts, p->nFrames, (UInt16)p->iKal, p->weight);
+	}else{
+		KalmanNextT (srcWaveStart, destWaveStart, nPoints, p->nPnts, p->nFrames, p->iKal, p->weight);
+	}
+}
+
+/* Each tile of points to do sequential Kalmaning, from startPos up to endPos, is done with this function
+ Last Modified 2026/10/16 */
+void KalmanNextTile (void* paramsPtr, CountInt startPos, CountInt endPos, UInt32 iSlot){
+	struct KalmanNextThreadParams* p;
+	p = (struct KalmanNextThreadParams*) paramsPtr;
+	CountInt pntsPerTile = endPos - startPos;
+	switch (p->inPutWaveType) {
+        case NT_I8:
+            KalmanNextCountT ((char*)p->inPutDataStartPtr + startPos, (char*)p->outPutDataStartPtr + startPos, pntsPerTile, p);
+            break;
+        case (NT_I8 | NT_UNSIGNED):
+            KalmanNextCountT ((unsigned char*)p->inPutDataStartPtr + startPos, (unsigned char*)p->outPutDataStartPtr + startPos, pntsPerTile, p);
+            break;
+        case NT_I16:
+            KalmanNextCountT ((short*)p->inPutDataStartPtr + startPos, (short*)p->outPutDataStartPtr+ startPos, pntsPerTile, p);
+            break;
+        case (NT_I16 | NT_UNSIGNED):
+            KalmanNextCountT ((unsigned short*)p->inPutDataStartPtr + startPos, (unsigned short*)p->outPutDataStartPtr + startPos, pntsPerTile, p);
+            break;
+        case NT_I32:
+            KalmanNextCountT ((SInt32*)p->inPutDataStartPtr + startPos, (SInt32*)p->outPutDataStartPtr + startPos, pntsPerTile, p);
+            break;
+        case (NT_I32| NT_UNSIGNED):
+            KalmanNextCountT ((UInt32*)p->inPutDataStartPtr + startPos, (UInt32*)p->outPutDataStartPtr + startPos, pntsPerTile, p);
+            break;
+        case NT_FP32:
+            KalmanNextCountT ((float*)p->inPutDataStartPtr + startPos, (float*)p->outPutDataStartPtr + startPos, pntsPerTile, p);
+            break;
+        case NT_FP64:
+            KalmanNextCountT ((double*)p->inPutDataStartPtr + startPos, (double*)p->outPutDataStartPtr + startPos, pntsPerTile, p);
+            break;
+	}
+}
+
+
+/* Moving average of nWindow layers for one tile of nPix points, one output layer for each window. The sums for a block
+ of KALMAN_SLIDING_BLOCK points are made once for the first window, then each window after that adds the layer that
+ comes into it and subtracts the layer that leaves it, so each output layer costs 2 layers of reads however wide the
+ window is. Windows at the ends of the wave that are missing layers are averaged over the layers they have. Each sum
+ is divided once and rounded to nearest, as for exact averaging. accPtr is a buffer of KALMAN_SLIDING_BLOCK sums for
+ this thread, of a type wide enough that no sum can overflow
+ Last Modified 2026/10/16 */
+template <typename T, typename A> int KalmanSlidingT (T* srcWaveStart, T* destWaveStart, CountInt nPix, CountInt frameSize, CountInt zSize, CountInt outZSize, CountInt nWindow, CountInt offset, A* accPtr){
+	CountInt blockStart, blockSize, iPix, layer, outLayer, firstLayer, lastLayer;
+	T* srcPtr;
+	T* leavingPtr;
+	T* destPtr;
+	for (blockStart = 0; blockStart < nPix; blockStart += blockSize){
+		blockSize = ((nPix - blockStart) < KALMAN_SLIDING_BLOCK) ? (nPix - blockStart) : KALMAN_SLIDING_BLOCK;
+		// sums for the first window, which may be missing layers at the start of the wave
+		lastLayer = nWindow - offset - 1;
+		if (lastLayer > zSize - 1) lastLayer = zSize - 1;
+		srcPtr = srcWaveStart + blockStart;
+		for (iPix = 0; iPix < blockSize; iPix++){
+			accPtr [iPix] = srcPtr [iPix];
+		}
+		for (layer = 1; layer <= lastLayer; layer++){
+			srcPtr = srcWaveStart + layer * frameSize + blockStart;
+			for (iPix = 0; iPix < blockSize; iPix++){
+				accPtr [iPix] += srcPtr [iPix];
+			}
+		}
+		for (outLayer = 0; outLayer < outZSize; outLayer++){
+			firstLayer = outLayer - offset;
+			destPtr = destWaveStart + outLayer * frameSize + blockStart;
+			CountInt numLayers = lastLayer - ((firstLayer < 0) ? 0 : firstLayer) + 1;
+			for (iPix = 0; iPix < blockSize; iPix++){
+				destPtr [iPix] = (T)KalmanExactDivide (accPtr [iPix], numLayers);
+			}
+			if (outLayer == outZSize - 1) break;
+			// slide the window on by one layer, taking off the first layer and adding the layer after the last one
+			if (firstLayer >= 0){
+				leavingPtr = srcWaveStart + firstLayer * frameSize + blockStart;
+				if (lastLayer < zSize - 1){
+					lastLayer++;
+					srcPtr = srcWaveStart + lastLayer * frameSize + blockStart;
+					for (iPix = 0; iPix < blockSize; iPix++){
+						accPtr [iPix] += (A)srcPtr [iPix] - (A)leavingPtr [iPix];
+					}
+				}else{
+					for (iPix = 0; iPix < blockSize; iPix++){
+						accPtr [iPix] -= leavingPtr [iPix];
+					}
+				}
+			}else if (lastLayer < zSize - 1){
+				lastLayer++;
+				srcPtr = srcWaveStart + lastLayer * frameSize + blockStart;
+				for (iPix = 0; iPix < blockSize; iPix++){
+					accPtr [iPix] += srcPtr [iPix];
+				}
+			}
+		}
+	}
+	return 0;
+}
+
+/* Picks the sums for KalmanSlidingT: 32 bit for 8 and 16 bit points, unless the window has more than
+ KALMAN_EXACT_I32_LAYERS layers, 64 bit for 32 bit points, and double for floating point points
+ Last Modified 2026/10/16 */
+template <typename T> int KalmanSlidingSumT (T* srcWaveStart, T* destWaveStart, CountInt nPix, KalmanSlidingThreadParamsPtr p, SInt64* accPtr){
+	CountInt frameSize = p->xSize * p->ySize;
+	if (!std::numeric_limits<T>::is_integer){
+		return KalmanSlidingT (srcWaveStart, destWaveStart, nPix, frameSize, p->zSize, p->outZSize, p->nWindow, p->offset, (double*)accPtr);
+	}else if ((sizeof (T) <= 2) && (p->nWindow <= KALMAN_EXACT_I32_LAYERS)){
+		return KalmanSlidingT (srcWaveStart, destWaveStart, nPix, frameSize, p->zSize, p->outZSize, p->nWindow, p->offset, (SInt32*)accPtr);
+	}else{
+		return KalmanSlidingT (srcWaveStart, destWaveStart, nPix, frameSize, p->zSize, p->outZSize, p->nWindow, p->offset, accPtr);
+	}
+}
+
+/* Each tile of pixels for a moving average, from startPos up to endPos, is done with this function
+ Last Modified 2026/10/16 */
+void KalmanSlidingTile (void* paramsPtr, CountInt startPos, CountInt endPos, UInt32 iSlot){
+	struct KalmanSlidingThreadParams* p;
+	p = (struct KalmanSlidingThreadParams*) paramsPtr;
+	SInt64* accPtr = p->accBufferPtr + iSlot * KALMAN_SLIDING_BLOCK;
+	CountInt nPix = endPos - startPos;
+	int result;
+	switch (p->inPutWaveType) {
+	case NT_I8:
+		result = KalmanSlidingSumT ((char*)p->inPutDataStartPtr + startPos, (char*)p->outPutDataStartPtr + startPos, nPix, p, accPtr);
+		break;
+	case (NT_I8 | NT_UNSIGNED):
+		result = KalmanSlidingSumT ((unsigned char*)p->inPutDataStartPtr + startPos, (unsigned char*)p->outPutDataStartPtr + startPos, nPix, p, accPtr);
+		break;
+	case NT_I16:
+		result = KalmanSlidingSumT ((short*)p->inPutDataStartPtr + startPos, (short*)p->outPutDataStartPtr + startPos, nPix, p, accPtr);
+		break;
+	case (NT_I16 | NT_UNSIGNED):
+		result = KalmanSlidingSumT ((unsigned short*)p->inPutDataStartPtr + startPos, (unsigned short*)p->outPutDataStartPtr + startPos, nPix, p, accPtr);
+		break;
+	case NT_I32:
+		result = KalmanSlidingSumT ((SInt32*)p->inPutDataStartPtr + startPos, (SInt32*)p->outPutDataStartPtr + startPos, nPix, p, accPtr);
+		break;
+	case (NT_I32| NT_UNSIGNED):
+		result = KalmanSlidingSumT ((UInt32*)p->inPutDataStartPtr + startPos, (UInt32*)p->outPutDataStartPtr + startPos, nPix, p, accPtr);
+		break;
+	case NT_FP32:
+		result = KalmanSlidingSumT ((float*)p->inPutDataStartPtr + startPos, (float*)p->outPutDataStartPtr + startPos, nPix, p, accPtr);
+		break;
+	case NT_FP64:
+		result = KalmanSlidingSumT ((double*)p->inPutDataStartPtr + startPos, (double*)p->outPutDataStartPtr + startPos, nPix, p, accPtr);
+		break;
+	default:	// Unknown data type - possible in a future version of Igor.
+		result= NT_FNOT_AVAIL;
+		break;
+	}
+	if (result != 0) throw result;
+}
+
+/* Runs KalmanSlidingTile on the thread pool over all the pixels in a frame. Tiles are a whole number of
+ KALMAN_SLIDING_BLOCK blocks, and each thread gets a buffer for the sums of one block. Returns 0, MEMFAIL, or an error
+ thrown by a tile
+ Last Modified 2026/10/16 */
+int KalmanSlidingRunTiles (KalmanSlidingThreadParamsPtr paramsPtr){
+    int result = 0;
+    UInt32 nSlots = gNumProcessors;
+    CountInt frameSize = paramsPtr->xSize * paramsPtr->ySize;
+    CountInt pixPerTile = ThreadPoolTileSize (frameSize, KALMAN_SLIDING_BLOCK);
+    pixPerTile = ((pixPerTile + KALMAN_SLIDING_BLOCK - 1)/KALMAN_SLIDING_BLOCK) * KALMAN_SLIDING_BLOCK;
+    paramsPtr->accBufferPtr = (SInt64*)WMNewPtr (nSlots * KALMAN_SLIDING_BLOCK * sizeof (SInt64));
+    if (paramsPtr->accBufferPtr == nullptr) return MEMFAIL;
+    result = ThreadPoolRunTiles (KalmanSlidingTile, paramsPtr, frameSize, pixPerTile, nSlots);
+    WMDisposePtr ((Ptr)paramsPtr->accBufferPtr);
+    paramsPtr->accBufferPtr = nullptr;
+    return result;
+}
+
+
+/* Per-point mean, variance, standard deviation, and optionally minimum and maximum, over all the layers, in one pass.
+ For a block of KALMAN_STATS_BLOCK points, each layer is taken away from the point's value in the first layer, as a
+ shift, and the differences and their squares are summed in doubles for a chunk of KALMAN_STATS_CHUNK layers. The sums
+ for each chunk are then merged into the mean and M2 (sum of squared differences from the mean) for the layers before
+ it with Chan's formula, which is as stable as Welford's update for each layer, without a divide for every point of
+ every layer. For 8 and 16 bit waves the sums of a chunk are exact. The variance is the sample variance, M2/(n - 1),
+ or 0 for a single layer. bufPtr is KALMAN_STATS_BLOCK * KALMAN_STATS_SUMS doubles for this thread
+ Last Modified 2026/10/16 */
+template <typename T, typename O> int KalmanStatsT (T* srcWaveStart, O* destWaveStart, CountInt nPix, CountInt frameSize, CountInt zSize, UInt8 doMinMax, double* bufPtr){
+	double* shiftPtr = bufPtr;
+	double* sumPtr = bufPtr + KALMAN_STATS_BLOCK;
+	double* sumSqPtr = bufPtr + 2 * KALMAN_STATS_BLOCK;
+	double* meanPtr = bufPtr + 3 * KALMAN_STATS_BLOCK;
+	double* m2Ptr = bufPtr + 4 * KALMAN_STATS_BLOCK;
+	double* minPtr = bufPtr + 5 * KALMAN_STATS_BLOCK;
+	double* maxPtr = bufPtr + 6 * KALMAN_STATS_BLOCK;
+	CountInt blockStart, blockSize, iPix, layer, chunkStart, chunkSize, nDone;
+	double value, diff, chunkMean, delta, variance;
+	T* srcPtr;
+	O* destPtr;
+	for (blockStart = 0; blockStart < nPix; blockStart += blockSize){
+		blockSize = ((nPix - blockStart) < KALMAN_STATS_BLOCK) ? (nPix - blockStart) : KALMAN_STATS_BLOCK;
+		srcPtr = srcWaveStart + blockStart;
+		for (iPix = 0; iPix < blockSize; iPix++){
+			shiftPtr [iPix] = minPtr [iPix] = maxPtr [iPix] = srcPtr [iPix];
+			meanPtr [iPix] = m2Ptr [iPix] = 0;
+		}
+		for (chunkStart = 0, nDone = 0; chunkStart < zSize; chunkStart += chunkSize, nDone += chunkSize){
+			chunkSize = ((zSize - chunkStart) < KALMAN_STATS_CHUNK) ? (zSize - chunkStart) : KALMAN_STATS_CHUNK;
+			for (iPix = 0; iPix < blockSize; iPix++){
+				sumPtr [iPix] = sumSqPtr [iPix] = 0;
+			}
+			for (layer = chunkStart; layer < chunkStart + chunkSize; layer++){
+				srcPtr = srcWaveStart + layer * frameSize + blockStart;
+				if (doMinMax){
+					for (iPix = 0; iPix < blockSize; iPix++){
+						value = srcPtr [iPix];
+						diff = value - shiftPtr [iPix];
+						sumPtr [iPix] += diff;
+						sumSqPtr [iPix] += diff * diff;
+						minPtr [iPix] = (value < minPtr [iPix]) ? value : minPtr [iPix];
+						maxPtr [iPix] = (value > maxPtr [iPix]) ? value : maxPtr [iPix];
+					}
+				}else{
+					for (iPix = 0; iPix < blockSize; iPix++){
+						diff = srcPtr [iPix] - shiftPtr [iPix];
+						sumPtr [iPix] += diff;
+						sumSqPtr [iPix] += diff * diff;
+					}
+				}
+			}
+			// merge the chunk into the layers before it
+			double nAll = (double)(nDone + chunkSize);
+			double chunkWeight = chunkSize/nAll;
+			double crossWeight = (double)nDone * chunkSize/nAll;
+			for (iPix = 0; iPix < blockSize; iPix++){
+				chunkMean = sumPtr [iPix]/chunkSize;
+				delta = chunkMean - meanPtr [iPix];
+				meanPtr [iPix] += delta * chunkWeight;
+				m2Ptr [iPix] += (sumSqPtr [iPix] - sumPtr [iPix] * chunkMean) + delta * delta * crossWeight;
+			}
+		}
+		destPtr = destWaveStart + blockStart;
+		for (iPix = 0; iPix < blockSize; iPix++){
+			variance = (zSize > 1) ? m2Ptr [iPix]/(zSize - 1) : 0;
+			if (variance < 0) variance = 0;
+			destPtr [iPix] = (O)(meanPtr [iPix] + shiftPtr [iPix]);
+			destPtr [frameSize + iPix] = (O)variance;
+			destPtr [2 * frameSize + iPix] = (O)sqrt (variance);
+		}
+		if (doMinMax){
+			for (iPix = 0; iPix < blockSize; iPix++){
+				destPtr [3 * frameSize + iPix] = (O)minPtr [iPix];
+				destPtr [4 * frameSize + iPix] = (O)maxPtr [iPix];
+			}
+		}
+	}
+	return 0;
+}
+
+/* Wave type of the output of KalmanStats: single precision floating point for 8 and 16 bit and single precision waves,
+ double precision for 32 bit and double precision waves, so the mean and variance keep the precision of the data
+ Last Modified 2026/10/16 */
+int KalmanStatsOutPutType (int inPutWaveType){
+	switch (inPutWaveType) {
+	case NT_I32:
+	case (NT_I32| NT_UNSIGNED):
+	case NT_FP64:
+		return NT_FP64;
+	default:
+		return NT_FP32;
+	}
+}
+
+/* Each tile of pixels for KalmanStats, from startPos up to endPos, is done with this function
+ Last Modified 2026/10/16 */
+void KalmanStatsTile (void* paramsPtr, CountInt startPos, CountInt endPos, UInt32 iSlot){
+	struct KalmanStatsThreadParams* p;
+	p = (struct KalmanStatsThreadParams*) paramsPtr;
+	double* bufPtr = p->bufferPtr + iSlot * KALMAN_STATS_BLOCK * KALMAN_STATS_SUMS;
+	CountInt frameSize = p->xSize * p->ySize;
+	CountInt nPix = endPos - startPos;
+	int result;
+	switch (p->inPutWaveType) {
+	case NT_I8:
+		result = KalmanStatsT ((char*)p->inPutDataStartPtr + startPos, (float*)p->outPutDataStartPtr + startPos, nPix, frameSize, p->zSize, p->doMinMax, bufPtr);
+		break;
+	case (NT_I8 | NT_UNSIGNED):
+		result = KalmanStatsT ((unsigned char*)p->inPutDataStartPtr + startPos, (float*)p->outPutDataStartPtr + startPos, nPix, frameSize, p->zSize, p->doMinMax, bufPtr);
+		break;
+	case NT_I16:
+		result = KalmanStatsT ((short*)p->inPutDataStartPtr + startPos, (float*)p->outPutDataStartPtr + startPos, nPix, frameSize, p->zSize, p->doMinMax, bufPtr);
+		break;
+	case (NT_I16 | NT_UNSIGNED):
+		result = KalmanStatsT ((unsigned short*)p->inPutDataStartPtr + startPos, (float*)p->outPutDataStartPtr + startPos, nPix, frameSize, p->zSize, p->doMinMax, bufPtr);
+		break;
+	case NT_I32:
+		result = KalmanStatsT ((SInt32*)p->inPutDataStartPtr + startPos, (double*)p->outPutDataStartPtr + startPos, nPix, frameSize, p->zSize, p->doMinMax, bufPtr);
+		break;
+	case (NT_I32| NT_UNSIGNED):
+		result = KalmanStatsT ((UInt32*)p->inPutDataStartPtr + startPos, (double*)p->outPutDataStartPtr + startPos, nPix, frameSize, p->zSize, p->doMinMax, bufPtr);
+		break;
+	case NT_FP32:
+		result = KalmanStatsT ((float*)p->inPutDataStartPtr + startPos, (float*)p->outPutDataStartPtr + startPos, nPix, frameSize, p->zSize, p->doMinMax, bufPtr);
+		break;
+	case NT_FP64:
+		result = KalmanStatsT ((double*)p->inPutDataStartPtr + startPos, (double*)p->outPutDataStartPtr + startPos, nPix, frameSize, p->zSize, p->doMinMax, bufPtr);
+		break;
+	default:	// Unknown data type - possible in a future version of Igor.
+		result= NT_FNOT_AVAIL;
+		break;
+	}
+	if (result != 0) throw result;
+}
+
+/* Runs KalmanStatsTile on the thread pool over all the pixels in a frame. Tiles are a whole number of
+ KALMAN_STATS_BLOCK blocks, and each thread gets a buffer for the sums of one block. Returns 0, MEMFAIL, or an error
+ thrown by a tile
+ Last Modified 2026/10/16 */
+int KalmanStatsRunTiles (KalmanStatsThreadParamsPtr paramsPtr){
+    int result = 0;
+    UInt32 nSlots = gNumProcessors;
+    CountInt frameSize = paramsPtr->xSize * paramsPtr->ySize;
+    CountInt pixPerTile = ThreadPoolTileSize (frameSize, KALMAN_STATS_BLOCK);
+    pixPerTile = ((pixPerTile + KALMAN_STATS_BLOCK - 1)/KALMAN_STATS_BLOCK) * KALMAN_STATS_BLOCK;
+    paramsPtr->bufferPtr = (double*)WMNewPtr (nSlots * KALMAN_STATS_BLOCK * KALMAN_STATS_SUMS * sizeof (double));
+    if (paramsPtr->bufferPtr == nullptr) return MEMFAIL;
+    result = ThreadPoolRunTiles (KalmanStatsTile, paramsPtr, frameSize, pixPerTile, nSlots);
+    WMDisposePtr ((Ptr)paramsPtr->bufferPtr);
+    paramsPtr->bufferPtr = nullptr;
+    return result;
+}
+
+
+/* Sigma clipped mean of the n points of one column: the mean and standard deviation of the points kept so far are
+ found, points more than nSigma standard deviations from the mean are clipped, and this is repeated with the points
+ that are left till the kept points no longer change, or KALMAN_ROBUST_MAX_ITER times. The mean is always that of the
+ points kept by the last clip. A clip can drop points at one end and take back as many at the other, so the kept
+ points are only the same as before when both their number and their sum are. The standard deviation is that of the
+ points themselves, dividing by the number of points kept. If a clip would leave no points, the last mean is kept
+ Last Modified 2026/10/16 */
+static double KalmanSigmaClipMean (double* colPtr, CountInt n, double nSigma){
+	double lower = -HUGE_VAL, upper = HUGE_VAL;
+	double mean = 0, sum, lastSum = 0, sumSq, diff, value, stdDev;
+	CountInt iPnt, nKept, lastKept = 0;
+	for (int iter = 0; ; iter++){
+		sum = 0;
+		nKept = 0;
+		for (iPnt = 0; iPnt < n; iPnt++){
+			value = colPtr [iPnt];
+			UInt8 isKept = ((value >= lower) && (value <= upper));
+			sum += isKept ? value : 0;
+			nKept += isKept;
+		}
+		if (nKept == 0) break;
+		mean = sum/nKept;
+		if (((nKept == lastKept) && (sum == lastSum)) || (iter == KALMAN_ROBUST_MAX_ITER)) break;
+		lastKept = nKept;
+		lastSum = sum;
+		sumSq = 0;
+		for (iPnt = 0; iPnt < n; iPnt++){
+			value = colPtr [iPnt];
+			diff = value - mean;
+			sumSq += ((value >= lower) && (value <= upper)) ? diff * diff : 0;
+		}
+		stdDev = sqrt (sumSq/nKept);
+		lower = mean - nSigma * stdDev;
+		upper = mean + nSigma * stdDev;
+	}
+	return mean;
+}
+
+/* Inserts value into the sorted list of the nKeep smallest points seen so far, dropping the largest, or, with a list
+ sorted from largest down and isHigh, into the list of the nKeep largest. Each point of the list becomes the nearer to
+ value of itself and the point before it, without branches, working down from the end so the point before is unchanged
+ Last Modified 2026/10/16 */
+static inline void KalmanCutInsert (double* listPtr, CountInt nKeep, double value, UInt8 isHigh){
+	CountInt iPos;
+	double before, here;
+	for (iPos = nKeep - 1; iPos > 0; iPos--){
+		before = listPtr [iPos - 1];
+		here = listPtr [iPos];
+		if (isHigh){
+			before = (value < before) ? value : before;
+			listPtr [iPos] = (here > before) ? here : before;
+		}else{
+			before = (value > before) ? value : before;
+			listPtr [iPos] = (here < before) ? here : before;
+		}
+	}
+	here = listPtr [0];
+	listPtr [0] = isHigh ? ((value > here) ? value : here) : ((value < here) ? value : here);
+}
+
+/* Winsorized or trimmed mean of the n points of one column, with the lowest and highest nCut points replaced by the
+ nearest points that are kept, or left out. nCut must be less than n/2. When nCut is no more than KALMAN_ROBUST_MAX_LIST,
+ the nCut + 1 lowest and highest points are kept in short sorted lists in one pass over the column, with one well
+ predicted compare for each point at each end, and the cut points are taken off the sum of all the points. Else the two
+ points at the ends of the kept range are found with selectT, so the column is partitioned, not sorted
+ Last Modified 2026/10/16 */
+static double KalmanCutMean (double* colPtr, CountInt n, CountInt nCut, UInt8 winsorize){
+	CountInt iPnt, lastKept = n - 1 - nCut;
+	double sum = 0, lowest, highest;
+	if (nCut == 0){
+		for (iPnt = 0; iPnt < n; iPnt++) sum += colPtr [iPnt];
+		return sum/n;
+	}
+	if (nCut <= KALMAN_ROBUST_MAX_LIST){
+		double lowList [KALMAN_ROBUST_MAX_LIST + 1] = {}, highList [KALMAN_ROBUST_MAX_LIST + 1] = {};
+		CountInt nKeep = nCut + 1;
+		for (iPnt = 0; iPnt < nKeep; iPnt++){
+			lowList [iPnt] = HUGE_VAL;
+			highList [iPnt] = -HUGE_VAL;
+		}
+		for (iPnt = 0; iPnt < n; iPnt++){
+			double value = colPtr [iPnt];
+			sum += value;
+			if (value < lowList [nCut]) KalmanCutInsert (lowList, nKeep, value, 0);
+			if (value > highList [nCut]) KalmanCutInsert (highList, nKeep, value, 1);
+		}
+		for (iPnt = 0; iPnt < nCut; iPnt++) sum -= lowList [iPnt] + highList [iPnt];
+		lowest = lowList [nCut];
+		highest = highList [nCut];
+	}else{
+		lowest = selectT ((UInt32)n, (UInt32)nCut, colPtr);
+		highest = selectT ((UInt32)(n - nCut), (UInt32)(lastKept - nCut), colPtr + nCut);
+		for (iPnt = nCut; iPnt <= lastKept; iPnt++) sum += colPtr [iPnt];
+	}
+	if (winsorize) return (sum + nCut * (lowest + highest))/n;
+	return sum/(n - 2 * nCut);
+}
+
+/* Robust average over all the layers of one tile. For each block of blockPix points, the layers are copied into a
+ buffer of doubles, each point's column of layers together, as each layer is read once in order. Each column is then
+ averaged in cache with sigma clipping, Winsorizing, or trimming, which need several passes over the column or its
+ partition. Integer averages are rounded to nearest, halves away from zero
+ Last Modified 2026/10/16 */
+template <typename T> int KalmanRobustT (T* srcWaveStart, T* destWaveStart, CountInt nPix, CountInt frameSize, CountInt zSize, CountInt blockPix, UInt8 mode, double threshold, double* bufPtr){
+	CountInt blockStart, blockSize, iPix, layer;
+	CountInt nCut = (mode == KALMAN_ROBUST_SIGMA) ? 0 : (CountInt)(threshold * zSize);
+	double average;
+	T* srcPtr;
+	for (blockStart = 0; blockStart < nPix; blockStart += blockSize){
+		blockSize = ((nPix - blockStart) < blockPix) ? (nPix - blockStart) : blockPix;
+		for (layer = 0; layer < zSize; layer++){
+			srcPtr = srcWaveStart + layer * frameSize + blockStart;
+			for (iPix = 0; iPix < blockSize; iPix++){
+				bufPtr [iPix * zSize + layer] = srcPtr [iPix];
+			}
+		}
+		for (iPix = 0; iPix < blockSize; iPix++){
+			if (mode == KALMAN_ROBUST_SIGMA){
+				average = KalmanSigmaClipMean (bufPtr + iPix * zSize, zSize, threshold);
+			}else{
+				average = KalmanCutMean (bufPtr + iPix * zSize, zSize, nCut, (mode == KALMAN_ROBUST_WINSOR));
+			}
+			if (std::numeric_limits<T>::is_integer) average += (average < 0) ? -0.5 : 0.5;
+			destWaveStart [blockStart + iPix] = (T)average;
+		}
+	}
+	return 0;
+}
+
+/* Each tile of pixels for KalmanRobust, from startPos up to endPos, is done with this function
+ Last Modified 2026/10/16 */
+void KalmanRobustTile (void* paramsPtr, CountInt startPos, CountInt endPos, UInt32 iSlot){
+	struct KalmanRobustThreadParams* p;
+	p = (struct KalmanRobustThreadParams*) paramsPtr;
+	double* bufPtr = p->bufferPtr + iSlot * p->blockPix * p->zSize;
+	CountInt frameSize = p->xSize * p->ySize;
+	CountInt nPix = endPos - startPos;
+	int result;
+	switch (p->inPutWaveType) {
+	case NT_I8:
+		result = KalmanRobustT ((char*)p->inPutDataStartPtr + startPos, (char*)p->outPutDataStartPtr + startPos, nPix, frameSize, p->zSize, p->blockPix, p->mode, p->threshold, bufPtr);
+		break;
+	case (NT_I8 | NT_UNSIGNED):
+		result = KalmanRobustT ((unsigned char*)p->inPutDataStartPtr + startPos, (unsigned char*)p->outPutDataStartPtr + startPos, nPix, frameSize, p->zSize, p->blockPix, p->mode, p->threshold, bufPtr);
+		break;
+	case NT_I16:
+		result = KalmanRobustT ((short*)p->inPutDataStartPtr + startPos, (short*)p->outPutDataStartPtr + startPos, nPix, frameSize, p->zSize, p->blockPix, p->mode, p->threshold, bufPtr);
+		break;
+	case (NT_I16 | NT_UNSIGNED):
+		result = KalmanRobustT ((unsigned short*)p->inPutDataStartPtr + startPos, (unsigned short*)p->outPutDataStartPtr + startPos, nPix, frameSize, p->zSize, p->blockPix, p->mode, p->threshold, bufPtr);
+		break;
+	case NT_I32:
+		result = KalmanRobustT ((SInt32*)p->inPutDataStartPtr + startPos, (SInt32*)p->outPutDataStartPtr + startPos, nPix, frameSize, p->zSize, p->blockPix, p->mode, p->threshold, bufPtr);
+		break;
+	case (NT_I32| NT_UNSIGNED):
+		result = KalmanRobustT ((UInt32*)p->inPutDataStartPtr + startPos, (UInt32*)p->outPutDataStartPtr + startPos, nPix, frameSize, p->zSize, p->blockPix, p->mode, p->threshold, bufPtr);
+		break;
+	case NT_FP32:
+		result = KalmanRobustT ((float*)p->inPutDataStartPtr + startPos, (float*)p->outPutDataStartPtr + startPos, nPix, frameSize, p->zSize, p->blockPix, p->mode, p->threshold, bufPtr);
+		break;
+	case NT_FP64:
+		result = KalmanRobustT ((double*)p->inPutDataStartPtr + startPos, (double*)p->outPutDataStartPtr + startPos, nPix, frameSize, p->zSize, p->blockPix, p->mode, p->threshold, bufPtr);
+		break;
+	default:	// Unknown data type - possible in a future version of Igor.
+		result= NT_FNOT_AVAIL;
+		break;
+	}
+	if (result != 0) throw result;
+}
+
+/* Runs KalmanRobustTile on the thread pool over all the pixels in a frame. Blocks are as many points as let their
+ columns of layers fit in gKalmanBlockBytes, within KALMAN_ROBUST_MIN_BLOCK and KALMAN_ROBUST_MAX_BLOCK, and tiles are
+ a whole number of blocks. Each thread gets a buffer for the columns of one block. Returns 0, MEMFAIL, or an error
+ thrown by a tile
+ Last Modified 2026/10/16 */
+int KalmanRobustRunTiles (KalmanRobustThreadParamsPtr paramsPtr){
+    int result = 0;
+    UInt32 nSlots = gNumProcessors;
+    CountInt frameSize = paramsPtr->xSize * paramsPtr->ySize;
+    CountInt blockPix = gKalmanBlockBytes/(paramsPtr->zSize * sizeof (double));
+    if (blockPix < KALMAN_ROBUST_MIN_BLOCK) blockPix = KALMAN_ROBUST_MIN_BLOCK;
+    if (blockPix > KALMAN_ROBUST_MAX_BLOCK) blockPix = KALMAN_ROBUST_MAX_BLOCK;
+    CountInt pixPerTile = ThreadPoolTileSize (frameSize, blockPix);
+    pixPerTile = ((pixPerTile + blockPix - 1)/blockPix) * blockPix;
+    paramsPtr->blockPix = blockPix;
+    paramsPtr->bufferPtr = (double*)WMNewPtr (nSlots * blockPix * paramsPtr->zSize * sizeof (double));
+    if (paramsPtr->bufferPtr == nullptr) return MEMFAIL;
+    result = ThreadPoolRunTiles (KalmanRobustTile, paramsPtr, frameSize, pixPerTile, nSlots);
+    WMDisposePtr ((Ptr)paramsPtr->bufferPtr);
+    paramsPtr->bufferPtr = nullptr;
+    return result;
+}
+
+
+/* Triggered averaging of the nWindow layers after each of nTriggers start layers. For each block of KALMAN_EXACT_BLOCK
+ points, and each layer of the window, the layer at that offset after every trigger is added to a block of sums of type
+ A, as for KalmanExactT, and divided once, so no copy of the window around each trigger is ever made. Windows may
+ overlap, so input layers can be read for more than one trigger. accPtr is a buffer of KALMAN_EXACT_BLOCK sums for
+ this thread
+ Last Modified 2026/10/16 */
+template <typename T, typename A> int TriggeredAverageT (T* srcWaveStart, T* destWaveStart, CountInt nPix, CountInt frameSize, CountInt* startLayersPtr, CountInt nTriggers, CountInt nWindow, A* accPtr){
+	CountInt blockStart, blockSize, iPix, iTrigger, layer;
+	T* srcPtr;
+	T* destPtr;
+	for (blockStart = 0; blockStart < nPix; blockStart += blockSize){
+		blockSize = ((nPix - blockStart) < KALMAN_EXACT_BLOCK) ? (nPix - blockStart) : KALMAN_EXACT_BLOCK;
+		for (layer = 0; layer < nWindow; layer++){
+			srcPtr = srcWaveStart + (startLayersPtr [0] + layer) * frameSize + blockStart;
+			for (iPix = 0; iPix < blockSize; iPix++){
+				accPtr [iPix] = srcPtr [iPix];
+			}
+			for (iTrigger = 1; iTrigger < nTriggers; iTrigger++){
+				srcPtr = srcWaveStart + (startLayersPtr [iTrigger] + layer) * frameSize + blockStart;
+				for (iPix = 0; iPix < blockSize; iPix++){
+					accPtr [iPix] += srcPtr [iPix];
+				}
+			}
+			destPtr = destWaveStart + layer * frameSize + blockStart;
+			for (iPix = 0; iPix < blockSize; iPix++){
+				destPtr [iPix] = (T)KalmanExactDivide (accPtr [iPix], nTriggers);
+			}
+		}
+	}
+	return 0;
+}
+
+/* Chooses the type of the sums for TriggeredAverageT, as KalmanAverageT does for exact averaging
+ Last Modified 2026/10/16 */
+template <typename T> int TriggeredAverageSumT (T* srcWaveStart, T* destWaveStart, CountInt nPix, CountInt frameSize, CountInt* startLayersPtr, CountInt nTriggers, CountInt nWindow, SInt64* accPtr){
+	if (!std::numeric_limits<T>::is_integer){
+		return TriggeredAverageT (srcWaveStart, destWaveStart, nPix, frameSize, startLayersPtr, nTriggers, nWindow, (double*)accPtr);
+	}else if ((sizeof (T) <= 2) && (nTriggers <= KALMAN_EXACT_I32_LAYERS)){
+		return TriggeredAverageT (srcWaveStart, destWaveStart, nPix, frameSize, startLayersPtr, nTriggers, nWindow, (SInt32*)accPtr);
+	}else{
+		return TriggeredAverageT (srcWaveStart, destWaveStart, nPix, frameSize, startLayersPtr, nTriggers, nWindow, accPtr);
+	}
+}
+
+/* Each tile of pixels for TriggeredAverage, from startPos up to endPos, is done with this function
+ Last Modified 2026/10/16 */
+void TriggeredAverageTile (void* paramsPtr, CountInt startPos, CountInt endPos, UInt32 iSlot){
+	struct TriggeredAverageThreadParams* p;
+	p = (struct TriggeredAverageThreadParams*) paramsPtr;
+	SInt64* accPtr = p->accBufferPtr + iSlot * KALMAN_EXACT_BLOCK;
+	CountInt frameSize = p->xSize * p->ySize;
+	CountInt nPix = endPos - startPos;
+	int result;
+	switch (p->inPutWaveType) {
+	case NT_I8:
+		result = TriggeredAverageSumT ((char*)p->inPutDataStartPtr + startPos, (char*)p->outPutDataStartPtr + startPos, nPix, frameSize, p->startLayersPtr, p->nTriggers, p->nWindow, accPtr);
+		break;
+	case (NT_I8 | NT_UNSIGNED):
+		result = TriggeredAverageSumT ((unsigned char*)p->inPutDataStartPtr + startPos, (unsigned char*)p->outPutDataStartPtr + startPos, nPix, frameSize, p->startLayersPtr, p->nTriggers, p->nWindow, accPtr);
+		break;
+	case NT_I16:
+		result = TriggeredAverageSumT ((short*)p->inPutDataStartPtr + startPos, (short*)p->outPutDataStartPtr + startPos, nPix, frameSize, p->startLayersPtr, p->nTriggers, p->nWindow, accPtr);
+		break;
+	case (NT_I16 | NT_UNSIGNED):
+		result = TriggeredAverageSumT ((unsigned short*)p->inPutDataStartPtr + startPos, (unsigned short*)p->outPutDataStartPtr + startPos, nPix, frameSize, p->startLayersPtr, p->nTriggers, p->nWindow, accPtr);
+		break;
+	case NT_I32:
+		result = TriggeredAverageSumT ((SInt32*)p->inPutDataStartPtr + startPos, (SInt32*)p->outPutDataStartPtr + startPos, nPix, frameSize, p->startLayersPtr, p->nTriggers, p->nWindow, accPtr);
+		break;
+	case (NT_I32| NT_UNSIGNED):
+		result = TriggeredAverageSumT ((UInt32*)p->inPutDataStartPtr + startPos, (UInt32*)p->outPutDataStartPtr + startPos, nPix, frameSize, p->startLayersPtr, p->nTriggers, p->nWindow, accPtr);
+		break;
+	case NT_FP32:
+		result = TriggeredAverageSumT ((float*)p->inPutDataStartPtr + startPos, (float*)p->outPutDataStartPtr + startPos, nPix, frameSize, p->startLayersPtr, p->nTriggers, p->nWindow, accPtr);
+		break;
+	case NT_FP64:
+		result = TriggeredAverageSumT ((double*)p->inPutDataStartPtr + startPos, (double*)p->outPutDataStartPtr + startPos, nPix, frameSize, p->startLayersPtr, p->nTriggers, p->nWindow, accPtr);
+		break;
+	default:	// Unknown data type - possible in a future version of Igor.
+		result= NT_FNOT_AVAIL;
+		break;
+	}
+	if (result != 0) throw result;
+}
+
+/* Runs TriggeredAverageTile on the thread pool over all the pixels in a frame, in tiles of at least KALMAN_MIN_TILE
+ pixels, each thread getting a buffer for the sums of one block. Returns 0, MEMFAIL, or an error thrown by a tile
+ Last Modified 2026/10/16 */
+int TriggeredAverageRunTiles (TriggeredAverageThreadParamsPtr paramsPtr){
+    int result = 0;
+    UInt32 nSlots = gNumProcessors;
+    CountInt frameSize = paramsPtr->xSize * paramsPtr->ySize;
+    paramsPtr->accBufferPtr = (SInt64*)WMNewPtr (nSlots * KALMAN_EXACT_BLOCK * sizeof (SInt64));
+    if (paramsPtr->accBufferPtr == nullptr) return MEMFAIL;
+    result = ThreadPoolRunTiles (TriggeredAverageTile, paramsPtr, frameSize, ThreadPoolTileSize (frameSize, KALMAN_MIN_TILE), nSlots);
+    WMDisposePtr ((Ptr)paramsPtr->accBufferPtr);
+    paramsPtr->accBufferPtr = nullptr;
+    return result;
+}
@@ -0,0 +1,97 @@
+#include "twoPhotonKernels.h"
+/* ---------------------------------------------Kalman Kernels AVX2--------------------------------------------------
+ The running average loops of KalmanT with 4 doubles or 8 floats in each 256 bit AVX register. This file is built with
+ AVX2 code generation on (-mavx2 for gcc and clang), and KalmanT only calls it when gSIMDLevel is CPU_SIMD_AVX2. Built
+ for other processors, or without AVX2, KalmanLayersAVX2 returns 1 and the scalar loops are used
+ Last Modified 2026/10/16
+ ---------------------------------------------------------------------------------------------------------------*/
+#if defined (__AVX2__) || (defined (_MSC_VER) && (defined (_M_X64) || defined (_M_IX86)))
+#include <immintrin.h>
+#include <limits>
+
+namespace {
+
+typedef __m256d KalmanVec;
+
+static inline KalmanVec KVSet1 (double val){ return _mm256_set1_pd (val); }
+static inline KalmanVec KVAdd (KalmanVec a, KalmanVec b){ return _mm256_add_pd (a, b); }
+static inline KalmanVec KVMul (KalmanVec a, KalmanVec b){ return _mm256_mul_pd (a, b); }
+static inline KalmanVec KVDiv (KalmanVec a, KalmanVec b){ return _mm256_div_pd (a, b); }
+static inline KalmanVec KVTrunc (KalmanVec a){ return _mm256_round_pd (a, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC); }
+static inline KalmanVec KVFromI32 (__m128i ints){ return _mm256_cvtepi32_pd (ints); }
+// unsigned ints are offset by 2^31 to convert them as signed ints, and the offset added back as a double
+static inline KalmanVec KVFromU32 (__m128i ints){
+    return _mm256_add_pd (_mm256_cvtepi32_pd (_mm_xor_si128 (ints, _mm_set1_epi32 ((int)0x80000000))), _mm256_set1_pd (2147483648.0));
+}
+static inline KalmanVec KVLoadF64 (const double* ptr){ return _mm256_loadu_pd (ptr); }
+static inline __m128i KVToI32 (KalmanVec a){ return _mm256_cvttpd_epi32 (a); }
+static inline __m128i KVToU32 (KalmanVec a){
+    return _mm_xor_si128 (_mm256_cvttpd_epi32 (_mm256_sub_pd (a, _mm256_set1_pd (2147483648.0))), _mm_set1_epi32 ((int)0x80000000));
+}
+static inline void KVStoreF64 (double* ptr, KalmanVec a){ _mm256_storeu_pd (ptr, a); }
+
+typedef __m256 KalmanFVec;
+#define KALMAN_FVEC_PTS 8
+
+static inline KalmanFVec KFSet1 (float val){ return _mm256_set1_ps (val); }
+static inline KalmanFVec KFAdd (KalmanFVec a, KalmanFVec b){ return _mm256_add_ps (a, b); }
+static inline KalmanFVec KFMul (KalmanFVec a, KalmanFVec b){ return _mm256_mul_ps (a, b); }
+static inline KalmanFVec KFDiv (KalmanFVec a, KalmanFVec b){ return _mm256_div_ps (a, b); }
+static inline KalmanFVec KFLoadI8 (const char* ptr){ return _mm256_cvtepi32_ps (_mm256_cvtepi8_epi32 (_mm_loadl_epi64 ((const __m128i*)ptr))); }
+static inline KalmanFVec KFLoadU8 (const unsigned char* ptr){ return _mm256_cvtepi32_ps (_mm256_cvtepu8_epi32 (_mm_loadl_epi64 ((const __m128i*)ptr))); }
+static inline KalmanFVec KFLoadI16 (const short* ptr){ return _mm256_cvtepi32_ps (_mm256_cvtepi16_epi32 (_mm_loadu_si128 ((const __m128i*)ptr))); }
+static inline KalmanFVec KFLoadU16 (const unsigned short* ptr){ return _mm256_cvtepi32_ps (_mm256_cvtepu16_epi32 (_mm_loadu_si128 ((const __m128i*)ptr))); }
+static inline KalmanFVec KFLoadF32 (const float* ptr){ return _mm256_loadu_ps (ptr); }
+// truncates to ints, and returns the low 4 ints in lo and the high 4 in hi, to be packed down to 8 or 16 bits
+static inline void KFToI32 (KalmanFVec a, __m128i* loPtr, __m128i* hiPtr){
+    __m256i ints = _mm256_cvttps_epi32 (a);
+    *loPtr = _mm256_castsi256_si128 (ints);
+    *hiPtr = _mm256_extracti128_si256 (ints, 1);
+}
+static inline void KFStoreI8 (char* ptr, KalmanFVec a){
+    __m128i lo, hi;
+    KFToI32 (a, &lo, &hi);
+    lo = _mm_packs_epi32 (lo, hi);
+    _mm_storel_epi64 ((__m128i*)ptr, _mm_packs_epi16 (lo, lo));
+}
+static inline void KFStoreU8 (unsigned char* ptr, KalmanFVec a){
+    __m128i lo, hi;
+    KFToI32 (a, &lo, &hi);
+    lo = _mm_packus_epi32 (lo, hi);
+    _mm_storel_epi64 ((__m128i*)ptr, _mm_packus_epi16 (lo, lo));
+}
+static inline void KFStoreI16 (short* ptr, KalmanFVec a){
+    __m128i lo, hi;
+    KFToI32 (a, &lo, &hi);
+    _mm_storeu_si128 ((__m128i*)ptr, _mm_packs_epi32 (lo, hi));
+}
+static inline void KFStoreU16 (unsigned short* ptr, KalmanFVec a){
+    __m128i lo, hi;
+    KFToI32 (a, &lo, &hi);
+    _mm_storeu_si128 ((__m128i*)ptr, _mm_packus_epi32 (lo, hi));
+}
+static inline void KFStoreF32 (float* ptr, KalmanFVec a){ _mm256_storeu_ps (ptr, a); }
+
+#define KALMAN_SIMD_FP_WAVES 1
+
+#include "KalmanKernelsSIMD.h"
+
+}
+
+template <typename T> int KalmanLayersAVX2 (T* srcWave, T* destWaveStart, CountInt pixPerThread, CountInt pixToNextFrame, CountInt numLayers, float multiplier){
+    return KalmanSIMDLayers (srcWave, destWaveStart, pixPerThread, pixToNextFrame, numLayers, multiplier);
+}
+#else
+template <typename T> int KalmanLayersAVX2 (T* srcWave, T* destWaveStart, CountInt pixPerThread, CountInt pixToNextFrame, CountInt numLayers, float multiplier){
+    return 1;
+}
+#endif
+
+template int KalmanLayersAVX2 (char*, char*, CountInt, CountInt, CountInt, float);
+template int KalmanLayersAVX2 (unsigned char*, unsigned char*, CountInt, CountInt, CountInt, float);
+template int KalmanLayersAVX2 (short*, short*, CountInt, CountInt, CountInt, float);
+template int KalmanLayersAVX2 (unsigned short*, unsigned short*, CountInt, CountInt, CountInt, float);
+template int KalmanLayersAVX2 (SInt32*, SInt32*, CountInt, CountInt, CountInt, float);
+template int KalmanLayersAVX2 (UInt32*, UInt32*, CountInt, CountInt, CountInt, float);
+template int KalmanLayersAVX2 (float*, float*, CountInt, CountInt, CountInt, float);
+template int KalmanLayersAVX2 (double*, double*, CountInt, CountInt, CountInt, float);
@@ -0,0 +1,239 @@
+/*
+    KalmanKernelsSIMD.h -- the SIMD running average loops of KalmanT, for all 8 wave types. Included only by
+    KalmanKernelsSSE41.cpp and KalmanKernelsAVX2.cpp, each built for its own instruction set, which first define a
+    KalmanVec of 4 doubles and the KV functions on it, and a KalmanFVec of KALMAN_FVEC_PTS floats and the KF functions on
+    it, then include this file inside an unnamed namespace.
+
+    With no multiplier, the scalar loops do an integer divide for each point of each layer, which the compiler can not
+    vectorize. Here the points are converted to doubles, and the divide is a double divide. layer * dest + src is exact
+    in a double while there are at most KALMAN_SIMD_MAX_LAYERS layers, and the rounded quotient can not cross a whole
+    number, so truncating it gives the integer quotient. With a multiplier, the scalar expression is done in float. 8
+    and 16 bit points and layer numbers are exact as floats, so those waves, and float waves, are done in float lanes
+    with the same operations. Double waves are done in doubles. So the output is the same as from the scalar loops, bit
+    for bit. Returning 1 leaves the layers to the scalar loops, which is done for 32 bit waves with a multiplier, whose
+    points are not exact as floats, and for float and double waves unless KALMAN_SIMD_FP_WAVES is non-zero, as the
+    compiler already vectorizes the scalar loops for those at SSE2 width
+    Last Modified 2026/10/16
+*/
+
+/* Loads 4 points of a wave type into a KalmanVec, and stores 4 back. For integer types, the values stored must be
+ whole numbers in range for the type
+ Last Modified 2026/10/16 */
+template <typename T> struct KalmanLanes;
+
+template <> struct KalmanLanes<char>{
+    static inline KalmanVec load (const char* ptr){
+        int packed;
+        memcpy (&packed, ptr, 4);
+        return KVFromI32 (_mm_cvtepi8_epi32 (_mm_cvtsi32_si128 (packed)));
+    }
+    static inline void store (char* ptr, KalmanVec vals){
+        __m128i ints = KVToI32 (vals);
+        ints = _mm_packs_epi16 (_mm_packs_epi32 (ints, ints), ints);
+        int packed = _mm_cvtsi128_si32 (ints);
+        memcpy (ptr, &packed, 4);
+    }
+};
+
+template <> struct KalmanLanes<unsigned char>{
+    static inline KalmanVec load (const unsigned char* ptr){
+        int packed;
+        memcpy (&packed, ptr, 4);
+        return KVFromI32 (_mm_cvtepu8_epi32 (_mm_cvtsi32_si128 (packed)));
+    }
+    static inline void store (unsigned char* ptr, KalmanVec vals){
+        __m128i ints = KVToI32 (vals);
+        ints = _mm_packus_epi16 (_mm_packus_epi32 (ints, ints), ints);
+        int packed = _mm_cvtsi128_si32 (ints);
+        memcpy (ptr, &packed, 4);
+    }
+};
+
+template <> struct KalmanLanes<short>{
+    static inline KalmanVec load (const short* ptr){
+        return KVFromI32 (_mm_cvtepi16_epi32 (_mm_loadl_epi64 ((const __m128i*)ptr)));
+    }
+    static inline void store (short* ptr, KalmanVec vals){
+        __m128i ints = KVToI32 (vals);
+        _mm_storel_epi64 ((__m128i*)ptr, _mm_packs_epi32 (ints, ints));
+    }
+};
+
+template <> struct KalmanLanes<unsigned short>{
+    static inline KalmanVec load (const unsigned short* ptr){
+        return KVFromI32 (_mm_cvtepu16_epi32 (_mm_loadl_epi64 ((const __m128i*)ptr)));
+    }
+    static inline void store (unsigned short* ptr, KalmanVec vals){
+        __m128i ints = KVToI32 (vals);
+        _mm_storel_epi64 ((__m128i*)ptr, _mm_packus_epi32 (ints, ints));
+    }
+};
+
+template <> struct KalmanLanes<SInt32>{
+    static inline KalmanVec load (const SInt32* ptr){
+        return KVFromI32 (_mm_loadu_si128 ((const __m128i*)ptr));
+    }
+    static inline void store (SInt32* ptr, KalmanVec vals){
+        _mm_storeu_si128 ((__m128i*)ptr, KVToI32 (vals));
+    }
+};
+
+template <> struct KalmanLanes<UInt32>{
+    static inline KalmanVec load (const UInt32* ptr){
+        return KVFromU32 (_mm_loadu_si128 ((const __m128i*)ptr));
+    }
+    static inline void store (UInt32* ptr, KalmanVec vals){
+        _mm_storeu_si128 ((__m128i*)ptr, KVToU32 (vals));
+    }
+};
+
+template <> struct KalmanLanes<double>{
+    static inline KalmanVec load (const double* ptr){
+        return KVLoadF64 (ptr);
+    }
+    static inline void store (double* ptr, KalmanVec vals){
+        KVStoreF64 (ptr, vals);
+    }
+};
+
+/* Loads KALMAN_FVEC_PTS points of a wave type into a KalmanFVec, and stores them back, truncating to integers
+ Last Modified 2026/10/16 */
+template <typename T> struct KalmanFLanes;
+
+template <> struct KalmanFLanes<char>{
+    static inline KalmanFVec load (const char* ptr){ return KFLoadI8 (ptr); }
+    static inline void store (char* ptr, KalmanFVec vals){ KFStoreI8 (ptr, vals); }
+};
+
+template <> struct KalmanFLanes<unsigned char>{
+    static inline KalmanFVec load (const unsigned char* ptr){ return KFLoadU8 (ptr); }
+    static inline void store (unsigned char* ptr, KalmanFVec vals){ KFStoreU8 (ptr, vals); }
+};
+
+template <> struct KalmanFLanes<short>{
+    static inline KalmanFVec load (const short* ptr){ return KFLoadI16 (ptr); }
+    static inline void store (short* ptr, KalmanFVec vals){ KFStoreI16 (ptr, vals); }
+};
+
+template <> struct KalmanFLanes<unsigned short>{
+    static inline KalmanFVec load (const unsigned short* ptr){ return KFLoadU16 (ptr); }
+    static inline void store (unsigned short* ptr, KalmanFVec vals){ KFStoreU16 (ptr, vals); }
+};
+
+template <> struct KalmanFLanes<float>{
+    static inline KalmanFVec load (const float* ptr){ return KFLoadF32 (ptr); }
+    static inline void store (float* ptr, KalmanFVec vals){ KFStoreF32 (ptr, vals); }
+};
+
+/* Averages layers 1 to numLayers - 1 of the source into the destination in doubles, 4 points at a time, as done by the
+ scalar loops of KalmanT. srcWave points to the start of layer 1. Points left over at the end of the tile are done with
+ the scalar expressions. Used for all integer types with no multiplier, and for double waves
+ Last Modified 2026/10/16 */
+template <typename T> int KalmanSIMDDoubleLayersT (T* srcWave, T* destWaveStart, CountInt pixPerThread, CountInt pixToNextFrame, CountInt numLayers, float multiplier){
+    const bool isInteger = std::numeric_limits<T>::is_integer;
+    CountInt pixInVecs = pixPerThread - (pixPerThread % 4);
+    CountInt iPix, layer;
+    KalmanVec multVec = KVSet1 ((double)multiplier);
+    KalmanVec layerVec, nextLayerVec, destVals, srcVals, avgVals;
+    for (layer = 1; layer < numLayers; layer++, srcWave += pixPerThread + pixToNextFrame){
+        layerVec = KVSet1 ((double)layer);
+        nextLayerVec = KVSet1 ((double)(layer + 1));
+        if (multiplier > 1){
+            for (iPix = 0; iPix < pixInVecs; iPix += 4){
+                destVals = KalmanLanes<T>::load (destWaveStart + iPix);
+                srcVals = KalmanLanes<T>::load (srcWave + iPix);
+                avgVals = KVDiv (KVAdd (KVMul (destVals, layerVec), KVMul (srcVals, multVec)), nextLayerVec);
+                KalmanLanes<T>::store (destWaveStart + iPix, avgVals);
+            }
+            for (; iPix < pixPerThread; iPix++){
+                destWaveStart [iPix] = ((destWaveStart [iPix] * layer) + srcWave [iPix] * multiplier)/(layer + 1);
+            }
+        }else{
+            for (iPix = 0; iPix < pixInVecs; iPix += 4){
+                destVals = KalmanLanes<T>::load (destWaveStart + iPix);
+                srcVals = KalmanLanes<T>::load (srcWave + iPix);
+                avgVals = KVDiv (KVAdd (KVMul (destVals, layerVec), srcVals), nextLayerVec);
+                if (isInteger) avgVals = KVTrunc (avgVals);
+                KalmanLanes<T>::store (destWaveStart + iPix, avgVals);
+            }
+            for (; iPix < pixPerThread; iPix++){
+                destWaveStart [iPix] = ((destWaveStart [iPix] * layer) + srcWave [iPix])/(layer + 1);
+            }
+        }
+    }
+    return 0;
+}
+
+/* Averages layers 1 to numLayers - 1 in floats, KALMAN_FVEC_PTS points at a time, for 8 and 16 bit integer types with a
+ multiplier, and float waves
+ Last Modified 2026/10/16 */
+template <typename T> int KalmanSIMDFloatLayersT (T* srcWave, T* destWaveStart, CountInt pixPerThread, CountInt pixToNextFrame, CountInt numLayers, float multiplier){
+    CountInt pixInVecs = pixPerThread - (pixPerThread % KALMAN_FVEC_PTS);
+    CountInt iPix, layer;
+    KalmanFVec multVec = KFSet1 (multiplier);
+    KalmanFVec layerVec, nextLayerVec, destVals, srcVals, avgVals;
+    for (layer = 1; layer < numLayers; layer++, srcWave += pixPerThread + pixToNextFrame){
+        layerVec = KFSet1 ((float)layer);
+        nextLayerVec = KFSet1 ((float)(layer + 1));
+        if (multiplier > 1){
+            for (iPix = 0; iPix < pixInVecs; iPix += KALMAN_FVEC_PTS){
+                destVals = KalmanFLanes<T>::load (destWaveStart + iPix);
+                srcVals = KalmanFLanes<T>::load (srcWave + iPix);
+                avgVals = KFDiv (KFAdd (KFMul (destVals, layerVec), KFMul (srcVals, multVec)), nextLayerVec);
+                KalmanFLanes<T>::store (destWaveStart + iPix, avgVals);
+            }
+            for (; iPix < pixPerThread; iPix++){
+                destWaveStart [iPix] = ((destWaveStart [iPix] * layer) + srcWave [iPix] * multiplier)/(layer + 1);
+            }
+        }else{
+            for (iPix = 0; iPix < pixInVecs; iPix += KALMAN_FVEC_PTS){
+                destVals = KalmanFLanes<T>::load (destWaveStart + iPix);
+                srcVals = KalmanFLanes<T>::load (srcWave + iPix);
+                avgVals = KFDiv (KFAdd (KFMul (destVals, layerVec), srcVals), nextLayerVec);
+                KalmanFLanes<T>::store (destWaveStart + iPix, avgVals);
+            }
+            for (; iPix < pixPerThread; iPix++){
+                destWaveStart [iPix] = ((destWaveStart [iPix] * layer) + srcWave [iPix])/(layer + 1);
+            }
+        }
+    }
+    return 0;
+}
+
+/* Picks float or double lanes for each wave type, as described at the top of this file
+ Last Modified 2026/10/16 */
+template <typename T> int KalmanSIMDLayers (T* srcWave, T* destWaveStart, CountInt pixPerThread, CountInt pixToNextFrame, CountInt numLayers, float multiplier){
+    if (multiplier > 1) return 1;
+    return KalmanSIMDDoubleLayersT (srcWave, destWaveStart, pixPerThread, pixToNextFrame, numLayers, multiplier);
+}
+
+template <typename T> int KalmanSIMDSmallIntLayers (T* srcWave, T* destWaveStart, CountInt pixPerThread, CountInt pixToNextFrame, CountInt numLayers, float multiplier){
+    if (multiplier > 1) return KalmanSIMDFloatLayersT (srcWave, destWaveStart, pixPerThread, pixToNextFrame, numLayers, multiplier);
+    return KalmanSIMDDoubleLayersT (srcWave, destWaveStart, pixPerThread, pixToNextFrame, numLayers, multiplier);
+}
+
+template <> int KalmanSIMDLayers (char* srcWave, char* destWaveStart, CountInt pixPerThread, CountInt pixToNextFrame, CountInt numLayers, float multiplier){
+    return KalmanSIMDSmallIntLayers (srcWave, destWaveStart, pixPerThread, pixToNextFrame, numLayers, multiplier);
+}
+
+template <> int KalmanSIMDLayers (unsigned char* srcWave, unsigned char* destWaveStart, CountInt pixPerThread, CountInt pixToNextFrame, CountInt numLayers, float multiplier){
+    return KalmanSIMDSmallIntLayers (srcWave, destWaveStart, pixPerThread, pixToNextFrame, numLayers, multiplier);
+}
+
+template <> int KalmanSIMDLayers (short* srcWave, short* destWaveStart, CountInt pixPerThread, CountInt pixToNextFrame, CountInt numLayers, float multiplier){
+    return KalmanSIMDSmallIntLayers (srcWave, destWaveStart, pixPerThread, pixToNextFrame, numLayers, multiplier);
+}
+
+template <> int KalmanSIMDLayers (unsigned short* srcWave, unsigned short* destWaveStart, CountInt pixPerThread, CountInt pixToNextFrame, CountInt numLayers, float multiplier){
+    return KalmanSIMDSmallIntLayers (srcWave, destWaveStart, pixPerThread, pixToNextFrame, numLayers, multiplier);
+}
+
+template <> int KalmanSIMDLayers (float* srcWave, float* destWaveStart, CountInt pixPerThread, CountInt pixToNextFrame, CountInt numLayers, float multiplier){
+    if (!KALMAN_SIMD_FP_WAVES) return 1;
+    return KalmanSIMDFloatLayersT (srcWave, destWaveStart, pixPerThread, pixToNextFrame, numLayers, multiplier);
+}
+
+template <> int KalmanSIMDLayers (double* srcWave, double* destWaveStart, CountInt pixPerThread, CountInt pixToNextFrame, CountInt numLayers, float multiplier){
+    if (!KALMAN_SIMD_FP_WAVES) return 1;
+    return KalmanSIMDDoubleLayersT (srcWave, destWaveStart, pixPerThread, pixToNextFrame, numLayers, multiplier);
+}
@@ -0,0 +1,96 @@
+#include "twoPhotonKernels.h"
+/* ---------------------------------------------Kalman Kernels SSE4.1------------------------------------------------
+ The running average loops of KalmanT with 4 doubles in a pair of 128 bit SSE registers, or 4 floats in one. This file
+ is built with SSE4.1 code generation on (-msse4.1 for gcc and clang), and KalmanT only calls it when gSIMDLevel is
+ CPU_SIMD_SSE41. Built for other processors, or without SSE4.1, KalmanLayersSSE41 returns 1 and the scalar loops are
+ used
+ Last Modified 2026/10/16
+ ---------------------------------------------------------------------------------------------------------------*/
+#if defined (__SSE4_1__) || (defined (_MSC_VER) && (defined (_M_X64) || defined (_M_IX86)))
+#include <smmintrin.h>
+#include <limits>
+
+namespace {
+
+typedef struct KalmanVec{
+    __m128d lo;     // points 0 and 1
+    __m128d hi;     // points 2 and 3
+} KalmanVec;
+
+static inline KalmanVec KVMake (__m128d lo, __m128d hi){ KalmanVec vals = {lo, hi}; return vals; }
+static inline KalmanVec KVSet1 (double val){ return KVMake (_mm_set1_pd (val), _mm_set1_pd (val)); }
+static inline KalmanVec KVAdd (KalmanVec a, KalmanVec b){ return KVMake (_mm_add_pd (a.lo, b.lo), _mm_add_pd (a.hi, b.hi)); }
+static inline KalmanVec KVMul (KalmanVec a, KalmanVec b){ return KVMake (_mm_mul_pd (a.lo, b.lo), _mm_mul_pd (a.hi, b.hi)); }
+static inline KalmanVec KVDiv (KalmanVec a, KalmanVec b){ return KVMake (_mm_div_pd (a.lo, b.lo), _mm_div_pd (a.hi, b.hi)); }
+static inline KalmanVec KVTrunc (KalmanVec a){
+    return KVMake (_mm_round_pd (a.lo, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC), _mm_round_pd (a.hi, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC));
+}
+static inline KalmanVec KVFromI32 (__m128i ints){ return KVMake (_mm_cvtepi32_pd (ints), _mm_cvtepi32_pd (_mm_unpackhi_epi64 (ints, ints))); }
+// unsigned ints are offset by 2^31 to convert them as signed ints, and the offset added back as a double
+static inline KalmanVec KVFromU32 (__m128i ints){
+    return KVAdd (KVFromI32 (_mm_xor_si128 (ints, _mm_set1_epi32 ((int)0x80000000))), KVSet1 (2147483648.0));
+}
+static inline KalmanVec KVLoadF64 (const double* ptr){ return KVMake (_mm_loadu_pd (ptr), _mm_loadu_pd (ptr + 2)); }
+static inline __m128i KVToI32 (KalmanVec a){ return _mm_unpacklo_epi64 (_mm_cvttpd_epi32 (a.lo), _mm_cvttpd_epi32 (a.hi)); }
+static inline __m128i KVToU32 (KalmanVec a){
+    return _mm_xor_si128 (KVToI32 (KVAdd (a, KVSet1 (-2147483648.0))), _mm_set1_epi32 ((int)0x80000000));
+}
+static inline void KVStoreF64 (double* ptr, KalmanVec a){ _mm_storeu_pd (ptr, a.lo); _mm_storeu_pd (ptr + 2, a.hi); }
+
+typedef __m128 KalmanFVec;
+#define KALMAN_FVEC_PTS 4
+
+static inline KalmanFVec KFSet1 (float val){ return _mm_set1_ps (val); }
+static inline KalmanFVec KFAdd (KalmanFVec a, KalmanFVec b){ return _mm_add_ps (a, b); }
+static inline KalmanFVec KFMul (KalmanFVec a, KalmanFVec b){ return _mm_mul_ps (a, b); }
+static inline KalmanFVec KFDiv (KalmanFVec a, KalmanFVec b){ return _mm_div_ps (a, b); }
+// loads 4 bytes, for 4 8 bit points
+static inline __m128i KFLoad4Bytes (const void* ptr){
+    int packed;
+    memcpy (&packed, ptr, 4);
+    return _mm_cvtsi32_si128 (packed);
+}
+static inline void KFStore4Bytes (void* ptr, __m128i bytes){
+    int packed = _mm_cvtsi128_si32 (bytes);
+    memcpy (ptr, &packed, 4);
+}
+static inline KalmanFVec KFLoadI8 (const char* ptr){ return _mm_cvtepi32_ps (_mm_cvtepi8_epi32 (KFLoad4Bytes (ptr))); }
+static inline KalmanFVec KFLoadU8 (const unsigned char* ptr){ return _mm_cvtepi32_ps (_mm_cvtepu8_epi32 (KFLoad4Bytes (ptr))); }
+static inline KalmanFVec KFLoadI16 (const short* ptr){ return _mm_cvtepi32_ps (_mm_cvtepi16_epi32 (_mm_loadl_epi64 ((const __m128i*)ptr))); }
+static inline KalmanFVec KFLoadU16 (const unsigned short* ptr){ return _mm_cvtepi32_ps (_mm_cvtepu16_epi32 (_mm_loadl_epi64 ((const __m128i*)ptr))); }
+static inline KalmanFVec KFLoadF32 (const float* ptr){ return _mm_loadu_ps (ptr); }
+static inline void KFStoreI8 (char* ptr, KalmanFVec a){
+    __m128i ints = _mm_packs_epi32 (_mm_cvttps_epi32 (a), _mm_setzero_si128 ());
+    KFStore4Bytes (ptr, _mm_packs_epi16 (ints, ints));
+}
+static inline void KFStoreU8 (unsigned char* ptr, KalmanFVec a){
+    __m128i ints = _mm_packus_epi32 (_mm_cvttps_epi32 (a), _mm_setzero_si128 ());
+    KFStore4Bytes (ptr, _mm_packus_epi16 (ints, ints));
+}
+static inline void KFStoreI16 (short* ptr, KalmanFVec a){ _mm_storel_epi64 ((__m128i*)ptr, _mm_packs_epi32 (_mm_cvttps_epi32 (a), _mm_setzero_si128 ())); }
+static inline void KFStoreU16 (unsigned short* ptr, KalmanFVec a){ _mm_storel_epi64 ((__m128i*)ptr, _mm_packus_epi32 (_mm_cvttps_epi32 (a), _mm_setzero_si128 ())); }
+static inline void KFStoreF32 (float* ptr, KalmanFVec a){ _mm_storeu_ps (ptr, a); }
+
+#define KALMAN_SIMD_FP_WAVES 0
+
+#include "KalmanKernelsSIMD.h"
+
+}
+
+template <typename T> int KalmanLayersSSE41 (T* srcWave, T* destWaveStart, CountInt pixPerThread, CountInt pixToNextFrame, CountInt numLayers, float multiplier){
+    return KalmanSIMDLayers (srcWave, destWaveStart, pixPerThread, pixToNextFrame, numLayers, multiplier);
+}
+#else
+template <typename T> int KalmanLayersSSE41 (T* srcWave, T* destWaveStart, CountInt pixPerThread, CountInt pixToNextFrame, CountInt numLayers, float multiplier){
+    return 1;
+}
+#endif
+
+template int KalmanLayersSSE41 (char*, char*, CountInt, CountInt, CountInt, float);
+template int KalmanLayersSSE41 (unsigned char*, unsigned char*, CountInt, CountInt, CountInt, float);
+template int KalmanLayersSSE41 (short*, short*, CountInt, CountInt, CountInt, float);
+template int KalmanLayersSSE41 (unsigned short*, unsigned short*, CountInt, CountInt, CountInt, float);
+template int KalmanLayersSSE41 (SInt32*, SInt32*, CountInt, CountInt, CountInt, float);
+template int KalmanLayersSSE41 (UInt32*, UInt32*, CountInt, CountInt, CountInt, float);
+template int KalmanLayersSSE41 (float*, float*, CountInt, CountInt, CountInt, float);
+template int KalmanLayersSSE41 (double*, double*, CountInt, CountInt, CountInt, float);
@@ -0,0 +1,794 @@
+#include "twoPhotonKernels.h"
+#include <limits>
+
+/* ------------------------------LSM Utility Kernels --------------------------------------------------
+ Templates and tile functions for the LSM utilities. The XFUNCs that call them are in LSMUtilties.cpp
+ Last Modified 2026/10/16
+ -------------------------------------------------------------------------------------------------*/
+
+/* -------------------------------- SwapEven -------------------------------------------------------
+ horizontally swaps every other line in an image or series of images.
+ Used after doing back and forth scanning, where every other line is scanned from the opposite direction.
+ ----------------------------------------------------------------------------------------------------- */
+
+/* Template for SwapEven function
+Last Modified 2013/07/15 by Jamie Boyd */
+template <typename T> void SwapEvenT (T *dataStartPtr, CountInt numLines, CountInt lineLen) {
+    // make Pointer to end of the data
+    T* dataEndPtr = dataStartPtr + (numLines * lineLen);
+    // make pointers for start and end of each line
+    T* lineStartPtr;
+    T* lineEndPtr;
+    //temporary value for swapping
+    T temp;
+    // calculate distance to start and end of next line
+    CountInt toNextStart = (2 * lineLen) - (lineLen/2);    //due to rounding of integer math, it doesn't matter if LineLen is even or odd
+    CountInt toNextEnd = (2 * lineLen) + (lineLen/2);
+    //iterate through every other line, flipping it around
+    for(lineStartPtr = dataStartPtr + lineLen, lineEndPtr = lineStartPtr + lineLen -1; lineEndPtr < dataEndPtr; lineStartPtr += toNextStart,lineEndPtr += toNextEnd) {
+        while (lineStartPtr < lineEndPtr){
+            SWAP (*lineStartPtr, *lineEndPtr);
+            lineStartPtr++;
+            lineEndPtr--;
+        }
+    }
+}
+
+/* Each tile of line pairs to swap, from startPair up to endPair, is done with this function. A pair is an even line,
+ which is left alone, and the odd line after it, which is swapped, so every tile starts on an even line
+Last Modified 2026/10/16 */
+void SwapEvenTile (void* paramsPtr, CountInt startPair, CountInt endPair, UInt32 iSlot){
+    struct SwapEvenThreadParams* p;
+    p = (struct SwapEvenThreadParams*) paramsPtr;
+    CountInt tLines = 2 * (endPair - startPair);
+    CountInt startPos = 2 * startPair * p->lineLen;
+    // call the right template function for the wave types
+    switch (p->inPutWaveType) {
+    case NT_I8:
+        SwapEvenT ((char*) p->dataStartPtr + startPos, tLines, p->lineLen);
+        break;
+    case (NT_I8 | NT_UNSIGNED):
+        SwapEvenT ((unsigned char*)p->dataStartPtr + startPos, tLines, p->lineLen);
+        break;
+    case NT_I16:
+        SwapEvenT ((short*)p->dataStartPtr + startPos, tLines, p->lineLen);
+        break;
+    case (NT_I16 | NT_UNSIGNED):
+        SwapEvenT ((unsigned short*)p->dataStartPtr + startPos, tLines, p->lineLen);
+        break;
+    case NT_I32:
+        SwapEvenT ((SInt32*)p->dataStartPtr + startPos, tLines, p->lineLen);
+        break;
+    case (NT_I32| NT_UNSIGNED):
+        SwapEvenT ((UInt32*)p->dataStartPtr + startPos, tLines, p->lineLen);
+        break;
+    case NT_FP32:
+        SwapEvenT ((float*)p->dataStartPtr + startPos, tLines, p->lineLen);
+        break;
+    case NT_FP64:
+        SwapEvenT ((double*)p->dataStartPtr + startPos, tLines, p->lineLen);
+        break;
+    }
+}
+
+/* Runs SwapEvenTile on the thread pool over all the line pairs in the wave. A last, even, line on its own is not swapped
+ Last Modified 2026/10/16 */
+void SwapEvenRunTiles (SwapEvenThreadParamsPtr paramsPtr){
+    CountInt nPairs = paramsPtr->numLines/2;
+    CountInt minPairsPerTile = LSM_MIN_TILE/(2 * paramsPtr->lineLen) + 1;
+    ThreadPoolRunTiles (SwapEvenTile, paramsPtr, nPairs, ThreadPoolTileSize (nPairs, minPairsPerTile), gNumProcessors);
+}
+
+/* -------------------------------------DownSample--------------------------------------------------------
+Down Sample takes a wave and resizes its X dimension, combining boxfactor points by taking the
+ average, sum, max, or median value of boxFactor points. Used after "oversampling" during scanning,
+ i.e., taking several A/D conversions per pixel
+DownSample methods: 1 = average, 2 = sum, 3 = max, 4 = median
+------------------------------------------------------------------------------------------------------------ */
+
+
+/* Template functions for the various DownSample methods. Each reads boxFactor input points for each output point
+ from srcStartPtr and writes the results to destStartPtr, so tiles can work side by side without overwriting input
+ still to be read by another tile
+Case 1 averaging, with a floating point temporary value.
+Last Modified 2026/10/16 */
+template <typename T> void DSaverageT (T *srcStartPtr, T* destStartPtr, CountInt points, UInt16 boxFactor) {
+    // make Pointer to the end of the data
+    T *dataEndPtr = srcStartPtr + points;
+    T *outPutPtr; // output position varies slowly
+    T *inPutPtr;  // input position varies quickly
+    UInt16 ifactor;
+    double tempVal;
+    //iterate through the wave, averaging input range into output value
+    for (outPutPtr = destStartPtr, inPutPtr = srcStartPtr;inPutPtr < dataEndPtr; outPutPtr++){
+        for (tempVal = 0, ifactor = 0; ifactor < boxFactor; ifactor++, inPutPtr++)
+            tempVal += *inPutPtr;
+        *outPutPtr = (T)(tempVal/boxFactor);
+    }
+}
+
+// Case 2: Summing. Need different function for different bounds checking for floats, signed ints, and unsigned ints
+//Floats: Don't check Max or Min - overflows should automatically go to INF and -INF
+template <typename T> void DSsumFloatT (T *srcStartPtr, T* destStartPtr, CountInt points, UInt16 boxFactor) {
+    T *dataEndPtr = srcStartPtr + points;
+    T *outPutPtr;
+    T *inPutPtr;
+    UInt16 ifactor;
+    for (outPutPtr = destStartPtr, inPutPtr = srcStartPtr;inPutPtr < dataEndPtr; outPutPtr++){
+        for (*outPutPtr = *inPutPtr,inPutPtr++, ifactor = 1; ifactor < boxFactor; ifactor++, inPutPtr++)
+            *outPutPtr = *outPutPtr + *inPutPtr;
+    }
+}
+
+// Signed Ints: Check OverFlows at both ends (Max and Min). Sum is done in double so 32 bit sums can't wrap around
+template <typename T> void DSsumSignedIntT (T *srcStartPtr, T* destStartPtr, CountInt points, UInt16 boxFactor, T Tmax, T Tmin){
+    T *dataEndPtr = srcStartPtr + points;
+    T *outPutPtr;
+    T *inPutPtr;
+    UInt16 ifactor;
+    double tempVal;
+    for (outPutPtr = destStartPtr, inPutPtr = srcStartPtr;inPutPtr < dataEndPtr; outPutPtr++){
+        for (tempVal = 0, ifactor = 0; ifactor < boxFactor; ifactor++, inPutPtr++)
+            tempVal += *inPutPtr;
+        if (tempVal > Tmax) //Check Max
+            *outPutPtr = Tmax;
+        else{
+            if (tempVal < Tmin) //Check Min
+                *outPutPtr = Tmin;
+            else
+                *outPutPtr = (T)tempVal;
+        }
+    }
+}
+
+// Unsigned integer types: Check OverFlows only for Max. Sum is done in double so 32 bit sums can't wrap around
+template <typename T> void DSsumUnSignedIntT (T *srcStartPtr, T* destStartPtr, CountInt points, UInt16 boxFactor, T Tmax){
+    T *dataEndPtr = srcStartPtr + points;
+    T *outPutPtr;
+    T *inPutPtr;
+    UInt16 ifactor;
+    double tempVal;
+    for (outPutPtr = destStartPtr, inPutPtr = srcStartPtr;inPutPtr < dataEndPtr; outPutPtr++){
+        for (tempVal = 0, ifactor = 0; ifactor < boxFactor; ifactor++, inPutPtr++)
+            tempVal += *inPutPtr;
+        if (tempVal > Tmax)  //check Max
+            *outPutPtr = Tmax;
+        else
+            *outPutPtr = (T)tempVal;
+    }
+}
+
+//Case 3: Take maximum Value
+template <typename T> void DSMaxT (T *srcStartPtr, T* destStartPtr, CountInt points, UInt16 boxFactor){
+    // make Pointer to the end of the data
+    T *dataEndPtr = srcStartPtr + points;
+    T *outPutPtr;
+    T *inPutPtr;
+    UInt16 ifactor;
+
+    for (outPutPtr = destStartPtr, inPutPtr = srcStartPtr;inPutPtr < dataEndPtr; outPutPtr++){
+        *outPutPtr = *inPutPtr;
+        inPutPtr++;
+        for (ifactor = 1; ifactor < boxFactor; ifactor++, inPutPtr++){
+            if (*outPutPtr < *inPutPtr)
+                *outPutPtr = *inPutPtr;
+        }
+    }
+}
+
+//case 4: take median value. Each box of input is partly sorted in place to find its median
+template <typename T> void DSMedianT (T *srcStartPtr, T* destStartPtr, CountInt points, UInt16 boxFactor){
+    // make Pointer to the end of the data
+    T *dataEndPtr = srcStartPtr + points;
+    T *outPutPtr;
+    T *inPutPtr;
+    for (outPutPtr = destStartPtr, inPutPtr = srcStartPtr;inPutPtr < dataEndPtr; outPutPtr++, inPutPtr += boxFactor){
+        *outPutPtr = medianT ((UInt32)boxFactor, inPutPtr);
+    }
+}
+
+
+/* Returns the number of bytes in each point of a wave of one of the 8 types DownSample works with, or 0 for other types
+ Last Modified 2026/10/16 */
+UInt8 DownSamplePointBytes (int waveType){
+    switch (waveType) {
+        case NT_FP64:
+            return 8;
+        case NT_FP32:
+        case (NT_I32 | NT_UNSIGNED):
+        case NT_I32:
+            return 4;
+        case (NT_I16 | NT_UNSIGNED):
+        case NT_I16:
+            return 2;
+        case (NT_I8 | NT_UNSIGNED):
+        case NT_I8:
+            return 1;
+    }
+    return 0;
+}
+
+/* Each tile of boxes to down sample, from startBox up to endBox, is done with this function. Results go to the
+ output buffer, which is copied back over the start of the wave when all the tiles are done
+Last Modified 2026/10/16 */
+void DownSampleTile (void* paramsPtr, CountInt startBox, CountInt endBox, UInt32 iSlot){
+    struct DownSampleThreadParams* p;
+    p = (struct DownSampleThreadParams*) paramsPtr;
+    UInt16 boxFactor = (UInt16)p->boxFactor;
+    CountInt tPoints = (endBox - startBox) * boxFactor;  // number of input points in this tile
+    CountInt startPos = startBox * boxFactor;           // starting input position for this tile
+    char* dataStartPtr = p->dataStartPtr;
+    char* outPutPtr = p->outPutBufferPtr;
+    // call the right template function for the down sample type
+    switch (p->inPutWaveType) {
+        case NT_FP64:
+            switch (p->DSType){
+                case 1:    //average
+                    DSaverageT ((double*)dataStartPtr + startPos, (double*)outPutPtr + startBox, tPoints, boxFactor);
+                    break;
+                case 2: // sum
+                    DSsumFloatT ((double*)dataStartPtr + startPos, (double*)outPutPtr + startBox, tPoints, boxFactor);
+                    break;
+                case 3: //max
+                    DSMaxT ((double*)dataStartPtr + startPos, (double*)outPutPtr + startBox, tPoints, boxFactor);
+                    break;
+                case 4: // median
+                    DSMedianT ((double*)dataStartPtr + startPos, (double*)outPutPtr + startBox, tPoints, boxFactor);
+                    break;
+            }
+            break;
+        case NT_FP32:
+            switch (p->DSType){
+                case 1:    //average
+                    DSaverageT ((float*)dataStartPtr + startPos, (float*)outPutPtr + startBox, tPoints, boxFactor);
+                    break;
+                case 2: // sum
+                    DSsumFloatT ((float*)dataStartPtr + startPos, (float*)outPutPtr + startBox, tPoints, boxFactor);
+                    break;
+                case 3: //max
+                    DSMaxT ((float*)dataStartPtr + startPos, (float*)outPutPtr + startBox, tPoints, boxFactor);
+                    break;
+                case 4: // median
+                    DSMedianT ((float*)dataStartPtr + startPos, (float*)outPutPtr + startBox, tPoints, boxFactor);
+                    break;
+            }
+            break;
+        case (NT_I32 | NT_UNSIGNED):
+            switch (p->DSType){
+                case 1:    //average
+                    DSaverageT ((UInt32*)dataStartPtr + startPos, (UInt32*)outPutPtr + startBox, tPoints, boxFactor);
+                    break;
+                case 2: // sum
+                    DSsumUnSignedIntT ((UInt32*)dataStartPtr + startPos, (UInt32*)outPutPtr + startBox, tPoints, boxFactor,(UInt32)UINT_MAX);
+                    break;
+                case 3: //max
+                    DSMaxT ((UInt32*)dataStartPtr + startPos, (UInt32*)outPutPtr + startBox, tPoints, boxFactor);
+                    break;
+                case 4: // median
+                    DSMedianT ((UInt32*)dataStartPtr + startPos, (UInt32*)outPutPtr + startBox, tPoints, boxFactor);
+                    break;
+            }
+            break;
+        case NT_I32:
+            switch (p->DSType){
+                case 1:    //average
+                    DSaverageT ((SInt32*)dataStartPtr + startPos, (SInt32*)outPutPtr + startBox, tPoints, boxFactor);
+                    break;
+                case 2: // sum
+                    DSsumSignedIntT ((SInt32*)dataStartPtr + startPos, (SInt32*)outPutPtr + startBox, tPoints, boxFactor,(SInt32)INT_MAX, (SInt32)INT_MIN);
+                    break;
+                case 3: //max
+                    DSMaxT ((SInt32*)dataStartPtr + startPos, (SInt32*)outPutPtr + startBox, tPoints, boxFactor);
+                    break;
+                case 4: // median
+                    DSMedianT ((SInt32*)dataStartPtr + startPos, (SInt32*)outPutPtr + startBox, tPoints, boxFactor);
+                    break;
+            }
+            break;
+        case (NT_I16 | NT_UNSIGNED):
+            switch (p->DSType){
+                case 1:    //average
+                    DSaverageT ((unsigned short*)dataStartPtr + startPos, (unsigned short*)outPutPtr + startBox, tPoints, boxFactor);
+                    break;
+                case 2: // sum
+                    DSsumUnSignedIntT ((unsigned short*)dataStartPtr + startPos, (unsigned short*)outPutPtr + startBox, tPoints, boxFactor,(unsigned short)USHRT_MAX);
+                    break;
+                case 3: //max
+                    DSMaxT ((unsigned short*)dataStartPtr + startPos, (unsigned short*)outPutPtr + startBox, tPoints, boxFactor);
+                    break;
+                case 4: // median
+                    DSMedianT ((unsigned short*)dataStartPtr + startPos, (unsigned short*)outPutPtr + startBox, tPoints, boxFactor);
+                    break;
+            }
+            break;
+        case NT_I16:
+            switch (p->DSType){
+                case 1:    //average
+                    DSaverageT ((short*)dataStartPtr + startPos, (short*)outPutPtr + startBox, tPoints, boxFactor);
+                    break;
+                case 2: // sum
+                    DSsumSignedIntT ((short*)dataStartPtr + startPos, (short*)outPutPtr + startBox, tPoints, boxFactor,(short)SHRT_MAX, (short)SHRT_MIN);
+                    break;
+                case 3: //max
+                    DSMaxT ((short*)dataStartPtr + startPos, (short*)outPutPtr + startBox, tPoints, boxFactor);
+                    break;
+                case 4: // median
+                    DSMedianT ((short*)dataStartPtr + startPos, (short*)outPutPtr + startBox, tPoints, boxFactor);
+                    break;
+            }
+            break;
+        case (NT_I8 | NT_UNSIGNED):
+            switch (p->DSType){
+                case 1:    //average
+                    DSaverageT ((unsigned char*)dataStartPtr + startPos, (unsigned char*)outPutPtr + startBox, tPoints, boxFactor);
+                    break;
+                case 2: // sum
+                    DSsumUnSignedIntT ((unsigned char*)dataStartPtr + startPos, (unsigned char*)outPutPtr + startBox, tPoints, boxFactor,(unsigned char)UCHAR_MAX);
+                    break;
+                case 3: //max
+                    DSMaxT ((unsigned char*)dataStartPtr + startPos, (unsigned char*)outPutPtr + startBox, tPoints, boxFactor);
+                    break;
+                case 4: // median
+                    DSMedianT ((unsigned char*)dataStartPtr + startPos, (unsigned char*)outPutPtr + startBox, tPoints, boxFactor);
+                    break;
+            }
+            break;
+        case NT_I8:
+            switch (p->DSType){
+                case 1:    //average
+                    DSaverageT ((char*)dataStartPtr + startPos, (char*)outPutPtr + startBox, tPoints, boxFactor);
+                    break;
+                case 2: // sum
+                    DSsumSignedIntT ((char*)dataStartPtr + startPos, (char*)outPutPtr + startBox, tPoints, boxFactor,(char)SCHAR_MAX, (char)SCHAR_MIN);
+                    break;
+                case 3: //max
+                    DSMaxT ((char*)dataStartPtr + startPos, (char*)outPutPtr + startBox, tPoints, boxFactor);
+                    break;
+                case 4: // median
+                    DSMedianT ((char*)dataStartPtr + startPos, (char*)outPutPtr + startBox, tPoints, boxFactor);
+                    break;
+            }
+            break;
+    }    // end of switch
+}
+
+/* Runs DownSampleTile on the thread pool over all the boxes in the wave, then copies the down-sampled data from the
+ output buffer back over the start of the wave
+ Last Modified 2026/10/16 */
+void DownSampleRunTiles (DownSampleThreadParamsPtr paramsPtr){
+    CountInt nBoxes = paramsPtr->points/paramsPtr->boxFactor;
+    CountInt minBoxesPerTile = LSM_MIN_TILE/paramsPtr->boxFactor + 1;
+    ThreadPoolRunTiles (DownSampleTile, paramsPtr, nBoxes, ThreadPoolTileSize (nBoxes, minBoxesPerTile), gNumProcessors);
+    memcpy (paramsPtr->dataStartPtr, paramsPtr->outPutBufferPtr, nBoxes * DownSamplePointBytes (paramsPtr->inPutWaveType));
+}
+
+
+/*  ---------------------------------------Transpose Frames------------------------------------------------------------
+Transposes each frame in a 3D wave (equivalent to a horizontal flip and a 90 degree counter-clockwise rotation).
+Useful because microscope may have an odd number of  mirrors in the light path
+ ------------------------------------------------------------------------------------------------------------------- */
+
+/* template function for transposeFrames that are not square
+ Last Modified: 2025/06/23 by Jamie Boyd */
+template <typename T> void TransposeFramesT (T *dataStartPtr, T *frameCopyStart, CountInt xSize, CountInt ySize, CountInt zSize) {
+    CountInt frameSize = (xSize * ySize);
+    CountInt frameBytes = (frameSize * sizeof(T));
+    // make Pointer to end of the data
+    T* dataEndPtr = dataStartPtr + (frameSize * zSize);
+    // make pointer for progressing through the given data
+    T *dataWavePtr;
+    //pointers for iterating through x and y
+    T *frameCopyPtr, *frameXend, *frameYend;
+    CountInt toNextX = frameSize-1;
+    for (dataWavePtr= dataStartPtr; dataWavePtr < dataEndPtr;){
+        //make a copy of the current frame into the frame copy buffer
+        frameCopyStart = (T*) memcpy ((void*)frameCopyStart, (void*)dataWavePtr, frameBytes);
+        //iterate through x
+        for (frameCopyPtr = frameCopyStart, frameXend = frameCopyStart + xSize;frameCopyPtr < frameXend;frameCopyPtr -= toNextX){
+            // iterate through y
+            for (frameYend = frameCopyPtr + frameSize; frameCopyPtr < frameYend ;frameCopyPtr += xSize, dataWavePtr+=1){
+                *dataWavePtr = *frameCopyPtr;
+            }
+        }
+    }
+}
+
+/* Template function for TransposeFrames functions with frames that are square, as they often are.
+ Does not need to use a frame buffer, so should be a little faster
+ Last Modified 2013/07/15 by Jamie Boyd */
+template <typename T> void TransposeSquareFramesT (T *dataStartPtr, CountInt xySize, CountInt zSize){
+    CountInt frameSize = xySize * xySize;
+    // make Pointer to end of the data
+    T* dataEndPtr = dataStartPtr + ((frameSize * zSize) - xySize);
+    // make pointers for progressing through the data
+    T *xPtr, *yPtr;
+    // variables to point to the ends of the current line. x and y both the same, so we only need count X
+    T *xEndLinePtr;
+    // variable to count lines
+    CountInt lines;
+    // frames - 1, just because it's easier to read this way
+    CountInt frameSizeMinus1 = frameSize - 1;
+    // temp variable for SWAP macro
+    T temp;
+    //frames
+    for (xPtr = dataStartPtr + 1, yPtr = dataStartPtr + xySize; xPtr < dataEndPtr; xPtr += 1,yPtr += 1){
+        //columns/rows
+        for (lines = 1; lines < xySize; lines += 1, xPtr += lines, yPtr -= (frameSizeMinus1 - lines*xySize)){
+            // points in individual column/row
+            for (xEndLinePtr = xPtr + (xySize - lines); xPtr < xEndLinePtr; xPtr += 1,yPtr += xySize){
+                SWAP (*xPtr, *yPtr);
+            }
+        }
+    }
+}
+
+
+/* Each tile of frames to transpose, from startFrame up to endFrame, is done with this function. Frames that are not
+ square use the frame buffer for iSlot
+Last Modified 2026/10/16 */
+void TransposeFramesTile (void* paramsPtr, CountInt startFrame, CountInt endFrame, UInt32 iSlot){
+    struct TransposeFramesThreadParams* p = (struct TransposeFramesThreadParams*) paramsPtr;
+    CountInt frameSize = p->xSize * p->ySize;
+    CountInt tFrames = endFrame - startFrame;  // number of frames in this tile
+    CountInt startOffset = startFrame * frameSize;   // starting position for this tile
+    if (p->xSize == p->ySize){
+        switch (p->inPutWaveType) {
+            case NT_FP64:
+                TransposeSquareFramesT (((double*) p->dataStartPtr) + startOffset, p->xSize, tFrames);
+                break;
+            case NT_FP32:
+                TransposeSquareFramesT (((float*) p->dataStartPtr) + startOffset, p->xSize, tFrames);
+                break;
+            case (NT_I32 | NT_UNSIGNED):
+                TransposeSquareFramesT (((UInt32*) p->dataStartPtr) + startOffset, p->xSize, tFrames);
+                break;
+            case NT_I32:
+                TransposeSquareFramesT (((SInt32*) p->dataStartPtr) + startOffset, p->xSize, tFrames);
+                break;
+            case (NT_I16 | NT_UNSIGNED):
+                TransposeSquareFramesT (((unsigned short*) p->dataStartPtr) + startOffset, p->xSize, tFrames);
+                break;
+            case NT_I16:
+                TransposeSquareFramesT (((short*) p->dataStartPtr) + startOffset, p->xSize, tFrames);
+                break;
+            case (NT_I8 | NT_UNSIGNED):
+                TransposeSquareFramesT (((unsigned char*) p->dataStartPtr) + startOffset, p->xSize, tFrames);
+                break;
+            case NT_I8:
+                TransposeSquareFramesT (((char*) p->dataStartPtr) + startOffset, p->xSize, tFrames);
+                break;
+        }
+    }else{
+        CountInt bufferOffset =iSlot * frameSize; // this is in points, not bytes.
+        switch (p->inPutWaveType) {
+            case NT_FP64:
+                TransposeFramesT (((double*) p->dataStartPtr) + startOffset, ((double*) p->bufferPtr) + bufferOffset, p->xSize, p->ySize, tFrames);
+                break;
+            case NT_FP32:
+                TransposeFramesT (((float*) p->dataStartPtr) + startOffset, ((float*) p->bufferPtr) + bufferOffset, p->xSize, p->ySize, tFrames);
+                break;
+            case (NT_I32 | NT_UNSIGNED):
+                TransposeFramesT (((UInt32*) p->dataStartPtr) + startOffset, ((UInt32*) p->bufferPtr) + bufferOffset, p->xSize, p->ySize, tFrames);
+                break;
+            case NT_I32:
+                TransposeFramesT (((SInt32*) p->dataStartPtr) + startOffset, ((SInt32*)p->bufferPtr) + bufferOffset, p->xSize, p->ySize, tFrames);
+                break;
+            case (NT_I16 | NT_UNSIGNED):
+                TransposeFramesT (((unsigned short*) p->dataStartPtr) + startOffset, ((unsigned short*)p->bufferPtr) + bufferOffset, p->xSize, p->ySize, tFrames);
+                break;
+            case NT_I16:
+                TransposeFramesT (((SInt16*) p->dataStartPtr) + startOffset, ((SInt16*)p->bufferPtr) + bufferOffset, p->xSize, p->ySize, tFrames);
+                break;
+            case (NT_I8 | NT_UNSIGNED):
+                TransposeFramesT (((unsigned char*) p->dataStartPtr) + startOffset, ((unsigned char*) p->bufferPtr) + bufferOffset, p->xSize, p->ySize, tFrames);
+                break;
+            case NT_I8:
+                TransposeFramesT (((char*) p->dataStartPtr) + startOffset, ((char*)p->bufferPtr) + bufferOffset, p->xSize, p->ySize, tFrames);
+                break;
+        }
+    }
+ }
+
+/* -------------------------------Decumulate Functions--------------------------------------------------
+ For photon counting, the counter keeps a running total; i.e., it accumulates. To get counts for each pixel,
+ we need to subtract from the from count at each pixel the count of the pixel before it, i.e., decumulate
+ The National Instrument boards used by twoPhoton have 24 or 32 bit counters, but we make a templated
+ version in case someone has a different use case.
+ -------------------------------------------------------------------------------------------------------- */
+
+/* If you have a 32 bit counter into an unsigned 32 bit wave, counter overflows overflows are handled automatically
+Last Modified: 2026/10/16 */
+void Decumulate32_32(UInt32* dataStart, CountInt numPnts, UInt32 firstValue) {
+    UInt32* srcWavePtr;
+    // set srcWavePtr to last point in wave and work backwards
+    for (srcWavePtr = dataStart + numPnts - 1; srcWavePtr > dataStart; srcWavePtr --) {
+        *srcWavePtr -= *(srcWavePtr - 1);
+    }
+    *srcWavePtr -= firstValue;
+}
+
+
+/* The following template is used to handle any one of the other different types of wave data/counter size
+combos but your wave type must be wider than your counter size. On rollover, the counter has counted maxCount + 1
+past the previous value
+ Last Modified 2026/10/16 */
+template <typename T> void DecumulateT_ (T *dataStart, CountInt NumPnts, UInt32 maxCount, UInt32 firstValue){
+    T *srcWavePtr;
+    T firstT = (T)firstValue;   // the point before dataStart, compared as the wave's type, like the other points
+    // set srcWavePtr to last point in wave and work backwards
+    for (srcWavePtr = dataStart + NumPnts - 1; srcWavePtr > dataStart; srcWavePtr --){
+        if (*(srcWavePtr - 1) > *srcWavePtr)              // counter rollover occurred
+            *srcWavePtr += (T)maxCount + 1;
+        *srcWavePtr -= *(srcWavePtr - 1);
+    }
+    if (firstT > *srcWavePtr)
+        *srcWavePtr += (T)maxCount + 1;
+    *srcWavePtr -= firstT;
+}
+
+
+/* Returns the value of the point before startPos, as a counter value, for the first value of a thread's range
+ Last Modified 2026/10/16 */
+UInt32 DecumulateFirstValue (int waveType, char* dataStartPtr, CountInt startPos){
+    if (startPos == 0) return 0;
+    switch (waveType) {
+        case NT_I8:
+            return (UInt32)((char*)dataStartPtr) [startPos - 1];
+        case (NT_I8 | NT_UNSIGNED):
+            return (UInt32)((unsigned char*)dataStartPtr) [startPos - 1];
+        case NT_I16:
+            return (UInt32)((short*)dataStartPtr) [startPos - 1];
+        case (NT_I16 | NT_UNSIGNED):
+            return (UInt32)((unsigned short*)dataStartPtr) [startPos - 1];
+        case NT_I32:
+            return (UInt32)((SInt32*)dataStartPtr) [startPos - 1];
+        case (NT_I32 | NT_UNSIGNED):
+            return (UInt32)((UInt32*)dataStartPtr) [startPos - 1];
+        case NT_FP32:
+            return (UInt32)((float*)dataStartPtr) [startPos - 1];
+        case NT_FP64:
+            return (UInt32)((double*)dataStartPtr) [startPos - 1];
+    }
+    return 0;
+}
+
+
+/* Each thread to decumulate a range of points starts with this function
+ Last Modified 2026/10/16 */
+void* DecumulateThread (void* threadarg){
+    struct DecumulateThreadParams* p;
+    p = (struct DecumulateThreadParams*) threadarg;
+    if (p->numPnts == 0) return nullptr;
+    switch (p->inPutWaveType) {
+        case NT_I8:
+            DecumulateT_ ((char*)p->dataStartPtr + p->startPos, p->numPnts, p->maxCount, p->firstValue);
+            break;
+        case (NT_I8 | NT_UNSIGNED):
+            DecumulateT_ ((unsigned char*)p->dataStartPtr + p->startPos, p->numPnts, p->maxCount, p->firstValue);
+            break;
+        case NT_I16:
+            DecumulateT_ ((short*)p->dataStartPtr + p->startPos, p->numPnts, p->maxCount, p->firstValue);
+            break;
+        case (NT_I16 | NT_UNSIGNED):
+            DecumulateT_ ((unsigned short*)p->dataStartPtr + p->startPos, p->numPnts, p->maxCount, p->firstValue);
+            break;
+        case NT_I32:
+            DecumulateT_ ((SInt32*)p->dataStartPtr + p->startPos, p->numPnts, p->maxCount, p->firstValue);
+            break;
+        case (NT_I32 | NT_UNSIGNED):
+            if (p->is3232){
+                Decumulate32_32 ((UInt32*)p->dataStartPtr + p->startPos, p->numPnts, p->firstValue);
+            }else{
+                DecumulateT_ ((UInt32*)p->dataStartPtr + p->startPos, p->numPnts, p->maxCount, p->firstValue);
+            }
+            break;
+        case NT_FP32:
+            DecumulateT_ ((float*)p->dataStartPtr + p->startPos, p->numPnts, p->maxCount, p->firstValue);
+            break;
+        case NT_FP64:
+            DecumulateT_ ((double*)p->dataStartPtr + p->startPos, p->numPnts, p->maxCount, p->firstValue);
+            break;
+    }
+    return nullptr;
+}
+
+/* -------------------------------Frame Pipeline--------------------------------------------------
+ Post-processing of an acquired stack often runs Decumulate, SwapEven, DownSample and KalmanWaveToFrame one after
+ another, each reading and writing the whole wave. The pipeline does them all in one pass instead. Each tile is a
+ range of lines, which it takes through all the stages for one frame before going on to the same lines of the next
+ frame, so the data is read from memory once and stays in cache between stages.
+ SwapEven and DownSample give the same result in either order, as a reversed line down-samples to the reversed
+ down-sampled line. Decumulate must come before both, and Kalman averaging after all of them.
+ -------------------------------------------------------------------------------------------------------- */
+
+/* Down samples nPoints points from srcPtr, putting nPoints/boxFactor results in destPtr. The DownSample templates write
+ each result over input they have already read, so destPtr can be the same as srcPtr, to work in place within a tile
+ Last Modified 2026/10/16 */
+template <typename T> void PipelineDownSampleT (T* srcPtr, T* destPtr, CountInt nPoints, UInt16 boxFactor, UInt8 DSType){
+    switch (DSType){
+        case 1:    //average
+            DSaverageT (srcPtr, destPtr, nPoints, boxFactor);
+            break;
+        case 2: // sum
+            if (!std::numeric_limits<T>::is_integer){
+                DSsumFloatT (srcPtr, destPtr, nPoints, boxFactor);
+            }else if (std::numeric_limits<T>::is_signed){
+                DSsumSignedIntT (srcPtr, destPtr, nPoints, boxFactor, std::numeric_limits<T>::max (), std::numeric_limits<T>::min ());
+            }else{
+                DSsumUnSignedIntT (srcPtr, destPtr, nPoints, boxFactor, std::numeric_limits<T>::max ());
+            }
+            break;
+        case 3: //max
+            DSMaxT (srcPtr, destPtr, nPoints, boxFactor);
+            break;
+        case 4: // median
+            DSMedianT (srcPtr, destPtr, nPoints, boxFactor);
+            break;
+    }
+}
+
+/* Adds one layer of nPoints points to a Kalman average in destPtr, with the same arithmetic as KalmanT, so results are
+ the same as for KalmanWaveToFrame. srcPtr may be the same as destPtr for the first layer. With multiplier < 1, the
+ layers are summed in sumPtr, and the average is put in destPtr after the last layer
+ Last Modified 2026/10/16 */
+template <typename T> void PipelineKalmanT (T* srcPtr, T* destPtr, double* sumPtr, CountInt nPoints, CountInt layer, CountInt numLayers, float multiplier){
+    CountInt iPt;
+    if (multiplier < 1){
+        if (layer == 0){
+            for (iPt = 0; iPt < nPoints; iPt++) sumPtr [iPt] = srcPtr [iPt];
+        }else{
+            for (iPt = 0; iPt < nPoints; iPt++) sumPtr [iPt] += srcPtr [iPt];
+        }
+        if (layer == numLayers - 1){
+            for (iPt = 0; iPt < nPoints; iPt++) destPtr [iPt] = sumPtr [iPt]/numLayers;
+        }
+    }else if (multiplier > 1){
+        if (layer == 0){
+            for (iPt = 0; iPt < nPoints; iPt++) destPtr [iPt] = srcPtr [iPt] * multiplier;
+        }else{
+            for (iPt = 0; iPt < nPoints; iPt++) destPtr [iPt] = ((destPtr [iPt] * layer) + srcPtr [iPt] * multiplier)/(layer + 1);
+        }
+        if (layer == numLayers - 1){
+            for (iPt = 0; iPt < nPoints; iPt++) destPtr [iPt] /= multiplier;
+        }
+    }else{
+        if (layer == 0){
+            if (srcPtr != destPtr) memcpy (destPtr, srcPtr, nPoints * sizeof (T));
+        }else{
+            for (iPt = 0; iPt < nPoints; iPt++) destPtr [iPt] = ((destPtr [iPt] * layer) + srcPtr [iPt])/(layer + 1);
+        }
+    }
+}
+
+/* Takes lines startLine to endLine - 1 of each frame through all the stages that are on
+ Last Modified 2026/10/16 */
+template <typename T> void PipelineT (PipelineThreadParamsPtr p, CountInt startLine, CountInt endLine, UInt32 iSlot){
+    CountInt xSize = p->xSize, ySize = p->ySize, zSize = p->zSize;
+    CountInt nLines = endLine - startLine;
+    CountInt nPoints = nLines * xSize;
+    CountInt xOut = (p->DSType) ? xSize/p->boxFactor : xSize;
+    CountInt iTile = startLine/p->linesPerTile;
+    CountInt iFrame, firstLine;
+    T* dataPtr = (T*)p->dataStartPtr;
+    T* outPutPtr = (T*)p->outPutBufferPtr;
+    T* chunkPtr;
+    T* destPtr = nullptr;
+    double* sumPtr = (p->sumBufferPtr != nullptr) ? p->sumBufferPtr + iSlot * p->linesPerTile * xOut : nullptr;
+    for (iFrame = 0; iFrame < zSize; iFrame++){
+        firstLine = iFrame * ySize + startLine;     // line number counting from the start of the wave
+        chunkPtr = dataPtr + firstLine * xSize;
+        if (p->doDecumulate){
+            if (p->is3232){
+                Decumulate32_32 ((UInt32*)chunkPtr, nPoints, p->firstValuesPtr [iTile * zSize + iFrame]);
+            }else{
+                DecumulateT_ (chunkPtr, nPoints, p->maxCount, p->firstValuesPtr [iTile * zSize + iFrame]);
+            }
+        }
+        // SwapEven swaps odd lines, counting from the start of the wave. SwapEvenT swaps every second line from the
+        // line it starts on, so start it on the line before when the first line is odd. It does not touch that line
+        if (p->doSwapEven){
+            if (firstLine & 1){
+                SwapEvenT (chunkPtr - xSize, nLines + 1, xSize);
+            }else{
+                SwapEvenT (chunkPtr, nLines, xSize);
+            }
+        }
+        if (p->doKalman){
+            // down sample in place, then average into the output buffer, or into the first frame of the wave in place
+            if (p->DSType) PipelineDownSampleT (chunkPtr, chunkPtr, nPoints, (UInt16)p->boxFactor, p->DSType);
+            if (iFrame == 0) destPtr = (outPutPtr != nullptr) ? outPutPtr + startLine * xOut : chunkPtr;
+            PipelineKalmanT (chunkPtr, destPtr, sumPtr, nLines * xOut, iFrame, zSize, p->multiplier);
+        }else if (p->DSType){
+            PipelineDownSampleT (chunkPtr, outPutPtr + firstLine * xOut, nPoints, (UInt16)p->boxFactor, p->DSType);
+        }
+    }
+}
+
+/* Each tile of lines to run through the pipeline, from startLine up to endLine in each frame, is done with this
+ function. Every tile except the last has linesPerTile lines, so each tile can find its own first values for Decumulate
+ Last Modified 2026/10/16 */
+void PipelineTile (void* paramsPtr, CountInt startLine, CountInt endLine, UInt32 iSlot){
+    PipelineThreadParamsPtr p = (PipelineThreadParamsPtr) paramsPtr;
+    switch (p->inPutWaveType) {
+        case NT_I8:
+            PipelineT<char> (p, startLine, endLine, iSlot);
+            break;
+        case (NT_I8 | NT_UNSIGNED):
+            PipelineT<unsigned char> (p, startLine, endLine, iSlot);
+            break;
+        case NT_I16:
+            PipelineT<short> (p, startLine, endLine, iSlot);
+            break;
+        case (NT_I16 | NT_UNSIGNED):
+            PipelineT<unsigned short> (p, startLine, endLine, iSlot);
+            break;
+        case NT_I32:
+            PipelineT<SInt32> (p, startLine, endLine, iSlot);
+            break;
+        case (NT_I32 | NT_UNSIGNED):
+            PipelineT<UInt32> (p, startLine, endLine, iSlot);
+            break;
+        case NT_FP32:
+            PipelineT<float> (p, startLine, endLine, iSlot);
+            break;
+        case NT_FP64:
+            PipelineT<double> (p, startLine, endLine, iSlot);
+            break;
+        default:
+            throw NT_FNOT_AVAIL;
+            break;
+    }
+}
+
+/* Runs PipelineTile on the thread pool over all the lines of a frame, with tiles small enough to stay in cache. Makes
+ the buffers the tiles need, reads the first values for Decumulate before any tile changes the wave, and copies the
+ output buffer back over the start of the wave at the end. The stage settings in the paramater structure must be
+ filled in before calling. Returns 0, MEMFAIL, or an error thrown by a tile
+ Last Modified 2026/10/16 */
+int PipelineRunTiles (PipelineThreadParamsPtr p, UInt32 nSlots){
+    int result = 0;
+    UInt8 pointBytes = DownSamplePointBytes (p->inPutWaveType);
+    CountInt xOut = (p->DSType) ? p->xSize/p->boxFactor : p->xSize;
+    CountInt nTiles, iTile, iFrame, outPoints = 0;
+    if (pointBytes == 0) return NUMTYPE;
+    p->outPutBufferPtr = nullptr;
+    p->firstValuesPtr = nullptr;
+    p->sumBufferPtr = nullptr;
+    // lines per tile to fit in cache, but no more than needed to give each thread several tiles
+    p->linesPerTile = PIPELINE_TILE_BYTES/(p->xSize * pointBytes);
+    if (p->linesPerTile > ThreadPoolTileSize (p->ySize, 1)) p->linesPerTile = ThreadPoolTileSize (p->ySize, 1);
+    if (p->linesPerTile < 1) p->linesPerTile = 1;
+    nTiles = (p->ySize + p->linesPerTile - 1)/p->linesPerTile;
+    try{
+        // down sampled lines are shorter, so they can't be written back in place while other tiles still read the wave
+        if (p->DSType){
+            outPoints = xOut * p->ySize * ((p->doKalman) ? 1 : p->zSize);
+            p->outPutBufferPtr = (char*)WMNewPtr (outPoints * pointBytes);
+            if (p->outPutBufferPtr == nullptr) throw result = MEMFAIL;
+        }
+        if (p->doDecumulate){
+            p->firstValuesPtr = (UInt32*)WMNewPtr (nTiles * p->zSize * sizeof (UInt32));
+            if (p->firstValuesPtr == nullptr) throw result = MEMFAIL;
+            for (iTile = 0; iTile < nTiles; iTile++){
+                for (iFrame = 0; iFrame < p->zSize; iFrame++){
+                    p->firstValuesPtr [iTile * p->zSize + iFrame] = DecumulateFirstValue (p->inPutWaveType, p->dataStartPtr, (iFrame * p->ySize + iTile * p->linesPerTile) * p->xSize);
+                }
+            }
+        }
+        if ((p->doKalman) && (p->multiplier < 1)){
+            p->sumBufferPtr = (double*)WMNewPtr (nSlots * p->linesPerTile * xOut * sizeof (double));
+            if (p->sumBufferPtr == nullptr) throw result = MEMFAIL;
+        }
+        result = ThreadPoolRunTiles (PipelineTile, p, p->ySize, p->linesPerTile, nSlots);
+        if ((result == 0) && (p->outPutBufferPtr != nullptr)) memcpy (p->dataStartPtr, p->outPutBufferPtr, outPoints * pointBytes);
+    }catch (int thrown){
+        result = thrown;
+    }
+    if (p->outPutBufferPtr != nullptr) WMDisposePtr (p->outPutBufferPtr);
+    if (p->firstValuesPtr != nullptr) WMDisposePtr ((Ptr)p->firstValuesPtr);
+    if (p->sumBufferPtr != nullptr) WMDisposePtr ((Ptr)p->sumBufferPtr);
+    p->outPutBufferPtr = nullptr;
+    p->firstValuesPtr = nullptr;
+    p->sumBufferPtr = nullptr;
+    return result;
+}
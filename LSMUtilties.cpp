@@ -2,105 +2,223 @@
 #include "math.h"
 
 /* ------------------------------LSM Utilities --------------------------------------------------
-utility functions specialized for Laser Scanning Microscope data acquisition
-Last Modified 2025/06/27 by Jamie Boyd
+utility functions specialized for Laser Scanning Microscope data acquisition. The templates and tile functions
+they use are in LSMKernels.cpp
+Last Modified 2026/10/16
  -------------------------------------------------------------------------------------------------*/
  
 /* --------------------------- GetSetNumProcessors--------------------------------------------
-sanity check function for getting number of processors should return same as ThreadProcessorCount
-Last Modified 2025/06/24 by Jamie Boyd */
+Sets the number of threads all the XFUNCs fan out to to the number of CPUs usable by Igor, removing any cap set with
+SetNumProcessorsCap, and returns it. The usable CPUs are found again on each call, from the affinity mask of Igor and
+any cgroup or job object quota, and are never more than the threads in the pool
+Last Modified 2026/10/16 */
 extern "C" int GetSetNumProcessors(GetSetNumProcessorsParamsPtr p){
-    gNumProcessors = num_processors();
+    CPUTopology topo;
+    XFuncTimer timer;  // times each phase of this call, for TwoPhotonStats
+    XFuncTimerStart (&timer, STATS_GETSETNUMPROCESSORS);
+    CPUTopologyRead (&topo);
+    gNumProcessors = CPUTopologyThreadsForCap (&topo, CPU_CAP_NONE, ThreadPoolNumThreads ());
     p->result = (double)gNumProcessors;
+    XFuncTimerEnd (&timer);
     return (0);
 }
 
-/* -------------------------------- SwapEven -------------------------------------------------------
- horizontally swaps every other line in an image or series of images.
- Used after doing back and forth scanning, where every other line is scanned from the opposite direction.
- ----------------------------------------------------------------------------------------------------- */
-
-/* Template for SwapEven function
-Last Modified 2013/07/15 by Jamie Boyd */
-template <typename T> void SwapEvenT (T *dataStartPtr, CountInt numLines, CountInt lineLen) {
-    // make Pointer to end of the data
-    T* dataEndPtr = dataStartPtr + (numLines * lineLen);
-    // make pointers for start and end of each line
-    T* lineStartPtr;
-    T* lineEndPtr;
-    //temporary value for swapping
-    T temp;
-    // calculate distance to start and end of next line
-    CountInt toNextStart = (2 * lineLen) - (lineLen/2);    //due to rounding of integer math, it doesn't matter if LineLen is even or odd
-    CountInt toNextEnd = (2 * lineLen) + (lineLen/2);
-    //iterate through every other line, flipping it around
-    for(lineStartPtr = dataStartPtr + lineLen, lineEndPtr = lineStartPtr + lineLen -1; lineEndPtr < dataEndPtr; lineStartPtr += toNextStart,lineEndPtr += toNextEnd) {
-        while (lineStartPtr < lineEndPtr){
-            SWAP (*lineStartPtr, *lineEndPtr);
-            lineStartPtr++;
-            lineEndPtr--;
-        }
+/* --------------------------- SetNumProcessorsCap--------------------------------------------
+Sets the number of threads all the XFUNCs fan out to with a cap, and returns it. For memory-bound work, one thread per
+physical core is often as fast as one per logical CPU, and on hybrid CPUs tiles given to efficiency cores can hold up
+the rest. The CPUs are found again on each call, as for GetSetNumProcessors, and the result is never more than the
+usable CPUs or the threads in the pool
+SetNumProcessorsCapParams
+double cap         0 for all usable CPUs, n > 0 for at most n threads, -1 for one thread per physical core, or -2 for
+                   one thread per performance core on hybrid CPUs
+Last Modified 2026/10/16 */
+extern "C" int SetNumProcessorsCap(SetNumProcessorsCapParamsPtr p){
+    int result;
+    CPUTopology topo;
+    XFuncTimer timer;  // times each phase of this call, for TwoPhotonStats
+    XFuncTimerStart (&timer, STATS_SETNUMPROCESSORSCAP);
+    try{
+        if ((p->cap < CPU_CAP_PERFORMANCE) || (p->cap > 1e6) || (p->cap != (int)p->cap)) throw result = INPUT_RANGE;
+    }catch (int result){
+        XFuncTimerEnd (&timer);
+        p -> result = (double)(result - FIRST_XOP_ERR);
+#ifdef NO_IGOR_ERR
+        return (0);
+#else
+        return (result);
+#endif
     }
+    CPUTopologyRead (&topo);
+    gNumProcessors = CPUTopologyThreadsForCap (&topo, (int)p->cap, ThreadPoolNumThreads ());
+    p->result = (double)gNumProcessors;
+    XFuncTimerEnd (&timer);
+    return (0);
 }
 
-/* Structure to pass data to each SwapEvenThread
-Last Modified 2013/07/15 by Jamie Boyd */
-typedef struct SwapEvenThreadParams{
-    int inPutWaveType;
-    char* dataStartPtr;
-    CountInt numLines;
-    CountInt lineLen;
-    UInt8 ti; // number of this thread, starting from 0
-    UInt8 tN; // total number of threads (255 "should be enough for anyone")
-}SwapEvenThreadParams, *SwapEvenThreadParamsPtr;
-
+/* --------------------------- ThreadBusyTimes--------------------------------------------
+ Reports how busy each thread in the thread pool has been, to check that work is evenly spread among the threads.
+ Makes a 2D double precision wave with a row for each thread. Row 0 is for threads that called the XFUNCs, the other
+ rows are for the pool's worker threads. Column 0 is seconds spent working, column 1 is number of tiles of work done,
+ and column 2 is fraction of the time since the last reset that the thread was working. Returns number of threads
+ ThreadBusyTimesParams
+ Handle outPutPath      path and name of output wave, overwritten if it exists
+ double reset           non-zero to set busy times back to 0 after reporting them
+ Last Modified 2026/10/16 */
+extern "C" int ThreadBusyTimes (ThreadBusyTimesParamsPtr p){
+    int result = 0;
+    waveHndl outPutWaveH;                               // handle to output wave
+    DataFolderHandle outPutDFHandle;                    // Handle to the datafolder where we will put the output wave
+    DFPATH outPutPath;                                  // C string to hold data folder path of output wave
+    WVNAME outPutWaveName;                              // C string to hold name of output wave
+    CountInt outPutDimensionSizes[MAX_DIMENSIONS+1];    // an array used to hold rows and columns of output wave
+    CountInt outPutOffset;                              //offset in bytes from begnning of handle to a wave to the actual data
+    double* outPutDataPtr;
+    double* busySecsPtr = nullptr, *tilesDonePtr = nullptr;
+    double elapsedSecs;
+    UInt32 iThread, nThreads = ThreadPoolNumThreads ();
+    XFuncTimer timer;  // times each phase of this call, for TwoPhotonStats
+    XFuncTimerStart (&timer, STATS_THREADBUSYTIMES);
+    try{
+        if ((p->outPutPath == nullptr) || (WMGetHandleSize (p->outPutPath) == 0)) throw result = NO_INPUT_STRING;
+        busySecsPtr = (double*)WMNewPtr (nThreads * sizeof (double));
+        tilesDonePtr = (double*)WMNewPtr (nThreads * sizeof (double));
+        if ((busySecsPtr == nullptr) || (tilesDonePtr == nullptr)) throw result = MEMFAIL;
+        elapsedSecs = ThreadPoolGetStats (busySecsPtr, tilesDonePtr);
+        // make output wave
+        ParseWavePath (p->outPutPath, outPutPath, outPutWaveName);
+        CleanupName (0, outPutWaveName, MAX_OBJ_NAME);
+        if (GetNamedDataFolder (NULL, outPutPath, &outPutDFHandle)) throw result = WAVEERROR_NOS;
+        outPutDimensionSizes [0] = nThreads;
+        outPutDimensionSizes [1] = 3;
+        outPutDimensionSizes [2] = 0;
+        XFuncTimerPhase (&timer, STATS_MAKEWAVE);
+        if (MDMakeWave (&outPutWaveH, outPutWaveName, outPutDFHandle, outPutDimensionSizes, NT_FP64, OVERWRITE)) throw result = WAVEERROR_NOS;
+        XFuncTimerPhase (&timer, STATS_THREADS);
+        if (MDAccessNumericWaveData(outPutWaveH, kMDWaveAccessMode0, &outPutOffset)) throw result = WAVEERROR_NOS;
+        outPutDataPtr = (double*)((char*)(*outPutWaveH) + outPutOffset);
+    }catch (int result){
+        XFuncTimerEnd (&timer);
+        if (busySecsPtr != nullptr) WMDisposePtr ((Ptr)busySecsPtr);
+        if (tilesDonePtr != nullptr) WMDisposePtr ((Ptr)tilesDonePtr);
+        if (p->outPutPath != nullptr) WMDisposeHandle (p->outPutPath);
+        p -> result = (double)(result - FIRST_XOP_ERR);
+#ifdef NO_IGOR_ERR
+        return (0);
+#else
+        return (result);
+#endif
+    }
+    XFuncTimerPhase (&timer, STATS_FINISH);
+    // columns are busy seconds, tiles done, and fraction of elapsed time busy
+    for (iThread = 0; iThread < nThreads; iThread++){
+        outPutDataPtr [iThread] = busySecsPtr [iThread];
+        outPutDataPtr [nThreads + iThread] = tilesDonePtr [iThread];
+        outPutDataPtr [(2 * nThreads) + iThread] = (elapsedSecs > 0) ? busySecsPtr [iThread]/elapsedSecs : 0;
+    }
+    if (p->reset) ThreadPoolResetStats ();
+    WMDisposePtr ((Ptr)busySecsPtr);
+    WMDisposePtr ((Ptr)tilesDonePtr);
+    WMDisposeHandle (p->outPutPath);
+    WaveHandleModified(outPutWaveH);
+    p->result = (double)nThreads;
+    XFuncTimerEnd (&timer);
+    return (0);
+}
 
-/* Each thread to swap a range of rows starts with this function
-Last Modified 2025/06/13 by Jamie Boyd */
-void* SwapEvenThread (void* threadarg){
-    struct SwapEvenThreadParams* p;
-    p = (struct SwapEvenThreadParams*) threadarg;
-    CountInt tLines = (p-> numLines/p->tN);
-    if (tLines % 2) tLines--; // make sure number of lines per thread is even
-    CountInt startPos = p->ti * tLines * p->lineLen;
-    // the last thread gets any left-over lines
-    if (p->ti == p->tN - 1) tLines +=  (p->numLines % p->tN);
-    // call the right template function for the wave types
-    switch (p->inPutWaveType) {
-    case NT_I8:
-        SwapEvenT ((char*) p->dataStartPtr + startPos, tLines, p->lineLen);
-        break;
-    case (NT_I8 | NT_UNSIGNED):
-        SwapEvenT ((unsigned char*)p->dataStartPtr + startPos, tLines, p->lineLen);
-        break;
-    case NT_I16:
-        SwapEvenT ((short*)p->dataStartPtr + startPos, tLines, p->lineLen);
-        break;
-    case (NT_I16 | NT_UNSIGNED):
-        SwapEvenT ((unsigned short*)p->dataStartPtr + startPos, tLines, p->lineLen);
-        break;
-    case NT_I32:
-        SwapEvenT ((long*)p->dataStartPtr + startPos, tLines, p->lineLen);
-        break;
-    case (NT_I32| NT_UNSIGNED):
-        SwapEvenT ((unsigned long*)p->dataStartPtr + startPos, tLines, p->lineLen);
-        break;
-    case NT_FP32:
-        SwapEvenT ((float*)p->dataStartPtr + startPos, tLines, p->lineLen);
-        break;
-    case NT_FP64:
-        SwapEvenT ((double*)p->dataStartPtr + startPos, tLines, p->lineLen);
-        break;
-        break;
+/* --------------------------- TwoPhotonStats--------------------------------------------
+ Reports the timing counters kept for each XFUNC. Makes a 2D double precision wave with a row for each XFUNC, labelled
+ with its name. Column 0 is number of calls, followed by cumulative seconds and maximum seconds for each phase of a
+ call: validate, makeWave, threads, compute, finish, and total, with column labels like validate_sum and validate_max.
+ An empty string for the output path only resets the counters, if reset is non-zero. Returns total number of calls
+ TwoPhotonStatsParams
+ Handle outPutPath      path and name of output wave, overwritten if it exists, or empty string
+ double reset           non-zero to set counters back to 0 after reporting them
+ Last Modified 2026/10/16 */
+extern "C" int TwoPhotonStats (TwoPhotonStatsParamsPtr p){
+    int result = 0;
+    waveHndl outPutWaveH;                               // handle to output wave
+    DataFolderHandle outPutDFHandle;                    // Handle to the datafolder where we will put the output wave
+    DFPATH outPutPath;                                  // C string to hold data folder path of output wave
+    WVNAME outPutWaveName;                              // C string to hold name of output wave
+    CountInt outPutDimensionSizes[MAX_DIMENSIONS+1];    // an array used to hold rows and columns of output wave
+    CountInt outPutOffset;                              //offset in bytes from begnning of handle to a wave to the actual data
+    double* outPutDataPtr;
+    double calls [STATS_NUM_FUNCS];
+    double sumSecs [STATS_NUM_FUNCS * (STATS_NUM_PHASES + 1)];
+    double maxSecs [STATS_NUM_FUNCS * (STATS_NUM_PHASES + 1)];
+    char dimLabel [MAX_OBJ_NAME + 1];
+    CountInt iFunc, iPhase, nRows = STATS_NUM_FUNCS, nCols = 1 + 2 * (STATS_NUM_PHASES + 1);
+    double totalCalls = 0;
+    XFuncTimer timer;  // times each phase of this call, for TwoPhotonStats
+    XFuncTimerStart (&timer, STATS_TWOPHOTONSTATS);
+    try{
+        if ((p->outPutPath == nullptr) || (WMGetHandleSize (p->outPutPath) == 0)){
+            if (p->reset == 0) throw result = NO_INPUT_STRING;
+            outPutWaveH = nullptr;
+        }else{
+            // make output wave
+            ParseWavePath (p->outPutPath, outPutPath, outPutWaveName);
+            CleanupName (0, outPutWaveName, MAX_OBJ_NAME);
+            if (GetNamedDataFolder (NULL, outPutPath, &outPutDFHandle)) throw result = WAVEERROR_NOS;
+            outPutDimensionSizes [0] = nRows;
+            outPutDimensionSizes [1] = nCols;
+            outPutDimensionSizes [2] = 0;
+            XFuncTimerPhase (&timer, STATS_MAKEWAVE);
+            if (MDMakeWave (&outPutWaveH, outPutWaveName, outPutDFHandle, outPutDimensionSizes, NT_FP64, OVERWRITE)) throw result = WAVEERROR_NOS;
+            XFuncTimerPhase (&timer, STATS_THREADS);
+            if (MDAccessNumericWaveData(outPutWaveH, kMDWaveAccessMode0, &outPutOffset)) throw result = WAVEERROR_NOS;
+            outPutDataPtr = (double*)((char*)(*outPutWaveH) + outPutOffset);
+        }
+    }catch (int result){
+        XFuncTimerEnd (&timer);
+        if (p->outPutPath != nullptr) WMDisposeHandle (p->outPutPath);
+        p -> result = (double)(result - FIRST_XOP_ERR);
+#ifdef NO_IGOR_ERR
+        return (0);
+#else
+        return (result);
+#endif
+    }
+    XFuncTimerPhase (&timer, STATS_FINISH);
+    XFuncStatsGet (calls, sumSecs, maxSecs);
+    for (iFunc = 0; iFunc < nRows; iFunc++) totalCalls += calls [iFunc];
+    if (outPutWaveH != nullptr){
+        for (iFunc = 0; iFunc < nRows; iFunc++){
+            outPutDataPtr [iFunc] = calls [iFunc];
+            for (iPhase = 0; iPhase <= STATS_NUM_PHASES; iPhase++){
+                outPutDataPtr [(1 + 2 * iPhase) * nRows + iFunc] = sumSecs [iFunc * (STATS_NUM_PHASES + 1) + iPhase];
+                outPutDataPtr [(2 + 2 * iPhase) * nRows + iFunc] = maxSecs [iFunc * (STATS_NUM_PHASES + 1) + iPhase];
+            }
+            strncpy (dimLabel, gXFuncStatsFuncNames [iFunc], MAX_OBJ_NAME);
+            dimLabel [MAX_OBJ_NAME] = 0;
+            MDSetDimensionLabel (outPutWaveH, ROWS, iFunc, dimLabel);
+        }
+        MDSetDimensionLabel (outPutWaveH, COLUMNS, 0, (char*)"calls");
+        for (iPhase = 0; iPhase <= STATS_NUM_PHASES; iPhase++){
+            snprintf (dimLabel, MAX_OBJ_NAME + 1, "%s_sum", gXFuncStatsPhaseNames [iPhase]);
+            MDSetDimensionLabel (outPutWaveH, COLUMNS, 1 + 2 * iPhase, dimLabel);
+            snprintf (dimLabel, MAX_OBJ_NAME + 1, "%s_max", gXFuncStatsPhaseNames [iPhase]);
+            MDSetDimensionLabel (outPutWaveH, COLUMNS, 2 + 2 * iPhase, dimLabel);
+        }
+        WaveHandleModified(outPutWaveH);
     }
-    return nullptr;
+    if (p->reset) XFuncStatsReset ();
+    if (p->outPutPath != nullptr) WMDisposeHandle (p->outPutPath);
+    p->result = totalCalls;
+    XFuncTimerEnd (&timer);
+    return (0);
 }
 
+/* -------------------------------- SwapEven -------------------------------------------------------
+ horizontally swaps every other line in an image or series of images.
+ Used after doing back and forth scanning, where every other line is scanned from the opposite direction.
+ ----------------------------------------------------------------------------------------------------- */
+
 /* SwapEven XOP entry function
  SwapEvenParams:
  wave handle to start of data of input wave, which is overwrittten
  result =  0 or error code
-Last Modified 2025/06/23 by Jamie Boyd */
+Last Modified 2026/10/16 */
 extern "C" int SwapEven (SwapEvenParamsPtr p){
     waveHndl wavH = nullptr;        // handle to the input wave
     int waveType; //  Wavetypes numeric codes for things like 32 bit floating point, 16 bit int, etc
@@ -111,10 +229,9 @@ extern "C" int SwapEven (SwapEvenParamsPtr p){
     CountInt numLines;    // The number of lines in the file
     int result;    // The error returned from various Wavemetrics functions
     char* dataStartPtr;    // Pointer to start of data in input wave. Need to use char for these to use WM function to get data offset
-    // Multi threading
-    UInt8 iThread, nThreads;
-    SwapEvenThreadParamsPtr paramArrayPtr = nullptr;
-    pthread_t* threadsPtr = nullptr;
+    SwapEvenThreadParams params;  // paramaters for the tiles
+    XFuncTimer timer;  // times each phase of this call, for TwoPhotonStats
+    XFuncTimerStart (&timer, STATS_SWAPEVEN);
     try {
         // Get handle to input wave. Make sure it exists.
         wavH = p->w1;
@@ -137,16 +254,8 @@ extern "C" int SwapEven (SwapEvenParamsPtr p){
         // Get the offsets to the data in the wave
         if (MDAccessNumericWaveData(wavH, kMDWaveAccessMode0, &dataOffset)) throw result = WAVEERROR_NOS;
         dataStartPtr = (char*)(*wavH) + dataOffset;
-        // Multi threading
-        nThreads = gNumProcessors;
-        paramArrayPtr = (SwapEvenThreadParamsPtr)WMNewPtr(nThreads * sizeof(SwapEvenThreadParams));
-        if (paramArrayPtr == nullptr) throw result = MEMFAIL;
-        // make an array of pthread_t
-        threadsPtr =(pthread_t*)WMNewPtr(nThreads * sizeof(pthread_t));
-        if (threadsPtr == nullptr) throw result = MEMFAIL;
     }catch (int result){
-        if (paramArrayPtr != nullptr) WMDisposePtr ((Ptr)paramArrayPtr);
-        if (threadsPtr != nullptr) WMDisposePtr ((Ptr)threadsPtr);
+        XFuncTimerEnd (&timer);
         p -> result = (double)(result - FIRST_XOP_ERR);
 #ifdef NO_IGOR_ERR
         return (0);
@@ -154,30 +263,20 @@ extern "C" int SwapEven (SwapEvenParamsPtr p){
         return (result);
 #endif
     }
-    // fill threadParams array
-    for (iThread = 0; iThread < nThreads; iThread++){
-        paramArrayPtr[iThread].inPutWaveType = waveType;
-        paramArrayPtr[iThread].dataStartPtr = dataStartPtr;
-        paramArrayPtr[iThread].numLines = numLines;
-        paramArrayPtr[iThread].lineLen = lineLen;
-        paramArrayPtr[iThread].ti=iThread; // number of this thread, starting from 0
-        paramArrayPtr[iThread].tN =nThreads; // total number of threads
-    }
-    // create the threads
-    for (iThread = 0; iThread < nThreads; iThread++){
-        pthread_create (&threadsPtr[iThread], NULL, SwapEvenThread, (void *) &paramArrayPtr[iThread]);
-    }
-    // Wait till all the threads are finished
-    for (iThread = 0; iThread < nThreads; iThread++){
-        pthread_join (threadsPtr[iThread], NULL);
-    }
-    // free memory for pThreads Array
-    WMDisposePtr ((Ptr)threadsPtr);
-    // Free paramaterArray memory
-    WMDisposePtr ((Ptr)paramArrayPtr);
+    XFuncTimerPhase (&timer, STATS_THREADS);
+    // fill paramater structure
+    params.inPutWaveType = waveType;
+    params.dataStartPtr = dataStartPtr;
+    params.numLines = numLines;
+    params.lineLen = lineLen;
+    // run the tiles on the thread pool, and wait till they are all finished
+    XFuncTimerPhase (&timer, STATS_COMPUTE);
+    SwapEvenRunTiles (&params);
+    XFuncTimerPhase (&timer, STATS_FINISH);
     // Inform Igor that we have changed the input wave.
     WaveHandleModified(wavH);
     p -> result = (0);
+    XFuncTimerEnd (&timer);
     return (0);
 }
 
@@ -189,307 +288,12 @@ DownSample methods: 1 = average, 2 = sum, 3 = max, 4 = median
 ------------------------------------------------------------------------------------------------------------ */
 
 
-/* Template functions for the various DownSample methods
-Case 1 Kalman-style averaging.
-Last Modified 2013/07/15 by Jamie Boyd */
-template <typename T> void DSaverageT (T *dataStartPtr, CountInt points, UInt16 boxFactor) {
-    // make Pointer to the end of the data
-    T *dataEndPtr = dataStartPtr + points;
-    T *outPutPtr; // output position varies slowly
-    T *inPutPtr;  // input position varies quickly
-    UInt16 ifactor;
-    //iterate through the wave, averaging input range into output value
-    for (outPutPtr = inPutPtr = dataStartPtr;inPutPtr < dataEndPtr; outPutPtr++){
-        *outPutPtr = *inPutPtr;
-        inPutPtr++;
-        for (ifactor = 1; ifactor < boxFactor; ifactor++, inPutPtr++){
-            *outPutPtr = (*outPutPtr * (ifactor/(ifactor + 1))) + *inPutPtr /(ifactor + 1);
-        }
-    }
-}
-
-// Case 2: Summing. Need different function for different bounds checking for floats, signed ints, and unsigned ints
-//Floats: Don't check Max or Min - overflows should automatically go to INF and -INF
-template <typename T> void DSsumFloatT (T *dataStartPtr, CountInt points, UInt16 boxFactor) {
-    T *dataEndPtr = dataStartPtr + points;
-    T *outPutPtr;
-    T *inPutPtr;
-    UInt16 ifactor;
-    for (outPutPtr = inPutPtr = dataStartPtr;inPutPtr < dataEndPtr; outPutPtr++){
-        for (*outPutPtr = *inPutPtr,inPutPtr++, ifactor = 1; ifactor < boxFactor; ifactor++, inPutPtr++)
-            *outPutPtr = *outPutPtr + *inPutPtr;
-    }
-}
-
-// Signed Ints: Check OverFlows at both ends (Max and Min)
-template <typename T> void DSsumSignedIntT (T *dataStartPtr, CountInt points, UInt16 boxFactor, T Tmax, T Tmin){
-    T *dataEndPtr = dataStartPtr + points;
-    T *outPutPtr;
-    T *inPutPtr;
-    UInt16 ifactor;
-    for (outPutPtr = inPutPtr = dataStartPtr;inPutPtr < dataEndPtr; outPutPtr++){
-        for (*outPutPtr = *inPutPtr,inPutPtr++, ifactor = 1; ifactor < boxFactor; ifactor++, inPutPtr++){
-            if ((*outPutPtr + *inPutPtr) > Tmax) //Check Max
-                *outPutPtr = Tmax;
-            else{
-                if ((*outPutPtr + *inPutPtr) < Tmin) //Check Min
-                    *outPutPtr = Tmin;
-                else
-                    *outPutPtr = *outPutPtr + *inPutPtr;
-            }
-        }
-    }
-}
-
-// Unsigned integer types: Check OverFlows only for Max
-template <typename T> void DSsumUnSignedIntT (T *dataStartPtr, CountInt points, UInt16 boxFactor, T Tmax){
-    T *dataEndPtr = dataStartPtr + points;
-    T *outPutPtr;
-    T *inPutPtr;
-    UInt16 ifactor;
-    for (outPutPtr = inPutPtr = dataStartPtr;inPutPtr < dataEndPtr; outPutPtr++){
-        for (*outPutPtr = *inPutPtr,inPutPtr++, ifactor = 1; ifactor < boxFactor; ifactor++, inPutPtr++){
-            if ((*outPutPtr + *inPutPtr) > Tmax){  //check Max
-                *outPutPtr = Tmax;
-                break;    //can move on to the next input point - value can't get any higher
-            }
-            else
-                *outPutPtr = *outPutPtr + *inPutPtr;
-        }
-    }
-}
-
-//Case 3: Take maximum Value
-template <typename T> void DSMaxT (T *dataStartPtr, CountInt points, UInt16 boxFactor){
-    // make Pointer to the end of the data
-    T *dataEndPtr = dataStartPtr + points;
-    T *outPutPtr;
-    T *inPutPtr;
-    UInt16 ifactor;
-
-    for (outPutPtr = inPutPtr = dataStartPtr;inPutPtr < dataEndPtr; outPutPtr++){
-        *outPutPtr = *inPutPtr;
-        inPutPtr++;
-        for (ifactor = 1; ifactor < boxFactor; ifactor++, inPutPtr++){
-            if (*outPutPtr < *inPutPtr)
-                *outPutPtr = *inPutPtr;
-        }
-    }
-}
-
-//case 4: take median value.
-template <typename T> void DSMedianT (T *dataStartPtr, CountInt points, UInt16 boxFactor){
-    // make Pointer to the end of the data
-    T *dataEndPtr = dataStartPtr + points;
-    T *outPutPtr;
-    T *inPutPtr;
-    // Median variables
-    UInt16 i,right=boxFactor -1,j,left=0,mid;
-    UInt16 k = (boxFactor)/2;
-    T a,temp;
-    for (outPutPtr = inPutPtr = dataStartPtr;inPutPtr < dataEndPtr; outPutPtr++, inPutPtr += boxFactor){
-        for (;;) {
-            if (right <= left + 1) {
-                if (right == left + 1 && *(inPutPtr + right) < *(inPutPtr + left)) {
-                    SWAP((*(inPutPtr + left)),(*(inPutPtr + right)));
-                }
-                *outPutPtr = *(inPutPtr + k);
-                break;
-            } else {
-                mid=(left + right) >> 1;
-                SWAP((*(inPutPtr + mid)),(*(inPutPtr + left + 1)));
-                if (*(inPutPtr + left) > *(inPutPtr + right)) {
-                    SWAP((*(inPutPtr + left)),(*(inPutPtr + right)));
-                }
-                if (*(inPutPtr + left + 1) > *(inPutPtr + right)) {
-                    SWAP((*(inPutPtr + left + 1)), ( *(inPutPtr + right)));
-                }
-                if (*(inPutPtr + left) > *(inPutPtr + left+1)) {
-                    SWAP((*(inPutPtr + left)),(*(inPutPtr + left+1)));
-                }
-                i=left+1;
-                j=right;
-                a=*(inPutPtr + left+1);
-                for (;;) {
-                    do i++; while (*(inPutPtr + i) < a);
-                    do j--; while (*(inPutPtr + j) > a);
-                    if (j < i) break;
-                    SWAP((*(inPutPtr + i)),(*(inPutPtr + j)));
-                }
-                *(inPutPtr + left + 1) = *(inPutPtr + j);
-                *(inPutPtr + j) = a;
-                if (j >= k) right = j-1;
-                if (j <= k) left=i;
-            }
-        }
-    }
-}
-
-
-/* Structure to pass data to each DownSample thread
-Last Modified 2013/07/15 by Jamie Boyd */
-typedef struct DownSampleThreadParams{
-    int inPutWaveType;
-    char* dataStartPtr;
-    CountInt points;
-    CountInt boxFactor;
-    UInt8 DSType;
-    UInt8 ti; // number of this thread, starting from 0
-    UInt8 tN; // total number of threads (255 "should be enough for anyone")
-}DownSampleThreadParams, *DownSampleThreadParamsPtr;
-
-
-/* Each thread to down sampe a range of points  starts with this function
-Last Modified 2025/06/23 by Jamie Boyd */
-void* DownSampleThread (void* threadarg){
-    struct DownSampleThreadParams* p;
-    p = (struct DownSampleThreadParams*) threadarg;
-    CountInt tPoints = (p->points/p->tN);  // number of points to do per thread
-    CountInt startPos = p->ti * tPoints;   // starting position for this thread
-    if (p->ti == p->tN - 1) tPoints +=  (p->points % p->tN); // the last thread gets any left-over points
-    CountInt boxFactor = p->boxFactor;
-    UInt8 DSType = p->DSType;
-    char* dataStartPtr = p->dataStartPtr;
-    // call the right template function for the down sample type
-    switch (p->inPutWaveType) {
-        case NT_FP64:
-            switch (DSType){
-                case 1:    //average
-                    DSaverageT ((double*) dataStartPtr + startPos , tPoints, boxFactor);
-                    break;
-                case 2: // sum
-                    DSsumFloatT ((double*)dataStartPtr + startPos, tPoints, boxFactor);
-                    break;
-                case 3: //max
-                    DSMaxT ((double*)dataStartPtr + startPos, tPoints, boxFactor);
-                    break;
-                case 4: // median
-                    DSMedianT ((double*)dataStartPtr + startPos, tPoints, boxFactor);
-                    break;
-            }
-            break;
-        case NT_FP32:
-            switch (DSType){
-                case 1:    //average
-                    DSaverageT ((float*) dataStartPtr + startPos, tPoints, boxFactor);
-                    break;
-                case 2: // sum
-                    DSsumFloatT ((float*)dataStartPtr + startPos, tPoints, boxFactor);
-                    break;
-                case 3: //max
-                    DSMaxT ((float*)dataStartPtr + startPos, tPoints, boxFactor);
-                    break;
-                case 4: // median
-                    DSMedianT ((float*)dataStartPtr + startPos, tPoints, boxFactor);
-                    break;
-            }
-            break;
-        case (NT_I32 | NT_UNSIGNED):
-            switch (DSType){
-                case 1:    //average
-                    DSaverageT ((unsigned long*) dataStartPtr + startPos, tPoints, boxFactor);
-                    break;
-                case 2: // sum
-                    DSsumUnSignedIntT ((unsigned long*)dataStartPtr + startPos, tPoints, boxFactor,(unsigned long)ULONG_MAX);
-                    break;
-                case 3: //max
-                    DSMaxT ((unsigned long*)dataStartPtr + startPos, tPoints, boxFactor);
-                    break;
-                case 4: // median
-                    DSMedianT ((unsigned long*)dataStartPtr + startPos, tPoints, boxFactor);
-                    break;
-            }
-            break;
-        case NT_I32:
-            switch (DSType){
-                case 1:    //average
-                    DSaverageT ((long*) dataStartPtr + startPos, tPoints, boxFactor);
-                    break;
-                case 2: // sum
-                    DSsumSignedIntT ((long*)dataStartPtr + startPos, tPoints, boxFactor,(long)LONG_MAX, (long)LONG_MIN);
-                    break;
-                case 3: //max
-                    DSMaxT ((long*)dataStartPtr + startPos, tPoints, boxFactor);
-                    break;
-                case 4: // median
-                    DSMedianT ((long*)dataStartPtr + startPos, tPoints, boxFactor);
-                    break;
-            }
-            break;
-        case (NT_I16 | NT_UNSIGNED):
-            switch (DSType){
-                case 1:    //average
-                    DSaverageT ((unsigned short*) dataStartPtr + startPos, tPoints, boxFactor);
-                    break;
-                case 2: // sum
-                    DSsumUnSignedIntT ((unsigned short*)dataStartPtr + startPos, tPoints, boxFactor,(unsigned short)USHRT_MAX);
-                    break;
-                case 3: //max
-                    DSMaxT ((unsigned short*)dataStartPtr + startPos, tPoints, boxFactor);
-                    break;
-                case 4: // median
-                    DSMedianT ((unsigned short*)dataStartPtr + startPos, tPoints, boxFactor);
-                    break;
-            }
-            break;
-        case NT_I16:
-            switch (DSType){
-                case 1:    //average
-                    DSaverageT ((short*) dataStartPtr + startPos, tPoints, boxFactor);
-                    break;
-                case 2: // sum
-                    DSsumSignedIntT ((short*)dataStartPtr + startPos, tPoints, boxFactor,(short)SHRT_MAX, (short)SHRT_MIN);
-                    break;
-                case 3: //max
-                    DSMaxT ((short*)dataStartPtr + startPos, tPoints, boxFactor);
-                    break;
-                case 4: // median
-                    DSMedianT ((short*)dataStartPtr + startPos, tPoints, boxFactor);
-                    break;
-            }
-            break;
-        case (NT_I8 | NT_UNSIGNED):
-            switch (DSType){
-                case 1:    //average
-                    DSaverageT ((unsigned char*) dataStartPtr + startPos, tPoints, boxFactor);
-                    break;
-                case 2: // sum
-                    DSsumUnSignedIntT ((unsigned char*)dataStartPtr + startPos, tPoints, boxFactor,(unsigned char)UCHAR_MAX);
-                    break;
-                case 3: //max
-                    DSMaxT ((unsigned char*)dataStartPtr + startPos, tPoints, boxFactor);
-                    break;
-                case 4: // median
-                    DSMedianT ((unsigned char*)dataStartPtr + startPos, tPoints, boxFactor);
-                    break;
-            }
-            break;
-        case NT_I8:
-            switch (DSType){
-                case 1:    //average
-                    DSaverageT ((char*) dataStartPtr + startPos, tPoints, boxFactor);
-                    break;
-                case 2: // sum
-                    DSsumSignedIntT ((char*)dataStartPtr + startPos, tPoints, boxFactor,(char)SCHAR_MAX, (char)SCHAR_MIN);
-                    break;
-                case 3: //max
-                    DSMaxT ((char*)dataStartPtr + startPos, tPoints, boxFactor);
-                    break;
-                case 4: // median
-                    DSMedianT ((char*)dataStartPtr + startPos, tPoints, boxFactor);
-                    break;
-            }
-            break;
-    }    // end of switch
-    return nullptr;
-}
-
 /* DownSample XOP entry function
  DownSampleParams:
  wavehandle to input wave, which is overwritten
  downSample type 1 = average, 2 = sum, 3 = max, 4 = median
  boxfactor = number of pixels boxed together
-Last Modified 2025/06/13 by Jamie Boyd */
+Last Modified 2026/10/16 */
 extern "C" int DownSample (DownSampleParamsPtr p) {
     int result = 0;    // The error returned from various Wavemetrics functions
     int waveType; //  Wavetypes numeric codes for things like 32 bit floating point, 16 bit int, etc
@@ -501,9 +305,10 @@ extern "C" int DownSample (DownSampleParamsPtr p) {
     waveHndl wavH;        // handle to the input wave
     char* dataStartPtr;    // Pointer to start of data in input wave. Need to use char for these to use WM function to get data offset
     UInt8 DSType;
-    DownSampleThreadParamsPtr paramArrayPtr = nullptr;
-    pthread_t* threadsPtr = nullptr;
-    UInt8 iThread, nThreads;
+    char* outPutBufferPtr = nullptr;    // buffer for the down-sampled data
+    DownSampleThreadParams params;  // paramaters for the tiles
+    XFuncTimer timer;  // times each phase of this call, for TwoPhotonStats
+    XFuncTimerStart (&timer, STATS_DOWNSAMPLE);
     try{
         // Get handles to input wave. Make sure it exists.
         wavH = p->w1;
@@ -522,7 +327,7 @@ extern "C" int DownSample (DownSampleParamsPtr p) {
         // Get dimension size info
         xSize = dimensionSizes[0];
         boxFactor = (UInt16) p ->boxFactor;
-        if (xSize % boxFactor) throw result = BADFACTOR;
+        if ((boxFactor < 1) || (xSize % boxFactor)) throw result = BADFACTOR;
         ySize = dimensionSizes [1];
         if (numDimensions == 2){
             zSize = 1;
@@ -534,16 +339,12 @@ extern "C" int DownSample (DownSampleParamsPtr p) {
         if (MDAccessNumericWaveData(wavH, kMDWaveAccessMode0, &dataOffset)) throw result = WAVEERROR_NOS;
         // make pointer to start of wave data
         dataStartPtr = (char*)(*wavH) + dataOffset;
-        // Get ready for Multi threading
-        nThreads = gNumProcessors;
-        // make an arrray of paramater pointers
-        paramArrayPtr = (DownSampleThreadParamsPtr)WMNewPtr(nThreads * sizeof(DownSampleThreadParams));
-        // make an array of pthread_t
-       threadsPtr = (pthread_t*)WMNewPtr(nThreads * sizeof(pthread_t));
+        // make a buffer for the down-sampled data, as tiles can't write over input still to be read by other tiles
+        if (DownSamplePointBytes (waveType) == 0) throw result = NUMTYPE;
+        outPutBufferPtr = (char*)WMNewPtr ((points/boxFactor) * DownSamplePointBytes (waveType));
+        if (outPutBufferPtr == nullptr) throw result = MEMFAIL;
     }catch (int result){
-        // dispose of any memory we may have allocated
-        if (paramArrayPtr != nullptr) WMDisposePtr ((Ptr)paramArrayPtr);
-        if (threadsPtr != nullptr) WMDisposePtr ((Ptr)threadsPtr);
+        XFuncTimerEnd (&timer);
         p -> result = (double)(result - FIRST_XOP_ERR);
 #ifdef NO_IGOR_ERR
         return (0);
@@ -551,28 +352,19 @@ extern "C" int DownSample (DownSampleParamsPtr p) {
         return (result);
 #endif
     }
-    // fill paramater array
-    for (iThread = 0; iThread < nThreads; iThread++){
-        paramArrayPtr[iThread].inPutWaveType = waveType;
-        paramArrayPtr[iThread].dataStartPtr = dataStartPtr;
-        paramArrayPtr[iThread].points = points;
-        paramArrayPtr[iThread].boxFactor = boxFactor;
-        paramArrayPtr[iThread].DSType = DSType;
-        paramArrayPtr[iThread].ti = iThread; // number of this thread, starting from 0
-        paramArrayPtr[iThread].tN = nThreads; // total number of threads
-    }
-    // create the threads
-    for (iThread = 0; iThread < nThreads; iThread++){
-        pthread_create (&threadsPtr[iThread], NULL, DownSampleThread, (void *) &paramArrayPtr[iThread]);
-    }
-    // Wait till all the threads are finished
-    for (iThread = 0; iThread < nThreads; iThread++){
-        pthread_join (threadsPtr[iThread], NULL);
-    }
-    // free memory for pThreads Array
-    WMDisposePtr ((Ptr)threadsPtr);
-    // Free paramaterArray memory
-    WMDisposePtr ((Ptr)paramArrayPtr);
+    XFuncTimerPhase (&timer, STATS_THREADS);
+    // fill paramater structure
+    params.inPutWaveType = waveType;
+    params.dataStartPtr = dataStartPtr;
+    params.outPutBufferPtr = outPutBufferPtr;
+    params.points = points;
+    params.boxFactor = boxFactor;
+    params.DSType = DSType;
+    // run the tiles on the thread pool, and wait till they are all finished
+    XFuncTimerPhase (&timer, STATS_COMPUTE);
+    DownSampleRunTiles (&params);
+    XFuncTimerPhase (&timer, STATS_FINISH);
+    WMDisposePtr ((Ptr)outPutBufferPtr);
     dimensionSizes [0] = xSize/boxFactor;
     dimensionSizes [1] = ySize;
     dimensionSizes [2] = zSize;
@@ -581,6 +373,7 @@ extern "C" int DownSample (DownSampleParamsPtr p) {
     // Inform Igor that we have changed the input wave.
     WaveHandleModified (wavH);
     p -> result = (0);
+    XFuncTimerEnd (&timer);
     return (0);
 }
 
@@ -590,147 +383,11 @@ Transposes each frame in a 3D wave (equivalent to a horizontal flip and a 90 deg
 Useful because microscope may have an odd number of  mirrors in the light path
  ------------------------------------------------------------------------------------------------------------------- */
 
-/* template function for transposeFrames that are not square
- Last Modified: 2025/06/23 by Jamie Boyd */
-template <typename T> void TransposeFramesT (T *dataStartPtr, T *frameCopyStart, CountInt xSize, CountInt ySize, CountInt zSize) {
-    CountInt frameSize = (xSize * ySize);
-    CountInt frameBytes = (frameSize * sizeof(T));
-    // make Pointer to end of the data
-    T* dataEndPtr = dataStartPtr + (frameSize * zSize);
-    // make pointer for progressing through the given data
-    T *dataWavePtr;
-    //pointers for iterating through x and y
-    T *frameCopyPtr, *frameXend, *frameYend;
-    CountInt toNextX = frameSize-1;
-    for (dataWavePtr= dataStartPtr; dataWavePtr < dataEndPtr;){
-        //make a copy of the current frame into the frame copy buffer
-        frameCopyStart = (T*) memcpy ((void*)frameCopyStart, (void*)dataWavePtr, frameBytes);
-        //iterate through x
-        for (frameCopyPtr = frameCopyStart, frameXend = frameCopyStart + xSize;frameCopyPtr < frameXend;frameCopyPtr -= toNextX){
-            // iterate through y
-            for (frameYend = frameCopyPtr + frameSize; frameCopyPtr < frameYend ;frameCopyPtr += xSize, dataWavePtr+=1){
-                *dataWavePtr = *frameCopyPtr;
-            }
-        }
-    }
-}
-
-/* Template function for TransposeFrames functions with frames that are square, as they often are.
- Does not need to use a frame buffer, so should be a little faster
- Last Modified 2013/07/15 by Jamie Boyd */
-template <typename T> void TransposeSquareFramesT (T *dataStartPtr, CountInt xySize, CountInt zSize){
-    CountInt frameSize = xySize * xySize;
-    // make Pointer to end of the data
-    T* dataEndPtr = dataStartPtr + ((frameSize * zSize) - xySize);
-    // make pointers for progressing through the data
-    T *xPtr, *yPtr;
-    // variables to point to the ends of the current line. x and y both the same, so we only need count X
-    T *xEndLinePtr;
-    // variable to count lines
-    CountInt lines;
-    // frames - 1, just because it's easier to read this way
-    CountInt frameSizeMinus1 = frameSize - 1;
-    // temp variable for SWAP macro
-    T temp;
-    //frames
-    for (xPtr = dataStartPtr + 1, yPtr = dataStartPtr + xySize; xPtr < dataEndPtr; xPtr += 1,yPtr += 1){
-        //columns/rows
-        for (lines = 1; lines < xySize; lines += 1, xPtr += lines, yPtr -= (frameSizeMinus1 - lines*xySize)){
-            // points in individual column/row
-            for (xEndLinePtr = xPtr + (xySize - lines); xPtr < xEndLinePtr; xPtr += 1,yPtr += xySize){
-                SWAP (*xPtr, *yPtr);
-            }
-        }
-    }
-}
-
-
-/* Structure to pass data to each TransposeFrames thread
- Last Modified 2025/06/23 by Jamie Boyd */
-typedef struct TransposeFramesThreadParams{
-    int inPutWaveType;          // WaveMetrics code for waveType
-    void* dataStartPtr;         // pointer to start of input wave, which is overwritten
-    void* bufferPtr;            // pointer to start of a frame-sized buffer for temporary calculations, not used for square frames
-    CountInt xSize;            // number of columns in each frame
-    CountInt ySize;            // number of rows in each frame
-    CountInt zSize;             // number of frames in wave
-    UInt8 ti; // number of this thread, starting from 0
-    UInt8 tN; // total number of threads (255 "should be enough for anyone")
-} TransposeFramesThreadParams, *TransposeFramesThreadParamsPtr;
-
-
-/* Each thread to transpose a range of frames starts with this function
-Last Modified 2025/06/27 by Jamie Boyd */
-void* TransposeFramesThread (void* threadarg){
-    struct TransposeFramesThreadParams* p = (struct TransposeFramesThreadParams*) threadarg;
-    CountInt frameSize = p->xSize * p->ySize;
-    CountInt tFrames = (p->zSize/p->tN);  // number of frames to do per thread
-    CountInt startOffset = p->ti * frameSize * tFrames ;   // starting position for this thread
-    if (p->ti == p->tN - 1) tFrames += (p->zSize % p->tN); // the last thread gets any left-over frames
-    if (p->xSize == p->ySize){
-        switch (p->inPutWaveType) {
-            case NT_FP64:
-                TransposeSquareFramesT (((double*) p->dataStartPtr) + startOffset, p->xSize, tFrames);
-                break;
-            case NT_FP32:
-                TransposeSquareFramesT (((float*) p->dataStartPtr) + startOffset, p->xSize, tFrames);
-                break;
-            case (NT_I32 | NT_UNSIGNED):
-                TransposeSquareFramesT (((unsigned long*) p->dataStartPtr) + startOffset, p->xSize, tFrames);
-                break;
-            case NT_I32:
-                TransposeSquareFramesT (((long*) p->dataStartPtr) + startOffset, p->xSize, tFrames);
-                break;
-            case (NT_I16 | NT_UNSIGNED):
-                TransposeSquareFramesT (((unsigned short*) p->dataStartPtr) + startOffset, p->xSize, tFrames);
-                break;
-            case NT_I16:
-                TransposeSquareFramesT (((short*) p->dataStartPtr) + startOffset, p->xSize, tFrames);
-                break;
-            case (NT_I8 | NT_UNSIGNED):
-                TransposeSquareFramesT (((unsigned char*) p->dataStartPtr) + startOffset, p->xSize, tFrames);
-                break;
-            case NT_I8:
-                TransposeSquareFramesT (((char*) p->dataStartPtr) + startOffset, p->xSize, tFrames);
-                break;
-        }
-    }else{
-        CountInt bufferOffset =p->ti * frameSize; // this is in points, not bytes.
-        switch (p->inPutWaveType) {
-            case NT_FP64:
-                TransposeFramesT (((double*) p->dataStartPtr) + startOffset, ((double*) p->bufferPtr) + bufferOffset, p->xSize, p->ySize, tFrames);
-                break;
-            case NT_FP32:
-                TransposeFramesT (((float*) p->dataStartPtr) + startOffset, ((float*) p->bufferPtr) + bufferOffset, p->xSize, p->ySize, tFrames);
-                break;
-            case (NT_I32 | NT_UNSIGNED):
-                TransposeFramesT (((unsigned long*) p->dataStartPtr) + startOffset, ((unsigned long*) p->bufferPtr) + bufferOffset, p->xSize, p->ySize, tFrames);
-                break;
-            case NT_I32:
-                TransposeFramesT (((long*) p->dataStartPtr) + startOffset, ((long*)p->bufferPtr) + bufferOffset, p->xSize, p->ySize, tFrames);
-                break;
-            case (NT_I16 | NT_UNSIGNED):
-                TransposeFramesT (((unsigned short*) p->dataStartPtr) + startOffset, ((unsigned short*)p->bufferPtr) + bufferOffset, p->xSize, p->ySize, tFrames);
-                break;
-            case NT_I16:
-                TransposeFramesT (((SInt16*) p->dataStartPtr) + startOffset, ((SInt16*)p->bufferPtr) + bufferOffset, p->xSize, p->ySize, tFrames);
-                break;
-            case (NT_I8 | NT_UNSIGNED):
-                TransposeFramesT (((unsigned char*) p->dataStartPtr) + startOffset, ((unsigned char*) p->bufferPtr) + bufferOffset, p->xSize, p->ySize, tFrames);
-                break;
-            case NT_I8:
-                TransposeFramesT (((char*) p->dataStartPtr) + startOffset, ((char*)p->bufferPtr) + bufferOffset, p->xSize, p->ySize, tFrames);
-                break;
-        }
-    }
-    return nullptr;
- }
-
 /* TransposeFrames XOP entry function
  TransposeFramesParams:
  wave handle to input wave, which is always overwritten
  result which is 0 or error code
- Last Modified 2025/06/27 by Jamie Boyd */
+ Last Modified 2026/10/16 */
 extern "C" int TransposeFrames (TransposeFramesParamsPtr p) {
     int result = 0;    // The error returned from various Wavemetrics functions
     int waveType; //  Wavetypes numeric codes for things like 32 bit floating point, 16 bit int, etc
@@ -743,10 +400,11 @@ extern "C" int TransposeFrames (TransposeFramesParamsPtr p) {
     waveHndl wavH;        // handle to the input wave
     char* dataStartPtr;    // Pointer to start of data in input wave. Need to use char for these to use WM function to get data offset
     // threading
-    UInt8 iThread, nThreads;
-    TransposeFramesThreadParamsPtr paramArrayPtr = nullptr;
-    pthread_t* threadsPtr = nullptr; // pointer to threads array
+    UInt32 nThreads;    // number of slots, each with its own frame buffer
+    TransposeFramesThreadParams params;  // paramaters for the tiles
     void* bufferPtr = nullptr;  // pointer to temp buffer for threads
+    XFuncTimer timer;  // times each phase of this call, for TwoPhotonStats
+    XFuncTimerStart (&timer, STATS_TRANSPOSEFRAMES);
     // try/catch block to allocate all memory and catch errors before starting threads
     try {
         // Get handle to input wave. Make sure it exists.
@@ -773,13 +431,7 @@ extern "C" int TransposeFrames (TransposeFramesParamsPtr p) {
         dataStartPtr =  ((char*)*wavH) + dataOffset;
         // get ready for Multi threading
         nThreads = gNumProcessors;
-        if (zSize < gNumProcessors) nThreads = (UInt8)zSize;
-        // make an array of threadPramsStruct
-        paramArrayPtr = (TransposeFramesThreadParamsPtr)WMNewPtr(nThreads * sizeof(TransposeFramesThreadParams));
-        if (paramArrayPtr == nullptr) throw result = MEMFAIL;
-        // make an array of pthread_t
-        threadsPtr = (pthread_t*)WMNewPtr(nThreads * sizeof(pthread_t));
-        if (threadsPtr == nullptr) throw result = MEMFAIL;
+        if (zSize < gNumProcessors) nThreads = (UInt32)zSize;
         if (xSize != ySize){ // not square frames, so need to  make a frame sized buffer for each thread
             switch (waveType) {
                 case NT_I64 | NT_UNSIGNED:
@@ -819,9 +471,8 @@ extern "C" int TransposeFrames (TransposeFramesParamsPtr p) {
             if (bufferPtr == nullptr) throw result = NOMEM;
         }
     }catch (int result){ // free any memory we may have allocated so far
+        XFuncTimerEnd (&timer);
         if (bufferPtr != nullptr) WMDisposePtr ((Ptr)bufferPtr);
-        if (threadsPtr != nullptr) WMDisposePtr ((Ptr)threadsPtr);
-        if (paramArrayPtr != nullptr) WMDisposePtr ((Ptr)paramArrayPtr);
         p -> result = (double)(result - FIRST_XOP_ERR);
 #ifdef NO_IGOR_ERR
         return (0);
@@ -829,25 +480,18 @@ extern "C" int TransposeFrames (TransposeFramesParamsPtr p) {
         return (result);
 #endif
     }
-    // fill the array of paramater structs
-    for (iThread = 0; iThread < nThreads; iThread++){
-        paramArrayPtr[iThread].inPutWaveType = waveType;
-        paramArrayPtr[iThread].dataStartPtr = (void*)dataStartPtr;
-        if (xSize != ySize) paramArrayPtr[iThread].bufferPtr = bufferPtr;
-        paramArrayPtr[iThread].xSize = xSize;
-        paramArrayPtr[iThread].ySize = ySize;
-        paramArrayPtr[iThread].zSize = zSize;
-        paramArrayPtr[iThread].ti=iThread; // number of this thread, starting from 0
-        paramArrayPtr[iThread].tN =nThreads; // total number of threads
-    }
-    // create the threads
-    for (iThread = 0; iThread < nThreads; iThread++){
-        pthread_create (&threadsPtr[iThread], NULL, TransposeFramesThread, (void *) &paramArrayPtr[iThread]);
-    }
-    // Wait till all the threads are finished
-    for (iThread = 0; iThread < nThreads; iThread++){
-        pthread_join (threadsPtr[iThread], NULL);
-    }
+    XFuncTimerPhase (&timer, STATS_THREADS);
+    // fill paramater structure
+    params.inPutWaveType = waveType;
+    params.dataStartPtr = (void*)dataStartPtr;
+    params.bufferPtr = bufferPtr;
+    params.xSize = xSize;
+    params.ySize = ySize;
+    params.zSize = zSize;
+    // run the tiles on the thread pool, one frame per tile, and wait till they are all finished
+    XFuncTimerPhase (&timer, STATS_COMPUTE);
+    ThreadPoolRunTiles (TransposeFramesTile, &params, zSize, 1, nThreads);
+    XFuncTimerPhase (&timer, STATS_FINISH);
    // stuff for un-square frames
     if (xSize != ySize){
         WMDisposePtr ((Ptr)bufferPtr);
@@ -856,13 +500,10 @@ extern "C" int TransposeFrames (TransposeFramesParamsPtr p) {
         dimensionSizes [COLUMNS] = xSize;
         MDChangeWave2 (wavH, -1, dimensionSizes, 1);
     }
-    // free memory for pThreads Array
-    WMDisposePtr ((Ptr)threadsPtr);
-    // Free paramaterArray memory
-    WMDisposePtr ((Ptr)paramArrayPtr);
     // Inform Igor that we have changed the input wave.
     WaveHandleModified(wavH);
     p -> result = (0);
+    XFuncTimerEnd (&timer);
     return (0);
 }
 
@@ -873,65 +514,64 @@ extern "C" int TransposeFrames (TransposeFramesParamsPtr p) {
  version in case someone has a different use case.
  -------------------------------------------------------------------------------------------------------- */
 
-/* If you have a 32 bit counter into an unsigned 32 bit wave, counter overflows overflows are handled automatically
-Last Modified: 2025/06/27 by Jamie Boyd*/
-void Decumulate32_32(UInt32* dataStart, UInt32 numPnts, UInt32 firstValue) {
-    UInt32* srcWavePtr;
-    for (srcWavePtr = dataStart + numPnts; srcWavePtr > dataStart; srcWavePtr --) {
-        *srcWavePtr -= *(srcWavePtr - 1);
-    }
-    *srcWavePtr -= firstValue;
-}
-
-
-/* The following template is used to handle any one of the other different types of wave data/counter size
-combos but your wave type must be wider than your counter size.
- Last Modified 2025/06/27 by Jamie Boyd */
-template <typename T> void DecumulateT_ (T *dataStart, CountInt NumPnts, UInt32 maxCount, UInt32 firstValue){
-    T *srcWavePtr;
-    // set srcWavePtr to last point in wave and work backwards
-    for (srcWavePtr = dataStart + NumPnts; srcWavePtr > dataStart; srcWavePtr --){
-        if (*(srcWavePtr - 1) > *srcWavePtr)              // counter rollover occurred
-            *srcWavePtr += maxCount;
-        *srcWavePtr -= *(srcWavePtr - 1);
+/* Finds the maximum count before rollover for a counter of bitSize bits, checking that the wave type is wider than the
+ counter. Returns 0 or NUMTYPE
+ Last Modified 2026/10/16 */
+static int DecumulateMaxCount (int waveType, double bitSize, UInt32* maxCntPtr, UInt8* is3232Ptr){
+    UInt32 maxCnt = (UInt32)(pow(2, (int)bitSize) - 1);
+    *is3232Ptr = 0;
+    // do some checks that wave type is wider than counter size
+    switch (waveType) {
+    case NT_I8:
+        if (maxCnt > 127) return NUMTYPE;
+        break;
+    case (NT_I8 | NT_UNSIGNED):
+        if (maxCnt > 255) return NUMTYPE;
+        break;
+    case NT_I16:
+        if (maxCnt > 32767) return NUMTYPE;
+        break;
+    case (NT_I16 | NT_UNSIGNED):
+        if (maxCnt > 65535) return NUMTYPE;
+        break;
+    case NT_I32:
+        if (maxCnt > INT_MAX) return NUMTYPE;
+        break;
+    case (NT_I32 | NT_UNSIGNED):
+        if ((int)bitSize == 32) *is3232Ptr = 1;
+        break;
+    case NT_FP32:
+        if (maxCnt > 16777216) return NUMTYPE;
+        break;
+    case NT_FP64:
+        break;
+    default:
+        return NUMTYPE;
+        break;
     }
-    if (firstValue > *srcWavePtr)
-        *srcWavePtr += maxCount;
-    *srcWavePtr -= firstValue;
+    *maxCntPtr = maxCnt;
+    return 0;
 }
 
-
-/* Structure to pass data to each Decumulate thread
- Last Modified 2025/06/27 by Jamie Boyd */
-typedef struct DecumulateThreadParams {
-    int inPutWaveType;          // WaveMetrics code for waveType
-    void* dataStartPtr;         // pointer to start of input wave, which is overwritten
-    CountInt dataSize;           // number of points 
-    CountInt zSize;             // number of frames in wave
-    UInt8 ti; // number of this thread, starting from 0
-    UInt8 tN; // total number of threads (255 "should be enough for anyone")
-} DecumulateThreadParams, * DecumulateThreadParamsPtr;
-
 /* Decumulate XOP entry function
 typedef struct DecumulateParams
 double bitSize;   //bitsize of the counter.  either 24 or 32 for NI boards, but could be something else
 waveHndl w1;  // input wave - is overwritten
-Last Modified 2025/06/27 by Jamie Boyd*/
-int Decumulate (DecumulateParamsPtr p) {
+Last Modified 2026/10/16 */
+extern "C" int Decumulate (DecumulateParamsPtr p) {
     int result = 0;    // The error returned from various Wavemetrics functions
     int waveType; //  Wavetypes numeric codes for things like 32 bit floating point, 16 bit int, etc
-    int numDimensions;    // number of dimensions in input and output waves
-    //CountInt dimensionSizes[MAX_DIMENSIONS+1];    // an array used to hold the width, height, layers, and chunk sizes
     BCInt dataOffset;    //offset in bytes from begnning of handle to a wave to the actual data - size of headers, units, etc.
     waveHndl wavH;        // handle to the input wave
     CountInt numPnts;    // number of points in the wave
     char* srcWaveStart;    // Pointer to start of data in input wave. Need to use char for these to use WM function to get data offset
     UInt32 maxCnt;        // maximum value of counter before rollover.
+    UInt8 is3232 = 0;  // set if 32 bit counter with 32 bit unsigned int wave
     // threading
-    UInt8 iThread, nThreads;
+    UInt32 iThread, nThreads;
     DecumulateThreadParamsPtr paramArrayPtr = nullptr;
-    pthread_t* threadsPtr = nullptr; // pointer to threads array
-    void* bufferPtr = nullptr;  // pointer to temp buffer for threads
+    XFuncTimer timer;  // times each phase of this call, for TwoPhotonStats
+    XFuncTimerStart (&timer, STATS_DECUMULATE);
     try {
         // Get handle to input wave. Make sure it exists.
         wavH = p->w1;
@@ -939,55 +579,24 @@ int Decumulate (DecumulateParamsPtr p) {
         //Get data type, no text waves
         waveType = WaveType(p->w1);
         if (waveType == TEXT_WAVE_TYPE) throw result = NOTEXTWAVES;
+        // counter size must be from 1 to 32 bits
+        if ((p->bitSize < 1) || (p->bitSize > 32)) throw result = INPUT_RANGE;
         // Get the offsets to the start of the data in the wave
         if (MDAccessNumericWaveData(wavH, kMDWaveAccessMode0, &dataOffset)) throw result = WAVEERROR_NOS;
         //make pointer to stat of data
         srcWaveStart = (char*)(*wavH) + dataOffset;
         //Figure out how many points are in the wave
         numPnts = WavePoints(wavH);
-        maxCnt = pow(2, p->bitSize) - 1;
-        UInt8 is3232 = 0;  // set if 32 bit counter with 32 bit unsigned int wave
+        if ((result = DecumulateMaxCount (waveType, p->bitSize, &maxCnt, &is3232)) != 0) throw result;
         nThreads = gNumProcessors;
+        if (numPnts < nThreads) nThreads = (UInt32)numPnts;
+        if (nThreads == 0) nThreads = 1;
         // make an array of threadPramsStruct
         paramArrayPtr = (DecumulateThreadParamsPtr)WMNewPtr(nThreads * sizeof(DecumulateThreadParams));
         if (paramArrayPtr == nullptr) throw result = MEMFAIL;
-        // make an array of pthread_t
-        threadsPtr = (pthread_t*)WMNewPtr(nThreads * sizeof(pthread_t));
-        if (threadsPtr == nullptr) throw result = MEMFAIL;
-
-        // do some checks that wave type is wider than counter size
-
-        switch (waveType) {
-        case NT_I8:
-            if (maxCnt > 127) throw result = NUMTYPE;
-            break;
-        case (NT_I8 | NT_UNSIGNED):
-            if (maxCnt > 255) throw result = NUMTYPE;
-            break;
-        case NT_I16:
-            if (maxCnt > 32767) throw result = NUMTYPE;
-            break;
-        case (NT_I16 | NT_UNSIGNED):
-            if (maxCnt > 65535) throw result = NUMTYPE;
-            break;
-        case NT_I32:
-            if (maxCnt > LONG_MAX) throw result = NUMTYPE;
-            break;
-        case (NT_I32 | NT_UNSIGNED):
-            if (p->bitSize == 32) {
-                is3232 = 1;
-            }
-            else {
-                if (maxCnt > ULONG_MAX) throw result = NUMTYPE;
-            }
-            break;
-        case NT_FP32:
-            if (maxCnt > 16777216)  throw result = NUMTYPE;
-            break;
-        }
     }
-    catch (int result) { // free any memory we may have allocated so far  
-        if (threadsPtr != nullptr) WMDisposePtr((Ptr)threadsPtr);
+    catch (int result) { // free any memory we may have allocated so far
+        XFuncTimerEnd (&timer);
         if (paramArrayPtr != nullptr) WMDisposePtr((Ptr)paramArrayPtr);
         p->result = (double)(result - FIRST_XOP_ERR);
 #ifdef NO_IGOR_ERR
@@ -996,40 +605,172 @@ int Decumulate (DecumulateParamsPtr p) {
         return (result);
 #endif
     }
- 
+    XFuncTimerPhase (&timer, STATS_THREADS);
+    // fill the array of paramater structs, reading first value for each thread before any thread changes the wave
     CountInt tPoints = (numPnts / nThreads);  // number of points to do per thread
-
-
-    CountInt startOffset = p->ti * frameSize * tFrames;   // starting position for this thread
-    if (p->ti == p->tN - 1) tFrames += (p->zSize % p->tN); // the last thread gets any left-over frames
-
-    // fill the array of paramater structs
-
     for (iThread = 0; iThread < nThreads; iThread++) {
         paramArrayPtr[iThread].inPutWaveType = waveType;
-        paramArrayPtr[iThread].dataStartPtr = (void*)(srcWaveStart + ;
-        if (xSize != ySize) paramArrayPtr[iThread].bufferPtr = bufferPtr;
-        paramArrayPtr[iThread].xSize = xSize;
-        paramArrayPtr[iThread].ySize = ySize;
-        paramArrayPtr[iThread].zSize = zSize;
-        paramArrayPtr[iThread].ti = iThread; // number of this thread, starting from 0
-        paramArrayPtr[iThread].tN = nThreads; // total number of threads
-    }
-    // create the threads
-    for (iThread = 0; iThread < nThreads; iThread++) {
-        pthread_create(&threadsPtr[iThread], NULL, TransposeFramesThread, (void*)&paramArrayPtr[iThread]);
-    }
-    // Wait till all the threads are finished
-    for (iThread = 0; iThread < nThreads; iThread++) {
-        pthread_join(threadsPtr[iThread], NULL);
-    }
+        paramArrayPtr[iThread].dataStartPtr = srcWaveStart;
+        paramArrayPtr[iThread].startPos = iThread * tPoints;
+        paramArrayPtr[iThread].numPnts = tPoints;
+        if (iThread == nThreads - 1) paramArrayPtr[iThread].numPnts += (numPnts % nThreads); // the last thread gets any left-over points
+        paramArrayPtr[iThread].maxCount = maxCnt;
+        paramArrayPtr[iThread].firstValue = DecumulateFirstValue (waveType, srcWaveStart, iThread * tPoints);
+        paramArrayPtr[iThread].is3232 = is3232;
+    }
+    // run the tasks on the thread pool, and wait till they are all finished
+    XFuncTimerPhase (&timer, STATS_COMPUTE);
+    ThreadPoolRun (DecumulateThread, paramArrayPtr, sizeof(DecumulateThreadParams), nThreads);
+    XFuncTimerPhase (&timer, STATS_FINISH);
+    WMDisposePtr ((Ptr)paramArrayPtr);
+    WaveHandleModified(wavH);            // Inform Igor that we have changed the input wave.
+    p->result = (0);        // return 0 for success
+    XFuncTimerEnd (&timer);
+    return (0);
+}
+
+/* -------------------------------Frame Pipeline--------------------------------------------------
+ Runs several of Decumulate, SwapEven, DownSample and KalmanWaveToFrame on a wave in a single pass, instead of one
+ after another, so the wave is read from memory once. The kernel is in LSMKernels.cpp
+ -------------------------------------------------------------------------------------------------------- */
 
+// maximum length of the stage list for FramePipeline
+#define PIPELINE_MAX_LIST 255
+
+/* Parses a FramePipeline stage list like "Decumulate:24;SwapEven;DownSample:1,4;KalmanWaveToFrame:16" into the stage
+ settings of a paramater structure. Each stage is at most once, with the same paramaters as its XFUNC. Decumulate must
+ be first and KalmanWaveToFrame last. Returns 0, BADPIPELINE, or BADDSTYPE or BADFACTOR for bad DownSample paramaters
+ Last Modified 2026/10/16 */
+static int FramePipelineParse (Handle stageList, PipelineThreadParamsPtr paramsPtr, double* bitSizePtr){
+    char listStr [PIPELINE_MAX_LIST + 1];
+    char* stageStr, *nextStr, *argStr;
+    double arg1, arg2;
+    int nArgs;
+    UInt8 rank, lastRank = 0;  // Decumulate is rank 1, SwapEven and DownSample 2, KalmanWaveToFrame 3
+    BCInt listLen = WMGetHandleSize (stageList);
+    if ((listLen == 0) || (listLen > PIPELINE_MAX_LIST)) return BADPIPELINE;
+    memcpy (listStr, *stageList, listLen);
+    listStr [listLen] = 0;
+    paramsPtr->doDecumulate = 0;
+    paramsPtr->doSwapEven = 0;
+    paramsPtr->DSType = 0;
+    paramsPtr->boxFactor = 1;
+    paramsPtr->doKalman = 0;
+    paramsPtr->multiplier = 1;
+    for (stageStr = listStr; stageStr != nullptr; stageStr = nextStr){
+        nextStr = strchr (stageStr, ';');
+        if (nextStr != nullptr) *nextStr++ = 0;
+        while (*stageStr == ' ') stageStr++;
+        if (*stageStr == 0) continue;   // allow a trailing semicolon
+        // split off paramaters after the colon
+        argStr = strchr (stageStr, ':');
+        nArgs = 0;
+        if (argStr != nullptr){
+            *argStr++ = 0;
+            nArgs = sscanf (argStr, "%lf , %lf", &arg1, &arg2);
+        }
+        if (CmpStr (stageStr, (char*)"Decumulate") == 0){
+            if ((paramsPtr->doDecumulate) || (nArgs != 1)) return BADPIPELINE;
+            paramsPtr->doDecumulate = 1;
+            *bitSizePtr = arg1;
+            rank = 1;
+        }else if (CmpStr (stageStr, (char*)"SwapEven") == 0){
+            if ((paramsPtr->doSwapEven) || (nArgs != 0)) return BADPIPELINE;
+            paramsPtr->doSwapEven = 1;
+            rank = 2;
+        }else if (CmpStr (stageStr, (char*)"DownSample") == 0){
+            if ((paramsPtr->DSType) || (nArgs != 2)) return BADPIPELINE;
+            if ((arg1 < 1) || (arg1 > 4)) return BADDSTYPE;
+            if ((arg2 < 1) || (arg2 > 65535)) return BADFACTOR;
+            paramsPtr->DSType = (UInt8)arg1;
+            paramsPtr->boxFactor = (UInt16)arg2;
+            rank = 2;
+        }else if (CmpStr (stageStr, (char*)"KalmanWaveToFrame") == 0){
+            if ((paramsPtr->doKalman) || (nArgs != 1)) return BADPIPELINE;
+            paramsPtr->doKalman = 1;
+            paramsPtr->multiplier = (float)arg1;
+            rank = 3;
+        }else{
+            return BADPIPELINE;
+        }
+        if (rank < lastRank) return BADPIPELINE;
+        lastRank = rank;
+    }
+    if (lastRank == 0) return BADPIPELINE;
+    return 0;
+}
 
-        WaveHandleModified(wavH);            // Inform Igor that we have changed the input wave.
-        p->result = result;        // return 0 for success
-        return result;
+/* FramePipeline XOP entry function
+ Does the stages in a list on a wave in a single pass, with the same result as calling their XFUNCs one after another.
+ The wave is overwritten, and redimensioned when down sampled or Kalman averaged to a single frame
+ FramePipelineParams
+ Handle stageList   list of stages with their paramaters, as for their XFUNCs, like
+                    "Decumulate:24;SwapEven;DownSample:1,4;KalmanWaveToFrame:16". Decumulate:bitSize must be first,
+                    and KalmanWaveToFrame:multiplier last. SwapEven and DownSample:dsType,boxFactor may be in either order
+ waveHndl w1        input wave, 2D or 3D, 3D if it is to be Kalman averaged
+ result             0 or error code
+ Last Modified 2026/10/16 */
+extern "C" int FramePipeline (FramePipelineParamsPtr p){
+    int result = 0;
+    waveHndl wavH;        // handle to the input wave
+    int waveType; //  Wavetypes numeric codes for things like 32 bit floating point, 16 bit int, etc
+    int numDimensions;    // number of dimensions in input wave
+    CountInt dimensionSizes[MAX_DIMENSIONS+1];    // an array used to hold the width, height, layers, and chunk sizes
+    BCInt dataOffset;    //offset in bytes from begnning of handle to a wave to the actual data - size of headers, units, etc.
+    double bitSize = 0;
+    PipelineThreadParams params;  // paramaters for the tiles
+    XFuncTimer timer;  // times each phase of this call, for TwoPhotonStats
+    XFuncTimerStart (&timer, STATS_FRAMEPIPELINE);
+    try{
+        wavH = p->w1;
+        if (wavH == NIL) throw result = NON_EXISTENT_WAVE;
+        waveType = WaveType(wavH);
+        if (waveType == TEXT_WAVE_TYPE) throw result = NOTEXTWAVES;
+        if (DownSamplePointBytes (waveType) == 0) throw result = NUMTYPE;
+        if (p->stageList == nullptr) throw result = NO_INPUT_STRING;
+        if ((result = FramePipelineParse (p->stageList, &params, &bitSize)) != 0) throw result;
+        if (MDGetWaveDimensions(wavH, &numDimensions, dimensionSizes)) throw result = WAVEERROR_NOS;
+        if (params.doKalman){
+            if (numDimensions != 3) throw result = INPUTNEEDS_3D_WAVE;
+        }else if ((numDimensions != 2) && (numDimensions != 3)){
+            throw result = INPUTNEEDS_2D3D_WAVE;
+        }
+        params.xSize = dimensionSizes [0];
+        params.ySize = dimensionSizes [1];
+        params.zSize = (numDimensions == 2) ? 1 : dimensionSizes [2];
+        if ((params.DSType) && (params.xSize % params.boxFactor)) throw result = BADFACTOR;
+        if (params.doDecumulate){
+            if ((bitSize < 1) || (bitSize > 32)) throw result = INPUT_RANGE;
+            if ((result = DecumulateMaxCount (waveType, bitSize, &params.maxCount, &params.is3232)) != 0) throw result;
+        }
+        if (MDAccessNumericWaveData(wavH, kMDWaveAccessMode0, &dataOffset)) throw result = WAVEERROR_NOS;
+        params.inPutWaveType = waveType;
+        params.dataStartPtr = (char*)(*wavH) + dataOffset;
+        // run all the stages on the thread pool, and wait till they are finished
+        XFuncTimerPhase (&timer, STATS_COMPUTE);
+        if ((result = PipelineRunTiles (&params, gNumProcessors)) != 0) throw result;
     }catch (int result){
-        p -> result = result;
-        return result;  // XFUNC error code.
+        if (p->stageList != nullptr) WMDisposeHandle (p->stageList);
+        XFuncTimerEnd (&timer);
+        p -> result = (double)(result - FIRST_XOP_ERR);
+#ifdef NO_IGOR_ERR
+        return (0);
+#else
+        return (result);
+#endif
+    }
+    XFuncTimerPhase (&timer, STATS_FINISH);
+    WMDisposeHandle (p->stageList);
+    // redimension for down sampling, and for Kalman averaging into a single frame
+    if ((params.DSType) || (params.doKalman)){
+        dimensionSizes [0] = params.xSize/params.boxFactor;
+        dimensionSizes [1] = params.ySize;
+        dimensionSizes [2] = (params.doKalman) ? 0 : dimensionSizes [2];
+        dimensionSizes [3] = 0;
+        MDChangeWave2 (wavH, -1, dimensionSizes, 1);
     }
+    WaveHandleModified (wavH);
+    p -> result = (0);
+    XFuncTimerEnd (&timer);
+    return (0);
 }
@@ -0,0 +1,137 @@
+#include "IgorShim.h"
+
+/* ---------------------------------------------IgorShim----------------------------------------------------------
+ Memory and wave functions standing in for the Igor ones, for building and testing the twoPhoton kernels off Igor.
+ A handle is a master pointer followed by the size of the block it points to. A wave is a handle to a block that
+ starts with an IgorShimWave header, with the data following at dataOffset, aligned as Igor aligns wave data
+ Last Modified 2026/10/16
+ ---------------------------------------------------------------------------------------------------------------*/
+
+// offset from start of a wave's block to its data, a multiple of 16 bytes
+#define IGORSHIM_DATA_OFFSET 64
+
+typedef struct IgorShimWave{
+    int type;                                   // numeric type code
+    int numDimensions;                          // number of dimensions used
+    CountInt dimensionSizes [MAX_DIMENSIONS+1]; // size of each dimension, 0 for unused dimensions
+} IgorShimWave;
+
+typedef struct IgorShimMaster{
+    Ptr dataPtr;
+    BCInt size;
+} IgorShimMaster;
+
+/* Returns the number of bytes in one point of a wave of the given type, or 0 for an unknown type
+ Last Modified 2026/10/16 */
+static int IgorShimPointBytes (int type){
+    int bytes;
+    switch (type & ~(NT_UNSIGNED | NT_CMPLX)){
+        case NT_I8:
+            bytes = 1;
+            break;
+        case NT_I16:
+            bytes = 2;
+            break;
+        case NT_I32:
+        case NT_FP32:
+            bytes = 4;
+            break;
+        case NT_I64:
+        case NT_FP64:
+            bytes = 8;
+            break;
+        default:
+            return 0;
+    }
+    if (type & NT_CMPLX) bytes *= 2;
+    return bytes;
+}
+
+Ptr WMNewPtr (BCInt size){
+    return (Ptr) malloc (size > 0 ? size : 1);
+}
+
+void WMDisposePtr (Ptr p){
+    free (p);
+}
+
+Handle WMNewHandle (BCInt size){
+    IgorShimMaster* masterPtr = (IgorShimMaster*) malloc (sizeof (IgorShimMaster));
+    if (masterPtr == nullptr) return nullptr;
+    masterPtr->dataPtr = (Ptr) malloc (size > 0 ? size : 1);
+    if (masterPtr->dataPtr == nullptr){
+        free (masterPtr);
+        return nullptr;
+    }
+    masterPtr->size = size;
+    return (Handle) masterPtr;
+}
+
+void WMDisposeHandle (Handle h){
+    if (h == nullptr) return;
+    free (*h);
+    free (h);
+}
+
+BCInt WMGetHandleSize (Handle h){
+    if (h == nullptr) return 0;
+    return ((IgorShimMaster*) h)->size;
+}
+
+int MDMakeWave (waveHndl* waveHPtr, const char* waveName, DataFolderHandle dataFolderH, CountInt dimensionSizes[MAX_DIMENSIONS+1], int type, int overwrite){
+    int iDim, pointBytes = IgorShimPointBytes (type);
+    CountInt nPoints = 1;
+    IgorShimWave* wavePtr;
+    *waveHPtr = nullptr;
+    if (pointBytes == 0) return NT_FNOT_AVAIL;
+    for (iDim = 0; (iDim < MAX_DIMENSIONS) && (dimensionSizes [iDim] > 0); iDim++)
+        nPoints *= dimensionSizes [iDim];
+    Handle waveH = WMNewHandle (IGORSHIM_DATA_OFFSET + (nPoints * pointBytes));
+    if (waveH == nullptr) return NOMEM;
+    memset (*waveH, 0, IGORSHIM_DATA_OFFSET + (nPoints * pointBytes));
+    wavePtr = (IgorShimWave*) *waveH;
+    wavePtr->type = type;
+    wavePtr->numDimensions = (iDim == 0) ? 1 : iDim;
+    wavePtr->dimensionSizes [0] = (iDim == 0) ? 1 : dimensionSizes [0];
+    for (iDim = 1; iDim <= MAX_DIMENSIONS; iDim++)
+        wavePtr->dimensionSizes [iDim] = (iDim < wavePtr->numDimensions) ? dimensionSizes [iDim] : 0;
+    *waveHPtr = (waveHndl) waveH;
+    return 0;
+}
+
+int KillWave (waveHndl waveH){
+    if (waveH == nullptr) return NOWAV;
+    WMDisposeHandle ((Handle) waveH);
+    return 0;
+}
+
+int WaveType (waveHndl waveH){
+    return ((IgorShimWave*) *waveH)->type;
+}
+
+CountInt WavePoints (waveHndl waveH){
+    IgorShimWave* wavePtr = (IgorShimWave*) *waveH;
+    CountInt nPoints = 1;
+    for (int iDim = 0; iDim < wavePtr->numDimensions; iDim++)
+        nPoints *= wavePtr->dimensionSizes [iDim];
+    return nPoints;
+}
+
+int MDGetWaveDimensions (waveHndl waveH, int* numDimensionsPtr, CountInt dimensionSizes[MAX_DIMENSIONS+1]){
+    if (waveH == nullptr) return NOWAV;
+    IgorShimWave* wavePtr = (IgorShimWave*) *waveH;
+    *numDimensionsPtr = wavePtr->numDimensions;
+    for (int iDim = 0; iDim <= MAX_DIMENSIONS; iDim++)
+        dimensionSizes [iDim] = wavePtr->dimensionSizes [iDim];
+    return 0;
+}
+
+int MDAccessNumericWaveData (waveHndl waveH, int accessMode, BCInt* dataOffsetPtr){
+    if (waveH == nullptr) return NOWAV;
+    if (WaveType (waveH) == TEXT_WAVE_TYPE) return NT_FNOT_AVAIL;
+    *dataOffsetPtr = IGORSHIM_DATA_OFFSET;
+    return 0;
+}
+
+void WaveHandleModified (waveHndl waveH){
+}
@@ -0,0 +1,78 @@
+/*
+    IgorShim.h -- stands in for XOPStandardHeaders.h when the twoPhoton kernels are built without Igor,
+    as for the Linux static library made by CMakeLists.txt. Provides the XOP Toolkit types and numeric wave
+    type codes that the kernels use, plus just enough of the memory and wave functions for the kernels and
+    for test and benchmark programs that make waves, fill them, and run the kernels on them
+    Last Modified 2026/10/16
+*/
+#ifndef IGORSHIM_H_
+#define IGORSHIM_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+#include <stdint.h>
+
+// XOP Toolkit types
+typedef unsigned char UInt8;
+typedef signed char SInt8;
+typedef unsigned short UInt16;
+typedef short SInt16;
+typedef unsigned int UInt32;
+typedef int SInt32;
+typedef long long SInt64;
+typedef unsigned long long UInt64;
+typedef intptr_t IndexInt;
+typedef IndexInt CountInt;
+typedef intptr_t BCInt;
+typedef char* Ptr;
+typedef char** Handle;
+typedef struct IgorShimWave** waveHndl;
+typedef struct IgorShimDataFolder** DataFolderHandle;
+
+#define NIL 0L
+#define MAX_DIMENSIONS 4
+#define ROWS 0
+#define COLUMNS 1
+#define LAYERS 2
+#define CHUNKS 3
+#define MAX_OBJ_NAME 255
+
+// numeric wave types, as in IgorXOP.h
+#define TEXT_WAVE_TYPE 0
+#define NT_CMPLX 1
+#define NT_FP32 2
+#define NT_FP64 4
+#define NT_I8 8
+#define NT_I16 0x10
+#define NT_I32 0x20
+#define NT_UNSIGNED 0x40
+#define NT_I64 0x80
+
+// error codes
+#define NOMEM 1
+#define NOWAV 3
+#define NT_FNOT_AVAIL 110
+#define FIRST_XOP_ERR 10000
+
+#define kMDWaveAccessMode0 0
+
+// memory
+Ptr WMNewPtr (BCInt size);
+void WMDisposePtr (Ptr p);
+Handle WMNewHandle (BCInt size);
+void WMDisposeHandle (Handle h);
+BCInt WMGetHandleSize (Handle h);
+
+// waves, kept in memory with no names or data folders, so name, data folder, and overwrite are ignored
+int MDMakeWave (waveHndl* waveHPtr, const char* waveName, DataFolderHandle dataFolderH, CountInt dimensionSizes[MAX_DIMENSIONS+1], int type, int overwrite);
+int KillWave (waveHndl waveH);
+int WaveType (waveHndl waveH);
+CountInt WavePoints (waveHndl waveH);
+int MDGetWaveDimensions (waveHndl waveH, int* numDimensionsPtr, CountInt dimensionSizes[MAX_DIMENSIONS+1]);
+int MDAccessNumericWaveData (waveHndl waveH, int accessMode, BCInt* dataOffsetPtr);
+void WaveHandleModified (waveHndl waveH);
+
+#endif
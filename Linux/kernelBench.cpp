@@ -0,0 +1,919 @@
+/*
+    kernelBench.cpp -- throughput benchmarks for the twoPhoton compute kernels, built with the headless kernel library
+    against the Igor shim. Runs the same workloads as test_twoPhotonXOP in twoPhotonXOPtests.ipf, on stacks that mimic
+    a noisy 12 bit A/D, for every wave type, several stack shapes, and a range of thread counts. Prints one line of
+    comma separated values for each run, so results can be kept and compared between releases:
+    kernel,variant,type,xSize,ySize,zSize,threads,reps,bestSecs,meanSecs,GBperSec,framesPerSec
+    GB/s is bytes of input wave data read per second of the best rep, frames/s is input frames per second of the best rep
+    The stress test then calls Kalman, ProjectZ, MedianFrames and ConvolveFrames from several threads at once, as Igor
+    preemptive threads do, with the thread pool's governor on and off. For these lines variant is callers=n governor=on,
+    threads is the size of the pool, bestSecs is wall time for every caller to do reps calls, meanSecs is the mean time
+    of a call, and GB/s and frames/s are for all the callers together
+    usage: kernelBench [-shapes 1000x500x30,512x512x64] [-types u16,f32] [-threads 1,2,4] [-reps 3] [-kernels Kalman,Project] [-callers 1,2,4] [-quick]
+    Last Modified 2026/10/16
+*/
+#include "../twoPhotonKernels.h"
+#include <chrono>
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+
+// one stack shape to benchmark
+typedef struct BenchShape{
+    CountInt xSize;
+    CountInt ySize;
+    CountInt zSize;
+} BenchShape, *BenchShapePtr;
+
+// wave types, with short names for the output
+typedef struct BenchType{
+    int waveType;
+    const char* typeName;
+} BenchType, *BenchTypePtr;
+
+static const BenchType gBenchTypes [8] = {
+    {NT_I8, "i8"}, {NT_I8 | NT_UNSIGNED, "u8"}, {NT_I16, "i16"}, {NT_I16 | NT_UNSIGNED, "u16"},
+    {NT_I32, "i32"}, {NT_I32 | NT_UNSIGNED, "u32"}, {NT_FP32, "f32"}, {NT_FP64, "f64"}
+};
+
+/* Everything a benchmark needs to run a kernel once: the stack it works on, an output wave and a buffer big enough for
+ any kernel, the current shape, type and thread count, and the paramater structure for the kernel
+ Last Modified 2026/10/16 */
+typedef struct BenchContext{
+    BenchShape shape;
+    BenchType type;
+    UInt8 pointBytes;
+    UInt32 nThreads;
+    UInt32 reps;
+    char* stackPtr;         // input stack, refilled from originalPtr when a kernel overwrites it
+    char* originalPtr;      // untouched copy of the input stack
+    char* outPutPtr;        // output wave, same size and type as the input stack
+    char* bufferPtr;        // a frame-sized buffer for each thread, for kernels that work in place
+    float* kernelPtr;       // convolution kernel
+    float* kernelTablePtr;  // kernel table made from the convolution kernel
+    // paramater structures for the kernels
+    KalmanThreadParams kalmanParams;
+    KalmanNextThreadParams kalmanNextParams;
+    KalmanListThreadParams kalmanListParams;
+    KalmanSlidingThreadParams kalmanSlidingParams;
+    KalmanStatsThreadParams kalmanStatsParams;
+    KalmanRobustThreadParams kalmanRobustParams;
+    TriggeredAverageThreadParams triggeredParams;
+    ProjectThreadParams projectParams;
+    ProjectMultiThreadParams projectMultiParams;
+    ProjectDepthThreadParams projectDepthParams;
+    ConvolveFramesThreadParams convolveParams;
+    MedianFramesThreadParams medianParams;
+    SwapEvenThreadParams swapEvenParams;
+    DownSampleThreadParams downSampleParams;
+    TransposeFramesThreadParams transposeParams;
+    PipelineThreadParams pipelineParams;
+} BenchContext, *BenchContextPtr;
+
+typedef void (*BenchRunFunc)(BenchContextPtr benchPtr);
+
+/* Fills a stack with a pattern like that made by test_twoPhotonXOP, 2^11 + (2^10) * sin * cos + noise, scaled down
+ to fit in 8 bit waves
+ Last Modified 2026/10/16 */
+template <typename T> void BenchFillT (T* dataPtr, CountInt xSize, CountInt ySize, CountInt zSize, double scale){
+    UInt32 seed = 1;
+    CountInt iX, iY, iZ;
+    for (iZ = 0; iZ < zSize; iZ++){
+        for (iY = 0; iY < ySize; iY++){
+            for (iX = 0; iX < xSize; iX++, dataPtr++){
+                seed = seed * 1664525u + 1013904223u;
+                double noise = ((double)(seed >> 8)/(double)(1 << 24) - 0.5) * 2048;
+                *dataPtr = (T)(scale * (2048 + 1024 * sin ((iX - iZ)/60.0) * cos ((iY + iZ)/40.0) + noise));
+            }
+        }
+    }
+}
+
+/* Fills the stack for the current type, and keeps a copy of it to restore stacks that kernels overwrite
+ Last Modified 2026/10/16 */
+static void BenchFill (BenchContextPtr benchPtr){
+    CountInt x = benchPtr->shape.xSize, y = benchPtr->shape.ySize, z = benchPtr->shape.zSize;
+    switch (benchPtr->type.waveType){
+        case NT_I8:
+            BenchFillT ((char*)benchPtr->stackPtr, x, y, z, 1/64.0);
+            break;
+        case (NT_I8 | NT_UNSIGNED):
+            BenchFillT ((unsigned char*)benchPtr->stackPtr, x, y, z, 1/32.0);
+            break;
+        case NT_I16:
+            BenchFillT ((short*)benchPtr->stackPtr, x, y, z, 1);
+            break;
+        case (NT_I16 | NT_UNSIGNED):
+            BenchFillT ((unsigned short*)benchPtr->stackPtr, x, y, z, 1);
+            break;
+        case NT_I32:
+            BenchFillT ((SInt32*)benchPtr->stackPtr, x, y, z, 1);
+            break;
+        case (NT_I32| NT_UNSIGNED):
+            BenchFillT ((UInt32*)benchPtr->stackPtr, x, y, z, 1);
+            break;
+        case NT_FP32:
+            BenchFillT ((float*)benchPtr->stackPtr, x, y, z, 1);
+            break;
+        case NT_FP64:
+            BenchFillT ((double*)benchPtr->stackPtr, x, y, z, 1);
+            break;
+    }
+    memcpy (benchPtr->originalPtr, benchPtr->stackPtr, x * y * z * benchPtr->pointBytes);
+}
+
+/* Puts the original data back in the stack, for kernels that overwrite it
+ Last Modified 2026/10/16 */
+static void BenchRestore (BenchContextPtr benchPtr){
+    memcpy (benchPtr->stackPtr, benchPtr->originalPtr, benchPtr->shape.xSize * benchPtr->shape.ySize * benchPtr->shape.zSize * benchPtr->pointBytes);
+}
+
+/* Makes a normalized 2D or 1D gaussian kernel, as made by makeKernel and makeSymkernel in twoPhotonXOPtests.ipf
+ Last Modified 2026/10/16 */
+static void BenchMakeKernel (float* kernelPtr, UInt16 kWidth, UInt16 kHeight){
+    double sumVal = 0;
+    UInt16 iX, iY;
+    for (iY = 0; iY < kHeight; iY++){
+        for (iX = 0; iX < kWidth; iX++){
+            double x = (kWidth > 1) ? -1 + 2.0 * iX/(kWidth - 1) : 0;
+            double y = (kHeight > 1) ? -1 + 2.0 * iY/(kHeight - 1) : 0;
+            kernelPtr [iY * kWidth + iX] = (float)exp (-(x * x + y * y)/(2 * 0.25));
+            sumVal += kernelPtr [iY * kWidth + iX];
+        }
+    }
+    for (iX = 0; iX < kWidth * kHeight; iX++) kernelPtr [iX] /= sumVal;
+}
+
+/* Runs a kernel reps times, restoring the stack before each rep if asked, and prints a line of results
+ Last Modified 2026/10/16 */
+static void BenchRun (BenchContextPtr benchPtr, const char* kernelName, const char* variant, BenchRunFunc runFunc, double bytesPerRun, double framesPerRun, UInt8 restore){
+    double secs, bestSecs = 0, totalSecs = 0;
+    UInt32 iRep;
+    gNumProcessors = benchPtr->nThreads;
+    // one rep that is not timed, to fault in pages and warm up caches and the pool
+    if (restore) BenchRestore (benchPtr);
+    runFunc (benchPtr);
+    for (iRep = 0; iRep < benchPtr->reps; iRep++){
+        if (restore) BenchRestore (benchPtr);
+        std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now ();
+        runFunc (benchPtr);
+        secs = std::chrono::duration<double>(std::chrono::steady_clock::now () - startTime).count ();
+        totalSecs += secs;
+        if ((iRep == 0) || (secs < bestSecs)) bestSecs = secs;
+    }
+    printf ("%s,%s,%s,%ld,%ld,%ld,%u,%u,%.6f,%.6f,%.3f,%.1f\n", kernelName, variant, benchPtr->type.typeName,
+            (long)benchPtr->shape.xSize, (long)benchPtr->shape.ySize, (long)benchPtr->shape.zSize,
+            benchPtr->nThreads, benchPtr->reps, bestSecs, totalSecs/benchPtr->reps,
+            bytesPerRun/bestSecs/1e9, framesPerRun/bestSecs);
+    fflush (stdout);
+}
+
+/* ------------------------------------- run functions, one for each kernel ------------------------------------ */
+
+static void BenchKalman (BenchContextPtr benchPtr){
+    KalmanRunTiles (&benchPtr->kalmanParams);
+}
+
+/* KalmanNext is called once per frame during acquisition, adding each frame of the stack to a running average
+ Last Modified 2026/10/16 */
+static void BenchKalmanNext (BenchContextPtr benchPtr){
+    KalmanNextThreadParamsPtr p = &benchPtr->kalmanNextParams;
+    CountInt frameBytes = p->nPnts * benchPtr->pointBytes;
+    for (CountInt iFrame = 0; iFrame < benchPtr->shape.zSize; iFrame++){
+        p->inPutDataStartPtr = benchPtr->stackPtr + iFrame * frameBytes;
+        p->iKal = iFrame + 1;
+        ThreadPoolRunTiles (KalmanNextTile, p, p->nPnts, ThreadPoolTileSize (p->nPnts, KALMAN_MIN_TILE), gNumProcessors);
+    }
+}
+
+/* KalmanList averages the frames of the stack as a list of waves in a single call, to compare with calling KalmanNext
+ once for each frame
+ Last Modified 2026/10/16 */
+static void BenchKalmanNextBatch (BenchContextPtr benchPtr){
+    KalmanNextThreadParamsPtr p = &benchPtr->kalmanNextParams;
+    ThreadPoolRunTiles (KalmanNextTile, p, p->nPnts, ThreadPoolTileSize (p->nPnts, KALMAN_MIN_TILE), gNumProcessors);
+}
+
+static void BenchKalmanList (BenchContextPtr benchPtr){
+    KalmanListRunTiles (&benchPtr->kalmanListParams, gNumProcessors);
+}
+
+/* Binning with KalmanGroupFrames, with a call for each group, as done before with KalmanSpecFrames
+ Last Modified 2026/10/16 */
+static void BenchKalmanPerGroup (BenchContextPtr benchPtr){
+    KalmanThreadParams kp = benchPtr->kalmanParams;
+    kp.nGroups = 1;
+    for (CountInt iGroup = 0; iGroup < benchPtr->kalmanParams.nGroups; iGroup++){
+        kp.startLayer = iGroup * kp.zSize;
+        kp.outPutLayer = iGroup;
+        KalmanRunTiles (&kp);
+    }
+}
+
+/* Averaging interleaved channels as done before there was KalmanInterleaved, copying the layers of each channel into
+ a stack of their own, here the output wave, and averaging that in place
+ Last Modified 2026/10/16 */
+static void BenchKalmanDeinterleave (BenchContextPtr benchPtr){
+    KalmanThreadParams kp = benchPtr->kalmanParams;
+    CountInt frameBytes = kp.xSize * kp.ySize * benchPtr->pointBytes;
+    kp.inPutDataStartPtr = kp.outPutDataStartPtr;
+    kp.nChannels = 1;
+    for (CountInt iChannel = 0; iChannel < benchPtr->kalmanParams.nChannels; iChannel++){
+        for (CountInt iLayer = 0; iLayer < kp.zSize; iLayer++){
+            memcpy (kp.outPutDataStartPtr + iLayer * frameBytes, benchPtr->stackPtr + (iLayer * benchPtr->kalmanParams.nChannels + iChannel) * frameBytes, frameBytes);
+        }
+        KalmanRunTiles (&kp);
+    }
+}
+
+static void BenchKalmanSliding (BenchContextPtr benchPtr){
+    KalmanSlidingRunTiles (&benchPtr->kalmanSlidingParams);
+}
+
+/* The same moving average done as before there was KalmanSlidingWindow, with a call to KalmanSpecFrames for each
+ output layer, using exact averaging so the output is the same
+ Last Modified 2026/10/16 */
+static void BenchKalmanSpecLayers (BenchContextPtr benchPtr){
+    KalmanSlidingThreadParamsPtr sp = &benchPtr->kalmanSlidingParams;
+    KalmanThreadParams kp = {sp->inPutWaveType, sp->inPutDataStartPtr, sp->outPutDataStartPtr, 0, 0, sp->xSize, sp->ySize, sp->nWindow, 1, 1, 1, 1};
+    for (CountInt outLayer = 0; outLayer < sp->outZSize; outLayer++){
+        kp.startLayer = kp.outPutLayer = outLayer;
+        KalmanRunTiles (&kp);
+    }
+}
+
+static void BenchKalmanStats (BenchContextPtr benchPtr){
+    KalmanStatsRunTiles (&benchPtr->kalmanStatsParams);
+}
+
+static void BenchKalmanRobust (BenchContextPtr benchPtr){
+    KalmanRobustRunTiles (&benchPtr->kalmanRobustParams);
+}
+
+static void BenchTriggered (BenchContextPtr benchPtr){
+    TriggeredAverageRunTiles (&benchPtr->triggeredParams);
+}
+
+/* Triggered averaging as done before there was TriggeredAverage, copying the layer at each offset after every trigger
+ into a stack of its own, here after the output layers in the output wave, and averaging that stack exactly
+ Last Modified 2026/10/16 */
+static void BenchTriggeredCopies (BenchContextPtr benchPtr){
+    TriggeredAverageThreadParamsPtr tp = &benchPtr->triggeredParams;
+    CountInt frameBytes = tp->xSize * tp->ySize * benchPtr->pointBytes;
+    char* copiesPtr = tp->outPutDataStartPtr + tp->nWindow * frameBytes;
+    KalmanThreadParams kp = {tp->inPutWaveType, copiesPtr, tp->outPutDataStartPtr, 0, 0, tp->xSize, tp->ySize, tp->nTriggers, 1, 1, 1, 1};
+    for (CountInt layer = 0; layer < tp->nWindow; layer++){
+        for (CountInt iTrigger = 0; iTrigger < tp->nTriggers; iTrigger++){
+            memcpy (copiesPtr + iTrigger * frameBytes, tp->inPutDataStartPtr + (tp->startLayersPtr [iTrigger] + layer) * frameBytes, frameBytes);
+        }
+        kp.outPutLayer = layer;
+        KalmanRunTiles (&kp);
+    }
+}
+
+static void BenchProject (BenchContextPtr benchPtr){
+    ProjectRunTiles (&benchPtr->projectParams, 0);
+}
+
+static void BenchProjectMulti (BenchContextPtr benchPtr){
+    ProjectMultiRunTiles (&benchPtr->projectMultiParams);
+}
+
+static void BenchProjectDepth (BenchContextPtr benchPtr){
+    ProjectDepthRunTiles (&benchPtr->projectDepthParams);
+}
+
+/* Min, max, average and median Z projections, as made before there was ProjectMulti, with a call to ProjectAllFrames for
+ each, reading the whole stack each time
+ Last Modified 2026/10/16 */
+static void BenchProjectSeparate (BenchContextPtr benchPtr){
+    ProjectThreadParamsPtr p = &benchPtr->projectParams;
+    for (p->projMode = 0; p->projMode < 4; p->projMode++){
+        ProjectRunTiles (p, 0);
+    }
+}
+
+/* ProjectZSlice is called once per frame during acquisition, taking each layer of the stack in turn
+ Last Modified 2026/10/16 */
+static void BenchProjectZSlice (BenchContextPtr benchPtr){
+    ProjectThreadParamsPtr p = &benchPtr->projectParams;
+    for (CountInt iLayer = 0; iLayer < benchPtr->shape.zSize; iLayer++){
+        p->startP = p->endP = iLayer;
+        ProjectRunTiles (p, 0);
+    }
+}
+
+static void BenchConvolve (BenchContextPtr benchPtr){
+    ThreadPoolRunTiles (ConvolveFramesTile, &benchPtr->convolveParams, benchPtr->shape.zSize, 1, gNumProcessors);
+}
+
+static void BenchSymConvolve (BenchContextPtr benchPtr){
+    ThreadPoolRunTiles (SymConvolveFramesTile, &benchPtr->convolveParams, benchPtr->shape.zSize, 1, gNumProcessors);
+}
+
+static void BenchMedian (BenchContextPtr benchPtr){
+    ThreadPoolRunTiles (MedianFramesTile, &benchPtr->medianParams, benchPtr->shape.zSize, 1, gNumProcessors);
+}
+
+static void BenchSwapEven (BenchContextPtr benchPtr){
+    SwapEvenRunTiles (&benchPtr->swapEvenParams);
+}
+
+static void BenchDownSample (BenchContextPtr benchPtr){
+    DownSampleRunTiles (&benchPtr->downSampleParams);
+}
+
+static void BenchTranspose (BenchContextPtr benchPtr){
+    ThreadPoolRunTiles (TransposeFramesTile, &benchPtr->transposeParams, benchPtr->shape.zSize, 1, gNumProcessors);
+}
+
+/* The pipeline of Decumulate, SwapEven, DownSample and KalmanWaveToFrame in a single pass with FramePipeline
+ Last Modified 2026/10/16 */
+static void BenchPipelineFused (BenchContextPtr benchPtr){
+    PipelineRunTiles (&benchPtr->pipelineParams, gNumProcessors);
+}
+
+/* The same stages one after another, as done by calling their XFUNCs in turn, with the output wave as the buffer for
+ DownSample
+ Last Modified 2026/10/16 */
+static void BenchPipelineSeparate (BenchContextPtr benchPtr){
+    PipelineThreadParamsPtr p = &benchPtr->pipelineParams;
+    CountInt points = p->xSize * p->ySize * p->zSize;
+    DecumulateThreadParams decumulateParams [256];
+    UInt32 iThread, nThreads = gNumProcessors;
+    CountInt tPoints = points/nThreads;
+    for (iThread = 0; iThread < nThreads; iThread++){
+        DecumulateThreadParams dp = {p->inPutWaveType, p->dataStartPtr, iThread * tPoints, tPoints, p->maxCount,
+            DecumulateFirstValue (p->inPutWaveType, p->dataStartPtr, iThread * tPoints), p->is3232};
+        if (iThread == nThreads - 1) dp.numPnts += points % nThreads;
+        decumulateParams [iThread] = dp;
+    }
+    ThreadPoolRun (DecumulateThread, decumulateParams, sizeof (DecumulateThreadParams), nThreads);
+    SwapEvenThreadParams sp = {p->inPutWaveType, p->dataStartPtr, p->ySize * p->zSize, p->xSize};
+    SwapEvenRunTiles (&sp);
+    DownSampleThreadParams dp = {p->inPutWaveType, p->dataStartPtr, benchPtr->outPutPtr, points, p->boxFactor, p->DSType};
+    DownSampleRunTiles (&dp);
+    KalmanThreadParams kp = {p->inPutWaveType, p->dataStartPtr, p->dataStartPtr, 0, 0, p->xSize/p->boxFactor, p->ySize, p->zSize, 1, 1, p->multiplier};
+    KalmanRunTiles (&kp);
+}
+
+/* Runs all the selected kernels on the stack in the context, for its shape, type and thread count
+ Last Modified 2026/10/16 */
+static void BenchAllKernels (BenchContextPtr benchPtr, const std::string& kernelList){
+    const char* projNames [4] = {"min", "max", "avg", "median"};
+    const double percentiles [2] = {10, 99};
+    const char* dimNames [3] = {"ProjectX", "ProjectY", "ProjectZ"};
+    const char* dsNames [4] = {"avg", "sum", "max", "median"};
+    const UInt16 convolveWidths [2] = {5, 11};
+    const UInt16 symConvolveWidths [2] = {11, 23};
+    char variant [64];
+    CountInt x = benchPtr->shape.xSize, y = benchPtr->shape.ySize, z = benchPtr->shape.zSize;
+    CountInt frameSize = x * y;
+    double stackBytes = (double)frameSize * z * benchPtr->pointBytes;
+    int waveType = benchPtr->type.waveType;
+    UInt8 doAll = kernelList.empty ();
+    #define BENCH_SELECTED(name) (doAll || (("," + kernelList + ",").find (std::string (",") + name + ",") != std::string::npos))
+    // Kalman averaging of all frames into a new frame, with a multiplier of 16, as in twoPhotonXOPtests.ipf
+    if (BENCH_SELECTED ("Kalman")){
+        KalmanThreadParams kp = {waveType, benchPtr->stackPtr, benchPtr->outPutPtr, 0, 0, x, y, z, 1, 1, 16};
+        benchPtr->kalmanParams = kp;
+        BenchRun (benchPtr, "Kalman", "all", BenchKalman, stackBytes, (double)z, 0);
+        // exact averaging, summing the layers and dividing once
+        benchPtr->kalmanParams.exact = 1;
+        BenchRun (benchPtr, "Kalman", "exact", BenchKalman, stackBytes, (double)z, 0);
+    }
+    // the same with the scalar loops and each SIMD level this CPU has, with and without a multiplier
+    if (BENCH_SELECTED ("KalmanSIMD")){
+        const char* levelNames [3] = {"scalar", "sse4.1", "avx2"};
+        UInt8 savedLevel = gSIMDLevel;
+        for (int iMult = 0; iMult < 2; iMult++){
+            for (UInt8 level = CPU_SIMD_NONE; level <= CPUTopologySIMDLevel (); level++){
+                KalmanThreadParams kp = {waveType, benchPtr->stackPtr, benchPtr->outPutPtr, 0, 0, x, y, z, 1, 1, iMult ? 16.0f : 1.0f};
+                benchPtr->kalmanParams = kp;
+                gSIMDLevel = level;
+                snprintf (variant, sizeof (variant), "m=%d %s", iMult ? 16 : 1, levelNames [level]);
+                BenchRun (benchPtr, "KalmanSIMD", variant, BenchKalman, stackBytes, (double)z, 0);
+            }
+        }
+        gSIMDLevel = savedLevel;
+    }
+    // the same with whole tiles taken through all the layers at a time, and with blocks sized for the L2 cache
+    if (BENCH_SELECTED ("KalmanBlock")){
+        CountInt savedBlockBytes = gKalmanBlockBytes;
+        for (int iMult = 0; iMult < 2; iMult++){
+            KalmanThreadParams kp = {waveType, benchPtr->stackPtr, benchPtr->outPutPtr, 0, 0, x, y, z, 1, 1, iMult ? 16.0f : 1.0f};
+            benchPtr->kalmanParams = kp;
+            gKalmanBlockBytes = 0;
+            snprintf (variant, sizeof (variant), "m=%d tiles", iMult ? 16 : 1);
+            BenchRun (benchPtr, "KalmanBlock", variant, BenchKalman, stackBytes, (double)z, 0);
+            gKalmanBlockBytes = savedBlockBytes;
+            snprintf (variant, sizeof (variant), "m=%d blocks %ldK", iMult ? 16 : 1, (long)(savedBlockBytes/1024));
+            BenchRun (benchPtr, "KalmanBlock", variant, BenchKalman, stackBytes, (double)z, 0);
+        }
+    }
+    if (BENCH_SELECTED ("KalmanNext")){
+        KalmanNextThreadParams kn = {waveType, benchPtr->stackPtr, benchPtr->outPutPtr, frameSize, 1, 1, 0};
+        benchPtr->kalmanNextParams = kn;
+        memcpy (benchPtr->outPutPtr, benchPtr->stackPtr, frameSize * benchPtr->pointBytes);
+        BenchRun (benchPtr, "KalmanNext", "perFrame", BenchKalmanNext, stackBytes, (double)z, 0);
+        // all the frames of the stack in one call, as a running average and as an exponential average
+        benchPtr->kalmanNextParams = kn;
+        benchPtr->kalmanNextParams.nFrames = z;
+        BenchRun (benchPtr, "KalmanNext", "batch", BenchKalmanNextBatch, stackBytes, (double)z, 0);
+        benchPtr->kalmanNextParams.weight = 0.1;
+        BenchRun (benchPtr, "KalmanNext", "batch exp", BenchKalmanNextBatch, stackBytes, (double)z, 0);
+    }
+    if ((BENCH_SELECTED ("KalmanList")) && (z <= 65535)){
+        std::vector<Ptr> listStarts (z);
+        for (CountInt iFrame = 0; iFrame < z; iFrame++) listStarts [iFrame] = benchPtr->stackPtr + iFrame * frameSize * benchPtr->pointBytes;
+        KalmanListThreadParams kl = {waveType, listStarts.data (), benchPtr->outPutPtr, (UInt16)z, frameSize, 1, nullptr};
+        benchPtr->kalmanListParams = kl;
+        BenchRun (benchPtr, "KalmanList", "list", BenchKalmanList, stackBytes, (double)z, 0);
+        benchPtr->kalmanListParams.multiplier = 0;
+        BenchRun (benchPtr, "KalmanList", "average", BenchKalmanList, stackBytes, (double)z, 0);
+    }
+    // binning into groups of 8 layers, with a multiplier of 16, in one pass and with a call for each group
+    if (BENCH_SELECTED ("KalmanGroup")){
+        CountInt nFrames = (z < 8) ? z : 8;
+        KalmanThreadParams kp = {waveType, benchPtr->stackPtr, benchPtr->outPutPtr, 0, 0, x, y, nFrames, z/nFrames, 1, 16};
+        benchPtr->kalmanParams = kp;
+        snprintf (variant, sizeof (variant), "grouped n=%ld", (long)nFrames);
+        BenchRun (benchPtr, "KalmanGroup", variant, BenchKalman, stackBytes, (double)z, 0);
+        snprintf (variant, sizeof (variant), "perGroup n=%ld", (long)nFrames);
+        BenchRun (benchPtr, "KalmanGroup", variant, BenchKalmanPerGroup, stackBytes, (double)z, 0);
+    }
+    // two interleaved channels, each averaged straight from the stack, and copied into its own stack first
+    if ((BENCH_SELECTED ("KalmanInterleaved")) && (z >= 2)){
+        KalmanThreadParams kp = {waveType, benchPtr->stackPtr, benchPtr->outPutPtr, 0, 0, x, y, z/2, 1, 2, 16};
+        benchPtr->kalmanParams = kp;
+        BenchRun (benchPtr, "KalmanInterleaved", "interleaved c=2", BenchKalman, stackBytes, (double)z, 0);
+        BenchRun (benchPtr, "KalmanInterleaved", "deinterleave c=2", BenchKalmanDeinterleave, stackBytes, (double)z, 0);
+    }
+    // moving average of 16 layers, in one pass and with a call for each output layer
+    if (BENCH_SELECTED ("KalmanSliding")){
+        CountInt nWindow = (z < 16) ? z : 16;
+        KalmanSlidingThreadParams ks = {waveType, benchPtr->stackPtr, benchPtr->outPutPtr, x, y, z, z - nWindow + 1, nWindow, 0, nullptr};
+        benchPtr->kalmanSlidingParams = ks;
+        snprintf (variant, sizeof (variant), "sliding n=%ld", (long)nWindow);
+        BenchRun (benchPtr, "KalmanSliding", variant, BenchKalmanSliding, stackBytes, (double)z, 0);
+        snprintf (variant, sizeof (variant), "perLayer n=%ld", (long)nWindow);
+        BenchRun (benchPtr, "KalmanSliding", variant, BenchKalmanSpecLayers, stackBytes, (double)z, 0);
+    }
+    // per-point mean, variance and standard deviation, with and without minimum and maximum, and the exact mean alone
+    // for comparison. The output needs 5 layers, or 10 for a double precision output from a 32 bit stack
+    if ((BENCH_SELECTED ("KalmanStats")) && (z * benchPtr->pointBytes >= (CountInt)(5 * sizeof (double)))){
+        KalmanStatsThreadParams kst = {waveType, benchPtr->stackPtr, benchPtr->outPutPtr, x, y, z, 0, nullptr};
+        benchPtr->kalmanStatsParams = kst;
+        BenchRun (benchPtr, "KalmanStats", "stats", BenchKalmanStats, stackBytes, (double)z, 0);
+        benchPtr->kalmanStatsParams.doMinMax = 1;
+        BenchRun (benchPtr, "KalmanStats", "stats minmax", BenchKalmanStats, stackBytes, (double)z, 0);
+        KalmanThreadParams kp = {waveType, benchPtr->stackPtr, benchPtr->outPutPtr, 0, 0, x, y, z, 1, 1, 1, 1};
+        benchPtr->kalmanParams = kp;
+        BenchRun (benchPtr, "KalmanStats", "mean only", BenchKalman, stackBytes, (double)z, 0);
+    }
+    // robust averages, sigma clipped at 3 standard deviations, and Winsorized and trimmed by 10% at each end, with
+    // KalmanAllFrames, with a multiplier of 16 and exact, for comparison
+    if (BENCH_SELECTED ("KalmanRobust")){
+        const char* robustNames [3] = {"sigma 3", "winsor 0.1", "trim 0.1"};
+        for (UInt8 mode = KALMAN_ROBUST_SIGMA; mode <= KALMAN_ROBUST_TRIM; mode++){
+            KalmanRobustThreadParams kr = {waveType, benchPtr->stackPtr, benchPtr->outPutPtr, x, y, z, mode, (mode == KALMAN_ROBUST_SIGMA) ? 3.0 : 0.1, 0, nullptr};
+            benchPtr->kalmanRobustParams = kr;
+            BenchRun (benchPtr, "KalmanRobust", robustNames [mode], BenchKalmanRobust, stackBytes, (double)z, 0);
+        }
+        KalmanThreadParams kp = {waveType, benchPtr->stackPtr, benchPtr->outPutPtr, 0, 0, x, y, z, 1, 1, 16};
+        benchPtr->kalmanParams = kp;
+        BenchRun (benchPtr, "KalmanRobust", "KalmanAllFrames m=16", BenchKalman, stackBytes, (double)z, 0);
+        benchPtr->kalmanParams.exact = 1;
+        BenchRun (benchPtr, "KalmanRobust", "KalmanAllFrames exact", BenchKalman, stackBytes, (double)z, 0);
+    }
+    // windows of 10 layers, 2 before and 7 after a trigger every 10 layers, in one pass and copying the layers for each
+    // offset, as done before with Duplicate, before averaging them
+    if ((BENCH_SELECTED ("TriggeredAverage")) && (z >= 30)){
+        std::vector<CountInt> startLayers;
+        for (CountInt trigger = 10; trigger + 7 < z; trigger += 10) startLayers.push_back (trigger - 2);
+        TriggeredAverageThreadParams tp = {waveType, benchPtr->stackPtr, benchPtr->outPutPtr, x, y, z, startLayers.data (), (CountInt)startLayers.size (), 10, nullptr};
+        benchPtr->triggeredParams = tp;
+        snprintf (variant, sizeof (variant), "triggered n=%ld", (long)startLayers.size ());
+        BenchRun (benchPtr, "TriggeredAverage", variant, BenchTriggered, (double)frameSize * 10 * startLayers.size () * benchPtr->pointBytes, 10.0 * startLayers.size (), 0);
+        snprintf (variant, sizeof (variant), "copies n=%ld", (long)startLayers.size ());
+        BenchRun (benchPtr, "TriggeredAverage", variant, BenchTriggeredCopies, (double)frameSize * 10 * startLayers.size () * benchPtr->pointBytes, 10.0 * startLayers.size (), 0);
+    }
+    // projections of all frames in each dimension, for each mode
+    for (UInt8 flatDim = 0; flatDim < 3; flatDim++){
+        if (!BENCH_SELECTED (dimNames [flatDim])) continue;
+        CountInt endP = (flatDim == 0) ? x - 1 : ((flatDim == 1) ? y - 1 : z - 1);
+        for (UInt8 projMode = 0; projMode < 4; projMode++){
+            ProjectThreadParams pp = {waveType, benchPtr->stackPtr, benchPtr->outPutPtr, flatDim, projMode, x, y, z, 0, endP};
+            benchPtr->projectParams = pp;
+            BenchRun (benchPtr, dimNames [flatDim], projNames [projMode], BenchProject, stackBytes, (double)z, 0);
+        }
+        // 10th and 99th percentile projections, as for baseline F0 images and robust maxima
+        for (int iPct = 0; iPct < 2; iPct++){
+            ProjectThreadParams pp = {waveType, benchPtr->stackPtr, benchPtr->outPutPtr, flatDim, 4, x, y, z, 0, endP, percentiles [iPct]};
+            benchPtr->projectParams = pp;
+            snprintf (variant, sizeof (variant), "percentile %.0f", percentiles [iPct]);
+            BenchRun (benchPtr, dimNames [flatDim], variant, BenchProject, stackBytes, (double)z, 0);
+        }
+    }
+    // min, max, mean and median Z projections in one pass and with four separate projections, and all the statistics
+    if ((BENCH_SELECTED ("ProjectMulti")) && (z * benchPtr->pointBytes >= (CountInt)(PROJECT_STAT_NUM * sizeof (double)))){
+        ProjectMultiThreadParams mp = {waveType, benchPtr->stackPtr, benchPtr->outPutPtr, 2, PROJECT_STAT_MIN | PROJECT_STAT_MAX | PROJECT_STAT_MEAN | PROJECT_STAT_MEDIAN, x, y, z};
+        benchPtr->projectMultiParams = mp;
+        BenchRun (benchPtr, "ProjectMulti", "multi min+max+mean+median", BenchProjectMulti, stackBytes, (double)z, 0);
+        ProjectThreadParams pp = {waveType, benchPtr->stackPtr, benchPtr->outPutPtr, 2, 0, x, y, z, 0, z - 1};
+        benchPtr->projectParams = pp;
+        BenchRun (benchPtr, "ProjectMulti", "separate min+max+avg+median", BenchProjectSeparate, stackBytes, (double)z, 0);
+        benchPtr->projectMultiParams.statMask = (1 << PROJECT_STAT_NUM) - 1;
+        BenchRun (benchPtr, "ProjectMulti", "multi all", BenchProjectMulti, stackBytes, (double)z, 0);
+        benchPtr->projectMultiParams.statMask = PROJECT_STAT_MIN | PROJECT_STAT_MAX | PROJECT_STAT_MEAN | PROJECT_STAT_STD;
+        BenchRun (benchPtr, "ProjectMulti", "multi min+max+mean+std", BenchProjectMulti, stackBytes, (double)z, 0);
+    }
+    // maximum Z projection with the layer of each maximum, compared to the maximum alone and to ProjectMulti, which was the
+    // way to get both in one call before. The layers go in the output buffer after room for two frames of doubles
+    if ((BENCH_SELECTED ("ProjectDepth")) && (z * benchPtr->pointBytes >= (CountInt)(2 * (sizeof (double) + sizeof (SInt32))))){
+        ProjectDepthThreadParams dp = {waveType, benchPtr->stackPtr, benchPtr->outPutPtr, (SInt32*)(benchPtr->outPutPtr + 2 * frameSize * sizeof (double)), 1, x, y, z};
+        benchPtr->projectDepthParams = dp;
+        BenchRun (benchPtr, "ProjectDepth", "depth max+argMax", BenchProjectDepth, stackBytes, (double)z, 0);
+        benchPtr->projectDepthParams.projMode = 2;
+        BenchRun (benchPtr, "ProjectDepth", "depth max+min+args", BenchProjectDepth, stackBytes, (double)z, 0);
+        ProjectThreadParams pp = {waveType, benchPtr->stackPtr, benchPtr->outPutPtr, 2, 1, x, y, z, 0, z - 1};
+        benchPtr->projectParams = pp;
+        BenchRun (benchPtr, "ProjectDepth", "max only", BenchProject, stackBytes, (double)z, 0);
+        ProjectMultiThreadParams mp = {waveType, benchPtr->stackPtr, benchPtr->outPutPtr, 2, PROJECT_STAT_MAX | PROJECT_STAT_ARGMAX, x, y, z};
+        benchPtr->projectMultiParams = mp;
+        BenchRun (benchPtr, "ProjectDepth", "multi max+argMax", BenchProjectMulti, stackBytes, (double)z, 0);
+    }
+    if (BENCH_SELECTED ("ProjectZSlice")){
+        ProjectThreadParams pp = {waveType, benchPtr->stackPtr, benchPtr->outPutPtr, 2, 0, x, y, z, 0, 0};
+        benchPtr->projectParams = pp;
+        BenchRun (benchPtr, "ProjectZSlice", "perFrame", BenchProjectZSlice, stackBytes, (double)z, 0);
+    }
+    // gaussian convolutions into a new wave of the same type
+    if (BENCH_SELECTED ("ConvolveFrames")){
+        for (int iWidth = 0; iWidth < 2; iWidth++){
+            UInt16 kWidth = convolveWidths [iWidth];
+            BenchMakeKernel (benchPtr->kernelPtr, kWidth, kWidth);
+            benchPtr->kernelTablePtr = ConvolveMakeKernelTable (benchPtr->kernelPtr, kWidth, kWidth);
+            ConvolveFramesThreadParams cp = {waveType, benchPtr->stackPtr, benchPtr->outPutPtr, benchPtr->bufferPtr, x, y, z, benchPtr->kernelPtr, benchPtr->kernelTablePtr, kWidth, kWidth, 0};
+            benchPtr->convolveParams = cp;
+            snprintf (variant, sizeof (variant), "w=%d", kWidth);
+            BenchRun (benchPtr, "ConvolveFrames", variant, BenchConvolve, stackBytes, (double)z, 0);
+            WMDisposePtr ((Ptr)benchPtr->kernelTablePtr);
+        }
+    }
+    if (BENCH_SELECTED ("SymConvolveFrames")){
+        for (int iWidth = 0; iWidth < 2; iWidth++){
+            UInt16 kWidth = symConvolveWidths [iWidth];
+            BenchMakeKernel (benchPtr->kernelPtr, kWidth, 1);
+            benchPtr->kernelTablePtr = SymConvolveMakeKernelTable (benchPtr->kernelPtr, kWidth);
+            ConvolveFramesThreadParams cp = {waveType, benchPtr->stackPtr, benchPtr->outPutPtr, benchPtr->bufferPtr, x, y, z, benchPtr->kernelPtr, benchPtr->kernelTablePtr, kWidth, 1, 0};
+            benchPtr->convolveParams = cp;
+            snprintf (variant, sizeof (variant), "w=%d", kWidth);
+            BenchRun (benchPtr, "SymConvolveFrames", variant, BenchSymConvolve, stackBytes, (double)z, 0);
+            WMDisposePtr ((Ptr)benchPtr->kernelTablePtr);
+        }
+    }
+    if (BENCH_SELECTED ("MedianFrames")){
+        MedianFramesThreadParams mp = {waveType, benchPtr->stackPtr, benchPtr->outPutPtr, benchPtr->bufferPtr, x, y, z, 5};
+        benchPtr->medianParams = mp;
+        BenchRun (benchPtr, "MedianFrames", "w=5", BenchMedian, stackBytes, (double)z, 0);
+    }
+    // LSM utilities work in place, so the stack is restored before each rep
+    if (BENCH_SELECTED ("SwapEven")){
+        SwapEvenThreadParams sp = {waveType, benchPtr->stackPtr, y * z, x};
+        benchPtr->swapEvenParams = sp;
+        BenchRun (benchPtr, "SwapEven", "", BenchSwapEven, stackBytes, (double)z, 1);
+    }
+    if (BENCH_SELECTED ("DownSample")){
+        for (UInt8 DSType = 1; DSType <= 4; DSType++){
+            DownSampleThreadParams dp = {waveType, benchPtr->stackPtr, benchPtr->outPutPtr, frameSize * z, 4, DSType};
+            benchPtr->downSampleParams = dp;
+            BenchRun (benchPtr, "DownSample", dsNames [DSType - 1], BenchDownSample, stackBytes, (double)z, 1);
+        }
+    }
+    if (BENCH_SELECTED ("TransposeFrames")){
+        TransposeFramesThreadParams tp = {waveType, benchPtr->stackPtr, benchPtr->bufferPtr, x, y, z};
+        benchPtr->transposeParams = tp;
+        BenchRun (benchPtr, "TransposeFrames", (x == y) ? "square" : "", BenchTranspose, stackBytes, (double)z, 1);
+    }
+    // post-processing of a stack with 4 stages, in one pass and one stage after another
+    if ((BENCH_SELECTED ("Pipeline")) && ((x % 4) == 0)){
+        PipelineThreadParamsPtr pp = &benchPtr->pipelineParams;
+        memset (pp, 0, sizeof (PipelineThreadParams));
+        pp->inPutWaveType = waveType;
+        pp->dataStartPtr = benchPtr->stackPtr;
+        pp->xSize = x;
+        pp->ySize = y;
+        pp->zSize = z;
+        pp->doDecumulate = 1;
+        pp->maxCount = (benchPtr->pointBytes == 1) ? 127 : ((benchPtr->pointBytes == 2) ? 32767 : 16777215);
+        pp->doSwapEven = 1;
+        pp->DSType = 1;
+        pp->boxFactor = 4;
+        pp->doKalman = 1;
+        pp->multiplier = 1;
+        BenchRun (benchPtr, "Pipeline", "fused", BenchPipelineFused, stackBytes, (double)z, 1);
+        BenchRun (benchPtr, "Pipeline", "separate", BenchPipelineSeparate, stackBytes, (double)z, 1);
+    }
+    #undef BENCH_SELECTED
+}
+
+/* ------------------------------------- multi-caller stress test ------------------------------------ */
+
+// kernels run by the stress test, which are those most often run from Igor preemptive threads
+static const char* gStressKernels [4] = {"Kalman", "ProjectZ", "MedianFrames", "ConvolveFrames"};
+
+/* Sets up the paramaters for a stress test kernel on a caller's own context, returning its run function
+ Last Modified 2026/10/16 */
+static BenchRunFunc BenchStressSetup (BenchContextPtr benchPtr, int iKernel){
+    CountInt x = benchPtr->shape.xSize, y = benchPtr->shape.ySize, z = benchPtr->shape.zSize;
+    int waveType = benchPtr->type.waveType;
+    switch (iKernel){
+        case 0:{
+            KalmanThreadParams kp = {waveType, benchPtr->stackPtr, benchPtr->outPutPtr, 0, 0, x, y, z, 1, 1, 16};
+            benchPtr->kalmanParams = kp;
+            return BenchKalman;
+        }
+        case 1:{
+            ProjectThreadParams pp = {waveType, benchPtr->stackPtr, benchPtr->outPutPtr, 2, 2, x, y, z, 0, z - 1};
+            benchPtr->projectParams = pp;
+            return BenchProject;
+        }
+        case 2:{
+            MedianFramesThreadParams mp = {waveType, benchPtr->stackPtr, benchPtr->outPutPtr, benchPtr->bufferPtr, x, y, z, 5};
+            benchPtr->medianParams = mp;
+            return BenchMedian;
+        }
+        default:{
+            BenchMakeKernel (benchPtr->kernelPtr, 5, 5);
+            ConvolveFramesThreadParams cp = {waveType, benchPtr->stackPtr, benchPtr->outPutPtr, benchPtr->bufferPtr, x, y, z, benchPtr->kernelPtr, benchPtr->kernelTablePtr, 5, 5, 0};
+            benchPtr->convolveParams = cp;
+            return BenchConvolve;
+        }
+    }
+}
+
+/* Runs a stress test kernel from nCallers threads at once, each on its own stack, doing reps calls each after an
+ untimed warm up call, and prints a line of results
+ Last Modified 2026/10/16 */
+static int BenchStress (BenchShape shape, BenchType type, int iKernel, UInt32 nCallers, UInt32 reps, UInt8 governorOn){
+    std::vector<BenchContext> contexts (nCallers);
+    std::vector<BenchRunFunc> runFuncs (nCallers);
+    std::vector<double> callSecs (nCallers, 0);
+    std::vector<std::thread> callers;
+    std::atomic<UInt32> nReady (0);
+    std::atomic<UInt8> go (0);
+    CountInt frameSize = shape.xSize * shape.ySize;
+    CountInt nPnts = frameSize * shape.zSize;
+    UInt32 iCaller, nThreads = ThreadPoolNumThreads ();
+    int result = 0;
+    char variant [64];
+    for (iCaller = 0; iCaller < nCallers; iCaller++){
+        BenchContextPtr benchPtr = &contexts [iCaller];
+        memset (benchPtr, 0, sizeof (BenchContext));
+        benchPtr->shape = shape;
+        benchPtr->type = type;
+        benchPtr->pointBytes = DownSamplePointBytes (type.waveType);
+        benchPtr->nThreads = nThreads;
+        benchPtr->reps = reps;
+        benchPtr->stackPtr = (char*)WMNewPtr (nPnts * benchPtr->pointBytes);
+        benchPtr->originalPtr = (char*)WMNewPtr (nPnts * benchPtr->pointBytes);
+        benchPtr->outPutPtr = (char*)WMNewPtr (nPnts * benchPtr->pointBytes);
+        benchPtr->bufferPtr = (char*)WMNewPtr (frameSize * nThreads * benchPtr->pointBytes);
+        benchPtr->kernelPtr = (float*)WMNewPtr (5 * 5 * sizeof (float));
+        if ((benchPtr->stackPtr == NULL) || (benchPtr->originalPtr == NULL) || (benchPtr->outPutPtr == NULL) || (benchPtr->bufferPtr == NULL) || (benchPtr->kernelPtr == NULL)){
+            result = 1;
+            continue;
+        }
+        BenchFill (benchPtr);
+        if (iKernel == 3){
+            BenchMakeKernel (benchPtr->kernelPtr, 5, 5);
+            benchPtr->kernelTablePtr = ConvolveMakeKernelTable (benchPtr->kernelPtr, 5, 5);
+        }
+        runFuncs [iCaller] = BenchStressSetup (benchPtr, iKernel);
+    }
+    if (result == 0){
+        gNumProcessors = nThreads;
+        ThreadPoolSetGovernor (governorOn);
+        for (iCaller = 0; iCaller < nCallers; iCaller++){
+            callers.push_back (std::thread ([&, iCaller](){
+                BenchContextPtr benchPtr = &contexts [iCaller];
+                runFuncs [iCaller](benchPtr);    // warm up
+                nReady++;
+                while (go == 0) std::this_thread::yield ();
+                for (UInt32 iRep = 0; iRep < reps; iRep++){
+                    std::chrono::steady_clock::time_point callStart = std::chrono::steady_clock::now ();
+                    runFuncs [iCaller](benchPtr);
+                    callSecs [iCaller] += std::chrono::duration<double>(std::chrono::steady_clock::now () - callStart).count ();
+                }
+            }));
+        }
+        while (nReady < nCallers) std::this_thread::yield ();
+        std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now ();
+        go = 1;
+        for (iCaller = 0; iCaller < nCallers; iCaller++) callers [iCaller].join ();
+        double wallSecs = std::chrono::duration<double>(std::chrono::steady_clock::now () - startTime).count ();
+        double meanCallSecs = 0;
+        for (iCaller = 0; iCaller < nCallers; iCaller++) meanCallSecs += callSecs [iCaller];
+        meanCallSecs /= (double)nCallers * reps;
+        double totalRuns = (double)nCallers * reps;
+        snprintf (variant, sizeof (variant), "callers=%u governor=%s", nCallers, governorOn ? "on" : "off");
+        printf ("%s,%s,%s,%ld,%ld,%ld,%u,%u,%.6f,%.6f,%.3f,%.1f\n", gStressKernels [iKernel], variant, type.typeName,
+                (long)shape.xSize, (long)shape.ySize, (long)shape.zSize, nThreads, reps, wallSecs, meanCallSecs,
+                totalRuns * nPnts * contexts [0].pointBytes/wallSecs/1e9, totalRuns * shape.zSize/wallSecs);
+        fflush (stdout);
+        ThreadPoolSetGovernor (1);
+    }else{
+        fprintf (stderr, "Not enough memory for %u callers with %ldx%ldx%ld stacks\n", nCallers, (long)shape.xSize, (long)shape.ySize, (long)shape.zSize);
+    }
+    for (iCaller = 0; iCaller < nCallers; iCaller++){
+        BenchContextPtr benchPtr = &contexts [iCaller];
+        if (benchPtr->stackPtr != NULL) WMDisposePtr (benchPtr->stackPtr);
+        if (benchPtr->originalPtr != NULL) WMDisposePtr (benchPtr->originalPtr);
+        if (benchPtr->outPutPtr != NULL) WMDisposePtr (benchPtr->outPutPtr);
+        if (benchPtr->bufferPtr != NULL) WMDisposePtr (benchPtr->bufferPtr);
+        if (benchPtr->kernelPtr != NULL) WMDisposePtr ((Ptr)benchPtr->kernelPtr);
+        if (benchPtr->kernelTablePtr != NULL) WMDisposePtr ((Ptr)benchPtr->kernelTablePtr);
+    }
+    return result;
+}
+
+/* Splits a comma separated list into its items
+ Last Modified 2026/10/16 */
+static std::vector<std::string> BenchSplit (const char* list){
+    std::vector<std::string> items;
+    std::string item;
+    for (const char* c = list; ; c++){
+        if ((*c == ',') || (*c == 0)){
+            if (!item.empty ()) items.push_back (item);
+            item.clear ();
+            if (*c == 0) break;
+        }else{
+            item += *c;
+        }
+    }
+    return items;
+}
+
+static void BenchUsage (void){
+    fprintf (stderr, "usage: kernelBench [-shapes 1000x500x30,512x512x64] [-types u16,f32] [-threads 1,2,4] [-reps 3] [-kernels Kalman,ProjectZ] [-callers 1,2,4] [-quick]\n");
+    fprintf (stderr, "types are i8,u8,i16,u16,i32,u32,f32,f64. kernels are Kalman,KalmanSIMD,KalmanBlock,KalmanNext,KalmanList,KalmanGroup,KalmanInterleaved,KalmanSliding,KalmanStats,KalmanRobust,TriggeredAverage,ProjectX,ProjectY,ProjectZ,ProjectZSlice,ProjectMulti,ProjectDepth,\n");
+    fprintf (stderr, "ConvolveFrames,SymConvolveFrames,MedianFrames,SwapEven,DownSample,TransposeFrames,Pipeline\n");
+}
+
+int main (int argc, char* argv[]){
+    std::vector<BenchShape> shapes;
+    std::vector<BenchType> types;
+    std::vector<UInt32> threadCounts;
+    std::vector<UInt32> callerCounts;
+    std::string kernelList;
+    UInt32 reps = 3, maxThreads = 1;
+    UInt8 quick = 0;
+    UInt32 nProcessors = CPUTopologyNumThreads (CPU_CAP_NONE);
+    for (int iArg = 1; iArg < argc; iArg++){
+        std::string arg = argv [iArg];
+        if (arg == "-quick"){
+            quick = 1;
+        }else if ((iArg + 1 < argc) && (arg == "-shapes")){
+            std::vector<std::string> items = BenchSplit (argv [++iArg]);
+            for (size_t iItem = 0; iItem < items.size (); iItem++){
+                long x, y, z;
+                if ((sscanf (items [iItem].c_str (), "%ldx%ldx%ld", &x, &y, &z) != 3) || (x < 2) || (y < 2) || (z < 1)){
+                    fprintf (stderr, "bad shape %s\n", items [iItem].c_str ());
+                    return 1;
+                }
+                BenchShape shape = {x, y, z};
+                shapes.push_back (shape);
+            }
+        }else if ((iArg + 1 < argc) && (arg == "-types")){
+            std::vector<std::string> items = BenchSplit (argv [++iArg]);
+            for (size_t iItem = 0; iItem < items.size (); iItem++){
+                int iType;
+                for (iType = 0; (iType < 8) && (items [iItem] != gBenchTypes [iType].typeName); iType++);
+                if (iType == 8){
+                    fprintf (stderr, "bad type %s\n", items [iItem].c_str ());
+                    return 1;
+                }
+                types.push_back (gBenchTypes [iType]);
+            }
+        }else if ((iArg + 1 < argc) && (arg == "-threads")){
+            std::vector<std::string> items = BenchSplit (argv [++iArg]);
+            for (size_t iItem = 0; iItem < items.size (); iItem++){
+                int nThreads = atoi (items [iItem].c_str ());
+                if ((nThreads < 1) || (nThreads > 255)){
+                    fprintf (stderr, "bad thread count %s\n", items [iItem].c_str ());
+                    return 1;
+                }
+                threadCounts.push_back ((UInt32)nThreads);
+            }
+        }else if ((iArg + 1 < argc) && (arg == "-callers")){
+            std::vector<std::string> items = BenchSplit (argv [++iArg]);
+            for (size_t iItem = 0; iItem < items.size (); iItem++){
+                int nCallers = atoi (items [iItem].c_str ());
+                if ((nCallers < 1) || (nCallers > 256)){
+                    fprintf (stderr, "bad caller count %s\n", items [iItem].c_str ());
+                    return 1;
+                }
+                callerCounts.push_back ((UInt32)nCallers);
+            }
+        }else if ((iArg + 1 < argc) && (arg == "-reps")){
+            reps = (UInt32)atoi (argv [++iArg]);
+            if (reps < 1) reps = 1;
+        }else if ((iArg + 1 < argc) && (arg == "-kernels")){
+            kernelList = argv [++iArg];
+        }else{
+            BenchUsage ();
+            return 1;
+        }
+    }
+    // defaults: wide frames like the stack in twoPhotonXOPtests.ipf, square frames, and many small frames
+    if (shapes.empty ()){
+        if (quick){
+            BenchShape shape = {64, 48, 8};
+            shapes.push_back (shape);
+        }else{
+            BenchShape defaultShapes [3] = {{1000, 500, 30}, {512, 512, 64}, {128, 128, 1024}};
+            shapes.assign (defaultShapes, defaultShapes + 3);
+        }
+    }
+    if (types.empty ()){
+        if (quick){
+            types.push_back (gBenchTypes [3]);
+            types.push_back (gBenchTypes [6]);
+        }else{
+            types.assign (gBenchTypes, gBenchTypes + 8);
+        }
+    }
+    // default thread counts are 1, 2, 4... up to the number of processors, and the number of processors
+    if (threadCounts.empty ()){
+        for (UInt32 nThreads = 1; nThreads < nProcessors; nThreads *= 2) threadCounts.push_back (nThreads);
+        threadCounts.push_back (nProcessors);
+        if (quick) threadCounts.resize (threadCounts.size () > 1 ? 2 : 1);
+    }
+    // default caller counts for the stress test are 1, 2, 4... up to twice the number of processors
+    if (callerCounts.empty ()){
+        for (UInt32 nCallers = 1; nCallers <= 2 * nProcessors; nCallers *= 2) callerCounts.push_back (nCallers);
+        if (callerCounts.back () < 2 * nProcessors) callerCounts.push_back (2 * nProcessors);
+        if (quick) callerCounts.resize (2);
+    }
+    if (quick) reps = 1;
+    for (size_t iCount = 0; iCount < threadCounts.size (); iCount++){
+        if (threadCounts [iCount] > maxThreads) maxThreads = threadCounts [iCount];
+    }
+    if (ThreadPoolStart (maxThreads) != 0){
+        fprintf (stderr, "Could not start thread pool with %u threads\n", maxThreads);
+        return 1;
+    }
+    printf ("kernel,variant,type,xSize,ySize,zSize,threads,reps,bestSecs,meanSecs,GBperSec,framesPerSec\n");
+    int result = 0;
+    for (size_t iShape = 0; (iShape < shapes.size ()) && (result == 0); iShape++){
+        BenchContext bench;
+        memset (&bench, 0, sizeof (BenchContext));
+        bench.shape = shapes [iShape];
+        bench.reps = reps;
+        CountInt frameSize = bench.shape.xSize * bench.shape.ySize;
+        CountInt nPnts = frameSize * bench.shape.zSize;
+        // buffers are made big enough for the biggest points of the types asked for, and re-used for each type
+        CountInt maxPointBytes = 1;
+        for (size_t iType = 0; iType < types.size (); iType++){
+            if (DownSamplePointBytes (types [iType].waveType) > maxPointBytes) maxPointBytes = DownSamplePointBytes (types [iType].waveType);
+        }
+        bench.stackPtr = (char*)WMNewPtr (nPnts * maxPointBytes);
+        bench.originalPtr = (char*)WMNewPtr (nPnts * maxPointBytes);
+        bench.outPutPtr = (char*)WMNewPtr (nPnts * maxPointBytes);
+        bench.bufferPtr = (char*)WMNewPtr (frameSize * maxThreads * maxPointBytes);
+        bench.kernelPtr = (float*)WMNewPtr (23 * 23 * sizeof (float));
+        if ((bench.stackPtr == NULL) || (bench.originalPtr == NULL) || (bench.outPutPtr == NULL) || (bench.bufferPtr == NULL) || (bench.kernelPtr == NULL)){
+            fprintf (stderr, "Not enough memory for %ldx%ldx%ld stack\n", (long)bench.shape.xSize, (long)bench.shape.ySize, (long)bench.shape.zSize);
+            result = 1;
+        }else{
+            for (size_t iType = 0; iType < types.size (); iType++){
+                bench.type = types [iType];
+                bench.pointBytes = DownSamplePointBytes (bench.type.waveType);
+                BenchFill (&bench);
+                for (size_t iCount = 0; iCount < threadCounts.size (); iCount++){
+                    bench.nThreads = threadCounts [iCount];
+                    BenchRestore (&bench);
+                    BenchAllKernels (&bench, kernelList);
+                }
+            }
+        }
+        WMDisposePtr (bench.stackPtr);
+        WMDisposePtr (bench.originalPtr);
+        WMDisposePtr (bench.outPutPtr);
+        WMDisposePtr (bench.bufferPtr);
+        WMDisposePtr ((Ptr)bench.kernelPtr);
+    }
+    // stress test on the first shape and type, with the pool at its largest
+    for (int iKernel = 0; (iKernel < 4) && (result == 0); iKernel++){
+        if ((!kernelList.empty ()) && (("," + kernelList + ",").find (std::string (",") + gStressKernels [iKernel] + ",") == std::string::npos)) continue;
+        for (size_t iCount = 0; (iCount < callerCounts.size ()) && (result == 0); iCount++){
+            for (UInt8 governorOn = 0; (governorOn < 2) && (result == 0); governorOn++){
+                result = BenchStress (shapes [0], types [0], iKernel, callerCounts [iCount], reps, governorOn);
+            }
+        }
+    }
+    ThreadPoolStop ();
+    return result;
+}
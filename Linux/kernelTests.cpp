@@ -0,0 +1,1670 @@
+/*
+    kernelTests.cpp -- regression tests for the twoPhoton compute kernels, built with the headless kernel library
+    against the Igor shim. Each test makes waves with the shim, runs a kernel on the thread pool just as the XFUNC
+    would, and checks the results against a plain single-threaded reference. Run by ctest, returns the number of
+    tests that failed
+    Last Modified 2026/10/16
+*/
+#include "../twoPhotonKernels.h"
+#include <algorithm>
+#include <vector>
+#include <limits>
+#include <thread>
+#include <new>
+#include <chrono>
+#include <sched.h>
+#include <sys/stat.h>
+
+static int gFailures = 0;
+
+/* Prints a line for each check, and counts failures
+ Last Modified 2026/10/16 */
+static void check (const char* testName, int passed){
+    printf ("%-48s %s\n", testName, passed ? "ok" : "FAILED");
+    if (!passed) gFailures++;
+}
+
+/* Makes a wave of the given type and dimensions with the shim, and returns a pointer to the start of its data
+ Last Modified 2026/10/16 */
+static char* makeTestWave (waveHndl* waveHPtr, int waveType, CountInt xSize, CountInt ySize, CountInt zSize){
+    CountInt dimensionSizes[MAX_DIMENSIONS+1] = {xSize, ySize, zSize, 0, 0};
+    BCInt dataOffset;
+    if (MDMakeWave (waveHPtr, "test", NULL, dimensionSizes, waveType, 1) != 0) return NULL;
+    if (MDAccessNumericWaveData (*waveHPtr, kMDWaveAccessMode0, &dataOffset) != 0) return NULL;
+    return (char*)(**waveHPtr) + dataOffset;
+}
+
+/* Fills data with repeatable pseudo-random values from 0 to maxVal
+ Last Modified 2026/10/16 */
+template <typename T> void fillRandomT (T* dataPtr, CountInt nPnts, UInt32 maxVal, UInt32 seed){
+    for (CountInt iPnt = 0; iPnt < nPnts; iPnt++){
+        seed = seed * 1664525u + 1013904223u;
+        dataPtr [iPnt] = (T)((seed >> 8) % (maxVal + 1));
+    }
+}
+
+/* ------------------------------------------------Kalman---------------------------------------------------*/
+
+/* Kalman averages all the layers of a 3D wave into a separate output frame
+ Last Modified 2026/10/16 */
+static void testKalman (void){
+    const CountInt xSize = 131, ySize = 97, zSize = 7, frameSize = xSize * ySize;
+    waveHndl inH, outH;
+    // float wave with multiplier < 1 is a straight average
+    float* fIn = (float*)makeTestWave (&inH, NT_FP32, xSize, ySize, zSize);
+    float* fOut = (float*)makeTestWave (&outH, NT_FP32, xSize, ySize, 0);
+    fillRandomT (fIn, frameSize * zSize, 4095, 1);
+    KalmanThreadParams params = {NT_FP32, (char*)fIn, (char*)fOut, 0, 0, xSize, ySize, zSize, 1, 1, 0};
+    KalmanRunTiles (&params);
+    int passed = 1;
+    for (CountInt iPix = 0; iPix < frameSize && passed; iPix++){
+        double sum = 0;
+        for (CountInt iLayer = 0; iLayer < zSize; iLayer++) sum += fIn [iLayer * frameSize + iPix];
+        passed = (fabs (fOut [iPix] - sum/zSize) < 1e-3);
+    }
+    check ("Kalman NT_FP32 average", passed);
+    KillWave (inH);
+    KillWave (outH);
+    // 32 bit int wave with no multiplier is a running average, as done one layer at a time in Igor
+    SInt32* iIn = (SInt32*)makeTestWave (&inH, NT_I32, xSize, ySize, zSize);
+    SInt32* iOut = (SInt32*)makeTestWave (&outH, NT_I32, xSize, ySize, 0);
+    fillRandomT (iIn, frameSize * zSize, 1000000, 2);
+    params.inPutWaveType = NT_I32;
+    params.inPutDataStartPtr = (char*)iIn;
+    params.outPutDataStartPtr = (char*)iOut;
+    params.multiplier = 1;
+    KalmanRunTiles (&params);
+    passed = 1;
+    for (CountInt iPix = 0; iPix < frameSize && passed; iPix++){
+        SInt32 expected = iIn [iPix];
+        for (CountInt iLayer = 1; iLayer < zSize; iLayer++)
+            expected = ((expected * iLayer) + iIn [iLayer * frameSize + iPix])/(iLayer + 1);
+        passed = (iOut [iPix] == expected);
+    }
+    check ("Kalman NT_I32 running average", passed);
+    KillWave (inH);
+    KillWave (outH);
+}
+
+/* Runs Kalman over a stack of one type with the scalar loops and with the SIMD loops of one level, and returns non-zero
+ if the outputs are the same, bit for bit. Values are from 0 to maxVal, times scale, minus offset, so signed types get
+ negative values and 32 bit types get values bigger than 2^24. The frame size is not a multiple of 4, so the points left
+ over after the SIMD loops are done as well. inPlace collapses the stack into its first frame
+ Last Modified 2026/10/16 */
+template <typename T> int KalmanSIMDMatchT (int waveType, UInt32 maxVal, double scale, double offset, float multiplier, UInt8 inPlace, UInt8 level){
+    const CountInt xSize = 131, ySize = 97, zSize = 9, frameSize = xSize * ySize;
+    waveHndl inH, outH;
+    T* inPtr = (T*)makeTestWave (&inH, waveType, xSize, ySize, zSize);
+    T* outPtr = (T*)makeTestWave (&outH, waveType, xSize, ySize, 0);
+    fillRandomT (inPtr, frameSize * zSize, maxVal, 6);
+    for (CountInt iPnt = 0; iPnt < frameSize * zSize; iPnt++) inPtr [iPnt] = (T)(inPtr [iPnt] * scale - offset);
+    std::vector<T> original (inPtr, inPtr + frameSize * zSize);
+    std::vector<T> scalarOut (frameSize);
+    UInt8 savedLevel = gSIMDLevel;
+    KalmanThreadParams params = {waveType, (char*)inPtr, inPlace ? (char*)inPtr : (char*)outPtr, 0, 0, xSize, ySize, zSize, 1, 1, multiplier};
+    gSIMDLevel = CPU_SIMD_NONE;
+    KalmanRunTiles (&params);
+    memcpy (scalarOut.data (), inPlace ? inPtr : outPtr, frameSize * sizeof (T));
+    memcpy (inPtr, original.data (), frameSize * zSize * sizeof (T));
+    gSIMDLevel = level;
+    KalmanRunTiles (&params);
+    gSIMDLevel = savedLevel;
+    int passed = (memcmp (scalarOut.data (), inPlace ? inPtr : outPtr, frameSize * sizeof (T)) == 0);
+    KillWave (inH);
+    KillWave (outH);
+    return passed;
+}
+
+/* The SSE4.1 and AVX2 loops of Kalman give the same output as the scalar loops for every wave type, with and without a
+ multiplier, for each level this CPU has
+ Last Modified 2026/10/16 */
+static void testKalmanSIMD (void){
+    const char* levelNames [3] = {"scalar", "SSE4.1", "AVX2"};
+    char testName [64];
+    UInt8 maxLevel = CPUTopologySIMDLevel ();
+    for (UInt8 level = CPU_SIMD_SSE41; level <= maxLevel; level++){
+        for (int iMult = 0; iMult < 2; iMult++){
+            float multiplier = iMult ? 16 : 1;
+            // with a multiplier, integer points must fit in their type after being multiplied
+            int passed = KalmanSIMDMatchT<char> (NT_I8, iMult ? 14 : 255, 1, iMult ? 7 : 128, multiplier, 0, level);
+            passed &= KalmanSIMDMatchT<unsigned char> (NT_I8 | NT_UNSIGNED, iMult ? 15 : 255, 1, 0, multiplier, 0, level);
+            passed &= KalmanSIMDMatchT<short> (NT_I16, iMult ? 4095 : 65535, 1, iMult ? 2048 : 32768, multiplier, 0, level);
+            passed &= KalmanSIMDMatchT<unsigned short> (NT_I16 | NT_UNSIGNED, iMult ? 4095 : 65535, 1, 0, multiplier, 1, level);
+            passed &= KalmanSIMDMatchT<SInt32> (NT_I32, 16777215, iMult ? 8 : 255, iMult ? 6.7e7 : 2.1e9, multiplier, 0, level);
+            passed &= KalmanSIMDMatchT<UInt32> (NT_I32 | NT_UNSIGNED, 16777215, iMult ? 8 : 255, 0, multiplier, 1, level);
+            passed &= KalmanSIMDMatchT<float> (NT_FP32, 16777215, 0.37, 1e6, multiplier, 0, level);
+            passed &= KalmanSIMDMatchT<double> (NT_FP64, 16777215, 0.37, 1e6, multiplier, 1, level);
+            snprintf (testName, 64, "Kalman %s matches scalar, multiplier %d", levelNames [level], (int)multiplier);
+            check (testName, passed);
+        }
+    }
+}
+
+/* Runs Kalman over a stack of one type taking whole tiles through the layers, and in blocks of blockBytes, and returns
+ non-zero if the outputs are the same, bit for bit. inPlace collapses the stack into its first frame
+ Last Modified 2026/10/16 */
+template <typename T> int KalmanBlockMatchT (int waveType, float multiplier, UInt8 inPlace, CountInt blockBytes){
+    const CountInt xSize = 131, ySize = 97, zSize = 9, frameSize = xSize * ySize;
+    waveHndl inH, outH;
+    T* inPtr = (T*)makeTestWave (&inH, waveType, xSize, ySize, zSize);
+    T* outPtr = (T*)makeTestWave (&outH, waveType, xSize, ySize, 0);
+    fillRandomT (inPtr, frameSize * zSize, 4095, 8);
+    std::vector<T> original (inPtr, inPtr + frameSize * zSize);
+    std::vector<T> tileOut (frameSize);
+    CountInt savedBlockBytes = gKalmanBlockBytes;
+    KalmanThreadParams params = {waveType, (char*)inPtr, inPlace ? (char*)inPtr : (char*)outPtr, 0, 0, xSize, ySize, zSize, 1, 1, multiplier};
+    gKalmanBlockBytes = 0;
+    KalmanRunTiles (&params);
+    memcpy (tileOut.data (), inPlace ? inPtr : outPtr, frameSize * sizeof (T));
+    memcpy (inPtr, original.data (), frameSize * zSize * sizeof (T));
+    gKalmanBlockBytes = blockBytes;
+    KalmanRunTiles (&params);
+    gKalmanBlockBytes = savedBlockBytes;
+    int passed = (memcmp (tileOut.data (), inPlace ? inPtr : outPtr, frameSize * sizeof (T)) == 0);
+    KillWave (inH);
+    KillWave (outH);
+    return passed;
+}
+
+/* Kalman in blocks that are not a whole number of points or SIMD vectors, and do not divide the tiles evenly, gives
+ the same output as taking whole tiles through the layers, for a straight average, a running average, and a running
+ average with a multiplier, in place or not
+ Last Modified 2026/10/16 */
+static void testKalmanBlocks (void){
+    int passed = 1;
+    for (int iMult = 0; iMult < 3; iMult++){
+        float multiplier = (iMult == 0) ? 0 : ((iMult == 1) ? 1 : 16);
+        passed &= KalmanBlockMatchT<unsigned char> (NT_I8 | NT_UNSIGNED, (iMult == 2) ? 1 : multiplier, 1, 1001);
+        passed &= KalmanBlockMatchT<unsigned short> (NT_I16 | NT_UNSIGNED, multiplier, 1, 1001);
+        passed &= KalmanBlockMatchT<SInt32> (NT_I32, multiplier, 0, 1001);
+        passed &= KalmanBlockMatchT<float> (NT_FP32, multiplier, 0, 1001);
+        passed &= KalmanBlockMatchT<double> (NT_FP64, multiplier, 1, 1001);
+    }
+    check ("Kalman in blocks matches whole tiles", passed);
+}
+
+/* Runs exact Kalman averaging over a stack of one type, and returns non-zero if every point is the sum of its layers
+ divided once, rounded to nearest with halves away from zero for integer types. Values are from 0 to maxVal, times
+ scale, minus offset. inPlace collapses the stack into its first frame
+ Last Modified 2026/10/16 */
+template <typename T> int KalmanExactMatchT (int waveType, CountInt xSize, CountInt ySize, CountInt zSize, UInt32 maxVal, double scale, double offset, UInt8 inPlace){
+    const CountInt frameSize = xSize * ySize;
+    const bool isInteger = std::numeric_limits<T>::is_integer;
+    waveHndl inH, outH;
+    T* inPtr = (T*)makeTestWave (&inH, waveType, xSize, ySize, zSize);
+    T* outPtr = (T*)makeTestWave (&outH, waveType, xSize, ySize, 0);
+    fillRandomT (inPtr, frameSize * zSize, maxVal, 7);
+    for (CountInt iPnt = 0; iPnt < frameSize * zSize; iPnt++) inPtr [iPnt] = (T)(inPtr [iPnt] * scale - offset);
+    std::vector<T> expected (frameSize);
+    for (CountInt iPix = 0; iPix < frameSize; iPix++){
+        SInt64 intSum = 0;
+        double floatSum = 0;
+        for (CountInt iLayer = 0; iLayer < zSize; iLayer++){
+            intSum += (SInt64)inPtr [iLayer * frameSize + iPix];
+            floatSum += inPtr [iLayer * frameSize + iPix];
+        }
+        if (isInteger){
+            expected [iPix] = (T)((intSum < 0) ? (intSum - zSize/2)/zSize : (intSum + zSize/2)/zSize);
+        }else{
+            expected [iPix] = (T)(floatSum/zSize);
+        }
+    }
+    KalmanThreadParams params = {waveType, (char*)inPtr, inPlace ? (char*)inPtr : (char*)outPtr, 0, 0, xSize, ySize, zSize, 1, 1, 16, 1};
+    int passed = (KalmanRunTiles (&params) == 0);
+    passed &= (memcmp (expected.data (), inPlace ? inPtr : outPtr, frameSize * sizeof (T)) == 0);
+    KillWave (inH);
+    KillWave (outH);
+    return passed;
+}
+
+/* Exact averaging sums the layers in accumulators that can not overflow, for every wave type, so 32 bit sums of big
+ 32 bit points, and sums of more than KALMAN_EXACT_I32_LAYERS layers of 16 bit points, are still right. The frame is
+ not a whole number of blocks, and rounding is to nearest
+ Last Modified 2026/10/16 */
+static void testKalmanExact (void){
+    int passed = KalmanExactMatchT<char> (NT_I8, 131, 97, 10, 255, 1, 128, 0);
+    passed &= KalmanExactMatchT<unsigned char> (NT_I8 | NT_UNSIGNED, 131, 97, 10, 255, 1, 0, 1);
+    passed &= KalmanExactMatchT<short> (NT_I16, 131, 97, 10, 65535, 1, 32768, 0);
+    passed &= KalmanExactMatchT<unsigned short> (NT_I16 | NT_UNSIGNED, 131, 97, 10, 65535, 1, 0, 1);
+    check ("Kalman exact 8 and 16 bit", passed);
+    passed = KalmanExactMatchT<SInt32> (NT_I32, 131, 97, 10, 16777215, 255, 2.1e9, 0);
+    passed &= KalmanExactMatchT<UInt32> (NT_I32 | NT_UNSIGNED, 131, 97, 10, 16777215, 255, 0, 1);
+    check ("Kalman exact 32 bit", passed);
+    passed = KalmanExactMatchT<float> (NT_FP32, 131, 97, 10, 16777215, 0.37, 1e6, 0);
+    passed &= KalmanExactMatchT<double> (NT_FP64, 131, 97, 10, 16777215, 0.37, 1e6, 1);
+    check ("Kalman exact floating point", passed);
+    passed = KalmanExactMatchT<unsigned short> (NT_I16 | NT_UNSIGNED, 7, 5, 2 * KALMAN_EXACT_I32_LAYERS + 1, 1023, 1, -64512, 0);
+    check ("Kalman exact, 16 bit sums past 32 bits", passed);
+}
+
+/* Adds the layers of a stack to an average with one KalmanNext call, and returns non-zero if the result is the same as
+ adding them one at a time, with 64 bit sums for integer waves, starting from an average of iKal waves. With a weight,
+ checks an exponential average, rounded to nearest for integer waves
+ Last Modified 2026/10/16 */
+template <typename T> int KalmanNextMatchT (int waveType, CountInt zSize, CountInt iKal, double weight){
+    const CountInt xSize = 131, ySize = 97, frameSize = xSize * ySize;
+    const bool isInteger = std::numeric_limits<T>::is_integer;
+    waveHndl inH, outH;
+    T* inPtr = (T*)makeTestWave (&inH, waveType, xSize, ySize, zSize);
+    T* outPtr = (T*)makeTestWave (&outH, waveType, xSize, ySize, 0);
+    fillRandomT (inPtr, frameSize * zSize, 4095, 17);
+    fillRandomT (outPtr, frameSize, 4095, 19);
+    std::vector<T> expected (outPtr, outPtr + frameSize);
+    for (CountInt iLayer = 0; iLayer < zSize; iLayer++){
+        CountInt nAveraged = iKal + iLayer;
+        for (CountInt iPix = 0; iPix < frameSize; iPix++){
+            T newVal = inPtr [iLayer * frameSize + iPix];
+            if (nAveraged == 0){
+                expected [iPix] = newVal;
+            }else if (weight > 0){
+                double average = expected [iPix] * (1 - weight) + newVal * weight;
+                expected [iPix] = (T)(isInteger ? ((average < 0) ? -floor (0.5 - average) : floor (average + 0.5)) : average);
+            }else if (isInteger){
+                expected [iPix] = (T)(((SInt64)expected [iPix] * nAveraged + (SInt64)newVal)/(nAveraged + 1));
+            }else{
+                expected [iPix] = (T)((expected [iPix] * nAveraged + newVal)/(nAveraged + 1));
+            }
+        }
+    }
+    KalmanNextThreadParams params = {waveType, (char*)inPtr, (char*)outPtr, frameSize, iKal, zSize, weight};
+    ThreadPoolRunTiles (KalmanNextTile, &params, frameSize, ThreadPoolTileSize (frameSize, KALMAN_MIN_TILE), gNumProcessors);
+    int passed = (memcmp (expected.data (), outPtr, frameSize * sizeof (T)) == 0);
+    KillWave (inH);
+    KillWave (outH);
+    return passed;
+}
+
+/* KalmanNext with a block of new frames, starting a new average and adding to an old one, with counts that do not fit
+ in 16 bits, and as an exponential average
+ Last Modified 2026/10/16 */
+static void testKalmanNext (void){
+    int passed = KalmanNextMatchT<unsigned short> (NT_I16 | NT_UNSIGNED, 1, 3, 0);
+    passed &= KalmanNextMatchT<unsigned short> (NT_I16 | NT_UNSIGNED, 9, 0, 0);
+    passed &= KalmanNextMatchT<char> (NT_I8, 9, 5, 0);
+    passed &= KalmanNextMatchT<SInt32> (NT_I32, 9, 5, 0);
+    passed &= KalmanNextMatchT<float> (NT_FP32, 9, 0, 0);
+    passed &= KalmanNextMatchT<double> (NT_FP64, 9, 5, 0);
+    check ("KalmanNext, block of frames", passed);
+    passed = KalmanNextMatchT<unsigned short> (NT_I16 | NT_UNSIGNED, 9, 65530, 0);
+    passed &= KalmanNextMatchT<UInt32> (NT_I32 | NT_UNSIGNED, 9, 70000, 0);
+    check ("KalmanNext, counts past 16 bits", passed);
+    passed = KalmanNextMatchT<unsigned short> (NT_I16 | NT_UNSIGNED, 9, 5, 0.25);
+    passed &= KalmanNextMatchT<short> (NT_I16, 9, 0, 0.1);
+    passed &= KalmanNextMatchT<float> (NT_FP32, 9, 5, 0.25);
+    check ("KalmanNext, exponential average", passed);
+}
+
+/* Bins a stack of one type into groups of nFrames layers with a single KalmanRunTiles, into a new wave or in place, and
+ returns non-zero if the output is the same, byte for byte, as averaging each group with its own call, as done before
+ with KalmanSpecFrames
+ Last Modified 2026/10/16 */
+template <typename T> int KalmanGroupMatchT (int waveType, CountInt zSize, CountInt nFrames, float multiplier, UInt8 exact, UInt8 inPlace){
+    const CountInt xSize = 131, ySize = 97, frameSize = xSize * ySize;
+    const CountInt nGroups = zSize/nFrames;
+    waveHndl inH, outH, expectedH;
+    T* inPtr = (T*)makeTestWave (&inH, waveType, xSize, ySize, zSize);
+    T* outPtr = (T*)makeTestWave (&outH, waveType, xSize, ySize, nGroups);
+    T* expectedPtr = (T*)makeTestWave (&expectedH, waveType, xSize, ySize, nGroups);
+    fillRandomT (inPtr, frameSize * zSize, 4095, 13);
+    KalmanThreadParams params = {waveType, (char*)inPtr, (char*)expectedPtr, 0, 0, xSize, ySize, nFrames, 1, 1, multiplier, exact};
+    int passed = 1;
+    for (CountInt iGroup = 0; iGroup < nGroups; iGroup++){
+        params.startLayer = iGroup * nFrames;
+        params.outPutLayer = iGroup;
+        passed &= (KalmanRunTiles (&params) == 0);
+    }
+    params.startLayer = params.outPutLayer = 0;
+    params.nGroups = nGroups;
+    params.outPutDataStartPtr = inPlace ? (char*)inPtr : (char*)outPtr;
+    passed &= (KalmanRunTiles (&params) == 0);
+    passed &= (memcmp (expectedPtr, inPlace ? inPtr : outPtr, frameSize * nGroups * sizeof (T)) == 0);
+    KillWave (inH);
+    KillWave (outH);
+    KillWave (expectedH);
+    return passed;
+}
+
+/* Binning with KalmanGroupFrames, with running averages, multipliers and exact averaging, in place and not, for stacks
+ with layers left over, and for groups of 1 layer and of the whole stack
+ Last Modified 2026/10/16 */
+static void testKalmanGroups (void){
+    int passed = KalmanGroupMatchT<unsigned short> (NT_I16 | NT_UNSIGNED, 23, 4, 1, 0, 0);
+    passed &= KalmanGroupMatchT<unsigned short> (NT_I16 | NT_UNSIGNED, 23, 4, 16, 0, 1);
+    passed &= KalmanGroupMatchT<unsigned char> (NT_I8 | NT_UNSIGNED, 24, 3, 0, 0, 1);
+    passed &= KalmanGroupMatchT<SInt32> (NT_I32, 24, 5, 1, 0, 1);
+    passed &= KalmanGroupMatchT<float> (NT_FP32, 24, 6, 0, 0, 0);
+    passed &= KalmanGroupMatchT<double> (NT_FP64, 23, 2, 1, 0, 1);
+    check ("Kalman groups, running average", passed);
+    passed = KalmanGroupMatchT<short> (NT_I16, 23, 4, 1, 1, 1);
+    passed &= KalmanGroupMatchT<UInt32> (NT_I32 | NT_UNSIGNED, 23, 7, 1, 1, 0);
+    passed &= KalmanGroupMatchT<float> (NT_FP32, 24, 8, 1, 1, 1);
+    check ("Kalman groups, exact", passed);
+    passed = KalmanGroupMatchT<unsigned short> (NT_I16 | NT_UNSIGNED, 9, 1, 16, 0, 1);
+    passed &= KalmanGroupMatchT<unsigned short> (NT_I16 | NT_UNSIGNED, 9, 9, 16, 0, 1);
+    passed &= KalmanGroupMatchT<unsigned short> (NT_I16 | NT_UNSIGNED, 9, 1, 1, 1, 1);
+    check ("Kalman groups, 1 and all layers", passed);
+}
+
+/* Averages a stack of one type with nChannels channels interleaved layer by layer, in groups of nFrames layers of
+ each channel, with a single KalmanRunTiles, into a new wave or in place, and returns non-zero if each output layer is
+ the same, byte for byte, as copying each channel into its own stack and binning that, as done before in Igor
+ Last Modified 2026/10/16 */
+template <typename T> int KalmanInterleavedMatchT (int waveType, CountInt zSize, CountInt nChannels, CountInt nFrames, float multiplier, UInt8 exact, UInt8 inPlace){
+    const CountInt xSize = 131, ySize = 97, frameSize = xSize * ySize;
+    const CountInt nGroups = zSize/(nFrames * nChannels);
+    waveHndl inH, outH, channelH, expectedH;
+    T* inPtr = (T*)makeTestWave (&inH, waveType, xSize, ySize, zSize);
+    T* outPtr = (T*)makeTestWave (&outH, waveType, xSize, ySize, nGroups * nChannels);
+    T* channelPtr = (T*)makeTestWave (&channelH, waveType, xSize, ySize, nGroups * nFrames);
+    T* expectedPtr = (T*)makeTestWave (&expectedH, waveType, xSize, ySize, nGroups * nChannels);
+    fillRandomT (inPtr, frameSize * zSize, 4095, 17);
+    KalmanThreadParams params = {waveType, (char*)channelPtr, (char*)channelPtr, 0, 0, xSize, ySize, nFrames, nGroups, 1, multiplier, exact};
+    int passed = 1;
+    for (CountInt iChannel = 0; iChannel < nChannels; iChannel++){
+        for (CountInt iLayer = 0; iLayer < nGroups * nFrames; iLayer++){
+            memcpy (channelPtr + iLayer * frameSize, inPtr + (iLayer * nChannels + iChannel) * frameSize, frameSize * sizeof (T));
+        }
+        passed &= (KalmanRunTiles (&params) == 0);
+        for (CountInt iGroup = 0; iGroup < nGroups; iGroup++){
+            memcpy (expectedPtr + (iGroup * nChannels + iChannel) * frameSize, channelPtr + iGroup * frameSize, frameSize * sizeof (T));
+        }
+    }
+    params.inPutDataStartPtr = (char*)inPtr;
+    params.outPutDataStartPtr = inPlace ? (char*)inPtr : (char*)outPtr;
+    params.nChannels = nChannels;
+    passed &= (KalmanRunTiles (&params) == 0);
+    passed &= (memcmp (expectedPtr, inPlace ? inPtr : outPtr, frameSize * nGroups * nChannels * sizeof (T)) == 0);
+    KillWave (inH);
+    KillWave (outH);
+    KillWave (channelH);
+    KillWave (expectedH);
+    return passed;
+}
+
+/* Interleaved channels averaged over the whole stack and in groups, with left over layers, with and without a
+ multiplier and exact averaging, and in place, and a single channel, which is the same as KalmanGroupFrames
+ Last Modified 2026/10/16 */
+static void testKalmanInterleaved (void){
+    int passed = KalmanInterleavedMatchT<unsigned short> (NT_I16 | NT_UNSIGNED, 40, 2, 20, 16, 0, 0);
+    passed &= KalmanInterleavedMatchT<unsigned char> (NT_I8 | NT_UNSIGNED, 41, 3, 13, 1, 0, 0);
+    passed &= KalmanInterleavedMatchT<SInt32> (NT_I32, 40, 4, 10, 16, 1, 0);
+    passed &= KalmanInterleavedMatchT<float> (NT_FP32, 40, 2, 20, 0, 0, 0);
+    check ("Kalman interleaved channels, all layers", passed);
+    passed = KalmanInterleavedMatchT<short> (NT_I16, 50, 2, 4, 16, 0, 0);
+    passed &= KalmanInterleavedMatchT<double> (NT_FP64, 50, 3, 4, 1, 1, 0);
+    passed &= KalmanInterleavedMatchT<unsigned short> (NT_I16 | NT_UNSIGNED, 50, 2, 5, 16, 0, 1);
+    passed &= KalmanInterleavedMatchT<unsigned short> (NT_I16 | NT_UNSIGNED, 50, 2, 5, 1, 1, 1);
+    passed &= KalmanInterleavedMatchT<unsigned short> (NT_I16 | NT_UNSIGNED, 50, 1, 7, 16, 0, 1);
+    passed &= KalmanInterleavedMatchT<UInt32> (NT_I32 | NT_UNSIGNED, 50, 5, 1, 16, 0, 1);
+    check ("Kalman interleaved channels, groups and in place", passed);
+}
+
+/* Runs a moving average over a stack of one type, and returns non-zero if every output layer is the sum of the layers
+ in its window, clipped to the stack, divided once and rounded as for exact averaging. Floating point points are
+ allowed a small error, as adding and taking off layers from double sums may not give the same rounding as summing
+ each window afresh
+ Last Modified 2026/10/16 */
+template <typename T> int KalmanSlidingMatchT (int waveType, CountInt zSize, CountInt nWindow, UInt8 sameSize, UInt32 maxVal, double scale, double offset){
+    const CountInt xSize = 131, ySize = 97, frameSize = xSize * ySize;
+    const CountInt outZSize = sameSize ? zSize : zSize - nWindow + 1;
+    const CountInt windowOffset = sameSize ? (nWindow - 1)/2 : 0;
+    const bool isInteger = std::numeric_limits<T>::is_integer;
+    waveHndl inH, outH;
+    T* inPtr = (T*)makeTestWave (&inH, waveType, xSize, ySize, zSize);
+    T* outPtr = (T*)makeTestWave (&outH, waveType, xSize, ySize, outZSize);
+    fillRandomT (inPtr, frameSize * zSize, maxVal, 11);
+    for (CountInt iPnt = 0; iPnt < frameSize * zSize; iPnt++) inPtr [iPnt] = (T)(inPtr [iPnt] * scale - offset);
+    KalmanSlidingThreadParams params = {waveType, (char*)inPtr, (char*)outPtr, xSize, ySize, zSize, outZSize, nWindow, windowOffset, nullptr};
+    int passed = (KalmanSlidingRunTiles (&params) == 0);
+    for (CountInt outLayer = 0; outLayer < outZSize && passed; outLayer++){
+        CountInt firstLayer = std::max (outLayer - windowOffset, (CountInt)0);
+        CountInt lastLayer = std::min (outLayer - windowOffset + nWindow - 1, zSize - 1);
+        CountInt numLayers = lastLayer - firstLayer + 1;
+        for (CountInt iPix = 0; iPix < frameSize && passed; iPix++){
+            SInt64 intSum = 0;
+            double floatSum = 0;
+            for (CountInt iLayer = firstLayer; iLayer <= lastLayer; iLayer++){
+                intSum += (SInt64)inPtr [iLayer * frameSize + iPix];
+                floatSum += inPtr [iLayer * frameSize + iPix];
+            }
+            T result = outPtr [outLayer * frameSize + iPix];
+            if (isInteger){
+                passed = (result == (T)((intSum < 0) ? (intSum - numLayers/2)/numLayers : (intSum + numLayers/2)/numLayers));
+            }else{
+                passed = (fabs (result - floatSum/numLayers) <= 1e-6 * fabs (floatSum/numLayers));
+            }
+        }
+    }
+    KillWave (inH);
+    KillWave (outH);
+    return passed;
+}
+
+/* Moving averages with windows wholly inside the stack, and with as many output layers as input layers, for odd and
+ even windows, windows of 1 layer and of the whole stack, and sums that need 64 bits
+ Last Modified 2026/10/16 */
+static void testKalmanSliding (void){
+    int passed = KalmanSlidingMatchT<unsigned char> (NT_I8 | NT_UNSIGNED, 20, 5, 0, 255, 1, 0);
+    passed &= KalmanSlidingMatchT<short> (NT_I16, 20, 4, 0, 65535, 1, 32768);
+    passed &= KalmanSlidingMatchT<UInt32> (NT_I32 | NT_UNSIGNED, 20, 7, 0, 16777215, 255, 0);
+    passed &= KalmanSlidingMatchT<float> (NT_FP32, 20, 6, 0, 16777215, 0.37, 1e6);
+    check ("Kalman sliding window, whole windows", passed);
+    passed = KalmanSlidingMatchT<char> (NT_I8, 20, 5, 1, 255, 1, 128);
+    passed &= KalmanSlidingMatchT<unsigned short> (NT_I16 | NT_UNSIGNED, 20, 8, 1, 65535, 1, 0);
+    passed &= KalmanSlidingMatchT<SInt32> (NT_I32, 20, 9, 1, 16777215, 255, 2.1e9);
+    passed &= KalmanSlidingMatchT<double> (NT_FP64, 20, 20, 1, 16777215, 0.37, 1e6);
+    check ("Kalman sliding window, same size", passed);
+    passed = KalmanSlidingMatchT<unsigned short> (NT_I16 | NT_UNSIGNED, 9, 1, 0, 65535, 1, 0);
+    passed &= KalmanSlidingMatchT<unsigned short> (NT_I16 | NT_UNSIGNED, 9, 9, 0, 65535, 1, 0);
+    passed &= KalmanSlidingMatchT<unsigned short> (NT_I16 | NT_UNSIGNED, 9, 1, 1, 65535, 1, 0);
+    check ("Kalman sliding window, 1 and all layers", passed);
+}
+
+/* Runs KalmanStats over a stack of one type, and returns non-zero if the mean, sample variance and standard deviation
+ of each point match a two-pass reference in long doubles, to a relative error allowed for the type of the output, and
+ the minimum and maximum match exactly
+ Last Modified 2026/10/16 */
+template <typename T, typename O> int KalmanStatsMatchT (int waveType, CountInt zSize, UInt8 doMinMax, UInt32 maxVal, double scale, double offset){
+    const CountInt xSize = 131, ySize = 97, frameSize = xSize * ySize;
+    const double tolerance = (sizeof (O) == 4) ? 1e-5 : 1e-9;
+    waveHndl inH, outH;
+    T* inPtr = (T*)makeTestWave (&inH, waveType, xSize, ySize, zSize);
+    O* outPtr = (O*)makeTestWave (&outH, KalmanStatsOutPutType (waveType), xSize, ySize, doMinMax ? 5 : 3);
+    fillRandomT (inPtr, frameSize * zSize, maxVal, 13);
+    for (CountInt iPnt = 0; iPnt < frameSize * zSize; iPnt++) inPtr [iPnt] = (T)(inPtr [iPnt] * scale - offset);
+    KalmanStatsThreadParams params = {waveType, (char*)inPtr, (char*)outPtr, xSize, ySize, zSize, doMinMax, nullptr};
+    int passed = (KalmanStatsRunTiles (&params) == 0);
+    for (CountInt iPix = 0; iPix < frameSize && passed; iPix++){
+        long double sum = 0, m2 = 0, diff;
+        T minVal = inPtr [iPix], maxVal = inPtr [iPix];
+        for (CountInt iLayer = 0; iLayer < zSize; iLayer++){
+            sum += inPtr [iLayer * frameSize + iPix];
+            minVal = std::min (minVal, inPtr [iLayer * frameSize + iPix]);
+            maxVal = std::max (maxVal, inPtr [iLayer * frameSize + iPix]);
+        }
+        long double mean = sum/zSize;
+        for (CountInt iLayer = 0; iLayer < zSize; iLayer++){
+            diff = inPtr [iLayer * frameSize + iPix] - mean;
+            m2 += diff * diff;
+        }
+        double variance = (zSize > 1) ? (double)(m2/(zSize - 1)) : 0;
+        passed = (fabs (outPtr [iPix] - (double)mean) <= tolerance * (fabs ((double)mean) + sqrt (variance) + 1));
+        passed &= (fabs (outPtr [frameSize + iPix] - variance) <= tolerance * (variance + 1));
+        passed &= (fabs (outPtr [2 * frameSize + iPix] - sqrt (variance)) <= tolerance * (sqrt (variance) + 1));
+        if (doMinMax){
+            passed &= (outPtr [3 * frameSize + iPix] == (O)minVal) && (outPtr [4 * frameSize + iPix] == (O)maxVal);
+        }
+    }
+    KillWave (inH);
+    KillWave (outH);
+    return passed;
+}
+
+/* Per-point statistics for each type, for one layer, for more layers than a chunk, so chunks are merged, and for
+ floating point data with a large offset, where summing squares without a shift would lose the variance
+ Last Modified 2026/10/16 */
+static void testKalmanStats (void){
+    int passed = KalmanStatsMatchT<char, float> (NT_I8, 20, 1, 255, 1, 128);
+    passed &= KalmanStatsMatchT<unsigned char, float> (NT_I8 | NT_UNSIGNED, 20, 1, 255, 1, 0);
+    passed &= KalmanStatsMatchT<short, float> (NT_I16, 20, 1, 65535, 1, 32768);
+    passed &= KalmanStatsMatchT<unsigned short, float> (NT_I16 | NT_UNSIGNED, 20, 0, 65535, 1, 0);
+    passed &= KalmanStatsMatchT<SInt32, double> (NT_I32, 20, 1, 16777215, 255, 2.1e9);
+    passed &= KalmanStatsMatchT<UInt32, double> (NT_I32 | NT_UNSIGNED, 20, 0, 16777215, 255, 0);
+    passed &= KalmanStatsMatchT<float, float> (NT_FP32, 20, 1, 16777215, 0.37, 0);
+    passed &= KalmanStatsMatchT<double, double> (NT_FP64, 20, 1, 16777215, 0.37, 0);
+    check ("Kalman stats, each type", passed);
+    passed = KalmanStatsMatchT<unsigned short, float> (NT_I16 | NT_UNSIGNED, 1, 1, 65535, 1, 0);
+    passed &= KalmanStatsMatchT<unsigned short, float> (NT_I16 | NT_UNSIGNED, 2 * KALMAN_STATS_CHUNK + 37, 1, 65535, 1, 0);
+    passed &= KalmanStatsMatchT<double, double> (NT_FP64, KALMAN_STATS_CHUNK + 1, 0, 4095, 1e-3, -1e9);
+    passed &= KalmanStatsMatchT<float, float> (NT_FP32, 40, 1, 4095, 1, -1e5);
+    check ("Kalman stats, 1 layer, merged chunks, large offset", passed);
+}
+
+/* Reference robust average of one column, sorting a copy of the column for Winsorizing and trimming, and clipping
+ with the same sums, in the same order, as the kernel for sigma clipping, but stopping when the set of kept points,
+ not just their number and sum, is the same as for the last clip
+ Last Modified 2026/10/16 */
+static double KalmanRobustReference (std::vector<double> column, UInt8 mode, double threshold){
+    CountInt n = column.size (), iPnt;
+    double mean = 0, sum, sumSq, lower = -HUGE_VAL, upper = HUGE_VAL;
+    if (mode == KALMAN_ROBUST_SIGMA){
+        CountInt nKept;
+        std::vector<bool> kept (n), lastKept;
+        for (int iter = 0; ; iter++){
+            sum = 0;
+            nKept = 0;
+            for (iPnt = 0; iPnt < n; iPnt++){
+                kept [iPnt] = ((column [iPnt] >= lower) && (column [iPnt] <= upper));
+                if (kept [iPnt]){
+                    sum += column [iPnt];
+                    nKept++;
+                }
+            }
+            if (nKept == 0) break;
+            mean = sum/nKept;
+            if ((kept == lastKept) || (iter == KALMAN_ROBUST_MAX_ITER)) break;
+            lastKept = kept;
+            sumSq = 0;
+            for (iPnt = 0; iPnt < n; iPnt++){
+                if ((column [iPnt] >= lower) && (column [iPnt] <= upper)) sumSq += (column [iPnt] - mean) * (column [iPnt] - mean);
+            }
+            lower = mean - threshold * sqrt (sumSq/nKept);
+            upper = mean + threshold * sqrt (sumSq/nKept);
+        }
+        return mean;
+    }
+    CountInt nCut = (CountInt)(threshold * n);
+    std::sort (column.begin (), column.end ());
+    for (iPnt = 0, sum = 0; iPnt < n; iPnt++){
+        if (mode == KALMAN_ROBUST_WINSOR){
+            sum += column [std::min (std::max (iPnt, nCut), n - 1 - nCut)];
+        }else if ((iPnt >= nCut) && (iPnt < n - nCut)){
+            sum += column [iPnt];
+        }
+    }
+    return (mode == KALMAN_ROBUST_WINSOR) ? sum/n : sum/(n - 2 * nCut);
+}
+
+/* Runs a robust average over a stack of one type, with spikes added to some layers, and returns non-zero if every
+ point matches the reference, rounded to nearest for integer types, or to a small relative error for floating point
+ types, where the kernel adds the kept points in a different order
+ Last Modified 2026/10/16 */
+template <typename T> int KalmanRobustMatchT (int waveType, CountInt zSize, UInt8 mode, double threshold, UInt32 maxVal){
+    const CountInt xSize = 131, ySize = 97, frameSize = xSize * ySize;
+    const bool isInteger = std::numeric_limits<T>::is_integer;
+    waveHndl inH, outH;
+    T* inPtr = (T*)makeTestWave (&inH, waveType, xSize, ySize, zSize);
+    T* outPtr = (T*)makeTestWave (&outH, waveType, xSize, ySize, 0);
+    fillRandomT (inPtr, frameSize * zSize, maxVal, 19);
+    // a spike at every 7th point of every 5th layer
+    for (CountInt iLayer = 2; iLayer < zSize; iLayer += 5){
+        for (CountInt iPix = iLayer % 7; iPix < frameSize; iPix += 7) inPtr [iLayer * frameSize + iPix] = (T)(maxVal * 4);
+    }
+    KalmanRobustThreadParams params = {waveType, (char*)inPtr, (char*)outPtr, xSize, ySize, zSize, mode, threshold, 0, nullptr};
+    int passed = (KalmanRobustRunTiles (&params) == 0);
+    std::vector<double> column (zSize);
+    for (CountInt iPix = 0; iPix < frameSize && passed; iPix++){
+        for (CountInt iLayer = 0; iLayer < zSize; iLayer++) column [iLayer] = inPtr [iLayer * frameSize + iPix];
+        double expected = KalmanRobustReference (column, mode, threshold);
+        if (isInteger){
+            passed = (outPtr [iPix] == (T)(expected + ((expected < 0) ? -0.5 : 0.5)));
+        }else{
+            passed = (fabs (outPtr [iPix] - expected) <= 1e-6 * fabs (expected));
+        }
+    }
+    KillWave (inH);
+    KillWave (outH);
+    return passed;
+}
+
+/* Sigma clipping, Winsorizing and trimming, for each type, for one layer and for more layers than fit a minimum block in
+ the block bytes, and a check that the spikes are taken out: a clipped or trimmed mean of a flat stack with spikes is
+ the flat value
+ Last Modified 2026/10/16 */
+static void testKalmanRobust (void){
+    int passed = KalmanRobustMatchT<char> (NT_I8, 30, KALMAN_ROBUST_SIGMA, 3, 31);
+    passed &= KalmanRobustMatchT<unsigned char> (NT_I8 | NT_UNSIGNED, 30, KALMAN_ROBUST_SIGMA, 2.5, 63);
+    passed &= KalmanRobustMatchT<short> (NT_I16, 30, KALMAN_ROBUST_SIGMA, 3, 4095);
+    passed &= KalmanRobustMatchT<unsigned short> (NT_I16 | NT_UNSIGNED, 30, KALMAN_ROBUST_SIGMA, 2, 4095);
+    passed &= KalmanRobustMatchT<SInt32> (NT_I32, 30, KALMAN_ROBUST_SIGMA, 3, 65535);
+    passed &= KalmanRobustMatchT<UInt32> (NT_I32 | NT_UNSIGNED, 30, KALMAN_ROBUST_SIGMA, 3, 65535);
+    passed &= KalmanRobustMatchT<float> (NT_FP32, 30, KALMAN_ROBUST_SIGMA, 3, 4095);
+    passed &= KalmanRobustMatchT<double> (NT_FP64, 30, KALMAN_ROBUST_SIGMA, 0.5, 4095);
+    check ("Kalman robust, sigma clipped", passed);
+    passed = KalmanRobustMatchT<unsigned char> (NT_I8 | NT_UNSIGNED, 30, KALMAN_ROBUST_WINSOR, 0.1, 63);
+    passed &= KalmanRobustMatchT<short> (NT_I16, 31, KALMAN_ROBUST_WINSOR, 0.2, 4095);
+    passed &= KalmanRobustMatchT<UInt32> (NT_I32 | NT_UNSIGNED, 30, KALMAN_ROBUST_WINSOR, 0.45, 65535);
+    passed &= KalmanRobustMatchT<float> (NT_FP32, 30, KALMAN_ROBUST_WINSOR, 0.1, 4095);
+    passed &= KalmanRobustMatchT<char> (NT_I8, 30, KALMAN_ROBUST_TRIM, 0.1, 31);
+    passed &= KalmanRobustMatchT<unsigned short> (NT_I16 | NT_UNSIGNED, 31, KALMAN_ROBUST_TRIM, 0.2, 4095);
+    passed &= KalmanRobustMatchT<SInt32> (NT_I32, 30, KALMAN_ROBUST_TRIM, 0.49, 65535);
+    passed &= KalmanRobustMatchT<double> (NT_FP64, 30, KALMAN_ROBUST_TRIM, 0, 4095);
+    check ("Kalman robust, Winsorized and trimmed", passed);
+    passed = KalmanRobustMatchT<unsigned short> (NT_I16 | NT_UNSIGNED, 1, KALMAN_ROBUST_SIGMA, 3, 4095);
+    passed &= KalmanRobustMatchT<unsigned short> (NT_I16 | NT_UNSIGNED, 1, KALMAN_ROBUST_TRIM, 0.4, 4095);
+    // a small block size, so the columns of a block do not fit and the smallest block is used
+    CountInt savedBlockBytes = gKalmanBlockBytes;
+    gKalmanBlockBytes = 4096;
+    passed &= KalmanRobustMatchT<float> (NT_FP32, 100, KALMAN_ROBUST_SIGMA, 3, 4095);
+    passed &= KalmanRobustMatchT<float> (NT_FP32, 100, KALMAN_ROBUST_WINSOR, 0.25, 4095);
+    // more points cut than are kept in lists, so found with selectT
+    passed &= KalmanRobustMatchT<float> (NT_FP32, 100, KALMAN_ROBUST_WINSOR, 0.4, 4095);
+    passed &= KalmanRobustMatchT<unsigned short> (NT_I16 | NT_UNSIGNED, 100, KALMAN_ROBUST_TRIM, 0.45, 4095);
+    gKalmanBlockBytes = savedBlockBytes;
+    check ("Kalman robust, 1 layer, smallest blocks, long cuts", passed);
+    // a flat stack of 100 with spikes of 60000 in every 5th layer
+    const CountInt xSize = 64, ySize = 32, zSize = 40, frameSize = xSize * ySize;
+    waveHndl inH, outH;
+    unsigned short* inPtr = (unsigned short*)makeTestWave (&inH, NT_I16 | NT_UNSIGNED, xSize, ySize, zSize);
+    unsigned short* outPtr = (unsigned short*)makeTestWave (&outH, NT_I16 | NT_UNSIGNED, xSize, ySize, 0);
+    for (CountInt iPnt = 0; iPnt < frameSize * zSize; iPnt++) inPtr [iPnt] = ((iPnt/frameSize) % 5 == 3) ? 60000 : 100;
+    passed = 1;
+    for (UInt8 mode = KALMAN_ROBUST_SIGMA; mode <= KALMAN_ROBUST_TRIM; mode++){
+        KalmanRobustThreadParams params = {NT_I16 | NT_UNSIGNED, (char*)inPtr, (char*)outPtr, xSize, ySize, zSize, mode, (mode == KALMAN_ROBUST_SIGMA) ? 1.0 : 0.2, 0, nullptr};
+        passed &= (KalmanRobustRunTiles (&params) == 0);
+        for (CountInt iPix = 0; iPix < frameSize; iPix++) passed &= (outPtr [iPix] == 100);
+    }
+    KillWave (inH);
+    KillWave (outH);
+    check ("Kalman robust, spikes taken out", passed);
+    // columns where a clip drops a point at one end and takes one back at the other, keeping the same number of points,
+    // so the mean must be found again after that clip. {1, 1, 25, 19, 0, 28} keeps {1, 1, 19}, then {1, 1, 0}, then
+    // {1, 1}, and {27, 25, 12, 26, 14, 12} keeps {25, 26, 14}, then {27, 25, 26}, then {26}. Short random columns,
+    // clipped at 1 standard deviation, do this often
+    const float columns [2][6] = {{1, 1, 25, 19, 0, 28}, {27, 25, 12, 26, 14, 12}};
+    float* clipInPtr = (float*)makeTestWave (&inH, NT_FP32, 2, 1, 6);
+    float* clipOutPtr = (float*)makeTestWave (&outH, NT_FP32, 2, 1, 0);
+    for (CountInt iLayer = 0; iLayer < 6; iLayer++){
+        clipInPtr [2 * iLayer] = columns [0][iLayer];
+        clipInPtr [2 * iLayer + 1] = columns [1][iLayer];
+    }
+    KalmanRobustThreadParams clipParams = {NT_FP32, (char*)clipInPtr, (char*)clipOutPtr, 2, 1, 6, KALMAN_ROBUST_SIGMA, 1.0, 0, nullptr};
+    passed = (KalmanRobustRunTiles (&clipParams) == 0);
+    passed &= ((clipOutPtr [0] == 1) && (clipOutPtr [1] == 26));
+    passed &= KalmanRobustMatchT<unsigned char> (NT_I8 | NT_UNSIGNED, 6, KALMAN_ROBUST_SIGMA, 1, 31);
+    KillWave (inH);
+    KillWave (outH);
+    check ("Kalman robust, clipped points change on the last clip", passed);
+}
+
+/* Runs a triggered average over a stack of one type, and returns non-zero if each output layer is the sum of the
+ layers at that offset in each window, divided once and rounded as for exact averaging, or to a small relative error
+ for floating point types
+ Last Modified 2026/10/16 */
+template <typename T> int TriggeredAverageMatchT (int waveType, CountInt zSize, std::vector<CountInt> startLayers, CountInt nWindow, UInt32 maxVal, double offset){
+    const CountInt xSize = 131, ySize = 97, frameSize = xSize * ySize;
+    const CountInt nTriggers = startLayers.size ();
+    const bool isInteger = std::numeric_limits<T>::is_integer;
+    waveHndl inH, outH;
+    T* inPtr = (T*)makeTestWave (&inH, waveType, xSize, ySize, zSize);
+    T* outPtr = (T*)makeTestWave (&outH, waveType, xSize, ySize, nWindow);
+    fillRandomT (inPtr, frameSize * zSize, maxVal, 23);
+    for (CountInt iPnt = 0; iPnt < frameSize * zSize; iPnt++) inPtr [iPnt] = (T)(inPtr [iPnt] - offset);
+    TriggeredAverageThreadParams params = {waveType, (char*)inPtr, (char*)outPtr, xSize, ySize, zSize, startLayers.data (), nTriggers, nWindow, nullptr};
+    int passed = (TriggeredAverageRunTiles (&params) == 0);
+    for (CountInt layer = 0; layer < nWindow && passed; layer++){
+        for (CountInt iPix = 0; iPix < frameSize && passed; iPix++){
+            SInt64 intSum = 0;
+            double floatSum = 0;
+            for (CountInt iTrigger = 0; iTrigger < nTriggers; iTrigger++){
+                intSum += (SInt64)inPtr [(startLayers [iTrigger] + layer) * frameSize + iPix];
+                floatSum += inPtr [(startLayers [iTrigger] + layer) * frameSize + iPix];
+            }
+            T result = outPtr [layer * frameSize + iPix];
+            if (isInteger){
+                passed = (result == (T)((intSum < 0) ? (intSum - nTriggers/2)/nTriggers : (intSum + nTriggers/2)/nTriggers));
+            }else{
+                passed = (fabs (result - floatSum/nTriggers) <= 1e-6 * fabs (floatSum/nTriggers));
+            }
+        }
+    }
+    KillWave (inH);
+    KillWave (outH);
+    return passed;
+}
+
+/* Triggered averages for each type, with overlapping windows, a trigger repeated, windows at the start and end of the
+ stack, a single trigger, and a window of one layer
+ Last Modified 2026/10/16 */
+static void testTriggeredAverage (void){
+    std::vector<CountInt> starts = {0, 3, 7, 7, 12, 20, 33};
+    int passed = TriggeredAverageMatchT<char> (NT_I8, 40, starts, 7, 255, 128);
+    passed &= TriggeredAverageMatchT<unsigned char> (NT_I8 | NT_UNSIGNED, 40, starts, 7, 255, 0);
+    passed &= TriggeredAverageMatchT<short> (NT_I16, 40, starts, 7, 65535, 32768);
+    passed &= TriggeredAverageMatchT<unsigned short> (NT_I16 | NT_UNSIGNED, 40, starts, 7, 65535, 0);
+    passed &= TriggeredAverageMatchT<SInt32> (NT_I32, 40, starts, 7, 16777215, 8388608);
+    passed &= TriggeredAverageMatchT<UInt32> (NT_I32 | NT_UNSIGNED, 40, starts, 7, 16777215, 0);
+    passed &= TriggeredAverageMatchT<float> (NT_FP32, 40, starts, 7, 16777215, 0);
+    passed &= TriggeredAverageMatchT<double> (NT_FP64, 40, starts, 7, 16777215, 0);
+    check ("Triggered average, each type", passed);
+    passed = TriggeredAverageMatchT<unsigned short> (NT_I16 | NT_UNSIGNED, 40, {15}, 25, 65535, 0);
+    passed &= TriggeredAverageMatchT<unsigned short> (NT_I16 | NT_UNSIGNED, 40, {0, 39, 5, 5}, 1, 65535, 0);
+    passed &= TriggeredAverageMatchT<unsigned short> (NT_I16 | NT_UNSIGNED, 40, {0}, 40, 65535, 0);
+    check ("Triggered average, one trigger and one layer windows", passed);
+}
+
+/* KalmanList averages a list of waves, here the layers of a 3D wave, in blocks of points. Checks a straight average,
+ a running average, and a running average with a multiplier written over the first wave, with more points than a
+ whole number of blocks
+ Last Modified 2026/10/16 */
+static void testKalmanList (void){
+    const CountInt xSize = 131, ySize = 97, nWaves = 23, nPnts = xSize * ySize;
+    waveHndl inH, outH;
+    Ptr srcStarts [nWaves];
+    // float waves with multiplier < 1 are a straight average
+    float* fIn = (float*)makeTestWave (&inH, NT_FP32, xSize, ySize, nWaves);
+    float* fOut = (float*)makeTestWave (&outH, NT_FP32, xSize, ySize, 0);
+    fillRandomT (fIn, nPnts * nWaves, 4095, 3);
+    for (CountInt iWave = 0; iWave < nWaves; iWave++) srcStarts [iWave] = (Ptr)(fIn + iWave * nPnts);
+    KalmanListThreadParams params = {NT_FP32, srcStarts, (char*)fOut, (UInt16)nWaves, nPnts, 0, nullptr};
+    int passed = (KalmanListRunTiles (&params, gNumProcessors) == 0);
+    for (CountInt iPnt = 0; iPnt < nPnts && passed; iPnt++){
+        double sum = 0;
+        for (CountInt iWave = 0; iWave < nWaves; iWave++) sum += fIn [iWave * nPnts + iPnt];
+        passed = (fabs (fOut [iPnt] - sum/nWaves) < 1e-3);
+    }
+    check ("KalmanList NT_FP32 average", passed);
+    KillWave (inH);
+    KillWave (outH);
+    // 32 bit int waves with no multiplier are a running average
+    SInt32* iIn = (SInt32*)makeTestWave (&inH, NT_I32, xSize, ySize, nWaves);
+    SInt32* iOut = (SInt32*)makeTestWave (&outH, NT_I32, xSize, ySize, 0);
+    fillRandomT (iIn, nPnts * nWaves, 1000000, 4);
+    for (CountInt iWave = 0; iWave < nWaves; iWave++) srcStarts [iWave] = (Ptr)(iIn + iWave * nPnts);
+    params.inPutWaveType = NT_I32;
+    params.outPutDataStartPtr = (char*)iOut;
+    params.multiplier = 1;
+    passed = (KalmanListRunTiles (&params, gNumProcessors) == 0);
+    for (CountInt iPnt = 0; iPnt < nPnts && passed; iPnt++){
+        SInt32 expected = iIn [iPnt];
+        for (CountInt iWave = 1; iWave < nWaves; iWave++)
+            expected = ((expected * iWave) + iIn [iWave * nPnts + iPnt])/(iWave + 1);
+        passed = (iOut [iPnt] == expected);
+    }
+    check ("KalmanList NT_I32 running average", passed);
+    KillWave (inH);
+    KillWave (outH);
+    // 16 bit waves with a multiplier, overwriting the first wave in the list
+    UInt16* uIn = (UInt16*)makeTestWave (&inH, NT_I16 | NT_UNSIGNED, xSize, ySize, nWaves);
+    fillRandomT (uIn, nPnts * nWaves, 4095, 5);
+    std::vector<UInt16> expected (uIn, uIn + nPnts);
+    for (CountInt iPnt = 0; iPnt < nPnts; iPnt++){
+        expected [iPnt] = (UInt16)(expected [iPnt] * 16.0f);
+        for (CountInt iWave = 1; iWave < nWaves; iWave++)
+            expected [iPnt] = ((expected [iPnt] * iWave) + uIn [iWave * nPnts + iPnt] * 16.0f)/(iWave + 1);
+        expected [iPnt] /= 16.0f;
+    }
+    for (CountInt iWave = 0; iWave < nWaves; iWave++) srcStarts [iWave] = (Ptr)(uIn + iWave * nPnts);
+    params.inPutWaveType = NT_I16 | NT_UNSIGNED;
+    params.outPutDataStartPtr = (char*)uIn;
+    params.multiplier = 16;
+    passed = (KalmanListRunTiles (&params, gNumProcessors) == 0);
+    for (CountInt iPnt = 0; iPnt < nPnts && passed; iPnt++) passed = (uIn [iPnt] == expected [iPnt]);
+    check ("KalmanList NT_U16 multiplier over first wave", passed);
+    KillWave (inH);
+}
+
+/* ------------------------------------------------Project---------------------------------------------------*/
+
+/* Makes min, max, average, and median projections along each dimension of a 3D wave
+ Last Modified 2026/10/16 */
+static void testProject (void){
+    const CountInt xSize = 67, ySize = 53, zSize = 41;
+    const CountInt sizes [3] = {xSize, ySize, zSize};
+    const char* modeNames [4] = {"min", "max", "avg", "median"};
+    char testName [64];
+    waveHndl inH, outH;
+    float* inPtr = (float*)makeTestWave (&inH, NT_FP32, xSize, ySize, zSize);
+    fillRandomT (inPtr, xSize * ySize * zSize, 65535, 3);
+    float* outPtr = (float*)makeTestWave (&outH, NT_FP32, xSize * ySize, zSize, 0);
+    std::vector<float> vals;
+    for (UInt8 flatDim = 0; flatDim < 3; flatDim++){
+        // project over all but the first and last points of the flattened dimension
+        CountInt startP = 1, endP = sizes [flatDim] - 2;
+        // the two dimensions that are left, in order
+        CountInt d0 = (flatDim == 0) ? 1 : 0;
+        CountInt d1 = (flatDim == 2) ? 1 : 2;
+        for (UInt8 projMode = 0; projMode < 4; projMode++){
+            ProjectThreadParams params = {NT_FP32, (char*)inPtr, (char*)outPtr, flatDim, projMode, xSize, ySize, zSize, startP, endP};
+            ProjectRunTiles (&params, 0);
+            int passed = 1;
+            for (CountInt i1 = 0; i1 < sizes [d1] && passed; i1++){
+                for (CountInt i0 = 0; i0 < sizes [d0] && passed; i0++){
+                    vals.clear();
+                    CountInt pos [3];
+                    pos [d0] = i0;
+                    pos [d1] = i1;
+                    for (pos [flatDim] = startP; pos [flatDim] <= endP; pos [flatDim]++)
+                        vals.push_back (inPtr [pos [0] + pos [1] * xSize + pos [2] * xSize * ySize]);
+                    double expected;
+                    switch (projMode){
+                        case 0:
+                            expected = *std::min_element (vals.begin(), vals.end());
+                            break;
+                        case 1:
+                            expected = *std::max_element (vals.begin(), vals.end());
+                            break;
+                        case 2:
+                            expected = 0;
+                            for (size_t iVal = 0; iVal < vals.size(); iVal++) expected += vals [iVal];
+                            expected /= vals.size();
+                            break;
+                        default:
+                            std::nth_element (vals.begin(), vals.begin() + vals.size()/2, vals.end());
+                            expected = vals [vals.size()/2];
+                            break;
+                    }
+                    passed = (fabs (outPtr [i0 + i1 * sizes [d0]] - expected) < 1e-2);
+                }
+            }
+            snprintf (testName, 64, "Project %c %s", (char)('X' + flatDim), modeNames [projMode]);
+            check (testName, passed);
+        }
+    }
+    KillWave (inH);
+    KillWave (outH);
+    // in-place Z projections of 16 bit waves write over the first layer of the input, which they stream through in blocks
+    for (UInt8 projMode = 0; projMode < 3; projMode++){
+        UInt16* uIn = (UInt16*)makeTestWave (&inH, NT_I16 | NT_UNSIGNED, xSize, ySize, zSize);
+        fillRandomT (uIn, xSize * ySize * zSize, 65535, 4 + projMode);
+        std::vector<UInt16> expected (xSize * ySize);
+        for (CountInt iPnt = 0; iPnt < xSize * ySize; iPnt++){
+            double temp = uIn [iPnt];
+            UInt16 extreme = uIn [iPnt];
+            for (CountInt iLayer = 1; iLayer < zSize; iLayer++){
+                UInt16 val = uIn [iLayer * xSize * ySize + iPnt];
+                temp += val;
+                if ((projMode == 0) ? (val < extreme) : (val > extreme))
+                    extreme = val;
+            }
+            expected [iPnt] = (projMode == 2) ? (UInt16)(temp/zSize) : extreme;
+        }
+        ProjectThreadParams params = {NT_I16 | NT_UNSIGNED, (char*)uIn, (char*)uIn, 2, projMode, xSize, ySize, zSize, 0, zSize - 1};
+        ProjectRunTiles (&params, 1);
+        int passed = 1;
+        for (CountInt iPnt = 0; iPnt < xSize * ySize && passed; iPnt++) passed = (uIn [iPnt] == expected [iPnt]);
+        snprintf (testName, 64, "Project Z %s NT_U16 in place", modeNames [projMode]);
+        check (testName, passed);
+        KillWave (inH);
+    }
+}
+
+/* Median (projMode 3) or percentile (projMode 4) projections along flatDim of a wave with values from -offset to
+ maxVal - offset, over all but the first and last points of the flattened dimension, match a sort of each column, at
+ n/2 for the median, or the nearest rank to percentile/100 * (n - 1)
+ Last Modified 2026/10/16 */
+template <typename T> int ProjectSelectMatchT (int waveType, CountInt xSize, CountInt ySize, CountInt zSize, UInt8 flatDim, UInt32 maxVal, SInt32 offset, UInt8 projMode, double percentile){
+    const CountInt sizes [3] = {xSize, ySize, zSize};
+    CountInt startP = 1, endP = sizes [flatDim] - 2;
+    CountInt d0 = (flatDim == 0) ? 1 : 0;
+    CountInt d1 = (flatDim == 2) ? 1 : 2;
+    waveHndl inH, outH;
+    T* inPtr = (T*)makeTestWave (&inH, waveType, xSize, ySize, zSize);
+    T* outPtr = (T*)makeTestWave (&outH, waveType, sizes [d0], sizes [d1], 0);
+    fillRandomT (inPtr, xSize * ySize * zSize, maxVal, 11 + flatDim);
+    for (CountInt iPnt = 0; iPnt < xSize * ySize * zSize; iPnt++) inPtr [iPnt] = (T)(inPtr [iPnt] - offset);
+    ProjectThreadParams params = {waveType, (char*)inPtr, (char*)outPtr, flatDim, projMode, xSize, ySize, zSize, startP, endP, percentile};
+    size_t rank = (projMode == 3) ? (endP - startP + 1)/2 : (size_t)floor (percentile * (endP - startP)/100 + 0.5);
+    int passed = (ProjectRunTiles (&params, 0) == 0);
+    std::vector<T> vals;
+    for (CountInt i1 = 0; i1 < sizes [d1] && passed; i1++){
+        for (CountInt i0 = 0; i0 < sizes [d0] && passed; i0++){
+            vals.clear();
+            CountInt pos [3];
+            pos [d0] = i0;
+            pos [d1] = i1;
+            for (pos [flatDim] = startP; pos [flatDim] <= endP; pos [flatDim]++)
+                vals.push_back (inPtr [pos [0] + pos [1] * xSize + pos [2] * xSize * ySize]);
+            std::sort (vals.begin(), vals.end());
+            passed = (outPtr [i0 + i1 * sizes [d0]] == vals [rank]);
+        }
+    }
+    KillWave (inH);
+    KillWave (outH);
+    return passed;
+}
+
+/* Median projections of 8, 16 and 32 bit waves, signed and unsigned, along each dimension, with columns long enough to
+ use histograms, columns too short for them, and columns that are all the same value. 32 bit values span the sign bit,
+ and the top of the unsigned range, so every byte of the keys is refined
+ Last Modified 2026/10/16 */
+static void testProjectMedian (void){
+    char testName [64];
+    for (UInt8 flatDim = 0; flatDim < 3; flatDim++){
+        int passed = ProjectSelectMatchT<unsigned short> (NT_I16 | NT_UNSIGNED, 70, 66, 130, flatDim, 65535, 0, 3, 0);
+        passed &= ProjectSelectMatchT<short> (NT_I16, 70, 66, 130, flatDim, 65535, 32768, 3, 0);
+        passed &= ProjectSelectMatchT<unsigned char> (NT_I8 | NT_UNSIGNED, 70, 66, 130, flatDim, 255, 0, 3, 0);
+        passed &= ProjectSelectMatchT<char> (NT_I8, 70, 66, 130, flatDim, 255, 128, 3, 0);
+        passed &= ProjectSelectMatchT<short> (NT_I16, 70, 66, 130, flatDim, 40, 20, 3, 0);
+        snprintf (testName, 64, "Project %c median histograms", (char)('X' + flatDim));
+        check (testName, passed);
+        passed = ProjectSelectMatchT<SInt32> (NT_I32, 70, 66, 130, flatDim, 16777215, 8388608, 3, 0);
+        passed &= ProjectSelectMatchT<UInt32> (NT_I32 | NT_UNSIGNED, 70, 66, 130, flatDim, 16777215, 16777216, 3, 0);
+        passed &= ProjectSelectMatchT<SInt32> (NT_I32, 70, 66, 130, flatDim, 40, 20, 3, 0);
+        passed &= ProjectSelectMatchT<UInt32> (NT_I32 | NT_UNSIGNED, 12, 13, 14, flatDim, 16777215, 0, 3, 0);
+        snprintf (testName, 64, "Project %c median 32 bit histograms", (char)('X' + flatDim));
+        check (testName, passed);
+        passed = ProjectSelectMatchT<unsigned short> (NT_I16 | NT_UNSIGNED, 12, 13, 14, flatDim, 65535, 0, 3, 0);
+        passed &= ProjectSelectMatchT<char> (NT_I8, 12, 13, 14, flatDim, 255, 128, 3, 0);
+        passed &= ProjectSelectMatchT<unsigned char> (NT_I8 | NT_UNSIGNED, 70, 66, 130, flatDim, 0, 0, 3, 0);
+        snprintf (testName, 64, "Project %c median short columns", (char)('X' + flatDim));
+        check (testName, passed);
+    }
+}
+
+/* Percentile projections along each dimension, with the histograms of integer waves, short columns that are copied, and
+ floating point waves, which are always copied, for the lowest and highest points and percentiles between them
+ Last Modified 2026/10/16 */
+static void testProjectPercentile (void){
+    const double percentiles [5] = {0, 10, 50, 99, 100};
+    char testName [64];
+    for (UInt8 flatDim = 0; flatDim < 3; flatDim++){
+        int passed = 1;
+        for (int iPct = 0; iPct < 5; iPct++){
+            passed &= ProjectSelectMatchT<unsigned short> (NT_I16 | NT_UNSIGNED, 70, 66, 130, flatDim, 65535, 0, 4, percentiles [iPct]);
+            passed &= ProjectSelectMatchT<short> (NT_I16, 70, 66, 130, flatDim, 40, 20, 4, percentiles [iPct]);
+            passed &= ProjectSelectMatchT<char> (NT_I8, 70, 66, 130, flatDim, 255, 128, 4, percentiles [iPct]);
+            passed &= ProjectSelectMatchT<unsigned char> (NT_I8 | NT_UNSIGNED, 12, 13, 14, flatDim, 255, 0, 4, percentiles [iPct]);
+            passed &= ProjectSelectMatchT<SInt32> (NT_I32, 70, 66, 130, flatDim, 16777215, 8388608, 4, percentiles [iPct]);
+            passed &= ProjectSelectMatchT<UInt32> (NT_I32 | NT_UNSIGNED, 70, 66, 130, flatDim, 16777215, 16777216, 4, percentiles [iPct]);
+        }
+        snprintf (testName, 64, "Project %c percentile integer", (char)('X' + flatDim));
+        check (testName, passed);
+        passed = 1;
+        for (int iPct = 0; iPct < 5; iPct++){
+            passed &= ProjectSelectMatchT<float> (NT_FP32, 70, 66, 130, flatDim, 65535, 0, 4, percentiles [iPct]);
+            passed &= ProjectSelectMatchT<double> (NT_FP64, 12, 13, 14, flatDim, 65535, 32768, 4, percentiles [iPct]);
+            passed &= ProjectSelectMatchT<SInt32> (NT_I32, 12, 13, 14, flatDim, 1000, 500, 4, percentiles [iPct]);
+        }
+        snprintf (testName, 64, "Project %c percentile float and short columns", (char)('X' + flatDim));
+        check (testName, passed);
+    }
+}
+
+/* ProjectMulti along flatDim of a wave with values from -offset to maxVal - offset matches each statistic in statMask
+ worked out on its own from a copy of each column, with argmax the first of tied maxima
+ Last Modified 2026/10/16 */
+template <typename T, typename O> int ProjectMultiMatchT (int waveType, CountInt xSize, CountInt ySize, CountInt zSize, UInt8 flatDim, UInt32 statMask, UInt32 maxVal, SInt32 offset){
+    const CountInt sizes [3] = {xSize, ySize, zSize};
+    CountInt d0 = (flatDim == 0) ? 1 : 0;
+    CountInt d1 = (flatDim == 2) ? 1 : 2;
+    CountInt outFrameSize = sizes [d0] * sizes [d1];
+    CountInt nStats = 0;
+    for (int iStat = 0; iStat < PROJECT_STAT_NUM; iStat++) nStats += ((statMask >> iStat) & 1);
+    waveHndl inH, outH;
+    T* inPtr = (T*)makeTestWave (&inH, waveType, xSize, ySize, zSize);
+    O* outPtr = (O*)makeTestWave (&outH, ProjectMultiOutPutType (waveType, statMask), sizes [d0], sizes [d1], nStats);
+    fillRandomT (inPtr, xSize * ySize * zSize, maxVal, 21 + flatDim);
+    for (CountInt iPnt = 0; iPnt < xSize * ySize * zSize; iPnt++) inPtr [iPnt] = (T)(inPtr [iPnt] - offset);
+    ProjectMultiThreadParams params = {waveType, (char*)inPtr, (char*)outPtr, flatDim, statMask, xSize, ySize, zSize};
+    int passed = (ProjectMultiRunTiles (&params) == 0);
+    std::vector<T> vals;
+    double expected [PROJECT_STAT_NUM];
+    for (CountInt i1 = 0; i1 < sizes [d1] && passed; i1++){
+        for (CountInt i0 = 0; i0 < sizes [d0] && passed; i0++){
+            vals.clear();
+            CountInt pos [3];
+            pos [d0] = i0;
+            pos [d1] = i1;
+            for (pos [flatDim] = 0; pos [flatDim] < sizes [flatDim]; pos [flatDim]++)
+                vals.push_back (inPtr [pos [0] + pos [1] * xSize + pos [2] * xSize * ySize]);
+            CountInt n = (CountInt)vals.size();
+            double sum = 0, sumSq = 0;
+            for (CountInt iVal = 0; iVal < n; iVal++) sum += vals [iVal];
+            for (CountInt iVal = 0; iVal < n; iVal++) sumSq += (vals [iVal] - sum/n) * (vals [iVal] - sum/n);
+            expected [0] = *std::min_element (vals.begin(), vals.end());
+            expected [1] = *std::max_element (vals.begin(), vals.end());
+            expected [2] = sum/n;
+            expected [3] = sqrt (sumSq/(n - 1));
+            expected [4] = sum;
+            expected [5] = (double)(std::max_element (vals.begin(), vals.end()) - vals.begin());
+            std::sort (vals.begin(), vals.end());
+            expected [6] = vals [n/2];
+            O* outPos = outPtr + i0 + i1 * sizes [d0];
+            for (int iStat = 0; iStat < PROJECT_STAT_NUM && passed; iStat++){
+                if (!(statMask & (1 << iStat))) continue;
+                passed = (fabs (*outPos - expected [iStat]) <= 1e-5 * (fabs (expected [iStat]) + 1));
+                outPos += outFrameSize;
+            }
+        }
+    }
+    KillWave (inH);
+    KillWave (outH);
+    return passed;
+}
+
+/* ProjectMulti sum of 1000 layers of full range 16 bit data, less 0 to 3 in the first layer, is exact, which needs
+ more than the 24 bits of single precision
+ Last Modified 2026/10/16 */
+static void testProjectMultiDeepSum (void){
+    const CountInt xSize = 8, ySize = 4, zSize = 1000;
+    waveHndl inH, outH;
+    unsigned short* inPtr = (unsigned short*)makeTestWave (&inH, NT_I16 | NT_UNSIGNED, xSize, ySize, zSize);
+    double* outPtr = (double*)makeTestWave (&outH, ProjectMultiOutPutType (NT_I16 | NT_UNSIGNED, PROJECT_STAT_MEAN | PROJECT_STAT_SUM), xSize, ySize, 2);
+    for (CountInt iPnt = 0; iPnt < xSize * ySize * zSize; iPnt++) inPtr [iPnt] = 65535;
+    for (CountInt iPnt = 0; iPnt < xSize * ySize; iPnt++) inPtr [iPnt] = (unsigned short)(65535 - (iPnt % 4));
+    ProjectMultiThreadParams params = {NT_I16 | NT_UNSIGNED, (char*)inPtr, (char*)outPtr, 2, PROJECT_STAT_MEAN | PROJECT_STAT_SUM, xSize, ySize, zSize};
+    int passed = (ProjectMultiOutPutType (NT_I16 | NT_UNSIGNED, PROJECT_STAT_MEAN | PROJECT_STAT_SUM) == NT_FP64);
+    passed &= (ProjectMultiRunTiles (&params) == 0);
+    for (CountInt iPnt = 0; iPnt < xSize * ySize && passed; iPnt++)
+        passed = (outPtr [xSize * ySize + iPnt] == 65535000.0 - (double)(iPnt % 4));
+    check ("ProjectMulti sum of 1000 16 bit layers", passed);
+    KillWave (inH);
+    KillWave (outH);
+}
+
+/* ProjectMulti of all the statistics along each dimension for 8 and 16 bit waves, with histogram and copied medians,
+ and for floating point waves, and some of the statistics, in order, for 32 bit waves and with many tied maxima
+ Last Modified 2026/10/16 */
+static void testProjectMulti (void){
+    char testName [64];
+    for (UInt8 flatDim = 0; flatDim < 3; flatDim++){
+        int passed = ProjectMultiMatchT<unsigned short, double> (NT_I16 | NT_UNSIGNED, 40, 33, 27, flatDim, 127, 65535, 0);
+        passed &= ProjectMultiMatchT<char, double> (NT_I8, 40, 33, 27, flatDim, 127, 255, 128);
+        passed &= ProjectMultiMatchT<short, double> (NT_I16, 12, 13, 14, flatDim, 127, 65535, 32768);
+        passed &= ProjectMultiMatchT<float, double> (NT_FP32, 40, 33, 27, flatDim, 127, 65535, 0);
+        passed &= ProjectMultiMatchT<double, double> (NT_FP64, 12, 13, 14, flatDim, 127, 65535, 30000);
+        snprintf (testName, 64, "ProjectMulti %c all statistics", (char)('X' + flatDim));
+        check (testName, passed);
+        passed = ProjectMultiMatchT<SInt32, double> (NT_I32, 40, 33, 27, flatDim, PROJECT_STAT_MIN | PROJECT_STAT_MEAN | PROJECT_STAT_ARGMAX, 16777215, 8000000);
+        passed &= ProjectMultiMatchT<unsigned char, float> (NT_I8 | NT_UNSIGNED, 40, 33, 27, flatDim, PROJECT_STAT_MAX | PROJECT_STAT_ARGMAX | PROJECT_STAT_MEDIAN, 3, 0);
+        passed &= ProjectMultiMatchT<UInt32, double> (NT_I32 | NT_UNSIGNED, 40, 33, 27, flatDim, PROJECT_STAT_STD | PROJECT_STAT_SUM | PROJECT_STAT_MEDIAN, 16777215, 0);
+        snprintf (testName, 64, "ProjectMulti %c some statistics", (char)('X' + flatDim));
+        check (testName, passed);
+    }
+    testProjectMultiDeepSum ();
+}
+
+/* ProjectDepth of a wave with values from -offset to maxVal - offset matches the maximum and/or minimum of each XY
+ location, and the layer of the first one, found going down through the layers
+ Last Modified 2026/10/16 */
+template <typename T> int ProjectDepthMatchT (int waveType, CountInt xSize, CountInt ySize, CountInt zSize, UInt8 projMode, UInt32 maxVal, SInt32 offset){
+    const CountInt frameSize = xSize * ySize;
+    waveHndl inH, outH, indexH;
+    T* inPtr = (T*)makeTestWave (&inH, waveType, xSize, ySize, zSize);
+    T* outPtr = (T*)makeTestWave (&outH, waveType, xSize, ySize, (projMode == 2) ? 2 : 0);
+    SInt32* indexPtr = (SInt32*)makeTestWave (&indexH, NT_I32, xSize, ySize, (projMode == 2) ? 2 : 0);
+    fillRandomT (inPtr, frameSize * zSize, maxVal, 31 + projMode);
+    for (CountInt iPnt = 0; iPnt < frameSize * zSize; iPnt++) inPtr [iPnt] = (T)(inPtr [iPnt] - offset);
+    ProjectDepthThreadParams params = {waveType, (char*)inPtr, (char*)outPtr, indexPtr, projMode, xSize, ySize, zSize};
+    int passed = (ProjectDepthRunTiles (&params) == 0);
+    // with both, the maximum is the first layer of the outputs and the minimum the second
+    CountInt maxOffset = 0, minOffset = (projMode == 2) ? frameSize : 0;
+    for (CountInt iPix = 0; iPix < frameSize && passed; iPix++){
+        CountInt argMax = 0, argMin = 0;
+        for (CountInt iLayer = 1; iLayer < zSize; iLayer++){
+            if (inPtr [iPix + iLayer * frameSize] > inPtr [iPix + argMax * frameSize]) argMax = iLayer;
+            if (inPtr [iPix + iLayer * frameSize] < inPtr [iPix + argMin * frameSize]) argMin = iLayer;
+        }
+        if (projMode != 0)
+            passed = ((outPtr [maxOffset + iPix] == inPtr [iPix + argMax * frameSize]) && (indexPtr [maxOffset + iPix] == argMax));
+        if ((projMode != 1) && passed)
+            passed = ((outPtr [minOffset + iPix] == inPtr [iPix + argMin * frameSize]) && (indexPtr [minOffset + iPix] == argMin));
+    }
+    KillWave (inH);
+    KillWave (outH);
+    KillWave (indexH);
+    return passed;
+}
+
+/* ProjectDepth minimum, maximum and both, for signed and unsigned 8 and 16 bit, 32 bit and floating point waves, over
+ more XY locations than a block, with many tied values, and with a single layer
+ Last Modified 2026/10/16 */
+static void testProjectDepth (void){
+    const char* modeNames [3] = {"min", "max", "both"};
+    char testName [64];
+    for (UInt8 projMode = 0; projMode < 3; projMode++){
+        int passed = ProjectDepthMatchT<unsigned short> (NT_I16 | NT_UNSIGNED, 70, 66, 30, projMode, 65535, 0);
+        passed &= ProjectDepthMatchT<short> (NT_I16, 70, 66, 30, projMode, 65535, 32768);
+        passed &= ProjectDepthMatchT<char> (NT_I8, 70, 66, 30, projMode, 255, 128);
+        passed &= ProjectDepthMatchT<unsigned char> (NT_I8 | NT_UNSIGNED, 70, 66, 30, projMode, 3, 0);
+        passed &= ProjectDepthMatchT<SInt32> (NT_I32, 12, 13, 14, projMode, 16777215, 8000000);
+        passed &= ProjectDepthMatchT<UInt32> (NT_I32 | NT_UNSIGNED, 12, 13, 14, projMode, 16777215, 0);
+        passed &= ProjectDepthMatchT<float> (NT_FP32, 70, 66, 30, projMode, 65535, 30000);
+        passed &= ProjectDepthMatchT<double> (NT_FP64, 12, 13, 14, projMode, 65535, 0);
+        passed &= ProjectDepthMatchT<unsigned short> (NT_I16 | NT_UNSIGNED, 12, 13, 1, projMode, 65535, 0);
+        snprintf (testName, 64, "ProjectDepth %s", modeNames [projMode]);
+        check (testName, passed);
+    }
+}
+
+/* ------------------------------------------------LSM Utilities---------------------------------------------------*/
+
+/* Reverses the odd lines of a wave with an odd number of lines, so the last line is on its own and left alone
+ Last Modified 2026/10/16 */
+static void testSwapEven (void){
+    const CountInt lineLen = 37, numLines = 2001;
+    waveHndl waveH;
+    SInt16* dataPtr = (SInt16*)makeTestWave (&waveH, NT_I16, lineLen, numLines, 0);
+    fillRandomT (dataPtr, lineLen * numLines, 30000, 4);
+    std::vector<SInt16> expected (dataPtr, dataPtr + lineLen * numLines);
+    for (CountInt iLine = 1; iLine < numLines; iLine += 2)
+        std::reverse (expected.begin() + iLine * lineLen, expected.begin() + (iLine + 1) * lineLen);
+    SwapEvenThreadParams params = {NT_I16, (char*)dataPtr, numLines, lineLen};
+    SwapEvenRunTiles (&params);
+    check ("SwapEven NT_I16 odd number of lines", std::equal (expected.begin(), expected.end(), dataPtr));
+    KillWave (waveH);
+}
+
+/* Down samples a wave by each of the 4 methods, plus a 16 bit sum that has to be clipped
+ Last Modified 2026/10/16 */
+static void testDownSample (void){
+    const CountInt boxFactor = 5, nBoxes = 20011, points = boxFactor * nBoxes;
+    const char* dsNames [4] = {"average", "sum", "max", "median"};
+    char testName [64];
+    waveHndl waveH;
+    std::vector<double> original (points);
+    std::vector<double> box (boxFactor);
+    fillRandomT (&original [0], points, 4095, 5);
+    for (UInt8 DSType = 1; DSType <= 4; DSType++){
+        double* dataPtr = (double*)makeTestWave (&waveH, NT_FP64, points, 0, 0);
+        memcpy (dataPtr, &original [0], points * sizeof (double));
+        double* bufferPtr = (double*)WMNewPtr (nBoxes * sizeof (double));
+        DownSampleThreadParams params = {NT_FP64, (char*)dataPtr, (char*)bufferPtr, points, boxFactor, DSType};
+        DownSampleRunTiles (&params);
+        int passed = 1;
+        for (CountInt iBox = 0; iBox < nBoxes && passed; iBox++){
+            box.assign (original.begin() + iBox * boxFactor, original.begin() + (iBox + 1) * boxFactor);
+            double expected = 0;
+            switch (DSType){
+                case 1:
+                case 2:
+                    for (CountInt iPnt = 0; iPnt < boxFactor; iPnt++) expected += box [iPnt];
+                    if (DSType == 1) expected /= boxFactor;
+                    break;
+                case 3:
+                    expected = *std::max_element (box.begin(), box.end());
+                    break;
+                case 4:
+                    std::nth_element (box.begin(), box.begin() + boxFactor/2, box.end());
+                    expected = box [boxFactor/2];
+                    break;
+            }
+            passed = (fabs (dataPtr [iBox] - expected) < 1e-9);
+        }
+        snprintf (testName, 64, "DownSample NT_FP64 %s", dsNames [DSType - 1]);
+        check (testName, passed);
+        WMDisposePtr ((Ptr)bufferPtr);
+        KillWave (waveH);
+    }
+    // 16 bit sums are clipped at the maximum, not wrapped around
+    SInt16* iDataPtr = (SInt16*)makeTestWave (&waveH, NT_I16, points, 0, 0);
+    for (CountInt iPnt = 0; iPnt < points; iPnt++) iDataPtr [iPnt] = (iPnt % 2) ? 10000 : -100;
+    SInt16* iBufferPtr = (SInt16*)WMNewPtr (nBoxes * sizeof (SInt16));
+    DownSampleThreadParams params = {NT_I16, (char*)iDataPtr, (char*)iBufferPtr, points, boxFactor, 2};
+    DownSampleRunTiles (&params);
+    int passed = 1;
+    for (CountInt iBox = 0; iBox < nBoxes && passed; iBox++){
+        double expected = 0;
+        for (CountInt iPnt = iBox * boxFactor; iPnt < (iBox + 1) * boxFactor; iPnt++) expected += (iPnt % 2) ? 10000 : -100;
+        passed = (iDataPtr [iBox] == ((expected > SHRT_MAX) ? SHRT_MAX : expected));
+    }
+    check ("DownSample NT_I16 sum clipped", passed);
+    WMDisposePtr ((Ptr)iBufferPtr);
+    KillWave (waveH);
+}
+
+/* Transposes the frames of square and non-square waves
+ Last Modified 2026/10/16 */
+static void testTranspose (void){
+    const CountInt sizes [2][2] = {{48, 48}, {61, 29}};
+    const CountInt zSize = 23;
+    waveHndl waveH;
+    for (int iSize = 0; iSize < 2; iSize++){
+        CountInt xSize = sizes [iSize][0], ySize = sizes [iSize][1], frameSize = xSize * ySize;
+        UInt16* dataPtr = (UInt16*)makeTestWave (&waveH, NT_I16 | NT_UNSIGNED, xSize, ySize, zSize);
+        fillRandomT (dataPtr, frameSize * zSize, 65535, 6 + iSize);
+        std::vector<UInt16> original (dataPtr, dataPtr + frameSize * zSize);
+        UInt16* bufferPtr = (UInt16*)WMNewPtr (frameSize * gNumProcessors * sizeof (UInt16));
+        TransposeFramesThreadParams params = {NT_I16 | NT_UNSIGNED, dataPtr, bufferPtr, xSize, ySize, zSize};
+        ThreadPoolRunTiles (TransposeFramesTile, &params, zSize, 1, gNumProcessors);
+        int passed = 1;
+        for (CountInt iFrame = 0; iFrame < zSize && passed; iFrame++){
+            for (CountInt iY = 0; iY < ySize && passed; iY++){
+                for (CountInt iX = 0; iX < xSize && passed; iX++){
+                    // transposed frame has ySize columns and xSize rows
+                    passed = (dataPtr [iFrame * frameSize + iX * ySize + iY] == original [iFrame * frameSize + iY * xSize + iX]);
+                }
+            }
+        }
+        check (iSize == 0 ? "TransposeFrames square" : "TransposeFrames non-square", passed);
+        WMDisposePtr ((Ptr)bufferPtr);
+        KillWave (waveH);
+    }
+}
+
+/* ------------------------------------------------Filter---------------------------------------------------*/
+
+/* Median filters frames into a new wave and in place, checked against medians of the window at each pixel,
+ clipped at the edges of the frame
+ Last Modified 2026/10/16 */
+static void testMedian (void){
+    const CountInt xSize = 71, ySize = 43, zSize = 9, frameSize = xSize * ySize;
+    const UInt16 kWidth = 5, kRad = 2;
+    waveHndl inH, outH;
+    std::vector<float> window;
+    for (int inPlace = 0; inPlace < 2; inPlace++){
+        float* inPtr = (float*)makeTestWave (&inH, NT_FP32, xSize, ySize, zSize);
+        fillRandomT (inPtr, frameSize * zSize, 1000, 8);
+        std::vector<float> original (inPtr, inPtr + frameSize * zSize);
+        float* outPtr = inPtr;
+        float* bufferPtr = NULL;
+        if (inPlace){
+            bufferPtr = (float*)WMNewPtr (frameSize * gNumProcessors * sizeof (float));
+        }else{
+            outPtr = (float*)makeTestWave (&outH, NT_FP32, xSize, ySize, zSize);
+        }
+        MedianFramesThreadParams params = {NT_FP32, (char*)inPtr, (char*)outPtr, (char*)bufferPtr, xSize, ySize, zSize, kWidth};
+        ThreadPoolRunTiles (MedianFramesTile, &params, zSize, 1, gNumProcessors);
+        int passed = 1;
+        for (CountInt iFrame = 0; iFrame < zSize && passed; iFrame++){
+            for (CountInt iY = 0; iY < ySize && passed; iY++){
+                for (CountInt iX = 0; iX < xSize && passed; iX++){
+                    window.clear();
+                    for (CountInt kY = std::max ((CountInt)0, iY - kRad); kY <= std::min (ySize - 1, iY + kRad); kY++){
+                        for (CountInt kX = std::max ((CountInt)0, iX - kRad); kX <= std::min (xSize - 1, iX + kRad); kX++)
+                            window.push_back (original [iFrame * frameSize + kY * xSize + kX]);
+                    }
+                    std::nth_element (window.begin(), window.begin() + window.size()/2, window.end());
+                    passed = (outPtr [iFrame * frameSize + iY * xSize + iX] == window [window.size()/2]);
+                }
+            }
+        }
+        check (inPlace ? "MedianFrames in place" : "MedianFrames new wave", passed);
+        if (inPlace){
+            WMDisposePtr ((Ptr)bufferPtr);
+        }else{
+            KillWave (outH);
+        }
+        KillWave (inH);
+    }
+}
+
+/* Convolves frames with a delta kernel, which should give back the input, and a box kernel, which should give the
+ mean of the neighbourhood away from the edges
+ Last Modified 2026/10/16 */
+static void testConvolve (void){
+    const CountInt xSize = 64, ySize = 48, zSize = 6, frameSize = xSize * ySize;
+    const UInt16 kWidth = 3, kHeight = 3;
+    float deltaKernel [9] = {0, 0, 0, 0, 1, 0, 0, 0, 0};
+    float boxKernel [9] = {1.0f/9, 1.0f/9, 1.0f/9, 1.0f/9, 1.0f/9, 1.0f/9, 1.0f/9, 1.0f/9, 1.0f/9};
+    waveHndl inH, outH;
+    SInt16* inPtr = (SInt16*)makeTestWave (&inH, NT_I16, xSize, ySize, zSize);
+    fillRandomT (inPtr, frameSize * zSize, 4000, 9);
+    float* outPtr = (float*)makeTestWave (&outH, NT_FP32, xSize, ySize, zSize);
+    for (int iKernel = 0; iKernel < 2; iKernel++){
+        float* kernel = iKernel ? boxKernel : deltaKernel;
+        float* kernelTablePtr = ConvolveMakeKernelTable (kernel, kWidth, kHeight);
+        ConvolveFramesThreadParams params = {NT_I16, (char*)inPtr, (char*)outPtr, NULL, xSize, ySize, zSize, kernel, kernelTablePtr, kWidth, kHeight, 1};
+        ThreadPoolRunTiles (ConvolveFramesTile, &params, zSize, 1, gNumProcessors);
+        int passed = 1;
+        for (CountInt iFrame = 0; iFrame < zSize && passed; iFrame++){
+            for (CountInt iY = iKernel; iY < ySize - iKernel && passed; iY++){
+                for (CountInt iX = iKernel; iX < xSize - iKernel && passed; iX++){
+                    double expected = 0;
+                    if (iKernel){
+                        for (CountInt kY = iY - 1; kY <= iY + 1; kY++){
+                            for (CountInt kX = iX - 1; kX <= iX + 1; kX++) expected += inPtr [iFrame * frameSize + kY * xSize + kX];
+                        }
+                        expected /= 9;
+                    }else{
+                        expected = inPtr [iFrame * frameSize + iY * xSize + iX];
+                    }
+                    passed = (fabs (outPtr [iFrame * frameSize + iY * xSize + iX] - expected) < 1e-2);
+                }
+            }
+        }
+        check (iKernel ? "ConvolveFrames box kernel" : "ConvolveFrames delta kernel", passed);
+        WMDisposePtr ((Ptr)kernelTablePtr);
+    }
+    KillWave (inH);
+    KillWave (outH);
+}
+
+/* Checks the CPU counts are consistent with each other, and that caps are applied
+ Last Modified 2026/10/16 */
+static void testTopology (void){
+    CPUTopology topo;
+    CPUTopologyRead (&topo);
+    printf ("online %u, allowed %u, quota %u, usable %u, physical %u, performance %u\n", (unsigned)topo.onlineCPUs,
+            (unsigned)topo.allowedCPUs, (unsigned)topo.quotaCPUs, (unsigned)topo.usableCPUs, (unsigned)topo.physicalCores, (unsigned)topo.perfCores);
+    check ("CPUTopology counts", (topo.usableCPUs >= 1) && (topo.usableCPUs <= topo.allowedCPUs) && (topo.allowedCPUs <= topo.onlineCPUs) &&
+           (topo.physicalCores >= 1) && (topo.physicalCores <= topo.allowedCPUs) && (topo.perfCores >= 1) && (topo.perfCores <= topo.physicalCores));
+    check ("CPUTopology caps", (CPUTopologyNumThreads (CPU_CAP_NONE) == topo.usableCPUs) && (CPUTopologyNumThreads (1) == 1) &&
+           (CPUTopologyNumThreads (100000) == topo.usableCPUs) && (CPUTopologyNumThreads (CPU_CAP_PHYSICAL) <= topo.usableCPUs) &&
+           (CPUTopologyNumThreads (CPU_CAP_PERFORMANCE) <= CPUTopologyNumThreads (CPU_CAP_PHYSICAL)));
+    // each cap on a made-up hybrid CPU with 12 usable of 16 logical CPUs, 6 physical cores and 4 performance cores,
+    // and clamped to the threads in a pool of 8 or 3 threads
+    CPUTopology hybrid = {16, 12, 0, 12, 6, 4};
+    check ("CPUTopology cap values", (CPUTopologyThreadsForCap (&hybrid, CPU_CAP_NONE, 0) == 12) &&
+           (CPUTopologyThreadsForCap (&hybrid, CPU_CAP_PHYSICAL, 0) == 6) && (CPUTopologyThreadsForCap (&hybrid, CPU_CAP_PERFORMANCE, 0) == 4) &&
+           (CPUTopologyThreadsForCap (&hybrid, 5, 0) == 5) && (CPUTopologyThreadsForCap (&hybrid, 100, 0) == 12) &&
+           (CPUTopologyThreadsForCap (&hybrid, -7, 0) == 12));
+    check ("CPUTopology cap pool clamp", (CPUTopologyThreadsForCap (&hybrid, CPU_CAP_NONE, 8) == 8) &&
+           (CPUTopologyThreadsForCap (&hybrid, CPU_CAP_PHYSICAL, 8) == 6) && (CPUTopologyThreadsForCap (&hybrid, 100, 8) == 8) &&
+           (CPUTopologyThreadsForCap (&hybrid, CPU_CAP_PERFORMANCE, 3) == 3) && (CPUTopologyThreadsForCap (&hybrid, 2, 3) == 2));
+    // a quota of 3 CPUs limits the physical and performance core counts as well
+    CPUTopology quota = {16, 12, 3, 3, 6, 4};
+    check ("CPUTopology cap quota", (CPUTopologyThreadsForCap (&quota, CPU_CAP_NONE, 0) == 3) &&
+           (CPUTopologyThreadsForCap (&quota, CPU_CAP_PHYSICAL, 0) == 3) && (CPUTopologyThreadsForCap (&quota, CPU_CAP_PERFORMANCE, 0) == 3));
+}
+
+/* Writes a line to a file under rootDir, making the directories on its path, for testTopologyParsing
+ Last Modified 2026/10/16 */
+static void writeTopologyFile (const char* rootDir, const char* relPath, const char* line){
+    char path [1024];
+    snprintf (path, sizeof (path), "%s%s", rootDir, relPath);
+    for (char* slashPtr = strchr (path + 1, '/'); slashPtr != nullptr; slashPtr = strchr (slashPtr + 1, '/')){
+        *slashPtr = 0;
+        mkdir (path, 0755);
+        *slashPtr = '/';
+    }
+    FILE* fp = fopen (path, "w");
+    if (fp == nullptr) return;
+    fprintf (fp, "%s\n", line);
+    fclose (fp);
+}
+
+/* Checks the kernel cpu lists, the cgroup v2 and v1 quotas and the core counts are parsed as expected from made-up
+ sysfs and cgroup trees, and that the affinity mask of the calling thread limits the allowed CPUs. The thread is pinned
+ to its first two allowed CPUs, or one if that is all it has, while the trees are read
+ Last Modified 2026/10/16 */
+static void testTopologyParsing (void){
+    check ("CPUTopology cpu lists", (CPUTopologyListCount ("0-7,16-23") == 16) && (CPUTopologyListCount ("5") == 1) &&
+           (CPUTopologyListCount ("") == 0) && (CPUTopologyListCount ("0,2,4-5") == 4) && (CPUTopologyInList ("0-7,16-23", 17)) &&
+           (!CPUTopologyInList ("0-7,16-23", 8)) && (CPUTopologyInList ("0,2,4-5", 2)) && (!CPUTopologyInList ("0,2,4-5", 3)));
+    char rootTemplate [] = "/tmp/kernelTestsTopoXXXXXX";
+    char* rootDir = mkdtemp (rootTemplate);
+    if (rootDir == nullptr){
+        check ("CPUTopology test directory", 0);
+        return;
+    }
+    cpu_set_t savedSet, pinSet;
+    int pinned [2] = {-1, -1}, nPinned = 0;
+    sched_getaffinity (0, sizeof (savedSet), &savedSet);
+    CPU_ZERO (&pinSet);
+    for (int iCPU = 0; (iCPU < CPU_SETSIZE) && (nPinned < 2); iCPU++){
+        if (!CPU_ISSET (iCPU, &savedSet)) continue;
+        CPU_SET (iCPU, &pinSet);
+        pinned [nPinned++] = iCPU;
+    }
+    sched_setaffinity (0, sizeof (pinSet), &pinSet);
+    CPUTopology topo;
+    CPUTopologyRead (&topo);
+    check ("CPUTopology affinity", (topo.allowedCPUs == (UInt32)nPinned) && (topo.usableCPUs <= (UInt32)nPinned) &&
+           (CPUTopologyNumThreads (CPU_CAP_NONE) <= (UInt32)nPinned));
+    char dirName [1024], relPath [256];
+    // the pinned CPUs as two threads of one core, then as a performance core and an efficiency core by cpu_capacity,
+    // then by the list of performance cores an Intel hybrid CPU has
+    UInt32 expectPhysical [3] = {1, (UInt32)nPinned, (UInt32)nPinned};
+    const char* treeNames [3] = {"smt", "capacity", "corelist"};
+    for (int iTree = 0; iTree < 3; iTree++){
+        snprintf (dirName, sizeof (dirName), "%s/%s", rootDir, treeNames [iTree]);
+        for (int iPin = 0; iPin < nPinned; iPin++){
+            snprintf (relPath, sizeof (relPath), "/sys/devices/system/cpu/cpu%d/topology/core_id", pinned [iPin]);
+            writeTopologyFile (dirName, relPath, (iTree == 0) ? "0" : ((iPin == 0) ? "0" : "1"));
+            snprintf (relPath, sizeof (relPath), "/sys/devices/system/cpu/cpu%d/topology/physical_package_id", pinned [iPin]);
+            writeTopologyFile (dirName, relPath, "0");
+            if (iTree == 1){
+                snprintf (relPath, sizeof (relPath), "/sys/devices/system/cpu/cpu%d/cpu_capacity", pinned [iPin]);
+                writeTopologyFile (dirName, relPath, (iPin == 0) ? "1024" : "512");
+            }
+        }
+        if (iTree == 2){
+            snprintf (relPath, sizeof (relPath), "%d", pinned [0]);
+            writeTopologyFile (dirName, "/sys/devices/cpu_core/cpus", relPath);
+        }
+        CPUTopologyReadRoot (&topo, dirName);
+        char testName [64];
+        snprintf (testName, sizeof (testName), "CPUTopology cores %s", treeNames [iTree]);
+        check (testName, (topo.allowedCPUs == (UInt32)nPinned) && (topo.physicalCores == expectPhysical [iTree]) && (topo.perfCores == 1) &&
+               (topo.quotaCPUs == 0));
+    }
+    // cgroup v2 quotas at three levels, where the smallest, 2.5 CPUs rounded up, is used, and "max" is no quota
+    snprintf (dirName, sizeof (dirName), "%s/v2", rootDir);
+    writeTopologyFile (dirName, "/proc/self/cgroup", "0::/a/b");
+    writeTopologyFile (dirName, "/sys/fs/cgroup/a/b/cpu.max", "max 100000");
+    writeTopologyFile (dirName, "/sys/fs/cgroup/a/cpu.max", "250000 100000");
+    writeTopologyFile (dirName, "/sys/fs/cgroup/cpu.max", "400000 100000");
+    CPUTopologyReadRoot (&topo, dirName);
+    UInt32 v2Quota = topo.quotaCPUs;
+    // cgroup v1 quota of 1.5 CPUs in the combined cpu,cpuacct controller, and no quota when it is -1
+    snprintf (dirName, sizeof (dirName), "%s/v1", rootDir);
+    writeTopologyFile (dirName, "/sys/fs/cgroup/cpu,cpuacct/cpu.cfs_quota_us", "150000");
+    writeTopologyFile (dirName, "/sys/fs/cgroup/cpu,cpuacct/cpu.cfs_period_us", "100000");
+    CPUTopologyReadRoot (&topo, dirName);
+    UInt32 v1Quota = topo.quotaCPUs;
+    writeTopologyFile (dirName, "/sys/fs/cgroup/cpu,cpuacct/cpu.cfs_quota_us", "-1");
+    CPUTopologyReadRoot (&topo, dirName);
+    check ("CPUTopology cgroup quotas", (v2Quota == 3) && (v1Quota == 2) && (topo.quotaCPUs == 0));
+    sched_setaffinity (0, sizeof (savedSet), &savedSet);
+    snprintf (dirName, sizeof (dirName), "rm -rf %s", rootDir);
+    if (system (dirName) != 0) printf ("could not remove %s\n", rootDir);
+}
+
+/* Runs the stages of a pipeline one after another with the kernels of their own XFUNCs, as a reference for testPipeline
+ Last Modified 2026/10/16 */
+static void pipelineReference (PipelineThreadParamsPtr p){
+    CountInt points = p->xSize * p->ySize * p->zSize;
+    CountInt xOut = (p->DSType) ? p->xSize/p->boxFactor : p->xSize;
+    if (p->doDecumulate){
+        DecumulateThreadParams dp = {p->inPutWaveType, p->dataStartPtr, 0, points, p->maxCount, 0, p->is3232};
+        DecumulateThread (&dp);
+    }
+    if (p->doSwapEven){
+        SwapEvenThreadParams sp = {p->inPutWaveType, p->dataStartPtr, p->ySize * p->zSize, p->xSize};
+        SwapEvenRunTiles (&sp);
+    }
+    if (p->DSType){
+        char* bufferPtr = (char*)WMNewPtr (points/p->boxFactor * DownSamplePointBytes (p->inPutWaveType));
+        DownSampleThreadParams dp = {p->inPutWaveType, p->dataStartPtr, bufferPtr, points, p->boxFactor, p->DSType};
+        DownSampleRunTiles (&dp);
+        WMDisposePtr ((Ptr)bufferPtr);
+    }
+    if (p->doKalman){
+        KalmanThreadParams kp = {p->inPutWaveType, p->dataStartPtr, p->dataStartPtr, 0, 0, xOut, p->ySize, p->zSize, 1, 1, p->multiplier};
+        KalmanRunTiles (&kp);
+    }
+}
+
+/* Checks that the pipeline gives the same results as running its stages one after another, with one line per tile so
+ tiles start on both odd and even lines, and Decumulate needs a first value for every tile
+ Last Modified 2026/10/16 */
+static void testPipeline (void){
+    const CountInt xSize = 48, ySize = 31, zSize = 6, points = xSize * ySize * zSize;
+    // type, decumulate bits (0 for none), swapEven, DSType, boxFactor, Kalman, multiplier
+    typedef struct PipelineCase{int waveType; UInt32 bits; UInt8 doSwapEven; UInt8 DSType; CountInt boxFactor; UInt8 doKalman; float multiplier; const char* name;} PipelineCase;
+    const PipelineCase cases [5] = {
+        {NT_I16 | NT_UNSIGNED, 12, 1, 1, 4, 1, 1, "Pipeline u16 all stages"},
+        {NT_I16, 12, 1, 4, 4, 1, 16, "Pipeline i16 all stages, median, multiplier"},
+        {NT_FP32, 0, 1, 2, 3, 0, 1, "Pipeline f32 SwapEven and DownSample"},
+        {NT_I32 | NT_UNSIGNED, 32, 0, 0, 1, 1, 0, "Pipeline u32 Decumulate and Kalman average"},
+        {NT_FP64, 0, 1, 0, 1, 0, 1, "Pipeline f64 SwapEven"}
+    };
+    for (int iCase = 0; iCase < 5; iCase++){
+        const PipelineCase* c = &cases [iCase];
+        UInt8 pointBytes = DownSamplePointBytes (c->waveType);
+        char* fusedPtr = (char*)WMNewPtr (points * pointBytes);
+        char* referencePtr = (char*)WMNewPtr (points * pointBytes);
+        // cumulative counts, rolling over as a counter of the given bits would
+        UInt32 maxCount = (c->bits == 0) ? 4095 : ((c->bits == 32) ? 0xFFFFFFFF : (1u << c->bits) - 1);
+        UInt32 count = 0, seed = 7;
+        for (CountInt iPnt = 0; iPnt < points; iPnt++){
+            seed = seed * 1664525u + 1013904223u;
+            count = (c->bits) ? ((count + ((seed >> 8) % 200)) & maxCount) : (seed >> 8) % 4096;
+            switch (c->waveType){
+                case (NT_I16 | NT_UNSIGNED):
+                    ((unsigned short*)fusedPtr) [iPnt] = (unsigned short)count;
+                    break;
+                case NT_I16:
+                    ((short*)fusedPtr) [iPnt] = (short)count;
+                    break;
+                case (NT_I32 | NT_UNSIGNED):
+                    ((UInt32*)fusedPtr) [iPnt] = count + 0xFFFFF000u;   // start near the top so the 32 bit counter rolls over
+                    break;
+                case NT_FP32:
+                    ((float*)fusedPtr) [iPnt] = (float)count;
+                    break;
+                case NT_FP64:
+                    ((double*)fusedPtr) [iPnt] = (double)count;
+                    break;
+            }
+        }
+        memcpy (referencePtr, fusedPtr, points * pointBytes);
+        PipelineThreadParams params;
+        memset (&params, 0, sizeof (params));
+        params.inPutWaveType = c->waveType;
+        params.xSize = xSize;
+        params.ySize = ySize;
+        params.zSize = zSize;
+        params.doDecumulate = (c->bits != 0);
+        params.maxCount = maxCount;
+        params.is3232 = ((c->bits == 32) && (c->waveType == (NT_I32 | NT_UNSIGNED)));
+        params.doSwapEven = c->doSwapEven;
+        params.DSType = c->DSType;
+        params.boxFactor = c->boxFactor;
+        params.doKalman = c->doKalman;
+        params.multiplier = c->multiplier;
+        params.dataStartPtr = referencePtr;
+        pipelineReference (&params);
+        params.dataStartPtr = fusedPtr;
+        int result = PipelineRunTiles (&params, gNumProcessors);
+        CountInt outPoints = ((c->DSType) ? xSize/c->boxFactor : xSize) * ySize * ((c->doKalman) ? 1 : zSize);
+        check (c->name, (result == 0) && (params.linesPerTile == 1) && (memcmp (fusedPtr, referencePtr, outPoints * pointBytes) == 0));
+        WMDisposePtr (fusedPtr);
+        WMDisposePtr (referencePtr);
+    }
+}
+
+/* Tile function for testControlled, counts items and sets the cancel flag once cancelAt items have been done
+ Last Modified 2026/10/16 */
+typedef struct ControlledTestParams{
+    ThreadPoolControlPtr controlPtr;
+    CountInt cancelAt;
+    std::atomic<CountInt> itemsRun;
+} ControlledTestParams;
+
+static void ControlledTestTile (void* paramsPtr, CountInt startItem, CountInt endItem, UInt32 iSlot){
+    ControlledTestParams* params = (ControlledTestParams*)paramsPtr;
+    if ((params->itemsRun += endItem - startItem) >= params->cancelAt) params->controlPtr->cancel = 1;
+}
+
+/* Checks that a controlled job counts the items done, and stops handing out tiles once it is cancelled
+ Last Modified 2026/10/16 */
+static void testControlled (void){
+    ThreadPoolControl control;
+    ControlledTestParams params;
+    CountInt nItems = 1000;
+    int result;
+    UInt8 cancelled;
+    params.controlPtr = &control;
+    for (cancelled = 0; cancelled < 2; cancelled++){
+        control.cancel = 0;
+        control.itemsDone = 0;
+        params.itemsRun = 0;
+        params.cancelAt = cancelled ? 10 : nItems + 1;
+        result = ThreadPoolRunTilesControlled (ControlledTestTile, &params, nItems, 1, gNumProcessors, &control);
+        if (cancelled){
+            // each thread may finish the tile it has when the flag is set, but no more are started
+            check ("ThreadPool controlled job cancelled", (result == JOBCANCELLED) && (control.itemsDone == params.itemsRun) &&
+                   (params.itemsRun >= 10) && (params.itemsRun < 10 + (CountInt)gNumProcessors));
+        }else{
+            check ("ThreadPool controlled job progress", (result == 0) && (control.itemsDone == nItems) && (params.itemsRun == nItems));
+        }
+    }
+}
+
+/* Tile function for testTileExceptions, throws an error code from one tile and std::bad_alloc from another
+ Last Modified 2026/10/16 */
+static void ExceptionTestTile (void* paramsPtr, CountInt startItem, CountInt endItem, UInt32 iSlot){
+    CountInt throwAt = *(CountInt*)paramsPtr;
+    if ((startItem <= throwAt) && (throwAt < endItem)){
+        if (throwAt & 1) throw std::bad_alloc ();
+        throw (int)NOMEM;
+    }
+}
+
+/* Checks that an error code or another exception thrown from a tile, on the calling thread or a worker, ends up as the
+ result of the job instead of escaping the thread
+ Last Modified 2026/10/16 */
+static void testTileExceptions (void){
+    CountInt throwAt;
+    int passed = 1;
+    for (throwAt = 0; throwAt < 64; throwAt++){
+        int result = ThreadPoolRunTiles (ExceptionTestTile, &throwAt, 64, 1, gNumProcessors);
+        passed &= (result == ((throwAt & 1) ? MEMFAIL : NOMEM));
+    }
+    check ("ThreadPool exceptions thrown from tiles", passed);
+}
+
+/* Tile functions for testBackgroundJob. The background job's tiles hold on to their threads until released, or until
+ one of them has waited 10 seconds, so the job stays in flight while the plain call runs
+ Last Modified 2026/10/16 */
+typedef struct BackgroundTestParams{
+    std::atomic<UInt8> released;
+    std::atomic<CountInt> itemsStarted;
+    std::atomic<CountInt> itemsRun;
+} BackgroundTestParams;
+
+static void BackgroundTestTile (void* paramsPtr, CountInt startItem, CountInt endItem, UInt32 iSlot){
+    BackgroundTestParams* params = (BackgroundTestParams*)paramsPtr;
+    std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now ();
+    params->itemsStarted += endItem - startItem;
+    while (!params->released){
+        if (std::chrono::steady_clock::now () - startTime > std::chrono::seconds (10)) params->released = 1;
+        std::this_thread::sleep_for (std::chrono::milliseconds (1));
+    }
+}
+
+static void BackgroundTestPlainTile (void* paramsPtr, CountInt startItem, CountInt endItem, UInt32 iSlot){
+    ((BackgroundTestParams*)paramsPtr)->itemsRun += endItem - startItem;
+}
+
+/* Checks that a plain ThreadPoolRunTiles asking for every thread returns while a background job, as run by the Async
+ XFUNCs, is still in flight, instead of waiting for the job to give back its slots
+ Last Modified 2026/10/16 */
+static void testBackgroundJob (void){
+    ThreadPoolControl control;
+    BackgroundTestParams jobParams, plainParams;
+    CountInt nItems = 1000;
+    int jobResult = -1, plainResult;
+    std::atomic<UInt8> jobDone (0);
+    UInt8 doneFirst;
+    control.cancel = 0;
+    control.itemsDone = 0;
+    jobParams.released = 0;
+    jobParams.itemsStarted = 0;
+    plainParams.itemsRun = 0;
+    std::thread jobThread ([&](){
+        jobResult = ThreadPoolRunTilesControlled (BackgroundTestTile, &jobParams, 64, 1, ThreadPoolBackgroundSlots (), &control);
+        jobDone = 1;
+    });
+    while (jobParams.itemsStarted == 0) std::this_thread::sleep_for (std::chrono::milliseconds (1));
+    plainResult = ThreadPoolRunTiles (BackgroundTestPlainTile, &plainParams, nItems, 1, gNumProcessors);
+    doneFirst = (jobDone == 0);
+    jobParams.released = 1;
+    jobThread.join ();
+    check ("ThreadPool plain call during background job", doneFirst && (plainResult == 0) && (plainParams.itemsRun == nItems) &&
+           (jobResult == 0) && (control.itemsDone == 64));
+}
+
+int main (int argc, char* argv[]){
+    testTopology ();
+    testTopologyParsing ();
+    gNumProcessors = CPUTopologyNumThreads (CPU_CAP_NONE);
+    // run with at least 4 threads, so tiles are split up and stolen even on a small machine
+    if (gNumProcessors < 4) gNumProcessors = 4;
+    if (ThreadPoolStart (gNumProcessors) != 0){
+        printf ("Could not start thread pool\n");
+        return 1;
+    }
+    testKalman ();
+    testKalmanSIMD ();
+    testKalmanBlocks ();
+    testKalmanExact ();
+    testKalmanSliding ();
+    testKalmanGroups ();
+    testKalmanInterleaved ();
+    testKalmanNext ();
+    testKalmanStats ();
+    testKalmanRobust ();
+    testTriggeredAverage ();
+    testKalmanList ();
+    testProject ();
+    testProjectMedian ();
+    testProjectPercentile ();
+    testProjectMulti ();
+    testProjectDepth ();
+    testSwapEven ();
+    testDownSample ();
+    testTranspose ();
+    testMedian ();
+    testConvolve ();
+    testControlled ();
+    testTileExceptions ();
+    testBackgroundJob ();
+    testPipeline ();
+    ThreadPoolStop ();
+    printf ("%d failures\n", gFailures);
+    return gFailures;
+}
@@ -1,8 +1,10 @@
 #include "twoPhoton.h"
 
 /* ------------------------------Minimum/Maximum/Avg/Median Intensity Projections----------------------
- Code for making Minimum/Maximum/Avg/Median Intensity Projections along X,Y, and Z axes
- Last Modified 2025/06/25 by Jamie Boyd
+ Code for making Minimum/Maximum/Avg/Median/Percentile Intensity Projections along X,Y, and Z axes, for making several
+ statistics at once with ProjectMulti, and for depth coded projections with the layer of each maximum or minimum with
+ ProjectDepth
+ Last Modified 2026/10/16
  
  ProjectAllFrames and ProjectSpecFrames make a projection image of a 3D wave, either into a 2D wave,
  or by collapsing the input 3D wave into 2D. The differences between ProjectAllFrames and ProjectSpecFrames:
@@ -14,381 +16,8 @@
 
  ProjectXslice, ProjectYSlice, and ProjectZSLice are used to get a single slice from a 3D wave and place it in an
  existing 2D wave of the right dimensions
+ The templates and tile functions are in ProjectKernels.cpp
  ------------------------------------------------------------------------------------------------------- */
- 
-/* The following templates get a single slice or makes a minimum or maximum intensity projection for one of
- the 8 types of wave data in the X,Y,or Z dimension, for either of the Project functions
- srcWaveStart: pointer to the start of the data in the 3D input wave
- desWaveStart: pointer to the start of the data in the 2D or 3D outPut wave
- projMode: 1 for maximum intensity projection, 0 for minimum intensity projection
- example:
- X projection - looking for max/min with a range of columns at a single YZ location
- result is wave with dim 0 = ySize, dim 1 =zSize
- using Igor terminology of x being columns and y being rows and z being layers
- Last Modified 2014/01/27 by Jamie Boyd */
-
-template <typename T> void doProjectX(T *srcWaveStart, T *destWaveStart, UInt8 projMode, CountInt xSize, CountInt ySize, CountInt zSize, CountInt startP, CountInt endP, UInt8 ti, UInt8 tN){
-    // number of YZ locations to look at
-    CountInt yzLocs = ySize * zSize;
-    // Number of ZY locations to do for this thread. divide YZ locations among threads. truncated to an integer
-    CountInt tPoints = yzLocs/tN;
-    // which point to start this thread on depends on thread number
-    CountInt inStartPos = startP + (ti * tPoints * xSize);
-    CountInt outStartPos = ti * tPoints;
-    // the last thread gets any left-over YZ locations
-    if (ti == tN - 1) tPoints += (yzLocs % tN);
-    // number of columns to do within each YZ location.
-    CountInt ColumnsToDo = endP - startP + 1;
-    // number to skip to get to start of next column at this ZY location
-    // number of points to get to next YZloc
-    CountInt toNextYZ = xSize - ColumnsToDo;
-    // pointers for loops
-    T *srcWave = srcWaveStart + inStartPos;
-    T *destWave = destWaveStart + outStartPos;
-    T *destWaveEnd;
-    T* lastColumn; // last column at this YZ location
-    if (ColumnsToDo == 1){ // getting a single slice
-        // adjust toNextYZ for lack of inner loop
-        toNextYZ += 1;
-        // loop through YZ locations
-        for (destWaveEnd = destWave + tPoints; destWave < destWaveEnd; destWave++, srcWave += toNextYZ){
-            // set destination to chosen column at this source ZY location
-            *destWave = *srcWave;
-        }
-    }else{ // doing a projection
-        switch(projMode){
-            case 0: // Minimum projection
-                // loop through YZ locations looking for minimum
-                for (destWaveEnd = destWave + tPoints; destWave < destWaveEnd; destWave++, srcWave += toNextYZ){
-                    // set destination to first column at this source ZY location
-                    *destWave = *srcWave;
-                    // check remining columns in source to find max
-                    for (lastColumn= srcWave + ColumnsToDo, srcWave++ ; srcWave < lastColumn; srcWave++){
-                        if (*srcWave < *destWave)
-                            *destWave = *srcWave;
-                    }
-                }
-                break;
-            case 1: // Maximum projection
-                // loop through YZ locations looking for maximum
-                for (destWaveEnd = destWave + tPoints; destWave < destWaveEnd; destWave++, srcWave += toNextYZ){
-                    // set destination to first column at this source ZY location
-                    *destWave = *srcWave;
-                    // check remining columns in source to find min
-                    for (lastColumn= srcWave + ColumnsToDo, srcWave++ ; srcWave < lastColumn; srcWave++){
-                        if (*srcWave > *destWave)
-                            *destWave = *srcWave;
-                    }
-                }
-                break;
-            case 2: // Average projection
-                double temp;
-                // loop through YZ locations calculating average, with double precision float
-                for (destWaveEnd = destWave + tPoints; destWave < destWaveEnd; destWave++, srcWave += toNextYZ){
-                    for (lastColumn= srcWave + ColumnsToDo, temp=0; srcWave < lastColumn; srcWave++){
-                        temp += *srcWave;
-                    }
-                    *destWave = temp/ColumnsToDo;
-                }
-                break;
-            case 3: // Median projection
-                T *bufferStart = (T*) WMNewPtr (ColumnsToDo * sizeof(T));
-                T *bufferPos;
-                // loop through YZ locations filling a buffer for calculating median
-                for (destWaveEnd = destWave + tPoints; destWave < destWaveEnd; destWave++, srcWave += toNextYZ){
-                    for (lastColumn= srcWave + ColumnsToDo, bufferPos =bufferStart; srcWave < lastColumn; srcWave++, bufferPos++){
-                        *bufferPos = *srcWave;
-                    }
-                    *destWave = medianT (ColumnsToDo, bufferStart);
-                }
-                WMDisposePtr ((Ptr)bufferStart);
-                break;
-        }
-    }
-}
-
-/* Y projection - looking for max/min within a range of rows at each XZ location
- result is wave with dim 0 = xSize, dim 1 =zSize
- Last Modified 2014/01/27 by Jamie Boyd */
-template <typename T> void doProjectY(T *srcWaveStart, T *destWaveStart, UInt8 projMode, CountInt xSize, CountInt ySize, CountInt zSize, CountInt startP, CountInt endP, UInt8 ti, UInt8 tN){
-    // number of layers to do in each thread = layers/threads.  truncated to an integer
-    // each layer needs to be in a single thread because offset to next XZ location is different at end of a layer
-    CountInt tLayers = zSize/tN;
-    // which point to start this thread on depends on thread number * layers Per Thread . ti is 0 based
-    CountInt inStartPos = (startP * xSize) + (ti * tLayers * xSize * ySize);
-    CountInt outStartPos = ti * tLayers * xSize;
-    // the last thread gets any left-over layers
-    if (ti == tN - 1) tLayers += (zSize % tN);
-    // number of rows to look at in each XZ location
-    CountInt rowsToDo = endP - startP + 1;
-    CountInt toNextRow = xSize; // number to add to get to next row at this YZ location
-    CountInt toNextColumn = 1 - (rowsToDo * xSize); // number to add to get to next YZ location in this column
-    CountInt toNextLayer = (xSize * ySize) - xSize; // number to add to get to first YZ location in the next layer
-    T *srcWave = srcWaveStart + inStartPos;
-    T *destWave = destWaveStart + outStartPos;
-    T* lastRow; // last row at this XZ location
-    T* lastColumn; //last row of last column in this layer
-    T* lastLayer; // last row of last column of last layer
-    if (rowsToDo == 1){ // getting a single slice
-        // adjust toNextColumn for lack of innermost loop
-        toNextColumn += toNextRow;
-        // loop through layers (z)
-        for (lastLayer = srcWave + (tLayers * xSize * ySize); srcWave < lastLayer; srcWave += toNextLayer){
-            // loop through columns (x) in this layer
-            for (lastColumn = srcWave + xSize; srcWave < lastColumn; srcWave += toNextColumn, destWave++){
-                // set destination to chosen column in source row
-                *destWave = *srcWave;
-            }
-        }
-    }else{ // doing a projection
-        switch (projMode) {
-            case 0:  // minimum projection
-                for (lastLayer = srcWave + (tLayers * xSize * ySize); srcWave < lastLayer; srcWave += toNextLayer){
-                    // loop through columns (x) in this layer
-                    for (lastColumn = srcWave + xSize; srcWave < lastColumn; srcWave += toNextColumn, destWave++){
-                        // set destination to first row in source column
-                        *destWave = *srcWave;
-                        // loop through remaining rows (y) in this column (x)
-                        for (lastRow = srcWave + (rowsToDo * xSize), srcWave += toNextRow;srcWave < lastRow; srcWave += toNextRow){
-                            if (*srcWave < *destWave) *destWave = *srcWave;
-                        }
-                    }
-                }
-                break;
-            case 1:  // max projection
-                for (lastLayer = srcWave + (tLayers * xSize * ySize); srcWave < lastLayer; srcWave += toNextLayer){
-                    // loop through columns (x) in this layer
-                    for (lastColumn = srcWave + xSize; srcWave < lastColumn; srcWave += toNextColumn, destWave++){
-                        // set destination to first row in source column
-                        *destWave = *srcWave;
-                        // loop through remaining rows (y) in this column (x)
-                        for (lastRow = srcWave + (rowsToDo * xSize), srcWave += toNextRow;srcWave < lastRow; srcWave += toNextRow){
-                            if (*srcWave > *destWave) *destWave = *srcWave;
-                        }
-                    }
-                }
-                break;
-            case 2: // Avg projection
-                double temp;
-                for (lastLayer = srcWave + (tLayers * xSize * ySize); srcWave < lastLayer; srcWave += toNextLayer){
-                    // loop through columns (x) in this layer
-                    for (lastColumn = srcWave + xSize; srcWave < lastColumn; srcWave += toNextColumn, destWave++){
-                        // loop through rows (y) in this column (x)
-                        for (lastRow = srcWave + (rowsToDo * xSize), temp=0;srcWave < lastRow; srcWave += toNextRow){
-                            temp += *srcWave;
-                        }
-                        *destWave = temp/rowsToDo;
-                    }
-                }
-                break;
-            case 3: // median proj
-                T *bufferStart = (T*)WMNewPtr(rowsToDo * sizeof(T));
-                T *bufferPos;
-                for (lastLayer = srcWave + (tLayers * xSize * ySize); srcWave < lastLayer; srcWave += toNextLayer){
-                    // loop through columns (x) in this layer
-                    for (lastColumn = srcWave + xSize; srcWave < lastColumn; srcWave += toNextColumn, destWave++){
-                        // loop through rows (y) in this column (x)
-                        for (lastRow = srcWave + (rowsToDo * xSize), bufferPos=bufferStart;srcWave < lastRow; srcWave += toNextRow, bufferPos++){
-                            *bufferPos = *srcWave;
-                        }
-                        *destWave = medianT (rowsToDo, bufferStart);
-                    }
-                }
-                WMDisposePtr ((Ptr)bufferStart);
-                break;
-        }
-        
-    }
-}
-
-/* Z projection - looking for max/min in range of layers at same XY location
- result is wave with dim 0 = xSize, dim 1 =ySize
- Last Modified 2013/01/27 by Jamie Boyd  */
-template <typename T> void doProjectZ(T *srcWaveStart, T *destWaveStart, UInt8 projMode, CountInt xSize, CountInt ySize, CountInt startP, CountInt endP, UInt8 ti, UInt8 tN){
-    // total number of XY locations to process
-    CountInt xyLocs = (xSize * ySize);
-    // divide XY locations among threads. XYlocs per thread = total number of XYlocs/number of threads, truncated to an integer
-    CountInt tPoints = xyLocs/tN;
-    // which point to start this thread on depends on thread number * XY locations Per Thread . ti is 0 based
-    CountInt inStartPos = (startP * xSize * ySize) + (ti * tPoints);
-    CountInt outStartPos = ti * tPoints;
-    // the last thread gets any left-over XY locations
-    if (ti == tN - 1) tPoints += (xyLocs % tN);
-    // number of layers to do within each XYloc, and number to skip to get to start of next layer at this XYlocs
-    CountInt layersToDo = endP - startP + 1;
-    CountInt toNextLayer = xSize * ySize;
-    // number of points to get to next XYloc
-    CountInt toNextXY = 1 - (layersToDo * xSize * ySize);
-    // pointers for loops
-    T *srcWave = srcWaveStart + inStartPos;
-    T *destWave = destWaveStart + outStartPos;
-    T *destWaveEnd;
-    T* lastLayer; // last layer at this XY location
-    if (layersToDo == 1){ // getting a single slice
-        //adjust toNextXY for lack of innermost loop
-        toNextXY += toNextLayer;
-        for (destWaveEnd = destWave + tPoints; destWave < destWaveEnd; destWave++, srcWave += toNextXY){
-            *destWave = *srcWave; // set destination to chosen layer in source
-        }
-    }else{ // a max or min projection
-        switch (projMode) {
-            case 0: // minimum projection
-                for (destWaveEnd = destWave + tPoints; destWave < destWaveEnd; destWave++, srcWave += toNextXY){
-                    *destWave = *srcWave; // set destination to first layer in source
-                    // check remining layers in source to find min
-                    for (lastLayer= srcWave + (layersToDo * toNextLayer), srcWave += toNextLayer ; srcWave < lastLayer; srcWave += toNextLayer){
-                        if (*srcWave < *destWave)
-                            *destWave = *srcWave;
-                    }
-                }
-                break;
-            case 1: // maximum projection
-                for (destWaveEnd = destWave + tPoints; destWave < destWaveEnd; destWave++, srcWave += toNextXY){
-                    *destWave = *srcWave; // set destination to first layer in source
-                    // check remining layers in source to find max
-                    for (lastLayer= srcWave + (layersToDo * toNextLayer), srcWave += toNextLayer ; srcWave < lastLayer; srcWave += toNextLayer){
-                        if (*srcWave > *destWave)
-                            *destWave = *srcWave;
-                    }
-                }
-                break;
-            case 2: // average projection
-                double temp;
-                for (destWaveEnd = destWave + tPoints; destWave < destWaveEnd; destWave++, srcWave += toNextXY){
-                    for (lastLayer= srcWave + (layersToDo * toNextLayer), temp =0; srcWave < lastLayer; srcWave += toNextLayer){
-                        temp += *srcWave;
-                    }
-                    *destWave = temp/layersToDo;
-                }
-                break;
-            case 3: // median projection
-                T *bufferStart = (T*) WMNewPtr (layersToDo * sizeof(T));
-                T *bufferPos;
-                for (destWaveEnd = destWave + tPoints; destWave < destWaveEnd; destWave++, srcWave += toNextXY){
-                    for (lastLayer= srcWave + (layersToDo * toNextLayer), bufferPos = bufferStart; srcWave < lastLayer; srcWave += toNextLayer, bufferPos++){
-                        *bufferPos = *srcWave;
-                    }
-                    *destWave = medianT (layersToDo, bufferStart);
-                }
-                WMDisposePtr ((Ptr)bufferStart);
-                break;
-        }
-    }
-}
-
-
-/*  Structure to pass data to each ProjectThread
- Last Modified 2013/07/16 by Jamie Boyd */
-typedef struct ProjectThreadParams{
-    int inPutWaveType; // WM codes for wave types
-    char* inPutDataStartPtr; // pointer to start of data in input wave
-    char* outPutDataStartPtr; // pointer to start of data in output wave (may be same as outPut wave)
-    UInt8 flatDim; // 0 for X projection, 1 for Y projection, 2 for Z projection
-    UInt8 projMode; // 1 for a maximum intensity projection, 0 for a minimum intensity projection
-    CountInt xSize; // size of X dimension (number of rows)
-    CountInt ySize; // size of Y dimension (number of columns)
-    CountInt zSize; // size of Z dimension (number of layers)
-    CountInt startP; // starting point for projection
-    CountInt endP; // end point for projection
-    UInt8 ti; // number of this thread, starting from 0
-    UInt8 tN; // total number of threads
-} ProjectThreadParams, *ProjectThreadParamsPtr;
-
-
-/* Each thread to do a maximum or minimum intensity projection through X,Y, or Z starts with this function
- Last Modified 2013/07/16 by Jamie Boyd */
-void* ProjectThread (void* threadarg){
-    struct ProjectThreadParams* p;
-    p = (struct ProjectThreadParams*) threadarg;
-    switch (p->flatDim){
-        case 0:  //Project X
-            switch(p->inPutWaveType){
-                case NT_I8:
-                    doProjectX((char*)p->inPutDataStartPtr, (char*)p->outPutDataStartPtr, p->projMode, p->xSize, p->ySize, p->zSize, p->startP, p->endP, p->ti, p->tN);
-                    break;
-                case (NT_I8 | NT_UNSIGNED):
-                    doProjectX((unsigned char*)p->inPutDataStartPtr , (unsigned char*)p->outPutDataStartPtr,  p->projMode, p->xSize, p->ySize, p->zSize, p->startP, p->endP, p->ti, p->tN);
-                    break;
-                case NT_I16:
-                    doProjectX((short*)p->inPutDataStartPtr, (short*)p->outPutDataStartPtr, p->projMode, p->xSize, p->ySize, p->zSize, p->startP, p->endP, p->ti, p->tN);
-                    break;
-                case (NT_I16 | NT_UNSIGNED):
-                    doProjectX((unsigned short*)p->inPutDataStartPtr , (unsigned short*)p->outPutDataStartPtr,  p->projMode, p->xSize, p->ySize, p->zSize, p->startP, p->endP, p->ti, p->tN);
-                    break;
-                case NT_I32:
-                    doProjectX((long*)p->inPutDataStartPtr, (long*)p->outPutDataStartPtr, p->projMode, p->xSize, p->ySize, p->zSize, p->startP, p->endP, p->ti, p->tN);
-                    break;
-                case (NT_I32| NT_UNSIGNED):
-                    doProjectX((unsigned long*)p->inPutDataStartPtr, (unsigned long*)p->outPutDataStartPtr, p->projMode, p->xSize, p->ySize, p->zSize, p->startP, p->endP, p->ti, p->tN);
-                    break;
-                case NT_FP32:
-                    doProjectX((float*)p->inPutDataStartPtr, (float*)p->outPutDataStartPtr, p->projMode, p->xSize, p->ySize, p->zSize, p->startP, p->endP, p->ti, p->tN);
-                    break;
-                case NT_FP64:
-                    doProjectX((double*)p->inPutDataStartPtr, (double*)p->outPutDataStartPtr,  p->projMode, p->xSize, p->ySize, p->zSize, p->startP, p->endP, p->ti, p->tN);
-                    break;
-            }
-            break;
-        case 1: //Project Y
-            switch(p->inPutWaveType){
-                case NT_I8:
-                    doProjectY((char*)p->inPutDataStartPtr, (char*)p->outPutDataStartPtr, p->projMode, p->xSize, p->ySize, p->zSize, p->startP, p->endP, p->ti, p->tN);
-                    break;
-                case (NT_I8 | NT_UNSIGNED):
-                    doProjectY((unsigned char*)p->inPutDataStartPtr , (unsigned char*)p->outPutDataStartPtr,  p->projMode, p->xSize, p->ySize, p->zSize, p->startP, p->endP, p->ti, p->tN);
-                    break;
-                case NT_I16:
-                    doProjectY((short*)p->inPutDataStartPtr, (short*)p->outPutDataStartPtr, p->projMode, p->xSize, p->ySize, p->zSize, p->startP, p->endP, p->ti, p->tN);
-                    break;
-                case (NT_I16 | NT_UNSIGNED):
-                    doProjectY((unsigned short*)p->inPutDataStartPtr , (unsigned short*)p->outPutDataStartPtr,  p->projMode, p->xSize, p->ySize, p->zSize, p->startP, p->endP, p->ti, p->tN);
-                    break;
-                case NT_I32:
-                    doProjectY((long*)p->inPutDataStartPtr, (long*)p->outPutDataStartPtr, p->projMode, p->xSize, p->ySize, p->zSize, p->startP, p->endP, p->ti, p->tN);
-                    break;
-                case (NT_I32| NT_UNSIGNED):
-                    doProjectY((unsigned long*)p->inPutDataStartPtr, (unsigned long*)p->outPutDataStartPtr, p->projMode, p->xSize, p->ySize, p->zSize, p->startP, p->endP, p->ti, p->tN);
-                    break;
-                case NT_FP32:
-                    doProjectY((float*)p->inPutDataStartPtr, (float*)p->outPutDataStartPtr, p->projMode, p->xSize, p->ySize, p->zSize, p->startP, p->endP, p->ti, p->tN);
-                    break;
-                case NT_FP64:
-                    doProjectY((double*)p->inPutDataStartPtr, (double*)p->outPutDataStartPtr,  p->projMode, p->xSize, p->ySize, p->zSize, p->startP, p->endP, p->ti, p->tN);
-                    break;
-            }
-            break;
-        case 2: // Project Z
-            switch(p->inPutWaveType){
-                case NT_I8:
-                    doProjectZ((char*)p->inPutDataStartPtr, (char*)p->outPutDataStartPtr, p->projMode, p->xSize, p->ySize, p->startP, p->endP, p->ti, p->tN);
-                    break;
-                case (NT_I8 | NT_UNSIGNED):
-                    doProjectZ((unsigned char*)p->inPutDataStartPtr , (unsigned char*)p->outPutDataStartPtr,  p->projMode, p->xSize, p->ySize, p->startP, p->endP, p->ti, p->tN);
-                    break;
-                case NT_I16:
-                    doProjectZ((short*)p->inPutDataStartPtr, (short*)p->outPutDataStartPtr, p->projMode, p->xSize, p->ySize, p->startP, p->endP, p->ti, p->tN);
-                    break;
-                case (NT_I16 | NT_UNSIGNED):
-                    doProjectZ((unsigned short*)p->inPutDataStartPtr , (unsigned short*)p->outPutDataStartPtr,  p->projMode, p->xSize, p->ySize, p->startP, p->endP, p->ti, p->tN);
-                    break;
-                case NT_I32:
-                    doProjectZ((long*)p->inPutDataStartPtr, (long*)p->outPutDataStartPtr, p->projMode, p->xSize, p->ySize, p->startP, p->endP, p->ti, p->tN);
-                    break;
-                case (NT_I32| NT_UNSIGNED):
-                    doProjectZ((unsigned long*)p->inPutDataStartPtr, (unsigned long*)p->outPutDataStartPtr, p->projMode, p->xSize, p->ySize, p->startP, p->endP, p->ti, p->tN);
-                    break;
-                case NT_FP32:
-                    doProjectZ((float*)p->inPutDataStartPtr, (float*)p->outPutDataStartPtr, p->projMode, p->xSize, p->ySize, p->startP, p->endP, p->ti, p->tN);
-                    break;
-                case NT_FP64:
-                    doProjectZ((double*)p->inPutDataStartPtr, (double*)p->outPutDataStartPtr,  p->projMode, p->xSize, p->ySize, p->startP, p->endP, p->ti, p->tN);
-                    break;
-            }
-            break;
-    }
-    return 0;
-}
-
 
 /* ProjectSpecFrames XOP entry function
  Makes a projection image of a specified range of columns or rows or layers in the input wave and puts
@@ -401,8 +30,10 @@ void* ProjectThread (void* threadarg){
  double inPutEndLayer       end of range of layers to project
  double inPutStartLayer     start of range of layers to project
  waveHndl inPutWaveH        handle to the input wave
- Last Modified 2025/06/25 by Jamie Boyd */
-extern "C" int ProjectSpecFrames (ProjectSpecFramesParamsPtr p){
+ percentile is 0 to 100 from ProjectPercentileSpecFrames, which passes isPercentile set and projMode 4, and is unused
+ from ProjectSpecFrames
+ Last Modified 2026/10/16 */
+static int ProjectSpecFramesDo (ProjectSpecFramesParamsPtr p, double percentile, UInt8 isPercentile){
     int result =0;                                  // The error returned from various Wavemetrics functions
     waveHndl inPutWaveH = NIL, outPutWaveH = NIL;   // Handles to the input and output waves
     int inPutWaveType, outPutWaveType;              // Wavetypes numeric codes for things like 32 bit floating point, 16 bit int, etc
@@ -415,13 +46,13 @@ extern "C" int ProjectSpecFrames (ProjectSpecFramesParamsPtr p){
     CountInt endP = p->inPutEndLayer;                // ending Z (or X or Y) positon for projection
     CountInt outPutP = p->outPutLayer;               // Z (or X or Y) layer in output wave that get result of projection
     UInt8 flatDimension = p->flatDimension;          // dimension along which flattening occurs. 0 = X, 1 =Y, 2 = Z
-    UInt8 iThread;                                   // number of each thread, starting from 0
-    UInt8 nThreads;                                  // total number of threads
-    ProjectThreadParamsPtr paramArrayPtr = nullptr;  // array of params for threading
-    pthread_t* threadsPtr;                           // array of pthreads
+    ProjectThreadParams params;                      // paramaters for the tiles
+    XFuncTimer timer;  // times each phase of this call, for TwoPhotonStats
+    XFuncTimerStart (&timer, isPercentile ? STATS_PROJECTPERCENTILESPECFRAMES : STATS_PROJECTSPECFRAMES);
     try {
-        // check projection mode
-        if ((p->projMode < 0) || (p->projMode > 3)) throw result = BADDSTYPE;
+        // check projection mode, and percentile for percentile projections
+        if ((p->projMode < 0) || (p->projMode > (isPercentile ? 4 : 3))) throw result = BADDSTYPE;
+        if ((isPercentile) && !((percentile >= 0) && (percentile <= 100))) throw result = BADPERCENTILE;
         // Get handle to input and output waves make sure they exist.
         inPutWaveH = p->inPutWaveH;
         if (inPutWaveH == NIL) throw result= NON_EXISTENT_WAVE;
@@ -471,16 +102,8 @@ extern "C" int ProjectSpecFrames (ProjectSpecFramesParamsPtr p){
         srcWaveStart = (char*)(*inPutWaveH) + inPutWaveOffset;
         if (MDAccessNumericWaveData(outPutWaveH, kMDWaveAccessMode0, &outPutWaveOffset)) throw result = WAVEERROR_NOS;
         destWaveStart = (char*)(*outPutWaveH) + outPutWaveOffset;
-        // make an array of parameter structures
-        nThreads = gNumProcessors;
-        paramArrayPtr = (ProjectThreadParamsPtr)WMNewPtr (nThreads * sizeof(ProjectThreadParams));
-        if (paramArrayPtr == nullptr) throw result = MEMFAIL;
-        // make an array of pthread_t
-        threadsPtr =(pthread_t*)WMNewPtr(nThreads * sizeof(pthread_t));
-        if (threadsPtr == nullptr) throw result = MEMFAIL;
     }catch (int result){
-        if (threadsPtr != nullptr) WMDisposePtr ((Ptr)threadsPtr);
-        if (paramArrayPtr != nullptr) WMDisposePtr ((Ptr)paramArrayPtr);
+        XFuncTimerEnd (&timer);
         p -> result = (double)(result - FIRST_XOP_ERR);
 #ifdef NO_IGOR_ERR
         return (0);
@@ -488,7 +111,8 @@ extern "C" int ProjectSpecFrames (ProjectSpecFramesParamsPtr p){
         return (result);
 #endif
     }
-    // fill paramater array
+    XFuncTimerPhase (&timer, STATS_THREADS);
+    // fill paramater structure
     switch(outPutWaveType){
         case NT_I8:
         case (NT_I8 | NT_UNSIGNED):
@@ -500,7 +124,7 @@ extern "C" int ProjectSpecFrames (ProjectSpecFramesParamsPtr p){
             break;
         case NT_I32:
         case (NT_I32 | NT_UNSIGNED):
-            destWaveStart += sizeof(long) * (outPutP * outPutDimensionSizes[0] * outPutDimensionSizes [1]);
+            destWaveStart += sizeof(SInt32) * (outPutP * outPutDimensionSizes[0] * outPutDimensionSizes [1]);
             break;
         case NT_FP32:
             destWaveStart += sizeof(float) * (outPutP * outPutDimensionSizes[0] * outPutDimensionSizes [1]);
@@ -509,35 +133,67 @@ extern "C" int ProjectSpecFrames (ProjectSpecFramesParamsPtr p){
             destWaveStart += sizeof(double) * (outPutP * outPutDimensionSizes[0] * outPutDimensionSizes [1]);
             break;
     }
-    for (iThread = 0; iThread < nThreads; iThread++){
-        paramArrayPtr[iThread].inPutWaveType = inPutWaveType;
-        paramArrayPtr[iThread].inPutDataStartPtr = srcWaveStart;
-        paramArrayPtr[iThread].outPutDataStartPtr = destWaveStart;
-        paramArrayPtr[iThread].flatDim = flatDimension;
-        paramArrayPtr[iThread].projMode = p->projMode;
-        paramArrayPtr[iThread].xSize = inPutDimensionSizes [0];
-        paramArrayPtr[iThread].ySize = inPutDimensionSizes [1];
-        paramArrayPtr[iThread].zSize =inPutDimensionSizes [2];
-        paramArrayPtr[iThread].startP = startP;
-        paramArrayPtr[iThread].endP= endP;
-        paramArrayPtr[iThread].ti=iThread; // number of this thread, starting from 0
-        paramArrayPtr[iThread].tN =nThreads; // total number of threads
-    }
-    // create the threads
-    for (iThread = 0; iThread < nThreads; iThread++){
-        pthread_create (&threadsPtr[iThread], NULL, ProjectThread, (void *) &paramArrayPtr[iThread]);
-    }
-    //join threads
-    for (iThread = 0; iThread < nThreads; iThread++){
-        pthread_join (threadsPtr[iThread], NULL);
+    params.inPutWaveType = inPutWaveType;
+    params.inPutDataStartPtr = srcWaveStart;
+    params.outPutDataStartPtr = destWaveStart;
+    params.flatDim = flatDimension;
+    params.projMode = p->projMode;
+    params.percentile = percentile;
+    params.xSize = inPutDimensionSizes [0];
+    params.ySize = inPutDimensionSizes [1];
+    params.zSize =inPutDimensionSizes [2];
+    params.startP = startP;
+    params.endP= endP;
+    // run the tiles on the thread pool, and wait till they are all finished
+    XFuncTimerPhase (&timer, STATS_COMPUTE);
+    if ((result = ProjectRunTiles (&params, (inPutWaveH == outPutWaveH))) != 0){
+        XFuncTimerEnd (&timer);
+        p -> result = (double)(result - FIRST_XOP_ERR);
+#ifdef NO_IGOR_ERR
+        return (0);
+#else
+        return (result);
+#endif
     }
-    WMDisposePtr ((Ptr)threadsPtr);     // free memory for pThreads Array
-    WMDisposePtr ((Ptr)paramArrayPtr);   // Free paramaterArray memory
+    XFuncTimerPhase (&timer, STATS_FINISH);
     WaveHandleModified(outPutWaveH);     // Inform Igor that we have changed the output wave.
     p->result= (0);
+    XFuncTimerEnd (&timer);
     return (0);
 }
 
+extern "C" int ProjectSpecFrames (ProjectSpecFramesParamsPtr p){
+    return ProjectSpecFramesDo (p, 0, 0);
+}
+
+/* ProjectPercentileSpecFrames XOP entry function
+ Makes a percentile projection of a specified range of columns or rows or layers in the input wave, as ProjectSpecFrames
+ does for the other projections, selecting the value at the given percentile of the points flattened at each pixel
+ ProjectPercentileSpecFramesParams
+ double percentile          0 to 100, the percentile to select, else BADPERCENTILE
+ double flatDimension       the dimension that we are projecting along
+ double outPutLayer         the layer in the output wave that receives the projection
+ waveHndl outPutWaveH       A handle to output wave
+ double inPutEndLayer       end of range of layers to project
+ double inPutStartLayer     start of range of layers to project
+ waveHndl inPutWaveH        handle to the input wave
+ Last Modified 2026/10/16 */
+extern "C" int ProjectPercentileSpecFrames (ProjectPercentileSpecFramesParamsPtr p){
+    ProjectSpecFramesParams specParams;
+    int result;
+    specParams.projMode = 4;
+    specParams.flatDimension = p->flatDimension;
+    specParams.outPutLayer = p->outPutLayer;
+    specParams.outPutWaveH = p->outPutWaveH;
+    specParams.inPutEndLayer = p->inPutEndLayer;
+    specParams.inPutStartLayer = p->inPutStartLayer;
+    specParams.inPutWaveH = p->inPutWaveH;
+    specParams.tp = p->tp;
+    result = ProjectSpecFramesDo (&specParams, p->percentile, 1);
+    p->result = specParams.result;
+    return (result);
+}
+
 /* ProjectAllFrames XOP entry function
  Makes a projection Image of all columns or rows or layers in the input wave and makes a 2D wave to receive result
  ProjectAllFramesParams
@@ -546,8 +202,10 @@ extern "C" int ProjectSpecFrames (ProjectSpecFramesParamsPtr p){
  double flatDimension        Which dimension we want to collapse on, 0 for x, 1 for y, 2 for z
  double overwrite            0 to give errors when wave already exists. non-zero to cheerfully overwrite existing wave.
  double projMode             0 = mimimum intensity projection, 1 =maximum intensity projection, 2 = avg, 3 = median
- Last Modified 2025/06/25 by Jamie Boyd */
-extern "C" int ProjectAllFrames (ProjectAllFramesParamsPtr p){
+ percentile is 0 to 100 from ProjectPercentileAllFrames, which passes isPercentile set and projMode 4, and is unused
+ from ProjectAllFrames
+ Last Modified 2026/10/16 */
+static int ProjectAllFramesDo (ProjectAllFramesParamsPtr p, double percentile, UInt8 isPercentile){
     int result = 0;                                     // for error codes
     waveHndl inPutWaveH, outPutWaveH;                   // Handles to the input and output waves
     int waveType;                                       //  Wavetypes numeric codes for things like 32 bit floating point, 16 bit int, etc
@@ -564,14 +222,14 @@ extern "C" int ProjectAllFrames (ProjectAllFramesParamsPtr p){
     UInt8 flatDimension = p->flatDimension;             // dimension along which flattening occurs. 0 = X, 1 =Y, 2 = Z
     UInt8 flatten = 0;                                  // set if overwriting input wave, i.e., we flatten it
     CountInt endP;                                      // start point is always = 0, end point is dimension size - 1
-    UInt8 iThread;                                      // number of each thread, starting from 0
-    UInt8 nThreads;                                     // total number of threads
-    ProjectThreadParamsPtr paramArrayPtr = nullptr;     // array of params for threading
-    pthread_t* threadsPtr = nullptr;                    // array of pthreads
+    ProjectThreadParams params;                         // paramaters for the tiles
     int overWrite= p->overwrite;
+    XFuncTimer timer;  // times each phase of this call, for TwoPhotonStats
+    XFuncTimerStart (&timer, isPercentile ? STATS_PROJECTPERCENTILEALLFRAMES : STATS_PROJECTALLFRAMES);
     try{
-        // check projection mode
-        if ((p->projMode < 0) || (p->projMode > 3)) throw result = BADDSTYPE;
+        // check projection mode, and percentile for percentile projections
+        if ((p->projMode < 0) || (p->projMode > (isPercentile ? 4 : 3))) throw result = BADDSTYPE;
+        if ((isPercentile) && !((percentile >= 0) && (percentile <= 100))) throw result = BADPERCENTILE;
         // Get handle to input wave make sure it exists.
         inPutWaveH = p->inPutWaveH;
         if (inPutWaveH == NIL) throw result = NON_EXISTENT_WAVE;
@@ -628,7 +286,9 @@ extern "C" int ProjectAllFrames (ProjectAllFramesParamsPtr p){
                 outPutWaveH = inPutWaveH;
             }else{
                 // make the output wave
+                XFuncTimerPhase (&timer, STATS_MAKEWAVE);
                 if (MDMakeWave (&outPutWaveH, outPutWaveName, outPutDFHandle, outPutDimensionSizes,waveType, overWrite)) throw result = WAVEERROR_NOS;
+                XFuncTimerPhase (&timer, STATS_THREADS);
             }
         }
         // Get the offsets to the data in the input and output waves
@@ -636,16 +296,8 @@ extern "C" int ProjectAllFrames (ProjectAllFramesParamsPtr p){
         srcWaveStart = (char*)(*inPutWaveH) + inPutWaveOffset;
         if (MDAccessNumericWaveData(outPutWaveH, kMDWaveAccessMode0, &outPutWaveOffset)) throw result = WAVEERROR_NOS;
         destWaveStart = (char*)(*outPutWaveH) + outPutWaveOffset;
-        // make an array of parameter structures
-        nThreads = gNumProcessors;
-        paramArrayPtr = (ProjectThreadParamsPtr)WMNewPtr (nThreads * sizeof(ProjectThreadParams));
-        if (paramArrayPtr == nullptr) throw result = MEMFAIL;
-        // make an array of pthread_t
-        threadsPtr =(pthread_t*)WMNewPtr(nThreads * sizeof(pthread_t));
-        if (threadsPtr == nullptr) throw result = MEMFAIL;
     }catch (int (result)){
-        if (threadsPtr != nullptr) WMDisposePtr ((Ptr)threadsPtr);
-        if (paramArrayPtr != nullptr) WMDisposePtr ((Ptr)paramArrayPtr);
+        XFuncTimerEnd (&timer);
         p -> result = (double)(result - FIRST_XOP_ERR);
 #ifdef NO_IGOR_ERR
         return (0);
@@ -653,31 +305,33 @@ extern "C" int ProjectAllFrames (ProjectAllFramesParamsPtr p){
         return (result);
 #endif
     }
-    // fill param array struct
-    for (iThread = 0; iThread < nThreads; iThread++){
-        paramArrayPtr[iThread].inPutWaveType = waveType;
-        paramArrayPtr[iThread].inPutDataStartPtr = srcWaveStart;
-        paramArrayPtr[iThread].outPutDataStartPtr = destWaveStart;
-        paramArrayPtr[iThread].flatDim = flatDimension;
-        paramArrayPtr[iThread].projMode = p->projMode;
-        paramArrayPtr[iThread].xSize = inPutDimensionSizes [0];
-        paramArrayPtr[iThread].ySize = inPutDimensionSizes [1];
-        paramArrayPtr[iThread].zSize =inPutDimensionSizes [2];
-        paramArrayPtr[iThread].startP = 0;
-        paramArrayPtr[iThread].endP= endP;
-        paramArrayPtr[iThread].ti=iThread; // number of this thread, starting from 0
-        paramArrayPtr[iThread].tN =nThreads; // total number of threads
-    }
-    // create the threads
-    for (iThread = 0; iThread < nThreads; iThread++){
-        pthread_create (&threadsPtr[iThread], NULL, ProjectThread, (void *) &paramArrayPtr[iThread]);
-    }
-    //join the threads
-    for (iThread = 0; iThread < nThreads; iThread++){
-        pthread_join (threadsPtr[iThread], NULL);
+    XFuncTimerPhase (&timer, STATS_THREADS);
+    // fill paramater structure
+    params.inPutWaveType = waveType;
+    params.inPutDataStartPtr = srcWaveStart;
+    params.outPutDataStartPtr = destWaveStart;
+    params.flatDim = flatDimension;
+    params.projMode = p->projMode;
+    params.percentile = percentile;
+    params.xSize = inPutDimensionSizes [0];
+    params.ySize = inPutDimensionSizes [1];
+    params.zSize =inPutDimensionSizes [2];
+    params.startP = 0;
+    params.endP= endP;
+    // run the tiles on the thread pool, and wait till they are all finished
+    XFuncTimerPhase (&timer, STATS_COMPUTE);
+    if ((result = ProjectRunTiles (&params, flatten)) != 0){
+        XFuncTimerEnd (&timer);
+        if (p->outPutPath)
+            WMDisposeHandle(p->outPutPath);
+        p -> result = (double)(result - FIRST_XOP_ERR);
+#ifdef NO_IGOR_ERR
+        return (0);
+#else
+        return (result);
+#endif
     }
-    WMDisposePtr ((Ptr)threadsPtr);     // free memory for pThreads Array
-    WMDisposePtr ((Ptr)paramArrayPtr);   // Free paramaterArray memory
+    XFuncTimerPhase (&timer, STATS_FINISH);
     if (flatten){
         MDChangeWave (outPutWaveH, -1, outPutDimensionSizes);
     }
@@ -685,6 +339,275 @@ extern "C" int ProjectAllFrames (ProjectAllFramesParamsPtr p){
     if (p->outPutPath)
         WMDisposeHandle(p->outPutPath);
     p->result = (0);
+    XFuncTimerEnd (&timer);
+    return (0);
+}
+
+extern "C" int ProjectAllFrames (ProjectAllFramesParamsPtr p){
+    return ProjectAllFramesDo (p, 0, 0);
+}
+
+/* ProjectPercentileAllFrames XOP entry function
+ Makes a percentile projection of all columns or rows or layers in the input wave into a new 2D wave, as
+ ProjectAllFrames does for the other projections, selecting the value at the given percentile of the points flattened
+ at each pixel, e.g., 10 for a baseline F0 image
+ ProjectPercentileAllFramesParams
+ waveHndl inPutWaveH         handle to the input wave
+ Handle outPutPath           A handle to a string containing path to output wave we want to make
+ double flatDimension        Which dimension we want to collapse on, 0 for x, 1 for y, 2 for z
+ double overwrite            0 to give errors when wave already exists. non-zero to cheerfully overwrite existing wave.
+ double percentile           0 to 100, the percentile to select, else BADPERCENTILE
+ Last Modified 2026/10/16 */
+extern "C" int ProjectPercentileAllFrames (ProjectPercentileAllFramesParamsPtr p){
+    ProjectAllFramesParams allParams;
+    int result;
+    allParams.projMode = 4;
+    allParams.overwrite = p->overwrite;
+    allParams.flatDimension = p->flatDimension;
+    allParams.outPutPath = p->outPutPath;
+    allParams.inPutWaveH = p->inPutWaveH;
+    allParams.tp = p->tp;
+    result = ProjectAllFramesDo (&allParams, p->percentile, 1);
+    p->result = allParams.result;
+    return (result);
+}
+
+/* ProjectMulti XOP entry function
+ Makes several projections of all the columns, rows or layers of the input wave at once, as layers of a new 3D wave, in
+ one pass through the input, in place of a call to ProjectAllFrames for each projection. statMask adds together the
+ statistics to make: 1 = minimum, 2 = maximum, 4 = mean, 8 = standard deviation, 16 = sum, 32 = argmax, the position of
+ the first maximum along the flattened dimension, and 64 = median. Output layers are in that order, for the statistics
+ chosen, and are labelled min, max, mean, stdDev, sum, argMax and median. The standard deviation divides by the number of
+ points - 1. The output is single precision floating point for 8 and 16 bit and single precision waves, and double
+ precision for 32 bit and double precision waves, or whenever the sum is asked for, so sums of many layers are exact
+ ProjectMultiParams
+ waveHndl inPutWaveH         handle to a 3D input wave
+ Handle outPutPath           A handle to a string containing path to output wave we want to make
+ double flatDimension        Which dimension we want to collapse on, 0 for x, 1 for y, 2 for z
+ double statMask             statistics to make, added together, a whole number from 1 to 127, else BADSTATMASK
+ double overWrite            0 to give errors when wave already exists. non-zero to overwrite existing wave without warning.
+ Last Modified 2026/10/16 */
+extern "C" int ProjectMulti (ProjectMultiParamsPtr p){
+    int result = 0;                                     // for error codes
+    waveHndl inPutWaveH, outPutWaveH;                   // Handles to the input and output waves
+    int waveType;                                       //  Wavetypes numeric codes for things like 32 bit floating point, 16 bit int, etc
+    int numDimensions;                                  //number of Dimensions in input wave
+    CountInt inPutDimensionSizes[MAX_DIMENSIONS+1];     // an array used to hold wave width, height, layers, and chunk sizes of input wave
+    CountInt outPutDimensionSizes[MAX_DIMENSIONS+1];    // an array used to hold wave width, height, layers, and chunk sizes of output wave
+    DataFolderHandle outPutDFHandle=nullptr;            // Handle to the datafolder where we will put the output wave
+    DataFolderHandle inPutDFHandle=nullptr;             // Handle to datafolder for input wave, used to test if overwriting a wave
+    DFPATH inPutPath, outPutPath;                       // C string to hold data folder path of output wave
+    WVNAME inPutWaveName, outPutWaveName;               // C string to hold name of output wave
+    CountInt inPutWaveOffset, outPutWaveOffset;         //offset in bytes from begnning of handle to a wave to the actual data
+    UInt8 flatDimension = p->flatDimension;             // dimension along which flattening occurs. 0 = X, 1 =Y, 2 = Z
+    UInt32 statMask;                                    // PROJECT_STAT bits for the statistics to make
+    int overWrite= (p->overWrite != 0);
+    const char* layerLabels [PROJECT_STAT_NUM] = {"min", "max", "mean", "stdDev", "sum", "argMax", "median"};
+    int iStat, iLayer;
+    ProjectMultiThreadParams params;                    // paramaters for the tiles
+    XFuncTimer timer;  // times each phase of this call, for TwoPhotonStats
+    XFuncTimerStart (&timer, STATS_PROJECTMULTI);
+    try{
+        // check the statistics asked for
+        if ((p->statMask < 1) || (p->statMask >= (1 << PROJECT_STAT_NUM)) || (p->statMask != (UInt32)p->statMask)) throw result = BADSTATMASK;
+        statMask = (UInt32)p->statMask;
+        // Get handle to input wave make sure it exists.
+        inPutWaveH = p->inPutWaveH;
+        if (inPutWaveH == NIL) throw result = NON_EXISTENT_WAVE;
+        // Get wave data type and check that we don't have a text wave
+        waveType = WaveType(inPutWaveH);
+        if (waveType==TEXT_WAVE_TYPE) throw result = NOTEXTWAVES;
+        // Get number of used numDimensions in input wave, and check that input wave is 3D
+        if (MDGetWaveDimensions(inPutWaveH, &numDimensions, inPutDimensionSizes)) throw result = WAVEERROR_NOS;
+        if (numDimensions != 3) throw result = INPUTNEEDS_3D_WAVE;
+        // Set the sizes of the output wave as appropriate for the dimension we want to squish
+        switch (flatDimension){
+            case 0:    // X projection  output is dim [0] = y-size, dim [1] = z-Size
+                outPutDimensionSizes [0] = inPutDimensionSizes [1];
+                outPutDimensionSizes [1] = inPutDimensionSizes [2];
+                break;
+            case 1:// Y projection  output is dim [0] = x-size, dim [1] = z-Size
+                outPutDimensionSizes [0] = inPutDimensionSizes [0];
+                outPutDimensionSizes [1] = inPutDimensionSizes [2];
+                break;
+            case 2:    //z dimension
+                outPutDimensionSizes [0] = inPutDimensionSizes [0];
+                outPutDimensionSizes [1] = inPutDimensionSizes [1];
+                break;
+            default:
+                throw result = BADDIMENSION;
+                break;
+        }
+        // a layer for each statistic
+        for (iStat = 0, outPutDimensionSizes [2] = 0; iStat < PROJECT_STAT_NUM; iStat++){
+            if (statMask & (1 << iStat)) outPutDimensionSizes [2]++;
+        }
+        outPutDimensionSizes [3] = 0;
+        // output wave is always a new wave, of a different type than the input wave
+        if (WMGetHandleSize (p->outPutPath) == 0) throw result = OVERWRITEALERT;
+        ParseWavePath (p->outPutPath, outPutPath, outPutWaveName);
+        // Clean up wave name: no liberal names
+        CleanupName (0, outPutWaveName, MAX_OBJ_NAME);
+        //check that data folder is valid and get a handle to the datafolder
+        if (GetNamedDataFolder (NULL, outPutPath, &outPutDFHandle))throw result = WAVEERROR_NOS;
+        // Test name and data folder for output wave against the input wave to prevent overwriting the input wave
+        WaveName (inPutWaveH, inPutWaveName);
+        if (GetWavesDataFolder (inPutWaveH, &inPutDFHandle)) throw result = WAVEERROR_NOS;
+        if (GetDataFolderNameOrPath (inPutDFHandle, 1, inPutPath)) throw result = WAVEERROR_NOS;
+        if ((CmpStr (inPutPath,outPutPath) ==0) && (CmpStr (inPutWaveName,outPutWaveName) ==0)) throw result = OVERWRITEALERT;
+        // make the output wave, and label its layers
+        XFuncTimerPhase (&timer, STATS_MAKEWAVE);
+        if (MDMakeWave (&outPutWaveH, outPutWaveName, outPutDFHandle, outPutDimensionSizes, ProjectMultiOutPutType (waveType, statMask), overWrite)) throw result = WAVEERROR_NOS;
+        for (iStat = 0, iLayer = 0; iStat < PROJECT_STAT_NUM; iStat++){
+            if (statMask & (1 << iStat)){
+                MDSetDimensionLabel (outPutWaveH, LAYERS, iLayer, (char*)layerLabels [iStat]);
+                iLayer++;
+            }
+        }
+        XFuncTimerPhase (&timer, STATS_THREADS);
+        // Get the offsets to the data in the input and output waves
+        if (MDAccessNumericWaveData(inPutWaveH, kMDWaveAccessMode0, &inPutWaveOffset)) throw result = WAVEERROR_NOS;
+        if (MDAccessNumericWaveData(outPutWaveH, kMDWaveAccessMode0, &outPutWaveOffset)) throw result = WAVEERROR_NOS;
+        // fill paramater structure
+        params.inPutWaveType = waveType;
+        params.inPutDataStartPtr = (char*)(*inPutWaveH) + inPutWaveOffset;
+        params.outPutDataStartPtr = (char*)(*outPutWaveH) + outPutWaveOffset;
+        params.flatDim = flatDimension;
+        params.statMask = statMask;
+        params.xSize = inPutDimensionSizes [0];
+        params.ySize = inPutDimensionSizes [1];
+        params.zSize = inPutDimensionSizes [2];
+        // run the tiles on the thread pool, and wait till they are all finished
+        XFuncTimerPhase (&timer, STATS_COMPUTE);
+        if ((result = ProjectMultiRunTiles (&params)) != 0) throw result;
+    }catch (int result){
+        XFuncTimerEnd (&timer);
+        WMDisposeHandle(p->outPutPath);  // dispose passed in string paramater
+        p -> result = (double)(result - FIRST_XOP_ERR);
+#ifdef NO_IGOR_ERR
+        return (0);
+#else
+        return (result);
+#endif
+    }
+    XFuncTimerPhase (&timer, STATS_FINISH);
+    WMDisposeHandle(p->outPutPath);    // dispose passed in string paramater
+    WaveHandleModified(outPutWaveH);     // Inform Igor that we have changed the output wave.
+    p->result = (0);
+    XFuncTimerEnd (&timer);
+    return (0);
+}
+
+/* ProjectDepth XOP entry function
+ Makes a maximum and/or minimum Z projection of all the layers of a 3D wave into a new wave of the same type, and a new
+ 32 bit integer wave of the layer of the first maximum and/or minimum at each XY location, for depth coded images and for
+ finding the plane in focus. Both are made in the same pass through the input. With both maximum and minimum, each output
+ wave has two layers, labelled max and min, and argMax and argMin
+ ProjectDepthParams
+ waveHndl inPutWaveH         handle to a 3D input wave
+ Handle outPutPath           A handle to a string containing path to the projection wave we want to make
+ Handle indexPath            A handle to a string containing path to the wave of layers we want to make
+ double projMode             0 = minimum, 1 = maximum, 2 = both
+ double overWrite            0 to give errors when waves already exist. non-zero to overwrite existing waves without warning.
+ Last Modified 2026/10/16 */
+extern "C" int ProjectDepth (ProjectDepthParamsPtr p){
+    int result = 0;                                     // for error codes
+    waveHndl inPutWaveH, outPutWaveH, indexWaveH;       // Handles to the input and output waves
+    int waveType;                                       //  Wavetypes numeric codes for things like 32 bit floating point, 16 bit int, etc
+    int numDimensions;                                  //number of Dimensions in input wave
+    CountInt inPutDimensionSizes[MAX_DIMENSIONS+1];     // an array used to hold wave width, height, layers, and chunk sizes of input wave
+    CountInt outPutDimensionSizes[MAX_DIMENSIONS+1];    // an array used to hold wave width, height, layers, and chunk sizes of output waves
+    DataFolderHandle outPutDFHandle=nullptr;            // Handle to the datafolder where we will put the projection wave
+    DataFolderHandle indexDFHandle=nullptr;             // Handle to the datafolder where we will put the wave of layers
+    DataFolderHandle inPutDFHandle=nullptr;             // Handle to datafolder for input wave, used to test if overwriting a wave
+    DFPATH inPutPath, outPutPath, indexPath;            // C strings to hold data folder paths of input and output waves
+    WVNAME inPutWaveName, outPutWaveName, indexWaveName; // C strings to hold names of input and output waves
+    CountInt inPutWaveOffset, outPutWaveOffset, indexWaveOffset; //offset in bytes from begnning of handle to a wave to the actual data
+    UInt8 projMode;                                     // 0 = minimum, 1 = maximum, 2 = both
+    int overWrite= (p->overWrite != 0);
+    ProjectDepthThreadParams params;                    // paramaters for the tiles
+    XFuncTimer timer;  // times each phase of this call, for TwoPhotonStats
+    XFuncTimerStart (&timer, STATS_PROJECTDEPTH);
+    try{
+        // check projection mode
+        if ((p->projMode < 0) || (p->projMode > 2)) throw result = BADDSTYPE;
+        projMode = (UInt8)p->projMode;
+        // Get handle to input wave make sure it exists.
+        inPutWaveH = p->inPutWaveH;
+        if (inPutWaveH == NIL) throw result = NON_EXISTENT_WAVE;
+        // Get wave data type and check that we don't have a text wave
+        waveType = WaveType(inPutWaveH);
+        if (waveType==TEXT_WAVE_TYPE) throw result = NOTEXTWAVES;
+        // Get number of used numDimensions in input wave, and check that input wave is 3D
+        if (MDGetWaveDimensions(inPutWaveH, &numDimensions, inPutDimensionSizes)) throw result = WAVEERROR_NOS;
+        if (numDimensions != 3) throw result = INPUTNEEDS_3D_WAVE;
+        // output waves are the size of a frame, with a second layer when making both maximum and minimum
+        outPutDimensionSizes [0] = inPutDimensionSizes [0];
+        outPutDimensionSizes [1] = inPutDimensionSizes [1];
+        outPutDimensionSizes [2] = (projMode == 2) ? 2 : 0;
+        outPutDimensionSizes [3] = 0;
+        // output waves are always new waves, and can not be the input wave, or each other
+        if ((WMGetHandleSize (p->outPutPath) == 0) || (WMGetHandleSize (p->indexPath) == 0)) throw result = OVERWRITEALERT;
+        ParseWavePath (p->outPutPath, outPutPath, outPutWaveName);
+        ParseWavePath (p->indexPath, indexPath, indexWaveName);
+        // Clean up wave names: no liberal names
+        CleanupName (0, outPutWaveName, MAX_OBJ_NAME);
+        CleanupName (0, indexWaveName, MAX_OBJ_NAME);
+        //check that data folders are valid and get handles to the datafolders
+        if (GetNamedDataFolder (NULL, outPutPath, &outPutDFHandle))throw result = WAVEERROR_NOS;
+        if (GetNamedDataFolder (NULL, indexPath, &indexDFHandle))throw result = WAVEERROR_NOS;
+        // Test names and data folders for output waves against the input wave and each other to prevent overwriting
+        WaveName (inPutWaveH, inPutWaveName);
+        if (GetWavesDataFolder (inPutWaveH, &inPutDFHandle)) throw result = WAVEERROR_NOS;
+        if (GetDataFolderNameOrPath (inPutDFHandle, 1, inPutPath)) throw result = WAVEERROR_NOS;
+        if ((CmpStr (inPutPath,outPutPath) ==0) && (CmpStr (inPutWaveName,outPutWaveName) ==0)) throw result = OVERWRITEALERT;
+        if ((CmpStr (inPutPath,indexPath) ==0) && (CmpStr (inPutWaveName,indexWaveName) ==0)) throw result = OVERWRITEALERT;
+        if ((CmpStr (outPutPath,indexPath) ==0) && (CmpStr (outPutWaveName,indexWaveName) ==0)) throw result = OVERWRITEALERT;
+        // make the output waves, and label their layers
+        XFuncTimerPhase (&timer, STATS_MAKEWAVE);
+        if (MDMakeWave (&outPutWaveH, outPutWaveName, outPutDFHandle, outPutDimensionSizes, waveType, overWrite)) throw result = WAVEERROR_NOS;
+        if (MDMakeWave (&indexWaveH, indexWaveName, indexDFHandle, outPutDimensionSizes, NT_I32, overWrite)) throw result = WAVEERROR_NOS;
+        if (projMode == 2){
+            MDSetDimensionLabel (outPutWaveH, LAYERS, 0, (char*)"max");
+            MDSetDimensionLabel (outPutWaveH, LAYERS, 1, (char*)"min");
+            MDSetDimensionLabel (indexWaveH, LAYERS, 0, (char*)"argMax");
+            MDSetDimensionLabel (indexWaveH, LAYERS, 1, (char*)"argMin");
+        }
+        XFuncTimerPhase (&timer, STATS_THREADS);
+        // Get the offsets to the data in the input and output waves
+        if (MDAccessNumericWaveData(inPutWaveH, kMDWaveAccessMode0, &inPutWaveOffset)) throw result = WAVEERROR_NOS;
+        if (MDAccessNumericWaveData(outPutWaveH, kMDWaveAccessMode0, &outPutWaveOffset)) throw result = WAVEERROR_NOS;
+        if (MDAccessNumericWaveData(indexWaveH, kMDWaveAccessMode0, &indexWaveOffset)) throw result = WAVEERROR_NOS;
+        // fill paramater structure
+        params.inPutWaveType = waveType;
+        params.inPutDataStartPtr = (char*)(*inPutWaveH) + inPutWaveOffset;
+        params.outPutDataStartPtr = (char*)(*outPutWaveH) + outPutWaveOffset;
+        params.indexDataStartPtr = (SInt32*)((char*)(*indexWaveH) + indexWaveOffset);
+        params.projMode = projMode;
+        params.xSize = inPutDimensionSizes [0];
+        params.ySize = inPutDimensionSizes [1];
+        params.zSize = inPutDimensionSizes [2];
+        // run the tiles on the thread pool, and wait till they are all finished
+        XFuncTimerPhase (&timer, STATS_COMPUTE);
+        if ((result = ProjectDepthRunTiles (&params)) != 0) throw result;
+    }catch (int result){
+        XFuncTimerEnd (&timer);
+        WMDisposeHandle(p->outPutPath);  // dispose passed in string paramaters
+        WMDisposeHandle(p->indexPath);
+        p -> result = (double)(result - FIRST_XOP_ERR);
+#ifdef NO_IGOR_ERR
+        return (0);
+#else
+        return (result);
+#endif
+    }
+    XFuncTimerPhase (&timer, STATS_FINISH);
+    WMDisposeHandle(p->outPutPath);    // dispose passed in string paramaters
+    WMDisposeHandle(p->indexPath);
+    WaveHandleModified(outPutWaveH);     // Inform Igor that we have changed the output waves.
+    WaveHandleModified(indexWaveH);
+    p->result = (0);
+    XFuncTimerEnd (&timer);
     return (0);
 }
 
@@ -705,10 +628,9 @@ extern "C" int ProjectXSlice (ProjectSliceParamsPtr p) {
     CountInt inPutWaveOffset, outPutWaveOffset;      //offset in bytes from begnning of handle to a wave to the actual data
     char* srcWaveStart, *destWaveStart;              // Pointers to start of data in the inut and output waves.
     CountInt slice =  p->slice;                      // input layer
-    UInt8 iThread;                                   // number of each thread, starting from 0
-    UInt8 nThreads;                                  // total number of threads
-    ProjectThreadParamsPtr paramArrayPtr = nullptr;  // array of params for threading
-    pthread_t* threadsPtr = nullptr;                 // array of pthreads
+    ProjectThreadParams params;                      // paramaters for the tiles
+    XFuncTimer timer;  // times each phase of this call, for TwoPhotonStats
+    XFuncTimerStart (&timer, STATS_PROJECTXSLICE);
     try {
         // Get handle to input and output waves make sure they exist.
         inPutWaveH = p->inPutWaveH;
@@ -736,46 +658,30 @@ extern "C" int ProjectXSlice (ProjectSliceParamsPtr p) {
         srcWaveStart = (char*)(*inPutWaveH) + inPutWaveOffset;
         if (MDAccessNumericWaveData(outPutWaveH, kMDWaveAccessMode0, &outPutWaveOffset)) throw result = WAVEERROR_NOS;
         destWaveStart = (char*)(*outPutWaveH) + outPutWaveOffset;
-        // make an array of parameter structures
-        nThreads = gNumProcessors;
-        paramArrayPtr = (ProjectThreadParamsPtr)WMNewPtr (nThreads * sizeof(ProjectThreadParams));
-        if (paramArrayPtr == nullptr) throw result = MEMFAIL;
-        // make an array of pthread_t
-        threadsPtr =(pthread_t*)WMNewPtr(nThreads * sizeof(pthread_t));
-        if (threadsPtr == nullptr) throw result = MEMFAIL;
     }catch (int result){
-        if (threadsPtr != nullptr) WMDisposePtr ((Ptr)threadsPtr);
-        if (paramArrayPtr != nullptr) WMDisposePtr ((Ptr)paramArrayPtr);
+        XFuncTimerEnd (&timer);
         p -> result = (double)(result - FIRST_XOP_ERR);
         return result;
     }
-    // fill param array struct
-    for (iThread = 0; iThread < nThreads; iThread++){
-        paramArrayPtr[iThread].inPutWaveType = inPutWaveType;
-        paramArrayPtr[iThread].inPutDataStartPtr = srcWaveStart;
-        paramArrayPtr[iThread].outPutDataStartPtr = destWaveStart;
-        paramArrayPtr[iThread].flatDim = 0;
-        paramArrayPtr[iThread].projMode = 0;
-        paramArrayPtr[iThread].xSize = inPutDimensionSizes [0];
-        paramArrayPtr[iThread].ySize = inPutDimensionSizes [1];
-        paramArrayPtr[iThread].zSize =inPutDimensionSizes [2];
-        paramArrayPtr[iThread].startP = slice;
-        paramArrayPtr[iThread].endP= slice;
-        paramArrayPtr[iThread].ti=iThread; // number of this thread, starting from 0
-        paramArrayPtr[iThread].tN =nThreads; // total number of threads
-    }
-    // create the threads
-    for (iThread = 0; iThread < nThreads; iThread++){
-        pthread_create (&threadsPtr[iThread], NULL, ProjectThread, (void *) &paramArrayPtr[iThread]);
-    }
-    //join the threads
-    for (iThread = 0; iThread < nThreads; iThread++){
-        pthread_join (threadsPtr[iThread], NULL);
-    }
-    WMDisposePtr ((Ptr)threadsPtr);     // free memory for pThreads Array
-    WMDisposePtr ((Ptr)paramArrayPtr);   // Free paramaterArray memory
+    XFuncTimerPhase (&timer, STATS_THREADS);
+    // fill paramater structure
+    params.inPutWaveType = inPutWaveType;
+    params.inPutDataStartPtr = srcWaveStart;
+    params.outPutDataStartPtr = destWaveStart;
+    params.flatDim = 0;
+    params.projMode = 0;
+    params.xSize = inPutDimensionSizes [0];
+    params.ySize = inPutDimensionSizes [1];
+    params.zSize =inPutDimensionSizes [2];
+    params.startP = slice;
+    params.endP= slice;
+    // run the tiles on the thread pool, and wait till they are all finished
+    XFuncTimerPhase (&timer, STATS_COMPUTE);
+    ProjectRunTiles (&params, 0);
+    XFuncTimerPhase (&timer, STATS_FINISH);
     WaveHandleModified(outPutWaveH);     // Inform Igor that we have changed the output wave.
     p->result= (0);
+    XFuncTimerEnd (&timer);
     return (0);
 }
 
@@ -793,10 +699,9 @@ extern "C" int ProjectYSlice (ProjectSliceParamsPtr p){
     CountInt inPutWaveOffset, outPutWaveOffset;      //offset in bytes from begnning of handle to a wave to the actual data
     char* srcWaveStart, *destWaveStart;              // Pointers to start of data in the inut and output waves.
     CountInt slice =  p->slice;                      // input layer
-    UInt8 iThread;                                   // number of each thread, starting from 0
-    UInt8 nThreads;                                  // total number of threads
-    ProjectThreadParamsPtr paramArrayPtr = nullptr;  // array of params for threading
-    pthread_t* threadsPtr = nullptr;                 // array of pthreads
+    ProjectThreadParams params;                      // paramaters for the tiles
+    XFuncTimer timer;  // times each phase of this call, for TwoPhotonStats
+    XFuncTimerStart (&timer, STATS_PROJECTYSLICE);
     try {
         // Get handle to input and output waves make sure they exist.
         inPutWaveH = p->inPutWaveH;
@@ -824,46 +729,30 @@ extern "C" int ProjectYSlice (ProjectSliceParamsPtr p){
         srcWaveStart = (char*)(*inPutWaveH) + inPutWaveOffset;
         if (MDAccessNumericWaveData(outPutWaveH, kMDWaveAccessMode0, &outPutWaveOffset)) throw result = WAVEERROR_NOS;
         destWaveStart = (char*)(*outPutWaveH) + outPutWaveOffset;
-        // make an array of parameter structures
-        nThreads = gNumProcessors;
-        paramArrayPtr = (ProjectThreadParamsPtr)WMNewPtr (nThreads * sizeof(ProjectThreadParams));
-        if (paramArrayPtr == nullptr) throw result = MEMFAIL;
-        // make an array of pthread_t
-        threadsPtr =(pthread_t*)WMNewPtr(nThreads * sizeof(pthread_t));
-        if (threadsPtr == nullptr) throw result = MEMFAIL;
     }catch (int result){
-        if (threadsPtr != nullptr) WMDisposePtr ((Ptr)threadsPtr);
-        if (paramArrayPtr != nullptr) WMDisposePtr ((Ptr)paramArrayPtr);
+        XFuncTimerEnd (&timer);
         p -> result = (double)(result - FIRST_XOP_ERR);
         return result;
     }
-    // fill param array struct
-    for (iThread = 0; iThread < nThreads; iThread++){
-        paramArrayPtr[iThread].inPutWaveType = inPutWaveType;
-        paramArrayPtr[iThread].inPutDataStartPtr = srcWaveStart;
-        paramArrayPtr[iThread].outPutDataStartPtr = destWaveStart;
-        paramArrayPtr[iThread].flatDim = 1;
-        paramArrayPtr[iThread].projMode = 0;
-        paramArrayPtr[iThread].xSize = inPutDimensionSizes [0];
-        paramArrayPtr[iThread].ySize = inPutDimensionSizes [1];
-        paramArrayPtr[iThread].zSize =inPutDimensionSizes [2];
-        paramArrayPtr[iThread].startP = slice;
-        paramArrayPtr[iThread].endP= slice;
-        paramArrayPtr[iThread].ti=iThread; // number of this thread, starting from 0
-        paramArrayPtr[iThread].tN =nThreads; // total number of threads
-    }
-    // create the threads
-    for (iThread = 0; iThread < nThreads; iThread++){
-        pthread_create (&threadsPtr[iThread], NULL, ProjectThread, (void *) &paramArrayPtr[iThread]);
-    }
-    //join the threads
-    for (iThread = 0; iThread < nThreads; iThread++){
-        pthread_join (threadsPtr[iThread], NULL);
-    }
-    WMDisposePtr ((Ptr)threadsPtr);     // free memory for pThreads Array
-    WMDisposePtr ((Ptr)paramArrayPtr);   // Free paramaterArray memory
+    XFuncTimerPhase (&timer, STATS_THREADS);
+    // fill paramater structure
+    params.inPutWaveType = inPutWaveType;
+    params.inPutDataStartPtr = srcWaveStart;
+    params.outPutDataStartPtr = destWaveStart;
+    params.flatDim = 1;
+    params.projMode = 0;
+    params.xSize = inPutDimensionSizes [0];
+    params.ySize = inPutDimensionSizes [1];
+    params.zSize =inPutDimensionSizes [2];
+    params.startP = slice;
+    params.endP= slice;
+    // run the tiles on the thread pool, and wait till they are all finished
+    XFuncTimerPhase (&timer, STATS_COMPUTE);
+    ProjectRunTiles (&params, 0);
+    XFuncTimerPhase (&timer, STATS_FINISH);
     WaveHandleModified(outPutWaveH);     // Inform Igor that we have changed the output wave.
     p->result= (0);
+    XFuncTimerEnd (&timer);
     return (0);
 }
 
@@ -880,10 +769,9 @@ extern "C" int ProjectZSlice (ProjectSliceParamsPtr p){
     CountInt inPutWaveOffset, outPutWaveOffset;      //offset in bytes from begnning of handle to a wave to the actual data
     char* srcWaveStart, *destWaveStart;              // Pointers to start of data in the inut and output waves.
     CountInt slice =  p->slice;                      // input layer
-    UInt8 iThread;                                   // number of each thread, starting from 0
-    UInt8 nThreads;                                  // total number of threads
-    ProjectThreadParamsPtr paramArrayPtr = nullptr;  // array of params for threading
-    pthread_t* threadsPtr = nullptr;                 // array of pthreads
+    ProjectThreadParams params;                      // paramaters for the tiles
+    XFuncTimer timer;  // times each phase of this call, for TwoPhotonStats
+    XFuncTimerStart (&timer, STATS_PROJECTZSLICE);
     try {
         // Get handle to input and output waves make sure they exist.
         inPutWaveH = p->inPutWaveH;
@@ -911,45 +799,29 @@ extern "C" int ProjectZSlice (ProjectSliceParamsPtr p){
         srcWaveStart = (char*)(*inPutWaveH) + inPutWaveOffset;
         if (MDAccessNumericWaveData(outPutWaveH, kMDWaveAccessMode0, &outPutWaveOffset)) throw result = WAVEERROR_NOS;
         destWaveStart = (char*)(*outPutWaveH) + outPutWaveOffset;
-        // make an array of parameter structures
-        nThreads = gNumProcessors;
-        paramArrayPtr = (ProjectThreadParamsPtr)WMNewPtr (nThreads * sizeof(ProjectThreadParams));
-        if (paramArrayPtr == nullptr) throw result = MEMFAIL;
-        // make an array of pthread_t
-        threadsPtr =(pthread_t*)WMNewPtr(nThreads * sizeof(pthread_t));
-        if (threadsPtr == nullptr) throw result = MEMFAIL;
     }catch (int result){
-        if (threadsPtr != nullptr) WMDisposePtr ((Ptr)threadsPtr);
-        if (paramArrayPtr != nullptr) WMDisposePtr ((Ptr)paramArrayPtr);
+        XFuncTimerEnd (&timer);
         p -> result = (double)(result - FIRST_XOP_ERR);
         return result;
     }
-    // fill param array struct
-    for (iThread = 0; iThread < nThreads; iThread++){
-        paramArrayPtr[iThread].inPutWaveType = inPutWaveType;
-        paramArrayPtr[iThread].inPutDataStartPtr = srcWaveStart;
-        paramArrayPtr[iThread].outPutDataStartPtr = destWaveStart;
-        paramArrayPtr[iThread].flatDim = 2;     // for Z
-        paramArrayPtr[iThread].projMode = 0;    // doesn't matter for a single frame
-        paramArrayPtr[iThread].xSize = inPutDimensionSizes [0];
-        paramArrayPtr[iThread].ySize = inPutDimensionSizes [1];
-        paramArrayPtr[iThread].zSize =inPutDimensionSizes [2];
-        paramArrayPtr[iThread].startP = slice;
-        paramArrayPtr[iThread].endP= slice;
-        paramArrayPtr[iThread].ti=iThread; // number of this thread, starting from 0
-        paramArrayPtr[iThread].tN =nThreads; // total number of threads
-    }
-    // create the threads
-    for (iThread = 0; iThread < nThreads; iThread++){
-        pthread_create (&threadsPtr[iThread], NULL, ProjectThread, (void *) &paramArrayPtr[iThread]);
-    }
-    //join the threads
-    for (iThread = 0; iThread < nThreads; iThread++){
-        pthread_join (threadsPtr[iThread], NULL);
-    }
-    WMDisposePtr ((Ptr)threadsPtr);     // free memory for pThreads Array
-    WMDisposePtr ((Ptr)paramArrayPtr);   // Free paramaterArray memory
+    XFuncTimerPhase (&timer, STATS_THREADS);
+    // fill paramater structure
+    params.inPutWaveType = inPutWaveType;
+    params.inPutDataStartPtr = srcWaveStart;
+    params.outPutDataStartPtr = destWaveStart;
+    params.flatDim = 2;     // for Z
+    params.projMode = 0;    // doesn't matter for a single frame
+    params.xSize = inPutDimensionSizes [0];
+    params.ySize = inPutDimensionSizes [1];
+    params.zSize =inPutDimensionSizes [2];
+    params.startP = slice;
+    params.endP= slice;
+    // run the tiles on the thread pool, and wait till they are all finished
+    XFuncTimerPhase (&timer, STATS_COMPUTE);
+    ProjectRunTiles (&params, 0);
+    XFuncTimerPhase (&timer, STATS_FINISH);
     WaveHandleModified(outPutWaveH);     // Inform Igor that we have changed the output wave.
     p->result= (0);
+    XFuncTimerEnd (&timer);
     return (0);
 }
@@ -0,0 +1,975 @@
+#include "twoPhotonKernels.h"
+
+/* ------------------------------Minimum/Maximum/Avg/Median/Percentile Intensity Projection Kernels-----------
+ Templates and tile functions for making projections along X,Y, and Z axes, and for getting single slices.
+ The XFUNCs that call them are in ProjectImage.cpp
+ Last Modified 2026/10/16
+ ------------------------------------------------------------------------------------------------------- */
+
+/* Histograms of 8, 16 and 32 bit integer values count keys, the value - the smallest value of the type, made by flipping
+ the sign bit of signed values, so keys count in order. ProjectHistValue turns a key back into its value. Keys have
+ ProjectHistBytes bytes, which is capped at 4 only so templates for floating point types compile, as they never use keys
+ Last Modified 2026/10/16 */
+template <typename T> static inline int ProjectHistBytes (void){
+    return (sizeof (T) < 4) ? (int)sizeof (T) : 4;
+}
+
+template <typename T> static inline UInt32 ProjectHistKey (T value){
+    const UInt32 signBit = ((T)-1 < 0) ? ((UInt32)1 << (8 * ProjectHistBytes<T>() - 1)) : 0;
+    return ((UInt32)value ^ signBit) & ((UInt32)0xFFFFFFFF >> (32 - 8 * ProjectHistBytes<T>()));
+}
+
+template <typename T> static inline T ProjectHistValue (UInt32 key){
+    const UInt32 signBit = ((T)-1 < 0) ? ((UInt32)1 << (8 * ProjectHistBytes<T>() - 1)) : 0;
+    return (T)(key ^ signBit);
+}
+
+/* Finishes selecting the point of a given rank (0 for the smallest) in each of blockPoints columns, from histograms of 256
+ bins for each column in histPtr, already counted from the high bytes of the keys, which are the whole keys of 8 bit
+ waves. The bin of high bytes holding the selected point is found, and for wider waves each further pass over the block
+ counts the next lower byte of only the points whose higher bytes match those selected so far, one pass for 16 bit waves
+ and three for 32 bit waves. Columns start toNextPoint apart, and each has nRows points, toNextRow apart. keys gets the
+ key of the selected value for each column
+ Last Modified 2026/10/16 */
+template <typename T> static void ProjectHistFinishT (T* srcBlock, CountInt blockPoints, CountInt toNextPoint, CountInt nRows, CountInt toNextRow, CountInt rank, UInt32* histPtr, UInt32* keys){
+    CountInt rankLeft [PROJECT_HIST_BLOCK]; // rank of the selected point among the points with the bytes selected so far
+    CountInt iPoint, iRow, count;
+    UInt32 key, bin, *hist;
+    int shift;
+    T *srcRow, *srcPoint;
+    for (iPoint = 0, hist = histPtr; iPoint < blockPoints; iPoint++, hist += 256){
+        for (bin = 0, count = 0; count + hist [bin] <= rank; bin++)
+            count += hist [bin];
+        keys [iPoint] = bin;
+        rankLeft [iPoint] = rank - count;
+    }
+    for (shift = 8 * (ProjectHistBytes<T>() - 2); shift >= 0; shift -= 8){
+        memset (histPtr, 0, blockPoints * 256 * sizeof (UInt32));
+        for (iRow = 0, srcRow = srcBlock; iRow < nRows; iRow++, srcRow += toNextRow){
+            for (iPoint = 0, srcPoint = srcRow; iPoint < blockPoints; iPoint++, srcPoint += toNextPoint){
+                key = ProjectHistKey (*srcPoint);
+                histPtr [(iPoint << 8) + ((key >> shift) & 255)] += ((key >> (shift + 8)) == keys [iPoint]);
+            }
+        }
+        for (iPoint = 0, hist = histPtr; iPoint < blockPoints; iPoint++, hist += 256){
+            for (bin = 0, count = 0; count + hist [bin] <= rankLeft [iPoint]; bin++)
+                count += hist [bin];
+            keys [iPoint] = (keys [iPoint] << 8) | bin;
+            rankLeft [iPoint] -= count;
+        }
+    }
+}
+
+/* Selects the point of a given rank (0 for the smallest) in each of nPoints columns of an 8, 16 or 32 bit integer wave,
+ with no copying or partitioning of the columns. Columns start toNextPoint apart, and each has nRows points, toNextRow
+ apart. Columns are done in blocks of PROJECT_HIST_BLOCK, each with a histogram of 256 bins in histPtr, which is reused
+ for every block. One pass over the block counts the high bytes of the keys, and ProjectHistFinishT does the rest.
+ destStart gets the selections for all the columns, one after the other
+ Last Modified 2026/10/16 */
+template <typename T> void ProjectHistSelectT (T* srcStart, T* destStart, CountInt nPoints, CountInt toNextPoint, CountInt nRows, CountInt toNextRow, CountInt rank, UInt32* histPtr){
+    const UInt32 shift = 8 * (ProjectHistBytes<T>() - 1); // shift from a key to its bin in the first pass
+    UInt32 keys [PROJECT_HIST_BLOCK];
+    CountInt blockStart, blockPoints, iPoint, iRow;
+    UInt32 key;
+    T *srcBlock, *srcRow, *srcPoint, *destBlock;
+    for (blockStart = 0; blockStart < nPoints; blockStart += PROJECT_HIST_BLOCK){
+        blockPoints = nPoints - blockStart;
+        if (blockPoints > PROJECT_HIST_BLOCK)
+            blockPoints = PROJECT_HIST_BLOCK;
+        srcBlock = srcStart + blockStart * toNextPoint;
+        destBlock = destStart + blockStart;
+        memset (histPtr, 0, blockPoints * 256 * sizeof (UInt32));
+        for (iRow = 0, srcRow = srcBlock; iRow < nRows; iRow++, srcRow += toNextRow){
+            for (iPoint = 0, srcPoint = srcRow; iPoint < blockPoints; iPoint++, srcPoint += toNextPoint){
+                key = ProjectHistKey (*srcPoint);
+                histPtr [(iPoint << 8) + (key >> shift)]++;
+            }
+        }
+        ProjectHistFinishT (srcBlock, blockPoints, toNextPoint, nRows, toNextRow, rank, histPtr, keys);
+        for (iPoint = 0; iPoint < blockPoints; iPoint++)
+            destBlock [iPoint] = ProjectHistValue<T> (keys [iPoint]);
+    }
+}
+
+/* Rank (0 for the smallest) of the point selected from each column of nRows points by a median projection (projMode 3),
+ nRows/2, or by a percentile projection (projMode 4), the nearest rank to percentile/100 * (nRows - 1), which is also
+ nRows/2 for the 50th percentile
+ Last Modified 2026/10/16 */
+static inline CountInt ProjectRank (UInt8 projMode, double percentile, CountInt nRows){
+    if (projMode != 4)
+        return nRows/2;
+    CountInt rank = (CountInt)(percentile/100 * (nRows - 1) + 0.5);
+    if (rank < 0) return 0;
+    if (rank > nRows - 1) return nRows - 1;
+    return rank;
+}
+
+/* Whether median and percentile projections of a wave of waveType, with projSize points in each column, use the histograms
+ of ProjectHistSelectT, as for ProjectHistSelect, so the callers know how big a buffer to make for each thread
+ Last Modified 2026/10/16 */
+static inline UInt8 ProjectUseHist (int waveType, CountInt projSize){
+    return ((waveType & (NT_I8 | NT_I16 | NT_I32)) && (projSize >= PROJECT_HIST_MIN_POINTS));
+}
+
+/* Median and percentile projections of 8, 16 and 32 bit integer waves with at least PROJECT_HIST_MIN_POINTS points in
+ each column use the histograms of ProjectHistSelectT, and return 1. Floating point waves, and shorter columns, for which
+ copying each column and using selectT is faster, return 0, and the caller does that instead
+ Last Modified 2026/10/16 */
+template <typename T> int ProjectHistSelect (T* srcStart, T* destStart, CountInt nPoints, CountInt toNextPoint, CountInt nRows, CountInt toNextRow, CountInt rank, char* bufferPtr){
+    return 0;
+}
+
+static int ProjectHistSelect (char* srcStart, char* destStart, CountInt nPoints, CountInt toNextPoint, CountInt nRows, CountInt toNextRow, CountInt rank, char* bufferPtr){
+    if (nRows < PROJECT_HIST_MIN_POINTS) return 0;
+    ProjectHistSelectT (srcStart, destStart, nPoints, toNextPoint, nRows, toNextRow, rank, (UInt32*)bufferPtr);
+    return 1;
+}
+
+static int ProjectHistSelect (unsigned char* srcStart, unsigned char* destStart, CountInt nPoints, CountInt toNextPoint, CountInt nRows, CountInt toNextRow, CountInt rank, char* bufferPtr){
+    if (nRows < PROJECT_HIST_MIN_POINTS) return 0;
+    ProjectHistSelectT (srcStart, destStart, nPoints, toNextPoint, nRows, toNextRow, rank, (UInt32*)bufferPtr);
+    return 1;
+}
+
+static int ProjectHistSelect (short* srcStart, short* destStart, CountInt nPoints, CountInt toNextPoint, CountInt nRows, CountInt toNextRow, CountInt rank, char* bufferPtr){
+    if (nRows < PROJECT_HIST_MIN_POINTS) return 0;
+    ProjectHistSelectT (srcStart, destStart, nPoints, toNextPoint, nRows, toNextRow, rank, (UInt32*)bufferPtr);
+    return 1;
+}
+
+static int ProjectHistSelect (unsigned short* srcStart, unsigned short* destStart, CountInt nPoints, CountInt toNextPoint, CountInt nRows, CountInt toNextRow, CountInt rank, char* bufferPtr){
+    if (nRows < PROJECT_HIST_MIN_POINTS) return 0;
+    ProjectHistSelectT (srcStart, destStart, nPoints, toNextPoint, nRows, toNextRow, rank, (UInt32*)bufferPtr);
+    return 1;
+}
+
+static int ProjectHistSelect (SInt32* srcStart, SInt32* destStart, CountInt nPoints, CountInt toNextPoint, CountInt nRows, CountInt toNextRow, CountInt rank, char* bufferPtr){
+    if (nRows < PROJECT_HIST_MIN_POINTS) return 0;
+    ProjectHistSelectT (srcStart, destStart, nPoints, toNextPoint, nRows, toNextRow, rank, (UInt32*)bufferPtr);
+    return 1;
+}
+
+static int ProjectHistSelect (UInt32* srcStart, UInt32* destStart, CountInt nPoints, CountInt toNextPoint, CountInt nRows, CountInt toNextRow, CountInt rank, char* bufferPtr){
+    if (nRows < PROJECT_HIST_MIN_POINTS) return 0;
+    ProjectHistSelectT (srcStart, destStart, nPoints, toNextPoint, nRows, toNextRow, rank, (UInt32*)bufferPtr);
+    return 1;
+}
+
+/* The following templates get a single slice or makes a minimum or maximum intensity projection for one of
+ the 8 types of wave data in the X,Y,or Z dimension, for either of the Project functions
+ srcWaveStart: pointer to the start of the data in the 3D input wave
+ desWaveStart: pointer to the start of the data in the 2D or 3D outPut wave
+ projMode: 0 for minimum, 1 for maximum, 2 for average, 3 for median, 4 for percentile intensity projection
+ rank: for median and percentile projections, the rank of the point to select from each column, from ProjectRank
+ example:
+ X projection - looking for max/min with a range of columns at a single YZ location
+ result is wave with dim 0 = ySize, dim 1 =zSize
+ using Igor terminology of x being columns and y being rows and z being layers
+ Each call does one tile of the output, from startLoc up to, but not including, endLoc
+ Last Modified 2026/10/16 */
+
+template <typename T> void doProjectX(T *srcWaveStart, T *destWaveStart, UInt8 projMode, CountInt rank, CountInt xSize, CountInt ySize, CountInt zSize, CountInt startP, CountInt endP, CountInt startLoc, CountInt endLoc, char* bufferPtr){
+    // Number of ZY locations to do for this tile
+    CountInt tPoints = endLoc - startLoc;
+    // which point to start this tile on depends on first YZ location of the tile
+    CountInt inStartPos = startP + (startLoc * xSize);
+    CountInt outStartPos = startLoc;
+    // number of columns to do within each YZ location.
+    CountInt ColumnsToDo = endP - startP + 1;
+    // number to skip to get to start of next column at this ZY location
+    // number of points to get to next YZloc
+    CountInt toNextYZ = xSize - ColumnsToDo;
+    // pointers for loops
+    T *srcWave = srcWaveStart + inStartPos;
+    T *destWave = destWaveStart + outStartPos;
+    T *destWaveEnd;
+    T* lastColumn; // last column at this YZ location
+    if (ColumnsToDo == 1){ // getting a single slice
+        // adjust toNextYZ for lack of inner loop
+        toNextYZ += 1;
+        // loop through YZ locations
+        for (destWaveEnd = destWave + tPoints; destWave < destWaveEnd; destWave++, srcWave += toNextYZ){
+            // set destination to chosen column at this source ZY location
+            *destWave = *srcWave;
+        }
+    }else{ // doing a projection
+        switch(projMode){
+            case 0: // Minimum projection
+                // loop through YZ locations looking for minimum
+                for (destWaveEnd = destWave + tPoints; destWave < destWaveEnd; destWave++, srcWave += toNextYZ){
+                    // set destination to first column at this source ZY location
+                    *destWave = *srcWave;
+                    // check remining columns in source to find max
+                    for (lastColumn= srcWave + ColumnsToDo, srcWave++ ; srcWave < lastColumn; srcWave++){
+                        if (*srcWave < *destWave)
+                            *destWave = *srcWave;
+                    }
+                }
+                break;
+            case 1: // Maximum projection
+                // loop through YZ locations looking for maximum
+                for (destWaveEnd = destWave + tPoints; destWave < destWaveEnd; destWave++, srcWave += toNextYZ){
+                    // set destination to first column at this source ZY location
+                    *destWave = *srcWave;
+                    // check remining columns in source to find min
+                    for (lastColumn= srcWave + ColumnsToDo, srcWave++ ; srcWave < lastColumn; srcWave++){
+                        if (*srcWave > *destWave)
+                            *destWave = *srcWave;
+                    }
+                }
+                break;
+            case 2: // Average projection
+                double temp;
+                // loop through YZ locations calculating average, with double precision float
+                for (destWaveEnd = destWave + tPoints; destWave < destWaveEnd; destWave++, srcWave += toNextYZ){
+                    for (lastColumn= srcWave + ColumnsToDo, temp=0; srcWave < lastColumn; srcWave++){
+                        temp += *srcWave;
+                    }
+                    *destWave = temp/ColumnsToDo;
+                }
+                break;
+            case 3: // Median projection
+            case 4: // Percentile projection
+                // YZ locations are xSize apart, and columns at each location are next to each other
+                if (ProjectHistSelect (srcWave, destWave, tPoints, xSize, ColumnsToDo, 1, rank, bufferPtr))
+                    break;
+                T *bufferStart = (T*) bufferPtr;
+                T *bufferPos;
+                // loop through YZ locations filling a buffer for calculating median
+                for (destWaveEnd = destWave + tPoints; destWave < destWaveEnd; destWave++, srcWave += toNextYZ){
+                    for (lastColumn= srcWave + ColumnsToDo, bufferPos =bufferStart; srcWave < lastColumn; srcWave++, bufferPos++){
+                        *bufferPos = *srcWave;
+                    }
+                    *destWave = selectT (ColumnsToDo, rank, bufferStart);
+                }
+                break;
+        }
+    }
+}
+
+/* Y projection - looking for max/min within a range of rows at each XZ location
+ result is wave with dim 0 = xSize, dim 1 =zSize
+ Each call does a tile of layers, from startLoc up to, but not including, endLoc
+ Last Modified 2026/10/16 */
+template <typename T> void doProjectY(T *srcWaveStart, T *destWaveStart, UInt8 projMode, CountInt rank, CountInt xSize, CountInt ySize, CountInt zSize, CountInt startP, CountInt endP, CountInt startLoc, CountInt endLoc, char* bufferPtr){
+    // number of layers to do in this tile
+    // each layer needs to be in a single tile because offset to next XZ location is different at end of a layer
+    CountInt tLayers = endLoc - startLoc;
+    // which point to start this tile on depends on first layer of the tile
+    CountInt inStartPos = (startP * xSize) + (startLoc * xSize * ySize);
+    CountInt outStartPos = startLoc * xSize;
+    // number of rows to look at in each XZ location
+    CountInt rowsToDo = endP - startP + 1;
+    CountInt toNextRow = xSize; // number to add to get to next row at this YZ location
+    CountInt toNextColumn = 1 - (rowsToDo * xSize); // number to add to get to next YZ location in this column
+    CountInt toNextLayer = (xSize * ySize) - xSize; // number to add to get to first YZ location in the next layer
+    T *srcWave = srcWaveStart + inStartPos;
+    T *destWave = destWaveStart + outStartPos;
+    T* lastRow; // last row at this XZ location
+    T* lastColumn; //last row of last column in this layer
+    T* lastLayer; // last row of last column of last layer
+    if (rowsToDo == 1){ // getting a single slice
+        // adjust toNextColumn for lack of innermost loop
+        toNextColumn += toNextRow;
+        // loop through layers (z)
+        for (lastLayer = srcWave + (tLayers * xSize * ySize); srcWave < lastLayer; srcWave += toNextLayer){
+            // loop through columns (x) in this layer
+            for (lastColumn = srcWave + xSize; srcWave < lastColumn; srcWave += toNextColumn, destWave++){
+                // set destination to chosen column in source row
+                *destWave = *srcWave;
+            }
+        }
+    }else{ // doing a projection
+        switch (projMode) {
+            case 0:  // minimum projection
+                for (lastLayer = srcWave + (tLayers * xSize * ySize); srcWave < lastLayer; srcWave += toNextLayer){
+                    // loop through columns (x) in this layer
+                    for (lastColumn = srcWave + xSize; srcWave < lastColumn; srcWave += toNextColumn, destWave++){
+                        // set destination to first row in source column
+                        *destWave = *srcWave;
+                        // loop through remaining rows (y) in this column (x)
+                        for (lastRow = srcWave + (rowsToDo * xSize), srcWave += toNextRow;srcWave < lastRow; srcWave += toNextRow){
+                            if (*srcWave < *destWave) *destWave = *srcWave;
+                        }
+                    }
+                }
+                break;
+            case 1:  // max projection
+                for (lastLayer = srcWave + (tLayers * xSize * ySize); srcWave < lastLayer; srcWave += toNextLayer){
+                    // loop through columns (x) in this layer
+                    for (lastColumn = srcWave + xSize; srcWave < lastColumn; srcWave += toNextColumn, destWave++){
+                        // set destination to first row in source column
+                        *destWave = *srcWave;
+                        // loop through remaining rows (y) in this column (x)
+                        for (lastRow = srcWave + (rowsToDo * xSize), srcWave += toNextRow;srcWave < lastRow; srcWave += toNextRow){
+                            if (*srcWave > *destWave) *destWave = *srcWave;
+                        }
+                    }
+                }
+                break;
+            case 2: // Avg projection
+                double temp;
+                for (lastLayer = srcWave + (tLayers * xSize * ySize); srcWave < lastLayer; srcWave += toNextLayer){
+                    // loop through columns (x) in this layer
+                    for (lastColumn = srcWave + xSize; srcWave < lastColumn; srcWave += toNextColumn, destWave++){
+                        // loop through rows (y) in this column (x)
+                        for (lastRow = srcWave + (rowsToDo * xSize), temp=0;srcWave < lastRow; srcWave += toNextRow){
+                            temp += *srcWave;
+                        }
+                        *destWave = temp/rowsToDo;
+                    }
+                }
+                break;
+            case 3: // median proj
+            case 4: // percentile proj
+                // each layer is a row of XZ locations next to each other, with rows xSize apart
+                CountInt iLayer;
+                for (iLayer = 0; iLayer < tLayers; iLayer++){
+                    if (!ProjectHistSelect (srcWave + iLayer * xSize * ySize, destWave + iLayer * xSize, xSize, 1, rowsToDo, xSize, rank, bufferPtr))
+                        break;
+                }
+                if (iLayer == tLayers)
+                    break;
+                T *bufferStart = (T*)bufferPtr;
+                T *bufferPos;
+                for (lastLayer = srcWave + (tLayers * xSize * ySize); srcWave < lastLayer; srcWave += toNextLayer){
+                    // loop through columns (x) in this layer
+                    for (lastColumn = srcWave + xSize; srcWave < lastColumn; srcWave += toNextColumn, destWave++){
+                        // loop through rows (y) in this column (x)
+                        for (lastRow = srcWave + (rowsToDo * xSize), bufferPos=bufferStart;srcWave < lastRow; srcWave += toNextRow, bufferPos++){
+                            *bufferPos = *srcWave;
+                        }
+                        *destWave = selectT (rowsToDo, rank, bufferStart);
+                    }
+                }
+                break;
+        }
+        
+    }
+}
+
+/* Z projection - looking for max/min in range of layers at same XY location
+ result is wave with dim 0 = xSize, dim 1 =ySize
+ Each call does one tile of XY locations, from startLoc up to, but not including, endLoc. Min, max, and average
+ projections stream through the tile in blocks of PROJECT_Z_BLOCK XY locations, reading each layer of a block as one
+ contiguous run and folding it into the output, or into a block of sums for the average, which stay in L1 cache
+ while every layer is read. Median and percentile projections still gather each XY location down through the layers
+ Last Modified 2026/10/16 */
+template <typename T> void doProjectZ(T *srcWaveStart, T *destWaveStart, UInt8 projMode, CountInt rank, CountInt xSize, CountInt ySize, CountInt startP, CountInt endP, CountInt startLoc, CountInt endLoc, char* bufferPtr){
+    // number of XY locations to process in this tile
+    CountInt tPoints = endLoc - startLoc;
+    // which point to start this tile on depends on first XY location of the tile
+    CountInt inStartPos = (startP * xSize * ySize) + startLoc;
+    CountInt outStartPos = startLoc;
+    // number of layers to do within each XYloc, and number to skip to get to start of next layer at this XYlocs
+    CountInt layersToDo = endP - startP + 1;
+    CountInt toNextLayer = xSize * ySize;
+    // number of points to get to next XYloc
+    CountInt toNextXY = 1 - (layersToDo * xSize * ySize);
+    // pointers for loops
+    T *srcWave = srcWaveStart + inStartPos;
+    T *destWave = destWaveStart + outStartPos;
+    T *destWaveEnd;
+    T* lastLayer; // last layer at this XY location
+    // for streaming blocks of XY locations a layer at a time
+    CountInt blockStart, blockPoints, iLayer, iPoint;
+    T *srcLayer, *destBlock;
+    if (layersToDo == 1){ // getting a single slice
+        //adjust toNextXY for lack of innermost loop
+        toNextXY += toNextLayer;
+        for (destWaveEnd = destWave + tPoints; destWave < destWaveEnd; destWave++, srcWave += toNextXY){
+            *destWave = *srcWave; // set destination to chosen layer in source
+        }
+    }else{ // a max or min projection
+        switch (projMode) {
+            case 0: // minimum projection
+            case 1: // maximum projection
+                for (blockStart = 0; blockStart < tPoints; blockStart += PROJECT_Z_BLOCK){
+                    blockPoints = tPoints - blockStart;
+                    if (blockPoints > PROJECT_Z_BLOCK)
+                        blockPoints = PROJECT_Z_BLOCK;
+                    destBlock = destWave + blockStart;
+                    srcLayer = srcWave + blockStart;
+                    // set destination to first layer in source. With in-place Z projections, the output is the first
+                    // layer of the input, and each point is read here before it is written
+                    for (iPoint = 0; iPoint < blockPoints; iPoint++)
+                        destBlock [iPoint] = srcLayer [iPoint];
+                    // fold remaining layers into the destination, one contiguous run per layer
+                    if (projMode == 0){
+                        for (iLayer = 1, srcLayer += toNextLayer; iLayer < layersToDo; iLayer++, srcLayer += toNextLayer){
+                            for (iPoint = 0; iPoint < blockPoints; iPoint++)
+                                destBlock [iPoint] = (srcLayer [iPoint] < destBlock [iPoint]) ? srcLayer [iPoint] : destBlock [iPoint];
+                        }
+                    }else{
+                        for (iLayer = 1, srcLayer += toNextLayer; iLayer < layersToDo; iLayer++, srcLayer += toNextLayer){
+                            for (iPoint = 0; iPoint < blockPoints; iPoint++)
+                                destBlock [iPoint] = (srcLayer [iPoint] > destBlock [iPoint]) ? srcLayer [iPoint] : destBlock [iPoint];
+                        }
+                    }
+                }
+                break;
+            case 2: // average projection
+            {
+                // sums for one block, added in the same order as going down each XY location, so results are unchanged
+                double sums [PROJECT_Z_BLOCK];
+                for (blockStart = 0; blockStart < tPoints; blockStart += PROJECT_Z_BLOCK){
+                    blockPoints = tPoints - blockStart;
+                    if (blockPoints > PROJECT_Z_BLOCK)
+                        blockPoints = PROJECT_Z_BLOCK;
+                    srcLayer = srcWave + blockStart;
+                    for (iPoint = 0; iPoint < blockPoints; iPoint++)
+                        sums [iPoint] = srcLayer [iPoint];
+                    for (iLayer = 1, srcLayer += toNextLayer; iLayer < layersToDo; iLayer++, srcLayer += toNextLayer){
+                        for (iPoint = 0; iPoint < blockPoints; iPoint++)
+                            sums [iPoint] += srcLayer [iPoint];
+                    }
+                    destBlock = destWave + blockStart;
+                    for (iPoint = 0; iPoint < blockPoints; iPoint++)
+                        destBlock [iPoint] = sums [iPoint]/layersToDo;
+                }
+                break;
+            }
+            case 3: // median projection
+            case 4: // percentile projection
+                // XY locations are next to each other, with layers xSize * ySize apart
+                if (ProjectHistSelect (srcWave, destWave, tPoints, 1, layersToDo, toNextLayer, rank, bufferPtr))
+                    break;
+                T *bufferStart = (T*) bufferPtr;
+                T *bufferPos;
+                for (destWaveEnd = destWave + tPoints; destWave < destWaveEnd; destWave++, srcWave += toNextXY){
+                    for (lastLayer= srcWave + (layersToDo * toNextLayer), bufferPos = bufferStart; srcWave < lastLayer; srcWave += toNextLayer, bufferPos++){
+                        *bufferPos = *srcWave;
+                    }
+                    *destWave = selectT (layersToDo, rank, bufferStart);
+                }
+                break;
+        }
+    }
+}
+
+
+/* Each tile of a maximum or minimum intensity projection through X,Y, or Z is done with this function. Tiles are
+ YZ locations for X, layers for Y, and XY locations for Z
+ Last Modified 2026/10/16 */
+void ProjectTile (void* paramsPtr, CountInt startLoc, CountInt endLoc, UInt32 iSlot){
+    struct ProjectThreadParams* p;
+    p = (struct ProjectThreadParams*) paramsPtr;
+    char* slotBuffer = p->bufferPtr + iSlot * p->bufferBytes;
+    CountInt rank = ProjectRank (p->projMode, p->percentile, p->endP - p->startP + 1);
+    switch (p->flatDim){
+        case 0:  //Project X
+            switch(p->inPutWaveType){
+                case NT_I8:
+                    doProjectX((char*)p->inPutDataStartPtr, (char*)p->outPutDataStartPtr, p->projMode, rank, p->xSize, p->ySize, p->zSize, p->startP, p->endP, startLoc, endLoc, slotBuffer);
+                    break;
+                case (NT_I8 | NT_UNSIGNED):
+                    doProjectX((unsigned char*)p->inPutDataStartPtr , (unsigned char*)p->outPutDataStartPtr,  p->projMode, rank, p->xSize, p->ySize, p->zSize, p->startP, p->endP, startLoc, endLoc, slotBuffer);
+                    break;
+                case NT_I16:
+                    doProjectX((short*)p->inPutDataStartPtr, (short*)p->outPutDataStartPtr, p->projMode, rank, p->xSize, p->ySize, p->zSize, p->startP, p->endP, startLoc, endLoc, slotBuffer);
+                    break;
+                case (NT_I16 | NT_UNSIGNED):
+                    doProjectX((unsigned short*)p->inPutDataStartPtr , (unsigned short*)p->outPutDataStartPtr,  p->projMode, rank, p->xSize, p->ySize, p->zSize, p->startP, p->endP, startLoc, endLoc, slotBuffer);
+                    break;
+                case NT_I32:
+                    doProjectX((SInt32*)p->inPutDataStartPtr, (SInt32*)p->outPutDataStartPtr, p->projMode, rank, p->xSize, p->ySize, p->zSize, p->startP, p->endP, startLoc, endLoc, slotBuffer);
+                    break;
+                case (NT_I32| NT_UNSIGNED):
+                    doProjectX((UInt32*)p->inPutDataStartPtr, (UInt32*)p->outPutDataStartPtr, p->projMode, rank, p->xSize, p->ySize, p->zSize, p->startP, p->endP, startLoc, endLoc, slotBuffer);
+                    break;
+                case NT_FP32:
+                    doProjectX((float*)p->inPutDataStartPtr, (float*)p->outPutDataStartPtr, p->projMode, rank, p->xSize, p->ySize, p->zSize, p->startP, p->endP, startLoc, endLoc, slotBuffer);
+                    break;
+                case NT_FP64:
+                    doProjectX((double*)p->inPutDataStartPtr, (double*)p->outPutDataStartPtr,  p->projMode, rank, p->xSize, p->ySize, p->zSize, p->startP, p->endP, startLoc, endLoc, slotBuffer);
+                    break;
+            }
+            break;
+        case 1: //Project Y
+            switch(p->inPutWaveType){
+                case NT_I8:
+                    doProjectY((char*)p->inPutDataStartPtr, (char*)p->outPutDataStartPtr, p->projMode, rank, p->xSize, p->ySize, p->zSize, p->startP, p->endP, startLoc, endLoc, slotBuffer);
+                    break;
+                case (NT_I8 | NT_UNSIGNED):
+                    doProjectY((unsigned char*)p->inPutDataStartPtr , (unsigned char*)p->outPutDataStartPtr,  p->projMode, rank, p->xSize, p->ySize, p->zSize, p->startP, p->endP, startLoc, endLoc, slotBuffer);
+                    break;
+                case NT_I16:
+                    doProjectY((short*)p->inPutDataStartPtr, (short*)p->outPutDataStartPtr, p->projMode, rank, p->xSize, p->ySize, p->zSize, p->startP, p->endP, startLoc, endLoc, slotBuffer);
+                    break;
+                case (NT_I16 | NT_UNSIGNED):
+                    doProjectY((unsigned short*)p->inPutDataStartPtr , (unsigned short*)p->outPutDataStartPtr,  p->projMode, rank, p->xSize, p->ySize, p->zSize, p->startP, p->endP, startLoc, endLoc, slotBuffer);
+                    break;
+                case NT_I32:
+                    doProjectY((SInt32*)p->inPutDataStartPtr, (SInt32*)p->outPutDataStartPtr, p->projMode, rank, p->xSize, p->ySize, p->zSize, p->startP, p->endP, startLoc, endLoc, slotBuffer);
+                    break;
+                case (NT_I32| NT_UNSIGNED):
+                    doProjectY((UInt32*)p->inPutDataStartPtr, (UInt32*)p->outPutDataStartPtr, p->projMode, rank, p->xSize, p->ySize, p->zSize, p->startP, p->endP, startLoc, endLoc, slotBuffer);
+                    break;
+                case NT_FP32:
+                    doProjectY((float*)p->inPutDataStartPtr, (float*)p->outPutDataStartPtr, p->projMode, rank, p->xSize, p->ySize, p->zSize, p->startP, p->endP, startLoc, endLoc, slotBuffer);
+                    break;
+                case NT_FP64:
+                    doProjectY((double*)p->inPutDataStartPtr, (double*)p->outPutDataStartPtr,  p->projMode, rank, p->xSize, p->ySize, p->zSize, p->startP, p->endP, startLoc, endLoc, slotBuffer);
+                    break;
+            }
+            break;
+        case 2: // Project Z
+            switch(p->inPutWaveType){
+                case NT_I8:
+                    doProjectZ((char*)p->inPutDataStartPtr, (char*)p->outPutDataStartPtr, p->projMode, rank, p->xSize, p->ySize, p->startP, p->endP, startLoc, endLoc, slotBuffer);
+                    break;
+                case (NT_I8 | NT_UNSIGNED):
+                    doProjectZ((unsigned char*)p->inPutDataStartPtr , (unsigned char*)p->outPutDataStartPtr,  p->projMode, rank, p->xSize, p->ySize, p->startP, p->endP, startLoc, endLoc, slotBuffer);
+                    break;
+                case NT_I16:
+                    doProjectZ((short*)p->inPutDataStartPtr, (short*)p->outPutDataStartPtr, p->projMode, rank, p->xSize, p->ySize, p->startP, p->endP, startLoc, endLoc, slotBuffer);
+                    break;
+                case (NT_I16 | NT_UNSIGNED):
+                    doProjectZ((unsigned short*)p->inPutDataStartPtr , (unsigned short*)p->outPutDataStartPtr,  p->projMode, rank, p->xSize, p->ySize, p->startP, p->endP, startLoc, endLoc, slotBuffer);
+                    break;
+                case NT_I32:
+                    doProjectZ((SInt32*)p->inPutDataStartPtr, (SInt32*)p->outPutDataStartPtr, p->projMode, rank, p->xSize, p->ySize, p->startP, p->endP, startLoc, endLoc, slotBuffer);
+                    break;
+                case (NT_I32| NT_UNSIGNED):
+                    doProjectZ((UInt32*)p->inPutDataStartPtr, (UInt32*)p->outPutDataStartPtr, p->projMode, rank, p->xSize, p->ySize, p->startP, p->endP, startLoc, endLoc, slotBuffer);
+                    break;
+                case NT_FP32:
+                    doProjectZ((float*)p->inPutDataStartPtr, (float*)p->outPutDataStartPtr, p->projMode, rank, p->xSize, p->ySize, p->startP, p->endP, startLoc, endLoc, slotBuffer);
+                    break;
+                case NT_FP64:
+                    doProjectZ((double*)p->inPutDataStartPtr, (double*)p->outPutDataStartPtr,  p->projMode, rank, p->xSize, p->ySize, p->startP, p->endP, startLoc, endLoc, slotBuffer);
+                    break;
+            }
+            break;
+    }
+}
+
+/* Runs ProjectTile on the thread pool, in tiles of output locations, or of layers for Y projections. With inPlace set,
+ the output overwrites the input, and X and Y projections are done in order on one thread, because the output for one
+ location can land on input still to be read for an earlier location. Median and percentile projections get a buffer for each slot,
+ for the histograms of integer waves or a copy of one column for floating point waves. Returns 0 or MEMFAIL
+ Last Modified 2026/10/16 */
+int ProjectRunTiles (ProjectThreadParamsPtr paramsPtr, UInt8 inPlace){
+    int result;
+    CountInt nLocs, minLocsPerTile;
+    CountInt projSize = paramsPtr->endP - paramsPtr->startP + 1;
+    UInt32 nSlots = gNumProcessors;
+    switch (paramsPtr->flatDim){
+        case 0:
+            nLocs = paramsPtr->ySize * paramsPtr->zSize;
+            break;
+        case 1:
+            nLocs = paramsPtr->zSize;
+            break;
+        default:
+            nLocs = paramsPtr->xSize * paramsPtr->ySize;
+            break;
+    }
+    // aim for at least PROJECT_MIN_TILE points to read in a tile, and for Z projections, at least one full block of XY
+    // locations, so each layer of a tile is read as a long contiguous run
+    if (paramsPtr->flatDim == 1){
+        minLocsPerTile = PROJECT_MIN_TILE/(paramsPtr->xSize * projSize) + 1;
+    }else{
+        minLocsPerTile = PROJECT_MIN_TILE/projSize + 1;
+        if ((paramsPtr->flatDim == 2) && (minLocsPerTile < PROJECT_Z_BLOCK))
+            minLocsPerTile = PROJECT_Z_BLOCK;
+    }
+    if ((inPlace) && (paramsPtr->flatDim != 2))
+        nSlots = 1;
+    paramsPtr->bufferPtr = nullptr;
+    paramsPtr->bufferBytes = 0;
+    if ((paramsPtr->projMode >= 3) && (projSize > 1)){
+        if (ProjectUseHist (paramsPtr->inPutWaveType, projSize)){
+            paramsPtr->bufferBytes = PROJECT_HIST_BLOCK * 256 * sizeof (UInt32);
+        }else{
+            paramsPtr->bufferBytes = projSize * sizeof (double);
+        }
+        paramsPtr->bufferPtr = (char*)WMNewPtr (nSlots * paramsPtr->bufferBytes);
+        if (paramsPtr->bufferPtr == nullptr) return MEMFAIL;
+    }
+    if ((inPlace) && (paramsPtr->flatDim != 2)){
+        result = ThreadPoolRunTiles (ProjectTile, paramsPtr, nLocs, nLocs, 1);
+    }else{
+        result = ThreadPoolRunTiles (ProjectTile, paramsPtr, nLocs, ThreadPoolTileSize (nLocs, minLocsPerTile), nSlots);
+    }
+    if (paramsPtr->bufferPtr != nullptr){
+        WMDisposePtr ((Ptr)paramsPtr->bufferPtr);
+        paramsPtr->bufferPtr = nullptr;
+    }
+    return result;
+}
+
+/* ------------------------------Projections of several statistics at once----------------------------------------------*/
+
+/* Adds one row of a block of columns to the sums, minima and maxima of ProjectMultiT, and the row of the first maximum
+ when argMax is given. Rows of columns next to each other, as for Y and Z projections, are read as contiguous runs
+ Last Modified 2026/10/16 */
+template <typename T> static inline void ProjectMultiRowT (T* srcRow, CountInt toNextPoint, CountInt blockPoints, CountInt iRow, double* shiftVal, double* sumDiff, double* sumSqDiff, T* minVals, T* maxVals, CountInt* argMax){
+    CountInt iPoint;
+    T value;
+    double diff;
+    if (argMax != nullptr){
+        for (iPoint = 0; iPoint < blockPoints; iPoint++)
+            argMax [iPoint] = (srcRow [iPoint * toNextPoint] > maxVals [iPoint]) ? iRow : argMax [iPoint];
+    }
+    if (toNextPoint == 1){
+        for (iPoint = 0; iPoint < blockPoints; iPoint++){
+            value = srcRow [iPoint];
+            diff = value - shiftVal [iPoint];
+            sumDiff [iPoint] += diff;
+            sumSqDiff [iPoint] += diff * diff;
+            minVals [iPoint] = (value < minVals [iPoint]) ? value : minVals [iPoint];
+            maxVals [iPoint] = (value > maxVals [iPoint]) ? value : maxVals [iPoint];
+        }
+    }else{
+        for (iPoint = 0; iPoint < blockPoints; iPoint++){
+            value = srcRow [iPoint * toNextPoint];
+            diff = value - shiftVal [iPoint];
+            sumDiff [iPoint] += diff;
+            sumSqDiff [iPoint] += diff * diff;
+            minVals [iPoint] = (value < minVals [iPoint]) ? value : minVals [iPoint];
+            maxVals [iPoint] = (value > maxVals [iPoint]) ? value : maxVals [iPoint];
+        }
+    }
+}
+
+/* Statistics of each of nPoints columns, for the statistics in statMask, written to one layer of the output for each
+ statistic, outFrameSize points apart. Columns start toNextPoint apart, and each has nRows points, toNextRow apart. The
+ columns are read in blocks, a row at a time, and each row of a block is used for every statistic before the next row
+ is read. Sums are of differences from the first point of each column, to keep the precision of the standard
+ deviation, which divides by nRows - 1, and is 0 for a single row. Argmax is the row of the first maximum. For medians,
+ blocks are of PROJECT_HIST_BLOCK columns, and each row is also counted into the histograms of integer waves, or
+ copied into a buffer of columns for medianT, in bufferPtr
+ Last Modified 2026/10/16 */
+template <typename T, typename O> void ProjectMultiT (T* srcStart, O* destStart, CountInt nPoints, CountInt toNextPoint, CountInt nRows, CountInt toNextRow, UInt32 statMask, CountInt outFrameSize, char* bufferPtr){
+    const UInt8 doMedian = ((statMask & PROJECT_STAT_MEDIAN) != 0);
+    const UInt8 isInteger = ((T)0.5 == 0);
+    const UInt8 useHist = (doMedian && isInteger && (nRows >= PROJECT_HIST_MIN_POINTS));
+    const CountInt blockSize = doMedian ? PROJECT_HIST_BLOCK : PROJECT_MULTI_BLOCK;
+    const UInt32 shift = 8 * (ProjectHistBytes<T>() - 1);
+    double shiftVal [PROJECT_MULTI_BLOCK], sumDiff [PROJECT_MULTI_BLOCK], sumSqDiff [PROJECT_MULTI_BLOCK];
+    T minVals [PROJECT_MULTI_BLOCK], maxVals [PROJECT_MULTI_BLOCK];
+    CountInt argMax [PROJECT_MULTI_BLOCK];
+    CountInt* argMaxPtr = (statMask & PROJECT_STAT_ARGMAX) ? argMax : nullptr;
+    UInt32 keys [PROJECT_HIST_BLOCK];
+    UInt32* histPtr = (UInt32*)bufferPtr;
+    T* colPtr = (T*)bufferPtr;
+    CountInt blockStart, blockPoints, iPoint, iRow;
+    T *srcBlock, *srcRow, *srcPoint;
+    O *destLayer;
+    double nVals = (double)nRows, variance;
+    for (blockStart = 0; blockStart < nPoints; blockStart += blockSize){
+        blockPoints = nPoints - blockStart;
+        if (blockPoints > blockSize)
+            blockPoints = blockSize;
+        srcBlock = srcStart + blockStart * toNextPoint;
+        for (iPoint = 0, srcPoint = srcBlock; iPoint < blockPoints; iPoint++, srcPoint += toNextPoint){
+            shiftVal [iPoint] = *srcPoint;
+            sumDiff [iPoint] = sumSqDiff [iPoint] = 0;
+            minVals [iPoint] = maxVals [iPoint] = *srcPoint;
+            argMax [iPoint] = 0;
+        }
+        if (useHist)
+            memset (histPtr, 0, blockPoints * 256 * sizeof (UInt32));
+        for (iRow = 0, srcRow = srcBlock; iRow < nRows; iRow++, srcRow += toNextRow){
+            ProjectMultiRowT (srcRow, toNextPoint, blockPoints, iRow, shiftVal, sumDiff, sumSqDiff, minVals, maxVals, argMaxPtr);
+            if (useHist){
+                for (iPoint = 0, srcPoint = srcRow; iPoint < blockPoints; iPoint++, srcPoint += toNextPoint)
+                    histPtr [(iPoint << 8) + (ProjectHistKey (*srcPoint) >> shift)]++;
+            }else if (doMedian){
+                for (iPoint = 0, srcPoint = srcRow; iPoint < blockPoints; iPoint++, srcPoint += toNextPoint)
+                    colPtr [iPoint * nRows + iRow] = *srcPoint;
+            }
+        }
+        destLayer = destStart + blockStart;
+        if (statMask & PROJECT_STAT_MIN){
+            for (iPoint = 0; iPoint < blockPoints; iPoint++)
+                destLayer [iPoint] = (O)minVals [iPoint];
+            destLayer += outFrameSize;
+        }
+        if (statMask & PROJECT_STAT_MAX){
+            for (iPoint = 0; iPoint < blockPoints; iPoint++)
+                destLayer [iPoint] = (O)maxVals [iPoint];
+            destLayer += outFrameSize;
+        }
+        if (statMask & PROJECT_STAT_MEAN){
+            for (iPoint = 0; iPoint < blockPoints; iPoint++)
+                destLayer [iPoint] = (O)(shiftVal [iPoint] + sumDiff [iPoint]/nVals);
+            destLayer += outFrameSize;
+        }
+        if (statMask & PROJECT_STAT_STD){
+            for (iPoint = 0; iPoint < blockPoints; iPoint++){
+                variance = (nRows > 1) ? (sumSqDiff [iPoint] - sumDiff [iPoint] * sumDiff [iPoint]/nVals)/(nVals - 1) : 0;
+                destLayer [iPoint] = (O)sqrt ((variance > 0) ? variance : 0);
+            }
+            destLayer += outFrameSize;
+        }
+        if (statMask & PROJECT_STAT_SUM){
+            for (iPoint = 0; iPoint < blockPoints; iPoint++)
+                destLayer [iPoint] = (O)(shiftVal [iPoint] * nVals + sumDiff [iPoint]);
+            destLayer += outFrameSize;
+        }
+        if (statMask & PROJECT_STAT_ARGMAX){
+            for (iPoint = 0; iPoint < blockPoints; iPoint++)
+                destLayer [iPoint] = (O)argMax [iPoint];
+            destLayer += outFrameSize;
+        }
+        if (useHist){
+            ProjectHistFinishT (srcBlock, blockPoints, toNextPoint, nRows, toNextRow, nRows/2, histPtr, keys);
+            for (iPoint = 0; iPoint < blockPoints; iPoint++)
+                destLayer [iPoint] = (O)ProjectHistValue<T> (keys [iPoint]);
+        }else if (doMedian){
+            for (iPoint = 0; iPoint < blockPoints; iPoint++)
+                destLayer [iPoint] = (O)medianT (nRows, colPtr + iPoint * nRows);
+        }
+    }
+}
+
+/* Does one tile of ProjectMulti: YZ locations for X, layers for Y, and XY locations for Z, as for ProjectTile
+ Last Modified 2026/10/16 */
+template <typename T, typename O> void ProjectMultiTileT (ProjectMultiThreadParamsPtr p, T* srcWaveStart, O* destWaveStart, CountInt startLoc, CountInt endLoc, char* bufferPtr){
+    CountInt xSize = p->xSize, ySize = p->ySize, zSize = p->zSize;
+    switch (p->flatDim){
+        case 0: // YZ locations are xSize apart, and columns at each location are next to each other
+            ProjectMultiT (srcWaveStart + startLoc * xSize, destWaveStart + startLoc, endLoc - startLoc, xSize, xSize, 1, p->statMask, ySize * zSize, bufferPtr);
+            break;
+        case 1: // each layer is a row of XZ locations next to each other, with rows xSize apart
+            for (CountInt iLayer = startLoc; iLayer < endLoc; iLayer++){
+                ProjectMultiT (srcWaveStart + iLayer * xSize * ySize, destWaveStart + iLayer * xSize, xSize, 1, ySize, xSize, p->statMask, xSize * zSize, bufferPtr);
+            }
+            break;
+        default: // XY locations are next to each other, with layers xSize * ySize apart
+            ProjectMultiT (srcWaveStart + startLoc, destWaveStart + startLoc, endLoc - startLoc, 1, zSize, xSize * ySize, p->statMask, xSize * ySize, bufferPtr);
+            break;
+    }
+}
+
+/* Wave type of the output of ProjectMulti: as for KalmanStats, single precision floating point for 8 and 16 bit and
+ single precision waves, and double precision for 32 bit and double precision waves, but always double precision when
+ the sum is asked for, as a sum of many layers of 16 bit data can have more than the 24 bits single precision can hold
+ Last Modified 2026/10/16 */
+int ProjectMultiOutPutType (int inPutWaveType, UInt32 statMask){
+    return (statMask & PROJECT_STAT_SUM) ? NT_FP64 : KalmanStatsOutPutType (inPutWaveType);
+}
+
+/* Does one tile of ProjectMulti for input of type T, with the output type from ProjectMultiOutPutType
+ Last Modified 2026/10/16 */
+template <typename T> static void ProjectMultiTileOutT (ProjectMultiThreadParamsPtr p, T* srcWaveStart, CountInt startLoc, CountInt endLoc, char* bufferPtr){
+    if (ProjectMultiOutPutType (p->inPutWaveType, p->statMask) == NT_FP64)
+        ProjectMultiTileT (p, srcWaveStart, (double*)p->outPutDataStartPtr, startLoc, endLoc, bufferPtr);
+    else
+        ProjectMultiTileT (p, srcWaveStart, (float*)p->outPutDataStartPtr, startLoc, endLoc, bufferPtr);
+}
+
+/* Each tile of ProjectMulti is done with this function, with the output type chosen from the input type and statMask
+ Last Modified 2026/10/16 */
+void ProjectMultiTile (void* paramsPtr, CountInt startLoc, CountInt endLoc, UInt32 iSlot){
+    ProjectMultiThreadParamsPtr p = (ProjectMultiThreadParamsPtr) paramsPtr;
+    char* slotBuffer = p->bufferPtr + iSlot * p->bufferBytes;
+    int result = 0;
+    switch (p->inPutWaveType){
+        case NT_I8:
+            ProjectMultiTileOutT (p, (char*)p->inPutDataStartPtr, startLoc, endLoc, slotBuffer);
+            break;
+        case (NT_I8 | NT_UNSIGNED):
+            ProjectMultiTileOutT (p, (unsigned char*)p->inPutDataStartPtr, startLoc, endLoc, slotBuffer);
+            break;
+        case NT_I16:
+            ProjectMultiTileOutT (p, (short*)p->inPutDataStartPtr, startLoc, endLoc, slotBuffer);
+            break;
+        case (NT_I16 | NT_UNSIGNED):
+            ProjectMultiTileOutT (p, (unsigned short*)p->inPutDataStartPtr, startLoc, endLoc, slotBuffer);
+            break;
+        case NT_I32:
+            ProjectMultiTileOutT (p, (SInt32*)p->inPutDataStartPtr, startLoc, endLoc, slotBuffer);
+            break;
+        case (NT_I32| NT_UNSIGNED):
+            ProjectMultiTileOutT (p, (UInt32*)p->inPutDataStartPtr, startLoc, endLoc, slotBuffer);
+            break;
+        case NT_FP32:
+            ProjectMultiTileOutT (p, (float*)p->inPutDataStartPtr, startLoc, endLoc, slotBuffer);
+            break;
+        case NT_FP64:
+            ProjectMultiTileOutT (p, (double*)p->inPutDataStartPtr, startLoc, endLoc, slotBuffer);
+            break;
+        default:    // Unknown data type - possible in a future version of Igor.
+            result = NT_FNOT_AVAIL;
+            break;
+    }
+    if (result != 0) throw result;
+}
+
+/* Runs ProjectMultiTile on the thread pool, with tiles as for ProjectRunTiles. For medians, each slot gets a buffer for
+ the histograms of a block of integer columns, or for a copy of a block of floating point columns. Returns 0,
+ MEMFAIL, or an error thrown by a tile
+ Last Modified 2026/10/16 */
+int ProjectMultiRunTiles (ProjectMultiThreadParamsPtr paramsPtr){
+    int result;
+    CountInt nLocs, projSize, minLocsPerTile;
+    UInt32 nSlots = gNumProcessors;
+    switch (paramsPtr->flatDim){
+        case 0:
+            nLocs = paramsPtr->ySize * paramsPtr->zSize;
+            projSize = paramsPtr->xSize;
+            break;
+        case 1:
+            nLocs = paramsPtr->zSize;
+            projSize = paramsPtr->ySize;
+            break;
+        default:
+            nLocs = paramsPtr->xSize * paramsPtr->ySize;
+            projSize = paramsPtr->zSize;
+            break;
+    }
+    if (paramsPtr->flatDim == 1){
+        minLocsPerTile = PROJECT_MIN_TILE/(paramsPtr->xSize * projSize) + 1;
+    }else{
+        minLocsPerTile = PROJECT_MIN_TILE/projSize + 1;
+        if ((paramsPtr->flatDim == 2) && (minLocsPerTile < PROJECT_Z_BLOCK))
+            minLocsPerTile = PROJECT_Z_BLOCK;
+    }
+    paramsPtr->bufferPtr = nullptr;
+    paramsPtr->bufferBytes = 0;
+    if (paramsPtr->statMask & PROJECT_STAT_MEDIAN){
+        if (ProjectUseHist (paramsPtr->inPutWaveType, projSize)){
+            paramsPtr->bufferBytes = PROJECT_HIST_BLOCK * 256 * sizeof (UInt32);
+        }else{
+            paramsPtr->bufferBytes = PROJECT_HIST_BLOCK * projSize * sizeof (double);
+        }
+        paramsPtr->bufferPtr = (char*)WMNewPtr (nSlots * paramsPtr->bufferBytes);
+        if (paramsPtr->bufferPtr == nullptr) return MEMFAIL;
+    }
+    result = ThreadPoolRunTiles (ProjectMultiTile, paramsPtr, nLocs, ThreadPoolTileSize (nLocs, minLocsPerTile), nSlots);
+    if (paramsPtr->bufferPtr != nullptr){
+        WMDisposePtr ((Ptr)paramsPtr->bufferPtr);
+        paramsPtr->bufferPtr = nullptr;
+    }
+    return result;
+}
+
+/* ------------------------------Depth coded projections------------------------------------------------------------*/
+
+/* Folds the layers of one block of XY locations into the maximum and/or minimum of each location, and the layer where
+ each was first found, reading each layer of the block as one contiguous run, as doProjectZ does for its minimum and
+ maximum projections. The outputs for the block start out as the first layer, and stay in L1 cache while every layer
+ is read. doMax and doMin are constants, so the loop for each has no branches and can be vectorized
+ Last Modified 2026/10/16 */
+template <typename T, int doMax, int doMin> static void ProjectDepthBlockT (T* srcLayer, CountInt toNextLayer, CountInt nLayers, CountInt blockPoints, T* maxBlock, SInt32* argMaxBlock, T* minBlock, SInt32* argMinBlock){
+    CountInt iLayer, iPoint;
+    // floating point comparisons can trap, so are not repeated in a second select, and the compiler leaves the loop
+    // with branches. For them, the layer is blended in with a mask of all ones where the value is new instead
+    const bool isFloat = ((T)0.5 != 0);
+    T value;
+    SInt32 isNew;
+    for (iPoint = 0; iPoint < blockPoints; iPoint++){
+        if (doMax){
+            maxBlock [iPoint] = srcLayer [iPoint];
+            argMaxBlock [iPoint] = 0;
+        }
+        if (doMin){
+            minBlock [iPoint] = srcLayer [iPoint];
+            argMinBlock [iPoint] = 0;
+        }
+    }
+    for (iLayer = 1, srcLayer += toNextLayer; iLayer < nLayers; iLayer++, srcLayer += toNextLayer){
+        for (iPoint = 0; iPoint < blockPoints; iPoint++){
+            value = srcLayer [iPoint];
+            if (doMax){
+                if (isFloat){
+                    isNew = -(SInt32)(value > maxBlock [iPoint]);
+                    argMaxBlock [iPoint] = (argMaxBlock [iPoint] & ~isNew) | ((SInt32)iLayer & isNew);
+                }else{
+                    argMaxBlock [iPoint] = (value > maxBlock [iPoint]) ? (SInt32)iLayer : argMaxBlock [iPoint];
+                }
+                maxBlock [iPoint] = (value > maxBlock [iPoint]) ? value : maxBlock [iPoint];
+            }
+            if (doMin){
+                if (isFloat){
+                    isNew = -(SInt32)(value < minBlock [iPoint]);
+                    argMinBlock [iPoint] = (argMinBlock [iPoint] & ~isNew) | ((SInt32)iLayer & isNew);
+                }else{
+                    argMinBlock [iPoint] = (value < minBlock [iPoint]) ? (SInt32)iLayer : argMinBlock [iPoint];
+                }
+                minBlock [iPoint] = (value < minBlock [iPoint]) ? value : minBlock [iPoint];
+            }
+        }
+    }
+}
+
+/* Maximum and/or minimum Z projection of one tile of XY locations, from startLoc up to, but not including, endLoc, with
+ the layer of the first maximum and/or minimum at each location, in blocks of PROJECT_Z_BLOCK XY locations. With both,
+ the maximum and its layer go in the first layer of the outputs, and the minimum and its layer in the second
+ Last Modified 2026/10/16 */
+template <typename T> void ProjectDepthTileT (ProjectDepthThreadParamsPtr p, T* srcWaveStart, T* destWaveStart, CountInt startLoc, CountInt endLoc){
+    CountInt frameSize = p->xSize * p->ySize;
+    CountInt blockStart, blockPoints;
+    T *srcBlock, *destBlock;
+    SInt32 *indexBlock;
+    for (blockStart = startLoc; blockStart < endLoc; blockStart += PROJECT_Z_BLOCK){
+        blockPoints = endLoc - blockStart;
+        if (blockPoints > PROJECT_Z_BLOCK)
+            blockPoints = PROJECT_Z_BLOCK;
+        srcBlock = srcWaveStart + blockStart;
+        destBlock = destWaveStart + blockStart;
+        indexBlock = p->indexDataStartPtr + blockStart;
+        switch (p->projMode){
+            case 0:
+                ProjectDepthBlockT<T, 0, 1> (srcBlock, frameSize, p->zSize, blockPoints, nullptr, nullptr, destBlock, indexBlock);
+                break;
+            case 1:
+                ProjectDepthBlockT<T, 1, 0> (srcBlock, frameSize, p->zSize, blockPoints, destBlock, indexBlock, nullptr, nullptr);
+                break;
+            default:
+                ProjectDepthBlockT<T, 1, 1> (srcBlock, frameSize, p->zSize, blockPoints, destBlock, indexBlock, destBlock + frameSize, indexBlock + frameSize);
+                break;
+        }
+    }
+}
+
+/* Each tile of a depth coded projection is done with this function. Tiles are XY locations
+ Last Modified 2026/10/16 */
+void ProjectDepthTile (void* paramsPtr, CountInt startLoc, CountInt endLoc, UInt32 iSlot){
+    ProjectDepthThreadParamsPtr p = (ProjectDepthThreadParamsPtr) paramsPtr;
+    int result = 0;
+    switch (p->inPutWaveType){
+        case NT_I8:
+            ProjectDepthTileT (p, (char*)p->inPutDataStartPtr, (char*)p->outPutDataStartPtr, startLoc, endLoc);
+            break;
+        case (NT_I8 | NT_UNSIGNED):
+            ProjectDepthTileT (p, (unsigned char*)p->inPutDataStartPtr, (unsigned char*)p->outPutDataStartPtr, startLoc, endLoc);
+            break;
+        case NT_I16:
+            ProjectDepthTileT (p, (short*)p->inPutDataStartPtr, (short*)p->outPutDataStartPtr, startLoc, endLoc);
+            break;
+        case (NT_I16 | NT_UNSIGNED):
+            ProjectDepthTileT (p, (unsigned short*)p->inPutDataStartPtr, (unsigned short*)p->outPutDataStartPtr, startLoc, endLoc);
+            break;
+        case NT_I32:
+            ProjectDepthTileT (p, (SInt32*)p->inPutDataStartPtr, (SInt32*)p->outPutDataStartPtr, startLoc, endLoc);
+            break;
+        case (NT_I32| NT_UNSIGNED):
+            ProjectDepthTileT (p, (UInt32*)p->inPutDataStartPtr, (UInt32*)p->outPutDataStartPtr, startLoc, endLoc);
+            break;
+        case NT_FP32:
+            ProjectDepthTileT (p, (float*)p->inPutDataStartPtr, (float*)p->outPutDataStartPtr, startLoc, endLoc);
+            break;
+        case NT_FP64:
+            ProjectDepthTileT (p, (double*)p->inPutDataStartPtr, (double*)p->outPutDataStartPtr, startLoc, endLoc);
+            break;
+        default:    // Unknown data type - possible in a future version of Igor.
+            result = NT_FNOT_AVAIL;
+            break;
+    }
+    if (result != 0) throw result;
+}
+
+/* Runs ProjectDepthTile on the thread pool, in tiles of XY locations as for Z projections with ProjectRunTiles.
+ Returns 0, or an error thrown by a tile
+ Last Modified 2026/10/16 */
+int ProjectDepthRunTiles (ProjectDepthThreadParamsPtr paramsPtr){
+    CountInt nLocs = paramsPtr->xSize * paramsPtr->ySize;
+    CountInt minLocsPerTile = PROJECT_MIN_TILE/paramsPtr->zSize + 1;
+    if (minLocsPerTile < PROJECT_Z_BLOCK)
+        minLocsPerTile = PROJECT_Z_BLOCK;
+    return ThreadPoolRunTiles (ProjectDepthTile, paramsPtr, nLocs, ThreadPoolTileSize (nLocs, minLocsPerTile), gNumProcessors);
+}
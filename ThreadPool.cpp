@@ -0,0 +1,462 @@
+#include "twoPhotonKernels.h"
+#include <chrono>
+
+/* ---------------------------------------------ThreadPool----------------------------------------------------------
+ A pool of worker threads that is created once, when the XOP is loaded, and shared by all the XFUNCs. Creating and
+ joining a set of pthreads for every call costs as much as the work itself for small frames, e.g., when KalmanNext
+ or ProjectZSlice are called once per frame during acquisition.
+ Each call to ThreadPoolRunTiles makes a job, which is a range of items (pixels, layers, frames...) cut into tiles.
+ The tiles are dealt out in contiguous runs to a number of slots, one slot for each thread that works on the job.
+ A thread takes tiles from the front of its own slot, and when its slot is empty it steals the back half of the
+ slot with the most tiles left, so a thread that gets slow tiles (median edges, a busy core) is helped out by the
+ others instead of holding up the whole call. Jobs wait in a list, and workers take slots from the oldest job first.
+ The thread that called ThreadPoolRunTiles always works slot 0, then waits for any slots still running on workers.
+ The time each thread spends running tiles is added up, so ThreadBusyTimes can show how evenly the load is spread.
+ XFUNCs marked F_THREADSAFE may be called from several Igor preemptive threads at once, and each call would ask for
+ all of the pool's threads. A governor counts the slots claimed by jobs that are running, and gives each new job no
+ more slots than are free, so the calling threads and the workers running slots never add up to more than the pool
+ size. A call that finds no slots free does not wait for a running job to give some back, but runs all of its tiles
+ on its own thread, which is not one of the pool's workers. Its slot is still counted, so the next jobs get fewer
+ workers until it is done, and the workers are never asked for more slots than there are of them.
+ Last Modified 2026/10/16
+ ---------------------------------------------------------------------------------------------------------------*/
+
+/* A run of tiles belonging to one slot of a job, from nextTile up to, but not including, endTile
+ Last Modified 2026/10/16 */
+typedef struct ThreadPoolSlot{
+    UInt32 nextTile;
+    UInt32 endTile;
+} ThreadPoolSlot, *ThreadPoolSlotPtr;
+
+/* A job for the pool: a tile function and a paramater structure to run it on
+ Last Modified 2026/10/16 */
+typedef struct ThreadPoolJob{
+    ThreadPoolTileFunc tileFunc;    // function that does the work for one tile
+    void* paramsPtr;                // paramater structure passed to tileFunc
+    CountInt nItems;                // total number of items in the job
+    CountInt itemsPerTile;          // number of items in each tile, last tile may be shorter
+    UInt32 nSlots;                  // number of slots, i.e., the most threads that can work on this job
+    ThreadPoolControlPtr controlPtr; // cancel flag and progress, or nullptr
+    ThreadPoolSlotPtr slotsPtr;     // array of nSlots slots, protected by tileMutex
+    pthread_mutex_t tileMutex;      // protects slotsPtr and result
+    int result;                     // first error thrown by a tile, or 0
+    UInt32 nextSlot;                // next slot to be handed out to a worker, protected by gPoolMutex
+    UInt32 nSlotsDone;              // number of slots finished by workers, protected by gPoolMutex
+    UInt8 isListed;                 // non-zero while job is in the list of jobs, protected by gPoolMutex
+    pthread_cond_t doneCond;        // signalled when a worker finishes a slot
+    struct ThreadPoolJob* nextJob;  // next job in list of jobs with slots still to be handed out
+} ThreadPoolJob, *ThreadPoolJobPtr;
+
+/* Paramaters for running an array of thread paramater structures through ThreadPoolRun
+ Last Modified 2026/10/16 */
+typedef struct ThreadPoolTaskParams{
+    void* (*threadFunc)(void*);     // thread function, as was passed to pthread_create
+    char* paramArrayPtr;            // start of array of thread paramater structures
+    size_t paramSize;               // size of each paramater structure
+} ThreadPoolTaskParams, *ThreadPoolTaskParamsPtr;
+
+// Global Variable for number of processors for threading
+UInt32 gNumProcessors;
+
+// Globals for the pool, all protected by gPoolMutex
+static pthread_mutex_t gPoolMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t gPoolWorkCond = PTHREAD_COND_INITIALIZER;  // signalled when a job is added, or the pool is stopping
+static pthread_t* gPoolThreadsPtr = nullptr;    // array of worker threads
+static UInt32 gPoolNumWorkers = 0;              // number of worker threads running
+static ThreadPoolJobPtr gPoolJobsHead = nullptr; // oldest job with slots still to hand out
+static ThreadPoolJobPtr gPoolJobsTail = nullptr; // newest job
+static UInt8 gPoolQuit = 0;                     // set to tell workers to exit
+// Busy time statistics, index 0 is for threads calling ThreadPoolRunTiles, 1 to gPoolNumWorkers for worker threads
+static double* gPoolBusySecsPtr = nullptr;      // seconds spent running tiles
+static double* gPoolTilesDonePtr = nullptr;     // number of tiles run
+static UInt32 gPoolNumStats = 0;                // size of the statistics arrays
+static std::chrono::steady_clock::time_point gPoolStatsStart = std::chrono::steady_clock::now ();
+// Governor: slots claimed by running jobs, counting the calling thread's slot 0, also protected by gPoolMutex
+static UInt32 gPoolSlotsInUse = 0;
+static UInt8 gPoolGovernorOn = 1;               // set to 0 to let every job have all the slots it asks for
+// Seconds each calling thread has spent in ThreadPoolRunTiles without running tiles, taken by ThreadPoolTakeDispatchSecs
+static thread_local double gPoolDispatchSecs = 0;
+
+/* Removes a job from the list of jobs, if it is still there.
+ Called with gPoolMutex locked
+ Last Modified 2026/10/16 */
+static void ThreadPoolUnlistJob (ThreadPoolJobPtr job){
+    ThreadPoolJobPtr prevJob = nullptr;
+    ThreadPoolJobPtr aJob;
+    if (job->isListed == 0) return;
+    for (aJob = gPoolJobsHead; aJob != job; prevJob = aJob, aJob = aJob->nextJob);
+    if (prevJob == nullptr){
+        gPoolJobsHead = job->nextJob;
+    }else{
+        prevJob->nextJob = job->nextJob;
+    }
+    if (gPoolJobsTail == job) gPoolJobsTail = prevJob;
+    job->isListed = 0;
+}
+
+/* Gets the next tile for a slot, stealing the back half of the fullest slot when this slot is empty.
+ Returns 0 when there are no tiles left in the job, or a tile has thrown an error.
+ Called with tileMutex unlocked
+ Last Modified 2026/10/16 */
+static UInt8 ThreadPoolTakeTile (ThreadPoolJobPtr job, UInt32 iSlot, UInt32* iTilePtr){
+    ThreadPoolSlotPtr slot = &job->slotsPtr[iSlot];
+    ThreadPoolSlotPtr victim = nullptr;
+    UInt32 iVictim, nLeft, mostLeft = 0, nStolen;
+    UInt8 gotTile = 0;
+    pthread_mutex_lock (&job->tileMutex);
+    if ((job->result == 0) && (job->controlPtr != nullptr) && (job->controlPtr->cancel)) job->result = JOBCANCELLED;
+    if (job->result == 0){
+        if (slot->nextTile == slot->endTile){
+            for (iVictim = 0; iVictim < job->nSlots; iVictim++){
+                nLeft = job->slotsPtr[iVictim].endTile - job->slotsPtr[iVictim].nextTile;
+                if (nLeft > mostLeft){
+                    mostLeft = nLeft;
+                    victim = &job->slotsPtr[iVictim];
+                }
+            }
+            if (victim != nullptr){
+                nStolen = (mostLeft + 1)/2;
+                slot->endTile = victim->endTile;
+                slot->nextTile = victim->endTile - nStolen;
+                victim->endTile -= nStolen;
+            }
+        }
+        if (slot->nextTile < slot->endTile){
+            *iTilePtr = slot->nextTile++;
+            gotTile = 1;
+        }
+    }
+    pthread_mutex_unlock (&job->tileMutex);
+    return gotTile;
+}
+
+/* Keeps the first error from the tiles of a job as its result
+ Called with tileMutex unlocked
+ Last Modified 2026/10/16 */
+static void ThreadPoolSetResult (ThreadPoolJobPtr job, int result){
+    pthread_mutex_lock (&job->tileMutex);
+    if (job->result == 0) job->result = result;
+    pthread_mutex_unlock (&job->tileMutex);
+}
+
+/* Runs tiles for a slot until there are none left in the job, catching errors thrown from the tile function so they
+ don't escape a pool thread. Returns the time spent running tiles and the number of tiles run.
+ Called with gPoolMutex unlocked
+ Last Modified 2026/10/16 */
+static void ThreadPoolDoSlot (ThreadPoolJobPtr job, UInt32 iSlot, double* busySecsPtr, double* tilesDonePtr){
+    UInt32 iTile;
+    CountInt startItem, endItem;
+    std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now ();
+    *tilesDonePtr = 0;
+    while (ThreadPoolTakeTile (job, iSlot, &iTile)){
+        startItem = iTile * job->itemsPerTile;
+        endItem = startItem + job->itemsPerTile;
+        if (endItem > job->nItems) endItem = job->nItems;
+        try{
+            job->tileFunc (job->paramsPtr, startItem, endItem, iSlot);
+        }catch (int thrown){
+            ThreadPoolSetResult (job, thrown);
+        }catch (...){  // as std::bad_alloc, which must not reach the top of a worker thread and terminate Igor
+            ThreadPoolSetResult (job, MEMFAIL);
+        }
+        if (job->controlPtr != nullptr) job->controlPtr->itemsDone += endItem - startItem;
+        *tilesDonePtr += 1;
+    }
+    *busySecsPtr = std::chrono::duration<double>(std::chrono::steady_clock::now () - startTime).count ();
+}
+
+/* Adds busy time and tiles done for a thread to the statistics.
+ Called with gPoolMutex locked
+ Last Modified 2026/10/16 */
+static void ThreadPoolAddStats (UInt32 iStat, double busySecs, double tilesDone){
+    if (iStat >= gPoolNumStats) return;
+    gPoolBusySecsPtr [iStat] += busySecs;
+    gPoolTilesDonePtr [iStat] += tilesDone;
+}
+
+/* Claims up to nSlots slots for a new job and returns the number claimed. When no slots are free it claims just one,
+ the calling thread's own slot 0, without waiting, so the job runs on the calling thread alone
+ Called with gPoolMutex locked
+ Last Modified 2026/10/16 */
+static UInt32 ThreadPoolClaimSlots (UInt32 nSlots){
+    UInt32 nFree;
+    if (gPoolGovernorOn){
+        nFree = (gPoolSlotsInUse < gPoolNumWorkers + 1) ? gPoolNumWorkers + 1 - gPoolSlotsInUse : 1;
+        if (nSlots > nFree) nSlots = nFree;
+    }
+    gPoolSlotsInUse += nSlots;
+    return nSlots;
+}
+
+/* Gives back slots claimed by ThreadPoolClaimSlots, so they can go to the next jobs
+ Called with gPoolMutex locked
+ Last Modified 2026/10/16 */
+static void ThreadPoolReleaseSlots (UInt32 nSlots){
+    if (nSlots == 0) return;
+    gPoolSlotsInUse -= nSlots;
+}
+
+/* Each worker thread in the pool runs this function until the pool is stopped. threadarg is the worker number,
+ starting from 1, used as the index for the worker's statistics
+ Last Modified 2026/10/16 */
+static void* ThreadPoolWorker (void* threadarg){
+    UInt32 iStat = (UInt32)(size_t)threadarg;
+    ThreadPoolJobPtr job;
+    UInt32 iSlot;
+    double busySecs, tilesDone;
+    pthread_mutex_lock (&gPoolMutex);
+    for (;;){
+        while ((gPoolJobsHead == nullptr) && (gPoolQuit == 0))
+            pthread_cond_wait (&gPoolWorkCond, &gPoolMutex);
+        if (gPoolJobsHead == nullptr) break; // quitting, and no work left
+        job = gPoolJobsHead;
+        iSlot = job->nextSlot++;
+        if (job->nextSlot == job->nSlots) ThreadPoolUnlistJob (job);
+        pthread_mutex_unlock (&gPoolMutex);
+        ThreadPoolDoSlot (job, iSlot, &busySecs, &tilesDone);
+        pthread_mutex_lock (&gPoolMutex);
+        ThreadPoolAddStats (iStat, busySecs, tilesDone);
+        job->nSlotsDone++;
+        pthread_cond_signal (&job->doneCond);
+    }
+    pthread_mutex_unlock (&gPoolMutex);
+    return nullptr;
+}
+
+/* Starts the pool, called from XOPMain. nThreads is the number of threads that will work on each job, including the
+ calling thread, so nThreads - 1 worker threads are created. Returns 0, or MEMFAIL if the pool could not be started,
+ in which case ThreadPoolRunTiles does all the tiles on the calling thread.
+ Last Modified 2026/10/16 */
+int ThreadPoolStart (UInt32 nThreads){
+    UInt32 iWorker, nWorkers = (nThreads > 1) ? nThreads - 1 : 0;
+    if ((gPoolThreadsPtr != nullptr) || (gPoolBusySecsPtr != nullptr)) ThreadPoolStop ();
+    gPoolBusySecsPtr = (double*)WMNewPtr ((nWorkers + 1) * sizeof (double));
+    gPoolTilesDonePtr = (double*)WMNewPtr ((nWorkers + 1) * sizeof (double));
+    if ((gPoolBusySecsPtr == nullptr) || (gPoolTilesDonePtr == nullptr)){
+        ThreadPoolStop ();
+        return MEMFAIL;
+    }
+    gPoolNumStats = nWorkers + 1;
+    ThreadPoolResetStats ();
+    if (nWorkers == 0) return 0;
+    gPoolThreadsPtr = (pthread_t*)WMNewPtr (nWorkers * sizeof (pthread_t));
+    if (gPoolThreadsPtr == nullptr) return MEMFAIL;
+    gPoolQuit = 0;
+    for (iWorker = 0; iWorker < nWorkers; iWorker++){
+        if (pthread_create (&gPoolThreadsPtr[iWorker], NULL, ThreadPoolWorker, (void*)(size_t)(iWorker + 1)) != 0) break;
+    }
+    gPoolNumWorkers = iWorker;
+    return (gPoolNumWorkers == nWorkers) ? 0 : MEMFAIL;
+}
+
+/* Stops the pool, called when Igor sends the CLEANUP message. Workers finish any jobs in progress before exiting
+ Last Modified 2026/10/16 */
+void ThreadPoolStop (void){
+    UInt32 iWorker;
+    pthread_mutex_lock (&gPoolMutex);
+    gPoolQuit = 1;
+    pthread_cond_broadcast (&gPoolWorkCond);
+    pthread_mutex_unlock (&gPoolMutex);
+    for (iWorker = 0; iWorker < gPoolNumWorkers; iWorker++){
+        pthread_join (gPoolThreadsPtr[iWorker], NULL);
+    }
+    if (gPoolThreadsPtr != nullptr) WMDisposePtr ((Ptr)gPoolThreadsPtr);
+    gPoolThreadsPtr = nullptr;
+    gPoolNumWorkers = 0;
+    pthread_mutex_lock (&gPoolMutex);
+    if (gPoolBusySecsPtr != nullptr) WMDisposePtr ((Ptr)gPoolBusySecsPtr);
+    if (gPoolTilesDonePtr != nullptr) WMDisposePtr ((Ptr)gPoolTilesDonePtr);
+    gPoolBusySecsPtr = nullptr;
+    gPoolTilesDonePtr = nullptr;
+    gPoolNumStats = 0;
+    pthread_mutex_unlock (&gPoolMutex);
+}
+
+/* Returns the number of threads in the pool, including one for the threads that call ThreadPoolRunTiles
+ Last Modified 2026/10/16 */
+UInt32 ThreadPoolNumThreads (void){
+    return gPoolNumWorkers + 1;
+}
+
+/* Returns the number of slots for a background job, as for the Async XFUNCs, leaving one of the pool's threads for
+ ordinary calls, but at least 1
+ Last Modified 2026/10/16 */
+UInt32 ThreadPoolBackgroundSlots (void){
+    return (gPoolNumWorkers > 0) ? gPoolNumWorkers : 1;
+}
+
+/* Returns a number of items per tile for splitting nItems among the pool's threads, about THREADPOOL_TILES_PER_THREAD
+ tiles per thread, so there are spare tiles to steal, but never fewer than minItemsPerTile items in a tile
+ Last Modified 2026/10/16 */
+CountInt ThreadPoolTileSize (CountInt nItems, CountInt minItemsPerTile){
+    CountInt nTiles = ThreadPoolNumThreads () * THREADPOOL_TILES_PER_THREAD;
+    CountInt itemsPerTile = (nItems + nTiles - 1)/nTiles;
+    if (minItemsPerTile < 1) minItemsPerTile = 1;
+    return (itemsPerTile < minItemsPerTile) ? minItemsPerTile : itemsPerTile;
+}
+
+/* Runs tileFunc on tiles of itemsPerTile items each, covering items 0 to nItems - 1, using at most nSlots threads,
+ or fewer if the governor has given some of the pool's threads to other jobs, and returns when all the tiles are
+ finished. iSlot passed to tileFunc is less than nSlots, and no two tiles with the same iSlot run at the same time,
+ so iSlot can be used to index per-thread buffers. Returns 0, or the first error code thrown by a tile, or MEMFAIL
+ for any other exception, such as std::bad_alloc, in which case tiles not yet started are skipped.
+ Last Modified 2026/10/16 */
+int ThreadPoolRunTiles (ThreadPoolTileFunc tileFunc, void* paramsPtr, CountInt nItems, CountInt itemsPerTile, UInt32 nSlots){
+    return ThreadPoolRunTilesControlled (tileFunc, paramsPtr, nItems, itemsPerTile, nSlots, nullptr);
+}
+
+/* Runs a job as for ThreadPoolRunTiles, checking the cancel flag in controlPtr before each tile is handed out, and
+ adding the items in each finished tile to its itemsDone, so another thread can follow the job and stop it
+ Last Modified 2026/10/16 */
+int ThreadPoolRunTilesControlled (ThreadPoolTileFunc tileFunc, void* paramsPtr, CountInt nItems, CountInt itemsPerTile, UInt32 nSlots, ThreadPoolControlPtr controlPtr){
+    ThreadPoolJob job;
+    ThreadPoolSlot oneSlot;
+    UInt32 iSlot, nTiles, nClaimed;
+    double busySecs, tilesDone;
+    std::chrono::steady_clock::time_point runStart;
+    if (nItems <= 0) return 0;
+    runStart = std::chrono::steady_clock::now ();
+    if (itemsPerTile < 1) itemsPerTile = 1;
+    nTiles = (UInt32)((nItems + itemsPerTile - 1)/itemsPerTile);
+    if (nSlots > gPoolNumWorkers + 1) nSlots = gPoolNumWorkers + 1;
+    if (nSlots > nTiles) nSlots = nTiles;
+    if (nSlots < 1) nSlots = 1;
+    // ask the governor for slots, which may be fewer than we want if other jobs are running
+    pthread_mutex_lock (&gPoolMutex);
+    nClaimed = nSlots = ThreadPoolClaimSlots (nSlots);
+    pthread_mutex_unlock (&gPoolMutex);
+    job.tileFunc = tileFunc;
+    job.paramsPtr = paramsPtr;
+    job.controlPtr = controlPtr;
+    job.nItems = nItems;
+    job.itemsPerTile = itemsPerTile;
+    job.result = 0;
+    job.nextSlot = 1; // slot 0 is for this thread
+    job.nSlotsDone = 0;
+    job.isListed = 0;
+    job.nextJob = nullptr;
+    job.slotsPtr = &oneSlot;
+    if (nSlots > 1){
+        job.slotsPtr = (ThreadPoolSlotPtr)WMNewPtr (nSlots * sizeof (ThreadPoolSlot));
+        if (job.slotsPtr == nullptr){ // do it all on this thread
+            job.slotsPtr = &oneSlot;
+            nSlots = 1;
+        }
+    }
+    job.nSlots = nSlots;
+    // deal out the tiles to the slots in contiguous runs
+    for (iSlot = 0; iSlot < nSlots; iSlot++){
+        job.slotsPtr[iSlot].nextTile = (UInt32)(((UInt64)nTiles * iSlot)/nSlots);
+        job.slotsPtr[iSlot].endTile = (UInt32)(((UInt64)nTiles * (iSlot + 1))/nSlots);
+    }
+    pthread_mutex_init (&job.tileMutex, NULL);
+    // With only 1 slot, no need to involve the pool
+    if (nSlots == 1){
+        ThreadPoolDoSlot (&job, 0, &busySecs, &tilesDone);
+        pthread_mutex_lock (&gPoolMutex);
+        ThreadPoolAddStats (0, busySecs, tilesDone);
+        ThreadPoolReleaseSlots (nClaimed);
+        pthread_mutex_unlock (&gPoolMutex);
+        pthread_mutex_destroy (&job.tileMutex);
+        gPoolDispatchSecs += std::chrono::duration<double>(std::chrono::steady_clock::now () - runStart).count () - busySecs;
+        return job.result;
+    }
+    pthread_cond_init (&job.doneCond, NULL);
+    pthread_mutex_lock (&gPoolMutex);
+    // add job to end of list, and wake up workers
+    if (gPoolJobsTail == nullptr){
+        gPoolJobsHead = &job;
+    }else{
+        gPoolJobsTail->nextJob = &job;
+    }
+    gPoolJobsTail = &job;
+    job.isListed = 1;
+    pthread_cond_broadcast (&gPoolWorkCond);
+    pthread_mutex_unlock (&gPoolMutex);
+    // do tiles on this thread too, stealing from slots not yet started by a worker
+    ThreadPoolDoSlot (&job, 0, &busySecs, &tilesDone);
+    pthread_mutex_lock (&gPoolMutex);
+    ThreadPoolAddStats (0, busySecs, tilesDone);
+    // no tiles left, so don't hand out any more slots, and wait for slots still running on workers
+    ThreadPoolUnlistJob (&job);
+    // slots never taken by a worker can go to other jobs right away, the rest when the workers are done with them
+    ThreadPoolReleaseSlots (nSlots - job.nextSlot);
+    while (job.nSlotsDone < job.nextSlot - 1)
+        pthread_cond_wait (&job.doneCond, &gPoolMutex);
+    ThreadPoolReleaseSlots (job.nextSlot);
+    pthread_mutex_unlock (&gPoolMutex);
+    pthread_cond_destroy (&job.doneCond);
+    pthread_mutex_destroy (&job.tileMutex);
+    WMDisposePtr ((Ptr)job.slotsPtr);
+    gPoolDispatchSecs += std::chrono::duration<double>(std::chrono::steady_clock::now () - runStart).count () - busySecs;
+    return job.result;
+}
+
+/* Tile function for ThreadPoolRun. Each tile is one paramater structure of the array
+ Last Modified 2026/10/16 */
+static void ThreadPoolTaskTile (void* paramsPtr, CountInt startItem, CountInt endItem, UInt32 iSlot){
+    ThreadPoolTaskParamsPtr p = (ThreadPoolTaskParamsPtr)paramsPtr;
+    CountInt iTask;
+    for (iTask = startItem; iTask < endItem; iTask++){
+        p->threadFunc ((void*)(p->paramArrayPtr + (iTask * p->paramSize)));
+    }
+}
+
+/* Runs threadFunc once for each of the nTasks paramater structures of size paramSize in the array at paramArrayPtr,
+ and returns when all of them are finished. Returns 0, or the first error code thrown by a task.
+ Last Modified 2026/10/16 */
+int ThreadPoolRun (void* (*threadFunc)(void*), void* paramArrayPtr, size_t paramSize, UInt32 nTasks){
+    ThreadPoolTaskParams taskParams;
+    taskParams.threadFunc = threadFunc;
+    taskParams.paramArrayPtr = (char*)paramArrayPtr;
+    taskParams.paramSize = paramSize;
+    return ThreadPoolRunTiles (ThreadPoolTaskTile, &taskParams, nTasks, 1, nTasks);
+}
+
+/* Copies busy seconds and tiles done for each thread in the pool into the arrays at busySecsPtr and tilesDonePtr,
+ which must have room for ThreadPoolNumThreads () values. Index 0 is for the threads calling into the pool, the
+ rest are for the worker threads. Returns seconds elapsed since the statistics were last reset
+ Last Modified 2026/10/16 */
+double ThreadPoolGetStats (double* busySecsPtr, double* tilesDonePtr){
+    UInt32 iStat, nThreads = ThreadPoolNumThreads ();
+    double elapsedSecs;
+    pthread_mutex_lock (&gPoolMutex);
+    for (iStat = 0; iStat < nThreads; iStat++){
+        busySecsPtr [iStat] = (iStat < gPoolNumStats) ? gPoolBusySecsPtr [iStat] : 0;
+        tilesDonePtr [iStat] = (iStat < gPoolNumStats) ? gPoolTilesDonePtr [iStat] : 0;
+    }
+    elapsedSecs = std::chrono::duration<double>(std::chrono::steady_clock::now () - gPoolStatsStart).count ();
+    pthread_mutex_unlock (&gPoolMutex);
+    return elapsedSecs;
+}
+
+/* Returns the seconds the calling thread has spent in ThreadPoolRunTiles handing out jobs and waiting for workers,
+ rather than running tiles, since the last time it called this function, for the XFuncStats timers
+ Last Modified 2026/10/16 */
+double ThreadPoolTakeDispatchSecs (void){
+    double dispatchSecs = gPoolDispatchSecs;
+    gPoolDispatchSecs = 0;
+    return dispatchSecs;
+}
+
+/* Sets busy time and tiles done for all the threads back to 0, and restarts the elapsed time
+ Last Modified 2026/10/16 */
+void ThreadPoolResetStats (void){
+    UInt32 iStat;
+    pthread_mutex_lock (&gPoolMutex);
+    for (iStat = 0; iStat < gPoolNumStats; iStat++){
+        gPoolBusySecsPtr [iStat] = 0;
+        gPoolTilesDonePtr [iStat] = 0;
+    }
+    gPoolStatsStart = std::chrono::steady_clock::now ();
+    pthread_mutex_unlock (&gPoolMutex);
+}
+
+/* Turns the governor on or off. With it off, every job gets all the slots it asks for, as when the pool was first
+ written, which is only useful to measure what the governor gains
+ Last Modified 2026/10/16 */
+void ThreadPoolSetGovernor (UInt8 governorOn){
+    pthread_mutex_lock (&gPoolMutex);
+    gPoolGovernorOn = governorOn;
+    pthread_mutex_unlock (&gPoolMutex);
+}
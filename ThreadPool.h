@@ -0,0 +1,50 @@
+/*
+    ThreadPool.h -- a process-wide pool of worker threads shared by all the twoPhoton XFUNCs
+*/
+#ifndef THREADPOOL_H_
+#define THREADPOOL_H_
+
+#include <atomic>
+
+// number of tiles per thread that ThreadPoolTileSize aims for, so threads that finish early have tiles to steal
+#define THREADPOOL_TILES_PER_THREAD 8
+
+/* A tile function does the work for items startItem to endItem - 1 of a job. iSlot is less than the nSlots passed to
+ ThreadPoolRunTiles, and is not shared with any tile running at the same time, so it can index per-thread buffers */
+typedef void (*ThreadPoolTileFunc)(void* paramsPtr, CountInt startItem, CountInt endItem, UInt32 iSlot);
+
+/* The pool is started from XOPMain and stopped when Igor sends the CLEANUP message. Entry functions fill a single
+ paramater structure and hand it to ThreadPoolRunTiles with the number of items to do (pixels, layers, frames), which
+ cuts the items into tiles and runs the tile function on the pool's workers, with work stealing to balance the load,
+ returning when all the tiles are finished. ThreadPoolRun runs a thread function once for each structure in an array
+ of thread paramater structures, as for functions that still split their work by thread number.
+ The calling thread runs tiles as well, so a pool started with n threads makes n-1 worker threads. */
+int ThreadPoolStart (UInt32 nThreads);
+void ThreadPoolStop (void);
+UInt32 ThreadPoolNumThreads (void);
+CountInt ThreadPoolTileSize (CountInt nItems, CountInt minItemsPerTile);
+int ThreadPoolRunTiles (ThreadPoolTileFunc tileFunc, void* paramsPtr, CountInt nItems, CountInt itemsPerTile, UInt32 nSlots);
+/* Lets another thread follow a job run with ThreadPoolRunTilesControlled, and stop it. Once cancel is set no more tiles
+ are handed out, so the job ends when the tiles already running are done, and ThreadPoolRunTilesControlled returns
+ JOBCANCELLED. For kernels that do a frame per tile, that is within one frame */
+typedef struct ThreadPoolControl{
+    std::atomic<UInt8> cancel;          // set non-zero to stop the job
+    std::atomic<CountInt> itemsDone;    // items in tiles that have finished
+} ThreadPoolControl, *ThreadPoolControlPtr;
+int ThreadPoolRunTilesControlled (ThreadPoolTileFunc tileFunc, void* paramsPtr, CountInt nItems, CountInt itemsPerTile, UInt32 nSlots, ThreadPoolControlPtr controlPtr);
+/* The most slots a long running background job should ask for, one less than the pool's threads, so a call from another
+ thread always finds a slot free while the job runs */
+UInt32 ThreadPoolBackgroundSlots (void);
+int ThreadPoolRun (void* (*threadFunc)(void*), void* paramArrayPtr, size_t paramSize, UInt32 nTasks);
+
+/* The governor shares the pool's threads among jobs from different calling threads, see ThreadPool.cpp. It is on
+ unless turned off, as by kernelBench to compare */
+void ThreadPoolSetGovernor (UInt8 governorOn);
+
+/* Per-thread busy time and tiles done, as reported by the ThreadBusyTimes XFUNC */
+double ThreadPoolGetStats (double* busySecsPtr, double* tilesDonePtr);
+void ThreadPoolResetStats (void);
+/* Seconds the calling thread has spent in the pool not running tiles since it last asked, as for XFuncStats */
+double ThreadPoolTakeDispatchSecs (void);
+
+#endif
@@ -0,0 +1,110 @@
+#include "twoPhotonKernels.h"
+#include "XFuncStats.h"
+#include <chrono>
+
+/* ---------------------------------------------XFuncStats----------------------------------------------------------
+ Counters of calls and of cumulative and maximum time spent in each phase of each XFUNC, so we can see where time goes
+ inside the XOP. Each XFUNC keeps an XFuncTimer on its stack, and adds its times to the counters with a single lock of
+ gStatsMutex when it ends, so the cost is a few clock reads per call. Reported by the TwoPhotonStats XFUNC.
+ Last Modified 2026/10/16
+ ---------------------------------------------------------------------------------------------------------------*/
+
+// names of the XFUNCs and phases, used for dimension labels of the TwoPhotonStats wave
+const char* gXFuncStatsFuncNames [STATS_NUM_FUNCS] = {
+    "GetSetNumProcessors", "KalmanAllFrames", "KalmanSpecFrames", "KalmanWaveToFrame", "KalmanList", "KalmanNext",
+    "ProjectAllFrames", "ProjectSpecFrames", "ProjectXSlice", "ProjectYSlice", "ProjectZSlice", "SwapEven", "DownSample",
+    "Decumulate", "TransposeFrames", "ConvolveFrames", "SymConvolveFrames", "MedianFrames", "ThreadBusyTimes",
+    "TwoPhotonStats", "ConvolveFramesAsync", "SymConvolveFramesAsync", "MedianFramesAsync", "AsyncJobProgress",
+    "AsyncJobWait", "AsyncJobCancel", "FramePipeline",
+    "KalmanSlidingWindow", "KalmanGroupFrames", "KalmanStats", "KalmanInterleaved", "KalmanRobust", "TriggeredAverage",
+    "ProjectMulti", "ProjectDepth", "SetNumProcessorsCap", "KalmanAllFramesExact", "KalmanSpecFramesExact",
+    "KalmanNextWeighted", "ProjectPercentileAllFrames", "ProjectPercentileSpecFrames"
+};
+const char* gXFuncStatsPhaseNames [STATS_NUM_PHASES + 1] = {"validate", "makeWave", "threads", "compute", "finish", "total"};
+
+// Counters, all protected by gStatsMutex
+static pthread_mutex_t gStatsMutex = PTHREAD_MUTEX_INITIALIZER;
+static double gStatsCalls [STATS_NUM_FUNCS];
+static double gStatsSumSecs [STATS_NUM_FUNCS][STATS_NUM_PHASES + 1];
+static double gStatsMaxSecs [STATS_NUM_FUNCS][STATS_NUM_PHASES + 1];
+
+/* Returns seconds from a steady clock, for timing phases
+ Last Modified 2026/10/16 */
+static inline double XFuncStatsNow (void){
+    return std::chrono::duration<double>(std::chrono::steady_clock::now ().time_since_epoch ()).count ();
+}
+
+/* Starts timing an XFUNC call, in the STATS_VALIDATE phase
+ Last Modified 2026/10/16 */
+void XFuncTimerStart (XFuncTimerPtr timerPtr, UInt8 funcNum){
+    UInt8 iPhase;
+    timerPtr->funcNum = funcNum;
+    timerPtr->phase = STATS_VALIDATE;
+    for (iPhase = 0; iPhase < STATS_NUM_PHASES; iPhase++) timerPtr->phaseSecs [iPhase] = 0;
+    ThreadPoolTakeDispatchSecs (); // don't count pool overhead left over from an earlier call on this thread
+    timerPtr->phaseStart = XFuncStatsNow ();
+}
+
+/* Ends the phase being timed and starts timing a new phase. Thread pool overhead from the phase that ended is moved
+ to STATS_THREADS
+ Last Modified 2026/10/16 */
+void XFuncTimerPhase (XFuncTimerPtr timerPtr, UInt8 phase){
+    double now = XFuncStatsNow ();
+    double secs = now - timerPtr->phaseStart;
+    double dispatchSecs = ThreadPoolTakeDispatchSecs ();
+    if (dispatchSecs > secs) dispatchSecs = secs;
+    timerPtr->phaseSecs [timerPtr->phase] += secs - dispatchSecs;
+    timerPtr->phaseSecs [STATS_THREADS] += dispatchSecs;
+    timerPtr->phase = phase;
+    timerPtr->phaseStart = now;
+}
+
+/* Ends the phase being timed, and adds the call to the counters for its XFUNC
+ Last Modified 2026/10/16 */
+void XFuncTimerEnd (XFuncTimerPtr timerPtr){
+    UInt8 iPhase, funcNum = timerPtr->funcNum;
+    double totalSecs = 0;
+    XFuncTimerPhase (timerPtr, STATS_FINISH);
+    if (funcNum >= STATS_NUM_FUNCS) return;
+    pthread_mutex_lock (&gStatsMutex);
+    gStatsCalls [funcNum] += 1;
+    for (iPhase = 0; iPhase < STATS_NUM_PHASES; iPhase++){
+        totalSecs += timerPtr->phaseSecs [iPhase];
+        gStatsSumSecs [funcNum][iPhase] += timerPtr->phaseSecs [iPhase];
+        if (timerPtr->phaseSecs [iPhase] > gStatsMaxSecs [funcNum][iPhase]) gStatsMaxSecs [funcNum][iPhase] = timerPtr->phaseSecs [iPhase];
+    }
+    gStatsSumSecs [funcNum][STATS_NUM_PHASES] += totalSecs;
+    if (totalSecs > gStatsMaxSecs [funcNum][STATS_NUM_PHASES]) gStatsMaxSecs [funcNum][STATS_NUM_PHASES] = totalSecs;
+    pthread_mutex_unlock (&gStatsMutex);
+}
+
+/* Copies the counters into arrays of STATS_NUM_FUNCS calls, and STATS_NUM_FUNCS * (STATS_NUM_PHASES + 1) cumulative
+ and maximum seconds, with the values for each function together
+ Last Modified 2026/10/16 */
+void XFuncStatsGet (double* callsPtr, double* sumSecsPtr, double* maxSecsPtr){
+    UInt8 iFunc, iPhase;
+    pthread_mutex_lock (&gStatsMutex);
+    for (iFunc = 0; iFunc < STATS_NUM_FUNCS; iFunc++){
+        callsPtr [iFunc] = gStatsCalls [iFunc];
+        for (iPhase = 0; iPhase <= STATS_NUM_PHASES; iPhase++){
+            sumSecsPtr [iFunc * (STATS_NUM_PHASES + 1) + iPhase] = gStatsSumSecs [iFunc][iPhase];
+            maxSecsPtr [iFunc * (STATS_NUM_PHASES + 1) + iPhase] = gStatsMaxSecs [iFunc][iPhase];
+        }
+    }
+    pthread_mutex_unlock (&gStatsMutex);
+}
+
+/* Sets all the counters back to 0
+ Last Modified 2026/10/16 */
+void XFuncStatsReset (void){
+    UInt8 iFunc, iPhase;
+    pthread_mutex_lock (&gStatsMutex);
+    for (iFunc = 0; iFunc < STATS_NUM_FUNCS; iFunc++){
+        gStatsCalls [iFunc] = 0;
+        for (iPhase = 0; iPhase <= STATS_NUM_PHASES; iPhase++){
+            gStatsSumSecs [iFunc][iPhase] = 0;
+            gStatsMaxSecs [iFunc][iPhase] = 0;
+        }
+    }
+    pthread_mutex_unlock (&gStatsMutex);
+}
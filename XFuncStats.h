@@ -0,0 +1,81 @@
+/*
+    XFuncStats.h -- timing counters for the phases of each twoPhoton XFUNC, reported by the TwoPhotonStats XFUNC
+*/
+#ifndef XFUNCSTATS_H_
+#define XFUNCSTATS_H_
+
+/* Function numbers, the same as the numbers used for each XFUNC by RegisterFunction in twoPhoton.cpp */
+#define STATS_GETSETNUMPROCESSORS   0
+#define STATS_KALMANALLFRAMES       1
+#define STATS_KALMANSPECFRAMES      2
+#define STATS_KALMANWAVETOFRAME     3
+#define STATS_KALMANLIST            4
+#define STATS_KALMANNEXT            5
+#define STATS_PROJECTALLFRAMES      6
+#define STATS_PROJECTSPECFRAMES     7
+#define STATS_PROJECTXSLICE         8
+#define STATS_PROJECTYSLICE         9
+#define STATS_PROJECTZSLICE         10
+#define STATS_SWAPEVEN              11
+#define STATS_DOWNSAMPLE            12
+#define STATS_DECUMULATE            13
+#define STATS_TRANSPOSEFRAMES       14
+#define STATS_CONVOLVEFRAMES        15
+#define STATS_SYMCONVOLVEFRAMES     16
+#define STATS_MEDIANFRAMES          17
+#define STATS_THREADBUSYTIMES       18
+#define STATS_TWOPHOTONSTATS        19
+#define STATS_CONVOLVEFRAMESASYNC   20
+#define STATS_SYMCONVOLVEFRAMESASYNC 21
+#define STATS_MEDIANFRAMESASYNC     22
+#define STATS_ASYNCJOBPROGRESS      23
+#define STATS_ASYNCJOBWAIT          24
+#define STATS_ASYNCJOBCANCEL        25
+#define STATS_FRAMEPIPELINE         26
+#define STATS_KALMANSLIDINGWINDOW   27
+#define STATS_KALMANGROUPFRAMES     28
+#define STATS_KALMANSTATS           29
+#define STATS_KALMANINTERLEAVED     30
+#define STATS_KALMANROBUST          31
+#define STATS_TRIGGEREDAVERAGE      32
+#define STATS_PROJECTMULTI          33
+#define STATS_PROJECTDEPTH          34
+#define STATS_SETNUMPROCESSORSCAP   35
+#define STATS_KALMANALLFRAMESEXACT  36
+#define STATS_KALMANSPECFRAMESEXACT 37
+#define STATS_KALMANNEXTWEIGHTED    38
+#define STATS_PROJECTPERCENTILEALLFRAMES    39
+#define STATS_PROJECTPERCENTILESPECFRAMES   40
+#define STATS_NUM_FUNCS             41
+
+/* Phases of an XFUNC call. Time spent by the calling thread handing a job to the thread pool and waiting for the pool's
+ workers to finish is taken out of the phase it happened in and added to STATS_THREADS, along with time spent setting
+ up buffers and paramaters for the threads */
+#define STATS_VALIDATE      0   // checking paramaters and input waves
+#define STATS_MAKEWAVE      1   // making or overwriting the output wave with MDMakeWave
+#define STATS_THREADS       2   // setting up for the threads, and thread pool overhead
+#define STATS_COMPUTE       3   // running the kernels
+#define STATS_FINISH        4   // MDChangeWave redimensioning, freeing buffers, and marking waves modified
+#define STATS_NUM_PHASES    5
+
+/* Timer for one XFUNC call, kept on the stack of the XFUNC. Start it when the XFUNC is entered, mark the start of each
+ phase, and end it before each return to add the call to the counters */
+typedef struct XFuncTimer{
+    UInt8 funcNum;          // which XFUNC is being timed
+    UInt8 phase;            // the phase being timed
+    double phaseStart;      // time the current phase started, in seconds
+    double phaseSecs [STATS_NUM_PHASES];    // seconds spent in each phase so far
+} XFuncTimer, *XFuncTimerPtr;
+
+void XFuncTimerStart (XFuncTimerPtr timerPtr, UInt8 funcNum);
+void XFuncTimerPhase (XFuncTimerPtr timerPtr, UInt8 phase);
+void XFuncTimerEnd (XFuncTimerPtr timerPtr);
+
+/* Counters for all the XFUNCs. For each function, callsPtr gets the number of calls, and sumSecsPtr and maxSecsPtr get
+ the cumulative and maximum seconds for each phase and then for the whole call, STATS_NUM_PHASES + 1 values per function */
+void XFuncStatsGet (double* callsPtr, double* sumSecsPtr, double* maxSecsPtr);
+void XFuncStatsReset (void);
+extern const char* gXFuncStatsFuncNames [STATS_NUM_FUNCS];
+extern const char* gXFuncStatsPhaseNames [STATS_NUM_PHASES + 1];
+
+#endif
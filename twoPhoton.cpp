@@ -7,9 +7,6 @@ Last Modified:
 
 #include "twoPhoton.h"
 
-// Global Variable for number of processors for threading
-UInt8 gNumProcessors;
-
 /*
     Igor calls RegisterFunction at startup time to find the address of the
     XFUNCs added by this XOP. See XOP manual regarding "Direct XFUNCs".
@@ -72,6 +69,75 @@ static XOPIORecResult RegisterFunction() {
     case 17:
         return ((XOPIORecResult)MedianFrames);
         break;
+    case 18:
+        return ((XOPIORecResult)ThreadBusyTimes);
+        break;
+    case 19:
+        return ((XOPIORecResult)TwoPhotonStats);
+        break;
+    case 20:
+        return ((XOPIORecResult)ConvolveFramesAsync);
+        break;
+    case 21:
+        return ((XOPIORecResult)SymConvolveFramesAsync);
+        break;
+    case 22:
+        return ((XOPIORecResult)MedianFramesAsync);
+        break;
+    case 23:
+        return ((XOPIORecResult)AsyncJobProgress);
+        break;
+    case 24:
+        return ((XOPIORecResult)AsyncJobWait);
+        break;
+    case 25:
+        return ((XOPIORecResult)AsyncJobCancel);
+        break;
+    case 26:
+        return ((XOPIORecResult)FramePipeline);
+        break;
+    case 27:
+        return ((XOPIORecResult)KalmanSlidingWindow);
+        break;
+    case 28:
+        return ((XOPIORecResult)KalmanGroupFrames);
+        break;
+    case 29:
+        return ((XOPIORecResult)KalmanStats);
+        break;
+    case 30:
+        return ((XOPIORecResult)KalmanInterleaved);
+        break;
+    case 31:
+        return ((XOPIORecResult)KalmanRobust);
+        break;
+    case 32:
+        return ((XOPIORecResult)TriggeredAverage);
+        break;
+    case 33:
+        return ((XOPIORecResult)ProjectMulti);
+        break;
+    case 34:
+        return ((XOPIORecResult)ProjectDepth);
+        break;
+    case 35:
+        return ((XOPIORecResult)SetNumProcessorsCap);
+        break;
+    case 36:
+        return ((XOPIORecResult)KalmanAllFramesExact);
+        break;
+    case 37:
+        return ((XOPIORecResult)KalmanSpecFramesExact);
+        break;
+    case 38:
+        return ((XOPIORecResult)KalmanNextWeighted);
+        break;
+    case 39:
+        return ((XOPIORecResult)ProjectPercentileAllFrames);
+        break;
+    case 40:
+        return ((XOPIORecResult)ProjectPercentileSpecFrames);
+        break;
     }
     return 0;
 }
@@ -86,6 +152,10 @@ extern "C" void XOPEntry(void) {
     case FUNCADDRS:
         result = RegisterFunction();
         break;
+    case CLEANUP:   // XOP is about to be unloaded, so stop any async jobs, then the thread pool
+        AsyncJobCancelAll ();
+        ThreadPoolStop ();
+        break;
     }
     SetXOPResult(result);
 }
@@ -105,7 +175,8 @@ HOST_IMPORT int XOPMain(IORecHandle ioRecHandle) {		// The use of XOPMain rather
         SetXOPResult(OLD_IGOR);			// OLD_IGOR is defined in twoP.h corresponding error strings in twoP.r twoPWinCustom.rc.
         return EXIT_FAILURE;
     }
-    gNumProcessors = num_processors();
+    gNumProcessors = CPUTopologyNumThreads (CPU_CAP_NONE);   // usable CPUs, from affinity mask and any quota
+    ThreadPoolStart (gNumProcessors);  // start the thread pool shared by all the XFUNCs
     // char XOPbuffer [128];
     // sprintf(XOPbuffer, "TwoPhotonXOP found %d processor cores in this system.\r", gNumProcessors);
     // XOPNotice (XOPbuffer);
@@ -6,78 +6,20 @@
 
 #include "ParseWavePath.h"              // Utility to parse strings into data folder paths and wave names
 #include "XOPResources.h"                // Contains definition of XOP_TOOLKIT_VERSION
-#include "XOPStandardHeaders.h"            // Include ANSI headers, Mac headers, IgorXOP.h, XOP.h and XOPSupport.h
+#include "twoPhotonKernels.h"           // XOP Toolkit headers, threading, and the compute kernels called by the XFUNCs
+#include "XFuncStats.h"                 // timing counters for the phases of each XFUNC
+#include "AsyncJobs.h"                  // background jobs for the Async XFUNCs
 
 
 //#define NO_IGOR_ERR   // when defined, all functions return 0 to avoid modal dialogs
 #undef NO_IGOR_ERR      // when not defined, functions return error codes that invoke modal dialogs
 
-/* twoP custom error codes - also serve as return values from functions, after subtracting FIRST_XOP_ERR */
-#define OLD_IGOR                1 + FIRST_XOP_ERR
-#define NON_EXISTENT_WAVE       2 + FIRST_XOP_ERR
-#define INPUTNEEDS_3D_WAVE      3 + FIRST_XOP_ERR
-#define OUTPUTNEEDS_2D3D_WAVE   4 + FIRST_XOP_ERR
-#define NOTSAMEWAVETYPE         5 + FIRST_XOP_ERR
-#define NOTSAMEDIMSIZE          6 + FIRST_XOP_ERR
-#define INVALIDOUTPUTFRAME      7 + FIRST_XOP_ERR
-#define INVALIDINPUTFRAME       8 + FIRST_XOP_ERR
-#define OUTPUTNEEDS_2D_WAVE     9 + FIRST_XOP_ERR
-#define BADKERNEL               10 + FIRST_XOP_ERR
-#define INPUTNEEDS_2D3D_WAVE    11 + FIRST_XOP_ERR
-#define NO_INPUT_STRING         12 + FIRST_XOP_ERR
-#define BADFACTOR               13 + FIRST_XOP_ERR
-#define BADDSTYPE               14 + FIRST_XOP_ERR
-#define WAVEERROR_NOS           15 + FIRST_XOP_ERR
-#define OVERWRITEALERT          16 + FIRST_XOP_ERR
-#define NOTEXTWAVES             17 + FIRST_XOP_ERR
-#define BADDIMENSION            18 + FIRST_XOP_ERR
-#define NOT16OR32               19 + FIRST_XOP_ERR
-#define OUTPUTNEEDS_3D_WAVE     20 + FIRST_XOP_ERR
-#define BADWAVEINLIST           21 + FIRST_XOP_ERR
-#define BADSYMKERNEL            22 + FIRST_XOP_ERR
-#define NOTUNSIGNED             23 + FIRST_XOP_ERR
-#define MEMFAIL                 24 + FIRST_XOP_ERR
-#define NUMTYPE                 25 + FIRST_XOP_ERR
-#define INPUT_RANGE             26 + FIRST_XOP_ERR
-
 // mnemonic defines
 #define OVERWRITE 1
 #define NO_OVERWITE 0
 #define KILLOUTPUT 1
 #define NO_KILLOUTPUT 0
 
-//preprocessor macro to swap 2 values
-#define SWAP(a,b) temp=(a);(a)=(b);(b)=temp
-
-// Threading platform-dependent globals,includes, and macros
-extern UInt8 gNumProcessors;
-
-// include pThreads library on Windows
-#ifdef  _WINDOWS_
-// include pThreads library on Windows
-#include "pthread.h"
-#include "sched.h"
-#include "semaphore.h"
-static inline int num_processors() {
-    SYSTEM_INFO info;
-    GetSystemInfo(&info);
-    return info.dwNumberOfProcessors;
-}
-#endif
-
-// include native pThreads library on MacOS
-#ifdef __GNUC__
-#include <pthread.h>
-#include <sys/types.h>
-#include <sys/sysctl.h>
-static inline int num_processors() {
-    int np = 1;
-    size_t length = sizeof(np);
-    sysctlbyname("hw.ncpu", &np, &length, NULL, 0);
-    return np;
-}
-#endif
-
 // Structure definitions. All structures passed to Igor are two-byte aligned
 #pragma pack(2)
 
@@ -109,6 +51,69 @@ typedef struct KalmanWaveToFrameParams {
     double result;
 } KalmanWaveToFrameParams, * KalmanWaveToFrameParamsPtr;
 
+typedef struct KalmanSlidingWindowParams {
+    double overWrite;    //0 to give errors when wave already exists. non-zero to overwrite existing wave without warning.
+    double sameSize;    // 0 for one output layer for each whole window, non-zero for as many output layers as input layers
+    double nWindow;    // number of layers averaged into each output layer
+    Handle outPutPath;    // A handle to a string containing path to output wave we want to make
+    waveHndl inPutWaveH;    // handle to a 3D input wave
+    UserFunctionThreadInfoPtr tp; // Pointer to Igor private data.
+    double result;
+}KalmanSlidingWindowParams, *KalmanSlidingWindowParamsPtr;
+
+typedef struct KalmanGroupFramesParams {
+    double exact;    // non-zero to sum the layers of each group and divide once, rounding to nearest, instead of a running average
+    double overWrite;    //0 to give errors when wave already exists. non-zero to overwrite existing wave without warning.
+    double multiplier;    // Multiplier for,e.g., 16 bit waves containing less than 16 bits of data
+    double nFrames;    // number of layers averaged into each output layer
+    Handle outPutPath;    // A handle to a string containing path to output wave we want to make, or empty string to overwrite input wave
+    waveHndl inPutWaveH;    // handle to a 3D input wave
+    UserFunctionThreadInfoPtr tp; // Pointer to Igor private data.
+    double result;
+}KalmanGroupFramesParams, *KalmanGroupFramesParamsPtr;
+
+typedef struct KalmanStatsParams {
+    double overWrite;    //0 to give errors when wave already exists. non-zero to overwrite existing wave without warning.
+    double doMinMax;    // non-zero to add layers for the minimum and maximum of each point
+    Handle outPutPath;    // A handle to a string containing path to output wave we want to make
+    waveHndl inPutWaveH;    // handle to a 3D input wave
+    UserFunctionThreadInfoPtr tp; // Pointer to Igor private data.
+    double result;
+}KalmanStatsParams, *KalmanStatsParamsPtr;
+
+typedef struct KalmanInterleavedParams {
+    double exact;    // non-zero to sum the layers of each channel and divide once, rounding to nearest, instead of a running average
+    double overWrite;    //0 to give errors when wave already exists. non-zero to overwrite existing wave without warning.
+    double multiplier;    // Multiplier for,e.g., 16 bit waves containing less than 16 bits of data
+    double nFrames;    // number of layers of each channel averaged into each output layer, or 0 for all of them
+    double nChannels;    // number of channels interleaved layer by layer in the input wave
+    Handle outPutPath;    // A handle to a string containing path to output wave we want to make, or empty string to overwrite input wave
+    waveHndl inPutWaveH;    // handle to a 3D input wave
+    UserFunctionThreadInfoPtr tp; // Pointer to Igor private data.
+    double result;
+}KalmanInterleavedParams, *KalmanInterleavedParamsPtr;
+
+typedef struct KalmanRobustParams {
+    double overWrite;    //0 to give errors when wave already exists. non-zero to overwrite existing wave without warning.
+    double threshold;    // standard deviations for sigma clipping, or fraction of points at each end for Winsorizing or trimming
+    double mode;    // 0 for sigma clipped mean, 1 for Winsorized mean, 2 for trimmed mean
+    Handle outPutPath;    // A handle to a string containing path to output wave we want to make, or empty string to overwrite input wave
+    waveHndl inPutWaveH;    // handle to a 3D input wave
+    UserFunctionThreadInfoPtr tp; // Pointer to Igor private data.
+    double result;
+}KalmanRobustParams, *KalmanRobustParamsPtr;
+
+typedef struct TriggeredAverageParams {
+    double overWrite;    //0 to give errors when wave already exists. non-zero to overwrite existing wave without warning.
+    double nPost;    // number of layers after each trigger layer in each window
+    double nPre;    // number of layers before each trigger layer in each window
+    Handle outPutPath;    // A handle to a string containing path to output wave we want to make
+    waveHndl triggerWaveH;    // handle to a wave of the layers of the input wave at each trigger
+    waveHndl inPutWaveH;    // handle to a 3D input wave
+    UserFunctionThreadInfoPtr tp; // Pointer to Igor private data.
+    double result;
+}TriggeredAverageParams, *TriggeredAverageParamsPtr;
+
 typedef struct KalmanListParams {
     double overwrite;    //0 to give errors when wave already exists. non-zero to overwrite existing wave.
     double multiplier; // Multiplier for 16 bit waves containing less than 16 bits of data
@@ -126,9 +131,18 @@ typedef struct KalmanNextParams {
     double result;
 }KalmanNextParams, * KalmanNextParamsPtr;
 
+typedef struct KalmanNextWeightedParams {
+    double weight; // weight of each new wave for an exponential average, more than 0 and up to 1
+    double iKal; //which number of wave are we adding
+    waveHndl outPutWaveH;//handle to output wave
+    waveHndl inPutWaveH; // handle to iinput wave
+    UserFunctionThreadInfoPtr tp; // Pointer to Igor private data.
+    double result;
+}KalmanNextWeightedParams, * KalmanNextWeightedParamsPtr;
+
 // Project Image
 typedef struct ProjectAllFramesParams {
-    double projMode;        // variable for kind of projection, 0 is minimum intensity, 1 is maximum intensity
+    double projMode;        // variable for kind of projection, 0 is minimum intensity, 1 is maximum intensity, 2 avg, 3 median
     double overwrite;    //0 to give errors when wave already exists. non-zero to cheerfully overwrite existing wave.
     double flatDimension;    //Which dimension we want to collapse on, 0 for x, 1 for y, 2 for z
     Handle outPutPath;    // A handle to a string containing path to output wave we want to make
@@ -138,7 +152,7 @@ typedef struct ProjectAllFramesParams {
 } ProjectAllFramesParams, * ProjectAllFramesParamsPtr;
 
 typedef struct ProjectSpecFramesParams {
-    double projMode;             // 0 if minimum intensity projection, 1 for maximum intensity projection
+    double projMode;             // 0 if minimum intensity projection, 1 for maximum intensity projection, 2 avg, 3 median
     double flatDimension;    // the dimension that we are projecting along
     double outPutLayer;        //the layer in the output wave that receives the projection
     waveHndl outPutWaveH;    // A handle to output wave
@@ -149,6 +163,28 @@ typedef struct ProjectSpecFramesParams {
     double result;
 } ProjectSpecFramesParams, * ProjectSpecFramesParamsPtr;
 
+typedef struct ProjectPercentileAllFramesParams {
+    double percentile;      // 0 to 100, the percentile to select at each pixel
+    double overwrite;    //0 to give errors when wave already exists. non-zero to cheerfully overwrite existing wave.
+    double flatDimension;    //Which dimension we want to collapse on, 0 for x, 1 for y, 2 for z
+    Handle outPutPath;    // A handle to a string containing path to output wave we want to make
+    waveHndl inPutWaveH; //handle to the input wave
+    UserFunctionThreadInfoPtr tp; // Pointer to Igor private data.
+    double result;
+} ProjectPercentileAllFramesParams, * ProjectPercentileAllFramesParamsPtr;
+
+typedef struct ProjectPercentileSpecFramesParams {
+    double percentile;           // 0 to 100, the percentile to select at each pixel
+    double flatDimension;    // the dimension that we are projecting along
+    double outPutLayer;        //the layer in the output wave that receives the projection
+    waveHndl outPutWaveH;    // A handle to output wave
+    double inPutEndLayer;    //end of range of layers to project
+    double inPutStartLayer;    //start of range of layers to project
+    waveHndl inPutWaveH;    //handle to the input wave
+    UserFunctionThreadInfoPtr tp; // Pointer to Igor private data.
+    double result;
+} ProjectPercentileSpecFramesParams, * ProjectPercentileSpecFramesParamsPtr;
+
 typedef struct ProjectSliceParams {
     double slice;    // X, Y  or Z slice to get
     waveHndl outPutWaveH;    //handle to the output wave
@@ -157,11 +193,48 @@ typedef struct ProjectSliceParams {
     double result;
 }ProjectSliceParams, * ProjectSliceParamsPtr;
 
+typedef struct ProjectMultiParams {
+    double overWrite;    //0 to give errors when wave already exists. non-zero to overwrite existing wave without warning.
+    double statMask;    // statistics to make, added together: 1 min, 2 max, 4 mean, 8 std, 16 sum, 32 argmax, 64 median
+    double flatDimension;    //Which dimension we want to collapse on, 0 for x, 1 for y, 2 for z
+    Handle outPutPath;    // A handle to a string containing path to output wave we want to make
+    waveHndl inPutWaveH; //handle to the input wave
+    UserFunctionThreadInfoPtr tp; // Pointer to Igor private data.
+    double result;
+} ProjectMultiParams, * ProjectMultiParamsPtr;
+
+typedef struct ProjectDepthParams {
+    double overWrite;    //0 to give errors when waves already exist. non-zero to overwrite existing waves without warning.
+    double projMode;    // 0 for minimum and its layer, 1 for maximum and its layer, 2 for both
+    Handle indexPath;    // A handle to a string containing path to the wave of layers we want to make
+    Handle outPutPath;    // A handle to a string containing path to output wave we want to make
+    waveHndl inPutWaveH; //handle to the input wave
+    UserFunctionThreadInfoPtr tp; // Pointer to Igor private data.
+    double result;
+} ProjectDepthParams, * ProjectDepthParamsPtr;
+
 // LSM Utilities
 typedef struct GetSetNumProcessorsParams{
     double result;
 }GetSetNumProcessorsParams, *GetSetNumProcessorsParamsPtr;
 
+typedef struct SetNumProcessorsCapParams{
+    double cap;          // 0 for all usable CPUs, n > 0 for at most n threads, -1 for physical cores, -2 for performance cores
+    double result;
+}SetNumProcessorsCapParams, *SetNumProcessorsCapParamsPtr;
+
+typedef struct ThreadBusyTimesParams{
+    double reset;        // non-zero to set busy times back to 0 after reporting them
+    Handle outPutPath;   // path and name of output wave
+    double result;
+}ThreadBusyTimesParams, *ThreadBusyTimesParamsPtr;
+
+typedef struct TwoPhotonStatsParams{
+    double reset;        // non-zero to set counters back to 0 after reporting them
+    Handle outPutPath;   // path and name of output wave, or empty string to only reset the counters
+    double result;
+}TwoPhotonStatsParams, *TwoPhotonStatsParamsPtr;
+
 typedef struct SwapEvenParams {
     waveHndl w1;
     UserFunctionThreadInfoPtr tp; // Pointer to Igor private data.
@@ -183,6 +256,13 @@ typedef struct DecumulateParams {
     double result;
 } DecumulateParams, * DecumulateParamsPtr;
 
+typedef struct FramePipelineParams {
+    Handle stageList;   // list of stages with their paramaters, like "Decumulate:24;SwapEven;DownSample:1,4;KalmanWaveToFrame:16"
+    waveHndl w1;
+    UserFunctionThreadInfoPtr tp; // Pointer to Igor private data.
+    double result;
+} FramePipelineParams, * FramePipelineParamsPtr;
+
 typedef struct TransposeFramesParams {
     waveHndl w1;
     UserFunctionThreadInfoPtr tp; // Pointer to Igor private data.
@@ -209,6 +289,20 @@ typedef struct MedianFramesParams {
     double result;
 } MedianFramesParams, * MedianFramesParamsPtr;
 
+// Async jobs
+typedef struct AsyncJobParams {
+    double jobID;    // job ID returned by one of the Async XFUNCs
+    UserFunctionThreadInfoPtr tp; // Pointer to Igor private data.
+    double result;
+} AsyncJobParams, * AsyncJobParamsPtr;
+
+typedef struct AsyncJobWaitParams {
+    double timeOut;  // seconds to wait, 0 to only check, < 0 to wait till the job is done
+    double jobID;    // job ID returned by one of the Async XFUNCs
+    UserFunctionThreadInfoPtr tp; // Pointer to Igor private data.
+    double result;
+} AsyncJobWaitParams, * AsyncJobWaitParamsPtr;
+
 // Return to default structure packing
 #pragma pack()
 
@@ -216,25 +310,48 @@ typedef struct MedianFramesParams {
 HOST_IMPORT int XOPMain(IORecHandle ioRecHandle);
 //LSM Utilities
 extern "C" int GetSetNumProcessors(GetSetNumProcessorsParamsPtr p);
+extern "C" int SetNumProcessorsCap(SetNumProcessorsCapParamsPtr p);
+extern "C" int ThreadBusyTimes(ThreadBusyTimesParamsPtr p);
+extern "C" int TwoPhotonStats(TwoPhotonStatsParamsPtr p);
 extern "C" int SwapEven(SwapEvenParamsPtr);
 extern "C" int DownSample(DownSampleParamsPtr p);
 extern "C" int Decumulate(DecumulateParamsPtr p);
 extern "C" int TransposeFrames(TransposeFramesParamsPtr p);
+extern "C" int FramePipeline(FramePipelineParamsPtr p);
 // Kalman Averaging
 extern "C" int KalmanAllFrames(KalmanAllFramesParamsPtr);
 extern "C" int KalmanSpecFrames(KalmanSpecFramesParamsPtr);
+extern "C" int KalmanAllFramesExact(KalmanAllFramesParamsPtr);
+extern "C" int KalmanSpecFramesExact(KalmanSpecFramesParamsPtr);
 extern "C" int KalmanWaveToFrame(KalmanWaveToFrameParamsPtr);
 extern "C" int KalmanList(KalmanListParamsPtr p);
 extern "C" int KalmanNext(KalmanNextParamsPtr p);
+extern "C" int KalmanNextWeighted(KalmanNextWeightedParamsPtr p);
+extern "C" int KalmanSlidingWindow(KalmanSlidingWindowParamsPtr p);
+extern "C" int KalmanGroupFrames(KalmanGroupFramesParamsPtr p);
+extern "C" int KalmanStats(KalmanStatsParamsPtr p);
+extern "C" int KalmanInterleaved(KalmanInterleavedParamsPtr p);
+extern "C" int KalmanRobust(KalmanRobustParamsPtr p);
+extern "C" int TriggeredAverage(TriggeredAverageParamsPtr p);
 // Project Image
 extern "C" int  ProjectAllFrames(ProjectAllFramesParamsPtr p);
 extern "C" int  ProjectSpecFrames(ProjectSpecFramesParamsPtr p);
+extern "C" int  ProjectPercentileAllFrames(ProjectPercentileAllFramesParamsPtr p);
+extern "C" int  ProjectPercentileSpecFrames(ProjectPercentileSpecFramesParamsPtr p);
 extern "C" int  ProjectXSlice(ProjectSliceParamsPtr p);
 extern "C" int  ProjectYSlice(ProjectSliceParamsPtr p);
 extern "C" int  ProjectZSlice(ProjectSliceParamsPtr p);
+extern "C" int  ProjectMulti(ProjectMultiParamsPtr p);
+extern "C" int  ProjectDepth(ProjectDepthParamsPtr p);
 //Filter frames
 extern "C" int  ConvolveFrames(ConvolveFramesParamsPtr p);
 extern "C" int  SymConvolveFrames(ConvolveFramesParamsPtr p);
 extern "C" int  MedianFrames(MedianFramesParamsPtr p);
-template <typename T> T medianT(UInt32 n, T* dataStrtPtr);
+extern "C" int  ConvolveFramesAsync(ConvolveFramesParamsPtr p);
+extern "C" int  SymConvolveFramesAsync(ConvolveFramesParamsPtr p);
+extern "C" int  MedianFramesAsync(MedianFramesParamsPtr p);
+// Async jobs
+extern "C" int  AsyncJobProgress(AsyncJobParamsPtr p);
+extern "C" int  AsyncJobWait(AsyncJobWaitParamsPtr p);
+extern "C" int  AsyncJobCancel(AsyncJobParamsPtr p);
 #endif
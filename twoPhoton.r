@@ -79,6 +79,26 @@ resource 'STR#' (1100) {					/* custom error messages */
         "Can not do this function on wave of this type",
         /* [26] INPUT_RANGE */
         "Range of requested dimensions to process is invalid",
+        /* [27] JOBCANCELLED */
+        "The job was cancelled before it finished.",
+        /* [28] BADJOBID */
+        "There is no job with that job ID. It may have been collected already.",
+        /* [29] BADPIPELINE */
+        "The stage list is not valid. Use Decumulate, SwapEven, DownSample and KalmanWaveToFrame at most once each, with Decumulate first and KalmanWaveToFrame last.",
+        /* [30] BADLAYERCOUNT */
+        "The number of layers to average must be a whole number from 1 to the number of layers in the input wave.",
+        /* [31] BADWEIGHT */
+        "The weight for exponential averaging must be more than 0, and not more than 1.",
+        /* [32] BADCHANNELCOUNT */
+        "The number of interleaved channels must be from 1 to the number of layers in the input wave.",
+        /* [33] BADROBUSTMODE */
+        "The robust averaging mode must be 0, 1 or 2, with more than 0 standard deviations for mode 0, or a fraction from 0 to less than 0.5 for modes 1 and 2.",
+        /* [34] NOTRIGGERS */
+        "The trigger wave is empty, or no trigger has its whole window of layers inside the input wave.",
+        /* [35] BADSTATMASK */
+        "The statistics to project must add up to a whole number from 1 to 127.",
+        /* [36] BADPERCENTILE */
+        "The percentile must be from 0 to 100.",
 	}
 };
 
@@ -261,5 +281,237 @@ resource 'XOPF' (1100) {
             NT_FP64,  // flag to overwrite existing waves.
         },
 
+        "ThreadBusyTimes",
+        F_UTIL | F_EXTERNAL,                        /* function category*/
+        NT_FP64,                                    /* return value type */
+        {
+            HSTRING_TYPE,   // path and name of output wave
+            NT_FP64,        // non-zero to reset busy times
+        },
+
+        "TwoPhotonStats",
+        F_UTIL | F_EXTERNAL,                        /* function category*/
+        NT_FP64,                                    /* return value type */
+        {
+            HSTRING_TYPE,   // path and name of output wave, or "" to only reset
+            NT_FP64,        // non-zero to reset counters
+        },
+
+        "ConvolveFramesAsync",
+        F_ANLYZWAVES | F_THREADSAFE | F_EXTERNAL,                /* function category */
+        NT_FP64,                                    /* returns job ID */
+        {
+            WAVE_TYPE,    //input wave
+            HSTRING_TYPE,    //     string with path to output wave
+            NT_FP64,     //   0 for output wave same type as input, 1 to make it float
+            WAVE_TYPE,    //kernel wave
+            NT_FP64,  // flag to overwrite existing waves.
+        },
+
+        "SymConvolveFramesAsync",
+        F_ANLYZWAVES | F_THREADSAFE | F_EXTERNAL,                /* function category */
+        NT_FP64,                                    /* returns job ID */
+        {
+            WAVE_TYPE,    //input wave
+            HSTRING_TYPE,    //     string with path to output wave
+            NT_FP64,     //   0 for output wave same type as input, 1 to make it float
+            WAVE_TYPE,    //kernel wave
+            NT_FP64,  // flag to overwrite existing waves.
+        },
+
+        "MedianFramesAsync",
+        F_ANLYZWAVES | F_THREADSAFE | F_EXTERNAL,                /* function category */
+        NT_FP64,                                    /* returns job ID */
+        {
+            WAVE_TYPE,        //input wave
+            HSTRING_TYPE,    //     string with path to output wave
+            NT_FP64,    // Width over which to apply median
+            NT_FP64,  // flag to overwrite existing waves.
+        },
+
+        "AsyncJobProgress",
+        F_UTIL | F_THREADSAFE | F_EXTERNAL,         /* function category*/
+        NT_FP64,                                    /* returns fraction of frames done */
+        {
+            NT_FP64,        // job ID
+        },
+
+        "AsyncJobWait",
+        F_UTIL | F_THREADSAFE | F_EXTERNAL,         /* function category*/
+        NT_FP64,                                    /* returns 1 if the job finished, 0 if timed out */
+        {
+            NT_FP64,        // job ID
+            NT_FP64,        // seconds to wait, 0 to only check, < 0 to wait till done
+        },
+
+        "AsyncJobCancel",
+        F_UTIL | F_THREADSAFE | F_EXTERNAL,         /* function category*/
+        NT_FP64,                                    /* returns fraction of frames done */
+        {
+            NT_FP64,        // job ID
+        },
+
+        "FramePipeline",
+        F_ANLYZWAVES | F_THREADSAFE | F_EXTERNAL,                /* function category */
+        NT_FP64,
+        {
+            WAVE_TYPE,        //InPutWave
+            HSTRING_TYPE,     // list of stages, like "Decumulate:24;SwapEven;DownSample:1,4;KalmanWaveToFrame:16"
+        },
+
+        "KalmanSlidingWindow",
+        F_ANLYZWAVES | F_THREADSAFE | F_EXTERNAL,   /* function category */
+        NT_FP64,                                    /* return value type */
+        {                                           /* parameter types */
+            WAVE_TYPE,                              // input wave
+            HSTRING_TYPE,                           // output wave and path, to be created
+            NT_FP64,                                // number of layers in each window
+            NT_FP64,                                // same size: as many output layers as input layers
+            NT_FP64,                                // overwriting output wave is ok
+        },
+
+        "KalmanGroupFrames",
+        F_ANLYZWAVES | F_THREADSAFE | F_EXTERNAL,   /* function category */
+        NT_FP64,                                    /* return value type */
+        {                                           /* parameter types */
+            WAVE_TYPE,                              // input wave
+            HSTRING_TYPE,                           // output wave and path, to be created, or "" to overwrite input wave
+            NT_FP64,                                // number of layers in each group
+            NT_FP64,                                // multiplier
+            NT_FP64,                                // overwriting output wave is ok
+            NT_FP64,                                // exact: sum the layers and divide once
+        },
+
+        "KalmanStats",
+        F_ANLYZWAVES | F_THREADSAFE | F_EXTERNAL,   /* function category */
+        NT_FP64,                                    /* return value type */
+        {                                           /* parameter types */
+            WAVE_TYPE,                              // input wave
+            HSTRING_TYPE,                           // output wave and path, to be created
+            NT_FP64,                                // add layers for minimum and maximum
+            NT_FP64,                                // overwriting output wave is ok
+        },
+
+        "KalmanInterleaved",
+        F_ANLYZWAVES | F_THREADSAFE | F_EXTERNAL,   /* function category */
+        NT_FP64,                                    /* return value type */
+        {                                           /* parameter types */
+            WAVE_TYPE,                              // input wave
+            HSTRING_TYPE,                           // output wave and path, to be created, or "" to overwrite input wave
+            NT_FP64,                                // number of interleaved channels
+            NT_FP64,                                // number of layers of each channel in each group, or 0 for all
+            NT_FP64,                                // multiplier
+            NT_FP64,                                // overwriting output wave is ok
+            NT_FP64,                                // exact: sum the layers and divide once
+        },
+
+        "KalmanRobust",
+        F_ANLYZWAVES | F_THREADSAFE | F_EXTERNAL,   /* function category */
+        NT_FP64,                                    /* return value type */
+        {                                           /* parameter types */
+            WAVE_TYPE,                              // input wave
+            HSTRING_TYPE,                           // output wave and path, to be created, or "" to overwrite input wave
+            NT_FP64,                                // mode: 0 sigma clipped, 1 Winsorized, 2 trimmed
+            NT_FP64,                                // standard deviations, or fraction to cut at each end
+            NT_FP64,                                // overwriting output wave is ok
+        },
+
+        "TriggeredAverage",
+        F_ANLYZWAVES | F_THREADSAFE | F_EXTERNAL,   /* function category */
+        NT_FP64,                                    /* return value type */
+        {                                           /* parameter types */
+            WAVE_TYPE,                              // input wave
+            WAVE_TYPE,                              // wave of trigger layers
+            HSTRING_TYPE,                           // output wave and path, to be created
+            NT_FP64,                                // layers before each trigger
+            NT_FP64,                                // layers after each trigger
+            NT_FP64,                                // overwriting output wave is ok
+        },
+
+        "ProjectMulti",
+        F_ANLYZWAVES | F_THREADSAFE | F_EXTERNAL,   /* function category */
+        NT_FP64,                                    /* return value type */
+        {                                           /* parameter types */
+            WAVE_TYPE,                              // input wave
+            HSTRING_TYPE,                           // output wave and path, to be created
+            NT_FP64,                                // dimension to flatten, 0 for X, 1 for Y, 2 for Z
+            NT_FP64,                                // statistics to make, added together
+            NT_FP64,                                // overwriting output wave is ok
+        },
+
+        "ProjectDepth",
+        F_ANLYZWAVES | F_THREADSAFE | F_EXTERNAL,   /* function category */
+        NT_FP64,                                    /* return value type */
+        {                                           /* parameter types */
+            WAVE_TYPE,                              // input wave
+            HSTRING_TYPE,                           // output wave and path for the projection, to be created
+            HSTRING_TYPE,                           // output wave and path for the layers, to be created
+            NT_FP64,                                // minimum (0), maximum (1), or both (2)
+            NT_FP64,                                // overwriting output waves is ok
+        },
+
+        "SetNumProcessorsCap",
+        F_UTIL | F_EXTERNAL,                        /* function category*/
+        NT_FP64,                                    /* return value type */
+        {                                           /* parameter types */
+            NT_FP64,                                // cap: 0 for all usable CPUs, n > 0 for at most n, -1 physical cores, -2 performance cores
+        },
+
+        "KalmanAllFramesExact",
+        F_ANLYZWAVES | F_THREADSAFE | F_EXTERNAL,   /* function category */
+        NT_FP64,                                    /* return value type */
+        {                                           /* parameter types */
+            WAVE_TYPE,                              // input wave
+            HSTRING_TYPE,                           // output wave and path, to be created
+            NT_FP64,                                // multiplier, not used
+            NT_FP64,                                // overwriting output wave is ok
+        },
+
+        "KalmanSpecFramesExact",
+        F_ANLYZWAVES | F_THREADSAFE | F_EXTERNAL,   /* function category */
+        NT_FP64,                                    /* return value type */
+        {                                           /* parameter types */
+            WAVE_TYPE,                              // input wave
+            NT_FP64,                                // Start of layers to average
+            NT_FP64,                                // End of layers to average
+            WAVE_TYPE,                              // output wave
+            NT_FP64,                                // layer of output wave to modify
+            NT_FP64,                                // multiplier, not used
+        },
+
+        "KalmanNextWeighted",
+        F_ANLYZWAVES | F_THREADSAFE | F_EXTERNAL,   /* function category */
+        NT_FP64,                                    /* return value type */
+        {                                           /* parameter types */
+            WAVE_TYPE,                              // Input Wave
+            WAVE_TYPE,                              // output wave
+            NT_FP64,                                // how many waves have previously been added
+            NT_FP64,                                // weight of each new wave for exponential average
+        },
+
+        "ProjectPercentileAllFrames",
+        F_ANLYZWAVES | F_THREADSAFE | F_EXTERNAL,   /* function category */
+        NT_FP64,                                    /* return value type */
+        {                                           /* parameter types */
+            WAVE_TYPE,                              // Input wave
+            HSTRING_TYPE,                           // string with path to output wave
+            NT_FP64,                                // Which dimension we want to collapse on, 0 for x, 1 for y, 2 for z
+            NT_FP64,                                // overwriting output wave is ok
+            NT_FP64,                                // percentile, 0 to 100
+        },
+
+        "ProjectPercentileSpecFrames",
+        F_ANLYZWAVES | F_THREADSAFE | F_EXTERNAL,   /* function category */
+        NT_FP64,                                    /* return value type */
+        {                                           /* parameter types */
+            WAVE_TYPE,                              // Input wave
+            NT_FP64,                                // start layer
+            NT_FP64,                                // end layer
+            WAVE_TYPE,                              // output wave
+            NT_FP64,                                // output layer
+            NT_FP64,                                // Which dimension we want to collapse on, 0 for x, 1 for y, 2 for z
+            NT_FP64,                                // percentile, 0 to 100
+        },
+
     }
 };
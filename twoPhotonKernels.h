@@ -0,0 +1,506 @@
+/*
+    twoPhotonKernels.h -- the compute kernels of the twoPhoton XOP, with no calls into Igor, so they can be
+    built into a static library and tested and profiled on their own. The XFUNCs check their waves, fill a
+    paramater structure from this file, and hand it to the thread pool with one of the tile functions
+*/
+#ifndef TWOPHOTONKERNELS_H_
+#define TWOPHOTONKERNELS_H_
+
+// Built into the XOP, use the real XOP Toolkit headers. Built without Igor, use the shim
+#ifdef TWOPHOTON_HEADLESS
+#include "Linux/IgorShim.h"
+#else
+#include "XOPStandardHeaders.h"            // Include ANSI headers, Mac headers, IgorXOP.h, XOP.h and XOPSupport.h
+#endif
+
+/* twoP custom error codes - also serve as return values from functions, after subtracting FIRST_XOP_ERR */
+#define OLD_IGOR                1 + FIRST_XOP_ERR
+#define NON_EXISTENT_WAVE       2 + FIRST_XOP_ERR
+#define INPUTNEEDS_3D_WAVE      3 + FIRST_XOP_ERR
+#define OUTPUTNEEDS_2D3D_WAVE   4 + FIRST_XOP_ERR
+#define NOTSAMEWAVETYPE         5 + FIRST_XOP_ERR
+#define NOTSAMEDIMSIZE          6 + FIRST_XOP_ERR
+#define INVALIDOUTPUTFRAME      7 + FIRST_XOP_ERR
+#define INVALIDINPUTFRAME       8 + FIRST_XOP_ERR
+#define OUTPUTNEEDS_2D_WAVE     9 + FIRST_XOP_ERR
+#define BADKERNEL               10 + FIRST_XOP_ERR
+#define INPUTNEEDS_2D3D_WAVE    11 + FIRST_XOP_ERR
+#define NO_INPUT_STRING         12 + FIRST_XOP_ERR
+#define BADFACTOR               13 + FIRST_XOP_ERR
+#define BADDSTYPE               14 + FIRST_XOP_ERR
+#define WAVEERROR_NOS           15 + FIRST_XOP_ERR
+#define OVERWRITEALERT          16 + FIRST_XOP_ERR
+#define NOTEXTWAVES             17 + FIRST_XOP_ERR
+#define BADDIMENSION            18 + FIRST_XOP_ERR
+#define NOT16OR32               19 + FIRST_XOP_ERR
+#define OUTPUTNEEDS_3D_WAVE     20 + FIRST_XOP_ERR
+#define BADWAVEINLIST           21 + FIRST_XOP_ERR
+#define BADSYMKERNEL            22 + FIRST_XOP_ERR
+#define NOTUNSIGNED             23 + FIRST_XOP_ERR
+#define MEMFAIL                 24 + FIRST_XOP_ERR
+#define NUMTYPE                 25 + FIRST_XOP_ERR
+#define INPUT_RANGE             26 + FIRST_XOP_ERR
+#define JOBCANCELLED            27 + FIRST_XOP_ERR
+#define BADJOBID                28 + FIRST_XOP_ERR
+#define BADPIPELINE             29 + FIRST_XOP_ERR
+#define BADLAYERCOUNT           30 + FIRST_XOP_ERR
+#define BADWEIGHT               31 + FIRST_XOP_ERR
+#define BADCHANNELCOUNT         32 + FIRST_XOP_ERR
+#define BADROBUSTMODE           33 + FIRST_XOP_ERR
+#define NOTRIGGERS              34 + FIRST_XOP_ERR
+#define BADSTATMASK             35 + FIRST_XOP_ERR
+#define BADPERCENTILE           36 + FIRST_XOP_ERR
+
+//preprocessor macro to swap 2 values
+#define SWAP(a,b) temp=(a);(a)=(b);(b)=temp
+
+// Threading platform-dependent globals,includes, and macros
+// number of threads the XFUNCs fan out to, set from CPUTopologyNumThreads with the cap given to SetNumProcessorsCap
+extern UInt32 gNumProcessors;
+
+// include pThreads library on Windows
+#ifdef  _WINDOWS_
+// include pThreads library on Windows
+#include "pthread.h"
+#include "sched.h"
+#include "semaphore.h"
+#endif
+
+// include native pThreads library on MacOS and Linux
+#ifdef __GNUC__
+#include <pthread.h>
+#include <sys/types.h>
+#ifdef __linux__
+#include <unistd.h>
+#else
+#include <sys/sysctl.h>
+#endif
+#endif
+
+// process-wide thread pool used by all the XFUNCs in place of creating and joining pthreads for each call
+#include "ThreadPool.h"
+// how many CPUs we may really use, from affinity masks, cgroup quotas, and physical and hybrid core layout
+#include "CPUTopology.h"
+
+// fewest pixels in a tile of work for the thread pool, so tiles are big enough to be worth handing out
+#define KALMAN_MIN_TILE 4096
+// most layers the SIMD running averages in KalmanT will do, so that layer number * point + point is exact in a double
+// for 32 bit points, and the SIMD results are the same as the scalar ones. Stacks with more layers use the scalar loops
+#define KALMAN_SIMD_MAX_LAYERS 1048576
+// points in each block of exact averaging in KalmanTile, so the sums for a block stay in L1 cache while every layer is added
+#define KALMAN_EXACT_BLOCK 2048
+// most layers of 8 or 16 bit points whose sums fit in 32 bit accumulators for exact averaging. Deeper stacks use 64 bits
+#define KALMAN_EXACT_I32_LAYERS 32768
+// points in each block of KalmanSlidingWindow, so the sums for a block stay in L1 cache while the window slides through the layers
+#define KALMAN_SLIDING_BLOCK 2048
+// points in each block of KalmanNext, so the average for a block stays in L1 cache while every new wave is added
+#define KALMAN_NEXT_BLOCK 2048
+// points in each block of KalmanStats, so the sums for a block stay in L1 and L2 cache while every layer is added
+#define KALMAN_STATS_BLOCK 1024
+// layers in each chunk of KalmanStats. The sums of a chunk are merged into the mean and variance with Chan's formula
+#define KALMAN_STATS_CHUNK 256
+// number of doubles for each point of a block in the buffers of KalmanStats: shift, sum, sum of squares, mean, M2, min, max
+#define KALMAN_STATS_SUMS 7
+// modes of robust averaging with KalmanRobustTile
+#define KALMAN_ROBUST_SIGMA 0       // mean of the points within threshold standard deviations of the mean, repeated till no more points are clipped
+#define KALMAN_ROBUST_WINSOR 1      // mean with the threshold fraction of points at each end replaced by the nearest point that is kept
+#define KALMAN_ROBUST_TRIM 2        // mean with the threshold fraction of points at each end left out
+// most times the mean and standard deviation are found again with the points clipped by sigma clipping
+#define KALMAN_ROBUST_MAX_ITER 10
+// most points cut from each end by Winsorizing or trimming that are found by keeping short sorted lists, not with selectT
+#define KALMAN_ROBUST_MAX_LIST 32
+// fewest and most points in each block of KalmanRobust, whose columns of layers are copied together into a buffer
+#define KALMAN_ROBUST_MIN_BLOCK 16
+#define KALMAN_ROBUST_MAX_BLOCK 1024
+// points in each block of KalmanList, so the sums for a block stay in L1 cache while every wave in the list is added
+#define KALMAN_LIST_BLOCK 2048
+// fewest input points to read in a tile of work for the thread pool, so tiles are big enough to be worth handing out
+#define PROJECT_MIN_TILE 16384
+// XY locations in each block of a Z projection, which is read a layer at a time, so the block stays in L1 cache
+#define PROJECT_Z_BLOCK 2048
+// points in each block of a median projection of an integer wave, each with a histogram of 256 bins, and the fewest
+// points in a projection for which the histograms are used instead of copying each column to a buffer for medianT
+#define PROJECT_HIST_BLOCK 32
+#define PROJECT_HIST_MIN_POINTS 16
+// points in each block of ProjectMulti without a median, whose statistics are kept on the stack while the block is read
+#define PROJECT_MULTI_BLOCK 256
+// statistics for ProjectMulti, added together for the statMask. Output layers are in this order, for the statistics chosen
+#define PROJECT_STAT_MIN 1
+#define PROJECT_STAT_MAX 2
+#define PROJECT_STAT_MEAN 4
+#define PROJECT_STAT_STD 8
+#define PROJECT_STAT_SUM 16
+#define PROJECT_STAT_ARGMAX 32
+#define PROJECT_STAT_MEDIAN 64
+#define PROJECT_STAT_NUM 7
+// fewest points in a tile of work for SwapEven and DownSample
+#define LSM_MIN_TILE 16384
+// most bytes of each frame in a tile of work for FramePipeline, so a tile stays in cache through all its stages
+#define PIPELINE_TILE_BYTES 131072
+
+/* ---------------------------------------------Kalman----------------------------------------------------------*/
+
+/* Structure to pass data to each KalmanTile. Group n of zSize layers, starting at startLayer + n * zSize, is averaged
+ into layer outPutLayer + n of the output
+ Last Modified 2026/10/16 */
+typedef struct KalmanThreadParams{
+    int inPutWaveType;
+    char* inPutDataStartPtr;
+    char* outPutDataStartPtr;
+    CountInt startLayer;
+    CountInt outPutLayer;
+    CountInt xSize;
+    CountInt ySize;
+    CountInt zSize;
+    CountInt nGroups;       // groups of zSize layers, one after another, each averaged into the next layer of the output
+    CountInt nChannels;     // channels interleaved layer by layer, each group having zSize layers of each channel, averaged into nChannels layers of the output
+    float multiplier;
+    UInt8 exact;            // non-zero to sum the layers and divide once, rounding to nearest, instead of a running average
+    SInt64* accBufferPtr;   // KALMAN_EXACT_BLOCK sums for each slot when exact, set by KalmanRunTiles
+} KalmanThreadParams, *KalmanThreadParamsPtr;
+
+/* Structure to pass data to each KalmanListTile
+Last Modified 2026/10/16 */
+typedef struct KalmanListThreadParams{
+    int inPutWaveType;
+    Ptr* inPutDataStartsPtr;
+    char* outPutDataStartPtr;
+    UInt16 nWaves;
+    CountInt nPnts;
+    float multiplier;
+    double* sumBufferPtr;   // KALMAN_LIST_BLOCK sums for each slot, set by KalmanListRunTiles
+} KalmanListThreadParams, *KalmanListThreadParamsPtr;
+
+/* Structure to pass data to each KalmanNextTile. The input is nFrames waves of nPnts points, one after another, each
+ added in turn to the average in the output wave
+ Last Modified 2026/10/16 */
+typedef struct KalmanNextThreadParams{
+    int inPutWaveType;
+    char* inPutDataStartPtr;
+    char* outPutDataStartPtr;
+    CountInt nPnts;
+    CountInt iKal;          // number of waves already averaged into the output wave before the first input wave
+    CountInt nFrames;       // number of input waves to add
+    double weight;          // 0 for a running average, else the weight of each new wave for an exponential average
+} KalmanNextThreadParams, *KalmanNextThreadParamsPtr;
+
+/* Structure to pass data to each KalmanSlidingTile. Output layer n is the average of input layers n - offset to
+ n - offset + nWindow - 1, less any of those layers that are outside the input wave
+ Last Modified 2026/10/16 */
+typedef struct KalmanSlidingThreadParams{
+    int inPutWaveType;
+    char* inPutDataStartPtr;
+    char* outPutDataStartPtr;
+    CountInt xSize;
+    CountInt ySize;
+    CountInt zSize;         // layers in the input wave
+    CountInt outZSize;      // layers in the output wave
+    CountInt nWindow;       // layers averaged into each output layer
+    CountInt offset;        // layers each window starts before its output layer, 0 when every window is whole
+    SInt64* accBufferPtr;   // KALMAN_SLIDING_BLOCK sums for each slot, set by KalmanSlidingRunTiles
+} KalmanSlidingThreadParams, *KalmanSlidingThreadParamsPtr;
+
+/* Structure to pass data to each KalmanStatsTile. The output has layers for mean, variance and standard deviation, and
+ for minimum and maximum if doMinMax, of the type given by KalmanStatsOutPutType
+ Last Modified 2026/10/16 */
+typedef struct KalmanStatsThreadParams{
+    int inPutWaveType;
+    char* inPutDataStartPtr;
+    char* outPutDataStartPtr;
+    CountInt xSize;
+    CountInt ySize;
+    CountInt zSize;
+    UInt8 doMinMax;         // non-zero to add layers for the minimum and maximum of each point
+    double* bufferPtr;      // KALMAN_STATS_BLOCK * KALMAN_STATS_SUMS doubles for each slot, set by KalmanStatsRunTiles
+} KalmanStatsThreadParams, *KalmanStatsThreadParamsPtr;
+
+/* Structure to pass data to each KalmanRobustTile. The output is a single frame of the same type as the input
+ Last Modified 2026/10/16 */
+typedef struct KalmanRobustThreadParams{
+    int inPutWaveType;
+    char* inPutDataStartPtr;
+    char* outPutDataStartPtr;
+    CountInt xSize;
+    CountInt ySize;
+    CountInt zSize;
+    UInt8 mode;             // KALMAN_ROBUST_SIGMA, KALMAN_ROBUST_WINSOR, or KALMAN_ROBUST_TRIM
+    double threshold;       // standard deviations for sigma clipping, or fraction from 0 to less than 0.5 to replace or leave out at each end
+    CountInt blockPix;      // points in each block, set by KalmanRobustRunTiles
+    double* bufferPtr;      // blockPix * zSize doubles for each slot, set by KalmanRobustRunTiles
+} KalmanRobustThreadParams, *KalmanRobustThreadParamsPtr;
+
+/* Structure to pass data to each TriggeredAverageTile. Output layer n is the exact average over the triggers of input
+ layer startLayers [iTrigger] + n, for each of nWindow layers
+ Last Modified 2026/10/16 */
+typedef struct TriggeredAverageThreadParams{
+    int inPutWaveType;
+    char* inPutDataStartPtr;
+    char* outPutDataStartPtr;
+    CountInt xSize;
+    CountInt ySize;
+    CountInt zSize;
+    CountInt* startLayersPtr;   // first input layer of the window for each trigger, each window inside the input wave
+    CountInt nTriggers;
+    CountInt nWindow;           // layers in each window, and in the output wave
+    SInt64* accBufferPtr;       // KALMAN_EXACT_BLOCK sums for each slot, set by TriggeredAverageRunTiles
+} TriggeredAverageThreadParams, *TriggeredAverageThreadParamsPtr;
+
+/* Bytes of each tile of KalmanTile that are taken through all the layers at a time, so the running average for the
+ block stays in L2 cache while every layer is added to it, instead of being read back from memory for each layer. Set
+ from CPUTopologyL2Bytes when the XOP is loaded. 0 takes whole tiles through the layers, as kernelBench does to compare */
+extern CountInt gKalmanBlockBytes;
+void KalmanTile (void* paramsPtr, CountInt startPos, CountInt endPos, UInt32 iSlot);
+int KalmanRunTiles (KalmanThreadParamsPtr paramsPtr);
+void KalmanListTile (void* paramsPtr, CountInt startPos, CountInt endPos, UInt32 iSlot);
+int KalmanListRunTiles (KalmanListThreadParamsPtr paramsPtr, UInt32 nSlots);
+void KalmanNextTile (void* paramsPtr, CountInt startPos, CountInt endPos, UInt32 iSlot);
+void KalmanSlidingTile (void* paramsPtr, CountInt startPos, CountInt endPos, UInt32 iSlot);
+int KalmanSlidingRunTiles (KalmanSlidingThreadParamsPtr paramsPtr);
+int KalmanStatsOutPutType (int inPutWaveType);
+void KalmanStatsTile (void* paramsPtr, CountInt startPos, CountInt endPos, UInt32 iSlot);
+int KalmanStatsRunTiles (KalmanStatsThreadParamsPtr paramsPtr);
+void KalmanRobustTile (void* paramsPtr, CountInt startPos, CountInt endPos, UInt32 iSlot);
+int KalmanRobustRunTiles (KalmanRobustThreadParamsPtr paramsPtr);
+void TriggeredAverageTile (void* paramsPtr, CountInt startPos, CountInt endPos, UInt32 iSlot);
+int TriggeredAverageRunTiles (TriggeredAverageThreadParamsPtr paramsPtr);
+/* SIMD versions of the running average loops of KalmanT, for layers 1 to numLayers - 1, in KalmanKernelsSSE41.cpp and
+ KalmanKernelsAVX2.cpp. They give the same output as the scalar loops, bit for bit. Return 0 when done, or non-zero if
+ built without that instruction set, so the scalar loops must be used */
+template <typename T> int KalmanLayersSSE41 (T* srcWave, T* destWaveStart, CountInt pixPerThread, CountInt pixToNextFrame, CountInt numLayers, float multiplier);
+template <typename T> int KalmanLayersAVX2 (T* srcWave, T* destWaveStart, CountInt pixPerThread, CountInt pixToNextFrame, CountInt numLayers, float multiplier);
+
+/* ------------------------------Minimum/Maximum/Avg/Median Intensity Projections----------------------*/
+
+/*  Structure to pass data to each ProjectTile
+ Last Modified 2026/10/16 */
+typedef struct ProjectThreadParams{
+    int inPutWaveType; // WM codes for wave types
+    char* inPutDataStartPtr; // pointer to start of data in input wave
+    char* outPutDataStartPtr; // pointer to start of data in output wave (may be same as outPut wave)
+    UInt8 flatDim; // 0 for X projection, 1 for Y projection, 2 for Z projection
+    UInt8 projMode; // 0 for minimum, 1 for maximum, 2 for average, 3 for median, 4 for percentile projection
+    CountInt xSize; // size of X dimension (number of rows)
+    CountInt ySize; // size of Y dimension (number of columns)
+    CountInt zSize; // size of Z dimension (number of layers)
+    CountInt startP; // starting point for projection
+    CountInt endP; // end point for projection
+    double percentile; // 0 to 100, the percentile to select for a percentile projection (projMode 4)
+    char* bufferPtr; // scratch space for median and percentile projections, bufferBytes for each slot of the thread pool, set by ProjectRunTiles
+    CountInt bufferBytes;
+} ProjectThreadParams, *ProjectThreadParamsPtr;
+
+void ProjectTile (void* paramsPtr, CountInt startLoc, CountInt endLoc, UInt32 iSlot);
+int ProjectRunTiles (ProjectThreadParamsPtr paramsPtr, UInt8 inPlace);
+
+/* Structure to pass data to each ProjectMultiTile. The output wave has a layer for each statistic in statMask, in the
+ order of the PROJECT_STAT bits, each the size of a projection along flatDim over the whole of that dimension
+ Last Modified 2026/10/16 */
+typedef struct ProjectMultiThreadParams{
+    int inPutWaveType;
+    char* inPutDataStartPtr;
+    char* outPutDataStartPtr;   // output of the type given by ProjectMultiOutPutType
+    UInt8 flatDim;              // 0 for X projection, 1 for Y projection, 2 for Z projection
+    UInt32 statMask;            // PROJECT_STAT bits for the statistics to make
+    CountInt xSize;
+    CountInt ySize;
+    CountInt zSize;
+    char* bufferPtr;            // scratch space for medians, bufferBytes for each slot, set by ProjectMultiRunTiles
+    CountInt bufferBytes;
+} ProjectMultiThreadParams, *ProjectMultiThreadParamsPtr;
+
+int ProjectMultiOutPutType (int inPutWaveType, UInt32 statMask);
+void ProjectMultiTile (void* paramsPtr, CountInt startLoc, CountInt endLoc, UInt32 iSlot);
+int ProjectMultiRunTiles (ProjectMultiThreadParamsPtr paramsPtr);
+
+/* Structure to pass data to each ProjectDepthTile, for a maximum and/or minimum Z projection of all the layers of the
+ input wave, with the layer of each maximum and/or minimum. With both, the outputs each have two layers, the maximum and
+ its layer first, and the minimum and its layer second
+ Last Modified 2026/10/16 */
+typedef struct ProjectDepthThreadParams{
+    int inPutWaveType;
+    char* inPutDataStartPtr;
+    char* outPutDataStartPtr;   // output wave of the same type as the input wave, for the projections
+    SInt32* indexDataStartPtr;  // 32 bit integer output wave, for the layers of the first maximum or minimum at each XY location
+    UInt8 projMode;             // 0 for minimum, 1 for maximum, 2 for both
+    CountInt xSize;
+    CountInt ySize;
+    CountInt zSize;
+} ProjectDepthThreadParams, *ProjectDepthThreadParamsPtr;
+
+void ProjectDepthTile (void* paramsPtr, CountInt startLoc, CountInt endLoc, UInt32 iSlot);
+int ProjectDepthRunTiles (ProjectDepthThreadParamsPtr paramsPtr);
+
+/* ----------------------------------------Filter ------------------------------------------------------------------*/
+
+/* Structure to pass data to each ConvolveFramesTile or SymConvolveFramesTile
+ Last Modified 2026/10/16 */
+typedef struct ConvolveFramesThreadParams{
+    int inPutWaveType;          // WaveMetrics code for waveType
+    char* inPutDataPtr;         // pointer to start of input wave
+    char* outPutDataPtr;        // pointer to start of output wave
+    char* frameBufferPtr;       // pointer to frame sized buffer for symConvolveFrames, or when overwriting with ConvolveFrames
+    CountInt xSize;            // number of columns in each frame
+    CountInt ySize;            // number of rows in each frame
+    CountInt zSize;            // number of frames
+    float * kernelDataPtr;    // pointer to start of kernel
+    float * kernelTablePtr; // pointer to start of kernel table
+    UInt16 kWidth;            // number of columns in kernel
+    UInt16 kHeight;            // number of rows in kernel (ignored by convolveSymFrames)
+    UInt8 isFloat;            // waveType of outPut wave. 0 for same type as input wave, 1 for floating point wave
+} ConvolveFramesThreadParams, *ConvolveFramesThreadParamsPtr;
+
+/* Structure to pass data to each MedianFramesTile
+ Last Modified 2026/10/16 */
+typedef struct MedianFramesThreadParams{
+    int inPutWaveType;
+    char* inPutDataStartPtr;
+    char* outPutDataStartPtr;
+    char* bufferPtr;
+    CountInt xSize;
+    CountInt ySize;
+    CountInt zSize;
+    UInt16 kWidth;
+}MedianFramesThreadParams, *MedianFramesThreadParamsPtr;
+
+float* ConvolveMakeKernelTable (float * kernel, int kWidth, int kHeight);
+void ConvolveFramesTile (void* paramsPtr, CountInt startFrame, CountInt endFrame, UInt32 iSlot);
+float * SymConvolveMakeKernelTable (float * kernel, UInt16 kWidth);
+void SymConvolveFramesTile (void* paramsPtr, CountInt startFrame, CountInt endFrame, UInt32 iSlot);
+void MedianFramesTile (void* paramsPtr, CountInt startFrame, CountInt endFrame, UInt32 iSlot);
+
+/* ------------------------------LSM Utilities --------------------------------------------------*/
+
+/* Structure to pass data to each SwapEvenTile
+Last Modified 2026/10/16 */
+typedef struct SwapEvenThreadParams{
+    int inPutWaveType;
+    char* dataStartPtr;
+    CountInt numLines;
+    CountInt lineLen;
+}SwapEvenThreadParams, *SwapEvenThreadParamsPtr;
+
+/* Structure to pass data to each DownSampleTile
+Last Modified 2026/10/16 */
+typedef struct DownSampleThreadParams{
+    int inPutWaveType;
+    char* dataStartPtr;
+    char* outPutBufferPtr;  // buffer of points/boxFactor points for the down-sampled data, copied back over the input wave
+    CountInt points;
+    CountInt boxFactor;
+    UInt8 DSType;
+}DownSampleThreadParams, *DownSampleThreadParamsPtr;
+
+/* Structure to pass data to each TransposeFramesTile
+ Last Modified 2026/10/16 */
+typedef struct TransposeFramesThreadParams{
+    int inPutWaveType;          // WaveMetrics code for waveType
+    void* dataStartPtr;         // pointer to start of input wave, which is overwritten
+    void* bufferPtr;            // pointer to start of a frame-sized buffer for each slot, not used for square frames
+    CountInt xSize;            // number of columns in each frame
+    CountInt ySize;            // number of rows in each frame
+    CountInt zSize;             // number of frames in wave
+} TransposeFramesThreadParams, *TransposeFramesThreadParamsPtr;
+
+/* Structure to pass data to each Decumulate thread. Each thread does a range of points, subtracting firstValue,
+ the count of the point before its range, from its first point. firstValue is read before the threads start, as
+ the thread doing the preceding range will overwrite it
+ Last Modified 2026/10/16 */
+typedef struct DecumulateThreadParams {
+    int inPutWaveType;          // WaveMetrics code for waveType
+    char* dataStartPtr;         // pointer to start of input wave, which is overwritten
+    CountInt startPos;          // first point for this thread
+    CountInt numPnts;           // number of points for this thread
+    UInt32 maxCount;            // maximum value of counter before rollover
+    UInt32 firstValue;          // count of point before startPos, or 0 for first thread
+    UInt8 is3232;               // set if 32 bit counter with 32 bit unsigned int wave
+} DecumulateThreadParams, * DecumulateThreadParamsPtr;
+
+/* Structure to pass data to each PipelineTile. Each tile does a range of lines in every frame, one frame after another,
+ running all the stages that are on over those lines before going on to the next frame, so the lines stay in cache
+ from one stage to the next. The stages are done in the order Decumulate, SwapEven, DownSample, Kalman
+ Last Modified 2026/10/16 */
+typedef struct PipelineThreadParams{
+    int inPutWaveType;          // WaveMetrics code for waveType
+    char* dataStartPtr;         // pointer to start of input wave, which is overwritten
+    CountInt xSize;             // number of columns in each frame, before down sampling
+    CountInt ySize;             // number of rows in each frame
+    CountInt zSize;             // number of frames
+    UInt8 doDecumulate;         // non-zero to decumulate counts
+    UInt32 maxCount;            // for Decumulate, maximum value of counter before rollover
+    UInt8 is3232;               // for Decumulate, set if 32 bit counter with 32 bit unsigned int wave
+    UInt8 doSwapEven;           // non-zero to swap every other line
+    UInt8 DSType;               // DownSample type, 1 = average, 2 = sum, 3 = max, 4 = median, or 0 for no down sampling
+    CountInt boxFactor;         // for DownSample, number of points combined into one
+    UInt8 doKalman;             // non-zero to Kalman average all the frames into the first frame
+    float multiplier;           // for Kalman averaging, as for KalmanWaveToFrame
+    // set by PipelineRunTiles
+    CountInt linesPerTile;      // lines of each frame in a tile
+    char* outPutBufferPtr;      // down-sampled frames, or Kalman average, copied over the start of the wave at the end
+    UInt32* firstValuesPtr;     // for Decumulate, count of the point before each tile in each frame, read before tiles run
+    double* sumBufferPtr;       // for Kalman averaging with multiplier < 1, a buffer of sums for the lines of each slot
+} PipelineThreadParams, *PipelineThreadParamsPtr;
+
+void SwapEvenTile (void* paramsPtr, CountInt startPair, CountInt endPair, UInt32 iSlot);
+void SwapEvenRunTiles (SwapEvenThreadParamsPtr paramsPtr);
+UInt8 DownSamplePointBytes (int waveType);
+void DownSampleTile (void* paramsPtr, CountInt startBox, CountInt endBox, UInt32 iSlot);
+void DownSampleRunTiles (DownSampleThreadParamsPtr paramsPtr);
+void TransposeFramesTile (void* paramsPtr, CountInt startFrame, CountInt endFrame, UInt32 iSlot);
+UInt32 DecumulateFirstValue (int waveType, char* dataStartPtr, CountInt startPos);
+void* DecumulateThread (void* threadarg);
+void PipelineTile (void* paramsPtr, CountInt startLine, CountInt endLine, UInt32 iSlot);
+int PipelineRunTiles (PipelineThreadParamsPtr paramsPtr, UInt32 nSlots);
+
+/* template for a stand-alone selection function for any data type, used by medianT and robust averaging. Partitions
+ the data so the point at selectOffset is the value that would be there if the data were sorted, with no larger values
+ before it and no smaller values after it, and returns that value
+ n = number of data points, selectOffset = offset of point to select, dataStrtPtr is pointer to start of data
+ Last Modified 2026/10/16 */
+template <typename T> T selectT (UInt32 n, UInt32 selectOffset, T* dataStrtPtr) {
+    UInt32 medianOffset = selectOffset; // point offset to location of selected value when function returns
+    UInt32 i,right = n -1,j,left =0, mid; // point offsets used for partitioning
+    T a; //
+    T temp; // used for SWAP macro
+    for (;;) {
+        if (right <= left+1) {
+            if (right == left+1 && *(dataStrtPtr + right) < *(dataStrtPtr + left)) {
+                SWAP((*(dataStrtPtr + left)),(*(dataStrtPtr + right)));
+            }
+            return *(dataStrtPtr + medianOffset);
+        } else {
+            mid=(left + right) >> 1;
+            SWAP((*(dataStrtPtr + mid)),(*(dataStrtPtr + left + 1)));
+            if (*(dataStrtPtr + left) > *(dataStrtPtr + right)) {
+                SWAP((*(dataStrtPtr + left)),(*(dataStrtPtr + right)));
+            }
+            if (*(dataStrtPtr + left + 1) > *(dataStrtPtr + right)) {
+                SWAP((*(dataStrtPtr + left + 1)), ( *(dataStrtPtr + right)));
+            }
+            if (*(dataStrtPtr + left) > *(dataStrtPtr + left+1)) {
+                SWAP((*(dataStrtPtr + left)),(*(dataStrtPtr + left+1)));
+            }
+            i=left+1;
+            j=right;
+            a=*(dataStrtPtr + left+1);
+            for (;;) {
+                do i++; while (*(dataStrtPtr + i) < a);
+                do j--; while (*(dataStrtPtr + j) > a);
+                if (j < i) break;
+                SWAP((*(dataStrtPtr + i)),(*(dataStrtPtr + j)));
+            }
+            *(dataStrtPtr + left + 1) = *(dataStrtPtr + j);
+            *(dataStrtPtr + j) = a;
+            if (j >= medianOffset) right=j-1;
+            if (j <= medianOffset) left=i;
+        }
+    }
+}
+
+/* template for a stand-alone median function for any data type, used by MedianFrames and the projections
+ n = number of data points, dataStrtPtr is pointer to start of data
+ Last Modified 2026/10/16 */
+template <typename T> T medianT (UInt32 n, T* dataStrtPtr) {
+    return selectT (n, n/2, dataStrtPtr);
+}
+
+#endif